@@ -29,6 +29,7 @@ void connection_callback(void* user_data, MoqConnectionState state) {
         case MOQ_STATE_CONNECTING: state_str = "CONNECTING"; break;
         case MOQ_STATE_CONNECTED: state_str = "CONNECTED"; break;
         case MOQ_STATE_FAILED: state_str = "FAILED"; break;
+        case MOQ_STATE_RESUMING: state_str = "RESUMING"; break;
     }
     printf("Connection state changed: %s\n", state_str);
 }
@@ -31,6 +31,9 @@ void connection_state_callback(void* user_data, MoqConnectionState state) {
             printf("FAILED\n");
             data->failed = true;
             break;
+        case MOQ_STATE_RESUMING:
+            printf("RESUMING\n");
+            break;
     }
 }
 
@@ -176,6 +179,21 @@ void test_disconnect_without_connect(void) {
     moq_client_destroy(client);
 }
 
+void test_set_auto_resume(void) {
+    moq_init();
+
+    MoqResult result = moq_client_set_auto_resume(NULL, true);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_client_set_auto_resume(NULL) should be rejected");
+    moq_free_str(result.message);
+
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+    result = moq_client_set_auto_resume(client, true);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_client_set_auto_resume() should succeed");
+    moq_client_destroy(client);
+}
+
 void test_double_connect(void) {
     moq_init();
 
@@ -204,6 +222,7 @@ int main(void) {
     test_connect_invalid_url();
     test_disconnect_null_client();
     test_disconnect_without_connect();
+    test_set_auto_resume();
 
     /* These tests require network access */
     printf("\n--- Network-dependent tests ---\n");
@@ -0,0 +1,328 @@
+#include "test_framework.h"
+#include "moq_ffi.hpp"
+#include <cstdio>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Tests for the header-only C++ wrapper (moq_ffi.hpp).
+ *
+ * Ownership and error handling are checked against any backend; the pub/sub
+ * round trip runs on the simulated relay and is skipped when the library was
+ * built with a real transport.
+ */
+
+#define SIM_URL "sim://cpp-wrapper?seed=7"
+
+// Handles are move-only, pointer-sized and never throw when moved
+static_assert(!std::is_copy_constructible_v<moq::Client>);
+static_assert(!std::is_copy_constructible_v<moq::Publisher>);
+static_assert(!std::is_copy_constructible_v<moq::Subscriber>);
+static_assert(!std::is_copy_constructible_v<moq::WriteSlot>);
+static_assert(!std::is_copy_constructible_v<moq::Result>);
+static_assert(std::is_nothrow_move_constructible_v<moq::Client>);
+static_assert(std::is_nothrow_move_assignable_v<moq::Client>);
+static_assert(std::is_nothrow_move_constructible_v<moq::Publisher>);
+static_assert(std::is_nothrow_move_constructible_v<moq::Subscriber>);
+static_assert(std::is_nothrow_move_constructible_v<moq::WriteSlot>);
+static_assert(std::is_nothrow_move_constructible_v<moq::Result>);
+static_assert(sizeof(moq::Client) == sizeof(MoqClient*));
+static_assert(sizeof(moq::Subscriber) == sizeof(MoqSubscriber*));
+static_assert(!std::is_copy_constructible_v<moq::Object>);
+static_assert(std::is_nothrow_move_constructible_v<moq::Object>);
+static_assert(moq::Executor<moq::InlineExecutor>);
+
+/* Minimal eagerly started coroutine, just enough to drive the awaitables */
+struct Task {
+    struct promise_type {
+        Task get_return_object() noexcept {
+            return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+    bool done() const { return handle.done(); }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/* Executor deferring resumption to the test, like posting to an event loop */
+struct Deferred {
+    std::vector<std::coroutine_handle<>>* pending;
+
+    void operator()(std::coroutine_handle<> handle) const noexcept { pending->push_back(handle); }
+};
+
+static void run_pending(std::vector<std::coroutine_handle<>>& pending) {
+    std::vector<std::coroutine_handle<>> handles;
+    handles.swap(pending);
+    for (std::coroutine_handle<> handle : handles) {
+        handle.resume();
+    }
+}
+
+struct Received {
+    std::vector<std::string> payloads;
+
+    void operator()(moq::Bytes data) {
+        payloads.emplace_back(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+};
+
+struct BatchReceived {
+    size_t batches = 0;
+    size_t objects = 0;
+
+    void operator()(moq::Objects batch) {
+        batches++;
+        objects += batch.size();
+    }
+};
+
+static moq::Bytes as_bytes(const char* text) {
+    return std::as_bytes(std::span<const char>(text, std::strlen(text)));
+}
+
+void test_ownership_and_moves() {
+    moq::init();
+
+    moq::Client client;
+    TEST_ASSERT(static_cast<bool>(client), "moq::Client should create a client");
+    MoqClient* raw = client.get();
+
+    moq::Client moved(std::move(client));
+    TEST_ASSERT(!client, "A moved-from client should be empty");
+    TEST_ASSERT(moved.get() == raw, "The moved-to client should own the handle");
+
+    moq::Client assigned;
+    assigned = std::move(moved);
+    TEST_ASSERT(assigned.get() == raw, "Move assignment should transfer the handle");
+
+    MoqClient* released = assigned.release();
+    TEST_ASSERT(!assigned, "release() should leave the client empty");
+    moq_client_destroy(released);
+
+    moq::Publisher publisher;
+    moq::Subscriber subscriber;
+    moq::WriteSlot slot;
+    TEST_ASSERT(!publisher && !subscriber && !slot, "Default-constructed handles should be empty");
+    TEST_ASSERT(slot.data().empty(), "An empty slot should expose no memory");
+}
+
+void test_results_own_messages() {
+    moq::Client client;
+
+    moq::Result result = client.announce_namespace("cpp");
+    TEST_ASSERT(!result, "Announcing without a connection should fail");
+    TEST_ASSERT_EQ(result.code(), MOQ_ERROR_NOT_CONNECTED,
+                   "The error code should be carried through");
+    TEST_ASSERT(!result.message().empty(), "The error message should be available");
+
+    moq::Result moved = std::move(result);
+    TEST_ASSERT(!moved.message().empty(), "Moving a result should move its message");
+
+    moq::Publisher publisher = client.create_publisher("cpp", "track");
+    TEST_ASSERT(!publisher, "Creating a publisher without a connection should fail");
+
+    moq::Result publish = publisher.publish(as_bytes("x"));
+    TEST_ASSERT_EQ(publish.code(), MOQ_ERROR_INVALID_ARGUMENT,
+                   "Publishing on an empty publisher should be rejected");
+
+    TEST_ASSERT(!moq::version().empty(), "moq::version() should return the version");
+}
+
+void test_simulated_round_trip() {
+    moq::Client publisher_client;
+    moq::Client subscriber_client;
+
+    moq::Result connected = publisher_client.connect(SIM_URL);
+    if (connected.code() == MOQ_ERROR_UNSUPPORTED) {
+        printf("Simulated relay not available in this build, skipping\n");
+        return;
+    }
+    TEST_ASSERT(connected.ok(), "Client::connect() to a simulated relay should succeed");
+
+    int states = 0;
+    auto on_state = [&states](MoqConnectionState state) {
+        if (state == MOQ_STATE_CONNECTED) {
+            states++;
+        }
+    };
+    TEST_ASSERT(subscriber_client.connect(SIM_URL, on_state).ok(),
+                "Client::connect() with a state handler should succeed");
+    TEST_ASSERT_EQ(states, 1, "The state handler should see the connection");
+
+    std::vector<std::string> announced;
+    auto on_track = [&announced](std::string_view ns, std::string_view track) {
+        announced.emplace_back(std::string(ns) + "/" + std::string(track));
+    };
+    TEST_ASSERT(subscriber_client.subscribe_announces(on_track).ok(),
+                "Client::subscribe_announces() should succeed");
+
+    Received received;
+    moq::Subscriber subscriber = subscriber_client.subscribe("cpp", "state", received);
+    TEST_ASSERT(static_cast<bool>(subscriber), "Client::subscribe() should succeed");
+
+    BatchReceived batches;
+    moq::Subscriber batched = subscriber_client.subscribe_batched("cpp", "state", batches, {8, 0});
+    TEST_ASSERT(static_cast<bool>(batched), "Client::subscribe_batched() should succeed");
+
+    TEST_ASSERT(publisher_client.announce_namespace("cpp").ok(), "Announcing should succeed");
+    moq::Publisher publisher = publisher_client.create_publisher("cpp", "state");
+    TEST_ASSERT(static_cast<bool>(publisher), "Client::create_publisher() should succeed");
+
+    TEST_ASSERT(publisher.publish(as_bytes("first")).ok(), "Publisher::publish() should succeed");
+
+    {
+        moq::WriteSlot slot = publisher.acquire(16);
+        TEST_ASSERT(slot.data().size() >= 16, "Publisher::acquire() should return a buffer");
+        std::memcpy(slot.data().data(), "second", 6);
+        TEST_ASSERT(slot.commit(6).ok(), "WriteSlot::commit() should publish the buffer");
+        TEST_ASSERT(!slot, "A committed slot should be empty");
+    }
+    {
+        // Dropped without commit: returned to the pool, nothing published
+        moq::WriteSlot slot = publisher.acquire(16);
+        TEST_ASSERT(static_cast<bool>(slot), "A second acquire should succeed");
+    }
+
+    TEST_ASSERT(moq_sim_advance(SIM_URL, 10000).code == MOQ_OK, "Advancing the relay should succeed");
+    TEST_ASSERT_EQ(received.payloads.size(), 2, "Both objects should be delivered");
+    if (received.payloads.size() == 2) {
+        TEST_ASSERT_STR_EQ(received.payloads[0].c_str(), "first", "Payloads should arrive in order");
+        TEST_ASSERT_STR_EQ(received.payloads[1].c_str(), "second", "Slot payloads should arrive intact");
+    }
+    TEST_ASSERT_EQ(batches.objects, 2, "The batched subscriber should see both objects");
+    TEST_ASSERT_EQ(announced.size(), 1, "The track should be announced once");
+    if (announced.size() == 1) {
+        TEST_ASSERT_STR_EQ(announced[0].c_str(), "cpp/state", "The announced track should be named");
+    }
+
+    // Swap handlers on the live subscriber, then pause it
+    Received replacement;
+    TEST_ASSERT(subscriber.set_callback(replacement).ok(), "Subscriber::set_callback() should succeed");
+    TEST_ASSERT(publisher.publish(as_bytes("third")).ok(), "Publishing should still succeed");
+    TEST_ASSERT(moq_sim_advance(SIM_URL, 10000).code == MOQ_OK, "Advancing the relay should succeed");
+    TEST_ASSERT_EQ(replacement.payloads.size(), 1, "The replacement handler should receive the object");
+    TEST_ASSERT_EQ(received.payloads.size(), 2, "The previous handler should no longer be called");
+
+    TEST_ASSERT(subscriber.pause().ok(), "Subscriber::pause() should succeed");
+    TEST_ASSERT(subscriber.unsubscribe().ok(), "Subscriber::unsubscribe() should succeed");
+    TEST_ASSERT(!subscriber.is_subscribed(), "The subscriber should report it is unsubscribed");
+
+    // Destruction order: subscribers and publishers before their clients
+    batched = moq::Subscriber();
+    subscriber = moq::Subscriber();
+    publisher = moq::Publisher();
+    TEST_ASSERT(subscriber_client.disconnect().ok(), "Client::disconnect() should succeed");
+    TEST_ASSERT(!subscriber_client.is_connected(), "The client should report it is disconnected");
+}
+
+static Task connect_task(const moq::Client& client, moq::Result& connected) {
+    connected = co_await client.connect_async(SIM_URL);
+}
+
+static Task flush_task(const moq::Publisher& publisher, Deferred executor, moq::Result& flushed) {
+    flushed = co_await publisher.flush_async(1000, executor);
+}
+
+static Task consume_task(const moq::Subscriber& subscriber, Deferred executor,
+                         std::vector<std::string>& payloads) {
+    while (moq::Object object = co_await subscriber.next(executor)) {
+        moq::Bytes data = object.data();
+        payloads.emplace_back(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+}
+
+void test_coroutines() {
+    moq::Client client;
+    moq::Result connected;
+    Task connecting = connect_task(client, connected);
+    if (connected.code() == MOQ_ERROR_UNSUPPORTED) {
+        printf("Simulated relay not available in this build, skipping\n");
+        return;
+    }
+    TEST_ASSERT(connecting.done(), "A simulated connect should complete without suspending");
+    TEST_ASSERT(connected.ok(), "co_await connect_async() should yield the connect result");
+
+    moq::Result invalid;
+    moq::Client empty(nullptr);
+    Task rejected = connect_task(empty, invalid);
+    TEST_ASSERT(rejected.done(), "A rejected connect should resume immediately");
+    TEST_ASSERT_EQ(invalid.code(), MOQ_ERROR_INVALID_ARGUMENT, "The validation error should be yielded");
+
+    moq::Subscriber subscriber = client.subscribe_queued("cpp", "queued");
+    TEST_ASSERT(static_cast<bool>(subscriber), "Client::subscribe_queued() should succeed");
+
+    std::vector<std::coroutine_handle<>> pending;
+    std::vector<std::string> payloads;
+    Task consuming = consume_task(subscriber, Deferred{&pending}, payloads);
+    TEST_ASSERT(!consuming.done() && pending.empty(), "The consumer should wait for data");
+
+    TEST_ASSERT(client.announce_namespace("cpp").ok(), "Announcing should succeed");
+    moq::Publisher publisher = client.create_publisher("cpp", "queued");
+    TEST_ASSERT(publisher.publish(as_bytes("one")).ok(), "Publishing should succeed");
+    TEST_ASSERT(publisher.publish(as_bytes("two")).ok(), "Publishing should succeed");
+    TEST_ASSERT(moq_sim_advance(SIM_URL, 10000).code == MOQ_OK, "Advancing the relay should succeed");
+    TEST_ASSERT_EQ(pending.size(), 1, "Arriving objects should schedule the consumer once");
+    TEST_ASSERT(payloads.empty(), "The consumer should only run when the executor resumes it");
+
+    run_pending(pending);
+    TEST_ASSERT_EQ(payloads.size(), 2, "The consumer should drain both objects");
+    if (payloads.size() == 2) {
+        TEST_ASSERT_STR_EQ(payloads[0].c_str(), "one", "Objects should be awaited in order");
+        TEST_ASSERT_STR_EQ(payloads[1].c_str(), "two", "Objects should be awaited in order");
+    }
+    TEST_ASSERT(!consuming.done(), "The consumer should wait for more data");
+
+    // Flush: resumes once the relay has everything published before it
+    uint64_t unacked = 0;
+    TEST_ASSERT(publisher.unacked_bytes(unacked).ok() && unacked == 0, "Delivered objects should be acknowledged");
+    TEST_ASSERT(publisher.publish(as_bytes("three")).ok(), "Publishing should succeed");
+    TEST_ASSERT(publisher.unacked_bytes(unacked).ok() && unacked == 5, "A new object should be unacknowledged");
+    moq::Result flushed;
+    Task flushing = flush_task(publisher, Deferred{&pending}, flushed);
+    TEST_ASSERT(!flushing.done() && pending.empty(), "The flush should wait for the relay");
+    TEST_ASSERT(moq_sim_advance(SIM_URL, 10000).code == MOQ_OK, "Advancing the relay should succeed");
+    TEST_ASSERT_EQ(pending.size(), 2, "The flush and the consumer should both be scheduled");
+    run_pending(pending);
+    TEST_ASSERT(flushing.done() && flushed.ok(), "co_await flush_async() should yield success");
+    TEST_ASSERT_EQ(payloads.size(), 3, "The flushed object should be delivered");
+    TEST_ASSERT(publisher.flush(0).ok(), "Flushing with nothing outstanding should succeed at once");
+
+    TEST_ASSERT(subscriber.unsubscribe().ok(), "Subscriber::unsubscribe() should succeed");
+    TEST_ASSERT_EQ(pending.size(), 1, "Unsubscribing should wake the consumer");
+    run_pending(pending);
+    TEST_ASSERT(consuming.done(), "The consumer should see the end of the track");
+
+    publisher = moq::Publisher();
+    subscriber = moq::Subscriber();
+}
+
+int main(void) {
+    TEST_INIT();
+
+    printf("Running C++ wrapper tests...\n\n");
+
+    test_ownership_and_moves();
+    test_results_own_messages();
+    test_simulated_round_trip();
+    test_coroutines();
+
+    TEST_EXIT();
+    return 0;
+}
@@ -89,7 +89,8 @@ void test_result_code_ranges(void) {
         MOQ_ERROR_TIMEOUT,
         MOQ_ERROR_INTERNAL,
         MOQ_ERROR_UNSUPPORTED,
-        MOQ_ERROR_BUFFER_TOO_SMALL
+        MOQ_ERROR_BUFFER_TOO_SMALL,
+        MOQ_ERROR_UNCONFIRMED
     };
     int num_codes = sizeof(codes) / sizeof(codes[0]);
     int i, j;
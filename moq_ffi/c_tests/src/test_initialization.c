@@ -33,6 +33,65 @@ void test_moq_last_error_initial(void) {
     }
 }
 
+void test_moq_runtime_stats(void) {
+    TEST_ASSERT(!moq_get_runtime_stats(NULL), "moq_get_runtime_stats(NULL) should return false");
+
+    MoqRuntimeStats stats;
+    TEST_ASSERT(moq_get_runtime_stats(&stats), "moq_get_runtime_stats() should succeed");
+    printf("Runtime: %zu workers, %zu alive tasks\n", stats.worker_threads, stats.alive_tasks);
+}
+
+static void count_disconnects(void* user_data, MoqConnectionState state) {
+    if (state == MOQ_STATE_DISCONNECTED) {
+        ++*(int*)user_data;
+    }
+}
+
+void test_moq_shutdown_and_reinit(void) {
+    for (int cycle = 0; cycle < 3; ++cycle) {
+        TEST_ASSERT(moq_init(), "moq_init() should succeed after a shutdown");
+        MoqRuntimeStats stats;
+        TEST_ASSERT(moq_get_runtime_stats(&stats), "The runtime should start again");
+
+        MoqClient* client = moq_client_create();
+        TEST_ASSERT_NOT_NULL(client, "Clients should be created after a shutdown");
+        int disconnects = 0;
+        MoqResult result = moq_connect(client, "sim://shutdown", count_disconnects, &disconnects);
+        bool connected = result.code == MOQ_OK;
+        moq_free_str(result.message);
+
+        result = moq_shutdown(1000);
+        TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_shutdown() should release everything in time");
+        moq_free_str(result.message);
+        TEST_ASSERT(!moq_is_connected(client), "Shutdown should disconnect every client");
+        if (connected) {
+            TEST_ASSERT_EQ(disconnects, 1, "The client should be told it was disconnected");
+        }
+        moq_client_destroy(client);
+    }
+
+    /* Nothing left to release */
+    MoqResult result = moq_shutdown(0);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "A second moq_shutdown() should be harmless");
+    moq_free_str(result.message);
+    TEST_ASSERT(moq_init(), "moq_init() should succeed after a shutdown");
+}
+
+void test_moq_prewarm(void) {
+    MoqResult result = moq_prewarm(NULL, 0);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "Prewarming without URLs should succeed");
+    moq_free_str(result.message);
+
+    result = moq_prewarm(NULL, 1);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT, "Prewarming NULL URLs should fail");
+    moq_free_str(result.message);
+
+    const char* urls[] = {NULL};
+    result = moq_prewarm_ex(urls, 1, true);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT, "Prewarming a NULL URL should fail");
+    moq_free_str(result.message);
+}
+
 void test_result_codes(void) {
     /* Verify all result codes are defined */
     TEST_ASSERT_EQ(MOQ_OK, 0, "MOQ_OK should be 0");
@@ -54,6 +113,8 @@ void test_connection_state_enum(void) {
                     "MOQ_STATE_CONNECTED should differ from DISCONNECTED");
     TEST_ASSERT_NEQ(MOQ_STATE_FAILED, MOQ_STATE_DISCONNECTED,
                     "MOQ_STATE_FAILED should differ from DISCONNECTED");
+    TEST_ASSERT_NEQ(MOQ_STATE_RESUMING, MOQ_STATE_CONNECTING,
+                    "MOQ_STATE_RESUMING should differ from CONNECTING");
 }
 
 void test_delivery_mode_enum(void) {
@@ -72,6 +133,9 @@ int main(void) {
     test_moq_init_idempotent();
     test_moq_version();
     test_moq_last_error_initial();
+    test_moq_runtime_stats();
+    test_moq_prewarm();
+    test_moq_shutdown_and_reinit();
     test_result_codes();
     test_connection_state_enum();
     test_delivery_mode_enum();
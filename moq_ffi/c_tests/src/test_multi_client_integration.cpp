@@ -47,6 +47,9 @@ void multi_client_connection_callback(void* user_data, MoqConnectionState state)
         case MOQ_STATE_DISCONNECTED:
             cout << "[CLIENT-" << ctx->client_id << "] Disconnected" << endl;
             break;
+        case MOQ_STATE_RESUMING:
+            cout << "[CLIENT-" << ctx->client_id << "] Resuming, subscriptions ended" << endl;
+            break;
     }
 }
 
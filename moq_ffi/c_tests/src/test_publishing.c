@@ -108,6 +108,56 @@ void test_create_publisher_ex_delivery_modes(void) {
     moq_client_destroy(client);
 }
 
+void test_create_publishers_null_arguments(void) {
+    moq_init();
+
+    const char* names[] = {"track-a", "track-b"};
+    MoqPublisher* pubs[2];
+
+    MoqResult result = moq_create_publishers(
+        NULL, "namespace", names, 2, MOQ_DELIVERY_STREAM, pubs);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_create_publishers(NULL client) should return INVALID_ARGUMENT");
+    moq_free_str(result.message);
+
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+
+    result = moq_create_publishers(
+        client, "namespace", NULL, 2, MOQ_DELIVERY_STREAM, pubs);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_create_publishers() with NULL track_names should return INVALID_ARGUMENT");
+    moq_free_str(result.message);
+
+    result = moq_create_publishers(
+        client, "namespace", names, 2, MOQ_DELIVERY_STREAM, NULL);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_create_publishers() with NULL output array should return INVALID_ARGUMENT");
+    moq_free_str(result.message);
+
+    moq_client_destroy(client);
+}
+
+void test_create_publishers_not_connected(void) {
+    moq_init();
+
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+
+    const char* names[] = {"track-a", "track-b", "track-c"};
+    MoqPublisher* pubs[3] = {0};
+
+    MoqResult result = moq_create_publishers(
+        client, "namespace", names, 3, MOQ_DELIVERY_DATAGRAM, pubs);
+    TEST_ASSERT_NEQ(result.code, MOQ_OK,
+                    "Should fail to create publishers without connection");
+    TEST_ASSERT(pubs[0] == NULL && pubs[1] == NULL && pubs[2] == NULL,
+                "All publisher outputs should be NULL on failure");
+    moq_free_str(result.message);
+
+    moq_client_destroy(client);
+}
+
 void test_publish_data_null_publisher(void) {
     moq_init();
 
@@ -121,6 +171,43 @@ void test_publish_data_null_publisher(void) {
                    "Should return INVALID_ARGUMENT for NULL publisher");
 }
 
+void test_publish_file_range_null_arguments(void) {
+    moq_init();
+
+    MoqResult result = moq_publish_file_range(NULL, "asset.bin", 0, 16);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_publish_file_range(NULL publisher) should return INVALID_ARGUMENT");
+    if (result.message) {
+        moq_free_str(result.message);
+    }
+}
+
+void test_publish_acquire_null_publisher(void) {
+    moq_init();
+
+    MoqWriteSlot slot = moq_publish_acquire(NULL, 64);
+    TEST_ASSERT_NULL(slot.data, "moq_publish_acquire(NULL) should return an empty slot");
+    TEST_ASSERT_EQ(slot.capacity, (size_t)0, "Empty slot should have no capacity");
+
+    MoqResult result = moq_publish_commit(&slot, 0);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "Committing an empty slot should return INVALID_ARGUMENT");
+    if (result.message) {
+        moq_free_str(result.message);
+    }
+
+    result = moq_publish_commit(NULL, 0);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_publish_commit(NULL) should return INVALID_ARGUMENT");
+    if (result.message) {
+        moq_free_str(result.message);
+    }
+
+    /* Releasing NULL or empty slots must be safe */
+    moq_publish_release(NULL);
+    moq_publish_release(&slot);
+}
+
 void test_publish_data_null_data(void) {
     moq_init();
 
@@ -240,7 +327,12 @@ int main(void) {
     test_create_publisher_ex_null_client();
     test_create_publisher_ex_delivery_modes();
 
+    test_create_publishers_null_arguments();
+    test_create_publishers_not_connected();
+
     test_publish_data_null_publisher();
+    test_publish_acquire_null_publisher();
+    test_publish_file_range_null_arguments();
     test_publish_data_null_data();
     test_publish_data_zero_length();
     test_publish_data_large_payload();
@@ -61,6 +61,9 @@ void connection_callback(void* user_data, MoqConnectionState state) {
         case MOQ_STATE_DISCONNECTED:
             cout << "[CONNECTION] Disconnected" << endl;
             break;
+        case MOQ_STATE_RESUMING:
+            cout << "[CONNECTION] Resuming, subscriptions ended" << endl;
+            break;
     }
 }
 
@@ -0,0 +1,331 @@
+#include "test_framework.h"
+#include "moq_ffi.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SIM_URL "sim://c-tests?seed=1"
+
+typedef struct {
+    int count;
+    uint64_t arrival_us;
+    char last[32];
+} Arrivals;
+
+static void on_data(void* user_data, const uint8_t* data, size_t data_len) {
+    Arrivals* arrivals = (Arrivals*)user_data;
+    arrivals->count++;
+    arrivals->arrival_us = moq_sim_now(SIM_URL);
+    if (data_len < sizeof(arrivals->last)) {
+        memcpy(arrivals->last, data, data_len);
+        arrivals->last[data_len] = '\0';
+    }
+}
+
+static void on_track(void* user_data, const char* namespace_str, const char* track_name) {
+    int* announced = (int*)user_data;
+    (*announced)++;
+    printf("Announced track: %s/%s\n", namespace_str, track_name);
+}
+
+/* Returns false (and passes) when the library was built with a real transport */
+static bool connect_simulated(MoqClient* client) {
+    MoqResult result = moq_connect(client, SIM_URL, NULL, NULL);
+    if (result.code == MOQ_ERROR_UNSUPPORTED) {
+        printf("Simulated relay not available in this build, skipping\n");
+        moq_free_str(result.message);
+        return false;
+    }
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_connect() to a simulated relay should succeed");
+    moq_free_str(result.message);
+    return result.code == MOQ_OK;
+}
+
+void test_simulated_pubsub(void) {
+    moq_init();
+
+    MoqClient* publisher_client = moq_client_create();
+    MoqClient* subscriber_client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(publisher_client, "Publisher client should be created");
+    TEST_ASSERT_NOT_NULL(subscriber_client, "Subscriber client should be created");
+
+    if (!connect_simulated(publisher_client) || !connect_simulated(subscriber_client)) {
+        moq_client_destroy(subscriber_client);
+        moq_client_destroy(publisher_client);
+        return;
+    }
+
+    MoqSimLink uplink = { 15000, 0, 0, 0.0 };
+    MoqSimLink downlink = { 25000, 0, 0, 0.0 };
+    MoqResult result = moq_sim_set_link(publisher_client, &uplink, NULL);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_set_link() should set the uplink");
+    result = moq_sim_set_link(subscriber_client, NULL, &downlink);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_set_link() should set the downlink");
+
+    int announced = 0;
+    result = moq_subscribe_announces(subscriber_client, on_track, &announced);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_subscribe_announces() should succeed");
+
+    Arrivals arrivals = { 0, 0, "" };
+    MoqSubscriber* sub = moq_subscribe(subscriber_client, "sim", "state", on_data, &arrivals);
+    TEST_ASSERT_NOT_NULL(sub, "moq_subscribe() should succeed on a simulated relay");
+
+    result = moq_announce_namespace(publisher_client, "sim");
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_announce_namespace() should succeed");
+    MoqPublisher* pub = moq_create_publisher(publisher_client, "sim", "state");
+    TEST_ASSERT_NOT_NULL(pub, "moq_create_publisher() should succeed after announcing");
+
+    uint64_t start = moq_sim_now(SIM_URL);
+    const char* payload = "frame-1";
+    result = moq_publish_data(pub, (const uint8_t*)payload, strlen(payload), MOQ_DELIVERY_STREAM);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_publish_data() should succeed");
+    TEST_ASSERT_EQ(arrivals.count, 0, "Nothing is delivered before the clock advances");
+
+    result = moq_sim_advance(SIM_URL, 100000);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_advance() should succeed");
+    TEST_ASSERT_EQ(arrivals.count, 1, "The object should arrive after advancing");
+    TEST_ASSERT_EQ((int)(arrivals.arrival_us - start), 40000,
+                   "Arrival should take uplink plus downlink latency");
+    TEST_ASSERT_STR_EQ(arrivals.last, payload, "Payload should arrive intact");
+    TEST_ASSERT_EQ(announced, 1, "The new track should be announced to the other client");
+
+    moq_subscriber_destroy(sub);
+    moq_publisher_destroy(pub);
+    moq_disconnect(subscriber_client);
+    moq_disconnect(publisher_client);
+    moq_client_destroy(subscriber_client);
+    moq_client_destroy(publisher_client);
+}
+
+static void on_latency(void* user_data, uint64_t latency_us, uint64_t sequence) {
+    uint64_t* last = (uint64_t*)user_data;
+    (void)sequence;
+    *last = latency_us;
+}
+
+void test_simulated_latency_probe(void) {
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+    if (!connect_simulated(client)) {
+        moq_client_destroy(client);
+        return;
+    }
+
+    MoqSimLink uplink = { 10000, 0, 0, 0.0 };
+    MoqSimLink downlink = { 20000, 0, 0, 0.0 };
+    MoqResult result = moq_sim_set_link(client, &uplink, &downlink);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_set_link() should set both links");
+
+    uint64_t last_us = 0;
+    result = moq_client_start_latency_probe(client, 50, on_latency, &last_us);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_client_start_latency_probe() should succeed");
+    result = moq_sim_advance(SIM_URL, 200000);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_advance() should succeed");
+
+    MoqLatencyStats stats;
+    result = moq_client_get_latency_stats(client, &stats);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_client_get_latency_stats() should succeed");
+    TEST_ASSERT_EQ((int)stats.probes_received, 3, "Probes sent 50, 100 and 150 ms in should be back");
+    TEST_ASSERT_EQ((int)stats.smoothed_us, 30000, "Probes should take uplink plus downlink latency");
+    TEST_ASSERT_EQ((int)last_us, 30000, "The callback should see every probe");
+
+    result = moq_client_stop_latency_probe(client);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_client_stop_latency_probe() should succeed");
+    moq_disconnect(client);
+    moq_client_destroy(client);
+}
+
+static void on_object(void* user_data, const uint8_t* data, size_t data_len, const MoqObjectInfo* info) {
+    MoqObjectInfo* last = (MoqObjectInfo*)user_data;
+    (void)data;
+    (void)data_len;
+    *last = *info;
+}
+
+void test_simulated_capture_latency(void) {
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+    if (!connect_simulated(client)) {
+        moq_client_destroy(client);
+        return;
+    }
+
+    MoqSimLink uplink = { 10000, 0, 0, 0.0 };
+    MoqSimLink downlink = { 20000, 0, 0, 0.0 };
+    MoqResult result = moq_sim_set_link(client, &uplink, &downlink);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_set_link() should set both links");
+    /* The capture time travels in-band, which both ends have to opt in to */
+    result = moq_client_set_inband_headers(client, true);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_client_set_inband_headers() should succeed");
+
+    MoqObjectInfo last;
+    memset(&last, 0, sizeof(last));
+    MoqSubscriber* sub = moq_subscribe(client, "camera", "video", NULL, NULL);
+    TEST_ASSERT_NOT_NULL(sub, "moq_subscribe() should succeed");
+    result = moq_subscriber_set_object_callback(sub, on_object, &last);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_subscriber_set_object_callback() should succeed");
+    result = moq_announce_namespace(client, "camera");
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_announce_namespace() should succeed");
+    MoqPublisher* pub = moq_create_publisher(client, "camera", "video");
+    TEST_ASSERT_NOT_NULL(pub, "moq_create_publisher() should succeed");
+
+    /* A frame captured 5 ms before it is published */
+    result = moq_sim_advance(SIM_URL, 10000);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_advance() should succeed");
+    uint64_t capture_us = moq_sim_now(SIM_URL) - 5000;
+    const uint8_t frame[4] = { 1, 2, 3, 4 };
+    result = moq_publish_data_timestamped(pub, frame, sizeof(frame), capture_us);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_publish_data_timestamped() should succeed");
+    result = moq_sim_advance(SIM_URL, 100000);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_advance() should succeed");
+
+    TEST_ASSERT(last.latency_valid, "A stamped object should have a latency");
+    TEST_ASSERT_EQ((int)(last.capture_time_us == capture_us), 1, "The capture time should arrive with the object");
+    TEST_ASSERT_EQ((int)last.latency_us, 35000, "Latency should run from capture through both links");
+
+    moq_subscriber_destroy(sub);
+    moq_publisher_destroy(pub);
+    moq_disconnect(client);
+    moq_client_destroy(client);
+}
+
+typedef struct {
+    size_t count;
+    uint64_t first_key;
+    char first_data[16];
+} ReceivedExtensions;
+
+/* Extensions are only valid during the callback, so copy what the test checks */
+static void on_extensions(void* user_data, const uint8_t* data, size_t data_len, const MoqObjectInfo* info) {
+    ReceivedExtensions* received = (ReceivedExtensions*)user_data;
+    (void)data;
+    (void)data_len;
+    received->count = info->extension_count;
+    if (info->extension_count > 0 && info->extensions[0].data_len < sizeof(received->first_data)) {
+        received->first_key = info->extensions[0].key;
+        memcpy(received->first_data, info->extensions[0].data, info->extensions[0].data_len);
+    }
+}
+
+void test_simulated_extensions(void) {
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+    if (!connect_simulated(client)) {
+        moq_client_destroy(client);
+        return;
+    }
+
+    /* Extensions travel in-band, which both ends have to opt in to */
+    MoqResult result = moq_client_set_inband_headers(client, true);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_client_set_inband_headers() should succeed");
+
+    ReceivedExtensions received;
+    memset(&received, 0, sizeof(received));
+    MoqSubscriber* sub = moq_subscribe(client, "meta", "video", NULL, NULL);
+    TEST_ASSERT_NOT_NULL(sub, "moq_subscribe() should succeed");
+    result = moq_subscriber_set_object_callback(sub, on_extensions, &received);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_subscriber_set_object_callback() should succeed");
+    result = moq_announce_namespace(client, "meta");
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_announce_namespace() should succeed");
+    MoqPublisher* pub = moq_create_publisher(client, "meta", "video");
+    TEST_ASSERT_NOT_NULL(pub, "moq_create_publisher() should succeed");
+
+    const char scene[] = "scene-7";
+    MoqExtension extensions[2] = {
+        { 0x0b, 0, (const uint8_t*)scene, sizeof(scene) - 1 },
+        { 0x3c, 300, NULL, 0 },
+    };
+    const uint8_t frame[4] = { 1, 2, 3, 4 };
+    result = moq_publish_data_ex(pub, frame, sizeof(frame), extensions, 2);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_publish_data_ex() should succeed");
+    result = moq_publish_data_ex(pub, frame, sizeof(frame), NULL, 1);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT, "moq_publish_data_ex() should reject NULL extensions");
+    moq_free_str(result.message);
+    result = moq_sim_advance(SIM_URL, 1000);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_sim_advance() should succeed");
+
+    TEST_ASSERT_EQ((int)received.count, 2, "Both extensions should arrive with the object");
+    TEST_ASSERT_EQ((int)received.first_key, 0x0b, "Extensions should arrive in the order sent");
+    TEST_ASSERT_EQ(strcmp(received.first_data, scene), 0, "Extension bytes should arrive unchanged");
+
+    moq_subscriber_destroy(sub);
+    moq_publisher_destroy(pub);
+    moq_disconnect(client);
+    moq_client_destroy(client);
+}
+
+/* Publishes one object over a 30 ms uplink and disconnects while it is in flight */
+static MoqResult publish_and_leave(bool graceful) {
+    MoqClient* client = moq_client_create();
+    MoqSimLink uplink = { 30000, 0, 0, 0.0 };
+    MoqResult result = moq_connect(client, SIM_URL, NULL, NULL);
+    moq_free_str(result.message);
+    moq_sim_set_link(client, &uplink, NULL);
+    result = moq_announce_namespace(client, "maintenance");
+    moq_free_str(result.message);
+    MoqPublisher* pub = moq_create_publisher(client, "maintenance", "feed");
+    const char* payload = graceful ? "flushed" : "dropped";
+    result = moq_publish_data(pub, (const uint8_t*)payload, strlen(payload), MOQ_DELIVERY_STREAM);
+    moq_free_str(result.message);
+
+    result = graceful ? moq_disconnect_graceful(client, 100) : moq_disconnect(client);
+    moq_publisher_destroy(pub);
+    moq_client_destroy(client);
+    return result;
+}
+
+void test_simulated_graceful_disconnect(void) {
+    MoqClient* viewer = moq_client_create();
+    TEST_ASSERT_NOT_NULL(viewer, "Client should be created");
+    if (!connect_simulated(viewer)) {
+        moq_client_destroy(viewer);
+        return;
+    }
+    Arrivals arrivals = { 0, 0, "" };
+    MoqSubscriber* sub = moq_subscribe(viewer, "maintenance", "feed", on_data, &arrivals);
+    TEST_ASSERT_NOT_NULL(sub, "moq_subscribe() should succeed");
+
+    MoqResult result = publish_and_leave(false);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_disconnect() should succeed");
+    moq_free_str(result.message);
+    moq_sim_advance(SIM_URL, 100000);
+    TEST_ASSERT_EQ(arrivals.count, 0, "An abrupt disconnect loses the object in flight");
+
+    result = publish_and_leave(true);
+    TEST_ASSERT_EQ(result.code, MOQ_OK, "moq_disconnect_graceful() should flush within the deadline");
+    moq_free_str(result.message);
+    moq_sim_advance(SIM_URL, 100000);
+    TEST_ASSERT_EQ(arrivals.count, 1, "A graceful disconnect delivers the object in flight");
+    TEST_ASSERT_STR_EQ(arrivals.last, "flushed", "The flushed object should arrive intact");
+
+    result = moq_disconnect_graceful(NULL, 100);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT, "moq_disconnect_graceful(NULL) should fail");
+    moq_free_str(result.message);
+
+    moq_subscriber_destroy(sub);
+    moq_disconnect(viewer);
+    moq_client_destroy(viewer);
+}
+
+void test_sim_advance_unknown_relay(void) {
+    MoqResult result = moq_sim_advance("sim://nobody-connected", 1000);
+    TEST_ASSERT_NEQ(result.code, MOQ_OK, "moq_sim_advance() should fail without connected clients");
+    moq_free_str(result.message);
+
+    TEST_ASSERT_EQ((int)moq_sim_now(NULL), 0, "moq_sim_now(NULL) should return 0");
+}
+
+int main(void) {
+    TEST_INIT();
+
+    printf("Running simulated network tests...\n\n");
+
+    test_simulated_pubsub();
+    test_simulated_latency_probe();
+    test_simulated_capture_latency();
+    test_simulated_extensions();
+    test_simulated_graceful_disconnect();
+    test_sim_advance_unknown_relay();
+
+    TEST_EXIT();
+    return 0;
+}
@@ -102,6 +102,128 @@ void test_unsubscribe_null_subscriber(void) {
     TEST_ASSERT(true, "moq_unsubscribe(NULL) should not crash");
 }
 
+void test_subscriber_set_callback_null_subscriber(void) {
+    moq_init();
+
+    DataCallbackData cb_data = {0};
+    MoqResult result = moq_subscriber_set_callback(NULL, data_callback, &cb_data);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_subscriber_set_callback(NULL) should return INVALID_ARGUMENT");
+    if (result.message) {
+        moq_free_str(result.message);
+    }
+}
+
+static void batch_callback(void* user_data, const MoqObject* objects, size_t count) {
+    DataCallbackData* data = (DataCallbackData*)user_data;
+    (void)objects;
+    data->callback_count += (int)count;
+}
+
+void test_subscribe_batched_without_connection(void) {
+    moq_init();
+
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+
+    DataCallbackData cb_data = {0};
+    TEST_ASSERT_NULL(moq_subscribe_batched(NULL, "ns", "track", batch_callback, &cb_data, 0, 0),
+                     "moq_subscribe_batched(NULL client) should return NULL");
+    TEST_ASSERT_NULL(moq_subscribe_batched(client, "ns", "track", batch_callback, &cb_data, 16, 1000),
+                     "moq_subscribe_batched() should fail without connection");
+    TEST_ASSERT_EQ(cb_data.callback_count, 0, "No callbacks expected without connection");
+
+    MoqResult result = moq_subscriber_set_batch_callback(NULL, batch_callback, &cb_data, 0, 0);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_subscriber_set_batch_callback(NULL) should return INVALID_ARGUMENT");
+    if (result.message) {
+        moq_free_str(result.message);
+    }
+
+    moq_client_destroy(client);
+}
+
+void test_recorder_create_without_connection(void) {
+    moq_init();
+
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+
+    TEST_ASSERT_NULL(moq_recorder_create(NULL, "ns", "track", "recording"),
+                     "moq_recorder_create(NULL client) should return NULL");
+    TEST_ASSERT_NULL(moq_recorder_create(client, "ns", "track", NULL),
+                     "moq_recorder_create(NULL path) should return NULL");
+    TEST_ASSERT_NULL(moq_recorder_create(client, "ns", "track", "recording"),
+                     "moq_recorder_create() should fail without connection");
+
+    TEST_ASSERT_NULL(moq_replayer_create(NULL, "ns", "recording", 1.0),
+                     "moq_replayer_create(NULL client) should return NULL");
+    TEST_ASSERT_NULL(moq_replayer_create(client, "ns", "recording", 1.0),
+                     "moq_replayer_create() should fail without a recording or connection");
+    TEST_ASSERT(moq_replayer_is_finished(NULL), "NULL replayer should report finished");
+
+    /* Destroying NULL must be safe */
+    moq_recorder_destroy(NULL);
+    moq_replayer_destroy(NULL);
+
+    moq_client_destroy(client);
+}
+
+static uint8_t* alloc_hook(void* user_data, size_t size) {
+    (void)user_data;
+    (void)size;
+    return NULL;
+}
+
+static void commit_hook(void* user_data, uint8_t* buffer, size_t len,
+                        uint64_t group_id, uint64_t object_id) {
+    (void)user_data;
+    (void)buffer;
+    (void)len;
+    (void)group_id;
+    (void)object_id;
+}
+
+void test_subscriber_set_allocator_null_subscriber(void) {
+    moq_init();
+
+    MoqResult result = moq_subscriber_set_allocator(NULL, alloc_hook, commit_hook, NULL);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_subscriber_set_allocator(NULL) should return INVALID_ARGUMENT");
+    if (result.message) {
+        moq_free_str(result.message);
+    }
+}
+
+static void collect_range(void* user_data, const MoqObject* objects, size_t count) {
+    (void)user_data;
+    (void)objects;
+    (void)count;
+}
+
+void test_subscriber_cache_null_subscriber(void) {
+    moq_init();
+
+    MoqResult result = moq_subscriber_enable_cache(NULL, 0, 10000, 1 << 20, NULL, 0);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_subscriber_enable_cache(NULL) should return INVALID_ARGUMENT");
+    if (result.message) {
+        moq_free_str(result.message);
+    }
+
+    result = moq_subscriber_read_range(NULL, 0, 10, collect_range, NULL);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_subscriber_read_range(NULL) should return INVALID_ARGUMENT");
+    if (result.message) {
+        moq_free_str(result.message);
+    }
+
+    uint64_t first_group = 0;
+    uint64_t last_group = 0;
+    TEST_ASSERT(!moq_subscriber_cached_groups(NULL, &first_group, &last_group),
+                "moq_subscriber_cached_groups(NULL) should return false");
+}
+
 void test_unsubscribe_without_subscribe(void) {
     moq_init();
 
@@ -253,6 +375,58 @@ void test_resubscribe_after_unsubscribe(void) {
     moq_client_destroy(client);
 }
 
+void test_subscribe_many_null_arguments(void) {
+    moq_init();
+
+    const char* names[] = {"track-a", "track-b"};
+    MoqSubscriber* subs[2];
+
+    MoqResult result = moq_subscribe_many(
+        NULL, "namespace", names, 2, data_callback, NULL, subs);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_subscribe_many(NULL client) should return INVALID_ARGUMENT");
+    moq_free_str(result.message);
+
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+
+    result = moq_subscribe_many(
+        client, NULL, names, 2, data_callback, NULL, subs);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_subscribe_many() with NULL namespace should return INVALID_ARGUMENT");
+    moq_free_str(result.message);
+
+    result = moq_subscribe_many(
+        client, "namespace", names, 2, data_callback, NULL, NULL);
+    TEST_ASSERT_EQ(result.code, MOQ_ERROR_INVALID_ARGUMENT,
+                   "moq_subscribe_many() with NULL output array should return INVALID_ARGUMENT");
+    moq_free_str(result.message);
+
+    moq_client_destroy(client);
+}
+
+void test_subscribe_many_not_connected(void) {
+    moq_init();
+
+    MoqClient* client = moq_client_create();
+    TEST_ASSERT_NOT_NULL(client, "Client should be created");
+
+    DataCallbackData cb_data[2] = {{0}, {0}};
+    void* user_data[] = {&cb_data[0], &cb_data[1]};
+    const char* names[] = {"track-a", "track-b"};
+    MoqSubscriber* subs[2] = {0};
+
+    MoqResult result = moq_subscribe_many(
+        client, "namespace", names, 2, data_callback, user_data, subs);
+    TEST_ASSERT_NEQ(result.code, MOQ_OK,
+                    "Should fail to subscribe to many tracks without connection");
+    TEST_ASSERT(subs[0] == NULL && subs[1] == NULL,
+                "All subscriber outputs should be NULL on failure");
+    moq_free_str(result.message);
+
+    moq_client_destroy(client);
+}
+
 int main(void) {
     TEST_INIT();
 
@@ -263,8 +437,15 @@ int main(void) {
     test_subscribe_null_track();
     test_subscribe_null_callback();
     test_subscribe_without_connection();
+    test_subscribe_many_null_arguments();
+    test_subscribe_many_not_connected();
 
     test_unsubscribe_null_subscriber();
+    test_subscriber_set_callback_null_subscriber();
+    test_subscribe_batched_without_connection();
+    test_subscriber_set_allocator_null_subscriber();
+    test_subscriber_cache_null_subscriber();
+    test_recorder_create_without_connection();
     test_unsubscribe_without_subscribe();
 
     test_subscriber_lifecycle();
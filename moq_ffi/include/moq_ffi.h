@@ -49,6 +49,16 @@ typedef struct MoqPublisher MoqPublisher;
  */
 typedef struct MoqSubscriber MoqSubscriber;
 
+/**
+ * Opaque handle to a track recorder
+ */
+typedef struct MoqRecorder MoqRecorder;
+
+/**
+ * Opaque handle to a recording replayer
+ */
+typedef struct MoqReplayer MoqReplayer;
+
 /**
  * Result code for MoQ operations
  */
@@ -61,6 +71,8 @@ typedef enum {
     MOQ_ERROR_INTERNAL = 5,
     MOQ_ERROR_UNSUPPORTED = 6,
     MOQ_ERROR_BUFFER_TOO_SMALL = 7,
+    MOQ_ERROR_WOULD_BLOCK = 8,
+    MOQ_ERROR_UNCONFIRMED = 9,  // Best effort: sent, but delivery could not be confirmed
 } MoqResultCode;
 
 /**
@@ -79,6 +91,7 @@ typedef enum {
     MOQ_STATE_CONNECTING = 1,
     MOQ_STATE_CONNECTED = 2,
     MOQ_STATE_FAILED = 3,
+    MOQ_STATE_RESUMING = 4,  // Relay ended the session: subscriptions ended, reconnecting (opt-in)
 } MoqConnectionState;
 
 /**
@@ -97,6 +110,9 @@ typedef enum {
  * Connection state change callback
  * @param user_data User-provided context pointer
  * @param state New connection state
+ * 
+ * @note Invoked without internal client locks held; the callback may call
+ *       back into the library (e.g. moq_is_connected) on the same client.
  */
 typedef void (*MoqConnectionCallback)(void* user_data, MoqConnectionState state);
 
@@ -105,9 +121,72 @@ typedef void (*MoqConnectionCallback)(void* user_data, MoqConnectionState state)
  * @param user_data User-provided context pointer
  * @param data Pointer to received data buffer
  * @param data_len Length of received data
+ * 
+ * @note Invoked on a library worker thread without internal locks held.
+ *       Unsubscribing or destroying the subscriber does not wait for a
+ *       running invocation to return.
  */
 typedef void (*MoqDataCallback)(void* user_data, const uint8_t* data, size_t data_len);
 
+/**
+ * A received object, as passed to a batch callback
+ * 
+ * The data pointer is only valid during the callback invocation.
+ */
+typedef struct MoqObject {
+    const uint8_t* data;      // Object payload
+    size_t data_len;          // Payload length in bytes
+    uint64_t group_id;        // Group the object belongs to
+    uint64_t object_id;       // Object ID within the group
+} MoqObject;
+
+/**
+ * Writable publish buffer obtained from moq_publish_acquire()
+ * 
+ * The memory belongs to the library; write at most capacity bytes at data and
+ * pass the slot to moq_publish_commit() or moq_publish_release().
+ */
+typedef struct MoqWriteSlot {
+    uint8_t* data;            // Writable memory, NULL if the acquire failed
+    size_t capacity;          // Number of bytes that may be written at data
+    void* reserved;           // Library-owned state, do not modify
+} MoqWriteSlot;
+
+/**
+ * Batched data callback
+ * @param user_data User-provided context pointer
+ * @param objects Array of received objects, in arrival order
+ * @param count Number of objects in the array (at least 1)
+ * 
+ * @note Invoked on a library worker thread without internal locks held.
+ */
+typedef void (*MoqBatchCallback)(void* user_data, const MoqObject* objects, size_t count);
+
+/**
+ * Receive buffer allocation hook
+ * @param user_data User-provided context pointer
+ * @param size Size of the incoming object in bytes
+ * @return Buffer writable for size bytes, or NULL to drop the object
+ */
+typedef uint8_t* (*MoqAllocFn)(void* user_data, size_t size);
+
+/**
+ * Receive buffer commit hook
+ * 
+ * Called exactly once for every buffer returned by MoqAllocFn, after the
+ * object has been written into it. Ownership of the buffer returns to the
+ * application.
+ * 
+ * @param user_data User-provided context pointer
+ * @param buffer Buffer previously returned by the allocation hook
+ * @param len Number of bytes written; less than the requested size if the
+ *            object was cut short (e.g. the subscriber was unsubscribed)
+ * @param group_id Group the object belongs to
+ * @param object_id Object ID within the group
+ */
+typedef void (*MoqCommitFn)(void* user_data, uint8_t* buffer, size_t len,
+                            uint64_t group_id, uint64_t object_id);
+
 /**
  * Track announcement callback
  * @param user_data User-provided context pointer
@@ -116,6 +195,99 @@ typedef void (*MoqDataCallback)(void* user_data, const uint8_t* data, size_t dat
  */
 typedef void (*MoqTrackCallback)(void* user_data, const char* namespace_str, const char* track_name);
 
+/**
+ * Completion of an asynchronous operation
+ * @param user_data User-provided context pointer
+ * @param result Outcome of the operation; the callee owns result.message
+ *               and must free it with moq_free_str()
+ * 
+ * @note Invoked exactly once, on a library worker thread (stub backend: on the
+ *       calling thread, before the starting function returns).
+ */
+typedef void (*MoqCompletionCallback)(void* user_data, MoqResult result);
+
+/**
+ * One-shot readiness notification for moq_subscriber_next()
+ * @param user_data User-provided context pointer
+ * 
+ * @note Invoked without internal locks held; it should only schedule the
+ *       consumer, which then calls moq_subscriber_next() again.
+ */
+typedef void (*MoqReadyCallback)(void* user_data);
+
+/**
+ * Latency of one probe that came back through the relay
+ * @param user_data User-provided context pointer
+ * @param latency_us Time from publishing the probe to receiving it, in microseconds
+ * @param sequence Sequence number of the probe, counting from 0
+ * 
+ * @note Invoked on a library worker thread (stub backend: on the thread
+ *       calling moq_sim_advance()).
+ */
+typedef void (*MoqLatencyCallback)(void* user_data, uint64_t latency_us, uint64_t sequence);
+
+/**
+ * An object taken from a queued subscriber with moq_subscriber_next()
+ * 
+ * Owns its payload until passed to moq_object_release().
+ */
+typedef struct MoqReceivedObject {
+    const uint8_t* data;      // Object payload
+    size_t data_len;          // Payload length in bytes
+    uint64_t group_id;        // Group the object belongs to
+    uint64_t object_id;       // Object ID within the group
+    void* reserved;           // Library-owned state, do not modify
+} MoqReceivedObject;
+
+/**
+ * Extension header of an object
+ * 
+ * A key/value pair carried with the object, outside its payload (draft-14
+ * object extension headers). Even keys carry a number in value; odd keys
+ * carry data_len bytes at data. Key 2 is the capture timestamp.
+ */
+typedef struct MoqExtension {
+    uint64_t key;             // Extension type, below 2^62
+    uint64_t value;           // Value of an even key, below 2^62
+    const uint8_t* data;      // Value of an odd key
+    size_t data_len;          // Length of data in bytes
+} MoqExtension;
+
+/**
+ * Timing and extension headers of a received object
+ * 
+ * All times are in microseconds. The capture time is stamped by the
+ * publisher on its own clock (see moq_publish_data_timestamped()); arrival
+ * is read on the subscriber's clock when the object is complete. The latency
+ * is valid once the offset between the two clocks has been estimated.
+ * 
+ * The extensions point into the received object, not copies of it: they are
+ * valid during an object callback, or until a queued object is released.
+ */
+typedef struct MoqObjectInfo {
+    uint64_t group_id;         // Group the object belongs to
+    uint64_t object_id;        // Object ID within the group
+    uint64_t capture_time_us;  // Capture time since the Unix epoch, 0 if not stamped
+    uint64_t arrival_time_us;  // Arrival time since the Unix epoch
+    int64_t clock_offset_us;   // Publisher clock minus subscriber clock
+    uint64_t latency_us;       // One-way latency from capture to arrival
+    bool latency_valid;        // Stamped and the clock offset is known
+    const MoqExtension* extensions; // Extension headers in the order sent, NULL if none
+    size_t extension_count;    // Number of extension headers
+} MoqObjectInfo;
+
+/**
+ * Data received callback with object timing
+ * @param user_data User-provided context pointer
+ * @param data Pointer to received data buffer
+ * @param data_len Length of received data
+ * @param info Timing and extensions of the object, valid during the invocation
+ * 
+ * @note Invoked on a library worker thread without internal locks held.
+ */
+typedef void (*MoqObjectCallback)(void* user_data, const uint8_t* data, size_t data_len,
+                                  const MoqObjectInfo* info);
+
 /* ───────────────────────────────────────────────
  * Track Discovery (Catalog-Based)
  * ─────────────────────────────────────────────── */
@@ -183,6 +355,74 @@ typedef void (*MoqCatalogCallback)(void* user_data, const MoqTrackInfo* tracks,
  */
 MOQ_API bool moq_init(void);
 
+/**
+ * Shut the library down so that it can be unloaded or started again
+ * 
+ * Closes the session of every client not yet destroyed, stops the library's
+ * runtime and waits for its worker threads to exit, releasing their sockets
+ * and memory. Call it before unloading a hot-reloaded module. Client handles
+ * stay valid but disconnected and must still be destroyed; destroy
+ * subscribers and publishers first, as usual. Afterwards moq_init() and
+ * the rest of the API work again, on a fresh runtime.
+ * 
+ * @param timeout_ms How long to wait for the runtime's threads to exit, in
+ *                   milliseconds; 0 does not wait
+ * @return MOQ_OK once every runtime thread has exited,
+ *         MOQ_ERROR_TIMEOUT if some had not exited by the timeout (they exit
+ *         when their blocking work returns); with a timeout of 0 this is the
+ *         usual result,
+ *         MOQ_ERROR_INVALID_ARGUMENT if called from a library callback or
+ *         another thread of the library's runtime
+ * 
+ * @note Not thread-safe: no other library call may run concurrently
+ * @note Threads of the application's own async runtimes may call it
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_shutdown(uint64_t timeout_ms);
+
+/**
+ * Do the work of a first connect ahead of time
+ * 
+ * The first moq_connect() otherwise pays for starting the library's runtime,
+ * installing the crypto provider, reading the platform's root certificates
+ * and resolving the relay's host. This does all of that now, resolving the
+ * host of each URL so the system resolver caches it where the platform has
+ * a cache. URLs are warmed concurrently and the call returns once all are
+ * done; call it from a loading thread during startup.
+ * 
+ * @param urls Relay URLs to warm; may be NULL if url_count is 0
+ * @param url_count Number of URLs
+ * @return MOQ_OK once everything was warmed,
+ *         MOQ_ERROR_INVALID_ARGUMENT if urls or a URL is NULL or invalid,
+ *         MOQ_ERROR_CONNECTION_FAILED if a host could not be resolved (the
+ *         other URLs are still warmed)
+ * 
+ * @note Thread-safe; must not be called from a library callback
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_prewarm(const char* const* urls, size_t url_count);
+
+/**
+ * Do the work of a first connect ahead of time, optionally opening the sessions too
+ * 
+ * Like moq_prewarm(). With preconnect, also opens an idle session to each
+ * URL. The first moq_connect() to that URL takes the session over instead of
+ * dialing, skipping the QUIC, TLS and MoQ handshakes, provided the session is
+ * still open and the client uses the default UDP offload settings. Idle
+ * sessions send a keep-alive every 10 seconds; those never taken are closed
+ * by moq_shutdown().
+ * 
+ * @param urls Relay URLs to warm; may be NULL if url_count is 0
+ * @param url_count Number of URLs
+ * @param preconnect Whether to open an idle session to each URL
+ * @return As moq_prewarm(), and MOQ_ERROR_CONNECTION_FAILED if a session
+ *         could not be opened
+ * 
+ * @note Thread-safe; must not be called from a library callback
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_prewarm_ex(const char* const* urls, size_t url_count, bool preconnect);
+
 /* ───────────────────────────────────────────────
  * Client Management
  * ─────────────────────────────────────────────── */
@@ -204,6 +444,7 @@ MOQ_API void moq_client_destroy(MoqClient* client);
  * 
  * Supported URL schemes:
  * - https:// - WebTransport over QUIC (Draft 07 and Draft 14)
+ * - sim:// - In-memory simulated relay (stub backend only, see moq_sim_advance())
  * 
  * Future enhancements (Draft 14):
  * - quic:// - Raw QUIC connection (planned)
@@ -224,6 +465,31 @@ MOQ_API MoqResult moq_connect(
     void* user_data
 );
 
+/**
+ * Connect to a MoQ relay server without blocking the caller
+ * 
+ * Performs the same handshake as moq_connect() on a library worker thread and
+ * reports its outcome to completion_callback. Arguments are validated before
+ * this returns; if it returns an error, completion_callback is not invoked.
+ * 
+ * @param client Client handle
+ * @param url Connection URL, as for moq_connect()
+ * @param connection_callback Optional callback for connection state changes
+ * @param user_data User context pointer passed to both callbacks
+ * @param completion_callback Optional callback receiving the connect result
+ * @return MOQ_OK if the attempt was started, or the validation error
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_connect_async(
+    MoqClient* client,
+    const char* url,
+    MoqConnectionCallback connection_callback,
+    void* user_data,
+    MoqCompletionCallback completion_callback
+);
+
 /**
  * Disconnect from the MoQ relay
  * @param client Client handle
@@ -231,6 +497,37 @@ MOQ_API MoqResult moq_connect(
  */
 MOQ_API MoqResult moq_disconnect(MoqClient* client);
 
+/**
+ * Disconnect from the MoQ relay after sending what is still queued
+ * 
+ * moq_disconnect() drops the connection at once, losing objects that are
+ * still buffered or in flight. This stops taking new work, waits until the
+ * objects already published have been sent and presumably acknowledged,
+ * then closes the connection cleanly and disconnects. The network backend
+ * cannot confirm delivery, as the transport does not expose the streams it
+ * sends on: it waits until the connection has gone quiet for a few probe
+ * timeouts and then returns MOQ_ERROR_UNCONFIRMED. The stub backend lets
+ * objects on the simulated uplink arrive as the relay's virtual clock
+ * advances, for up to deadline_ms of it, and returns MOQ_OK once they all
+ * did.
+ * 
+ * If the relay ends a session on its own, the client reports
+ * MOQ_STATE_FAILED, or MOQ_STATE_DISCONNECTED if the session closed without
+ * an error; see moq_client_set_auto_resume() to reconnect instead.
+ * 
+ * @param client Client handle
+ * @param deadline_ms Longest time to wait for queued data to be sent
+ * @return MOQ_OK if delivery was confirmed, or if not connected,
+ *         MOQ_ERROR_UNCONFIRMED once everything queued was sent but its
+ *         delivery could not be confirmed,
+ *         MOQ_ERROR_TIMEOUT if the deadline passed first; the client is
+ *         disconnected in every case
+ * 
+ * @note Thread-safe; blocks for up to deadline_ms, so do not call it from a callback
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_disconnect_graceful(MoqClient* client, uint64_t deadline_ms);
+
 /**
  * Check if client is currently connected
  * @param client Client handle
@@ -238,6 +535,189 @@ MOQ_API MoqResult moq_disconnect(MoqClient* client);
  */
 MOQ_API bool moq_is_connected(const MoqClient* client);
 
+/**
+ * Select the UDP offloads of the client's next connection
+ *
+ * With GSO (generic segmentation offload) one send call carries a run of
+ * datagrams that the kernel or NIC splits; with GRO (generic receive offload)
+ * one receive call returns a run of datagrams the kernel coalesced. Both are
+ * on by default where the platform supports them. Turning them off can rule
+ * them out when a network path misbehaves.
+ *
+ * The setting takes effect on the next moq_connect(); an established
+ * connection is unchanged. Ignored by the stub backend.
+ *
+ * @param client Client handle
+ * @param gso Allow segmentation offload on send
+ * @param gro Allow receive offload
+ * @return MOQ_OK, or MOQ_ERROR_INVALID_ARGUMENT if client is NULL
+ *
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_client_set_udp_offload(MoqClient* client, bool gso, bool gro);
+
+/**
+ * Opt a client in to the library's in-band object header
+ * 
+ * The transport libraries do not expose draft-14 extension headers, and
+ * draft-07 has none, so moq_publish_data_ex(), moq_publish_data_timestamped()
+ * and moq_publisher_set_timestamps() carry extensions and capture times in a
+ * header block at the start of the object's payload instead. Only
+ * subscribers of this library that opted in strip the block again; other
+ * subscribers, including other MoQ implementations, receive it as part of
+ * the payload. Every client on a track therefore has to agree.
+ * 
+ * Off by default: publishers refuse extensions and timestamps with
+ * MOQ_ERROR_UNSUPPORTED, and subscribers deliver every payload exactly as
+ * received, even one that starts like a header block. The setting applies
+ * to publishers, subscriptions and recorders created afterwards.
+ * 
+ * @param client Client handle
+ * @param enabled Whether to write and strip the in-band header
+ * @return MOQ_OK, or MOQ_ERROR_INVALID_ARGUMENT if client is NULL
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_client_set_inband_headers(MoqClient* client, bool enabled);
+
+/**
+ * Opt a client in to resuming sessions the relay ends
+ * 
+ * The transport libraries do not surface GOAWAY, so a session the relay ends
+ * before maintenance looks the same as one it ends after rejecting the
+ * client, on a protocol error, or because it went away for good. With
+ * auto-resume the client reports MOQ_STATE_RESUMING, reconnects to the same
+ * URL in the background and announces its namespaces again; existing
+ * publishers keep working. Every subscription ends with the old session:
+ * moq_is_subscribed() returns false for each, and they should be taken out
+ * again on MOQ_STATE_CONNECTED. If reconnecting fails the client reports
+ * MOQ_STATE_FAILED.
+ * 
+ * Off by default: a session the relay ends is reported as MOQ_STATE_FAILED,
+ * or MOQ_STATE_DISCONNECTED if it closed without an error, and the client
+ * stays disconnected. Simulated relays never end sessions themselves.
+ * 
+ * @param client Client handle
+ * @param enabled Whether to reconnect when the relay ends the session
+ * @return MOQ_OK, or MOQ_ERROR_INVALID_ARGUMENT if client is NULL
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_client_set_auto_resume(MoqClient* client, bool enabled);
+
+/**
+ * Counters of a client's QUIC connection and its UDP socket
+ */
+typedef struct MoqTransportStats {
+    uint64_t rtt_us;             // Smoothed round-trip time in microseconds
+    uint64_t congestion_window;  // Congestion window in bytes
+    uint64_t lost_packets;       // Packets declared lost
+    uint64_t udp_tx_datagrams;   // UDP datagrams sent
+    uint64_t udp_tx_bytes;       // Bytes sent in UDP datagrams
+    uint64_t udp_tx_syscalls;    // Send calls; fewer than datagrams with GSO
+    uint64_t udp_rx_datagrams;   // UDP datagrams received
+    uint64_t udp_rx_bytes;       // Bytes received in UDP datagrams
+    uint64_t udp_rx_syscalls;    // Receive calls; fewer than datagrams with GRO or batching
+    uint32_t gso_segments;       // Datagrams per send; greater than 1 while GSO is active
+    uint32_t gro_segments;       // Datagrams per receive; greater than 1 while GRO is active
+} MoqTransportStats;
+
+/**
+ * Get the counters of the client's current connection
+ *
+ * udp_tx_datagrams / udp_tx_syscalls is the number of packets per send call,
+ * which shows whether segmentation offload is paying off. The stub backend
+ * reports the round-trip time of its simulated links and no UDP counters.
+ *
+ * @param client Client handle
+ * @param stats Receives the statistics
+ * @return MOQ_OK on success, MOQ_ERROR_NOT_CONNECTED if the client is not
+ *         connected, MOQ_ERROR_INVALID_ARGUMENT if an argument is NULL
+ *
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_client_get_transport_stats(const MoqClient* client, MoqTransportStats* stats);
+
+/* ───────────────────────────────────────────────
+ * Latency Probe
+ * ─────────────────────────────────────────────── */
+
+/**
+ * Latency of objects through the relay, as measured by the latency probe
+ */
+typedef struct MoqLatencyStats {
+    uint64_t probes_sent;      // Probes published
+    uint64_t probes_received;  // Probes received back through the relay
+    uint64_t last_us;          // Latency of the most recent probe in microseconds
+    uint64_t min_us;           // Lowest latency seen in microseconds
+    uint64_t max_us;           // Highest latency seen in microseconds
+    uint64_t smoothed_us;      // Moving average in microseconds (gain 1/8)
+} MoqLatencyStats;
+
+/**
+ * Start measuring publish-to-subscribe latency through the relay
+ * 
+ * Every interval_ms the client publishes a 16-byte object carrying a sequence
+ * number and a timestamp on a reserved track of its own (namespace
+ * "moq-ffi/latency-probe/<random id>", track "echo") and subscribes to that
+ * track through the relay. Each probe that comes back is one latency sample:
+ * the network round trip plus the relay's queuing and forwarding, which the
+ * QUIC round-trip time in MoqTransportStats does not include.
+ * 
+ * Starting a probe replaces a running one and resets the statistics. The
+ * probe stops on moq_disconnect(). The stub backend publishes probes on the
+ * simulated relay's virtual clock and reports virtual latencies.
+ * 
+ * @param client Client handle (must be connected)
+ * @param interval_ms Time between probes in milliseconds (must not be 0)
+ * @param callback Optional callback invoked with every sample (may be NULL)
+ * @param user_data User context passed to callback
+ * @return MOQ_OK once the probe is running, MOQ_ERROR_NOT_CONNECTED if the
+ *         client is not connected, MOQ_ERROR_INVALID_ARGUMENT if client is
+ *         NULL or interval_ms is 0
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_client_start_latency_probe(
+    MoqClient* client,
+    uint32_t interval_ms,
+    MoqLatencyCallback callback,
+    void* user_data
+);
+
+/**
+ * Stop the latency probe
+ * 
+ * The statistics stay readable until the next probe starts. Stopping a
+ * client without a running probe is a no-op.
+ * 
+ * @param client Client handle
+ * @return MOQ_OK, or MOQ_ERROR_INVALID_ARGUMENT if client is NULL
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_client_stop_latency_probe(MoqClient* client);
+
+/**
+ * Get the figures of the running or most recent latency probe
+ * 
+ * Every field is zero if no probe has been started.
+ * 
+ * @param client Client handle
+ * @param stats Receives the statistics
+ * @return MOQ_OK, or MOQ_ERROR_INVALID_ARGUMENT if an argument is NULL
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_client_get_latency_stats(const MoqClient* client, MoqLatencyStats* stats);
+
 /* ───────────────────────────────────────────────
  * Publishing
  * ─────────────────────────────────────────────── */
@@ -279,6 +759,39 @@ MOQ_API MoqPublisher* moq_create_publisher_ex(
     MoqDeliveryMode delivery_mode
 );
 
+/**
+ * Create publishers for many tracks of one namespace in a single call
+ *
+ * Resolves the announced namespace once and creates every track while
+ * holding the namespace's shard lock once; other namespaces are not
+ * blocked meanwhile. Use this instead of calling moq_create_publisher_ex()
+ * in a loop when setting up thousands of tracks.
+ *
+ * The operation is all-or-nothing: on failure no publishers are created and
+ * every entry of publishers_out is set to NULL.
+ *
+ * @param client Client handle (must be connected)
+ * @param namespace_str Namespace of the tracks (must be previously announced)
+ * @param track_names Array of track_count track names
+ * @param track_count Number of tracks to create
+ * @param delivery_mode Delivery mode used for every publisher
+ * @param publishers_out Caller-provided array of track_count entries that
+ *                       receives the publisher handles (destroy each with
+ *                       moq_publisher_destroy())
+ * @return MOQ_OK on success, error code on failure
+ *
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_create_publishers(
+    MoqClient* client,
+    const char* namespace_str,
+    const char* const* track_names,
+    size_t track_count,
+    MoqDeliveryMode delivery_mode,
+    MoqPublisher** publishers_out
+);
+
 /**
  * Destroy a publisher
  * @param publisher Publisher handle
@@ -300,59 +813,457 @@ MOQ_API MoqResult moq_publish_data(
     MoqDeliveryMode delivery_mode
 );
 
-/* ───────────────────────────────────────────────
- * Subscribing
- * ─────────────────────────────────────────────── */
-
 /**
- * Subscribe to a track
- * @param client Client handle
- * @param namespace_str Namespace of the track
- * @param track_name Name of the track
- * @param data_callback Callback for received data
- * @param user_data User context pointer passed to callbacks
- * @return Handle to the subscriber or NULL on failure
+ * Publish data stamped with the time it was captured
+ * 
+ * The capture time travels in the in-band header block at the start of the
+ * payload (see moq_client_set_inband_headers()), not as a draft-14
+ * extension header, so the publishing client has to opt in. Subscribers
+ * that opted in as well get the payload without the block and the one-way
+ * latency from capture to arrival in MoqObjectInfo; every other subscriber,
+ * including other MoQ implementations and draft-07 tools, receives the
+ * block as part of the payload. To estimate the offset between the two
+ * hosts' clocks, subscribers exchange timestamps with the publisher
+ * NTP-style over short lived clock tracks of the namespace, which the
+ * library answers.
+ * 
+ * @param publisher Publisher handle
+ * @param data Data buffer to publish
+ * @param data_len Length of data
+ * @param capture_time_us Capture time in microseconds since the Unix epoch,
+ *                        or 0 for the current time
+ *                        (stub backend: on the simulated relay's clock)
+ * @return Result of the publish operation; MOQ_ERROR_UNSUPPORTED if the
+ *         client had not opted in to in-band headers when the publisher
+ *         was created
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
  */
-MOQ_API MoqSubscriber* moq_subscribe(
-    MoqClient* client,
-    const char* namespace_str,
-    const char* track_name,
-    MoqDataCallback data_callback,
-    void* user_data
+MOQ_API MoqResult moq_publish_data_timestamped(
+    MoqPublisher* publisher,
+    const uint8_t* data,
+    size_t data_len,
+    uint64_t capture_time_us
 );
 
 /**
- * Unsubscribe and destroy a subscriber
- * @param subscriber Subscriber handle
+ * Publish data with extension headers
+ * 
+ * A capture timestamp (key 2) given here counts as the object's capture
+ * time, also for a publisher that stamps every object.
+ * 
+ * These are not draft-14 extension headers on the wire: the transport
+ * libraries do not expose those (and draft-07 has none), so the extensions
+ * travel in-band, in a header block at the start of the object's payload.
+ * That needs moq_client_set_inband_headers() on the publishing client.
+ * Subscribers that opted in as well get the payload without the block and
+ * the extensions, in the order given, in MoqObjectInfo; every other
+ * subscriber, including other MoQ implementations, receives the block as
+ * part of the payload.
+ * 
+ * @param publisher Publisher handle
+ * @param data Data buffer to publish
+ * @param data_len Length of data
+ * @param extensions Extension headers (copied), may be NULL if extension_count is 0
+ * @param extension_count Number of extension headers
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if a pointer is NULL, a key or value
+ *         is 2^62 or more, or the extensions take more than 4096 bytes,
+ *         MOQ_ERROR_UNSUPPORTED if there are extensions but the client had
+ *         not opted in to in-band headers when the publisher was created
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
  */
-MOQ_API void moq_subscriber_destroy(MoqSubscriber* subscriber);
+MOQ_API MoqResult moq_publish_data_ex(
+    MoqPublisher* publisher,
+    const uint8_t* data,
+    size_t data_len,
+    const MoqExtension* extensions,
+    size_t extension_count
+);
 
 /**
- * Unsubscribe from a track without destroying the subscriber handle
- * 
- * This function stops receiving data from the track by:
- * - Aborting the reader task (stops processing incoming data)
- * - Dropping the track reader (signals to the relay)
- * - Marking the subscriber as unsubscribed
+ * Stamp every object of a publisher with its publish time
  * 
- * After calling this function:
- * - No more data callbacks will be invoked
- * - moq_is_subscribed() will return false
- * - The subscriber handle remains valid but inactive
- * - Call moq_subscriber_destroy() to free the handle
+ * Applies to all publish functions; moq_publish_data_timestamped() keeps
+ * its own capture time. Off by default. The stamp travels in the in-band
+ * header block, with the same incompatibility as
+ * moq_publish_data_timestamped(), so the client must have opted in with
+ * moq_client_set_inband_headers() before creating the publisher.
  * 
- * @param subscriber Subscriber handle
- * @return MOQ_OK on success or if already unsubscribed,
- *         MOQ_ERROR_INVALID_ARGUMENT if subscriber is null
+ * @param publisher Publisher handle
+ * @param enabled Whether to stamp objects
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if publisher is NULL,
+ *         MOQ_ERROR_UNSUPPORTED if enabling it without in-band headers
  * 
  * @note Thread-safe
- * @note Idempotent: safe to call multiple times
- * @note Available since: v0.2.0
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_publisher_set_timestamps(MoqPublisher* publisher, bool enabled);
+
+/**
+ * Get the bytes a publisher has published that the relay has not yet acknowledged
  * 
- * Example usage:
- * @code
- *   MoqSubscriber* sub = moq_subscribe(client, "ns", "track", callback, NULL);
- *   // ... receive data ...
+ * Counts object payloads and headers published since the publisher was
+ * created. Simulated sessions only: QUIC acknowledges data per stream, but
+ * the network transport opens subgroup streams internally, so a publisher's
+ * data cannot be told apart from other traffic on the connection, and the
+ * network backend returns MOQ_ERROR_UNSUPPORTED.
+ * 
+ * @param publisher Publisher handle
+ * @param unacked_bytes Output for the unacknowledged byte count
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_UNSUPPORTED from the network backend,
+ *         MOQ_ERROR_INVALID_ARGUMENT if publisher or unacked_bytes is NULL
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_publisher_get_unacked_bytes(const MoqPublisher* publisher, uint64_t* unacked_bytes);
+
+/**
+ * Check that everything published so far has been delivered to the relay
+ * 
+ * Simulated sessions only, for the reasons given at
+ * moq_publisher_get_unacked_bytes(); the network backend returns
+ * MOQ_ERROR_UNSUPPORTED, and moq_disconnect_graceful() drains a whole
+ * connection instead. The relay's virtual clock only moves in
+ * moq_sim_advance(), so this cannot wait for it: use
+ * moq_publisher_flush_async() to complete during an advance. Objects
+ * published afterwards are not waited for. The publisher stays usable
+ * whatever the outcome.
+ * 
+ * @param publisher Publisher handle
+ * @param timeout_ms How long to wait, in milliseconds
+ * @return MOQ_OK once all data published before the call has been
+ *         delivered, or if nothing was published,
+ *         MOQ_ERROR_TIMEOUT if some was still unacknowledged at the timeout,
+ *         MOQ_ERROR_NOT_CONNECTED if the session ended first,
+ *         MOQ_ERROR_UNSUPPORTED from the network backend,
+ *         MOQ_ERROR_INVALID_ARGUMENT if publisher is NULL
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_publisher_flush(MoqPublisher* publisher, uint64_t timeout_ms);
+
+/**
+ * Flush a publisher without blocking
+ * 
+ * Like moq_publisher_flush(), but returns at once and reports the outcome to
+ * completion_callback on a library thread, or before returning if nothing
+ * is outstanding. The publisher must outlive the callback.
+ * 
+ * @param publisher Publisher handle
+ * @param timeout_ms How long to wait, in milliseconds
+ * @param completion_callback Receives the result moq_publisher_flush() would have returned; may be NULL
+ * @param user_data Passed to completion_callback
+ * @return MOQ_OK if the flush was started,
+ *         MOQ_ERROR_UNSUPPORTED from the network backend,
+ *         MOQ_ERROR_INVALID_ARGUMENT if publisher is NULL
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_publisher_flush_async(
+    MoqPublisher* publisher,
+    uint64_t timeout_ms,
+    MoqCompletionCallback completion_callback,
+    void* user_data
+);
+
+/**
+ * Publish a byte range of a file as one object, without copying
+ * 
+ * The file is memory-mapped and the range is handed to the transport as a
+ * slice of the mapping, so video-on-demand assets are neither read into
+ * memory up front nor copied. Pages are loaded on demand and, being clean
+ * file-backed memory, can be reclaimed by the OS once sent.
+ * 
+ * The publisher keeps the most recently used file mapped and remaps it when
+ * its size or modification time changes. When a range starts where the
+ * previous one ended, the next four ranges (up to 16 MiB) are prefetched so
+ * sequential group publishing doesn't stall on disk reads.
+ * 
+ * @param publisher Publisher handle
+ * @param path Path of the file
+ * @param offset Byte offset of the range within the file
+ * @param len Length of the range in bytes
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if an argument is NULL, the file cannot
+ *         be opened or the range extends past its end
+ * 
+ * @note Thread-safe
+ * @note The file must not be truncated or modified in place while its
+ *       ranges are being sent; replace it atomically instead
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_publish_file_range(
+    MoqPublisher* publisher,
+    const char* path,
+    uint64_t offset,
+    size_t len
+);
+
+/**
+ * Acquire a writable buffer from the publisher's pool
+ * 
+ * Lets an encoder serialize an object directly into memory the library will
+ * send, instead of into its own buffer that moq_publish_data() then copies.
+ * Buffers come from a small per-publisher pool and are reused once the
+ * transport is done with them, so steady-state publishing does not allocate.
+ * 
+ * Every acquired slot must be passed to moq_publish_commit() or
+ * moq_publish_release() exactly once.
+ * 
+ * @param publisher Publisher handle
+ * @param size Number of bytes the application intends to write
+ * @return Slot with at least size bytes of capacity, or a slot whose data is
+ *         NULL on failure (check moq_last_error() for details)
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ * 
+ * Example usage:
+ * @code
+ *   MoqWriteSlot slot = moq_publish_acquire(pub, max_state_size);
+ *   if (slot.data) {
+ *       size_t used = encode_game_state(&state, slot.data, slot.capacity);
+ *       moq_publish_commit(&slot, used);
+ *   }
+ * @endcode
+ */
+MOQ_API MoqWriteSlot moq_publish_acquire(MoqPublisher* publisher, size_t size);
+
+/**
+ * Publish the bytes written into an acquired slot
+ * 
+ * The first used_len bytes are sent in place as one object and the rest of
+ * the buffer returns to the pool. The slot is reset to empty, even if sending
+ * fails. A slot may still be committed after its publisher was destroyed.
+ * 
+ * @param slot Slot returned by moq_publish_acquire()
+ * @param used_len Number of bytes written, at most slot->capacity
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if the slot is empty or used_len exceeds
+ *         its capacity (the slot is then left untouched)
+ * 
+ * @note A single slot must not be committed from two threads at once
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_publish_commit(MoqWriteSlot* slot, size_t used_len);
+
+/**
+ * Return an acquired slot to the pool without publishing
+ * 
+ * @param slot Slot returned by moq_publish_acquire() (NULL or empty slots
+ *             are ignored)
+ * 
+ * @note Available since: v0.3.0
+ */
+MOQ_API void moq_publish_release(MoqWriteSlot* slot);
+
+/* ───────────────────────────────────────────────
+ * Subscribing
+ * ─────────────────────────────────────────────── */
+
+/**
+ * Subscribe to a track
+ * @param client Client handle
+ * @param namespace_str Namespace of the track
+ * @param track_name Name of the track
+ * @param data_callback Callback for received data
+ * @param user_data User context pointer passed to callbacks
+ * @return Handle to the subscriber or NULL on failure
+ */
+MOQ_API MoqSubscriber* moq_subscribe(
+    MoqClient* client,
+    const char* namespace_str,
+    const char* track_name,
+    MoqDataCallback data_callback,
+    void* user_data
+);
+
+/**
+ * Subscribe to many tracks of one namespace in a single call
+ *
+ * Resolves the session once and issues all SUBSCRIBE requests from a single
+ * background task. Every track still gets its own subscriber handle, so tracks
+ * can be unsubscribed and destroyed independently.
+ *
+ * The operation is all-or-nothing: on failure no subscribers are created and
+ * every entry of subscribers_out is set to NULL.
+ *
+ * @param client Client handle (must be connected)
+ * @param namespace_str Namespace of the tracks
+ * @param track_names Array of track_count track names
+ * @param track_count Number of tracks to subscribe to
+ * @param data_callback Callback for received data, shared by all tracks
+ * @param user_data Optional array of track_count context pointers; entry i is
+ *                  passed to callbacks for track i (NULL passes NULL for all)
+ * @param subscribers_out Caller-provided array of track_count entries that
+ *                        receives the subscriber handles (destroy each with
+ *                        moq_subscriber_destroy())
+ * @return MOQ_OK on success, error code on failure
+ *
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_subscribe_many(
+    MoqClient* client,
+    const char* namespace_str,
+    const char* const* track_names,
+    size_t track_count,
+    MoqDataCallback data_callback,
+    void* const* user_data,
+    MoqSubscriber** subscribers_out
+);
+
+/**
+ * Subscribe to a track with batched delivery
+ * 
+ * Objects that are ready at the same time are handed to the callback in a
+ * single invocation, cutting per-object call overhead on high-rate tracks.
+ * A batch is delivered when it holds max_batch_objects objects, when the next
+ * read would block and max_batch_latency_us has passed since its first
+ * object, or when the track ends.
+ * 
+ * @param client Client handle (must be connected)
+ * @param namespace_str Namespace of the track
+ * @param track_name Name of the track
+ * @param batch_callback Callback receiving arrays of objects
+ * @param user_data User context pointer passed to callbacks
+ * @param max_batch_objects Maximum objects per batch (0 selects the default of 64)
+ * @param max_batch_latency_us How long a started batch may wait for more
+ *                             objects (0 delivers whatever is ready without waiting)
+ * @return Handle to the subscriber or NULL on failure
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqSubscriber* moq_subscribe_batched(
+    MoqClient* client,
+    const char* namespace_str,
+    const char* track_name,
+    MoqBatchCallback batch_callback,
+    void* user_data,
+    size_t max_batch_objects,
+    uint32_t max_batch_latency_us
+);
+
+/**
+ * Subscribe to a track and queue received objects for moq_subscriber_next()
+ * 
+ * Instead of calling into the application, received objects wait in a bounded
+ * queue until pulled, so event loops and coroutines can consume them on their
+ * own thread. When more than max_queued_objects are waiting, the oldest are
+ * dropped.
+ * 
+ * @param client Client handle (must be connected)
+ * @param namespace_str Namespace of the track
+ * @param track_name Name of the track
+ * @param max_queued_objects Queue limit (0 selects the default of 256)
+ * @return Handle to the subscriber or NULL on failure
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqSubscriber* moq_subscribe_queued(
+    MoqClient* client,
+    const char* namespace_str,
+    const char* track_name,
+    size_t max_queued_objects
+);
+
+/**
+ * Take the next object of a queued subscriber
+ * 
+ * When nothing is queued and ready is not NULL, ready is armed and invoked
+ * once, on a library thread, as soon as an object arrives or the track ends.
+ * Arming again replaces the previous callback. Destroying the subscriber
+ * disarms it without invoking it.
+ * 
+ * @param subscriber Subscriber created with moq_subscribe_queued()
+ * @param object_out Receives the object; release it with moq_object_release()
+ * @param ready Optional readiness callback, armed only if nothing is queued
+ * @param user_data User context pointer passed to ready
+ * @return MOQ_OK with object_out filled,
+ *         MOQ_ERROR_WOULD_BLOCK if nothing is queued yet (no message),
+ *         MOQ_ERROR_NOT_CONNECTED once the track has ended and the queue is
+ *         drained (no message),
+ *         MOQ_ERROR_INVALID_ARGUMENT if subscriber or object_out is NULL
+ * 
+ * @note Objects must be consumed by one thread at a time
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_subscriber_next(
+    MoqSubscriber* subscriber,
+    MoqReceivedObject* object_out,
+    MoqReadyCallback ready,
+    void* user_data
+);
+
+/**
+ * Release an object returned by moq_subscriber_next()
+ * 
+ * The object is zeroed afterwards; releasing it again is a no-op.
+ * 
+ * @param object Object to release (may be NULL)
+ * 
+ * @note Available since: v0.3.0
+ */
+MOQ_API void moq_object_release(MoqReceivedObject* object);
+
+/**
+ * Get the timing and extensions of an object returned by moq_subscriber_next()
+ * 
+ * The clock offset and latency are those known when the object arrived.
+ * The extensions stay valid until the object is released.
+ * 
+ * @param object Object that has not been released
+ * @param info Receives the timing
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if a pointer is NULL or the object is empty
+ * 
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_object_info(const MoqReceivedObject* object, MoqObjectInfo* info);
+
+/**
+ * Unsubscribe and destroy a subscriber
+ * @param subscriber Subscriber handle
+ */
+MOQ_API void moq_subscriber_destroy(MoqSubscriber* subscriber);
+
+/**
+ * Unsubscribe from a track without destroying the subscriber handle
+ * 
+ * This function stops receiving data from the track by:
+ * - Aborting the reader task (stops processing incoming data)
+ * - Dropping the track reader (signals to the relay)
+ * - Marking the subscriber as unsubscribed
+ * 
+ * After calling this function:
+ * - No more data callbacks will be invoked
+ * - moq_is_subscribed() will return false
+ * - The subscriber handle remains valid but inactive
+ * - Call moq_subscriber_destroy() to free the handle
+ * 
+ * @param subscriber Subscriber handle
+ * @return MOQ_OK on success or if already unsubscribed,
+ *         MOQ_ERROR_INVALID_ARGUMENT if subscriber is null
+ * 
+ * @note Thread-safe
+ * @note Idempotent: safe to call multiple times
+ * @note Available since: v0.2.0
+ * 
+ * Example usage:
+ * @code
+ *   MoqSubscriber* sub = moq_subscribe(client, "ns", "track", callback, NULL);
+ *   // ... receive data ...
  *   
  *   // Stop receiving without destroying handle
  *   MoqResult result = moq_unsubscribe(sub);
@@ -371,13 +1282,319 @@ MOQ_API MoqResult moq_unsubscribe(MoqSubscriber* subscriber);
  * Check if the subscriber is currently subscribed to a track
  * 
  * @param subscriber Subscriber handle
- * @return true if actively subscribed, false if null/unsubscribed/error
+ * @return true if actively subscribed, false if null/unsubscribed/error or
+ *         once the track has ended, including when the relay ended the session
  * 
  * @note Thread-safe
  * @note Available since: v0.2.0
  */
 MOQ_API bool moq_is_subscribed(const MoqSubscriber* subscriber);
 
+/**
+ * Replace the data callback of a running subscriber
+ * 
+ * The callback and user data are swapped atomically and take effect from the
+ * next received object; delivery never blocks on this call or vice versa.
+ * Passing a NULL callback pauses delivery (received objects are dropped).
+ * 
+ * An invocation of the previous callback that is already running may still
+ * complete after this function returns, so keep its user_data alive until then.
+ * 
+ * @param subscriber Subscriber handle
+ * @param data_callback New data callback, or NULL to pause delivery
+ * @param user_data User context pointer passed to the new callback
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if subscriber is null
+ * 
+ * @note Thread-safe; may be called from inside a data callback
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_subscriber_set_callback(
+    MoqSubscriber* subscriber,
+    MoqDataCallback data_callback,
+    void* user_data
+);
+
+/**
+ * Replace the callback of a running subscriber with a batch callback
+ * 
+ * Same semantics as moq_subscriber_set_callback(). Objects already waiting in
+ * a batch go to whichever callback is current when the batch is delivered.
+ * 
+ * @param subscriber Subscriber handle
+ * @param batch_callback New batch callback, or NULL to pause delivery
+ * @param user_data User context pointer passed to the new callback
+ * @param max_batch_objects Maximum objects per batch (0 selects the default)
+ * @param max_batch_latency_us How long a started batch may wait for more objects
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if subscriber is null
+ * 
+ * @note Thread-safe; may be called from inside a callback
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_subscriber_set_batch_callback(
+    MoqSubscriber* subscriber,
+    MoqBatchCallback batch_callback,
+    void* user_data,
+    size_t max_batch_objects,
+    uint32_t max_batch_latency_us
+);
+
+/**
+ * Replace the callback of a running subscriber with one that also gets object timing
+ * 
+ * Same semantics as moq_subscriber_set_callback(). Objects the publisher
+ * stamped carry their capture time; their latency becomes valid once the
+ * clock offset to the publisher is known, about a round trip after the
+ * first stamped object (stub backend: immediately, with an offset of 0).
+ * 
+ * @param subscriber Subscriber handle
+ * @param object_callback New callback, or NULL to pause delivery
+ * @param user_data User context pointer passed to the new callback
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if subscriber is null
+ * 
+ * @note Thread-safe; may be called from inside a callback
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_subscriber_set_object_callback(
+    MoqSubscriber* subscriber,
+    MoqObjectCallback object_callback,
+    void* user_data
+);
+
+/**
+ * Receive objects directly into application-provided buffers
+ * 
+ * For each object the reader asks alloc_fn for a buffer of the object's size,
+ * writes the payload chunks straight into it as they arrive, and hands the
+ * buffer back through commit_fn. No intermediate library buffer is used, so
+ * objects can land in GPU staging buffers, pinned memory or a frame pool.
+ * 
+ * This replaces the subscriber's data or batch callback; objects received
+ * before the call are delivered through the previous callback.
+ * 
+ * @param subscriber Subscriber handle
+ * @param alloc_fn Allocation hook (NULL together with commit_fn removes the
+ *                 hooks and pauses delivery)
+ * @param commit_fn Commit hook
+ * @param user_data User context pointer passed to both hooks
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if subscriber is null or only one hook is set
+ * 
+ * @note Thread-safe
+ * @note Hooks are invoked on a library worker thread
+ * @note Available since: v0.3.0
+ * 
+ * Example usage:
+ * @code
+ *   static uint8_t* alloc_frame(void* pool, size_t size) {
+ *       return frame_pool_acquire((FramePool*)pool, size);
+ *   }
+ *   static void commit_frame(void* pool, uint8_t* buf, size_t len,
+ *                            uint64_t group_id, uint64_t object_id) {
+ *       frame_pool_submit((FramePool*)pool, buf, len);
+ *   }
+ *   
+ *   MoqSubscriber* sub = moq_subscribe(client, "ns", "video", NULL, NULL);
+ *   moq_subscriber_set_allocator(sub, alloc_frame, commit_frame, &pool);
+ * @endcode
+ */
+MOQ_API MoqResult moq_subscriber_set_allocator(
+    MoqSubscriber* subscriber,
+    MoqAllocFn alloc_fn,
+    MoqCommitFn commit_fn,
+    void* user_data
+);
+
+/**
+ * Keep the most recent groups of a subscribed track for catch-up and rewind
+ * 
+ * Every object the subscriber receives is also kept in a bounded cache after
+ * it has been delivered, so late joiners and replay UIs can read recent groups
+ * locally instead of asking the relay again. Payloads stay in memory up to
+ * memory_bytes; beyond that the oldest payloads spill into a memory-mapped
+ * overflow file used as a ring buffer. Whole groups are evicted, oldest first,
+ * when there are more than max_groups, when they are older than max_age_ms,
+ * or when memory and overflow file are both full.
+ * 
+ * Enabling the cache again replaces it and discards its contents. Objects are
+ * cached even while the data callback is NULL.
+ * 
+ * @param subscriber Subscriber handle
+ * @param max_groups Maximum number of cached groups (0 = no group limit)
+ * @param max_age_ms Maximum age of a cached group, from its first object
+ *                   (0 = no age limit)
+ * @param memory_bytes Payload bytes kept in memory
+ * @param overflow_path Overflow file, created or truncated (NULL = memory only)
+ * @param overflow_bytes Size of the overflow file (ignored if overflow_path is NULL)
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if subscriber is null or overflow_path is
+ *         set with overflow_bytes of 0,
+ *         MOQ_ERROR_INTERNAL if the overflow file cannot be created,
+ *         MOQ_ERROR_UNSUPPORTED in the stub backend
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ * 
+ * Example usage:
+ * @code
+ *   // Last 10 seconds, 8 MiB in memory, up to 256 MiB on disk
+ *   moq_subscriber_enable_cache(sub, 0, 10000, 8 << 20,
+ *                               "/tmp/video.cache", 256 << 20);
+ * @endcode
+ */
+MOQ_API MoqResult moq_subscriber_enable_cache(
+    MoqSubscriber* subscriber,
+    size_t max_groups,
+    uint32_t max_age_ms,
+    size_t memory_bytes,
+    const char* overflow_path,
+    size_t overflow_bytes
+);
+
+/**
+ * Get the oldest and newest group IDs in a subscriber's cache
+ * 
+ * @param subscriber Subscriber handle
+ * @param first_group Receives the oldest cached group ID
+ * @param last_group Receives the newest cached group ID
+ * @return true if the cache holds at least one group, false if it is empty,
+ *         not enabled, or any argument is null
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API bool moq_subscriber_cached_groups(
+    const MoqSubscriber* subscriber,
+    uint64_t* first_group,
+    uint64_t* last_group
+);
+
+/**
+ * Read cached objects of a range of groups
+ * 
+ * Copies the cached objects of groups first_group..last_group (inclusive) out
+ * of the cache and passes them, in arrival order, to a single invocation of
+ * callback on the calling thread. Live delivery continues meanwhile. The
+ * callback is not invoked if no cached object falls in the range.
+ * 
+ * @param subscriber Subscriber handle
+ * @param first_group First group ID of the range
+ * @param last_group Last group ID of the range
+ * @param callback Receives the objects (valid only during the call)
+ * @param user_data User context pointer passed to callback
+ * @return MOQ_OK on success,
+ *         MOQ_ERROR_INVALID_ARGUMENT if subscriber or callback is null, or the
+ *         cache is not enabled
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_subscriber_read_range(
+    MoqSubscriber* subscriber,
+    uint64_t first_group,
+    uint64_t last_group,
+    MoqBatchCallback callback,
+    void* user_data
+);
+
+/* ───────────────────────────────────────────────
+ * Recording
+ * ─────────────────────────────────────────────── */
+
+/**
+ * Record a track to an indexed on-disk log
+ * 
+ * Subscribes to the track and appends every received object, with its group
+ * and object IDs and arrival time, to a new recording directory:
+ * 
+ *   track          namespace and track name, one per line
+ *   index          64-byte header, then one 40-byte little-endian entry per
+ *                  object: arrival_us, group_id, object_id (u64),
+ *                  segment, len (u32), offset (u64)
+ *   00000000.seg   payload segments
+ * 
+ * Each recorder writes on a thread of its own. Payloads are copied into
+ * memory-mapped 64 MiB segments whose disk space is reserved and whose pages
+ * are faulted in ahead of use, and the index is memory-mapped as well, so
+ * writing costs no system call per object and many tracks can be recorded
+ * without competing with live delivery. The index is ordered by arrival,
+ * allowing binary search by time or group.
+ * 
+ * @param client Client handle (must be connected)
+ * @param namespace_str Namespace of the track
+ * @param track_name Name of the track
+ * @param path Directory to record into; created if missing, must not already
+ *             contain a recording
+ * @return Recorder handle, or NULL on failure (check moq_last_error())
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqRecorder* moq_recorder_create(
+    MoqClient* client,
+    const char* namespace_str,
+    const char* track_name,
+    const char* path
+);
+
+/**
+ * Stop recording and finalize the recording on disk
+ * 
+ * Unsubscribes and waits until all data and the index are written back and
+ * the preallocated space is trimmed. After moq_shutdown() the subscription
+ * is already gone; this only finalizes the recording and does not start the
+ * runtime again.
+ * 
+ * @param recorder Recorder handle (NULL is ignored)
+ * 
+ * @note Must not be called from a library callback
+ */
+MOQ_API void moq_recorder_destroy(MoqRecorder* recorder);
+
+/**
+ * Republish a recorded track
+ * 
+ * Opens a recording made by moq_recorder_create() and publishes its track,
+ * under the recorded track name, in an announced namespace. Objects keep their
+ * original group structure (one subgroup per recorded group) and are sent
+ * straight out of the memory-mapped segments without copying.
+ * 
+ * With a positive speed, objects are scheduled against the start of the replay
+ * at their recorded arrival times divided by speed, so timer slack does not
+ * accumulate. Timing resolution is that of the runtime timer (1 ms).
+ * 
+ * @param client Client handle (must be connected)
+ * @param namespace_str Namespace to publish in (must be previously announced)
+ * @param path Recording directory
+ * @param speed Playback rate: 1.0 for the recorded timing, 2.0 for twice as
+ *              fast, 0 for as fast as possible
+ * @return Replayer handle, or NULL on failure (check moq_last_error())
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqReplayer* moq_replayer_create(
+    MoqClient* client,
+    const char* namespace_str,
+    const char* path,
+    double speed
+);
+
+/**
+ * Check whether a replayer has published every recorded object
+ * @param replayer Replayer handle (NULL returns true)
+ * @return true once the replay has finished
+ */
+MOQ_API bool moq_replayer_is_finished(const MoqReplayer* replayer);
+
+/**
+ * Stop a replayer and close its track
+ * @param replayer Replayer handle (NULL is ignored)
+ */
+MOQ_API void moq_replayer_destroy(MoqReplayer* replayer);
+
 /* ───────────────────────────────────────────────
  * Namespace Announcement Discovery
  * ─────────────────────────────────────────────── */
@@ -485,6 +1702,83 @@ MOQ_API MoqSubscriber* moq_subscribe_catalog(
     void* user_data
 );
 
+/* ───────────────────────────────────────────────
+ * Simulated Network (stub backend)
+ * ─────────────────────────────────────────────── */
+
+/*
+ * Builds without the moq features contain an in-memory relay for tests and
+ * benchmarks that must run without a network. moq_connect() with a URL of the
+ * form "sim://<name>" (optionally "sim://<name>?seed=<n>") joins the relay of
+ * that name; all clients using the same name share it. Announces, publishers,
+ * subscribers and announce callbacks then behave as with a real relay.
+ *
+ * Time is virtual: objects wait on simulated links until moq_sim_advance()
+ * moves the relay's clock past their arrival, and every callback runs on the
+ * thread calling moq_sim_advance(). Given the same seed and the same calls, a
+ * run delivers the same objects at the same virtual times.
+ *
+ * With the moq features enabled these functions return MOQ_ERROR_UNSUPPORTED.
+ */
+
+/**
+ * One direction of a client's link to a simulated relay
+ */
+typedef struct MoqSimLink {
+    uint32_t latency_us;    // One-way delay
+    uint32_t jitter_us;     // Extra delay drawn uniformly from [0, jitter_us]
+    uint64_t bandwidth_bps; // Link rate in bits per second, 0 for unlimited
+    double loss;            // Probability in [0, 1] that an object is lost
+} MoqSimLink;
+
+/**
+ * Set the simulated uplink (client to relay) and downlink (relay to client)
+ * 
+ * Links start ideal: no delay, unlimited bandwidth, no loss. Datagram objects
+ * that are lost disappear; stream objects are retransmitted after a round
+ * trip and stay in order. Objects already in flight are not affected.
+ * 
+ * @param client Client handle (connected or not; the links persist across connects)
+ * @param uplink New uplink, or NULL to keep the current one
+ * @param downlink New downlink, or NULL to keep the current one
+ * @return MOQ_OK, or MOQ_ERROR_INVALID_ARGUMENT for a null client or a loss outside [0, 1]
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_sim_set_link(
+    MoqClient* client,
+    const MoqSimLink* uplink,
+    const MoqSimLink* downlink
+);
+
+/**
+ * Advance the virtual clock of a simulated relay
+ * 
+ * Delivers, in virtual-time order, every object and announcement due within
+ * the next duration_us microseconds. Callbacks may publish; objects they send
+ * within the window are delivered in the same call.
+ * 
+ * @param url URL the clients connected with, e.g. "sim://relay"
+ * @param duration_us Virtual microseconds to advance (0 delivers what is due now)
+ * @return MOQ_OK, or MOQ_ERROR_INVALID_ARGUMENT if no client is connected to that relay
+ * 
+ * @note Thread-safe, but advancing from several threads makes delivery order nondeterministic
+ * @note Available since: v0.3.0
+ */
+MOQ_API MoqResult moq_sim_advance(const char* url, uint64_t duration_us);
+
+/**
+ * Get the virtual time of a simulated relay
+ * 
+ * @param url URL the clients connected with
+ * @return Microseconds since the relay was created, or 0 if no client is connected to it
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API uint64_t moq_sim_now(const char* url);
+
 /* ───────────────────────────────────────────────
  * Utilities
  * ─────────────────────────────────────────────── */
@@ -507,6 +1801,29 @@ MOQ_API const char* moq_version(void);
  */
 MOQ_API const char* moq_last_error(void);
 
+/**
+ * Snapshot of the library's async runtime
+ */
+typedef struct MoqRuntimeStats {
+    size_t worker_threads;      // Worker threads of the runtime
+    size_t alive_tasks;         // Spawned tasks that have not finished
+    size_t global_queue_depth;  // Tasks waiting in the global queue
+} MoqRuntimeStats;
+
+/**
+ * Get the current state of the library's async runtime
+ * 
+ * Intended for monitoring and soak tests: a steadily rising alive_tasks count
+ * under a constant workload points to tasks that are never torn down.
+ * 
+ * @param stats Receives the statistics (all zero in the stub backend)
+ * @return true on success, false if stats is null
+ * 
+ * @note Thread-safe
+ * @note Available since: v0.3.0
+ */
+MOQ_API bool moq_get_runtime_stats(MoqRuntimeStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
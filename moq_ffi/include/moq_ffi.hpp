@@ -0,0 +1,684 @@
+/*
+ * MoQ FFI - C++ wrapper for the C API
+ *
+ * Header-only, move-only RAII types over moq_ffi.h. Every handle frees itself,
+ * MoqResult messages are released automatically, payloads are passed as
+ * std::span<const std::byte>, and callbacks are forwarded through templated
+ * trampolines to handler objects owned by the caller, so the wrapper adds no
+ * heap allocations or indirections beyond the C calls themselves.
+ *
+ * Connecting, receiving and, in simulated sessions, flushing can also be
+ * awaited from C++20 coroutines, see Client::connect_async(),
+ * Subscriber::next() and Publisher::flush_async().
+ *
+ * Requires C++20. Nothing here throws; errors are reported through moq::Result
+ * or empty handles, exactly like the C API.
+ */
+
+#ifndef MOQ_FFI_HPP
+#define MOQ_FFI_HPP
+
+#if __cplusplus < 202002L && (!defined(_MSVC_LANG) || _MSVC_LANG < 202002L)
+#error "moq_ffi.hpp requires C++20; use moq_ffi.h from older language versions"
+#endif
+
+#include "moq_ffi.h"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace moq {
+
+/** Read-only payload view */
+using Bytes = std::span<const std::byte>;
+
+/** Writable buffer view */
+using MutableBytes = std::span<std::byte>;
+
+/** Batch of received objects, valid only during the callback */
+using Objects = std::span<const MoqObject>;
+
+/** View a received object's payload */
+inline Bytes payload(const MoqObject& object) noexcept {
+    return {reinterpret_cast<const std::byte*>(object.data), object.data_len};
+}
+
+/** Extension headers of an object */
+using Extensions = std::span<const MoqExtension>;
+
+/** View a received object's extension headers, valid as long as its info */
+inline Extensions extensions(const MoqObjectInfo& info) noexcept {
+    return {info.extensions, info.extension_count};
+}
+
+/** View the bytes of an odd-keyed extension header */
+inline Bytes data(const MoqExtension& extension) noexcept {
+    return {reinterpret_cast<const std::byte*>(extension.data), extension.data_len};
+}
+
+namespace detail {
+
+struct ClientDeleter {
+    void operator()(MoqClient* client) const noexcept { moq_client_destroy(client); }
+};
+
+struct PublisherDeleter {
+    void operator()(MoqPublisher* publisher) const noexcept { moq_publisher_destroy(publisher); }
+};
+
+struct SubscriberDeleter {
+    void operator()(MoqSubscriber* subscriber) const noexcept { moq_subscriber_destroy(subscriber); }
+};
+
+struct MessageDeleter {
+    void operator()(const char* message) const noexcept { moq_free_str(message); }
+};
+
+/*
+ * Trampolines recover the handler type from user_data. They are noexcept so an
+ * exception escaping a handler terminates instead of unwinding through the
+ * library's frames.
+ */
+
+template <class F>
+void on_state(void* user_data, MoqConnectionState state) noexcept {
+    (*static_cast<F*>(user_data))(state);
+}
+
+template <class F>
+void on_data(void* user_data, const uint8_t* data, size_t data_len) noexcept {
+    (*static_cast<F*>(user_data))(Bytes(reinterpret_cast<const std::byte*>(data), data_len));
+}
+
+template <class F>
+void on_batch(void* user_data, const MoqObject* objects, size_t count) noexcept {
+    (*static_cast<F*>(user_data))(Objects(objects, count));
+}
+
+template <class F>
+void on_object(void* user_data, const uint8_t* data, size_t data_len, const MoqObjectInfo* info) noexcept {
+    (*static_cast<F*>(user_data))(Bytes(reinterpret_cast<const std::byte*>(data), data_len), *info);
+}
+
+template <class F>
+void on_track(void* user_data, const char* namespace_str, const char* track_name) noexcept {
+    (*static_cast<F*>(user_data))(std::string_view(namespace_str),
+                                  track_name ? std::string_view(track_name) : std::string_view());
+}
+
+template <class F>
+void on_latency(void* user_data, uint64_t latency_us, uint64_t sequence) noexcept {
+    (*static_cast<F*>(user_data))(latency_us, sequence);
+}
+
+/* Handlers may be const; the C API only takes a non-const context pointer */
+template <class F>
+void* context(F& handler) noexcept {
+    return const_cast<void*>(static_cast<const volatile void*>(std::addressof(handler)));
+}
+
+/* Free the message of a result whose code is all the caller needs */
+inline MoqResultCode code_of(MoqResult result) noexcept {
+    moq_free_str(result.message);
+    return result.code;
+}
+
+} // namespace detail
+
+/**
+ * Executor resuming an awaiting coroutine directly on the library thread that
+ * completed the operation
+ *
+ * With the network backends that is a runtime worker thread, so the coroutine
+ * must not block; pass an executor that posts the handle to your own event
+ * loop instead when it might.
+ */
+struct InlineExecutor {
+    void operator()(std::coroutine_handle<> handle) const noexcept { handle.resume(); }
+};
+
+/** Callable that resumes a coroutine handle, e.g. by posting it to an event loop */
+template <class E>
+concept Executor = std::is_nothrow_move_constructible_v<E> && std::is_invocable_v<E&, std::coroutine_handle<>>;
+
+/**
+ * Outcome of an operation, owning its error message
+ */
+class [[nodiscard]] Result {
+public:
+    Result() noexcept = default;
+
+    /** Take ownership of a result returned by the C API */
+    explicit Result(MoqResult result) noexcept
+        : code_(result.code), message_(result.message) {}
+
+    MoqResultCode code() const noexcept { return code_; }
+    bool ok() const noexcept { return code_ == MOQ_OK; }
+    explicit operator bool() const noexcept { return ok(); }
+
+    /** Error description, empty on success */
+    std::string_view message() const noexcept {
+        return message_ ? std::string_view(message_.get()) : std::string_view();
+    }
+
+private:
+    MoqResultCode code_ = MOQ_OK;
+    std::unique_ptr<const char, detail::MessageDeleter> message_;
+};
+
+/** Batching limits for Client::subscribe_batched() */
+struct Batching {
+    size_t max_objects = 0;      // 0 selects the library default
+    uint32_t max_latency_us = 0; // 0 delivers whatever is ready without waiting
+};
+
+/**
+ * Buffer acquired with Publisher::acquire()
+ *
+ * Released back to the publisher's pool on destruction unless committed.
+ */
+class WriteSlot {
+public:
+    WriteSlot() noexcept = default;
+    explicit WriteSlot(MoqWriteSlot slot) noexcept : slot_(slot) {}
+
+    WriteSlot(WriteSlot&& other) noexcept : slot_(std::exchange(other.slot_, MoqWriteSlot{})) {}
+    WriteSlot& operator=(WriteSlot&& other) noexcept {
+        if (this != &other) {
+            release();
+            slot_ = std::exchange(other.slot_, MoqWriteSlot{});
+        }
+        return *this;
+    }
+    WriteSlot(const WriteSlot&) = delete;
+    WriteSlot& operator=(const WriteSlot&) = delete;
+    ~WriteSlot() { release(); }
+
+    explicit operator bool() const noexcept { return slot_.data != nullptr; }
+
+    /** Writable memory; empty if the acquire failed or the slot was committed */
+    MutableBytes data() const noexcept {
+        return {reinterpret_cast<std::byte*>(slot_.data), slot_.data ? slot_.capacity : 0};
+    }
+
+    /** Publish the first used_len bytes; the slot is empty afterwards on success */
+    Result commit(size_t used_len) noexcept { return Result(moq_publish_commit(&slot_, used_len)); }
+
+    /** Return the buffer to the pool without publishing */
+    void release() noexcept { moq_publish_release(&slot_); }
+
+private:
+    MoqWriteSlot slot_{};
+};
+
+/**
+ * Object taken from a queued subscriber, owning its payload
+ */
+class Object {
+public:
+    Object() noexcept = default;
+    explicit Object(MoqReceivedObject object) noexcept : object_(object) {}
+
+    Object(Object&& other) noexcept : object_(std::exchange(other.object_, MoqReceivedObject{})) {}
+    Object& operator=(Object&& other) noexcept {
+        if (this != &other) {
+            moq_object_release(&object_);
+            object_ = std::exchange(other.object_, MoqReceivedObject{});
+        }
+        return *this;
+    }
+    Object(const Object&) = delete;
+    Object& operator=(const Object&) = delete;
+    ~Object() { moq_object_release(&object_); }
+
+    /** False at the end of the track */
+    explicit operator bool() const noexcept { return object_.reserved != nullptr; }
+
+    Bytes data() const noexcept {
+        return {reinterpret_cast<const std::byte*>(object_.data), object_.data_len};
+    }
+    uint64_t group_id() const noexcept { return object_.group_id; }
+    uint64_t object_id() const noexcept { return object_.object_id; }
+
+    /** Capture time, latency and extension headers, see moq_object_info() */
+    MoqObjectInfo info() const noexcept {
+        MoqObjectInfo info{};
+        detail::code_of(moq_object_info(&object_, &info));
+        return info;
+    }
+
+private:
+    MoqReceivedObject object_{};
+};
+
+namespace detail {
+
+/*
+ * The awaitables below hand `this` to the library and must not touch it once
+ * the coroutine may have been resumed elsewhere. Whichever of await_suspend()
+ * and the library callback finishes second resumes the coroutine, so an
+ * operation completing before await_suspend() returns does not suspend at all.
+ */
+
+template <Executor E>
+class ConnectAwaitable {
+public:
+    ConnectAwaitable(MoqClient* client, const char* url, E executor) noexcept
+        : client_(client), url_(url), executor_(std::move(executor)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+        handle_ = handle;
+        MoqResult started = moq_connect_async(client_, url_, nullptr, this, &complete);
+        if (started.code != MOQ_OK) {
+            result_ = started;
+            return false;
+        }
+        return !done_.exchange(true, std::memory_order_acq_rel);
+    }
+
+    Result await_resume() noexcept { return Result(std::exchange(result_, MoqResult{})); }
+
+private:
+    static void complete(void* user_data, MoqResult result) noexcept {
+        auto* self = static_cast<ConnectAwaitable*>(user_data);
+        self->result_ = result;
+        if (self->done_.exchange(true, std::memory_order_acq_rel)) {
+            E executor = std::move(self->executor_);
+            executor(self->handle_);
+        }
+    }
+
+    MoqClient* client_;
+    const char* url_;
+    E executor_;
+    std::coroutine_handle<> handle_;
+    MoqResult result_{};
+    std::atomic<bool> done_{false};
+};
+
+template <Executor E>
+class FlushAwaitable {
+public:
+    FlushAwaitable(MoqPublisher* publisher, uint64_t timeout_ms, E executor) noexcept
+        : publisher_(publisher), timeout_ms_(timeout_ms), executor_(std::move(executor)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+        handle_ = handle;
+        MoqResult started = moq_publisher_flush_async(publisher_, timeout_ms_, &complete, this);
+        if (started.code != MOQ_OK) {
+            result_ = started;
+            return false;
+        }
+        return !done_.exchange(true, std::memory_order_acq_rel);
+    }
+
+    Result await_resume() noexcept { return Result(std::exchange(result_, MoqResult{})); }
+
+private:
+    static void complete(void* user_data, MoqResult result) noexcept {
+        auto* self = static_cast<FlushAwaitable*>(user_data);
+        self->result_ = result;
+        if (self->done_.exchange(true, std::memory_order_acq_rel)) {
+            E executor = std::move(self->executor_);
+            executor(self->handle_);
+        }
+    }
+
+    MoqPublisher* publisher_;
+    uint64_t timeout_ms_;
+    E executor_;
+    std::coroutine_handle<> handle_;
+    MoqResult result_{};
+    std::atomic<bool> done_{false};
+};
+
+template <Executor E>
+class NextAwaitable {
+public:
+    NextAwaitable(MoqSubscriber* subscriber, E executor) noexcept
+        : subscriber_(subscriber), executor_(std::move(executor)) {}
+    NextAwaitable(const NextAwaitable&) = delete;
+    NextAwaitable& operator=(const NextAwaitable&) = delete;
+    ~NextAwaitable() { moq_object_release(&object_); }
+
+    bool await_ready() noexcept {
+        code_ = code_of(moq_subscriber_next(subscriber_, &object_, nullptr, nullptr));
+        return code_ != MOQ_ERROR_WOULD_BLOCK;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+        handle_ = handle;
+        MoqResultCode code = code_of(moq_subscriber_next(subscriber_, &object_, &ready, this));
+        if (code == MOQ_ERROR_WOULD_BLOCK) {
+            return true; // Armed: ready() may already be running
+        }
+        code_ = code;
+        return false;
+    }
+
+    /** The next object, or an empty one once the track has ended */
+    Object await_resume() noexcept {
+        if (code_ == MOQ_ERROR_WOULD_BLOCK) {
+            code_ = code_of(moq_subscriber_next(subscriber_, &object_, nullptr, nullptr));
+        }
+        return code_ == MOQ_OK ? Object(std::exchange(object_, MoqReceivedObject{})) : Object();
+    }
+
+private:
+    static void ready(void* user_data) noexcept {
+        auto* self = static_cast<NextAwaitable*>(user_data);
+        E executor = std::move(self->executor_);
+        executor(self->handle_);
+    }
+
+    MoqSubscriber* subscriber_;
+    E executor_;
+    std::coroutine_handle<> handle_;
+    MoqReceivedObject object_{};
+    MoqResultCode code_ = MOQ_ERROR_WOULD_BLOCK;
+};
+
+} // namespace detail
+
+/**
+ * Publisher for one track
+ */
+class Publisher {
+public:
+    Publisher() noexcept = default;
+    Publisher(MoqPublisher* handle, MoqDeliveryMode mode) noexcept : handle_(handle), mode_(mode) {}
+
+    explicit operator bool() const noexcept { return handle_ != nullptr; }
+    MoqPublisher* get() const noexcept { return handle_.get(); }
+    MoqPublisher* release() noexcept { return handle_.release(); }
+    MoqDeliveryMode delivery_mode() const noexcept { return mode_; }
+
+    /** Publish one object */
+    Result publish(Bytes data) const noexcept {
+        return Result(moq_publish_data(handle_.get(), reinterpret_cast<const uint8_t*>(data.data()),
+                                       data.size(), mode_));
+    }
+
+    /** Publish one object stamped with its capture time (0 for now), see moq_publish_data_timestamped() */
+    Result publish(Bytes data, uint64_t capture_time_us) const noexcept {
+        return Result(moq_publish_data_timestamped(handle_.get(),
+                                                   reinterpret_cast<const uint8_t*>(data.data()),
+                                                   data.size(), capture_time_us));
+    }
+
+    /** Publish one object with extension headers, see moq_publish_data_ex() */
+    Result publish(Bytes data, Extensions extensions) const noexcept {
+        return Result(moq_publish_data_ex(handle_.get(), reinterpret_cast<const uint8_t*>(data.data()),
+                                          data.size(), extensions.data(), extensions.size()));
+    }
+
+    /** Stamp every object with its publish time; needs in-band headers, see moq_client_set_inband_headers() */
+    Result set_timestamps(bool enabled) const noexcept {
+        return Result(moq_publisher_set_timestamps(handle_.get(), enabled));
+    }
+
+    /** Bytes published but not yet acknowledged by the relay; simulated sessions only */
+    Result unacked_bytes(uint64_t& bytes) const noexcept {
+        return Result(moq_publisher_get_unacked_bytes(handle_.get(), &bytes));
+    }
+
+    /** Check that everything published so far is acknowledged; simulated sessions only, see moq_publisher_flush() */
+    Result flush(uint64_t timeout_ms) const noexcept {
+        return Result(moq_publisher_flush(handle_.get(), timeout_ms));
+    }
+
+    /** co_await a flush on the simulated relay's clock, see moq_publisher_flush_async() */
+    template <Executor E = InlineExecutor>
+    [[nodiscard]] detail::FlushAwaitable<E> flush_async(uint64_t timeout_ms, E executor = {}) const noexcept {
+        return detail::FlushAwaitable<E>(handle_.get(), timeout_ms, std::move(executor));
+    }
+
+    /** Publish a byte range of a file as one object, see moq_publish_file_range() */
+    Result publish_file_range(const char* path, uint64_t offset, size_t len) const noexcept {
+        return Result(moq_publish_file_range(handle_.get(), path, offset, len));
+    }
+
+    /** Acquire a pooled buffer to encode the next object into */
+    WriteSlot acquire(size_t size) const noexcept {
+        return WriteSlot(moq_publish_acquire(handle_.get(), size));
+    }
+
+private:
+    std::unique_ptr<MoqPublisher, detail::PublisherDeleter> handle_;
+    MoqDeliveryMode mode_ = MOQ_DELIVERY_STREAM;
+};
+
+/**
+ * Subscription to one track
+ *
+ * Handlers are referenced, not copied: a handler passed to Client::subscribe()
+ * or set_callback() must outlive the subscriber, and with the network backends
+ * also any callback still running when the subscriber is destroyed (see
+ * MoqDataCallback).
+ */
+class Subscriber {
+public:
+    Subscriber() noexcept = default;
+    explicit Subscriber(MoqSubscriber* handle) noexcept : handle_(handle) {}
+
+    explicit operator bool() const noexcept { return handle_ != nullptr; }
+    MoqSubscriber* get() const noexcept { return handle_.get(); }
+    MoqSubscriber* release() noexcept { return handle_.release(); }
+
+    bool is_subscribed() const noexcept { return moq_is_subscribed(handle_.get()); }
+
+    /** Stop receiving while keeping the handle */
+    Result unsubscribe() const noexcept { return Result(moq_unsubscribe(handle_.get())); }
+
+    /** Replace the handler; F is invoked as handler(moq::Bytes) */
+    template <class F>
+        requires std::is_invocable_v<F&, Bytes>
+    Result set_callback(F& handler) const noexcept {
+        return Result(moq_subscriber_set_callback(handle_.get(), &detail::on_data<F>,
+                                                  detail::context(handler)));
+    }
+
+    /** Replace the handler with a batch handler invoked as handler(moq::Objects) */
+    template <class F>
+        requires std::is_invocable_v<F&, Objects>
+    Result set_batch_callback(F& handler, Batching batching = {}) const noexcept {
+        return Result(moq_subscriber_set_batch_callback(handle_.get(), &detail::on_batch<F>,
+                                                        detail::context(handler),
+                                                        batching.max_objects,
+                                                        batching.max_latency_us));
+    }
+
+    /** Replace the handler with one invoked as handler(moq::Bytes, const MoqObjectInfo&) */
+    template <class F>
+        requires std::is_invocable_v<F&, Bytes, const MoqObjectInfo&>
+    Result set_object_callback(F& handler) const noexcept {
+        return Result(moq_subscriber_set_object_callback(handle_.get(), &detail::on_object<F>,
+                                                         detail::context(handler)));
+    }
+
+    /** Pause delivery; received objects are dropped */
+    Result pause() const noexcept {
+        return Result(moq_subscriber_set_callback(handle_.get(), nullptr, nullptr));
+    }
+
+    /**
+     * Await the next object of a subscriber from Client::subscribe_queued()
+     *
+     * co_await yields a moq::Object, empty once the track has ended (after
+     * unsubscribe() or when the relay ends it). A coroutine still waiting when
+     * the subscriber is destroyed is never resumed. One awaiter at a time.
+     */
+    template <Executor E = InlineExecutor>
+    [[nodiscard]] detail::NextAwaitable<E> next(E executor = {}) const noexcept {
+        return detail::NextAwaitable<E>(handle_.get(), std::move(executor));
+    }
+
+private:
+    std::unique_ptr<MoqSubscriber, detail::SubscriberDeleter> handle_;
+};
+
+/**
+ * Client session with a relay
+ *
+ * Destroy publishers and subscribers before the client they were created from.
+ */
+class Client {
+public:
+    /** Create a client; check with operator bool */
+    Client() noexcept : handle_(moq_client_create()) {}
+    explicit Client(MoqClient* handle) noexcept : handle_(handle) {}
+
+    explicit operator bool() const noexcept { return handle_ != nullptr; }
+    MoqClient* get() const noexcept { return handle_.get(); }
+    MoqClient* release() noexcept { return handle_.release(); }
+
+    Result connect(const char* url) const noexcept {
+        return Result(moq_connect(handle_.get(), url, nullptr, nullptr));
+    }
+
+    /** Connect, reporting state changes as handler(MoqConnectionState) */
+    template <class F>
+        requires std::is_invocable_v<F&, MoqConnectionState>
+    Result connect(const char* url, F& handler) const noexcept {
+        return Result(moq_connect(handle_.get(), url, &detail::on_state<F>, detail::context(handler)));
+    }
+
+    /**
+     * Connect without blocking; co_await yields the moq::Result
+     *
+     * The coroutine is resumed through executor once the handshake finishes,
+     * or immediately if the attempt fails validation or completes at once.
+     */
+    template <Executor E = InlineExecutor>
+    [[nodiscard]] detail::ConnectAwaitable<E> connect_async(const char* url, E executor = {}) const noexcept {
+        return detail::ConnectAwaitable<E>(handle_.get(), url, std::move(executor));
+    }
+
+    Result disconnect() const noexcept { return Result(moq_disconnect(handle_.get())); }
+    /** Disconnect once queued data is sent, waiting at most deadline_ms */
+    Result disconnect_graceful(uint64_t deadline_ms) const noexcept {
+        return Result(moq_disconnect_graceful(handle_.get(), deadline_ms));
+    }
+    bool is_connected() const noexcept { return moq_is_connected(handle_.get()); }
+
+    /** Select GSO/GRO for the next connect() */
+    Result set_udp_offload(bool gso, bool gro) const noexcept {
+        return Result(moq_client_set_udp_offload(handle_.get(), gso, gro));
+    }
+
+    /** Write and strip the in-band object header, see moq_client_set_inband_headers() */
+    Result set_inband_headers(bool enabled) const noexcept {
+        return Result(moq_client_set_inband_headers(handle_.get(), enabled));
+    }
+
+    /** Reconnect when the relay ends the session, see moq_client_set_auto_resume() */
+    Result set_auto_resume(bool enabled) const noexcept {
+        return Result(moq_client_set_auto_resume(handle_.get(), enabled));
+    }
+
+    Result transport_stats(MoqTransportStats& stats) const noexcept {
+        return Result(moq_client_get_transport_stats(handle_.get(), &stats));
+    }
+
+    Result start_latency_probe(uint32_t interval_ms) const noexcept {
+        return Result(moq_client_start_latency_probe(handle_.get(), interval_ms, nullptr, nullptr));
+    }
+
+    /** Probe relay-path latency, reporting each sample as handler(uint64_t latency_us, uint64_t sequence) */
+    template <class F>
+        requires std::is_invocable_v<F&, uint64_t, uint64_t>
+    Result start_latency_probe(uint32_t interval_ms, F& handler) const noexcept {
+        return Result(moq_client_start_latency_probe(handle_.get(), interval_ms, &detail::on_latency<F>,
+                                                     detail::context(handler)));
+    }
+
+    Result stop_latency_probe() const noexcept { return Result(moq_client_stop_latency_probe(handle_.get())); }
+
+    Result latency_stats(MoqLatencyStats& stats) const noexcept {
+        return Result(moq_client_get_latency_stats(handle_.get(), &stats));
+    }
+
+    Result announce_namespace(const char* namespace_str) const noexcept {
+        return Result(moq_announce_namespace(handle_.get(), namespace_str));
+    }
+
+    /** Create a publisher; empty on failure (see moq_last_error()) */
+    Publisher create_publisher(const char* namespace_str, const char* track_name,
+                               MoqDeliveryMode mode = MOQ_DELIVERY_STREAM) const noexcept {
+        return Publisher(moq_create_publisher_ex(handle_.get(), namespace_str, track_name, mode), mode);
+    }
+
+    /** Subscribe with handler(moq::Bytes); empty on failure */
+    template <class F>
+        requires std::is_invocable_v<F&, Bytes>
+    Subscriber subscribe(const char* namespace_str, const char* track_name, F& handler) const noexcept {
+        return Subscriber(moq_subscribe(handle_.get(), namespace_str, track_name,
+                                        &detail::on_data<F>, detail::context(handler)));
+    }
+
+    /** Subscribe with batched delivery to handler(moq::Objects); empty on failure */
+    template <class F>
+        requires std::is_invocable_v<F&, Objects>
+    Subscriber subscribe_batched(const char* namespace_str, const char* track_name, F& handler,
+                                 Batching batching = {}) const noexcept {
+        return Subscriber(moq_subscribe_batched(handle_.get(), namespace_str, track_name,
+                                                &detail::on_batch<F>, detail::context(handler),
+                                                batching.max_objects, batching.max_latency_us));
+    }
+
+    /** Subscribe with objects queued for Subscriber::next(); empty on failure */
+    Subscriber subscribe_queued(const char* namespace_str, const char* track_name,
+                                size_t max_queued_objects = 0) const noexcept {
+        return Subscriber(moq_subscribe_queued(handle_.get(), namespace_str, track_name,
+                                               max_queued_objects));
+    }
+
+    /**
+     * Report announced tracks as handler(std::string_view ns, std::string_view track);
+     * track is empty for namespace-level announcements
+     */
+    template <class F>
+        requires std::is_invocable_v<F&, std::string_view, std::string_view>
+    Result subscribe_announces(F& handler) const noexcept {
+        return Result(moq_subscribe_announces(handle_.get(), &detail::on_track<F>,
+                                              detail::context(handler)));
+    }
+
+private:
+    std::unique_ptr<MoqClient, detail::ClientDeleter> handle_;
+};
+
+/** Initialize the library, see moq_init() */
+inline bool init() noexcept { return moq_init(); }
+
+/** Shut the library down so that it can be unloaded or started again, see moq_shutdown() */
+inline Result shutdown(uint64_t timeout_ms) noexcept { return Result(moq_shutdown(timeout_ms)); }
+
+/** Do the work of a first connect ahead of time, optionally opening the sessions, see moq_prewarm_ex() */
+inline Result prewarm(std::span<const char* const> urls, bool preconnect = false) noexcept {
+    return Result(moq_prewarm_ex(urls.data(), urls.size(), preconnect));
+}
+
+/** Library version string */
+inline std::string_view version() noexcept { return moq_version(); }
+
+/** Last error on this thread, empty if none */
+inline std::string_view last_error() noexcept {
+    const char* error = moq_last_error();
+    return error ? std::string_view(error) : std::string_view();
+}
+
+} // namespace moq
+
+#endif /* MOQ_FFI_HPP */
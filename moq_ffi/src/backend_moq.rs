@@ -18,13 +18,26 @@
 
 use std::ffi::{CStr, CString};
 use std::os::raw::c_char;
-use std::sync::{Arc, Mutex};
+use std::sync::{Arc, Mutex, RwLock};
+use std::sync::atomic::{AtomicBool, AtomicU8, Ordering};
+use std::collections::hash_map::RandomState;
 use std::collections::HashMap;
+use std::hash::{BuildHasher, Hash};
 
-use tokio::runtime::Runtime;
+use arc_swap::ArcSwapOption;
+
+use tokio::runtime::{Handle, Runtime};
 use tokio::time::{timeout, Duration};
 use once_cell::sync::Lazy;
 
+use crate::group_cache::{CacheLimits, GroupCache};
+use crate::clock_sync;
+use crate::latency_probe::{self, LatencyFn, ProbeStats};
+use crate::object_header::{self, ObjectHeader};
+use crate::object_queue::{ObjectQueue, Pop};
+use crate::recording::{RecordingReader, RecordingWriter};
+use crate::udp_offload::{OffloadSocket, UdpOffload};
+
 // Compile-time check: Ensure only one MoQ version feature is enabled
 #[cfg(all(feature = "with_moq", feature = "with_moq_draft07"))]
 compile_error!("Cannot enable both 'with_moq' and 'with_moq_draft07' features simultaneously. Choose one based on your relay server.");
@@ -54,20 +67,169 @@ use moq_catalog_draft07 as moq_catalog;
 // These timeouts prevent operations from hanging indefinitely
 const CONNECT_TIMEOUT_SECS: u64 = 30;
 
+// Session resumption after the relay ends a session: attempts, and the delay
+// before the first retry, doubled after each failure
+const RESUME_ATTEMPTS: u32 = 5;
+const RESUME_BACKOFF: Duration = Duration::from_millis(250);
+
 // Global tokio runtime for async operations
 // This runtime handles:
 // - Async WebTransport/QUIC operations
 // - Message processing tasks
 // - Track reader/writer management
 // - Callback invocations from async context
-static RUNTIME: Lazy<Runtime> = Lazy::new(|| {
-    tokio::runtime::Builder::new_multi_thread()
-        .worker_threads(4)
-        .thread_name("moq-ffi-worker")
-        .enable_all()
-        .build()
-        .expect("Failed to create tokio runtime")
-});
+// It is built on first use; moq_shutdown() stops it and joins its threads,
+// and the next use after that builds a fresh one.
+static RUNTIME: SharedRuntime = SharedRuntime::new();
+
+// Worker threads of the runtime
+const RUNTIME_WORKERS: usize = 4;
+
+/// The library's runtime, replaceable so that a shut-down library can start again.
+struct SharedRuntime {
+    /// Handle of the running runtime, cloned for every use
+    handle: RwLock<Option<Handle>>,
+    /// The runtime itself, owned here until shutdown consumes it, with the
+    /// count of its threads that are still running
+    runtime: Mutex<Option<(Runtime, Arc<LiveThreads>)>>,
+}
+
+thread_local! {
+    // Set on every thread a library runtime starts, workers and blocking threads alike
+    static LIBRARY_THREAD: std::cell::Cell<bool> = const { std::cell::Cell::new(false) };
+}
+
+/// Whether the calling thread belongs to a library runtime, as callbacks do.
+/// Threads of the host's own runtimes are not.
+fn on_library_thread() -> bool {
+    LIBRARY_THREAD.with(|flag| flag.get())
+}
+
+/// Threads of one runtime that have started and not yet stopped.
+#[derive(Default)]
+struct LiveThreads {
+    count: Mutex<usize>,
+    changed: std::sync::Condvar,
+}
+
+impl LiveThreads {
+    fn started(&self) {
+        *self.count.lock().unwrap_or_else(|poisoned| poisoned.into_inner()) += 1;
+        self.changed.notify_all();
+    }
+
+    fn stopped(&self) {
+        *self.count.lock().unwrap_or_else(|poisoned| poisoned.into_inner()) -= 1;
+        self.changed.notify_all();
+    }
+
+    /// Waits until at least `threads` have started, so that none is missed
+    /// by a shutdown that comes before it got going.
+    fn wait_started(&self, threads: usize) {
+        let count = self.count.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        drop(self.changed.wait_while(count, |count| *count < threads).unwrap_or_else(|poisoned| poisoned.into_inner()));
+    }
+
+    /// Waits until `deadline` for every thread to stop. Returns whether they did.
+    fn wait_until(&self, deadline: std::time::Instant) -> bool {
+        let mut count = self.count.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        while *count > 0 {
+            let left = deadline.saturating_duration_since(std::time::Instant::now());
+            if left.is_zero() {
+                return false;
+            }
+            count = self.changed.wait_timeout(count, left).unwrap_or_else(|poisoned| poisoned.into_inner()).0;
+        }
+        true
+    }
+}
+
+impl SharedRuntime {
+    const fn new() -> Self {
+        SharedRuntime { handle: RwLock::new(None), runtime: Mutex::new(None) }
+    }
+
+    /// Handle of the running runtime, building one if there is none.
+    fn handle(&self) -> Handle {
+        if let Some(handle) = self.handle.read().unwrap_or_else(|poisoned| poisoned.into_inner()).as_ref() {
+            return handle.clone();
+        }
+        let mut runtime = self.runtime.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        let handle = runtime
+            .get_or_insert_with(|| {
+                let threads = Arc::new(LiveThreads::default());
+                let (on_start, on_stop) = (threads.clone(), threads.clone());
+                let runtime = tokio::runtime::Builder::new_multi_thread()
+                    .worker_threads(RUNTIME_WORKERS)
+                    .thread_name("moq-ffi-worker")
+                    .on_thread_start(move || {
+                        LIBRARY_THREAD.with(|flag| flag.set(true));
+                        on_start.started();
+                    })
+                    .on_thread_stop(move || on_stop.stopped())
+                    .enable_all()
+                    .build()
+                    .expect("Failed to create tokio runtime");
+                threads.wait_started(RUNTIME_WORKERS);
+                (runtime, threads)
+            })
+            .0
+            .handle()
+            .clone();
+        *self.handle.write().unwrap_or_else(|poisoned| poisoned.into_inner()) = Some(handle.clone());
+        handle
+    }
+
+    /// Handle of the running runtime, or None after shutdown or before first
+    /// use. Never builds one.
+    fn try_handle(&self) -> Option<Handle> {
+        self.handle.read().unwrap_or_else(|poisoned| poisoned.into_inner()).clone()
+    }
+
+    fn spawn<F>(&self, future: F) -> tokio::task::JoinHandle<F::Output>
+    where
+        F: std::future::Future + Send + 'static,
+        F::Output: Send + 'static,
+    {
+        self.handle().spawn(future)
+    }
+
+    fn block_on<F: std::future::Future>(&self, future: F) -> F::Output {
+        self.handle().block_on(future)
+    }
+
+    fn metrics(&self) -> tokio::runtime::RuntimeMetrics {
+        self.handle().metrics()
+    }
+
+    /// Stops the runtime, dropping its tasks, and waits up to `timeout` for
+    /// its threads to exit. Returns true only if all of them did; the rest
+    /// exit once their blocking work returns.
+    fn shutdown(&self, timeout: Duration) -> bool {
+        let runtime = {
+            let mut runtime = self.runtime.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+            *self.handle.write().unwrap_or_else(|poisoned| poisoned.into_inner()) = None;
+            runtime.take()
+        };
+        let Some((runtime, threads)) = runtime else { return true };
+        let deadline = std::time::Instant::now() + timeout;
+        runtime.shutdown_timeout(timeout);
+        threads.wait_until(deadline)
+    }
+}
+
+// Clients not yet destroyed, so moq_shutdown() can close their sessions
+static CLIENTS: Mutex<Vec<std::sync::Weak<ClientInner>>> = Mutex::new(Vec::new());
+
+// Native root certificates, see root_certs()
+static ROOT_CERTS: Mutex<Option<Arc<rustls::RootCertStore>>> = Mutex::new(None);
+
+// Idle sessions opened by moq_prewarm_ex(), by URL, each waiting for the
+// first moq_connect() to its URL
+static PREWARMED: Mutex<Vec<(String, Dialed)>> = Mutex::new(Vec::new());
+
+// Keep-alive of prewarmed sessions, well inside quinn's 30 s idle timeout
+const PREWARM_KEEP_ALIVE: Duration = Duration::from_secs(10);
 
 // Crypto provider initialization for rustls
 // Rustls 0.23+ requires explicit CryptoProvider initialization before any TLS operations.
@@ -113,27 +275,240 @@ use moq::{
 };
 
 struct ClientInner {
-    connected: bool,
-    url: Option<String>,
-    session: Option<Session>,
-    publisher: Option<MoqTransportPublisher>,
-    subscriber: Option<MoqTransportSubscriber>,
-    connection_callback: MoqConnectionCallback,
-    connection_user_data: usize, // Store as usize for Send safety
+    // Connection state (MoqConnectionState as u8), readable without locking
+    state: AtomicU8,
+    url: Mutex<Option<String>>,
+    // Publisher/subscriber handles for the live session, swapped in on connect
+    session: ArcSwapOption<SessionHandles>,
+    connection_callback: ArcSwapOption<CallbackSlot<MoqConnectionCallback>>,
     // Track announced namespaces (for publishing)
-    announced_namespaces: HashMap<TrackNamespace, TracksWriter>,
+    announced_namespaces: ShardedMap<TrackNamespace, TracksWriter>,
+    // Readers of the announced namespaces, announced again on a resumed session
+    announced_tracks: Mutex<HashMap<TrackNamespace, serve::TracksReader>>,
     // Handle to session run task
-    session_task: Option<tokio::task::JoinHandle<()>>,
+    session_task: Mutex<Option<tokio::task::JoinHandle<()>>>,
     // Callback for namespace announcements (from other publishers)
-    announce_callback: MoqTrackCallback,
-    announce_user_data: usize,
+    announce_callback: ArcSwapOption<CallbackSlot<MoqTrackCallback>>,
     // Handle to announce listener task
-    announce_task: Option<tokio::task::JoinHandle<()>>,
+    announce_task: Mutex<Option<tokio::task::JoinHandle<()>>>,
+    // UDP offloads for the endpoint of the next connection
+    udp_offload: Mutex<UdpOffload>,
+    // Whether new publishers and subscriptions use the in-band object header
+    // (moq_client_set_inband_headers)
+    inband_headers: AtomicBool,
+    // Whether a session the relay ends is reconnected (moq_client_set_auto_resume)
+    auto_resume: AtomicBool,
+    // Relay-path latency probe, while running
+    latency_probe: Mutex<Option<LatencyProbe>>,
+    // Figures of the most recent latency probe, kept after it stops
+    latency_stats: ArcSwapOption<ProbeStats>,
+    // Clock offsets to the publishers of subscribed namespaces
+    peer_clocks: Mutex<HashMap<TrackNamespace, Arc<PeerClock>>>,
+}
+
+impl ClientInner {
+    fn new() -> Self {
+        ClientInner {
+            state: AtomicU8::new(MoqConnectionState::MoqStateDisconnected as u8),
+            url: Mutex::new(None),
+            session: ArcSwapOption::empty(),
+            connection_callback: ArcSwapOption::empty(),
+            announced_namespaces: ShardedMap::new(),
+            announced_tracks: Mutex::new(HashMap::new()),
+            session_task: Mutex::new(None),
+            announce_callback: ArcSwapOption::empty(),
+            announce_task: Mutex::new(None),
+            udp_offload: Mutex::new(UdpOffload::default()),
+            inband_headers: AtomicBool::new(false),
+            auto_resume: AtomicBool::new(false),
+            latency_probe: Mutex::new(None),
+            latency_stats: ArcSwapOption::empty(),
+            peer_clocks: Mutex::new(HashMap::new()),
+        }
+    }
+
+    fn is_connected(&self) -> bool {
+        self.state.load(Ordering::Acquire) == MoqConnectionState::MoqStateConnected as u8
+    }
+
+    /// Whether new publishers and subscriptions use the in-band object header.
+    fn inband_headers(&self) -> bool {
+        self.inband_headers.load(Ordering::Relaxed)
+    }
+
+    /// Whether a session the relay ends is reconnected rather than reported.
+    fn auto_resume(&self) -> bool {
+        self.auto_resume.load(Ordering::Relaxed)
+    }
+
+    /// Whether `session` is still the client's live session, so its end was
+    /// neither the client's doing nor already handled.
+    fn owns_session(&self, session: &std::sync::Weak<SessionHandles>) -> bool {
+        let current = self.session.load_full();
+        self.is_connected() && current.is_some_and(|s| std::ptr::eq(Arc::as_ptr(&s), session.as_ptr()))
+    }
+
+    fn set_state(&self, state: MoqConnectionState) {
+        self.state.store(state as u8, Ordering::Release);
+    }
+
+    /// Clones the session handles without taking a lock; None when not connected.
+    fn session(&self) -> Option<Arc<SessionHandles>> {
+        if !self.is_connected() {
+            return None;
+        }
+        self.session.load_full()
+    }
+
+    fn lock_announced_tracks(&self) -> std::sync::MutexGuard<'_, HashMap<TrackNamespace, serve::TracksReader>> {
+        self.announced_tracks.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Drops an announced namespace, so a resumed session does not announce it again.
+    fn forget_namespace(&self, namespace: &TrackNamespace) {
+        self.announced_namespaces.remove(namespace);
+        self.lock_announced_tracks().remove(namespace);
+    }
+
+    fn forget_namespaces(&self) {
+        self.announced_namespaces.clear();
+        self.lock_announced_tracks().clear();
+    }
+
+    /// Stops the latency probe, if running.
+    fn stop_latency_probe(&self) {
+        let probe = match self.latency_probe.lock() {
+            Ok(mut guard) => guard.take(),
+            Err(poisoned) => poisoned.into_inner().take(),
+        };
+        if let Some(probe) = probe {
+            probe.stop(self);
+        }
+    }
+
+    /// The clock of the publisher of `namespace`, shared by all its subscribers.
+    fn peer_clock(self: &Arc<Self>, namespace: &TrackNamespace) -> Arc<PeerClock> {
+        let mut clocks = self.peer_clocks.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        clocks
+            .entry(namespace.clone())
+            .or_insert_with(|| Arc::new(PeerClock::new(Arc::downgrade(self), namespace.clone())))
+            .clone()
+    }
+
+    /// Stops estimating clock offsets; subscribers of a later session start over.
+    fn stop_clock_sync(&self) {
+        let clocks = std::mem::take(&mut *self.peer_clocks.lock().unwrap_or_else(|poisoned| poisoned.into_inner()));
+        for clock in clocks.into_values() {
+            clock.stop();
+        }
+    }
+
+    /// Invokes the connection callback, if any. Never called with a lock held.
+    fn notify(&self, state: MoqConnectionState) {
+        if let Some(slot) = self.connection_callback.load_full() {
+            if let Some(callback) = slot.callback {
+                let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| unsafe {
+                    callback(slot.user_data as *mut std::ffi::c_void, state);
+                }));
+            }
+        }
+    }
+}
+
+/// Publisher and subscriber handles of an established session.
+///
+/// Both are cheap to clone; callers clone them out of the `ArcSwapOption`
+/// without taking a lock, and hold no lock for the duration of an operation.
+struct SessionHandles {
+    publisher: MoqTransportPublisher,
+    subscriber: MoqTransportSubscriber,
+    transport: Transport,
+}
+
+/// The QUIC connection under a session, kept for its statistics.
+struct Transport {
+    connection: quinn::Connection,
+    socket: ClientSocket,
+}
+
+/// The UDP socket of a client's QUIC endpoint.
+struct ClientSocket {
+    udp: Arc<OffloadSocket>,
+}
+
+/// A C callback together with its user data.
+///
+/// Stored behind an `ArcSwapOption` so the pair is always replaced as a unit
+/// and can be read on hot paths without locking.
+struct CallbackSlot<F> {
+    callback: F,
+    user_data: usize, // Store as usize for Send safety
+}
+
+impl<F> CallbackSlot<F> {
+    fn new(callback: F, user_data: *mut std::ffi::c_void) -> Arc<Self> {
+        Arc::new(CallbackSlot { callback, user_data: user_data as usize })
+    }
+}
+
+/// A hash map split into independently locked shards.
+///
+/// Operations on different keys usually touch different shards, so threads
+/// setting up publishers in different namespaces do not contend.
+struct ShardedMap<K, V> {
+    hasher: RandomState,
+    shards: Box<[Mutex<HashMap<K, V>>]>,
+}
+
+const MAP_SHARD_COUNT: usize = 16;
+
+impl<K: Hash + Eq, V> ShardedMap<K, V> {
+    fn new() -> Self {
+        ShardedMap {
+            hasher: RandomState::new(),
+            shards: (0..MAP_SHARD_COUNT).map(|_| Mutex::new(HashMap::new())).collect(),
+        }
+    }
+
+    /// Locks the shard owning `key`, recovering from poisoning.
+    fn shard(&self, key: &K) -> std::sync::MutexGuard<'_, HashMap<K, V>> {
+        let index = self.hasher.hash_one(key) as usize % self.shards.len();
+        match self.shards[index].lock() {
+            Ok(guard) => guard,
+            Err(poisoned) => {
+                log::warn!("Mutex poisoned in namespace map, recovering");
+                poisoned.into_inner()
+            }
+        }
+    }
+
+    /// Inserts `value` unless `key` is present. Returns false if it was.
+    fn insert_if_absent(&self, key: K, value: V) -> bool {
+        let mut shard = self.shard(&key);
+        if shard.contains_key(&key) {
+            return false;
+        }
+        shard.insert(key, value);
+        true
+    }
+
+    fn remove(&self, key: &K) -> Option<V> {
+        self.shard(key).remove(key)
+    }
+
+    fn clear(&self) {
+        for shard in self.shards.iter() {
+            match shard.lock() {
+                Ok(mut guard) => guard.clear(),
+                Err(poisoned) => poisoned.into_inner().clear(),
+            }
+        }
+    }
 }
 
 #[repr(C)]
 pub struct MoqClient {
-    inner: Arc<Mutex<ClientInner>>,
+    inner: Arc<ClientInner>,
 }
 
 enum PublisherMode {
@@ -146,18 +521,176 @@ struct PublisherInner {
     track_name: String,
     mode: PublisherMode,
     group_id_counter: std::sync::atomic::AtomicU64,
+    // Stamp every object with its publish time (moq_publisher_set_timestamps)
+    timestamps: bool,
+    // Objects may carry the in-band object header, as the client was set up
+    // when the publisher was created
+    inband_headers: bool,
 }
 
 #[repr(C)]
 pub struct MoqPublisher {
     inner: Arc<Mutex<PublisherInner>>,
+    pool: Arc<WriteBufferPool>,
+    // File most recently published from with moq_publish_file_range()
+    file: Mutex<Option<MappedFile>>,
+}
+
+/// Minimum capacity of a pooled publish buffer.
+const WRITE_POOL_BLOCK_SIZE: usize = 64 * 1024;
+
+/// Number of idle buffers a publisher keeps for reuse.
+const WRITE_POOL_MAX_IDLE: usize = 8;
+
+/// Per-publisher pool of write buffers handed out by `moq_publish_acquire()`.
+///
+/// A committed slot is split off its block and frozen into the `Bytes` that
+/// is sent, and the rest of the block goes back to the pool. Once the sent
+/// payload has been dropped by the transport, `BytesMut::reserve` reclaims
+/// the whole allocation, so steady-state publishing does not allocate.
+struct WriteBufferPool {
+    idle: Mutex<Vec<bytes::BytesMut>>,
+}
+
+impl WriteBufferPool {
+    fn new() -> Self {
+        WriteBufferPool { idle: Mutex::new(Vec::new()) }
+    }
+
+    /// Takes a buffer with at least `size` bytes of spare capacity.
+    fn acquire(&self, size: usize) -> bytes::BytesMut {
+        let block = match self.idle.lock() {
+            Ok(mut idle) => idle.pop(),
+            Err(poisoned) => poisoned.into_inner().pop(),
+        };
+        let mut block = block.unwrap_or_default();
+        block.clear();
+        block.reserve(size.max(WRITE_POOL_BLOCK_SIZE));
+        block
+    }
+
+    /// Returns a buffer to the pool, dropping it if enough are already idle.
+    fn release(&self, block: bytes::BytesMut) {
+        let mut idle = match self.idle.lock() {
+            Ok(guard) => guard,
+            Err(poisoned) => poisoned.into_inner(),
+        };
+        if idle.len() < WRITE_POOL_MAX_IDLE {
+            idle.push(block);
+        }
+    }
+
+    #[cfg(test)]
+    fn idle_count(&self) -> usize {
+        match self.idle.lock() {
+            Ok(idle) => idle.len(),
+            Err(poisoned) => poisoned.into_inner().len(),
+        }
+    }
+}
+
+/// Writable publish buffer handed to the application by `moq_publish_acquire()`.
+#[repr(C)]
+pub struct MoqWriteSlot {
+    /// Start of the writable memory (null if the acquire failed)
+    pub data: *mut u8,
+    /// Number of bytes that may be written at `data`
+    pub capacity: usize,
+    /// Library-owned state; must not be modified by the application
+    pub reserved: *mut std::ffi::c_void,
+}
+
+impl MoqWriteSlot {
+    fn empty() -> Self {
+        MoqWriteSlot {
+            data: std::ptr::null_mut(),
+            capacity: 0,
+            reserved: std::ptr::null_mut(),
+        }
+    }
+}
+
+/// Ranges ahead of a sequential reader that are prefetched.
+const FILE_READAHEAD_RANGES: usize = 4;
+
+/// Upper bound on the prefetch window.
+const FILE_READAHEAD_MAX: usize = 16 * 1024 * 1024;
+
+/// Shares one read-only file mapping between the `Bytes` payloads cut from it.
+struct SharedMap(Arc<memmap2::Mmap>);
+
+impl AsRef<[u8]> for SharedMap {
+    fn as_ref(&self) -> &[u8] {
+        &self.0
+    }
+}
+
+/// A file mapped for publishing ranges of it without copying.
+///
+/// The mapping is reused while the file at `path` keeps its size and
+/// modification time; payloads handed to the transport keep it alive.
+struct MappedFile {
+    path: std::path::PathBuf,
+    len: u64,
+    modified: Option<std::time::SystemTime>,
+    map: Arc<memmap2::Mmap>,
+    bytes: bytes::Bytes,
+    // End of the last published range, to recognize sequential access
+    next_offset: usize,
+}
+
+impl MappedFile {
+    fn open(path: &std::path::Path, metadata: &std::fs::Metadata) -> std::io::Result<Self> {
+        let file = std::fs::File::open(path)?;
+        let map = Arc::new(unsafe { memmap2::Mmap::map(&file)? });
+        #[cfg(unix)]
+        let _ = map.advise(memmap2::Advice::Sequential);
+        Ok(MappedFile {
+            path: path.to_path_buf(),
+            len: metadata.len(),
+            modified: metadata.modified().ok(),
+            bytes: bytes::Bytes::from_owner(SharedMap(map.clone())),
+            map,
+            next_offset: 0,
+        })
+    }
+
+    fn is_current(&self, path: &std::path::Path, metadata: &std::fs::Metadata) -> bool {
+        self.path == path && self.len == metadata.len() && self.modified == metadata.modified().ok()
+    }
+
+    /// Returns `offset..offset + len` as a zero-copy slice of the mapping.
+    ///
+    /// When the range continues the previous one, the kernel is asked to read
+    /// the next few ranges ahead so sequential group publishing doesn't stall
+    /// on page faults.
+    fn range(&mut self, offset: usize, len: usize) -> bytes::Bytes {
+        let end = offset + len;
+        if offset == self.next_offset && len > 0 {
+            let window = (len * FILE_READAHEAD_RANGES).min(FILE_READAHEAD_MAX).min(self.bytes.len() - end);
+            if window > 0 {
+                #[cfg(unix)]
+                let _ = self.map.advise_range(memmap2::Advice::WillNeed, end, window);
+            }
+        }
+        self.next_offset = end;
+        self.bytes.slice(offset..end)
+    }
+}
+
+/// State behind `MoqWriteSlot::reserved` between acquire and commit.
+///
+/// It keeps the publisher state alive on its own, so a slot can still be
+/// committed or released safely after its publisher was destroyed.
+struct PendingWrite {
+    publisher: Arc<Mutex<PublisherInner>>,
+    pool: Arc<WriteBufferPool>,
+    block: bytes::BytesMut,
 }
 
 struct SubscriberInner {
     namespace: TrackNamespace,
     track_name: String,
-    data_callback: MoqDataCallback,
-    user_data: usize, // Store as usize for Send safety
     track: Option<serve::TrackReader>,
     // Handle to data reading task
     reader_task: Option<tokio::task::JoinHandle<()>>,
@@ -165,12 +698,74 @@ struct SubscriberInner {
     subscribed: bool,
 }
 
+/// How a subscriber hands received objects to the application.
+#[derive(Copy, Clone)]
+enum DataDelivery {
+    /// One callback invocation per object
+    Object(MoqDataCallback),
+    /// Objects that are ready together are delivered in one invocation
+    Batch(MoqBatchCallback, BatchLimits),
+    /// Objects are reassembled into application buffers and then committed
+    Allocated(MoqAllocFn, MoqCommitFn),
+    /// Objects wait in the subscriber's queue, at most this many, until pulled
+    Queue(usize),
+    /// One callback invocation per object, with its timing
+    Info(MoqObjectCallback),
+}
+
+impl DataDelivery {
+    fn is_set(&self) -> bool {
+        match self {
+            DataDelivery::Object(cb) => cb.is_some(),
+            DataDelivery::Batch(cb, _) => cb.is_some(),
+            DataDelivery::Allocated(alloc, _) => alloc.is_some(),
+            DataDelivery::Queue(_) => true,
+            DataDelivery::Info(cb) => cb.is_some(),
+        }
+    }
+}
+
+/// Bounds on how much a batch may accumulate before it is delivered.
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+struct BatchLimits {
+    max_objects: usize,
+    max_latency: Duration,
+}
+
+impl BatchLimits {
+    /// Builds limits from the C arguments; 0 objects selects the default.
+    fn new(max_objects: usize, max_latency_us: u32) -> Self {
+        BatchLimits {
+            max_objects: if max_objects == 0 { DEFAULT_BATCH_MAX_OBJECTS } else { max_objects },
+            max_latency: Duration::from_micros(max_latency_us as u64),
+        }
+    }
+}
+
+const DEFAULT_BATCH_MAX_OBJECTS: usize = 64;
+
+/// Data callback of a subscriber, shared with its reader task.
+///
+/// The reader task loads the current slot for every object without locking,
+/// so the callback can be replaced while data is flowing and teardown never
+/// waits for a callback to return.
+type DataCallbackCell = ArcSwapOption<CallbackSlot<DataDelivery>>;
+
+/// Optional cache of recent groups, filled by a subscriber's reader task.
+type GroupCacheCell = ArcSwapOption<Mutex<GroupCache>>;
+
+/// Objects waiting to be pulled from a subscriber in queue mode.
+type ReceivedQueue = ObjectQueue<ReceivedObject>;
+
 #[repr(C)]
 pub struct MoqSubscriber {
     inner: Arc<Mutex<SubscriberInner>>,
+    callback: Arc<DataCallbackCell>,
+    cache: Arc<GroupCacheCell>,
+    queue: Arc<ReceivedQueue>,
 }
 
-// Safety: We ensure thread safety through Arc<Mutex<>> wrappers
+// Safety: We ensure thread safety through Arc<Mutex<>> wrappers and atomics
 unsafe impl Send for MoqClient {}
 unsafe impl Send for MoqPublisher {}
 unsafe impl Send for MoqSubscriber {}
@@ -190,6 +785,9 @@ pub enum MoqResultCode {
     MoqErrorInternal = 5,
     MoqErrorUnsupported = 6,
     MoqErrorBufferTooSmall = 7,
+    MoqErrorWouldBlock = 8,
+    /// Best effort: sent, but delivery could not be confirmed
+    MoqErrorUnconfirmed = 9,
 }
 
 #[repr(C)]
@@ -205,6 +803,9 @@ pub enum MoqConnectionState {
     MoqStateConnecting = 1,
     MoqStateConnected = 2,
     MoqStateFailed = 3,
+    /// The relay ended the session: every subscription has ended, and the
+    /// client is reconnecting (`moq_client_set_auto_resume`)
+    MoqStateResuming = 4,
 }
 
 #[repr(C)]
@@ -225,6 +826,36 @@ pub type MoqDataCallback = Option<
     unsafe extern "C" fn(user_data: *mut std::ffi::c_void, data: *const u8, data_len: usize),
 >;
 
+/// A received object as handed to a batch callback.
+///
+/// `data` is only valid during the callback invocation.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct MoqObject {
+    pub data: *const u8,
+    pub data_len: usize,
+    pub group_id: u64,
+    pub object_id: u64,
+}
+
+pub type MoqBatchCallback = Option<
+    unsafe extern "C" fn(user_data: *mut std::ffi::c_void, objects: *const MoqObject, count: usize),
+>;
+
+pub type MoqAllocFn = Option<
+    unsafe extern "C" fn(user_data: *mut std::ffi::c_void, size: usize) -> *mut u8,
+>;
+
+pub type MoqCommitFn = Option<
+    unsafe extern "C" fn(
+        user_data: *mut std::ffi::c_void,
+        buffer: *mut u8,
+        len: usize,
+        group_id: u64,
+        object_id: u64,
+    ),
+>;
+
 pub type MoqTrackCallback = Option<
     unsafe extern "C" fn(
         user_data: *mut std::ffi::c_void,
@@ -233,6 +864,107 @@ pub type MoqTrackCallback = Option<
     ),
 >;
 
+/// One-shot completion of an asynchronous operation; the callee owns `result.message`.
+pub type MoqCompletionCallback =
+    Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void, result: MoqResult)>;
+
+/// One-shot notification that a queued subscriber has data or has ended.
+pub type MoqReadyCallback = Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void)>;
+
+/// Latency of one probe that came back through the relay.
+pub type MoqLatencyCallback =
+    Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void, latency_us: u64, sequence: u64)>;
+
+/// One extension header of an object: a key with a number (even keys) or bytes (odd keys).
+#[repr(C)]
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct MoqExtension {
+    pub key: u64,
+    pub value: u64,
+    pub data: *const u8,
+    pub data_len: usize,
+}
+
+impl MoqExtension {
+    fn of(extension: object_header::Extension) -> Self {
+        MoqExtension {
+            key: extension.key,
+            value: extension.value,
+            data: extension.data.as_ptr(),
+            data_len: extension.data.len(),
+        }
+    }
+}
+
+/// Timing and extension headers of a received object, passed with it to an object callback.
+///
+/// All times are in microseconds. The capture time is on the publisher's
+/// clock; the arrival time is on the subscriber's.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct MoqObjectInfo {
+    pub group_id: u64,
+    pub object_id: u64,
+    pub capture_time_us: u64,
+    pub arrival_time_us: u64,
+    pub clock_offset_us: i64,
+    pub latency_us: u64,
+    pub latency_valid: bool,
+    pub extensions: *const MoqExtension,
+    pub extension_count: usize,
+}
+
+impl Default for MoqObjectInfo {
+    fn default() -> Self {
+        MoqObjectInfo {
+            group_id: 0,
+            object_id: 0,
+            capture_time_us: 0,
+            arrival_time_us: 0,
+            clock_offset_us: 0,
+            latency_us: 0,
+            latency_valid: false,
+            extensions: std::ptr::null(),
+            extension_count: 0,
+        }
+    }
+}
+
+/// Received object together with its timing.
+pub type MoqObjectCallback = Option<
+    unsafe extern "C" fn(
+        user_data: *mut std::ffi::c_void,
+        data: *const u8,
+        data_len: usize,
+        info: *const MoqObjectInfo,
+    ),
+>;
+
+/// An object taken from a queued subscriber with `moq_subscriber_next()`.
+///
+/// `data` stays valid until the object is passed to `moq_object_release()`.
+#[repr(C)]
+#[derive(Debug)]
+pub struct MoqReceivedObject {
+    pub data: *const u8,
+    pub data_len: usize,
+    pub group_id: u64,
+    pub object_id: u64,
+    pub reserved: *mut std::ffi::c_void,
+}
+
+impl MoqReceivedObject {
+    fn empty() -> Self {
+        MoqReceivedObject {
+            data: std::ptr::null(),
+            data_len: 0,
+            group_id: 0,
+            object_id: 0,
+            reserved: std::ptr::null_mut(),
+        }
+    }
+}
+
 /* ───────────────────────────────────────────────
  * Track Discovery (Catalog-Based)
  * ─────────────────────────────────────────────── */
@@ -336,41 +1068,254 @@ pub extern "C" fn moq_init() -> bool {
     true
 }
 
-/* ───────────────────────────────────────────────
- * Client Management
- * ─────────────────────────────────────────────── */
-
-/// Creates a new MoQ client instance.
+/// Shuts the library down so that it can be unloaded or started again.
 ///
-/// # Returns
-/// A pointer to the newly created client, or null on failure.
-/// The client must be destroyed with `moq_client_destroy()` when no longer needed.
+/// Closes the session of every client that has not been destroyed, stops the
+/// runtime, dropping all of its tasks, and waits up to `timeout_ms` for its
+/// threads to exit. Sockets, buffers and threads are released; client handles
+/// stay valid, disconnected, and must still be destroyed. `moq_init()` and the
+/// rest of the API work again afterwards, on a fresh runtime. The rustls
+/// crypto provider stays installed: it holds no resources, and rustls offers
+/// no way to remove it.
 ///
-/// # Thread Safety
-/// This function is thread-safe and can be called from any thread.
+/// # Safety
+/// - No other library call may run concurrently
+/// - Must not be called from a library callback, or any other thread of the
+///   library's runtime; threads of the host's own runtimes may call it
+///
+/// # Parameters
+/// - `timeout_ms`: Longest time to wait for the runtime's threads; 0 does not wait
+///
+/// # Returns
+/// - `MoqOk` once every runtime thread has exited
+/// - `MoqErrorTimeout` if some had not exited by the timeout, as is usual for
+///   a timeout of 0; they exit when their blocking work returns
+/// - `MoqErrorInvalidArgument` if called from a library runtime thread
 #[no_mangle]
-pub extern "C" fn moq_client_create() -> *mut MoqClient {
+pub extern "C" fn moq_shutdown(timeout_ms: u64) -> MoqResult {
     std::panic::catch_unwind(|| {
-        let client = MoqClient {
-            inner: Arc::new(Mutex::new(ClientInner {
-                connected: false,
-                url: None,
-                session: None,
-                publisher: None,
-                subscriber: None,
-                connection_callback: None,
-                connection_user_data: 0,
-                announced_namespaces: HashMap::new(),
-                session_task: None,
-                announce_callback: None,
-                announce_user_data: 0,
-                announce_task: None,
-            })),
-        };
-        Box::into_raw(Box::new(client))
-    }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_client_create");
-        set_last_error("Internal panic occurred in moq_client_create".to_string());
+        if on_library_thread() {
+            set_last_error("moq_shutdown cannot be called from a library callback or runtime thread".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "moq_shutdown cannot be called from a library callback or runtime thread",
+            );
+        }
+
+        // Upgraded first: disconnecting runs connection callbacks, which may destroy clients
+        let clients: Vec<Arc<ClientInner>> = CLIENTS
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .iter()
+            .filter_map(std::sync::Weak::upgrade)
+            .collect();
+        for inner in &clients {
+            if let Some(session) = inner.session.swap(None) {
+                session.transport.connection.close(quinn::VarInt::from_u32(0x100), b"shutdown");
+            }
+            let announce_task = inner.announce_task.lock().unwrap_or_else(|poisoned| poisoned.into_inner()).take();
+            if let Some(task) = announce_task {
+                task.abort();
+            }
+            disconnect(inner, MoqConnectionState::MoqStateDisconnected);
+        }
+        drop(clients);
+        // Prewarmed sessions and cached certificates go too; a restart starts cold
+        let prewarmed = std::mem::take(&mut *PREWARMED.lock().unwrap_or_else(|poisoned| poisoned.into_inner()));
+        for (_, dialed) in prewarmed {
+            dialed.transport.connection.close(quinn::VarInt::from_u32(0x100), b"shutdown");
+        }
+        *ROOT_CERTS.lock().unwrap_or_else(|poisoned| poisoned.into_inner()) = None;
+
+        if RUNTIME.shutdown(Duration::from_millis(timeout_ms)) {
+            log::info!("MoQ FFI shut down");
+            make_ok_result()
+        } else {
+            set_last_error("Runtime threads were still busy at the timeout".to_string());
+            make_error_result(MoqResultCode::MoqErrorTimeout, "Runtime threads were still busy at the timeout")
+        }
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_shutdown");
+        set_last_error("Internal panic occurred in moq_shutdown".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/// Does the work of a first connect ahead of time.
+///
+/// Builds the runtime and its worker threads, installs the crypto provider,
+/// reads the platform's root certificates and resolves the host of each URL,
+/// which fills the system resolver's cache where the platform has one. All
+/// URLs are warmed concurrently; the call returns once all are done. Call it
+/// from a loading thread during startup so that the first `moq_connect()`
+/// only pays for the handshakes. See `moq_prewarm_ex()` to open the
+/// sessions as well.
+///
+/// # Safety
+/// - `urls` must point to `url_count` valid null-terminated C strings, or be
+///   null if `url_count` is 0
+/// - This function is thread-safe
+/// - Must not be called from a library callback
+///
+/// # Returns
+/// - `MoqOk` once everything was warmed
+/// - `MoqErrorInvalidArgument` if `urls` is null or a URL is not an https:// URL
+/// - `MoqErrorConnectionFailed` if a host could not be resolved; the other
+///   URLs are still warmed
+#[no_mangle]
+pub unsafe extern "C" fn moq_prewarm(urls: *const *const c_char, url_count: usize) -> MoqResult {
+    std::panic::catch_unwind(|| prewarm(urls, url_count, false)).unwrap_or_else(|_| {
+        log::error!("Panic in moq_prewarm");
+        set_last_error("Internal panic occurred in moq_prewarm".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/// Like `moq_prewarm()`, and with `preconnect` also opens an idle session to
+/// each URL.
+///
+/// The first `moq_connect()` to a URL then takes over its session instead of
+/// dialing, skipping the QUIC, TLS and MoQ handshakes, provided the session
+/// is still open and the client uses the default UDP offload settings.
+/// Sessions send a keep-alive every 10 s while they wait; those not taken
+/// are closed by `moq_shutdown()`. Warming a URL that already has an idle
+/// session keeps that session.
+///
+/// # Safety
+/// Same as `moq_prewarm()`.
+///
+/// # Returns
+/// As `moq_prewarm()`, and `MoqErrorConnectionFailed` if a session could not
+/// be opened within the connect timeout.
+#[no_mangle]
+pub unsafe extern "C" fn moq_prewarm_ex(urls: *const *const c_char, url_count: usize, preconnect: bool) -> MoqResult {
+    std::panic::catch_unwind(|| prewarm(urls, url_count, preconnect)).unwrap_or_else(|_| {
+        log::error!("Panic in moq_prewarm_ex");
+        set_last_error("Internal panic occurred in moq_prewarm_ex".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+unsafe fn prewarm(urls: *const *const c_char, url_count: usize, preconnect: bool) -> MoqResult {
+    ensure_crypto_init();
+    if urls.is_null() && url_count > 0 {
+        set_last_error("URLs are null".to_string());
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "URLs are null");
+    }
+
+    let mut targets = Vec::with_capacity(url_count);
+    for index in 0..url_count {
+        let url = *urls.add(index);
+        let parsed = (!url.is_null())
+            .then(|| CStr::from_ptr(url).to_str().ok())
+            .flatten()
+            .filter(|url_str| url_str.starts_with("https://"))
+            .and_then(|url_str| Some((url::Url::parse(url_str).ok()?, url_str.to_string())));
+        match parsed {
+            Some(target) => targets.push(target),
+            None => {
+                let message = format!("URL {} is not a valid https:// URL", index);
+                set_last_error(message.clone());
+                return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &message);
+            }
+        }
+    }
+
+    let runtime = RUNTIME.handle();
+    let failures: Vec<String> = RUNTIME.block_on(async {
+        let certs = runtime.spawn_blocking(root_certs);
+        let warmed = futures::future::join_all(
+            targets.iter().map(|(parsed_url, url_str)| prewarm_url(parsed_url, url_str, preconnect)),
+        )
+        .await;
+        let _ = certs.await;
+        warmed.into_iter().filter_map(Result::err).collect()
+    });
+
+    if failures.is_empty() {
+        make_ok_result()
+    } else {
+        let message = failures.join("; ");
+        set_last_error(message.clone());
+        make_error_result(MoqResultCode::MoqErrorConnectionFailed, &message)
+    }
+}
+
+/// Resolves the host of one URL, or with `preconnect` opens an idle session
+/// to it, which resolves the host on the way.
+async fn prewarm_url(parsed_url: &url::Url, url_str: &str, preconnect: bool) -> Result<(), String> {
+    if !preconnect {
+        let host = parsed_url.host_str().unwrap_or_default().to_string();
+        let port = parsed_url.port_or_known_default().unwrap_or(443);
+        let resolved = tokio::task::spawn_blocking(move || {
+            use std::net::ToSocketAddrs;
+            (host.as_str(), port).to_socket_addrs().map(|addrs| addrs.count())
+        })
+        .await;
+        return match resolved {
+            Ok(Ok(count)) if count > 0 => Ok(()),
+            Ok(Ok(_)) => Err(format!("No addresses for {}", url_str)),
+            Ok(Err(e)) => Err(format!("Could not resolve {}: {}", url_str, e)),
+            Err(e) => Err(format!("Could not resolve {}: {}", url_str, e)),
+        };
+    }
+
+    let open = PREWARMED
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner())
+        .iter()
+        .any(|(url, dialed)| url == url_str && dialed.transport.connection.close_reason().is_none());
+    if open {
+        return Ok(());
+    }
+    let dialed = timeout(
+        Duration::from_secs(CONNECT_TIMEOUT_SECS),
+        dial(parsed_url, url_str, UdpOffload::default(), Some(PREWARM_KEEP_ALIVE)),
+    )
+    .await
+    .map_err(|_| format!("Connection timeout after {} seconds to {}", CONNECT_TIMEOUT_SECS, url_str))??;
+    let mut prewarmed = PREWARMED.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+    prewarmed.retain(|(url, _)| url != url_str);
+    prewarmed.push((url_str.to_string(), dialed));
+    log::info!("Prewarmed a session to {}", url_str);
+    Ok(())
+}
+
+/* ───────────────────────────────────────────────
+ * Client Management
+ * ─────────────────────────────────────────────── */
+
+/// Creates a new MoQ client instance.
+///
+/// # Returns
+/// A pointer to the newly created client, or null on failure.
+/// The client must be destroyed with `moq_client_destroy()` when no longer needed.
+///
+/// # Thread Safety
+/// This function is thread-safe and can be called from any thread.
+#[no_mangle]
+pub extern "C" fn moq_client_create() -> *mut MoqClient {
+    std::panic::catch_unwind(|| {
+        let client = MoqClient {
+            inner: Arc::new(ClientInner::new()),
+        };
+        let mut clients = CLIENTS.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        clients.retain(|client| client.strong_count() > 0);
+        clients.push(Arc::downgrade(&client.inner));
+        drop(clients);
+        Box::into_raw(Box::new(client))
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_client_create");
+        set_last_error("Internal panic occurred in moq_client_create".to_string());
         std::ptr::null_mut()
     })
 }
@@ -393,18 +1338,24 @@ pub unsafe extern "C" fn moq_client_destroy(client: *mut MoqClient) {
             let client_box = Box::from_raw(client);
             
             // Clean up resources properly
-            if let Ok(mut inner) = client_box.inner.lock() {
-                // Abort session task if running
-                if let Some(task) = inner.session_task.take() {
+            let inner = &client_box.inner;
+            // Abort session and announce listener tasks if running
+            if let Ok(mut task) = inner.session_task.lock() {
+                if let Some(task) = task.take() {
+                    task.abort();
+                }
+            }
+            if let Ok(mut task) = inner.announce_task.lock() {
+                if let Some(task) = task.take() {
                     task.abort();
                 }
-                // Clear all resources
-                inner.announced_namespaces.clear();
-                inner.publisher = None;
-                inner.subscriber = None;
-                inner.session = None;
-                inner.connected = false;
             }
+            inner.stop_latency_probe();
+            inner.stop_clock_sync();
+            // Clear all resources
+            inner.set_state(MoqConnectionState::MoqStateDisconnected);
+            inner.forget_namespaces();
+            inner.session.store(None);
             
             drop(client_box);
         }
@@ -457,39 +1408,51 @@ unsafe fn moq_connect_impl(
     connection_callback: MoqConnectionCallback,
     user_data: *mut std::ffi::c_void,
 ) -> MoqResult {
+    let (client_inner, parsed_url, url_str) = match begin_connect(client, url, connection_callback, user_data) {
+        Ok(prepared) => prepared,
+        Err(result) => return result,
+    };
+
+    let result = RUNTIME.block_on(establish_session(client_inner.clone(), parsed_url, url_str.clone()));
+
+    log::debug!("🔍 [CONNECT] block_on completed, processing result");
+    finish_connect(&client_inner, &url_str, result, connection_callback, user_data)
+}
+
+/// Validates the arguments of a connect call, stores the connection callback
+/// and reports the Connecting state.
+///
+/// Returns the client state, parsed URL and URL string, or the result to hand
+/// back to the caller if the connection cannot be attempted.
+unsafe fn begin_connect(
+    client: *mut MoqClient,
+    url: *const c_char,
+    connection_callback: MoqConnectionCallback,
+    user_data: *mut std::ffi::c_void,
+) -> Result<(Arc<ClientInner>, url::Url, String), MoqResult> {
     // Ensure crypto provider is initialized before any TLS/QUIC operations
     ensure_crypto_init();
     
     if client.is_null() || url.is_null() {
         set_last_error("Client or URL is null".to_string());
-        return make_error_result(
+        return Err(make_error_result(
             MoqResultCode::MoqErrorInvalidArgument,
             "Client or URL is null",
-        );
+        ));
     }
 
     let url_str = match CStr::from_ptr(url).to_str() {
         Ok(s) => s.to_string(),
         Err(_) => {
             set_last_error("Invalid UTF-8 in URL".to_string());
-            return make_error_result(
+            return Err(make_error_result(
                 MoqResultCode::MoqErrorInvalidArgument,
                 "Invalid UTF-8 in URL",
-            );
+            ));
         }
     };
 
     let client_ref = &*client;
-    let mut inner = match client_ref.inner.lock() {
-        Ok(inner) => inner,
-        Err(_) => {
-            set_last_error("Failed to lock client mutex".to_string());
-            return make_error_result(
-                MoqResultCode::MoqErrorInternal,
-                "Failed to lock client mutex",
-            );
-        }
-    };
 
     // Validate URL format - must be HTTPS for WebTransport over QUIC
     // Draft 07 (CloudFlare): WebTransport over QUIC only (current priority)
@@ -503,46 +1466,230 @@ unsafe fn moq_connect_impl(
     // - Reference: https://github.com/moq-wg/moq-transport
     if !url_str.starts_with("https://") {
         set_last_error(format!("Invalid URL scheme: {}", url_str));
-        return make_error_result(
+        return Err(make_error_result(
             MoqResultCode::MoqErrorInvalidArgument,
             "URL must start with https:// (WebTransport over QUIC)",
-        );
+        ));
     }
 
     // Store connection callback
-    inner.connection_callback = connection_callback;
-    inner.connection_user_data = user_data as usize;
-    inner.url = Some(url_str.clone());
+    let inner = &client_ref.inner;
+    inner.connection_callback.store(Some(CallbackSlot::new(connection_callback, user_data)));
+    match inner.url.lock() {
+        Ok(mut url) => *url = Some(url_str.clone()),
+        Err(poisoned) => *poisoned.into_inner() = Some(url_str.clone()),
+    }
 
     // Notify connecting state (with panic protection)
-    if let Some(callback) = connection_callback {
-        let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
-            callback(user_data, MoqConnectionState::MoqStateConnecting);
-        }));
-    }
+    inner.set_state(MoqConnectionState::MoqStateConnecting);
+    inner.notify(MoqConnectionState::MoqStateConnecting);
 
     // Parse URL
     let parsed_url = match url::Url::parse(&url_str) {
         Ok(u) => u,
         Err(e) => {
             set_last_error(format!("Failed to parse URL: {}", e));
+            inner.set_state(MoqConnectionState::MoqStateFailed);
             if let Some(callback) = connection_callback {
                 let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
                     callback(user_data, MoqConnectionState::MoqStateFailed);
                 }));
             }
-            return make_error_result(
+            return Err(make_error_result(
                 MoqResultCode::MoqErrorInvalidArgument,
                 "Invalid URL format",
-            );
+            ));
         }
     };
 
-    // CRITICAL: Drop the mutex guard before async operations to prevent deadlock
-    // The async block needs to be able to lock the mutex to update state
-    let client_inner = client_ref.inner.clone();
-    drop(inner); // Explicitly drop the MutexGuard
-    
+    Ok((client_ref.inner.clone(), parsed_url, url_str))
+}
+
+/// Creates the client's QUIC endpoint on a UDP socket with the given offloads.
+fn create_client_endpoint(
+    bind_addr: std::net::SocketAddr,
+    offload: UdpOffload,
+) -> std::io::Result<(quinn::Endpoint, ClientSocket)> {
+    let socket = ClientSocket { udp: Arc::new(OffloadSocket::bind(bind_addr, offload)?) };
+    log::debug!(
+        "UDP socket on {}: up to {} datagrams per send, {} per receive",
+        bind_addr,
+        socket.udp.gso_segments(),
+        socket.udp.gro_segments()
+    );
+    let endpoint = quinn::Endpoint::new_with_abstract_socket(
+        quinn::EndpointConfig::default(),
+        None,
+        socket.udp.clone(),
+        Arc::new(quinn::TokioRuntime),
+    )?;
+    Ok((endpoint, socket))
+}
+
+
+/// The platform's root certificates, read on first use and kept until
+/// moq_shutdown(): reading the native store can take longer than the rest of
+/// connection setup.
+fn root_certs() -> Arc<rustls::RootCertStore> {
+    let mut cached = ROOT_CERTS.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+    cached
+        .get_or_insert_with(|| {
+            let mut roots = rustls::RootCertStore::empty();
+            let native_certs = rustls_native_certs::load_native_certs();
+
+            // Log any errors that occurred while loading certificates
+            for err in native_certs.errors {
+                log::warn!("Failed to load native cert: {:?}", err);
+            }
+
+            // Add valid certificates to the store
+            for cert in native_certs.certs {
+                if let Err(e) = roots.add(cert) {
+                    log::warn!("Failed to add root cert: {:?}", e);
+                }
+            }
+            Arc::new(roots)
+        })
+        .clone()
+}
+
+/// Takes the session moq_prewarm_ex() opened to `url_str`, if it is still
+/// open and was dialed the way a client with `offload` would dial it.
+fn take_prewarmed(url_str: &str, offload: UdpOffload) -> Option<Dialed> {
+    if offload != UdpOffload::default() {
+        return None;
+    }
+    let mut prewarmed = PREWARMED.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+    let index = prewarmed.iter().position(|(url, _)| url == url_str)?;
+    let (_, dialed) = prewarmed.swap_remove(index);
+    match dialed.transport.connection.close_reason() {
+        None => Some(dialed),
+        Some(reason) => {
+            log::debug!("Session prewarmed for {} has closed ({}), dialing again", url_str, reason);
+            None
+        }
+    }
+}
+
+/// A WebTransport session with the MoQ handshake done, not yet running.
+struct Dialed {
+    session: Session,
+    publisher: MoqTransportPublisher,
+    subscriber: MoqTransportSubscriber,
+    transport: Transport,
+}
+
+/// Opens a QUIC connection to `parsed_url`, then the WebTransport and MoQ
+/// sessions on it. `keep_alive` keeps an idle connection from timing out.
+async fn dial(
+    parsed_url: &url::Url,
+    url_str: &str,
+    offload: UdpOffload,
+    keep_alive: Option<Duration>,
+) -> Result<Dialed, String> {
+    log::debug!("🔍 [CONNECT] Creating endpoint");
+    // Create quinn endpoint for WebTransport over QUIC
+    // Try IPv6 first, fall back to IPv4 if IPv6 is unavailable
+    // This handles systems where IPv6 is disabled or not supported
+    let (mut endpoint, socket) = match "[::]:0".parse::<std::net::SocketAddr>() {
+        Ok(ipv6_addr) => {
+            // Try to create IPv6 endpoint
+            match create_client_endpoint(ipv6_addr, offload) {
+                Ok(ep) => {
+                    log::debug!("Created IPv6 endpoint successfully");
+                    ep
+                }
+                Err(e) => {
+                    // IPv6 not available, fall back to IPv4
+                    log::debug!("IPv6 endpoint creation failed ({}), falling back to IPv4", e);
+                    let ipv4_addr = "0.0.0.0:0".parse()
+                        .map_err(|e| format!("Failed to parse IPv4 bind address: {}", e))?;
+                    create_client_endpoint(ipv4_addr, offload)
+                        .map_err(|e| format!("Failed to create IPv4 endpoint: {}", e))?
+                }
+            }
+        }
+        // Note: This branch is defensive programming - "[::]:0" should always parse successfully
+        Err(_) => {
+            log::debug!("IPv6 address parsing failed (unexpected), using IPv4");
+            let ipv4_addr = "0.0.0.0:0".parse()
+                .map_err(|e| format!("Failed to parse IPv4 bind address: {}", e))?;
+            create_client_endpoint(ipv4_addr, offload)
+                .map_err(|e| format!("Failed to create IPv4 endpoint: {}", e))?
+        }
+    };
+
+    // Configure TLS with native root certificates
+    let mut client_crypto = rustls::ClientConfig::builder()
+        .with_root_certificates(root_certs())
+        .with_no_client_auth();
+
+    // Set ALPN protocols for WebTransport over HTTP/3
+    // This is CRITICAL for protocol negotiation
+    client_crypto.alpn_protocols = vec![web_transport_quinn::ALPN.to_vec()];
+
+    let mut client_config = quinn::ClientConfig::new(std::sync::Arc::new(
+        quinn::crypto::rustls::QuicClientConfig::try_from(client_crypto)
+            .map_err(|e| format!("Crypto config error: {}", e))?
+    ));
+
+    // Configure transport - enable datagrams for MoQ datagram delivery
+    let mut transport_config = quinn::TransportConfig::default();
+    transport_config.max_concurrent_bidi_streams(100u32.into());
+    transport_config.max_concurrent_uni_streams(100u32.into());
+    transport_config.datagram_receive_buffer_size(Some(1024 * 1024)); // 1MB buffer
+    transport_config.datagram_send_buffer_size(1024 * 1024); // 1MB send buffer
+    transport_config.keep_alive_interval(keep_alive);
+    client_config.transport_config(std::sync::Arc::new(transport_config));
+
+    endpoint.set_default_client_config(client_config);
+
+    log::debug!("🔍 [CONNECT] Endpoint configured, starting WebTransport connection");
+
+    // Connect via WebTransport (HTTP/3 over QUIC)
+    #[cfg(feature = "with_moq_draft07")]
+    log::info!("Connecting via WebTransport over QUIC to {} (Draft 07 - CloudFlare)", url_str);
+
+    #[cfg(feature = "with_moq")]
+    log::info!("Connecting via WebTransport over QUIC to {} (Draft 14 - Latest)", url_str);
+
+    use web_transport_quinn::connect as wt_connect;
+    log::debug!("🔍 [CONNECT] Calling wt_connect...");
+    let wt_session_quinn = wt_connect(&endpoint, parsed_url)
+        .await
+        .map_err(|e| {
+            log::debug!("🔍 [CONNECT] WebTransport connection failed: {}", e);
+            format!("Failed to connect via WebTransport: {}", e)
+        })?;
+
+    log::debug!("🔍 [CONNECT] wt_connect succeeded, converting to generic session");
+    let transport = Transport { connection: (*wt_session_quinn).clone(), socket };
+    // Convert to generic web_transport::Session
+    let wt_session = web_transport::Session::from(wt_session_quinn);
+
+    log::info!("WebTransport session established to {}", url_str);
+    log::debug!("🔍 [CONNECT] Starting MoQ session handshake");
+
+    // Establish MoQ session over the transport
+    let (moq_session, publisher, subscriber) = Session::connect(wt_session)
+        .await
+        .map_err(|e| {
+            log::debug!("🔍 [CONNECT] MoQ session establishment failed: {}", e);
+            format!("Failed to establish MoQ session: {}", e)
+        })?;
+
+    log::info!("MoQ session established");
+    log::debug!("🔍 [CONNECT] MoQ session handshake complete");
+    Ok(Dialed { session: moq_session, publisher, subscriber, transport })
+}
+
+/// Establishes the WebTransport and MoQ sessions of a client, within the
+/// connect timeout, and reports the Connected state on success.
+async fn establish_session(
+    client_inner: Arc<ClientInner>,
+    parsed_url: url::Url,
+    url_str: String,
+) -> Result<(), String> {
     // Establish WebTransport connection over QUIC asynchronously
     // Priority: Draft 07 (CloudFlare production relay)
     // Both Draft 07 and Draft 14 use WebTransport over QUIC
@@ -554,158 +1701,133 @@ unsafe fn moq_connect_impl(
     //    - https:// -> WebTransport (current implementation)
     //    - quic:// -> Raw QUIC (to be implemented)
     // 3. Both should result in a compatible session for moq-transport
-    let url_str_clone = url_str.clone();
-    
-    log::debug!("🔍 [CONNECT] Starting connection to {}", url_str_clone);
-    
-    let result = RUNTIME.block_on(async move {
-        log::debug!("🔍 [CONNECT] Inside runtime.block_on, wrapping with timeout");
-        // Wrap the entire connection process in a timeout
-        match timeout(Duration::from_secs(CONNECT_TIMEOUT_SECS), async {
-            log::debug!("🔍 [CONNECT] Inside timeout wrapper, creating endpoint");
-            // Create quinn endpoint for WebTransport over QUIC
-            // Try IPv6 first, fall back to IPv4 if IPv6 is unavailable
-            // This handles systems where IPv6 is disabled or not supported
-            let mut endpoint = match "[::]:0".parse::<std::net::SocketAddr>() {
-                Ok(ipv6_addr) => {
-                    // Try to create IPv6 endpoint
-                    match quinn::Endpoint::client(ipv6_addr) {
-                        Ok(ep) => {
-                            log::debug!("Created IPv6 endpoint successfully");
-                            ep
-                        }
-                        Err(e) => {
-                            // IPv6 not available, fall back to IPv4
-                            log::debug!("IPv6 endpoint creation failed ({}), falling back to IPv4", e);
-                            let ipv4_addr = "0.0.0.0:0".parse()
-                                .map_err(|e| format!("Failed to parse IPv4 bind address: {}", e))?;
-                            quinn::Endpoint::client(ipv4_addr)
-                                .map_err(|e| format!("Failed to create IPv4 endpoint: {}", e))?
-                        }
-                    }
-                }
-                // Note: This branch is defensive programming - "[::]:0" should always parse successfully
-                Err(_) => {
-                    log::debug!("IPv6 address parsing failed (unexpected), using IPv4");
-                    let ipv4_addr = "0.0.0.0:0".parse()
-                        .map_err(|e| format!("Failed to parse IPv4 bind address: {}", e))?;
-                    quinn::Endpoint::client(ipv4_addr)
-                        .map_err(|e| format!("Failed to create IPv4 endpoint: {}", e))?
-                }
-            };
+    log::debug!("🔍 [CONNECT] Starting connection to {}", url_str);
 
-        // Configure TLS with native root certificates  
-        let mut roots = rustls::RootCertStore::empty();
-        let native_certs = rustls_native_certs::load_native_certs();
-        
-        // Log any errors that occurred while loading certificates
-        for err in native_certs.errors {
-            log::warn!("Failed to load native cert: {:?}", err);
-        }
-        
-        // Add valid certificates to the store
-        for cert in native_certs.certs {
-            if let Err(e) = roots.add(cert) {
-                log::warn!("Failed to add root cert: {:?}", e);
+    // Wrap the entire connection process in a timeout
+    match timeout(Duration::from_secs(CONNECT_TIMEOUT_SECS), async {
+        let offload = match client_inner.udp_offload.lock() {
+            Ok(offload) => *offload,
+            Err(poisoned) => *poisoned.into_inner(),
+        };
+        let Dialed { session: moq_session, publisher, subscriber, transport } = match take_prewarmed(&url_str, offload) {
+            Some(dialed) => {
+                log::info!("Using the session prewarmed for {}", url_str);
+                dialed
             }
-        }
-
-        let mut client_crypto = rustls::ClientConfig::builder()
-            .with_root_certificates(roots)
-            .with_no_client_auth();
-        
-        // Set ALPN protocols for WebTransport over HTTP/3
-        // This is CRITICAL for protocol negotiation
-        client_crypto.alpn_protocols = vec![web_transport_quinn::ALPN.to_vec()];
-
-        let mut client_config = quinn::ClientConfig::new(std::sync::Arc::new(
-            quinn::crypto::rustls::QuicClientConfig::try_from(client_crypto)
-                .map_err(|e| format!("Crypto config error: {}", e))?
-        ));
-        
-        // Configure transport - enable datagrams for MoQ datagram delivery
-        let mut transport_config = quinn::TransportConfig::default();
-        transport_config.max_concurrent_bidi_streams(100u32.into());
-        transport_config.max_concurrent_uni_streams(100u32.into());
-        transport_config.datagram_receive_buffer_size(Some(1024 * 1024)); // 1MB buffer
-        transport_config.datagram_send_buffer_size(1024 * 1024); // 1MB send buffer
-        client_config.transport_config(std::sync::Arc::new(transport_config));
-        
-        endpoint.set_default_client_config(client_config);
-
-        log::debug!("🔍 [CONNECT] Endpoint configured, starting WebTransport connection");
-        
-        // Connect via WebTransport (HTTP/3 over QUIC)
-        #[cfg(feature = "with_moq_draft07")]
-        log::info!("Connecting via WebTransport over QUIC to {} (Draft 07 - CloudFlare)", url_str_clone);
-        
-        #[cfg(feature = "with_moq")]
-        log::info!("Connecting via WebTransport over QUIC to {} (Draft 14 - Latest)", url_str_clone);
-        
-        use web_transport_quinn::connect as wt_connect;
-        log::debug!("🔍 [CONNECT] Calling wt_connect...");
-        let wt_session_quinn = wt_connect(&endpoint, &parsed_url)
-            .await
-            .map_err(|e| {
-                log::debug!("🔍 [CONNECT] WebTransport connection failed: {}", e);
-                format!("Failed to connect via WebTransport: {}", e)
-            })?;
-        
-        log::debug!("🔍 [CONNECT] wt_connect succeeded, converting to generic session");
-        // Convert to generic web_transport::Session
-        let wt_session = web_transport::Session::from(wt_session_quinn);
-
-        log::info!("WebTransport session established to {}", url_str_clone);
-        log::debug!("🔍 [CONNECT] Starting MoQ session handshake");
-
-        // Establish MoQ session over the transport
-        let (moq_session, publisher, subscriber) = Session::connect(wt_session)
-            .await
-            .map_err(|e| {
-                log::debug!("🔍 [CONNECT] MoQ session establishment failed: {}", e);
-                format!("Failed to establish MoQ session: {}", e)
-            })?;
-
-        log::info!("MoQ session established");
-        log::debug!("🔍 [CONNECT] MoQ session handshake complete");
-
-        // Store session and publisher/subscriber
-        let mut inner = client_inner.lock()
-            .map_err(|e| format!("Failed to lock client mutex: {}", e))?;
-        inner.publisher = Some(publisher);
-        inner.subscriber = Some(subscriber);
-        inner.connected = true;
+            None => dial(&parsed_url, &url_str, offload, None).await?,
+        };
 
-        // Notify connection success via callback (with panic protection)
-        if let Some(callback) = inner.connection_callback {
-            let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
-                callback(inner.connection_user_data as *mut std::ffi::c_void, MoqConnectionState::MoqStateConnected);
-            }));
-        }
+        // Publish the session handles before flipping the state so any thread
+        // that observes Connected also sees them
+        let handles = Arc::new(SessionHandles { publisher, subscriber, transport });
+        client_inner.session.store(Some(handles.clone()));
 
-        // Spawn task to run the session
+        // Spawn task to run the session, and to resume or report its end
+        // if the relay ends it
+        let client = Arc::downgrade(&client_inner);
+        let session = Arc::downgrade(&handles);
+        let (parsed_url, url_str) = (parsed_url.clone(), url_str.clone());
         let task = RUNTIME.spawn(async move {
-            if let Err(e) = moq_session.run().await {
+            let result = moq_session.run().await;
+            if let Err(e) = &result {
                 log::error!("MoQ session error: {}", e);
             }
+            let Some(client) = client.upgrade() else { return };
+            if client.auto_resume() {
+                resume_session(client, session, parsed_url, url_str).await;
+            } else if client.owns_session(&session) {
+                log::warn!("Relay ended the session to {}", url_str);
+                let state = if result.is_ok() {
+                    MoqConnectionState::MoqStateDisconnected
+                } else {
+                    MoqConnectionState::MoqStateFailed
+                };
+                // Aborts this very task, which has nothing left to await
+                disconnect(&client, state);
+            }
         });
-        inner.session_task = Some(task);
+        match client_inner.session_task.lock() {
+            Ok(mut slot) => *slot = Some(task),
+            Err(poisoned) => *poisoned.into_inner() = Some(task),
+        }
+
+        client_inner.set_state(MoqConnectionState::MoqStateConnected);
+
+        // Notify connection success via callback (with panic protection)
+        client_inner.notify(MoqConnectionState::MoqStateConnected);
 
         Ok::<(), String>(())
-        }).await {
-            Ok(result) => {
-                log::debug!("🔍 [CONNECT] Timeout wrapper completed with result");
-                result
+    }).await {
+        Ok(result) => {
+            log::debug!("🔍 [CONNECT] Timeout wrapper completed with result");
+            result
+        }
+        Err(_) => {
+            log::warn!("🔍 [CONNECT] Connection timed out after {} seconds", CONNECT_TIMEOUT_SECS);
+            Err(format!("Connection timeout after {} seconds", CONNECT_TIMEOUT_SECS))
+        }
+    }
+}
+
+/// Reconnects a client whose session the relay ended, typically because it
+/// is going away for maintenance, and announces its namespaces again. Only
+/// for clients that opted in with `moq_client_set_auto_resume()`.
+///
+/// Does nothing if the session was closed by the client or already replaced.
+/// Publishers keep their tracks across the switch; subscriptions end with the
+/// old session and are taken out again by the application once it sees
+/// Connected. Boxed because it runs inside the task `establish_session` spawns.
+fn resume_session(
+    client: Arc<ClientInner>,
+    ended: std::sync::Weak<SessionHandles>,
+    parsed_url: url::Url,
+    url_str: String,
+) -> futures::future::BoxFuture<'static, ()> {
+    Box::pin(async move {
+        if !client.owns_session(&ended) {
+            return;
+        }
+        log::warn!("Relay ended the session and with it every subscription, reconnecting to {}", url_str);
+        client.set_state(MoqConnectionState::MoqStateResuming);
+        client.session.store(None);
+        client.stop_latency_probe();
+        client.stop_clock_sync();
+        // Not Connecting: the application has to know its subscriptions are gone
+        client.notify(MoqConnectionState::MoqStateResuming);
+
+        let mut backoff = RESUME_BACKOFF;
+        for attempt in 1..=RESUME_ATTEMPTS {
+            match establish_session(client.clone(), parsed_url.clone(), url_str.clone()).await {
+                Ok(()) => {
+                    let Some(session) = client.session() else { return };
+                    let tracks: Vec<_> = client.lock_announced_tracks().iter().map(|(n, r)| (n.clone(), r.clone())).collect();
+                    log::info!("Session to {} resumed, announcing {} namespaces again", url_str, tracks.len());
+                    for (namespace, reader) in tracks {
+                        spawn_announce(&client, session.clone(), namespace, reader);
+                    }
+                    return;
+                }
+                Err(e) => log::warn!("Resuming session, attempt {} of {} failed: {}", attempt, RESUME_ATTEMPTS, e),
             }
-            Err(_) => {
-                log::warn!("🔍 [CONNECT] Connection timed out after {} seconds", CONNECT_TIMEOUT_SECS);
-                Err(format!("Connection timeout after {} seconds", CONNECT_TIMEOUT_SECS))
+            if attempt < RESUME_ATTEMPTS {
+                tokio::time::sleep(backoff).await;
+                backoff *= 2;
             }
         }
-    });
-
-    log::debug!("🔍 [CONNECT] block_on completed, processing result");
+        log::error!("Could not resume the session to {}", url_str);
+        client.set_state(MoqConnectionState::MoqStateFailed);
+        client.notify(MoqConnectionState::MoqStateFailed);
+    })
+}
 
+/// Reports the outcome of a connection attempt, cleaning up after a failure.
+unsafe fn finish_connect(
+    inner: &ClientInner,
+    url_str: &str,
+    result: Result<(), String>,
+    connection_callback: MoqConnectionCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
     match result {
         Ok(()) => {
             log::info!("Connected to {} successfully", url_str);
@@ -716,18 +1838,15 @@ unsafe fn moq_connect_impl(
             set_last_error(e.clone());
             
             // Notify connection failure and clean up partial state
-            let inner_result = client_ref.inner.lock();
-            let mut inner = match inner_result {
-                Ok(guard) => guard,
+            inner.set_state(MoqConnectionState::MoqStateFailed);
+            match inner.url.lock() {
+                Ok(mut url) => *url = None,
                 Err(poisoned) => {
                     log::warn!("Mutex poisoned during connection failure, recovering");
-                    poisoned.into_inner()
+                    *poisoned.into_inner() = None
                 }
-            };
-            inner.connected = false;
-            inner.url = None;
-            inner.connection_callback = None;
-            inner.connection_user_data = 0;
+            }
+            inner.connection_callback.store(None);
             
             if let Some(callback) = connection_callback {
                 let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
@@ -743,62 +1862,65 @@ unsafe fn moq_connect_impl(
     }
 }
 
-/// Disconnects from the MoQ relay server.
+/// Starts connecting to a MoQ relay server without blocking.
+///
+/// Validates the arguments and returns immediately. The connection is then
+/// established on the library's runtime and `completion_callback` is invoked
+/// exactly once, on a library worker thread, with the same result
+/// `moq_connect()` would have returned. If this function returns an error the
+/// attempt was never started and `completion_callback` is not invoked.
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `client` must not be null
+/// - `client` must not be destroyed before the completion callback has run
+/// - `url` must be a valid null-terminated C string pointer
+/// - `connection_callback` and `completion_callback` may be null
+/// - `user_data` is passed to both callbacks and may be null
+/// - The callee of `completion_callback` owns the result's message and must
+///   free it with `moq_free_str()`
 /// - This function is thread-safe
-/// - Closes active connection and aborts async tasks
 ///
 /// # Parameters
 /// - `client`: Pointer to the MoQ client
+/// - `url`: HTTPS URL of the relay server (WebTransport over QUIC)
+/// - `connection_callback`: Optional callback for connection state changes
+/// - `user_data`: User data pointer passed to both callbacks
+/// - `completion_callback`: Optional callback receiving the outcome
 ///
 /// # Returns
-/// `MoqResult` with status code and error message (if any)
+/// `MoqOk` if the attempt was started, otherwise the argument error
 #[no_mangle]
-pub unsafe extern "C" fn moq_disconnect(client: *mut MoqClient) -> MoqResult {
+pub unsafe extern "C" fn moq_connect_async(
+    client: *mut MoqClient,
+    url: *const c_char,
+    connection_callback: MoqConnectionCallback,
+    user_data: *mut std::ffi::c_void,
+    completion_callback: MoqCompletionCallback,
+) -> MoqResult {
     std::panic::catch_unwind(|| {
-        if client.is_null() {
-            set_last_error("Client is null".to_string());
-            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
-        }
-
-        let client_ref = &*client;
-        let inner_result = client_ref.inner.lock();
-        let mut inner = match inner_result {
-            Ok(guard) => guard,
-            Err(poisoned) => {
-                log::warn!("Mutex poisoned during disconnect, recovering");
-                poisoned.into_inner()
-            }
+        let (client_inner, parsed_url, url_str) = match begin_connect(client, url, connection_callback, user_data) {
+            Ok(prepared) => prepared,
+            Err(result) => return result,
         };
 
-        // Abort session task if running
-        if let Some(task) = inner.session_task.take() {
-            task.abort();
-        }
-
-        // Clear session state
-        inner.session = None;
-        inner.publisher = None;
-        inner.subscriber = None;
-        inner.announced_namespaces.clear();
-        inner.connected = false;
-        inner.url = None;
-
-        // Notify disconnected state (with panic protection)
-        if let Some(callback) = inner.connection_callback {
-            let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
-                callback(inner.connection_user_data as *mut std::ffi::c_void, MoqConnectionState::MoqStateDisconnected);
-            }));
-        }
-
-        log::info!("Disconnected from MoQ server");
+        let user_data = user_data as usize;
+        RUNTIME.spawn(async move {
+            let result = establish_session(client_inner.clone(), parsed_url, url_str.clone()).await;
+            let user_data = user_data as *mut std::ffi::c_void;
+            let result = unsafe { finish_connect(&client_inner, &url_str, result, connection_callback, user_data) };
+            match completion_callback {
+                Some(callback) => {
+                    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| unsafe {
+                        callback(user_data, result);
+                    }));
+                }
+                None => unsafe { moq_free_str(result.message) },
+            }
+        });
         make_ok_result()
     }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_disconnect");
-        set_last_error("Internal panic occurred in moq_disconnect".to_string());
+        log::error!("Panic in moq_connect_async");
+        set_last_error("Internal panic occurred in moq_connect_async".to_string());
         make_error_result(
             MoqResultCode::MoqErrorInternal,
             "Internal panic occurred"
@@ -806,69 +1928,148 @@ pub unsafe extern "C" fn moq_disconnect(client: *mut MoqClient) -> MoqResult {
     })
 }
 
-/// Checks if the client is currently connected to a relay server.
+/// Disconnects from the MoQ relay server.
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `client` may be null (returns false)
+/// - `client` must not be null
 /// - This function is thread-safe
+/// - Closes active connection and aborts async tasks
 ///
 /// # Parameters
 /// - `client`: Pointer to the MoQ client
 ///
 /// # Returns
-/// `true` if connected, `false` otherwise (including if client is null)
+/// `MoqResult` with status code and error message (if any)
 #[no_mangle]
-pub unsafe extern "C" fn moq_is_connected(client: *const MoqClient) -> bool {
+pub unsafe extern "C" fn moq_disconnect(client: *mut MoqClient) -> MoqResult {
     std::panic::catch_unwind(|| {
         if client.is_null() {
-            return false;
+            set_last_error("Client is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
         }
 
-        let client_ref = &*client;
-        let inner_result = client_ref.inner.lock();
-        let inner = match inner_result {
-            Ok(guard) => guard,
-            Err(poisoned) => {
-                log::warn!("Mutex poisoned in moq_is_connected, recovering");
-                poisoned.into_inner()
-            }
-        };
-
-        inner.connected
-    }).unwrap_or(false)
+        disconnect(&(*client).inner, MoqConnectionState::MoqStateDisconnected);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_disconnect");
+        set_last_error("Internal panic occurred in moq_disconnect".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
 }
 
-/* ───────────────────────────────────────────────
- * Publishing
- * ─────────────────────────────────────────────── */
+/// Aborts the session task and clears the session state of a client, then
+/// reports `state`: Disconnected, or Failed for a session that ended in an error.
+fn disconnect(inner: &ClientInner, state: MoqConnectionState) {
+    // Abort session task if running
+    let task = match inner.session_task.lock() {
+        Ok(mut guard) => guard.take(),
+        Err(poisoned) => {
+            log::warn!("Mutex poisoned during disconnect, recovering");
+            poisoned.into_inner().take()
+        }
+    };
+    if let Some(task) = task {
+        task.abort();
+    }
+    inner.stop_latency_probe();
+    inner.stop_clock_sync();
+
+    // Clear session state
+    inner.set_state(state);
+    inner.session.store(None);
+    inner.forget_namespaces();
+    match inner.url.lock() {
+        Ok(mut url) => *url = None,
+        Err(poisoned) => *poisoned.into_inner() = None,
+    }
 
-/// Announces a namespace to the MoQ relay server.
+    // Notify disconnected state (with panic protection)
+    inner.notify(state);
+
+    log::info!("Disconnected from MoQ server");
+}
+
+/// Disconnects from the MoQ relay server after sending what is still queued.
+///
+/// `moq_disconnect()` drops the connection at once, losing objects that are
+/// still buffered or unacknowledged. This first stops taking new work, then
+/// waits, best effort, until the objects already published have left on the
+/// wire and presumably been acknowledged, closes the connection with a
+/// no-error code and disconnects. Relays see a clean close instead of a
+/// timeout.
+///
+/// Quinn reports acknowledgements per stream, but neither transport crate
+/// exposes its subgroup streams, so delivery cannot be confirmed: the
+/// wait ends once the connection has gone quiet for long enough to have had
+/// everything acknowledged (see `ack_quiet_period()`), and data held back by
+/// flow control looks the same. Nothing else sends on the connection by
+/// then, so it does go quiet.
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
 /// - `client` must not be null
-/// - `namespace` must be a valid null-terminated C string pointer
-/// - `namespace` must not be null
-/// - Client must be connected before calling this function
-/// - This function is thread-safe
+/// - This function is thread-safe; it blocks for up to `deadline_ms`
+/// - Must not be called from a connection or data callback
 ///
 /// # Parameters
 /// - `client`: Pointer to the MoQ client
-/// - `namespace`: Namespace string (slash-separated path, e.g., "example/namespace")
+/// - `deadline_ms`: Longest time to wait for queued data to be sent
 ///
 /// # Returns
-/// `MoqResult` with status code and error message (if any)
+/// - `MoqOk` if the client was not connected
+/// - `MoqErrorUnconfirmed` once the connection went quiet after sending what
+///   was queued; delivery is likely, not confirmed
+/// - `MoqErrorTimeout` if the deadline passed first
+/// - The client is disconnected in every case
+/// - `MoqErrorInvalidArgument` if `client` is null
 #[no_mangle]
-pub unsafe extern "C" fn moq_announce_namespace(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-) -> MoqResult {
+pub unsafe extern "C" fn moq_disconnect_graceful(client: *mut MoqClient, deadline_ms: u64) -> MoqResult {
     std::panic::catch_unwind(|| {
-        moq_announce_namespace_impl(client, namespace)
+        if client.is_null() {
+            set_last_error("Client is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+        }
+
+        let inner = &(*client).inner;
+        // Taking the session first keeps new work off it and tells the
+        // session task that its end is not the relay's doing
+        let session = inner.session.swap(None);
+        let drained = match session {
+            Some(session) if inner.is_connected() => {
+                inner.stop_latency_probe();
+                inner.stop_clock_sync();
+                let connection = &session.transport.connection;
+                let deadline = tokio::time::Instant::now() + Duration::from_millis(deadline_ms);
+                let drained = RUNTIME.block_on(drain_transport(connection, deadline));
+                // HTTP/3 H3_NO_ERROR, the code WebTransport closes a session with
+                connection.close(quinn::VarInt::from_u32(0x100), b"disconnect");
+                Some(drained)
+            }
+            _ => None,
+        };
+        disconnect(inner, MoqConnectionState::MoqStateDisconnected);
+
+        match drained {
+            None => make_ok_result(),
+            Some(true) => {
+                set_last_error("Queued data was sent, but its delivery cannot be confirmed".to_string());
+                make_error_result(
+                    MoqResultCode::MoqErrorUnconfirmed,
+                    "Queued data was sent, but its delivery cannot be confirmed",
+                )
+            }
+            Some(false) => {
+                set_last_error("Deadline passed before all data was sent".to_string());
+                make_error_result(MoqResultCode::MoqErrorTimeout, "Deadline passed before all data was sent")
+            }
+        }
     }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_announce_namespace");
-        set_last_error("Internal panic occurred in moq_announce_namespace".to_string());
+        log::error!("Panic in moq_disconnect_graceful");
+        set_last_error("Internal panic occurred in moq_disconnect_graceful".to_string());
         make_error_result(
             MoqResultCode::MoqErrorInternal,
             "Internal panic occurred"
@@ -876,325 +2077,596 @@ pub unsafe extern "C" fn moq_announce_namespace(
     })
 }
 
-unsafe fn moq_announce_namespace_impl(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-) -> MoqResult {
-    if client.is_null() || namespace.is_null() {
-        set_last_error("Client or namespace is null".to_string());
-        return make_error_result(
-            MoqResultCode::MoqErrorInvalidArgument,
-            "Client or namespace is null",
-        );
-    }
-
-    let namespace_str = match CStr::from_ptr(namespace).to_str() {
-        Ok(s) => s.to_string(),
-        Err(_) => {
-            set_last_error("Invalid UTF-8 in namespace".to_string());
-            return make_error_result(
-                MoqResultCode::MoqErrorInvalidArgument,
-                "Invalid UTF-8 in namespace",
-            );
-        }
-    };
-
-    let client_ref = &*client;
-    let inner_result = client_ref.inner.lock();
-    let inner = match inner_result {
-        Ok(guard) => guard,
-        Err(poisoned) => {
-            log::warn!("Mutex poisoned in moq_announce_namespace, recovering");
-            poisoned.into_inner()
-        }
-    };
+/// The relay's maximum ACK delay, QUIC's default
+const MAX_ACK_DELAY: Duration = Duration::from_millis(25);
 
-    if !inner.connected {
-        set_last_error("Not connected to MoQ server".to_string());
-        return make_error_result(
-            MoqResultCode::MoqErrorNotConnected,
-            "Not connected to MoQ server",
-        );
-    }
+/// How often draining looks at the connection's counters
+const DRAIN_POLL_INTERVAL: Duration = Duration::from_millis(5);
 
-    // Get mutable reference for announcing
-    drop(inner);
-    let inner_result = client_ref.inner.lock();
-    let mut inner = match inner_result {
-        Ok(guard) => guard,
-        Err(poisoned) => {
-            log::warn!("Mutex poisoned in moq_announce_namespace, recovering");
-            poisoned.into_inner()
-        }
-    };
+/// Frames sent on `connection` that carry data or probe for lost packets.
+fn data_frames_sent(connection: &quinn::Connection) -> u64 {
+    let frames = connection.stats().frame_tx;
+    frames.stream + frames.datagram + frames.ping
+}
 
-    // Parse namespace from string (using slash-separated path)
-    let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
+/// Probe timeouts after which a lost packet has been probed for again, each
+/// twice as long as the one before, that the quiet period covers
+const PTO_BACKOFFS: u32 = 2;
 
-    if inner.announced_namespaces.contains_key(&track_namespace) {
-        set_last_error(format!("Namespace already announced: {}", namespace_str));
-        return make_error_result(
-            MoqResultCode::MoqErrorInternal,
-            "Namespace already announced",
-        );
-    }
+/// How long `connection` has to send no data frames before every packet it
+/// sent is presumed acknowledged.
+///
+/// Quinn does not report when its send buffers are empty or what is in
+/// flight. A probe timeout on a fresh path is three round trips plus the ACK
+/// delay; the period spans that and the backed-off timeouts after it, so a
+/// packet lost along with its first probes would have been probed for again
+/// and counted by `data_frames_sent()`. Data blocked by flow control is
+/// neither sent nor probed for, which is why the result is only presumed.
+fn ack_quiet_period(connection: &quinn::Connection) -> Duration {
+    (connection.rtt() * 3 + MAX_ACK_DELAY) * ((1 << (PTO_BACKOFFS + 1)) - 1)
+}
 
-    // Get publisher
-    let mut publisher = match inner.publisher.as_mut() {
-        Some(p) => p.clone(),
-        None => {
-            set_last_error("Publisher not available".to_string());
-            return make_error_result(
-                MoqResultCode::MoqErrorNotConnected,
-                "Publisher not available",
-            );
+/// Waits until `connection` has sent what is queued on it and presumably had
+/// it acknowledged (see `ack_quiet_period()`); returns false if `deadline`
+/// passes or the connection closes first.
+async fn drain_transport(connection: &quinn::Connection, deadline: tokio::time::Instant) -> bool {
+    let mut sent = data_frames_sent(connection);
+    let mut quiet_since = tokio::time::Instant::now();
+    loop {
+        if connection.close_reason().is_some() {
+            return false;
         }
-    };
-
-    // Create tracks for this namespace
-    let (tracks_writer, _tracks_request, tracks_reader) = serve::Tracks::new(track_namespace.clone()).produce();
-
-    // Spawn task to announce and handle subscriptions
-    let track_namespace_clone = track_namespace.clone();
-    let client_inner = client_ref.inner.clone();
-    RUNTIME.spawn(async move {
-        if let Err(e) = publisher.announce(tracks_reader).await {
-            log::error!("Failed to announce namespace: {}", e);
-            // Remove from announced namespaces on failure
-            if let Ok(mut inner) = client_inner.lock() {
-                inner.announced_namespaces.remove(&track_namespace_clone);
-            }
+        let now = tokio::time::Instant::now();
+        if now - quiet_since >= ack_quiet_period(connection) {
+            return true;
         }
-    });
-
-    // Store the tracks writer for later use
-    inner.announced_namespaces.insert(track_namespace, tracks_writer);
-
-    log::info!("Announced namespace: {}", namespace_str);
-    make_ok_result()
+        if now >= deadline {
+            return false;
+        }
+        tokio::time::sleep_until((now + DRAIN_POLL_INTERVAL).min(deadline)).await;
+        let count = data_frames_sent(connection);
+        if count != sent {
+            sent = count;
+            quiet_since = tokio::time::Instant::now();
+        }
+    }
 }
 
-/// Creates a publisher for a specific track (stream mode by default).
+/// Checks if the client is currently connected to a relay server.
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `client` must not be null
-/// - `namespace` must be a valid null-terminated C string pointer
-/// - `namespace` must not be null
-/// - `track_name` must be a valid null-terminated C string pointer
-/// - `track_name` must not be null
-/// - Namespace must be announced before creating publisher
-/// - Client must be connected
+/// - `client` may be null (returns false)
 /// - This function is thread-safe
 ///
 /// # Parameters
 /// - `client`: Pointer to the MoQ client
-/// - `namespace`: Namespace string (must be previously announced)
-/// - `track_name`: Track name string
 ///
 /// # Returns
-/// Pointer to the created publisher, or null on failure
+/// `true` if connected, `false` otherwise (including if client is null)
 #[no_mangle]
-pub unsafe extern "C" fn moq_create_publisher(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-    track_name: *const c_char,
-) -> *mut MoqPublisher {
-    // Default to stream mode for backward compatibility
-    moq_create_publisher_ex(client, namespace, track_name, MoqDeliveryMode::MoqDeliveryStream)
+pub unsafe extern "C" fn moq_is_connected(client: *const MoqClient) -> bool {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            return false;
+        }
+
+        (*client).inner.is_connected()
+    }).unwrap_or(false)
 }
 
-/// Creates a publisher for a specific track with explicit delivery mode.
+/// Selects the UDP offloads of the client's next connection.
+///
+/// GSO and GRO are on by default; the setting takes effect on the next
+/// `moq_connect()` and leaves an established connection unchanged.
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `client` must not be null
-/// - `namespace` must be a valid null-terminated C string pointer
-/// - `namespace` must not be null
-/// - `track_name` must be a valid null-terminated C string pointer
-/// - `track_name` must not be null
-/// - Namespace must be announced before creating publisher
-/// - Client must be connected
 /// - This function is thread-safe
 ///
-/// # Parameters
-/// - `client`: Pointer to the MoQ client
-/// - `namespace`: Namespace string (must be previously announced)
-/// - `track_name`: Track name string
-/// - `delivery_mode`: Delivery mode (stream or datagram)
-///
 /// # Returns
-/// Pointer to the created publisher, or null on failure
+/// `MoqOk`, or `MoqErrorInvalidArgument` if `client` is null
 #[no_mangle]
-pub unsafe extern "C" fn moq_create_publisher_ex(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-    track_name: *const c_char,
-    delivery_mode: MoqDeliveryMode,
-) -> *mut MoqPublisher {
+pub unsafe extern "C" fn moq_client_set_udp_offload(client: *mut MoqClient, gso: bool, gro: bool) -> MoqResult {
     std::panic::catch_unwind(|| {
-        moq_create_publisher_ex_impl(client, namespace, track_name, delivery_mode)
+        if client.is_null() {
+            set_last_error("Client is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+        }
+        let offload = UdpOffload { gso, gro };
+        let inner = &(*client).inner;
+        match inner.udp_offload.lock() {
+            Ok(mut slot) => *slot = offload,
+            Err(poisoned) => *poisoned.into_inner() = offload,
+        }
+        make_ok_result()
     }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_create_publisher_ex");
-        set_last_error("Internal panic occurred in moq_create_publisher_ex".to_string());
-        std::ptr::null_mut()
+        log::error!("Panic in moq_client_set_udp_offload");
+        set_last_error("Internal panic occurred in moq_client_set_udp_offload".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
     })
 }
 
-unsafe fn moq_create_publisher_ex_impl(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-    track_name: *const c_char,
-    delivery_mode: MoqDeliveryMode,
-) -> *mut MoqPublisher {
-    if client.is_null() || namespace.is_null() || track_name.is_null() {
-        set_last_error("Client, namespace, or track_name is null".to_string());
-        return std::ptr::null_mut();
-    }
-
-    let namespace_str = match CStr::from_ptr(namespace).to_str() {
-        Ok(s) => s.to_string(),
-        Err(_) => {
-            set_last_error("Invalid UTF-8 in namespace".to_string());
-            return std::ptr::null_mut();
+/// Opts the client in to the library's in-band object header.
+///
+/// Neither transport crate exposes draft-14 extension headers, and draft-07
+/// has none, so extension headers and capture timestamps travel in a block
+/// (see `object_header`) written at the start of the object's payload. Subscribers that did not opt
+/// in, and every other MoQ implementation, receive that block as part of the
+/// payload, so all clients on a track have to agree.
+///
+/// Off by default: publishers then refuse extension headers and timestamps,
+/// and subscriptions deliver every payload exactly as received. The setting
+/// applies to publishers, subscriptions and recorders created afterwards.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - This function is thread-safe
+///
+/// # Returns
+/// `MoqOk`, or `MoqErrorInvalidArgument` if `client` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_set_inband_headers(client: *mut MoqClient, enabled: bool) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            set_last_error("Client is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
         }
-    };
+        let inner = &(*client).inner;
+        inner.inband_headers.store(enabled, Ordering::Relaxed);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_client_set_inband_headers");
+        set_last_error("Internal panic occurred in moq_client_set_inband_headers".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
 
-    let track_name_str = match CStr::from_ptr(track_name).to_str() {
-        Ok(s) => s.to_string(),
-        Err(_) => {
-            set_last_error("Invalid UTF-8 in track_name".to_string());
-            return std::ptr::null_mut();
+/// Opts the client in to resuming sessions the relay ends.
+///
+/// Neither transport crate surfaces GOAWAY, so a session that ends without
+/// the client closing it cannot be told apart from a relay that rejected the
+/// client, failed or went away for good. With auto-resume the client reports
+/// `MoqStateResuming` instead, reconnects to the same URL with backoff and
+/// announces its namespaces again; publishers keep working, subscriptions
+/// end with the old session. It reports `MoqStateFailed` if every attempt
+/// fails.
+///
+/// Off by default: a session the relay ends is reported as `MoqStateFailed`
+/// if it ended in an error, otherwise `MoqStateDisconnected`, and the client
+/// stays disconnected. Applies to the sessions ending afterwards.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - This function is thread-safe
+///
+/// # Returns
+/// `MoqOk`, or `MoqErrorInvalidArgument` if `client` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_set_auto_resume(client: *mut MoqClient, enabled: bool) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            set_last_error("Client is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
         }
-    };
+        let inner = &(*client).inner;
+        inner.auto_resume.store(enabled, Ordering::Relaxed);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_client_set_auto_resume");
+        set_last_error("Internal panic occurred in moq_client_set_auto_resume".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
 
-    let client_ref = &*client;
-    let mut inner = match client_ref.inner.lock() {
-        Ok(inner) => inner,
-        Err(_) => {
-            set_last_error("Failed to lock client mutex".to_string());
-            return std::ptr::null_mut();
+/// Counters of a client's QUIC connection and its UDP socket.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct MoqTransportStats {
+    /// Smoothed round-trip time in microseconds
+    pub rtt_us: u64,
+    /// Congestion window in bytes
+    pub congestion_window: u64,
+    /// Packets declared lost
+    pub lost_packets: u64,
+    /// UDP datagrams sent
+    pub udp_tx_datagrams: u64,
+    /// Bytes sent in UDP datagrams
+    pub udp_tx_bytes: u64,
+    /// Send calls into the socket; fewer than datagrams with GSO
+    pub udp_tx_syscalls: u64,
+    /// UDP datagrams received
+    pub udp_rx_datagrams: u64,
+    /// Bytes received in UDP datagrams
+    pub udp_rx_bytes: u64,
+    /// Receive calls that returned data; fewer than datagrams with GRO or
+    /// batched receives
+    pub udp_rx_syscalls: u64,
+    /// Datagrams one send may carry; greater than 1 while GSO is active
+    pub gso_segments: u32,
+    /// Datagrams one receive may return; greater than 1 while GRO is active
+    pub gro_segments: u32,
+}
+
+/// Fills `stats` with the counters of the client's current connection.
+///
+/// `udp_tx_datagrams / udp_tx_syscalls` is the number of packets per send
+/// call, which shows whether segmentation offload is paying off.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `stats` must be a valid pointer to writable `MoqTransportStats`
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if `client` or `stats` is null
+/// - `MoqErrorNotConnected` if the client is not connected
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_get_transport_stats(
+    client: *const MoqClient,
+    stats: *mut MoqTransportStats,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || stats.is_null() {
+            set_last_error("Client or stats is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client or stats is null");
         }
-    };
+        let Some(session) = (*client).inner.session() else {
+            set_last_error("Not connected".to_string());
+            return make_error_result(MoqResultCode::MoqErrorNotConnected, "Not connected");
+        };
+        let transport = &session.transport;
+        let counters = transport.connection.stats();
+        *stats = MoqTransportStats {
+            rtt_us: counters.path.rtt.as_micros() as u64,
+            congestion_window: counters.path.cwnd,
+            lost_packets: counters.path.lost_packets,
+            udp_tx_datagrams: counters.udp_tx.datagrams,
+            udp_tx_bytes: counters.udp_tx.bytes,
+            udp_tx_syscalls: counters.udp_tx.ios,
+            udp_rx_datagrams: counters.udp_rx.datagrams,
+            udp_rx_bytes: counters.udp_rx.bytes,
+            udp_rx_syscalls: counters.udp_rx.ios,
+            gso_segments: transport.socket.udp.gso_segments() as u32,
+            gro_segments: transport.socket.udp.gro_segments() as u32,
+        };
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_client_get_transport_stats");
+        set_last_error("Internal panic occurred in moq_client_get_transport_stats".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
 
-    if !inner.connected {
-        set_last_error("Not connected to MoQ server".to_string());
-        return std::ptr::null_mut();
+/* ───────────────────────────────────────────────
+ * Latency probe
+ * ─────────────────────────────────────────────── */
+
+/// Latency of objects through the relay, as measured by the latency probe.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct MoqLatencyStats {
+    /// Probes published
+    pub probes_sent: u64,
+    /// Probes received back through the relay
+    pub probes_received: u64,
+    /// Latency of the most recent probe in microseconds
+    pub last_us: u64,
+    /// Lowest latency seen in microseconds
+    pub min_us: u64,
+    /// Highest latency seen in microseconds
+    pub max_us: u64,
+    /// Moving average of the latency in microseconds (gain 1/8)
+    pub smoothed_us: u64,
+}
+
+impl From<latency_probe::Summary> for MoqLatencyStats {
+    fn from(summary: latency_probe::Summary) -> Self {
+        MoqLatencyStats {
+            probes_sent: summary.sent,
+            probes_received: summary.received,
+            last_us: summary.last_us,
+            min_us: summary.min_us,
+            max_us: summary.max_us,
+            smoothed_us: summary.smoothed_us,
+        }
     }
+}
 
-    // Parse namespace
-    let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
+/// A running latency probe: a publishing task and the subscription it is echoed to.
+struct LatencyProbe {
+    namespace: TrackNamespace,
+    publish_task: tokio::task::JoinHandle<()>,
+    echo_task: tokio::task::JoinHandle<()>,
+}
 
-    // Get the tracks writer for this namespace
-    let tracks_writer = match inner.announced_namespaces.get_mut(&track_namespace) {
-        Some(tw) => tw,
-        None => {
-            set_last_error(format!("Namespace not announced: {}", namespace_str));
-            return std::ptr::null_mut();
+impl LatencyProbe {
+    fn stop(self, inner: &ClientInner) {
+        self.publish_task.abort();
+        self.echo_task.abort();
+        inner.forget_namespace(&self.namespace);
+        log::info!("Latency probe on {:?} stopped", self.namespace);
+    }
+}
+
+impl PayloadBuffer for Vec<u8> {
+    fn extend_from_slice(&mut self, chunk: &[u8]) {
+        Vec::extend_from_slice(self, chunk);
+    }
+}
+
+/// Measures every probe read back from the relay.
+struct ProbeSink {
+    stats: Arc<ProbeStats>,
+}
+
+impl TrackSink for ProbeSink {
+    type Buffer = Vec<u8>;
+
+    fn begin_object(&self, _group_id: u64, _object_id: u64, size: usize, _header: ObjectHeader) -> Vec<u8> {
+        Vec::with_capacity(size)
+    }
+
+    fn push(&mut self, payload: Vec<u8>) {
+        self.stats.on_echo(&payload, latency_probe::monotonic_us());
+    }
+
+    fn flush_deadline(&self) -> Option<Duration> {
+        None
+    }
+
+    fn flush(&mut self) {}
+}
+
+/// Starts measuring publish-to-subscribe latency through the relay.
+///
+/// Every `interval_ms` the client publishes a 16-byte object carrying a
+/// sequence number and a timestamp on a reserved track of its own, and
+/// subscribes to that track through the relay. Each probe that comes back
+/// yields one latency sample: the time from publishing to receiving,
+/// including the relay's queuing and forwarding, which the QUIC round-trip
+/// time in `MoqTransportStats` does not include.
+///
+/// Samples go to `callback`, if set, on a library thread, and are summarized
+/// by `moq_client_get_latency_stats()`. Starting a probe replaces a running
+/// one and resets the statistics. The probe stops on `moq_disconnect()`.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `user_data` will be passed to the callback and may be null
+/// - Client must be connected
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` once the probe is running
+/// - `MoqErrorInvalidArgument` if `client` is null or `interval_ms` is 0
+/// - `MoqErrorNotConnected` if the client is not connected
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_start_latency_probe(
+    client: *mut MoqClient,
+    interval_ms: u32,
+    callback: MoqLatencyCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        moq_client_start_latency_probe_impl(client, interval_ms, callback, user_data)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_client_start_latency_probe");
+        set_last_error("Internal panic occurred in moq_client_start_latency_probe".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+unsafe fn moq_client_start_latency_probe_impl(
+    client: *mut MoqClient,
+    interval_ms: u32,
+    callback: MoqLatencyCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    if client.is_null() {
+        set_last_error("Client is null".to_string());
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+    }
+    if interval_ms == 0 {
+        set_last_error("Latency probe interval must be at least 1 ms".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Latency probe interval must be at least 1 ms",
+        );
+    }
+
+    let inner = &(*client).inner;
+    inner.stop_latency_probe();
+
+    let namespace_str = latency_probe::unique_namespace();
+    let result = announce_namespace(inner, &namespace_str);
+    if result.code != MoqResultCode::MoqOk {
+        return result;
+    }
+    let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
+    let publisher = {
+        let mut shard = inner.announced_namespaces.shard(&track_namespace);
+        match shard.get_mut(&track_namespace) {
+            Some(tracks_writer) => create_track_publisher(
+                inner,
+                tracks_writer,
+                &track_namespace,
+                latency_probe::TRACK,
+                MoqDeliveryMode::MoqDeliveryStream,
+            ),
+            None => Err(format!("Namespace not announced: {}", namespace_str)),
         }
     };
-
-    // Create track immediately
-    let track = match tracks_writer.create(&track_name_str) {
-        Some(t) => t,
-        None => {
-            set_last_error("Failed to create track (all readers dropped)".to_string());
-            return std::ptr::null_mut();
+    let publisher = match publisher {
+        Ok(publisher) => publisher.inner,
+        Err(e) => {
+            inner.forget_namespace(&track_namespace);
+            set_last_error(e.clone());
+            return make_error_result(MoqResultCode::MoqErrorInternal, &e);
         }
     };
 
-    // Create writer based on requested delivery mode
-    // Following moq-pub pattern: use groups() for stream delivery, datagrams() for datagram
-    let mode = match delivery_mode {
-        MoqDeliveryMode::MoqDeliveryDatagram => {
-            match track.datagrams() {
-                Ok(d) => PublisherMode::Datagrams(d),
-                Err(e) => {
-                    set_last_error(format!("Failed to create datagram writer: {}", e));
-                    return std::ptr::null_mut();
-                }
+    let stats = Arc::new(ProbeStats::new(callback.map(|cb| (cb as LatencyFn, user_data as usize))));
+    inner.latency_stats.store(Some(stats.clone()));
+    let interval = Duration::from_millis(interval_ms as u64);
+
+    let publish_stats = stats.clone();
+    let publish_task = RUNTIME.spawn(async move {
+        let mut ticker = tokio::time::interval(interval);
+        // After a stall, resume the cadence rather than send a burst of probes that all measure the stall
+        ticker.set_missed_tick_behavior(tokio::time::MissedTickBehavior::Delay);
+        for sequence in 0u64.. {
+            ticker.tick().await;
+            let payload = latency_probe::encode(sequence, latency_probe::monotonic_us());
+            let result = publish_payload(&publisher, bytes::Bytes::copy_from_slice(&payload), None, &[]);
+            if result.code == MoqResultCode::MoqOk {
+                publish_stats.on_sent();
+            } else {
+                log::debug!("Latency probe {} not sent", sequence);
+                moq_free_str(result.message);
             }
         }
-        MoqDeliveryMode::MoqDeliveryStream => {
-            // Use groups() like moq-pub does, not stream()
-            match track.groups() {
-                Ok(s) => PublisherMode::Subgroups(s),
-                Err(e) => {
-                    set_last_error(format!("Failed to create subgroups writer: {}", e));
-                    return std::ptr::null_mut();
-                }
+    });
+
+    let echo_inner = inner.clone();
+    let echo_namespace = track_namespace.clone();
+    let mut sink = ProbeSink { stats };
+    let echo_task = RUNTIME.spawn(async move {
+        loop {
+            // Give the relay an interval to take the announce before (re)subscribing
+            tokio::time::sleep(interval).await;
+            match subscribe_track(&echo_inner, &echo_namespace, latency_probe::TRACK) {
+                Ok(track) => read_track(track, &mut sink, false, &echo_namespace, latency_probe::TRACK).await,
+                Err(e) => log::debug!("Latency probe subscribe failed: {}", e),
             }
         }
-    };
-
-    drop(inner);
+    });
 
-    // Create publisher
-    let publisher = MoqPublisher {
-        inner: Arc::new(Mutex::new(PublisherInner {
-            namespace: track_namespace,
-            track_name: track_name_str.clone(),
-            mode,
-            group_id_counter: std::sync::atomic::AtomicU64::new(0),
-        })),
+    let probe = LatencyProbe { namespace: track_namespace, publish_task, echo_task };
+    let previous = match inner.latency_probe.lock() {
+        Ok(mut guard) => guard.replace(probe),
+        Err(poisoned) => poisoned.into_inner().replace(probe),
     };
+    // Another thread started a probe meanwhile; the newest one wins
+    if let Some(previous) = previous {
+        previous.stop(inner);
+    }
 
-    log::info!("Created publisher for {}/{} (mode: {:?})", namespace_str, track_name_str, delivery_mode);
-    Box::into_raw(Box::new(publisher))
+    log::info!("Latency probe started on {} every {} ms", namespace_str, interval_ms);
+    make_ok_result()
 }
 
-/// Destroys a publisher and releases its resources.
+/// Stops the latency probe. Its statistics stay readable until the next
+/// probe starts; stopping a client without a probe is a no-op.
 ///
 /// # Safety
-/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
-/// - `publisher` must not be null (null pointers are safely ignored)
-/// - `publisher` must not be accessed after this function returns
+/// - `client` must be a valid pointer returned from `moq_client_create()`
 /// - This function is thread-safe
 ///
-/// # Parameters
-/// - `publisher`: Pointer to the publisher to destroy, or null (null is safely ignored)
+/// # Returns
+/// `MoqOk`, or `MoqErrorInvalidArgument` if `client` is null
 #[no_mangle]
-pub unsafe extern "C" fn moq_publisher_destroy(publisher: *mut MoqPublisher) {
-    let _ = std::panic::catch_unwind(|| {
-        if !publisher.is_null() {
-            let _ = Box::from_raw(publisher);
-            log::debug!("Destroyed publisher");
+pub unsafe extern "C" fn moq_client_stop_latency_probe(client: *mut MoqClient) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            set_last_error("Client is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
         }
-    });
-    // Silently handle panics - destructor should not propagate panics
+        (*client).inner.stop_latency_probe();
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_client_stop_latency_probe");
+        set_last_error("Internal panic occurred in moq_client_stop_latency_probe".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
 }
 
-/// Publishes data to a track.
+/// Fills `stats` with the figures of the running or most recent latency probe.
+///
+/// Every field is zero if no probe has been started.
 ///
 /// # Safety
-/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
-/// - `publisher` must not be null
-/// - `data` must be a valid pointer to a buffer of at least `data_len` bytes
-/// - `data` must not be null if `data_len` > 0
-/// - `data` may be null if `data_len` is 0
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `stats` must be a valid pointer to writable `MoqLatencyStats`
+/// - This function is thread-safe
+///
+/// # Returns
+/// `MoqOk`, or `MoqErrorInvalidArgument` if `client` or `stats` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_get_latency_stats(
+    client: *const MoqClient,
+    stats: *mut MoqLatencyStats,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || stats.is_null() {
+            set_last_error("Client or stats is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client or stats is null");
+        }
+        let inner = &(*client).inner;
+        *stats = inner
+            .latency_stats
+            .load_full()
+            .map_or_else(MoqLatencyStats::default, |probe| probe.summary().into());
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_client_get_latency_stats");
+        set_last_error("Internal panic occurred in moq_client_get_latency_stats".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/* ───────────────────────────────────────────────
+ * Publishing
+ * ─────────────────────────────────────────────── */
+
+/// Announces a namespace to the MoQ relay server.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `client` must not be null
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `namespace` must not be null
+/// - Client must be connected before calling this function
 /// - This function is thread-safe
-/// - Data is copied, so the buffer can be freed after this function returns
 ///
 /// # Parameters
-/// - `publisher`: Pointer to the publisher
-/// - `data`: Pointer to the data buffer
-/// - `data_len`: Length of the data in bytes
-/// - `_delivery_mode`: Ignored (delivery mode is set at publisher creation)
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Namespace string (slash-separated path, e.g., "example/namespace")
 ///
 /// # Returns
 /// `MoqResult` with status code and error message (if any)
 #[no_mangle]
-pub unsafe extern "C" fn moq_publish_data(
-    publisher: *mut MoqPublisher,
-    data: *const u8,
-    data_len: usize,
-    _delivery_mode: MoqDeliveryMode,
+pub unsafe extern "C" fn moq_announce_namespace(
+    client: *mut MoqClient,
+    namespace: *const c_char,
 ) -> MoqResult {
     std::panic::catch_unwind(|| {
-        moq_publish_data_impl(publisher, data, data_len, _delivery_mode)
+        moq_announce_namespace_impl(client, namespace)
     }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_publish_data");
-        set_last_error("Internal panic occurred in moq_publish_data".to_string());
+        log::error!("Panic in moq_announce_namespace");
+        set_last_error("Internal panic occurred in moq_announce_namespace".to_string());
         make_error_result(
             MoqResultCode::MoqErrorInternal,
             "Internal panic occurred"
@@ -1202,118 +2674,164 @@ pub unsafe extern "C" fn moq_publish_data(
     })
 }
 
-unsafe fn moq_publish_data_impl(
-    publisher: *mut MoqPublisher,
-    data: *const u8,
-    data_len: usize,
-    _delivery_mode: MoqDeliveryMode,
+unsafe fn moq_announce_namespace_impl(
+    client: *mut MoqClient,
+    namespace: *const c_char,
 ) -> MoqResult {
-    if publisher.is_null() {
-        set_last_error("Publisher is null".to_string());
+    if client.is_null() || namespace.is_null() {
+        set_last_error("Client or namespace is null".to_string());
         return make_error_result(
             MoqResultCode::MoqErrorInvalidArgument,
-            "Publisher is null",
+            "Client or namespace is null",
         );
     }
 
-    // Validate data pointer with length check
-    if data.is_null() && data_len > 0 {
-        set_last_error("Data is null but data_len is non-zero".to_string());
-        return make_error_result(
-            MoqResultCode::MoqErrorInvalidArgument,
-            "Data is null but data_len is non-zero",
-        );
-    }
-
-    let publisher_ref = &*publisher;
-    let inner_result = publisher_ref.inner.lock();
-    let mut inner = match inner_result {
-        Ok(guard) => guard,
-        Err(poisoned) => {
-            log::warn!("Mutex poisoned in moq_publish_data, recovering");
-            poisoned.into_inner()
+    let namespace_str = match CStr::from_ptr(namespace).to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            set_last_error("Invalid UTF-8 in namespace".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Invalid UTF-8 in namespace",
+            );
         }
     };
 
-    // Copy data to Bytes (handle empty data case)
-    // Note: data_len == 0 case already validated above (null with non-zero length rejected)
-    let data_bytes = if data_len == 0 {
-        bytes::Bytes::new()
-    } else {
-        let data_slice = std::slice::from_raw_parts(data, data_len);
-        bytes::Bytes::copy_from_slice(data_slice)
+    announce_namespace(&(*client).inner, &namespace_str)
+}
+
+/// Registers a namespace for publishing and announces it to the relay.
+fn announce_namespace(inner: &Arc<ClientInner>, namespace_str: &str) -> MoqResult {
+    let Some(session) = inner.session() else {
+        set_last_error("Not connected to MoQ server".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorNotConnected,
+            "Not connected to MoQ server",
+        );
     };
 
-    let namespace = inner.namespace.clone();
-    let track_name = inner.track_name.clone();
-    
-    // Get counter value before borrowing mode
-    let counter_val = inner.group_id_counter.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
-    
-    // Publish data based on mode
-    // Following moq-pub pattern: use subgroups.append() then subgroup.write()
-    let result = match &mut inner.mode {
-        PublisherMode::Datagrams(datagrams) => {
-            // Create a datagram with metadata
-            #[cfg(feature = "with_moq")]
-            let datagram = serve::Datagram {
-                group_id: 0,
-                object_id: counter_val,
-                priority: 0,
-                payload: data_bytes,
-            };
-            
-            #[cfg(feature = "with_moq_draft07")]
-            let datagram = serve::Datagram {
-                group_id: 0,
-                object_id: counter_val,
-                priority: 0,
-                status: moq::data::ObjectStatus::Object,
-                payload: data_bytes,
-            };
-            
-            datagrams.write(datagram)
-                .map_err(|e| format!("Failed to write datagram: {}", e))
-                .map(|_| {
-                    log::debug!("Published {} bytes to {:?}/{} via datagram", data_len, namespace, track_name);
-                })
-        }
-        PublisherMode::Subgroups(subgroups) => {
-            // Following moq-pub pattern:
-            // 1. Create a new subgroup with append(priority)
-            // 2. Write data to it with write()
-            // For simplicity, create a new subgroup for each publish (like moq-pub does for keyframes)
-            let priority: u8 = 127; // Same as moq-pub uses
-            
-            match subgroups.append(priority) {
-                Ok(mut subgroup) => {
-                    subgroup.write(data_bytes)
-                        .map_err(|e| format!("Failed to write to subgroup: {}", e))
-                        .map(|_| {
-                            log::debug!("Published {} bytes to {:?}/{} via subgroup", data_len, namespace, track_name);
-                        })
-                }
-                Err(e) => {
-                    Err(format!("Failed to create subgroup: {}", e))
-                }
+    // Parse namespace from string (using slash-separated path)
+    let track_namespace = TrackNamespace::from_utf8_path(namespace_str);
+
+    // Create tracks for this namespace and store the writer for later use
+    let (tracks_writer, tracks_request, tracks_reader) = serve::Tracks::new(track_namespace.clone()).produce();
+    if !inner.announced_namespaces.insert_if_absent(track_namespace.clone(), tracks_writer) {
+        set_last_error(format!("Namespace already announced: {}", namespace_str));
+        return make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Namespace already announced",
+        );
+    }
+    inner.lock_announced_tracks().insert(track_namespace.clone(), tracks_reader.clone());
+
+    // Spawn tasks to announce and handle subscriptions
+    RUNTIME.spawn(serve_track_requests(tracks_request, Arc::downgrade(inner), track_namespace.clone()));
+    spawn_announce(inner, session, track_namespace, tracks_reader);
+
+    log::info!("Announced namespace: {}", namespace_str);
+    make_ok_result()
+}
+
+/// Announces a namespace on `session` until the session ends.
+///
+/// A namespace the relay refuses is forgotten. One whose session was closed
+/// under it is kept, to be announced again if the session is resumed.
+fn spawn_announce(
+    inner: &Arc<ClientInner>,
+    session: Arc<SessionHandles>,
+    track_namespace: TrackNamespace,
+    tracks_reader: serve::TracksReader,
+) {
+    let client_inner = inner.clone();
+    RUNTIME.spawn(async move {
+        let mut publisher = session.publisher.clone();
+        if let Err(e) = publisher.announce(tracks_reader).await {
+            if session.transport.connection.close_reason().is_some() {
+                log::debug!("Announcement of {:?} ended with its session: {}", track_namespace, e);
+                return;
             }
+            log::error!("Failed to announce namespace: {}", e);
+            client_inner.forget_namespace(&track_namespace);
         }
-    };
+    });
+}
 
-    match result {
-        Ok(()) => make_ok_result(),
-        Err(e) => {
-            set_last_error(e.clone());
-            make_error_result(MoqResultCode::MoqErrorInternal, &e)
-        }
+/// Answers SUBSCRIBEs for tracks of an announced namespace that have no
+/// publisher: clock requests get the times they were received and answered,
+/// anything else is not found.
+async fn serve_track_requests(
+    mut requests: serve::TracksRequest,
+    client: std::sync::Weak<ClientInner>,
+    namespace: TrackNamespace,
+) {
+    while let Some(track) = requests.next().await {
+        let received_us = clock_sync::wallclock_us();
+        let track_name = track.name.clone();
+        if !clock_sync::is_request(&track_name) {
+            log::debug!("Subscription to unknown track {:?}/{}", namespace, track_name);
+            let _ = track.close(serve::ServeError::NotFound);
+            continue;
+        }
+
+        let answer = track.groups().and_then(|mut groups| {
+            let response = clock_sync::encode_response(received_us, clock_sync::wallclock_us());
+            groups.append(0)?.write(bytes::Bytes::copy_from_slice(&response))?;
+            Ok(groups)
+        });
+        let groups = match answer {
+            Ok(groups) => groups,
+            Err(e) => {
+                log::debug!("Failed to answer clock request {:?}/{}: {}", namespace, track_name, e);
+                continue;
+            }
+        };
+
+        // Keep the response until the relay has forwarded it, then forget the track
+        let client = client.clone();
+        let namespace = namespace.clone();
+        RUNTIME.spawn(async move {
+            tokio::time::sleep(CLOCK_RESPONSE_LINGER).await;
+            drop(groups);
+            if let Some(client) = client.upgrade() {
+                if let Some(tracks_writer) = client.announced_namespaces.shard(&namespace).get_mut(&namespace) {
+                    tracks_writer.remove(&track_name);
+                }
+            }
+        });
     }
 }
 
-/* ───────────────────────────────────────────────
- * Subscribing
- * ─────────────────────────────────────────────── */
+/// Creates a publisher for a specific track (stream mode by default).
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `client` must not be null
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `namespace` must not be null
+/// - `track_name` must be a valid null-terminated C string pointer
+/// - `track_name` must not be null
+/// - Namespace must be announced before creating publisher
+/// - Client must be connected
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Namespace string (must be previously announced)
+/// - `track_name`: Track name string
+///
+/// # Returns
+/// Pointer to the created publisher, or null on failure
+#[no_mangle]
+pub unsafe extern "C" fn moq_create_publisher(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+) -> *mut MoqPublisher {
+    // Default to stream mode for backward compatibility
+    moq_create_publisher_ex(client, namespace, track_name, MoqDeliveryMode::MoqDeliveryStream)
+}
 
-/// Subscribes to a track on the MoQ relay server.
+/// Creates a publisher for a specific track with explicit delivery mode.
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
@@ -1322,44 +2840,40 @@ unsafe fn moq_publish_data_impl(
 /// - `namespace` must not be null
 /// - `track_name` must be a valid null-terminated C string pointer
 /// - `track_name` must not be null
-/// - `data_callback` may be null (no data will be received)
-/// - `user_data` will be passed to the callback and may be null
+/// - Namespace must be announced before creating publisher
 /// - Client must be connected
 /// - This function is thread-safe
 ///
 /// # Parameters
 /// - `client`: Pointer to the MoQ client
-/// - `namespace`: Namespace string (slash-separated path)
+/// - `namespace`: Namespace string (must be previously announced)
 /// - `track_name`: Track name string
-/// - `data_callback`: Optional callback for received data
-/// - `user_data`: User data pointer passed to the callback
+/// - `delivery_mode`: Delivery mode (stream or datagram)
 ///
 /// # Returns
-/// Pointer to the created subscriber, or null on failure
+/// Pointer to the created publisher, or null on failure
 #[no_mangle]
-pub unsafe extern "C" fn moq_subscribe(
+pub unsafe extern "C" fn moq_create_publisher_ex(
     client: *mut MoqClient,
     namespace: *const c_char,
     track_name: *const c_char,
-    data_callback: MoqDataCallback,
-    user_data: *mut std::ffi::c_void,
-) -> *mut MoqSubscriber {
+    delivery_mode: MoqDeliveryMode,
+) -> *mut MoqPublisher {
     std::panic::catch_unwind(|| {
-        moq_subscribe_impl(client, namespace, track_name, data_callback, user_data)
+        moq_create_publisher_ex_impl(client, namespace, track_name, delivery_mode)
     }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_subscribe");
-        set_last_error("Internal panic occurred in moq_subscribe".to_string());
+        log::error!("Panic in moq_create_publisher_ex");
+        set_last_error("Internal panic occurred in moq_create_publisher_ex".to_string());
         std::ptr::null_mut()
     })
 }
 
-unsafe fn moq_subscribe_impl(
+unsafe fn moq_create_publisher_ex_impl(
     client: *mut MoqClient,
     namespace: *const c_char,
     track_name: *const c_char,
-    data_callback: MoqDataCallback,
-    user_data: *mut std::ffi::c_void,
-) -> *mut MoqSubscriber {
+    delivery_mode: MoqDeliveryMode,
+) -> *mut MoqPublisher {
     if client.is_null() || namespace.is_null() || track_name.is_null() {
         set_last_error("Client, namespace, or track_name is null".to_string());
         return std::ptr::null_mut();
@@ -1381,17 +2895,8 @@ unsafe fn moq_subscribe_impl(
         }
     };
 
-    let client_ref = &*client;
-    let inner_result = client_ref.inner.lock();
-    let inner = match inner_result {
-        Ok(guard) => guard,
-        Err(poisoned) => {
-            log::warn!("Mutex poisoned in moq_subscribe, recovering");
-            poisoned.into_inner()
-        }
-    };
-
-    if !inner.connected {
+    let inner = &(*client).inner;
+    if !inner.is_connected() {
         set_last_error("Not connected to MoQ server".to_string());
         return std::ptr::null_mut();
     }
@@ -1399,1511 +2904,5365 @@ unsafe fn moq_subscribe_impl(
     // Parse namespace
     let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
 
-    // Get subscriber (we need to clone it to use in async context)
-    let subscriber_impl = match inner.subscriber.as_ref() {
-        Some(s) => s.clone(),
+    // Get the tracks writer for this namespace (locks only its shard)
+    let mut shard = inner.announced_namespaces.shard(&track_namespace);
+    let tracks_writer = match shard.get_mut(&track_namespace) {
+        Some(tw) => tw,
         None => {
-            set_last_error("Subscriber not available".to_string());
+            set_last_error(format!("Namespace not announced: {}", namespace_str));
             return std::ptr::null_mut();
         }
     };
 
-    drop(inner);
-
-    // Following moq-sub pattern:
-    // 1. Create a Tracks for the namespace we want to subscribe to
-    // 2. Call tracks.produce() to get (TracksWriter, TracksRequest, TracksReader)
-    // 3. Use TracksWriter.create() to create a track entry
-    // 4. Call subscriber.subscribe(track_writer) to register subscription with relay
-    // 5. Use TracksReader.subscribe() to get the TrackReader for receiving data
-    
-    let tracks = Tracks::new(track_namespace.clone());
-    let (mut tracks_writer, _tracks_request, mut tracks_reader) = tracks.produce();
-    
-    // Create track writer for this specific track
-    let track_writer = match tracks_writer.create(&track_name_str) {
-        Some(tw) => tw,
-        None => {
-            set_last_error("Failed to create track writer (tracks closed)".to_string());
+    let publisher = match create_track_publisher(inner, tracks_writer, &track_namespace, &track_name_str, delivery_mode) {
+        Ok(p) => p,
+        Err(e) => {
+            set_last_error(e);
             return std::ptr::null_mut();
         }
     };
 
-    // Clone subscriber for the async task
-    let mut subscriber_for_task = subscriber_impl.clone();
-    let track_name_for_task = track_name_str.clone();
-    
-    // Spawn task to send subscribe request to relay (async, non-blocking)
-    // This follows the moq-sub pattern where subscribe is spawned as a task
-    RUNTIME.spawn(async move {
-        if let Err(err) = subscriber_for_task.subscribe(track_writer).await {
-            log::warn!("Failed to subscribe to track {}: {}", track_name_for_task, err);
-        }
-    });
+    drop(shard);
 
-    // Get the track reader from TracksReader - this will block until the track is available
-    let track_reader = match tracks_reader.subscribe(&track_name_str) {
-        Some(tr) => tr,
-        None => {
-            set_last_error("Failed to get track reader (no track available)".to_string());
-            return std::ptr::null_mut();
+    log::info!("Created publisher for {}/{} (mode: {:?})", namespace_str, track_name_str, delivery_mode);
+    Box::into_raw(Box::new(publisher))
+}
+
+/// Creates a track in an announced namespace and wraps its writer in a publisher.
+///
+/// Shared by the single and bulk publisher constructors. The caller must hold
+/// the namespace shard lock that owns `tracks_writer`.
+fn create_track_publisher(
+    client: &Arc<ClientInner>,
+    tracks_writer: &mut TracksWriter,
+    track_namespace: &TrackNamespace,
+    track_name: &str,
+    delivery_mode: MoqDeliveryMode,
+) -> Result<MoqPublisher, String> {
+    // Create track immediately
+    let track = tracks_writer
+        .create(track_name)
+        .ok_or_else(|| "Failed to create track (all readers dropped)".to_string())?;
+
+    // Create writer based on requested delivery mode
+    // Following moq-pub pattern: use groups() for stream delivery, datagrams() for datagram
+    let mode = match delivery_mode {
+        MoqDeliveryMode::MoqDeliveryDatagram => {
+            let d = track.datagrams()
+                .map_err(|e| format!("Failed to create datagram writer: {}", e))?;
+            PublisherMode::Datagrams(d)
+        }
+        MoqDeliveryMode::MoqDeliveryStream => {
+            // Use groups() like moq-pub does, not stream()
+            let s = track.groups()
+                .map_err(|e| format!("Failed to create subgroups writer: {}", e))?;
+            PublisherMode::Subgroups(s)
         }
     };
 
-    // Create subscriber and spawn task to read incoming data
-    let subscriber_inner = Arc::new(Mutex::new(SubscriberInner {
-        namespace: track_namespace.clone(),
-        track_name: track_name_str.clone(),
-        data_callback,
-        user_data: user_data as usize,
-        track: Some(track_reader.clone()),
-        reader_task: None,
-        subscribed: true,
-    }));
+    Ok(MoqPublisher {
+        inner: Arc::new(Mutex::new(PublisherInner {
+            namespace: track_namespace.clone(),
+            track_name: track_name.to_string(),
+            mode,
+            group_id_counter: std::sync::atomic::AtomicU64::new(0),
+            timestamps: false,
+            inband_headers: client.inband_headers(),
+        })),
+        pool: Arc::new(WriteBufferPool::new()),
+        file: Mutex::new(None),
+    })
+}
 
-    // Clone values for the async task
-    let track_namespace_log = track_namespace.clone();
-    let track_name_log = track_name_str.clone();
-    
-    // Spawn task to read data from track - following moq-sub pattern exactly
-    let inner_clone = subscriber_inner.clone();
-    let reader_task = RUNTIME.spawn(async move {
-        let track = {
-            match inner_clone.lock() {
-                Ok(inner) => match inner.track.clone() {
-                    Some(t) => t,
-                    None => {
-                        log::error!("Track reader not available (unsubscribed?)");
-                        return;
-                    }
-                },
-                Err(e) => {
-                    log::error!("Failed to lock subscriber mutex: {}", e);
-                    return;
-                }
-            }
-        };
-
-        log::debug!("Starting track reader for {:?}/{}", track_namespace_log, track_name_log);
-
-        // Get the mode - following moq-sub pattern
-        let mode_result = track.mode().await;
-        match mode_result {
-            Ok(mode) => {
-                use moq::serve::TrackReaderMode;
-                
-                match mode {
-                    TrackReaderMode::Subgroups(mut groups) => {
-                        // Following moq-sub recv_track pattern exactly
-                        log::debug!("Track {:?}/{} using Subgroups mode", track_namespace_log, track_name_log);
-                        while let Ok(Some(mut group)) = groups.next().await {
-                            log::trace!("Received group {} for {:?}/{}", group.group_id, track_namespace_log, track_name_log);
-                            // Following moq-sub recv_group pattern
-                            while let Ok(Some(mut object)) = group.next().await {
-                                log::trace!("Received object {} in group {}", object.object_id, group.group_id);
-                                // Following moq-sub recv_object pattern
-                                let mut buf = Vec::with_capacity(object.size);
-                                while let Ok(Some(chunk)) = object.read().await {
-                                    buf.extend_from_slice(&chunk);
-                                }
-                                
-                                if !buf.is_empty() {
-                                    // Invoke callback with panic protection
-                                    let inner_result = inner_clone.lock();
-                                    let inner = match inner_result {
-                                        Ok(guard) => guard,
-                                        Err(poisoned) => {
-                                            log::warn!("Mutex poisoned in subscriber callback, recovering");
-                                            poisoned.into_inner()
-                                        }
-                                    };
-                                    if let Some(callback) = inner.data_callback {
-                                        log::debug!("Invoking callback with {} bytes", buf.len());
-                                        let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
-                                            callback(inner.user_data as *mut std::ffi::c_void, buf.as_ptr(), buf.len());
-                                        }));
-                                    }
-                                }
-                            }
-                        }
-                        log::debug!("Track {:?}/{} subgroups ended", track_namespace_log, track_name_log);
-                    }
-                    TrackReaderMode::Stream(mut stream) => {
-                        log::debug!("Track {:?}/{} using Stream mode", track_namespace_log, track_name_log);
-                        while let Ok(Some(mut group)) = stream.next().await {
-                            while let Ok(Some(mut object)) = group.next().await {
-                                let mut buf = Vec::new();
-                                while let Ok(Some(chunk)) = object.read().await {
-                                    buf.extend_from_slice(&chunk);
-                                }
-                                
-                                if !buf.is_empty() {
-                                    let inner_result = inner_clone.lock();
-                                    let inner = match inner_result {
-                                        Ok(guard) => guard,
-                                        Err(poisoned) => poisoned.into_inner()
-                                    };
-                                    if let Some(callback) = inner.data_callback {
-                                        let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
-                                            callback(inner.user_data as *mut std::ffi::c_void, buf.as_ptr(), buf.len());
-                                        }));
-                                    }
-                                }
-                            }
-                        }
-                        log::debug!("Track {:?}/{} stream ended", track_namespace_log, track_name_log);
-                    }
-                    TrackReaderMode::Datagrams(mut datagrams) => {
-                        log::debug!("Track {:?}/{} using Datagrams mode", track_namespace_log, track_name_log);
-                        while let Ok(Some(datagram)) = datagrams.read().await {
-                            let buf = datagram.payload.to_vec();
-                            if !buf.is_empty() {
-                                let inner_result = inner_clone.lock();
-                                let inner = match inner_result {
-                                    Ok(guard) => guard,
-                                    Err(poisoned) => poisoned.into_inner()
-                                };
-                                if let Some(callback) = inner.data_callback {
-                                    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
-                                        callback(inner.user_data as *mut std::ffi::c_void, buf.as_ptr(), buf.len());
-                                    }));
-                                }
-                            }
-                        }
-                        log::debug!("Track {:?}/{} datagrams ended", track_namespace_log, track_name_log);
-                    }
-                }
-            }
-            Err(e) => {
-                log::error!("Failed to get track mode for {:?}/{}: {}", track_namespace_log, track_name_log, e);
-            }
-        }
-    });
-
-    // Store reader task (with proper error handling)
-    {
-        let inner_result = subscriber_inner.lock();
-        let mut inner = match inner_result {
-            Ok(guard) => guard,
-            Err(poisoned) => {
-                log::warn!("Mutex poisoned when storing reader task, recovering");
-                poisoned.into_inner()
-            }
-        };
-        inner.reader_task = Some(reader_task);
-    } // Drop the guard before moving subscriber_inner
-
-    let subscriber = MoqSubscriber {
-        inner: subscriber_inner,
-    };
-
-    log::info!("Subscribed to {}/{}", namespace_str, track_name_str);
-    Box::into_raw(Box::new(subscriber))
-}
-
-/// Destroys a subscriber and releases its resources.
-///
-/// # Safety
-/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
-/// - `subscriber` must not be null (null pointers are safely ignored)
-/// - `subscriber` must not be accessed after this function returns
-/// - This function is thread-safe
-/// - Active reader task will be aborted
-///
-/// # Parameters
-/// - `subscriber`: Pointer to the subscriber to destroy, or null (null is safely ignored)
-#[no_mangle]
-pub unsafe extern "C" fn moq_subscriber_destroy(subscriber: *mut MoqSubscriber) {
-    let _ = std::panic::catch_unwind(|| {
-        if !subscriber.is_null() {
-            let subscriber = Box::from_raw(subscriber);
-            
-            // Cancel reader task (with proper error handling)
-            let inner_result = subscriber.inner.lock();
-            let mut inner = match inner_result {
-                Ok(guard) => guard,
-                Err(poisoned) => {
-                    log::warn!("Mutex poisoned in moq_subscriber_destroy, recovering");
-                    poisoned.into_inner()
-                }
-            };
-            if let Some(task) = inner.reader_task.take() {
-                task.abort();
-            }
-            
-            log::debug!("Destroyed subscriber for {:?}/{}", inner.namespace, inner.track_name);
-        }
-    });
-    // Silently handle panics - destructor should not propagate panics
-}
-
-/// Unsubscribes from a track without destroying the subscriber handle.
+/// Creates publishers for many tracks of one announced namespace in a single pass.
 ///
-/// This function stops receiving data from the track by:
-/// 1. Aborting the reader task (stops processing incoming data)
-/// 2. Dropping the track reader (signals to the relay)
-/// 3. Marking the subscriber as unsubscribed
+/// The namespace is resolved once and every track is created while its shard
+/// lock of `announced_namespaces` is held a single time, so setting up
+/// thousands of tracks avoids the per-call locking, namespace lookup and
+/// argument conversion of calling `moq_create_publisher_ex()` in a loop.
+/// Other namespaces' shards stay available meanwhile.
 ///
-/// After calling this function:
-/// - No more data callbacks will be invoked
-/// - `moq_is_subscribed()` will return false
-/// - The subscriber handle remains valid but inactive
-/// - Call `moq_subscriber_destroy()` to free the handle
+/// The operation is all-or-nothing: on failure no publisher is returned and
+/// every entry of `publishers_out` is set to null.
 ///
 /// # Safety
-/// - `subscriber` must be a valid pointer returned from `moq_subscribe()` or `moq_subscribe_catalog()`
-/// - `subscriber` must not be null
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_names` must point to `track_count` valid null-terminated C string pointers
+/// - `publishers_out` must point to writable storage for `track_count` publisher pointers
+/// - Namespace must be announced before creating publishers
+/// - Client must be connected
 /// - This function is thread-safe
-/// - Safe to call multiple times (idempotent)
 ///
 /// # Parameters
-/// - `subscriber`: Pointer to the subscriber to unsubscribe
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Namespace string (must be previously announced)
+/// - `track_names`: Array of track name strings
+/// - `track_count`: Number of entries in `track_names` and `publishers_out`
+/// - `delivery_mode`: Delivery mode used for every publisher
+/// - `publishers_out`: Receives one publisher handle per track name
 ///
 /// # Returns
-/// - `MoqOk` on success or if already unsubscribed
-/// - `MoqErrorInvalidArgument` if subscriber is null
+/// `MoqResult` with status code and error message (if any)
 #[no_mangle]
-pub unsafe extern "C" fn moq_unsubscribe(subscriber: *mut MoqSubscriber) -> MoqResult {
+pub unsafe extern "C" fn moq_create_publishers(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_names: *const *const c_char,
+    track_count: usize,
+    delivery_mode: MoqDeliveryMode,
+    publishers_out: *mut *mut MoqPublisher,
+) -> MoqResult {
     std::panic::catch_unwind(|| {
-        if subscriber.is_null() {
+        moq_create_publishers_impl(client, namespace, track_names, track_count, delivery_mode, publishers_out)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_create_publishers");
+        set_last_error("Internal panic occurred in moq_create_publishers".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+unsafe fn moq_create_publishers_impl(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_names: *const *const c_char,
+    track_count: usize,
+    delivery_mode: MoqDeliveryMode,
+    publishers_out: *mut *mut MoqPublisher,
+) -> MoqResult {
+    if client.is_null() || namespace.is_null() || (track_count > 0 && (track_names.is_null() || publishers_out.is_null())) {
+        set_last_error("Client, namespace, track_names, or publishers_out is null".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Client, namespace, track_names, or publishers_out is null",
+        );
+    }
+
+    if track_count == 0 {
+        return make_ok_result();
+    }
+
+    let out = std::slice::from_raw_parts_mut(publishers_out, track_count);
+    out.fill(std::ptr::null_mut());
+
+    let namespace_str = match CStr::from_ptr(namespace).to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            set_last_error("Invalid UTF-8 in namespace".to_string());
             return make_error_result(
                 MoqResultCode::MoqErrorInvalidArgument,
-                "Subscriber is null",
+                "Invalid UTF-8 in namespace",
             );
         }
+    };
 
-        let subscriber_ref = &*subscriber;
-        let inner_result = subscriber_ref.inner.lock();
-        let mut inner = match inner_result {
-            Ok(guard) => guard,
-            Err(poisoned) => {
-                log::warn!("Mutex poisoned in moq_unsubscribe, recovering");
-                poisoned.into_inner()
-            }
-        };
+    let names = match c_str_array_to_strings(track_names, track_count) {
+        Ok(names) => names,
+        Err(e) => {
+            set_last_error(e.clone());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &e);
+        }
+    };
 
-        // Already unsubscribed - idempotent success
-        if !inner.subscribed {
-            log::debug!("Subscriber for {:?}/{} already unsubscribed", inner.namespace, inner.track_name);
-            return MoqResult {
-                code: MoqResultCode::MoqOk,
-                message: std::ptr::null(),
-            };
+    let inner = &(*client).inner;
+    if !inner.is_connected() {
+        set_last_error("Not connected to MoQ server".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorNotConnected,
+            "Not connected to MoQ server",
+        );
+    }
+
+    let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
+    let mut shard = inner.announced_namespaces.shard(&track_namespace);
+    let tracks_writer = match shard.get_mut(&track_namespace) {
+        Some(tw) => tw,
+        None => {
+            set_last_error(format!("Namespace not announced: {}", namespace_str));
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Namespace not announced",
+            );
         }
+    };
 
-        // Abort the reader task
-        if let Some(task) = inner.reader_task.take() {
-            task.abort();
-            log::debug!("Aborted reader task for {:?}/{}", inner.namespace, inner.track_name);
+    let mut publishers = Vec::with_capacity(track_count);
+    for name in &names {
+        match create_track_publisher(inner, tracks_writer, &track_namespace, name, delivery_mode) {
+            Ok(p) => publishers.push(p),
+            Err(e) => {
+                // Dropping the already-created publishers closes their tracks
+                let e = format!("{} (track {})", e, name);
+                set_last_error(e.clone());
+                return make_error_result(MoqResultCode::MoqErrorInternal, &e);
+            }
         }
+    }
 
-        // Drop the track reader to signal unsubscribe to the relay
-        inner.track = None;
+    drop(shard);
 
-        // Mark as unsubscribed
-        inner.subscribed = false;
+    for (slot, publisher) in out.iter_mut().zip(publishers) {
+        *slot = Box::into_raw(Box::new(publisher));
+    }
 
-        log::info!("Unsubscribed from {:?}/{}", inner.namespace, inner.track_name);
+    log::info!("Created {} publishers for {} (mode: {:?})", track_count, namespace_str, delivery_mode);
+    make_ok_result()
+}
 
-        MoqResult {
-            code: MoqResultCode::MoqOk,
-            message: std::ptr::null(),
-        }
-    }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_unsubscribe");
-        make_error_result(
-            MoqResultCode::MoqErrorInternal,
-            "Internal panic occurred in moq_unsubscribe",
-        )
-    })
+/// Converts a C array of `count` string pointers into owned UTF-8 strings.
+///
+/// # Safety
+/// `ptrs` must point to `count` readable `*const c_char` entries.
+unsafe fn c_str_array_to_strings(ptrs: *const *const c_char, count: usize) -> Result<Vec<String>, String> {
+    std::slice::from_raw_parts(ptrs, count)
+        .iter()
+        .enumerate()
+        .map(|(i, &p)| {
+            if p.is_null() {
+                return Err(format!("Track name at index {} is null", i));
+            }
+            CStr::from_ptr(p)
+                .to_str()
+                .map(|s| s.to_string())
+                .map_err(|_| format!("Invalid UTF-8 in track name at index {}", i))
+        })
+        .collect()
 }
 
-/// Checks if the subscriber is currently subscribed to a track.
+/// Destroys a publisher and releases its resources.
 ///
 /// # Safety
-/// - `subscriber` must be a valid pointer returned from `moq_subscribe()` or `moq_subscribe_catalog()`
-/// - `subscriber` may be null (returns false)
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - `publisher` must not be null (null pointers are safely ignored)
+/// - `publisher` must not be accessed after this function returns
 /// - This function is thread-safe
 ///
 /// # Parameters
-/// - `subscriber`: Pointer to the subscriber to check
-///
-/// # Returns
-/// - `true` if the subscriber is actively subscribed
-/// - `false` if subscriber is null, unsubscribed, or in an error state
+/// - `publisher`: Pointer to the publisher to destroy, or null (null is safely ignored)
 #[no_mangle]
-pub unsafe extern "C" fn moq_is_subscribed(subscriber: *const MoqSubscriber) -> bool {
-    std::panic::catch_unwind(|| {
-        if subscriber.is_null() {
-            return false;
+pub unsafe extern "C" fn moq_publisher_destroy(publisher: *mut MoqPublisher) {
+    let _ = std::panic::catch_unwind(|| {
+        if !publisher.is_null() {
+            let _ = Box::from_raw(publisher);
+            log::debug!("Destroyed publisher");
         }
-
-        let subscriber_ref = &*subscriber;
-        let inner_result = subscriber_ref.inner.lock();
-        let inner = match inner_result {
-            Ok(guard) => guard,
-            Err(poisoned) => {
-                log::warn!("Mutex poisoned in moq_is_subscribed, recovering");
-                poisoned.into_inner()
-            }
-        };
-
-        inner.subscribed
-    }).unwrap_or(false)
+    });
+    // Silently handle panics - destructor should not propagate panics
 }
 
-/* ───────────────────────────────────────────────
- * Namespace Announcement Discovery
- * ─────────────────────────────────────────────── */
-
-/// Subscribe to namespace announcements from other publishers.
-///
-/// Registers a callback to be invoked when the relay forwards ANNOUNCE messages
-/// from other publishers. This enables dynamic discovery of available namespaces
-/// without knowing them in advance.
-///
-/// **Current Limitations:**
-/// - Most relays (including Cloudflare) do not currently forward announcements
-///   to subscribers. This function prepares your application for future relay
-///   support of SUBSCRIBE_NAMESPACE or similar discovery mechanisms.
-/// - Until relay support is available, the callback will not be invoked.
+/// Publishes data to a track.
 ///
 /// # Safety
-/// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `client` must not be null
-/// - `callback` may be null (to unregister the callback)
-/// - `user_data` will be passed to the callback and may be null
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - `publisher` must not be null
+/// - `data` must be a valid pointer to a buffer of at least `data_len` bytes
+/// - `data` must not be null if `data_len` > 0
+/// - `data` may be null if `data_len` is 0
 /// - This function is thread-safe
+/// - Data is copied, so the buffer can be freed after this function returns
 ///
 /// # Parameters
-/// - `client`: Pointer to a connected MoQ client
-/// - `callback`: Callback for namespace announcements (NULL to unregister)
-/// - `user_data`: User data pointer passed to the callback
+/// - `publisher`: Pointer to the publisher
+/// - `data`: Pointer to the data buffer
+/// - `data_len`: Length of the data in bytes
+/// - `_delivery_mode`: Ignored (delivery mode is set at publisher creation)
 ///
 /// # Returns
-/// - `MoqOk` on success
-/// - `MoqErrorInvalidArgument` if client is null
-/// - `MoqErrorNotConnected` if client is not connected
+/// `MoqResult` with status code and error message (if any)
 #[no_mangle]
-pub unsafe extern "C" fn moq_subscribe_announces(
-    client: *mut MoqClient,
-    callback: MoqTrackCallback,
-    user_data: *mut std::ffi::c_void,
+pub unsafe extern "C" fn moq_publish_data(
+    publisher: *mut MoqPublisher,
+    data: *const u8,
+    data_len: usize,
+    _delivery_mode: MoqDeliveryMode,
 ) -> MoqResult {
     std::panic::catch_unwind(|| {
-        moq_subscribe_announces_impl(client, callback, user_data)
+        moq_publish_data_impl(publisher, data, data_len, None, &[])
     }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_subscribe_announces");
+        log::error!("Panic in moq_publish_data");
+        set_last_error("Internal panic occurred in moq_publish_data".to_string());
         make_error_result(
             MoqResultCode::MoqErrorInternal,
-            "Internal panic occurred in moq_subscribe_announces",
+            "Internal panic occurred"
         )
     })
 }
 
-unsafe fn moq_subscribe_announces_impl(
-    client: *mut MoqClient,
-    callback: MoqTrackCallback,
-    user_data: *mut std::ffi::c_void,
+unsafe fn moq_publish_data_impl(
+    publisher: *mut MoqPublisher,
+    data: *const u8,
+    data_len: usize,
+    capture_time_us: Option<u64>,
+    extensions: &[object_header::Extension],
 ) -> MoqResult {
-    if client.is_null() {
+    if publisher.is_null() {
+        set_last_error("Publisher is null".to_string());
         return make_error_result(
             MoqResultCode::MoqErrorInvalidArgument,
-            "Client is null",
+            "Publisher is null",
         );
     }
 
-    let client_ref = &*client;
-    let inner_result = client_ref.inner.lock();
-    let mut inner = match inner_result {
+    // Validate data pointer with length check
+    if data.is_null() && data_len > 0 {
+        set_last_error("Data is null but data_len is non-zero".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Data is null but data_len is non-zero",
+        );
+    }
+
+    // Copy data to Bytes (handle empty data case)
+    // Note: data_len == 0 case already validated above (null with non-zero length rejected)
+    let data_bytes = if data_len == 0 {
+        bytes::Bytes::new()
+    } else {
+        let data_slice = std::slice::from_raw_parts(data, data_len);
+        bytes::Bytes::copy_from_slice(data_slice)
+    };
+
+    publish_payload(&(*publisher).inner, data_bytes, capture_time_us, extensions)
+}
+
+/// Sends one object on the publisher's track.
+///
+/// The object's header carries `extensions` and a capture time: the given
+/// one, else one among the extensions, else its publish time if the
+/// publisher stamps every object.
+fn publish_payload(
+    publisher: &Mutex<PublisherInner>,
+    data_bytes: bytes::Bytes,
+    capture_time_us: Option<u64>,
+    extensions: &[object_header::Extension],
+) -> MoqResult {
+    let mut inner = match publisher.lock() {
         Ok(guard) => guard,
         Err(poisoned) => {
-            log::warn!("Mutex poisoned in moq_subscribe_announces, recovering");
+            log::warn!("Mutex poisoned in moq_publish_data, recovering");
             poisoned.into_inner()
         }
     };
+    let data_len = data_bytes.len();
 
-    // Store the callback (can be None to unregister)
-    inner.announce_callback = callback;
-    inner.announce_user_data = user_data as usize;
-
-    // If unregistering (callback is None), cancel any existing announce task
-    if callback.is_none() {
-        if let Some(task) = inner.announce_task.take() {
-            task.abort();
-            log::info!("Unregistered announce callback, cancelled listener task");
-        }
-        return make_ok_result();
-    }
-
-    // If not connected, just store the callback for when we connect
-    if !inner.connected {
-        log::info!("Announce callback registered (will activate on connect)");
-        return make_ok_result();
-    }
-
-    // If already have an announce task running, it will pick up the new callback
-    if inner.announce_task.is_some() {
-        log::info!("Updated announce callback (existing listener active)");
-        return make_ok_result();
+    if (!extensions.is_empty() || capture_time_us.is_some()) && !inner.inband_headers {
+        let e = "Extension headers and timestamps need in-band headers, see moq_client_set_inband_headers()";
+        set_last_error(e.to_string());
+        return make_error_result(MoqResultCode::MoqErrorUnsupported, e);
     }
-
-    // Get the subscriber to listen for announces
-    let subscriber = match inner.subscriber.as_ref() {
-        Some(s) => s.clone(),
-        None => {
-            log::warn!("No subscriber available for announce listening");
-            return make_ok_result(); // Not an error, just no subscriber role
+    let capture_time_us = capture_time_us
+        .or_else(|| extensions.iter().find(|e| e.key == object_header::CAPTURE_TIMESTAMP).map(|e| e.value))
+        .or_else(|| inner.timestamps.then(clock_sync::wallclock_us));
+    let header = match object_header::encode_stamped(capture_time_us, extensions) {
+        Ok(header) => header,
+        Err(e) => {
+            set_last_error(e.clone());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &e);
         }
     };
 
-    // Clone what we need for the async task
-    let client_inner = client_ref.inner.clone();
-
-    // Spawn task to listen for announces
-    let announce_task = RUNTIME.spawn(async move {
-        let mut subscriber = subscriber;
-        
-        log::info!("Starting announce listener task");
-        
-        // Listen for announced namespaces
-        // Note: Most relays don't forward announces to subscribers yet,
-        // so this loop may never receive any announcements.
-        while let Some(mut announced) = subscriber.announced().await {
-            let namespace = announced.namespace.to_utf8_path();
-            log::info!("Received namespace announcement: {}", namespace);
-
-            // Get the callback from client inner
-            let (callback, user_data) = {
-                let inner_result = client_inner.lock();
-                let inner = match inner_result {
-                    Ok(guard) => guard,
-                    Err(poisoned) => {
-                        log::warn!("Mutex poisoned in announce listener, recovering");
-                        poisoned.into_inner()
-                    }
-                };
-                (inner.announce_callback, inner.announce_user_data)
+    let namespace = inner.namespace.clone();
+    let track_name = inner.track_name.clone();
+    
+    // Get counter value before borrowing mode
+    let counter_val = inner.group_id_counter.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+    
+    // Publish data based on mode
+    // Following moq-pub pattern: use subgroups.append() then subgroup.write()
+    let result = match &mut inner.mode {
+        PublisherMode::Datagrams(datagrams) => {
+            // A datagram is a single chunk, so a header has to be joined to the payload
+            let data_bytes = match header {
+                Some(header) => [header.as_slice(), &data_bytes].concat().into(),
+                None => data_bytes,
             };
 
-            // Invoke callback if registered
-            if let Some(cb) = callback {
-                let namespace_cstr = match std::ffi::CString::new(namespace.clone()) {
-                    Ok(s) => s,
-                    Err(_) => {
-                        log::error!("Invalid namespace string (contains null byte)");
-                        continue;
-                    }
-                };
-
-                let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
-                    cb(
-                        user_data as *mut std::ffi::c_void,
-                        namespace_cstr.as_ptr(),
-                        std::ptr::null(), // track_name is null for namespace announcements
-                    );
-                }));
-            }
-
-            // Accept the announcement (required by protocol)
-            if let Err(e) = announced.ok() {
-                log::warn!("Failed to accept announcement for {}: {}", namespace, e);
+            // Create a datagram with metadata
+            #[cfg(feature = "with_moq")]
+            let datagram = serve::Datagram {
+                group_id: 0,
+                object_id: counter_val,
+                priority: 0,
+                payload: data_bytes,
+            };
+            
+            #[cfg(feature = "with_moq_draft07")]
+            let datagram = serve::Datagram {
+                group_id: 0,
+                object_id: counter_val,
+                priority: 0,
+                status: moq::data::ObjectStatus::Object,
+                payload: data_bytes,
+            };
+            
+            datagrams.write(datagram)
+                .map_err(|e| format!("Failed to write datagram: {}", e))
+                .map(|_| {
+                    log::debug!("Published {} bytes to {:?}/{} via datagram", data_len, namespace, track_name);
+                })
+        }
+        PublisherMode::Subgroups(subgroups) => {
+            // Following moq-pub pattern:
+            // 1. Create a new subgroup with append(priority)
+            // 2. Write data to it with write()
+            // For simplicity, create a new subgroup for each publish (like moq-pub does for keyframes)
+            let priority: u8 = 127; // Same as moq-pub uses
+            
+            match subgroups.append(priority) {
+                Ok(mut subgroup) => {
+                    write_object(&mut subgroup, header, data_bytes)
+                        .map_err(|e| format!("Failed to write to subgroup: {}", e))
+                        .map(|_| {
+                            log::debug!("Published {} bytes to {:?}/{} via subgroup", data_len, namespace, track_name);
+                        })
+                }
+                Err(e) => {
+                    Err(format!("Failed to create subgroup: {}", e))
+                }
             }
         }
+    };
 
-        log::info!("Announce listener task ended");
-    });
-
-    inner.announce_task = Some(announce_task);
-    log::info!("Announce callback registered and listener started");
-
-    make_ok_result()
+    match result {
+        Ok(()) => make_ok_result(),
+        Err(e) => {
+            set_last_error(e.clone());
+            make_error_result(MoqResultCode::MoqErrorInternal, &e)
+        }
+    }
 }
 
-/* ───────────────────────────────────────────────
- * Catalog Subscription (Track Discovery)
- * ─────────────────────────────────────────────── */
+/// Writes one object to a subgroup, with the header (if any) as a chunk of
+/// its own ahead of the payload so the payload is not copied.
+fn write_object(
+    subgroup: &mut serve::SubgroupWriter,
+    header: Option<Vec<u8>>,
+    payload: bytes::Bytes,
+) -> Result<(), serve::ServeError> {
+    let Some(header) = header else {
+        return subgroup.write(payload);
+    };
+    let mut object = subgroup.create(header.len() + payload.len())?;
+    object.write(header.into())?;
+    if !payload.is_empty() {
+        object.write(payload)?;
+    }
+    Ok(())
+}
 
-/// Subscribe to a catalog track for automatic track discovery.
-/// 
-/// The catalog track should publish JSON data conforming to the MoQ catalog format
-/// (draft-ietf-moq-catalogformat). When catalog updates are received, the callback
-/// is invoked with the parsed track list.
-/// 
+/// Publishes data to a track, stamped with the time it was captured.
+///
+/// The capture time travels in the in-band object header at the start of
+/// the payload, so the client must have opted in with
+/// `moq_client_set_inband_headers()`. Subscribers that opted in too receive
+/// the payload without it; together with the clock offset they estimate to
+/// this publisher, it gives them the one-way latency of the object in
+/// `MoqObjectInfo`. Any other subscriber, including other MoQ
+/// implementations, receives the header as part of the payload.
+///
 /// # Safety
-/// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `namespace` must be a valid null-terminated C string
-/// - `catalog_track_name` must be a valid null-terminated C string
-/// - None of the above may be null
-/// - `callback` may be null (no callback will be invoked)
-/// - `user_data` will be passed to the callback and may be null
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - `data` must be a valid pointer to a buffer of at least `data_len` bytes (may be null if `data_len` is 0)
 /// - This function is thread-safe
-/// 
+/// - Data is copied, so the buffer can be freed after this function returns
+///
 /// # Parameters
-/// - `client`: Pointer to a connected MoQ client
-/// - `namespace`: Namespace containing the catalog track
-/// - `catalog_track_name`: Name of the catalog track (e.g., "catalog")
-/// - `callback`: Optional callback for track list updates
-/// - `user_data`: User data pointer passed to the callback
-/// 
-/// # Returns
-/// Subscriber handle for the catalog, or NULL on failure.
-/// The returned subscriber must be destroyed with `moq_subscriber_destroy()`.
+/// - `publisher`: Pointer to the publisher
+/// - `data`: Pointer to the data buffer
+/// - `data_len`: Length of the data in bytes
+/// - `capture_time_us`: Capture time in microseconds since the Unix epoch on
+///   this host's clock, or 0 to use the current time
+///
+/// # Returns
+/// `MoqResult` with status code and error message (if any);
+/// `MoqErrorUnsupported` if the publisher's client had not opted in to
+/// in-band headers when it was created
 #[no_mangle]
-pub unsafe extern "C" fn moq_subscribe_catalog(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-    catalog_track_name: *const c_char,
-    callback: MoqCatalogCallback,
-    user_data: *mut std::ffi::c_void,
-) -> *mut MoqSubscriber {
+pub unsafe extern "C" fn moq_publish_data_timestamped(
+    publisher: *mut MoqPublisher,
+    data: *const u8,
+    data_len: usize,
+    capture_time_us: u64,
+) -> MoqResult {
     std::panic::catch_unwind(|| {
-        moq_subscribe_catalog_impl(client, namespace, catalog_track_name, callback, user_data)
+        let capture_time_us = if capture_time_us == 0 { clock_sync::wallclock_us() } else { capture_time_us };
+        moq_publish_data_impl(publisher, data, data_len, Some(capture_time_us), &[])
     }).unwrap_or_else(|_| {
-        log::error!("Panic in moq_subscribe_catalog");
-        set_last_error("Internal panic occurred in moq_subscribe_catalog".to_string());
-        std::ptr::null_mut()
+        log::error!("Panic in moq_publish_data_timestamped");
+        set_last_error("Internal panic occurred in moq_publish_data_timestamped".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
     })
 }
 
-unsafe fn moq_subscribe_catalog_impl(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-    catalog_track_name: *const c_char,
-    callback: MoqCatalogCallback,
-    user_data: *mut std::ffi::c_void,
-) -> *mut MoqSubscriber {
-    // Validate arguments
-    if client.is_null() || namespace.is_null() || catalog_track_name.is_null() {
-        set_last_error("Client, namespace, or catalog_track_name is null".to_string());
-        return std::ptr::null_mut();
-    }
-
-    let namespace_str = match CStr::from_ptr(namespace).to_str() {
-        Ok(s) => s.to_string(),
-        Err(_) => {
-            set_last_error("Invalid UTF-8 in namespace".to_string());
-            return std::ptr::null_mut();
+/// Publishes data to a track with extension headers.
+///
+/// Each extension is a key with a number (`value`, for even keys) or bytes
+/// (`data`, for odd keys), carried in the in-band object header at the start
+/// of the payload, so the client must have opted in with
+/// `moq_client_set_inband_headers()`. Subscribers that opted in too receive
+/// the payload without it and the extensions in `MoqObjectInfo`, in the
+/// order given here; any other subscriber receives the header as part of
+/// the payload. Key 2 is the capture timestamp (see
+/// `moq_publish_data_timestamped()`); a publisher stamping every object uses
+/// the one given here instead of its publish time.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - `data` must be a valid pointer to a buffer of at least `data_len` bytes (may be null if `data_len` is 0)
+/// - `extensions` must point to `extension_count` extensions (may be null if the count is 0)
+/// - This function is thread-safe
+/// - Data and extensions are copied, so the buffers can be freed after this function returns
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if a pointer is null, a key or value is 2^62
+///   or more, or the extensions take more than 4096 bytes
+/// - `MoqErrorUnsupported` if there are extensions but the publisher's
+///   client had not opted in to in-band headers when it was created
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_data_ex(
+    publisher: *mut MoqPublisher,
+    data: *const u8,
+    data_len: usize,
+    extensions: *const MoqExtension,
+    extension_count: usize,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if extensions.is_null() && extension_count > 0 {
+            set_last_error("Extensions are null but extension_count is non-zero".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Extensions are null but extension_count is non-zero",
+            );
         }
-    };
-
-    let track_name_str = match CStr::from_ptr(catalog_track_name).to_str() {
-        Ok(s) => s.to_string(),
-        Err(_) => {
-            set_last_error("Invalid UTF-8 in catalog_track_name".to_string());
-            return std::ptr::null_mut();
+        let extensions = if extension_count == 0 { &[] } else { std::slice::from_raw_parts(extensions, extension_count) };
+        let mut pairs = Vec::with_capacity(extensions.len());
+        for extension in extensions {
+            let data = if extension.key % 2 == 0 || extension.data_len == 0 {
+                &[][..]
+            } else if extension.data.is_null() {
+                set_last_error(format!("Data of extension {} is null", extension.key));
+                return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Extension data is null");
+            } else {
+                std::slice::from_raw_parts(extension.data, extension.data_len)
+            };
+            pairs.push(object_header::Extension { key: extension.key, value: extension.value, data });
         }
-    };
+        moq_publish_data_impl(publisher, data, data_len, None, &pairs)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_publish_data_ex");
+        set_last_error("Internal panic occurred in moq_publish_data_ex".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
 
-    let client_ref = &*client;
-    let inner_result = client_ref.inner.lock();
-    let inner = match inner_result {
-        Ok(guard) => guard,
-        Err(poisoned) => {
-            log::warn!("Mutex poisoned in moq_subscribe_catalog, recovering");
-            poisoned.into_inner()
+/// Makes a publisher stamp every object it sends with its publish time.
+///
+/// Applies to every publish function; `moq_publish_data_timestamped()`
+/// still stamps its own capture time. Off by default. The stamp travels in
+/// the in-band object header, like `moq_publish_data_timestamped()`'s, so
+/// the publisher's client must have opted in to those.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if `publisher` is null
+/// - `MoqErrorUnsupported` if enabling it on a publisher whose client had not
+///   opted in to in-band headers when it was created
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_set_timestamps(publisher: *mut MoqPublisher, enabled: bool) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() {
+            set_last_error("Publisher is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Publisher is null");
         }
-    };
+        let mut inner = (*publisher).inner.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        if enabled && !inner.inband_headers {
+            let e = "Timestamps need in-band headers, see moq_client_set_inband_headers()";
+            set_last_error(e.to_string());
+            return make_error_result(MoqResultCode::MoqErrorUnsupported, e);
+        }
+        inner.timestamps = enabled;
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_publisher_set_timestamps");
+        set_last_error("Internal panic occurred in moq_publisher_set_timestamps".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
 
-    if !inner.connected {
-        set_last_error("Not connected to MoQ server".to_string());
-        return std::ptr::null_mut();
+/// Message of the flush functions, which only simulated sessions support.
+const FLUSH_UNSUPPORTED: &str =
+    "Publisher flush is only supported in simulated sessions: the transport does not expose its streams";
+
+/// Would report how many published bytes the relay has not yet acknowledged.
+///
+/// Quinn reports acknowledgements only per stream, and subgroup streams are
+/// opened inside moq-transport, out of reach of this library, so a
+/// publisher's share of the connection cannot be told apart from other
+/// traffic on it. Supported by the simulated backend only.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - `unacked_bytes` must be a valid pointer to a writable `u64`
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqErrorUnsupported`, leaving `unacked_bytes` untouched
+/// - `MoqErrorInvalidArgument` if `publisher` or `unacked_bytes` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_get_unacked_bytes(
+    publisher: *const MoqPublisher,
+    unacked_bytes: *mut u64,
+) -> MoqResult {
+    if publisher.is_null() || unacked_bytes.is_null() {
+        set_last_error("Publisher or unacked_bytes is null".to_string());
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Publisher or unacked_bytes is null");
     }
+    set_last_error(FLUSH_UNSUPPORTED.to_string());
+    make_error_result(MoqResultCode::MoqErrorUnsupported, FLUSH_UNSUPPORTED)
+}
 
-    // Parse namespace
-    let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
+/// Would wait until every object published so far has been acknowledged.
+///
+/// Not supported over the network, for the reasons given at
+/// `moq_publisher_get_unacked_bytes()`; `moq_disconnect_graceful()` drains
+/// a whole connection instead. Supported by the simulated backend only.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqErrorUnsupported`
+/// - `MoqErrorInvalidArgument` if `publisher` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_flush(publisher: *mut MoqPublisher, _timeout_ms: u64) -> MoqResult {
+    if publisher.is_null() {
+        set_last_error("Publisher is null".to_string());
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Publisher is null");
+    }
+    set_last_error(FLUSH_UNSUPPORTED.to_string());
+    make_error_result(MoqResultCode::MoqErrorUnsupported, FLUSH_UNSUPPORTED)
+}
 
-    // Get subscriber (we need to clone it to use in async context)
-    let subscriber_impl = match inner.subscriber.as_ref() {
-        Some(s) => s.clone(),
-        None => {
-            set_last_error("Subscriber not available".to_string());
-            return std::ptr::null_mut();
-        }
-    };
+/// Would start waiting for every object published so far to be acknowledged.
+///
+/// Not supported over the network, see `moq_publisher_flush()`. As with any
+/// error from this function, the completion callback is never invoked.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqErrorUnsupported`
+/// - `MoqErrorInvalidArgument` if `publisher` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_flush_async(
+    publisher: *mut MoqPublisher,
+    _timeout_ms: u64,
+    _completion_callback: MoqCompletionCallback,
+    _user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    moq_publisher_flush(publisher, 0)
+}
+
+/// Publishes a byte range of a file as one object without copying it.
+///
+/// The file is memory-mapped and the range is handed to the transport as a
+/// slice of the mapping, so on-demand assets are neither read into memory
+/// up front nor copied. The publisher keeps the most recent file mapped;
+/// publishing consecutive ranges of it triggers readahead of the next ranges.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - `path` must be a valid null-terminated C string pointer
+/// - The file must not be truncated or modified in place while ranges of it are being sent
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `publisher`: Pointer to the publisher
+/// - `path`: Path of the file
+/// - `offset`: Byte offset of the range within the file
+/// - `len`: Length of the range in bytes
+///
+/// # Returns
+/// `MoqResult` with status code and error message (if any)
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_file_range(
+    publisher: *mut MoqPublisher,
+    path: *const c_char,
+    offset: u64,
+    len: usize,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        moq_publish_file_range_impl(publisher, path, offset, len)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_publish_file_range");
+        set_last_error("Internal panic occurred in moq_publish_file_range".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
 
-    drop(inner);
+unsafe fn moq_publish_file_range_impl(
+    publisher: *mut MoqPublisher,
+    path: *const c_char,
+    offset: u64,
+    len: usize,
+) -> MoqResult {
+    if publisher.is_null() || path.is_null() {
+        set_last_error("Publisher or path is null".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Publisher or path is null",
+        );
+    }
 
-    // Create track subscription using the same pattern as moq_subscribe
-    let tracks = Tracks::new(track_namespace.clone());
-    let (mut tracks_writer, _tracks_request, mut tracks_reader) = tracks.produce();
-    
-    // Create track writer for the catalog track
-    let track_writer = match tracks_writer.create(&track_name_str) {
-        Some(tw) => tw,
-        None => {
-            set_last_error("Failed to create track writer for catalog (tracks closed)".to_string());
-            return std::ptr::null_mut();
+    let path = match CStr::from_ptr(path).to_str() {
+        Ok(s) => std::path::Path::new(s),
+        Err(_) => {
+            set_last_error("Invalid UTF-8 in path".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Invalid UTF-8 in path",
+            );
         }
     };
 
-    // Clone subscriber for the async task
-    let mut subscriber_for_task = subscriber_impl.clone();
-    let track_name_for_task = track_name_str.clone();
-    
-    // Spawn task to send subscribe request to relay
-    RUNTIME.spawn(async move {
-        if let Err(err) = subscriber_for_task.subscribe(track_writer).await {
-            log::warn!("Failed to subscribe to catalog track {}: {}", track_name_for_task, err);
-        }
-    });
+    let publisher_ref = &*publisher;
+    let payload = {
+        let mut file = match publisher_ref.file.lock() {
+            Ok(guard) => guard,
+            Err(poisoned) => poisoned.into_inner(),
+        };
 
-    // Get the track reader from TracksReader
-    let track_reader = match tracks_reader.subscribe(&track_name_str) {
-        Some(tr) => tr,
-        None => {
-            set_last_error("Failed to get track reader for catalog (no track available)".to_string());
-            return std::ptr::null_mut();
+        let metadata = match std::fs::metadata(path) {
+            Ok(metadata) => metadata,
+            Err(e) => {
+                let msg = format!("Failed to open {}: {}", path.display(), e);
+                set_last_error(msg.clone());
+                return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &msg);
+            }
+        };
+        let end = offset.checked_add(len as u64);
+        if end.is_none_or(|end| end > metadata.len()) {
+            let msg = format!("Range {}+{} exceeds the size of {} ({} bytes)", offset, len, path.display(), metadata.len());
+            set_last_error(msg.clone());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &msg);
         }
-    };
-
-    // Create subscriber with catalog-specific data callback
-    let subscriber_inner = Arc::new(Mutex::new(SubscriberInner {
-        namespace: track_namespace.clone(),
-        track_name: track_name_str.clone(),
-        data_callback: None, // We use catalog callback instead
-        user_data: user_data as usize,
-        track: Some(track_reader.clone()),
-        reader_task: None,
-        subscribed: true,
-    }));
 
-    // Clone values for the async task
-    let track_namespace_log = track_namespace.clone();
-    let track_name_log = track_name_str.clone();
-    let user_data_usize = user_data as usize;
-    
-    // Spawn task to read catalog data and parse it
-    let inner_clone = subscriber_inner.clone();
-    let reader_task = RUNTIME.spawn(async move {
-        let track = {
-            match inner_clone.lock() {
-                Ok(inner) => match inner.track.clone() {
-                    Some(t) => t,
-                    None => {
-                        log::error!("Track reader not available (unsubscribed?)");
-                        return;
-                    }
-                },
+        if !file.as_ref().is_some_and(|f| f.is_current(path, &metadata)) {
+            match MappedFile::open(path, &metadata) {
+                Ok(mapped) => *file = Some(mapped),
                 Err(e) => {
-                    log::error!("Failed to lock subscriber mutex: {}", e);
-                    return;
+                    let msg = format!("Failed to map {}: {}", path.display(), e);
+                    set_last_error(msg.clone());
+                    return make_error_result(MoqResultCode::MoqErrorInternal, &msg);
                 }
             }
-        };
+        }
+        file.as_mut().expect("mapped file").range(offset as usize, len)
+    };
 
-        log::debug!("Starting catalog reader for {:?}/{}", track_namespace_log, track_name_log);
+    publish_payload(&publisher_ref.inner, payload, None, &[])
+}
 
-        // Get the mode - following moq-sub pattern
-        let mode_result = track.mode().await;
-        match mode_result {
-            Ok(mode) => {
-                use moq::serve::TrackReaderMode;
-                
-                match mode {
-                    TrackReaderMode::Subgroups(mut groups) => {
-                        log::debug!("Catalog {:?}/{} using Subgroups mode", track_namespace_log, track_name_log);
-                        while let Ok(Some(mut group)) = groups.next().await {
-                            while let Ok(Some(mut object)) = group.next().await {
-                                // Read the complete catalog object
-                                let mut buf = Vec::with_capacity(object.size);
-                                while let Ok(Some(chunk)) = object.read().await {
-                                    buf.extend_from_slice(&chunk);
-                                }
-                                
-                                if !buf.is_empty() {
-                                    // Parse catalog and invoke callback
-                                    parse_and_invoke_catalog_callback(
-                                        &buf,
-                                        callback,
-                                        user_data_usize,
-                                        &track_namespace_log,
-                                        &track_name_log,
-                                    );
-                                }
-                            }
-                        }
-                        log::debug!("Catalog {:?}/{} subgroups ended", track_namespace_log, track_name_log);
-                    }
-                    TrackReaderMode::Stream(mut stream) => {
-                        log::debug!("Catalog {:?}/{} using Stream mode", track_namespace_log, track_name_log);
-                        while let Ok(Some(mut group)) = stream.next().await {
-                            while let Ok(Some(mut object)) = group.next().await {
-                                let mut buf = Vec::new();
-                                while let Ok(Some(chunk)) = object.read().await {
-                                    buf.extend_from_slice(&chunk);
-                                }
-                                
-                                if !buf.is_empty() {
-                                    parse_and_invoke_catalog_callback(
-                                        &buf,
-                                        callback,
-                                        user_data_usize,
-                                        &track_namespace_log,
-                                        &track_name_log,
-                                    );
-                                }
-                            }
-                        }
-                        log::debug!("Catalog {:?}/{} stream ended", track_namespace_log, track_name_log);
-                    }
-                    TrackReaderMode::Datagrams(mut datagrams) => {
-                        log::debug!("Catalog {:?}/{} using Datagrams mode", track_namespace_log, track_name_log);
-                        while let Ok(Some(datagram)) = datagrams.read().await {
-                            let buf = datagram.payload.to_vec();
-                            if !buf.is_empty() {
-                                parse_and_invoke_catalog_callback(
-                                    &buf,
-                                    callback,
-                                    user_data_usize,
-                                    &track_namespace_log,
-                                    &track_name_log,
-                                );
-                            }
-                        }
-                        log::debug!("Catalog {:?}/{} datagrams ended", track_namespace_log, track_name_log);
-                    }
-                }
-            }
-            Err(e) => {
-                log::error!("Failed to get track mode for catalog {:?}/{}: {}", track_namespace_log, track_name_log, e);
-            }
+/// Acquires a writable buffer from the publisher's pool.
+///
+/// The application serializes its object directly into `data` and then
+/// passes the slot to `moq_publish_commit()`, which sends the written bytes
+/// without copying them. Every acquired slot must be either committed or
+/// handed to `moq_publish_release()`.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()` or `moq_create_publisher_ex()`
+/// - `publisher` must not be null
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `publisher`: Pointer to the publisher
+/// - `size`: Number of bytes the application intends to write
+///
+/// # Returns
+/// A slot with at least `size` bytes of capacity, or a slot with a null
+/// `data` pointer on error (check `moq_last_error()` for details)
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_acquire(
+    publisher: *mut MoqPublisher,
+    size: usize,
+) -> MoqWriteSlot {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() {
+            set_last_error("Publisher is null".to_string());
+            return MoqWriteSlot::empty();
+        }
+
+        let publisher_ref = &*publisher;
+        let mut block = publisher_ref.pool.acquire(size);
+        let data = block.spare_capacity_mut().as_mut_ptr() as *mut u8;
+        let capacity = block.capacity();
+        let pending = Box::new(PendingWrite {
+            publisher: Arc::clone(&publisher_ref.inner),
+            pool: Arc::clone(&publisher_ref.pool),
+            block,
+        });
+
+        MoqWriteSlot {
+            data,
+            capacity,
+            reserved: Box::into_raw(pending) as *mut std::ffi::c_void,
         }
-    });
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_publish_acquire");
+        set_last_error("Internal panic occurred in moq_publish_acquire".to_string());
+        MoqWriteSlot::empty()
+    })
+}
 
-    // Store reader task
-    {
-        let inner_result = subscriber_inner.lock();
-        let mut inner = match inner_result {
-            Ok(guard) => guard,
-            Err(poisoned) => {
-                log::warn!("Mutex poisoned when storing reader task, recovering");
-                poisoned.into_inner()
-            }
-        };
-        inner.reader_task = Some(reader_task);
-    }
+/// Publishes the first `used_len` bytes of an acquired slot.
+///
+/// The written bytes are frozen in place and sent as one object; the unused
+/// remainder of the buffer returns to the publisher's pool. On success the
+/// slot is reset to empty and must not be used again.
+///
+/// # Safety
+/// - `slot` must point to a slot returned from `moq_publish_acquire()`
+/// - The first `used_len` bytes at `slot->data` must have been written
+/// - A slot must not be committed from two threads at once
+///
+/// # Parameters
+/// - `slot`: Pointer to the acquired slot
+/// - `used_len`: Number of bytes written, at most `slot->capacity`
+///
+/// # Returns
+/// `MoqResult` with status code and error message (if any). If `used_len`
+/// exceeds the capacity the slot is left untouched so it can still be
+/// released; any other failure consumes the slot.
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_commit(
+    slot: *mut MoqWriteSlot,
+    used_len: usize,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if slot.is_null() || (*slot).reserved.is_null() {
+            set_last_error("Write slot is null or already consumed".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Write slot is null or already consumed",
+            );
+        }
+        if used_len > (*slot).capacity {
+            set_last_error("used_len exceeds the slot capacity".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "used_len exceeds the slot capacity",
+            );
+        }
 
-    let subscriber = MoqSubscriber {
-        inner: subscriber_inner,
-    };
+        let mut pending = Box::from_raw((*slot).reserved as *mut PendingWrite);
+        *slot = MoqWriteSlot::empty();
 
-    log::info!("Subscribed to catalog {}/{}", namespace_str, track_name_str);
-    Box::into_raw(Box::new(subscriber))
+        // The application has initialized these bytes through the slot pointer
+        pending.block.set_len(used_len);
+        let payload = pending.block.split_to(used_len).freeze();
+        pending.pool.release(pending.block);
+
+        publish_payload(&pending.publisher, payload, None, &[])
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_publish_commit");
+        set_last_error("Internal panic occurred in moq_publish_commit".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
 }
 
-/// Helper function to parse catalog JSON and invoke the callback.
-/// 
-/// This function handles:
-/// - JSON parsing using serde_json and moq_catalog::Root
-/// - Converting moq_catalog::Track to MoqTrackInfo for FFI
-/// - String allocation for C-compatible strings
-/// - Callback invocation with panic protection
-/// - Proper cleanup of allocated strings
-fn parse_and_invoke_catalog_callback(
-    data: &[u8],
-    callback: MoqCatalogCallback,
-    user_data: usize,
-    namespace: &TrackNamespace,
-    track_name: &str,
-) {
-    // Skip if no callback
-    let callback_fn = match callback {
-        Some(cb) => cb,
-        None => {
-            log::debug!("No catalog callback set, skipping");
+/// Returns an acquired slot to the pool without publishing anything.
+///
+/// # Safety
+/// - `slot` must be null or point to a slot returned from `moq_publish_acquire()`
+/// - Empty or already consumed slots are safely ignored
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_release(slot: *mut MoqWriteSlot) {
+    let _ = std::panic::catch_unwind(|| {
+        if slot.is_null() || (*slot).reserved.is_null() {
             return;
         }
+        let pending = Box::from_raw((*slot).reserved as *mut PendingWrite);
+        *slot = MoqWriteSlot::empty();
+        pending.pool.release(pending.block);
+    });
+    // Silently handle panics - destructor should not propagate panics
+}
+
+/* ───────────────────────────────────────────────
+ * Subscribing
+ * ─────────────────────────────────────────────── */
+
+/// Subscribes to a track on the MoQ relay server.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `client` must not be null
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `namespace` must not be null
+/// - `track_name` must be a valid null-terminated C string pointer
+/// - `track_name` must not be null
+/// - `data_callback` may be null (no data will be received)
+/// - `user_data` will be passed to the callback and may be null
+/// - Client must be connected
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Namespace string (slash-separated path)
+/// - `track_name`: Track name string
+/// - `data_callback`: Optional callback for received data
+/// - `user_data`: User data pointer passed to the callback
+///
+/// # Returns
+/// Pointer to the created subscriber, or null on failure
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    data_callback: MoqDataCallback,
+    user_data: *mut std::ffi::c_void,
+) -> *mut MoqSubscriber {
+    std::panic::catch_unwind(|| {
+        moq_subscribe_impl(client, namespace, track_name, DataDelivery::Object(data_callback), user_data)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscribe");
+        set_last_error("Internal panic occurred in moq_subscribe".to_string());
+        std::ptr::null_mut()
+    })
+}
+
+unsafe fn moq_subscribe_impl(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    delivery: DataDelivery,
+    user_data: *mut std::ffi::c_void,
+) -> *mut MoqSubscriber {
+    if client.is_null() || namespace.is_null() || track_name.is_null() {
+        set_last_error("Client, namespace, or track_name is null".to_string());
+        return std::ptr::null_mut();
+    }
+
+    let namespace_str = match CStr::from_ptr(namespace).to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            set_last_error("Invalid UTF-8 in namespace".to_string());
+            return std::ptr::null_mut();
+        }
     };
 
-    // Try to parse as UTF-8 string first
-    let json_str = match std::str::from_utf8(data) {
-        Ok(s) => s,
-        Err(e) => {
-            log::warn!("Catalog data for {:?}/{} is not valid UTF-8: {}", namespace, track_name, e);
-            return;
+    let track_name_str = match CStr::from_ptr(track_name).to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            set_last_error("Invalid UTF-8 in track_name".to_string());
+            return std::ptr::null_mut();
         }
     };
 
-    // Parse catalog JSON using moq_catalog crate
-    let catalog: moq_catalog::Root = match serde_json::from_str(json_str) {
-        Ok(cat) => cat,
+    // Parse namespace
+    let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
+
+    let track_reader = match subscribe_track(&(*client).inner, &track_namespace, &track_name_str) {
+        Ok(reader) => reader,
         Err(e) => {
-            log::warn!("Failed to parse catalog JSON for {:?}/{}: {}", namespace, track_name, e);
-            log::debug!("Catalog JSON (first 500 chars): {:.500}", json_str);
-            return;
+            set_last_error(e);
+            return std::ptr::null_mut();
         }
     };
 
-    log::debug!(
-        "Parsed catalog v{} with {} tracks for {:?}/{}",
-        catalog.version,
-        catalog.tracks.len(),
-        namespace,
-        track_name
+    let clock = (*client).inner.peer_clock(&track_namespace);
+    let subscriber = spawn_track_subscriber(
+        track_namespace,
+        &track_name_str,
+        track_reader,
+        delivery,
+        user_data as usize,
+        clock,
+        (*client).inner.inband_headers(),
     );
 
-    // Convert tracks to MoqTrackInfo structs for FFI
-    // We need to keep CStrings alive until after the callback
-    let mut c_strings: Vec<CString> = Vec::new();
-    let mut track_infos: Vec<MoqTrackInfo> = Vec::with_capacity(catalog.tracks.len());
-
-    for track in &catalog.tracks {
-        // Allocate C strings - we'll clean these up after the callback
-        let name_cstr = CString::new(track.name.as_str())
-            .unwrap_or_else(|_| CString::new("").unwrap());
-        let name_ptr = name_cstr.as_ptr();
-        c_strings.push(name_cstr);
+    log::info!("Subscribed to {}/{}", namespace_str, track_name_str);
+    Box::into_raw(Box::new(subscriber))
+}
 
-        let codec_ptr = if let Some(ref codec) = track.selection_params.codec {
-            let cstr = CString::new(codec.as_str())
-                .unwrap_or_else(|_| CString::new("").unwrap());
-            let ptr = cstr.as_ptr();
-            c_strings.push(cstr);
-            ptr
-        } else {
-            std::ptr::null()
-        };
+/// Sends a SUBSCRIBE for one track and returns the reader its objects arrive on.
+fn subscribe_track(
+    client: &ClientInner,
+    track_namespace: &TrackNamespace,
+    track_name: &str,
+) -> Result<serve::TrackReader, String> {
+    // Get subscriber (cloned from the session handles without locking the client)
+    let subscriber_impl = match client.session() {
+        Some(session) => session.subscriber.clone(),
+        None => return Err("Not connected to MoQ server".to_string()),
+    };
 
-        let mime_type_ptr = if let Some(ref mime) = track.selection_params.mime_type {
-            let cstr = CString::new(mime.as_str())
-                .unwrap_or_else(|_| CString::new("").unwrap());
-            let ptr = cstr.as_ptr();
-            c_strings.push(cstr);
-            ptr
-        } else {
-            std::ptr::null()
+    // Following moq-sub pattern:
+    // 1. Create a Tracks for the namespace we want to subscribe to
+    // 2. Call tracks.produce() to get (TracksWriter, TracksRequest, TracksReader)
+    // 3. Use TracksWriter.create() to create a track entry
+    // 4. Call subscriber.subscribe(track_writer) to register subscription with relay
+    // 5. Use TracksReader.subscribe() to get the TrackReader for receiving data
+    
+    let tracks = Tracks::new(track_namespace.clone());
+    let (mut tracks_writer, _tracks_request, mut tracks_reader) = tracks.produce();
+    
+    // Create track writer for this specific track
+    let track_writer = match tracks_writer.create(track_name) {
+        Some(tw) => tw,
+        None => return Err("Failed to create track writer (tracks closed)".to_string()),
+    };
+
+    // Clone subscriber for the async task
+    let mut subscriber_for_task = subscriber_impl.clone();
+    let track_name_for_task = track_name.to_string();
+    
+    // Spawn task to send subscribe request to relay (async, non-blocking)
+    // This follows the moq-sub pattern where subscribe is spawned as a task
+    RUNTIME.spawn(async move {
+        if let Err(err) = subscriber_for_task.subscribe(track_writer).await {
+            log::warn!("Failed to subscribe to track {}: {}", track_name_for_task, err);
+        }
+    });
+
+    // Get the track reader from TracksReader - this will block until the track is available
+    tracks_reader
+        .subscribe(track_name)
+        .ok_or_else(|| "Failed to get track reader (no track available)".to_string())
+}
+
+/// Clock exchanges at the start, spaced `CLOCK_BURST_INTERVAL` apart, so the
+/// first estimate is available quickly and has a few samples to choose from.
+const CLOCK_BURST: u32 = 4;
+const CLOCK_BURST_INTERVAL: Duration = Duration::from_millis(250);
+
+/// Spacing of clock exchanges after the burst, to follow clock drift.
+const CLOCK_SYNC_INTERVAL: Duration = Duration::from_secs(10);
+
+/// How long a clock exchange may take before it is given up.
+const CLOCK_EXCHANGE_TIMEOUT: Duration = Duration::from_secs(2);
+
+/// How long a publisher keeps a clock response available after sending it.
+const CLOCK_RESPONSE_LINGER: Duration = Duration::from_secs(1);
+
+/// Offset to the clock of the publisher behind one namespace.
+///
+/// Exchanges with the publisher start once a subscriber receives an object
+/// with a capture timestamp from it, and run until the client disconnects.
+struct PeerClock {
+    client: std::sync::Weak<ClientInner>,
+    namespace: TrackNamespace,
+    started: std::sync::atomic::AtomicBool,
+    estimator: Mutex<clock_sync::Estimator>,
+    task: Mutex<Option<tokio::task::JoinHandle<()>>>,
+}
+
+impl PeerClock {
+    fn new(client: std::sync::Weak<ClientInner>, namespace: TrackNamespace) -> Self {
+        PeerClock {
+            client,
+            namespace,
+            started: std::sync::atomic::AtomicBool::new(false),
+            estimator: Mutex::new(clock_sync::Estimator::default()),
+            task: Mutex::new(None),
+        }
+    }
+
+    /// Starts the exchanges unless they are running.
+    fn start(self: &Arc<Self>) {
+        if self.started.swap(true, Ordering::AcqRel) {
+            return;
+        }
+        log::debug!("Estimating clock offset to the publisher of {:?}", self.namespace);
+        let task = RUNTIME.spawn(sync_clock(Arc::downgrade(self)));
+        *self.task.lock().unwrap_or_else(|poisoned| poisoned.into_inner()) = Some(task);
+    }
+
+    fn stop(&self) {
+        if let Some(task) = self.task.lock().unwrap_or_else(|poisoned| poisoned.into_inner()).take() {
+            task.abort();
+        }
+    }
+
+    /// Publisher clock minus this host's clock, or None before the first exchange.
+    fn offset_us(&self) -> Option<i64> {
+        self.estimator.lock().unwrap_or_else(|poisoned| poisoned.into_inner()).offset_us()
+    }
+}
+
+/// Runs clock exchanges for `clock` until it or its client is gone.
+async fn sync_clock(clock: std::sync::Weak<PeerClock>) {
+    for round in 1u32.. {
+        {
+            let Some(peer) = clock.upgrade() else { return };
+            let Some(client) = peer.client.upgrade() else { return };
+            match timeout(CLOCK_EXCHANGE_TIMEOUT, clock_exchange(&client, &peer.namespace)).await {
+                Ok(Ok(sample)) => {
+                    log::trace!("Clock sample for {:?}: {:?}", peer.namespace, sample);
+                    peer.estimator.lock().unwrap_or_else(|poisoned| poisoned.into_inner()).add(sample);
+                }
+                Ok(Err(e)) => log::debug!("Clock exchange with {:?} failed: {}", peer.namespace, e),
+                Err(_) => log::debug!("Clock exchange with {:?} timed out", peer.namespace),
+            }
+        }
+        let pause = if round < CLOCK_BURST { CLOCK_BURST_INTERVAL } else { CLOCK_SYNC_INTERVAL };
+        tokio::time::sleep(pause).await;
+    }
+}
+
+/// Subscribes to a fresh clock track of `namespace` and times the publisher's answer.
+async fn clock_exchange(client: &ClientInner, namespace: &TrackNamespace) -> Result<clock_sync::Sample, String> {
+    let track_name = clock_sync::request_track();
+    let requested_us = clock_sync::wallclock_us();
+    let track = subscribe_track(client, namespace, &track_name)?;
+    let serve::TrackReaderMode::Subgroups(mut groups) = track.mode().await.map_err(|e| e.to_string())? else {
+        return Err("Clock track is not in subgroups mode".to_string());
+    };
+    let mut group = groups.next().await.map_err(|e| e.to_string())?.ok_or("Clock track ended")?;
+    let response = group.read_next().await.map_err(|e| e.to_string())?.ok_or("Clock group ended")?;
+    let received_us = clock_sync::wallclock_us();
+    let (answered_us, sent_us) = clock_sync::decode_response(&response).ok_or("Malformed clock response")?;
+    Ok(clock_sync::Sample::new(requested_us, answered_us, sent_us, received_us))
+}
+
+/// Subscribes to a track and delivers received objects in batches.
+///
+/// Objects that are ready at the same time are handed to `batch_callback` in
+/// one invocation. A batch is delivered when it holds `max_batch_objects`
+/// objects, when the next read would block and `max_batch_latency_us` has
+/// passed since its first object, or when the track ends.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `client` must not be null
+/// - `namespace` and `track_name` must be valid null-terminated C string pointers
+/// - `namespace` and `track_name` must not be null
+/// - `batch_callback` may be null (no data will be received)
+/// - `user_data` will be passed to the callback and may be null
+/// - Client must be connected
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Namespace string (slash-separated path)
+/// - `track_name`: Track name string
+/// - `batch_callback`: Optional callback receiving arrays of objects
+/// - `user_data`: User data pointer passed to the callback
+/// - `max_batch_objects`: Maximum objects per batch (0 selects the default of 64)
+/// - `max_batch_latency_us`: How long a started batch may wait for more objects
+///   (0 delivers whatever is ready without waiting)
+///
+/// # Returns
+/// Pointer to the created subscriber, or null on failure
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe_batched(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    batch_callback: MoqBatchCallback,
+    user_data: *mut std::ffi::c_void,
+    max_batch_objects: usize,
+    max_batch_latency_us: u32,
+) -> *mut MoqSubscriber {
+    std::panic::catch_unwind(|| {
+        let limits = BatchLimits::new(max_batch_objects, max_batch_latency_us);
+        moq_subscribe_impl(client, namespace, track_name, DataDelivery::Batch(batch_callback, limits), user_data)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscribe_batched");
+        set_last_error("Internal panic occurred in moq_subscribe_batched".to_string());
+        std::ptr::null_mut()
+    })
+}
+
+/// Subscribes to a track and queues received objects until they are pulled.
+///
+/// Instead of invoking a callback, the subscriber holds up to
+/// `max_queued_objects` objects (the oldest are dropped beyond that) for
+/// `moq_subscriber_next()`. This suits coroutine and event-loop consumers that
+/// want to wait for data without blocking a thread.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` and `track_name` must be valid null-terminated C string pointers
+/// - Client must be connected
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Namespace string (slash-separated path)
+/// - `track_name`: Track name string
+/// - `max_queued_objects`: Queue capacity (0 selects the default of 256)
+///
+/// # Returns
+/// Pointer to the created subscriber, or null on failure
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe_queued(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    max_queued_objects: usize,
+) -> *mut MoqSubscriber {
+    std::panic::catch_unwind(|| {
+        moq_subscribe_impl(client, namespace, track_name, DataDelivery::Queue(max_queued_objects), std::ptr::null_mut())
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscribe_queued");
+        set_last_error("Internal panic occurred in moq_subscribe_queued".to_string());
+        std::ptr::null_mut()
+    })
+}
+
+/// Wraps a track reader in a subscriber handle and spawns the task that
+/// delivers its objects according to `delivery`.
+///
+/// Shared by the single, batched and bulk subscribe paths.
+fn spawn_track_subscriber(
+    track_namespace: TrackNamespace,
+    track_name: &str,
+    track_reader: serve::TrackReader,
+    delivery: DataDelivery,
+    user_data: usize,
+    clock: Arc<PeerClock>,
+    inband_headers: bool,
+) -> MoqSubscriber {
+    // Create subscriber and spawn task to read incoming data
+    let subscriber_inner = Arc::new(Mutex::new(SubscriberInner {
+        namespace: track_namespace.clone(),
+        track_name: track_name.to_string(),
+        track: Some(track_reader.clone()),
+        reader_task: None,
+        subscribed: true,
+    }));
+    let callback_cell: Arc<DataCallbackCell> = Arc::new(ArcSwapOption::empty());
+    if delivery.is_set() {
+        callback_cell.store(Some(Arc::new(CallbackSlot { callback: delivery, user_data })));
+    }
+
+    // Spawn task to read data from track
+    let cache_cell: Arc<GroupCacheCell> = Arc::new(ArcSwapOption::empty());
+    let queue: Arc<ReceivedQueue> = Arc::new(ObjectQueue::new());
+    let mut sink = ObjectSink::new(callback_cell.clone())
+        .with_cache(cache_cell.clone())
+        .with_queue(queue.clone())
+        .with_clock(clock);
+    let track_name_log = track_name.to_string();
+    let reader_queue = queue.clone();
+    let reader_inner = Arc::downgrade(&subscriber_inner);
+    let reader_task = RUNTIME.spawn(async move {
+        read_track(track_reader, &mut sink, inband_headers, &track_namespace, &track_name_log).await;
+        reader_queue.close();
+        // The track ended, on its own or with the session: report it
+        if let Some(inner) = reader_inner.upgrade() {
+            inner.lock().unwrap_or_else(|poisoned| poisoned.into_inner()).subscribed = false;
+        }
+    });
+
+    // Store reader task (with proper error handling)
+    {
+        let inner_result = subscriber_inner.lock();
+        let mut inner = match inner_result {
+            Ok(guard) => guard,
+            Err(poisoned) => {
+                log::warn!("Mutex poisoned when storing reader task, recovering");
+                poisoned.into_inner()
+            }
         };
+        inner.reader_task = Some(reader_task);
+    } // Drop the guard before moving subscriber_inner
 
-        let language_ptr = if let Some(ref lang) = track.selection_params.language {
-            let cstr = CString::new(lang.as_str())
-                .unwrap_or_else(|_| CString::new("").unwrap());
-            let ptr = cstr.as_ptr();
-            c_strings.push(cstr);
-            ptr
-        } else {
-            std::ptr::null()
+    MoqSubscriber {
+        inner: subscriber_inner,
+        callback: callback_cell,
+        cache: cache_cell,
+        queue,
+    }
+}
+
+/// Reads every object of a track into `sink` until the track ends; objects
+/// start with the in-band object header only if `inband_headers` is set.
+///
+/// Following the moq-sub pattern, the loop handles all three track modes.
+/// Every await goes through `sink.next_ready()`, so a sink that holds back
+/// objects can deliver them as soon as the next read would block.
+async fn read_track<S: TrackSink>(
+    track: serve::TrackReader,
+    sink: &mut S,
+    inband_headers: bool,
+    track_namespace_log: &TrackNamespace,
+    track_name_log: &str,
+) {
+    log::debug!("Starting track reader for {:?}/{}", track_namespace_log, track_name_log);
+
+    // Get the mode - following moq-sub pattern
+    let mode_result = track.mode().await;
+    match mode_result {
+        Ok(mode) => {
+            use moq::serve::TrackReaderMode;
+
+            match mode {
+                TrackReaderMode::Subgroups(mut groups) => {
+                    // Following moq-sub recv_track pattern exactly
+                    log::debug!("Track {:?}/{} using Subgroups mode", track_namespace_log, track_name_log);
+                    while let Ok(Some(mut group)) = sink.next_ready(groups.next()).await {
+                        log::trace!("Received group {} for {:?}/{}", group.group_id, track_namespace_log, track_name_log);
+                        // Following moq-sub recv_group pattern
+                        while let Ok(Some(mut object)) = sink.next_ready(group.next()).await {
+                            log::trace!("Received object {} in group {}", object.object_id, group.group_id);
+                            // Following moq-sub recv_object pattern
+                            let mut buf = Reassembly::new(group.group_id, object.object_id, object.size, inband_headers);
+                            while let Ok(Some(chunk)) = sink.next_ready(object.read()).await {
+                                buf.extend_from_slice(sink, &chunk);
+                            }
+                            let buf = buf.finish(sink);
+                            sink.push(buf);
+                        }
+                    }
+                    log::debug!("Track {:?}/{} subgroups ended", track_namespace_log, track_name_log);
+                }
+                TrackReaderMode::Stream(mut stream) => {
+                    log::debug!("Track {:?}/{} using Stream mode", track_namespace_log, track_name_log);
+                    while let Ok(Some(mut group)) = sink.next_ready(stream.next()).await {
+                        let group_id = group.group_id;
+                        while let Ok(Some(mut object)) = sink.next_ready(group.next()).await {
+                            let mut buf = Reassembly::new(group_id, object.object_id, object.size, inband_headers);
+                            while let Ok(Some(chunk)) = sink.next_ready(object.read()).await {
+                                buf.extend_from_slice(sink, &chunk);
+                            }
+                            let buf = buf.finish(sink);
+                            sink.push(buf);
+                        }
+                    }
+                    log::debug!("Track {:?}/{} stream ended", track_namespace_log, track_name_log);
+                }
+                TrackReaderMode::Datagrams(mut datagrams) => {
+                    log::debug!("Track {:?}/{} using Datagrams mode", track_namespace_log, track_name_log);
+                    while let Ok(Some(datagram)) = sink.next_ready(datagrams.read()).await {
+                        let mut buf = Reassembly::new(datagram.group_id, datagram.object_id, datagram.payload.len(), inband_headers);
+                        buf.extend_from_slice(sink, &datagram.payload);
+                        let buf = buf.finish(sink);
+                        sink.push(buf);
+                    }
+                    log::debug!("Track {:?}/{} datagrams ended", track_namespace_log, track_name_log);
+                }
+            }
+            sink.flush();
+        }
+        Err(e) => {
+            log::error!("Failed to get track mode for {:?}/{}: {}", track_namespace_log, track_name_log, e);
+        }
+    }
+}
+
+/// Destination of the objects read by `read_track()`.
+trait TrackSink {
+    type Buffer: PayloadBuffer;
+
+    /// Picks the buffer the `size` payload bytes of a new object are
+    /// reassembled into; `header` is what came ahead of them.
+    fn begin_object(&self, group_id: u64, object_id: u64, size: usize, header: ObjectHeader) -> Self::Buffer;
+
+    /// Takes a fully reassembled object.
+    fn push(&mut self, buffer: Self::Buffer);
+
+    /// How long the next read may block before held-back objects must be
+    /// flushed, or None if nothing is held back.
+    fn flush_deadline(&self) -> Option<Duration>;
+
+    /// Delivers everything held back.
+    fn flush(&mut self);
+
+    /// Awaits `fut`, first flushing held-back objects if `fut` is not ready
+    /// before the flush deadline.
+    async fn next_ready<F: std::future::Future>(&mut self, fut: F) -> F::Output {
+        use futures::FutureExt;
+
+        let deadline = match self.flush_deadline() {
+            Some(deadline) => deadline,
+            None => return fut.await,
         };
 
-        track_infos.push(MoqTrackInfo {
-            name: name_ptr,
-            codec: codec_ptr,
-            mime_type: mime_type_ptr,
-            width: track.selection_params.width.unwrap_or(0),
-            height: track.selection_params.height.unwrap_or(0),
-            bitrate: track.selection_params.bitrate.unwrap_or(0),
-            sample_rate: track.selection_params.samplerate.unwrap_or(0),
-            language: language_ptr,
-        });
+        let mut fut = std::pin::pin!(fut);
+        if let Some(output) = fut.as_mut().now_or_never() {
+            return output;
+        }
+
+        if !deadline.is_zero() {
+            if let Ok(output) = timeout(deadline, fut.as_mut()).await {
+                return output;
+            }
+        }
+
+        self.flush();
+        fut.await
     }
+}
 
-    // Invoke callback with panic protection
-    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
-        log::debug!("Invoking catalog callback with {} tracks", track_infos.len());
-        // Safety: callback_fn is a C function pointer, user_data is provided by caller
-        unsafe {
-            callback_fn(
-                user_data as *mut std::ffi::c_void,
-                if track_infos.is_empty() { std::ptr::null() } else { track_infos.as_ptr() },
-                track_infos.len(),
+/// Buffer an object's payload chunks are appended to.
+trait PayloadBuffer {
+    fn extend_from_slice(&mut self, chunk: &[u8]);
+}
+
+/// One object being read by `read_track()`, split into header and payload.
+///
+/// The sink's buffer is only requested once the start of the object shows
+/// whether it has a header, which is normally the first chunk; chunks are
+/// held back only while a header is still incomplete. Without in-band
+/// headers the object is all payload and goes to the buffer as it arrives.
+struct Reassembly<B> {
+    group_id: u64,
+    object_id: u64,
+    size: usize,
+    inband_headers: bool,
+    // Leading bytes that may still turn out to be a header
+    head: Vec<u8>,
+    buffer: Option<B>,
+}
+
+impl<B: PayloadBuffer> Reassembly<B> {
+    fn new(group_id: u64, object_id: u64, size: usize, inband_headers: bool) -> Self {
+        Reassembly { group_id, object_id, size, inband_headers, head: Vec::new(), buffer: None }
+    }
+
+    fn extend_from_slice<S: TrackSink<Buffer = B>>(&mut self, sink: &S, chunk: &[u8]) {
+        if let Some(buffer) = self.buffer.as_mut() {
+            buffer.extend_from_slice(chunk);
+            return;
+        }
+        if !self.inband_headers {
+            self.begin(sink, object_header::Split::Plain, chunk);
+            return;
+        }
+        if self.head.is_empty() {
+            match object_header::split(chunk) {
+                object_header::Split::Incomplete => self.head.extend_from_slice(chunk),
+                split => self.begin(sink, split, chunk),
+            }
+            return;
+        }
+        self.head.extend_from_slice(chunk);
+        match object_header::split(&self.head) {
+            object_header::Split::Incomplete => {}
+            split => {
+                let head = std::mem::take(&mut self.head);
+                self.begin(sink, split, &head);
+            }
+        }
+    }
+
+    /// Returns the buffer holding the complete payload.
+    fn finish<S: TrackSink<Buffer = B>>(mut self, sink: &S) -> B {
+        if self.buffer.is_none() {
+            // The object ended while it could still have been a header, so it is all payload
+            let head = std::mem::take(&mut self.head);
+            self.begin(sink, object_header::Split::Plain, &head);
+        }
+        self.buffer.take().expect("buffer begun")
+    }
+
+    fn begin<S: TrackSink<Buffer = B>>(&mut self, sink: &S, split: object_header::Split, bytes: &[u8]) {
+        let (header, header_len) = match split {
+            object_header::Split::Header(header, len) => (header, len),
+            _ => (ObjectHeader::default(), 0),
+        };
+        let mut buffer = sink.begin_object(self.group_id, self.object_id, self.size.saturating_sub(header_len), header);
+        buffer.extend_from_slice(&bytes[header_len..]);
+        self.buffer = Some(buffer);
+    }
+}
+
+/// A received object waiting to be delivered.
+#[derive(Clone)]
+struct ReceivedObject {
+    group_id: u64,
+    object_id: u64,
+    payload: Vec<u8>,
+    header: ObjectHeader,
+    // Wall-clock arrival time, and the publisher's clock offset as known then
+    arrival_us: u64,
+    clock_offset_us: Option<i64>,
+}
+
+impl ReceivedObject {
+    /// Views of the object's extension headers, pointing into the object.
+    fn extensions(&self) -> impl Iterator<Item = MoqExtension> + '_ {
+        self.header.extensions().map(MoqExtension::of)
+    }
+
+    /// The object's info, listing `extensions` as its extension headers.
+    fn info(&self, extensions: &[MoqExtension]) -> MoqObjectInfo {
+        let capture_time_us = self.header.capture_time_us();
+        let latency_us = match (capture_time_us, self.clock_offset_us) {
+            (Some(capture_us), Some(offset_us)) => Some(clock_sync::one_way_latency_us(capture_us, self.arrival_us, offset_us)),
+            _ => None,
+        };
+        MoqObjectInfo {
+            group_id: self.group_id,
+            object_id: self.object_id,
+            capture_time_us: capture_time_us.unwrap_or(0),
+            arrival_time_us: self.arrival_us,
+            clock_offset_us: self.clock_offset_us.unwrap_or(0),
+            latency_us: latency_us.unwrap_or(0),
+            latency_valid: latency_us.is_some(),
+            extensions: if extensions.is_empty() { std::ptr::null() } else { extensions.as_ptr() },
+            extension_count: extensions.len(),
+        }
+    }
+}
+
+/// Destination of an object's payload while it is being reassembled.
+enum ObjectBuffer {
+    /// Library-owned buffer, delivered through the data or batch callback
+    Owned(ReceivedObject),
+    /// Application buffer obtained from the subscriber's allocator hook
+    External(ExternalBuffer),
+    /// No destination (allocator declined); the payload is read and dropped
+    Discard,
+}
+
+impl PayloadBuffer for ObjectBuffer {
+    fn extend_from_slice(&mut self, chunk: &[u8]) {
+        match self {
+            ObjectBuffer::Owned(object) => object.payload.extend_from_slice(chunk),
+            ObjectBuffer::External(external) => external.extend_from_slice(chunk),
+            ObjectBuffer::Discard => {}
+        }
+    }
+}
+
+/// An application-provided buffer being filled with one object.
+///
+/// The commit hook runs when this is dropped, so every buffer handed out by
+/// the allocator is returned exactly once, even if the reader task is
+/// cancelled mid-object (in which case `len` is short of the requested size).
+struct ExternalBuffer {
+    ptr: *mut u8,
+    capacity: usize,
+    len: usize,
+    group_id: u64,
+    object_id: u64,
+    hooks: Arc<CallbackSlot<DataDelivery>>,
+}
+
+// Safety: the allocator hands the buffer to this reader until it is committed
+unsafe impl Send for ExternalBuffer {}
+
+impl ExternalBuffer {
+    fn extend_from_slice(&mut self, chunk: &[u8]) {
+        let n = chunk.len().min(self.capacity - self.len);
+        if n < chunk.len() {
+            log::warn!(
+                "Object {}/{} exceeds its announced size ({} bytes); truncating",
+                self.group_id, self.object_id, self.capacity
             );
         }
-    }));
+        unsafe { std::ptr::copy_nonoverlapping(chunk.as_ptr(), self.ptr.add(self.len), n); }
+        self.len += n;
+    }
+
+    fn as_slice(&self) -> &[u8] {
+        unsafe { std::slice::from_raw_parts(self.ptr, self.len) }
+    }
+}
+
+impl Drop for ExternalBuffer {
+    fn drop(&mut self) {
+        if let DataDelivery::Allocated(_, Some(commit)) = self.hooks.callback {
+            let user_data = self.hooks.user_data as *mut std::ffi::c_void;
+            let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+                unsafe { commit(user_data, self.ptr, self.len, self.group_id, self.object_id); }
+            }));
+        }
+    }
+}
+
+/// Collects objects read by a subscriber's reader task and hands them to
+/// the subscriber's current callback.
+///
+/// In per-object mode every object is delivered as soon as it is pushed. In
+/// batch mode objects accumulate until the batch is full, the next read would
+/// block, or the batch's latency budget runs out.
+///
+/// With a group cache enabled, every object is also kept in the cache once it
+/// has been delivered.
+struct ObjectSink {
+    callback: Arc<DataCallbackCell>,
+    cache: Arc<GroupCacheCell>,
+    queue: Arc<ReceivedQueue>,
+    pending: Vec<ReceivedObject>,
+    // Scratch array of views handed to batch callbacks, reused across batches
+    views: Vec<MoqObject>,
+    // Scratch array of extension header views handed to object callbacks
+    extensions: Vec<MoqExtension>,
+    batch_started: Option<std::time::Instant>,
+    // Offset to the publisher's clock, for the latency of stamped objects
+    clock: Option<Arc<PeerClock>>,
+}
+
+// Safety: `views` and `extensions` only hold pointers into `pending` while it is being delivered
+unsafe impl Send for ObjectSink {}
+
+impl ObjectSink {
+    fn new(callback: Arc<DataCallbackCell>) -> Self {
+        ObjectSink {
+            callback,
+            cache: Arc::new(ArcSwapOption::empty()),
+            queue: Arc::new(ObjectQueue::new()),
+            pending: Vec::new(),
+            views: Vec::new(),
+            extensions: Vec::new(),
+            batch_started: None,
+            clock: None,
+        }
+    }
+
+    fn with_clock(mut self, clock: Arc<PeerClock>) -> Self {
+        self.clock = Some(clock);
+        self
+    }
+
+    fn with_cache(mut self, cache: Arc<GroupCacheCell>) -> Self {
+        self.cache = cache;
+        self
+    }
+
+    fn with_queue(mut self, queue: Arc<ReceivedQueue>) -> Self {
+        self.queue = queue;
+        self
+    }
+
+    fn caching(&self) -> bool {
+        self.cache.load().is_some()
+    }
+
+    /// Batch limits of the current callback, or None in per-object mode.
+    fn batch_limits(&self) -> Option<BatchLimits> {
+        match self.callback.load().as_deref() {
+            Some(CallbackSlot { callback: DataDelivery::Batch(_, limits), .. }) => Some(*limits),
+            _ => None,
+        }
+    }
+}
+
+impl TrackSink for ObjectSink {
+    type Buffer = ObjectBuffer;
+
+    /// Picks the destination for a new object of `size` bytes.
+    ///
+    /// With an allocator hook installed the object goes straight into an
+    /// application buffer; otherwise into a library-owned buffer. Objects
+    /// nobody receives are still read into one while the cache is enabled.
+    fn begin_object(&self, group_id: u64, object_id: u64, size: usize, header: ObjectHeader) -> ObjectBuffer {
+        let owned = || ObjectBuffer::Owned(ReceivedObject {
+            group_id,
+            object_id,
+            payload: Vec::with_capacity(size),
+            header,
+            arrival_us: 0,
+            clock_offset_us: None,
+        });
+        let slot = match self.callback.load_full() {
+            Some(slot) => slot,
+            None if self.caching() => return owned(),
+            None => return ObjectBuffer::Discard,
+        };
+        let alloc = match slot.callback {
+            DataDelivery::Allocated(Some(alloc), _) => alloc,
+            _ => return owned(),
+        };
+        if size == 0 {
+            return ObjectBuffer::Discard;
+        }
+
+        let user_data = slot.user_data as *mut std::ffi::c_void;
+        let ptr = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| unsafe { alloc(user_data, size) }))
+            .unwrap_or(std::ptr::null_mut());
+        if ptr.is_null() {
+            log::trace!("Allocator declined object {}/{} ({} bytes)", group_id, object_id, size);
+            return if self.caching() { owned() } else { ObjectBuffer::Discard };
+        }
+        ObjectBuffer::External(ExternalBuffer {
+            ptr,
+            capacity: size,
+            len: 0,
+            group_id,
+            object_id,
+            hooks: slot,
+        })
+    }
+
+    /// Hands over a fully reassembled object, delivering immediately unless batching.
+    fn push(&mut self, buffer: ObjectBuffer) {
+        let mut object = match buffer {
+            ObjectBuffer::Owned(object) => object,
+            ObjectBuffer::External(external) => {
+                // Keep arrival order: anything still batched goes out first
+                self.flush();
+                if let Some(cache) = self.cache.load_full() {
+                    let mut cache = cache.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+                    let payload = external.as_slice().to_vec();
+                    cache.insert(external.group_id, external.object_id, payload, std::time::Instant::now());
+                }
+                drop(external); // Commits the buffer
+                return;
+            }
+            ObjectBuffer::Discard => return,
+        };
+        if object.payload.is_empty() {
+            return;
+        }
+        object.arrival_us = clock_sync::wallclock_us();
+        if object.header.capture_time_us().is_some() {
+            if let Some(clock) = &self.clock {
+                clock.start();
+                object.clock_offset_us = clock.offset_us();
+            }
+        }
+        if self.batch_started.is_none() {
+            self.batch_started = Some(std::time::Instant::now());
+        }
+        self.pending.push(object);
+
+        match self.batch_limits() {
+            Some(limits) if self.pending.len() < limits.max_objects => {}
+            _ => self.flush(),
+        }
+    }
+
+    fn flush_deadline(&self) -> Option<Duration> {
+        if self.pending.is_empty() {
+            return None;
+        }
+        // What remains of the batch's latency budget
+        let budget = self.batch_limits().map(|l| l.max_latency).unwrap_or_default();
+        let elapsed = self.batch_started.map(|t| t.elapsed()).unwrap_or_default();
+        Some(budget.saturating_sub(elapsed))
+    }
+
+    /// Delivers all pending objects to the current callback (dropped if there
+    /// is none, or if an allocator hook has replaced it), then caches them.
+    fn flush(&mut self) {
+        if self.pending.is_empty() {
+            return;
+        }
+
+        if let Some(slot) = self.callback.load_full() {
+            let user_data = slot.user_data as *mut std::ffi::c_void;
+            match slot.callback {
+                DataDelivery::Batch(Some(cb), _) => {
+                    self.views.clear();
+                    self.views.extend(self.pending.iter().map(|o| MoqObject {
+                        data: o.payload.as_ptr(),
+                        data_len: o.payload.len(),
+                        group_id: o.group_id,
+                        object_id: o.object_id,
+                    }));
+                    log::trace!("Invoking batch callback with {} objects", self.views.len());
+                    let views = &self.views;
+                    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+                        unsafe { cb(user_data, views.as_ptr(), views.len()); }
+                    }));
+                    self.views.clear();
+                }
+                DataDelivery::Object(Some(cb)) => {
+                    for object in &self.pending {
+                        log::trace!("Invoking callback with {} bytes", object.payload.len());
+                        let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+                            unsafe { cb(user_data, object.payload.as_ptr(), object.payload.len()); }
+                        }));
+                    }
+                }
+                DataDelivery::Info(Some(cb)) => {
+                    for object in &self.pending {
+                        self.extensions.clear();
+                        self.extensions.extend(object.extensions());
+                        let info = object.info(&self.extensions);
+                        let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+                            unsafe { cb(user_data, object.payload.as_ptr(), object.payload.len(), &info); }
+                        }));
+                    }
+                }
+                DataDelivery::Queue(max_objects) => {
+                    // Payloads move into the queue; the cache gets copies
+                    if self.caching() {
+                        self.queue.push(self.pending.iter().cloned(), max_objects);
+                    } else {
+                        self.queue.push(self.pending.drain(..), max_objects);
+                    }
+                }
+                _ => {}
+            }
+        }
+
+        // Delivered payloads move into the cache without another copy
+        match self.cache.load_full() {
+            Some(cache) => {
+                let now = std::time::Instant::now();
+                let mut cache = cache.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+                for object in self.pending.drain(..) {
+                    cache.insert(object.group_id, object.object_id, object.payload, now);
+                }
+            }
+            None => self.pending.clear(),
+        }
+        self.batch_started = None;
+    }
+}
+
+/// Subscribes to many tracks of one namespace in a single pass.
+///
+/// The session's subscriber handle is cloned once, all tracks
+/// share one namespace track set, and the SUBSCRIBE requests are driven by a
+/// single background task instead of one task per track. Each track still gets
+/// its own subscriber handle so it can be unsubscribed independently.
+///
+/// The operation is all-or-nothing: on failure no subscriber is returned and
+/// every entry of `subscribers_out` is set to null.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_names` must point to `track_count` valid null-terminated C string pointers
+/// - `user_data` may be null; otherwise it must point to `track_count` pointers
+/// - `subscribers_out` must point to writable storage for `track_count` subscriber pointers
+/// - Client must be connected
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Namespace string (slash-separated path)
+/// - `track_names`: Array of track name strings
+/// - `track_count`: Number of entries in `track_names`, `user_data` and `subscribers_out`
+/// - `data_callback`: Optional callback for received data, shared by all tracks
+/// - `user_data`: Optional per-track user data passed to the callback (null means all null)
+/// - `subscribers_out`: Receives one subscriber handle per track name
+///
+/// # Returns
+/// `MoqResult` with status code and error message (if any)
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe_many(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_names: *const *const c_char,
+    track_count: usize,
+    data_callback: MoqDataCallback,
+    user_data: *const *mut std::ffi::c_void,
+    subscribers_out: *mut *mut MoqSubscriber,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        moq_subscribe_many_impl(client, namespace, track_names, track_count, data_callback, user_data, subscribers_out)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscribe_many");
+        set_last_error("Internal panic occurred in moq_subscribe_many".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+unsafe fn moq_subscribe_many_impl(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_names: *const *const c_char,
+    track_count: usize,
+    data_callback: MoqDataCallback,
+    user_data: *const *mut std::ffi::c_void,
+    subscribers_out: *mut *mut MoqSubscriber,
+) -> MoqResult {
+    if client.is_null() || namespace.is_null() || (track_count > 0 && (track_names.is_null() || subscribers_out.is_null())) {
+        set_last_error("Client, namespace, track_names, or subscribers_out is null".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Client, namespace, track_names, or subscribers_out is null",
+        );
+    }
+
+    if track_count == 0 {
+        return make_ok_result();
+    }
+
+    let out = std::slice::from_raw_parts_mut(subscribers_out, track_count);
+    out.fill(std::ptr::null_mut());
+
+    let namespace_str = match CStr::from_ptr(namespace).to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            set_last_error("Invalid UTF-8 in namespace".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Invalid UTF-8 in namespace",
+            );
+        }
+    };
+
+    let names = match c_str_array_to_strings(track_names, track_count) {
+        Ok(names) => names,
+        Err(e) => {
+            set_last_error(e.clone());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &e);
+        }
+    };
+
+    let subscriber_impl = match (*client).inner.session() {
+        Some(session) => session.subscriber.clone(),
+        None => {
+            set_last_error("Not connected to MoQ server".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorNotConnected,
+                "Not connected to MoQ server",
+            );
+        }
+    };
+
+    // One track set for the whole batch (see moq_subscribe for the per-step pattern)
+    let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
+    let (mut tracks_writer, _tracks_request, mut tracks_reader) =
+        Tracks::new(track_namespace.clone()).produce();
+
+    let mut track_writers = Vec::with_capacity(track_count);
+    let mut track_readers = Vec::with_capacity(track_count);
+    for name in &names {
+        let track_writer = tracks_writer.create(name);
+        let track_reader = tracks_reader.subscribe(name);
+        match (track_writer, track_reader) {
+            (Some(tw), Some(tr)) => {
+                track_writers.push(tw);
+                track_readers.push(tr);
+            }
+            _ => {
+                let e = format!("Failed to create track for {} (tracks closed)", name);
+                set_last_error(e.clone());
+                return make_error_result(MoqResultCode::MoqErrorInternal, &e);
+            }
+        }
+    }
+
+    // Drive every SUBSCRIBE request from a single task
+    RUNTIME.spawn(async move {
+        use futures::stream::{FuturesUnordered, StreamExt};
+
+        let mut pending: FuturesUnordered<_> = track_writers
+            .into_iter()
+            .map(|track_writer| {
+                let mut subscriber = subscriber_impl.clone();
+                async move {
+                    let name = track_writer.name.clone();
+                    (name, subscriber.subscribe(track_writer).await)
+                }
+            })
+            .collect();
+
+        while let Some((name, result)) = pending.next().await {
+            if let Err(err) = result {
+                log::warn!("Failed to subscribe to track {}: {}", name, err);
+            }
+        }
+    });
+
+    let user_data = if user_data.is_null() {
+        None
+    } else {
+        Some(std::slice::from_raw_parts(user_data, track_count))
+    };
+
+    let clock = (*client).inner.peer_clock(&track_namespace);
+    let inband_headers = (*client).inner.inband_headers();
+    for (i, (name, track_reader)) in names.iter().zip(track_readers).enumerate() {
+        let ud = user_data.map_or(0, |ud| ud[i] as usize);
+        let subscriber = spawn_track_subscriber(
+            track_namespace.clone(),
+            name,
+            track_reader,
+            DataDelivery::Object(data_callback),
+            ud,
+            clock.clone(),
+            inband_headers,
+        );
+        out[i] = Box::into_raw(Box::new(subscriber));
+    }
+
+    log::info!("Subscribed to {} tracks in {}", track_count, namespace_str);
+    make_ok_result()
+}
+
+/// Destroys a subscriber and releases its resources.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
+/// - `subscriber` must not be null (null pointers are safely ignored)
+/// - `subscriber` must not be accessed after this function returns
+/// - This function is thread-safe
+/// - Active reader task will be aborted
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber to destroy, or null (null is safely ignored)
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_destroy(subscriber: *mut MoqSubscriber) {
+    let _ = std::panic::catch_unwind(|| {
+        if !subscriber.is_null() {
+            let subscriber = Box::from_raw(subscriber);
+
+            // Stop delivering before cancelling; never waits for a running callback
+            subscriber.callback.store(None);
+            subscriber.queue.disarm();
+            
+            // Cancel reader task (with proper error handling)
+            let inner_result = subscriber.inner.lock();
+            let mut inner = match inner_result {
+                Ok(guard) => guard,
+                Err(poisoned) => {
+                    log::warn!("Mutex poisoned in moq_subscriber_destroy, recovering");
+                    poisoned.into_inner()
+                }
+            };
+            if let Some(task) = inner.reader_task.take() {
+                task.abort();
+            }
+            
+            log::debug!("Destroyed subscriber for {:?}/{}", inner.namespace, inner.track_name);
+        }
+    });
+    // Silently handle panics - destructor should not propagate panics
+}
+
+/// Unsubscribes from a track without destroying the subscriber handle.
+///
+/// This function stops receiving data from the track by:
+/// 1. Aborting the reader task (stops processing incoming data)
+/// 2. Dropping the track reader (signals to the relay)
+/// 3. Marking the subscriber as unsubscribed
+///
+/// After calling this function:
+/// - No more data callbacks will be invoked
+/// - `moq_is_subscribed()` will return false
+/// - The subscriber handle remains valid but inactive
+/// - Call `moq_subscriber_destroy()` to free the handle
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from `moq_subscribe()` or `moq_subscribe_catalog()`
+/// - `subscriber` must not be null
+/// - This function is thread-safe
+/// - Safe to call multiple times (idempotent)
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber to unsubscribe
+///
+/// # Returns
+/// - `MoqOk` on success or if already unsubscribed
+/// - `MoqErrorInvalidArgument` if subscriber is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_unsubscribe(subscriber: *mut MoqSubscriber) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+
+        let subscriber_ref = &*subscriber;
+        let inner_result = subscriber_ref.inner.lock();
+        let mut inner = match inner_result {
+            Ok(guard) => guard,
+            Err(poisoned) => {
+                log::warn!("Mutex poisoned in moq_unsubscribe, recovering");
+                poisoned.into_inner()
+            }
+        };
+
+        // Already unsubscribed - idempotent success
+        if !inner.subscribed {
+            log::debug!("Subscriber for {:?}/{} already unsubscribed", inner.namespace, inner.track_name);
+            return MoqResult {
+                code: MoqResultCode::MoqOk,
+                message: std::ptr::null(),
+            };
+        }
+
+        // Stop delivering, then abort the reader task; never waits for a running callback
+        subscriber_ref.callback.store(None);
+        if let Some(task) = inner.reader_task.take() {
+            task.abort();
+            log::debug!("Aborted reader task for {:?}/{}", inner.namespace, inner.track_name);
+        }
+
+        // Drop the track reader to signal unsubscribe to the relay
+        inner.track = None;
+
+        // Mark as unsubscribed
+        inner.subscribed = false;
+        log::info!("Unsubscribed from {:?}/{}", inner.namespace, inner.track_name);
+        drop(inner);
+
+        // Wake a consumer waiting on the queue; already queued objects can still be pulled
+        subscriber_ref.queue.close();
+
+        MoqResult {
+            code: MoqResultCode::MoqOk,
+            message: std::ptr::null(),
+        }
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_unsubscribe");
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred in moq_unsubscribe",
+        )
+    })
+}
+
+/// Checks if the subscriber is currently subscribed to a track.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from `moq_subscribe()` or `moq_subscribe_catalog()`
+/// - `subscriber` may be null (returns false)
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber to check
+///
+/// # Returns
+/// - `true` if the subscriber is actively subscribed
+/// - `false` if subscriber is null, unsubscribed, or its track has ended,
+///   which includes the relay ending the session
+#[no_mangle]
+pub unsafe extern "C" fn moq_is_subscribed(subscriber: *const MoqSubscriber) -> bool {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            return false;
+        }
+
+        let subscriber_ref = &*subscriber;
+        let inner_result = subscriber_ref.inner.lock();
+        let inner = match inner_result {
+            Ok(guard) => guard,
+            Err(poisoned) => {
+                log::warn!("Mutex poisoned in moq_is_subscribed, recovering");
+                poisoned.into_inner()
+            }
+        };
+
+        inner.subscribed
+    }).unwrap_or(false)
+}
+
+/// Replaces the data callback of a subscriber while it is running.
+///
+/// The new callback and user data are published atomically; the reader task
+/// picks them up for the next object it delivers. Passing a null callback
+/// pauses delivery (objects are still received and dropped).
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from `moq_subscribe()` or `moq_subscribe_many()`
+/// - `subscriber` must not be null
+/// - `user_data` will be passed to the callback and may be null
+/// - This function is thread-safe and may be called from inside a data callback
+/// - An invocation of the previous callback that is already running may still
+///   complete after this function returns
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber
+/// - `data_callback`: New data callback, or null to pause delivery
+/// - `user_data`: User data pointer passed to the new callback
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if subscriber is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_set_callback(
+    subscriber: *mut MoqSubscriber,
+    data_callback: MoqDataCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            set_last_error("Subscriber is null".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+
+        let subscriber_ref = &*subscriber;
+        subscriber_ref.callback.store(
+            data_callback.map(|cb| CallbackSlot::new(DataDelivery::Object(Some(cb)), user_data)),
+        );
+
+        log::debug!("Replaced subscriber data callback");
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscriber_set_callback");
+        set_last_error("Internal panic occurred in moq_subscriber_set_callback".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/// Replaces the callback of a running subscriber with a batch callback.
+///
+/// Works like `moq_subscriber_set_callback()`; objects already waiting in a
+/// batch are delivered to whichever callback is current when the batch flushes.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `subscriber` must not be null
+/// - `user_data` will be passed to the callback and may be null
+/// - This function is thread-safe and may be called from inside a callback
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber
+/// - `batch_callback`: New batch callback, or null to pause delivery
+/// - `user_data`: User data pointer passed to the new callback
+/// - `max_batch_objects`: Maximum objects per batch (0 selects the default)
+/// - `max_batch_latency_us`: How long a started batch may wait for more objects
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if subscriber is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_set_batch_callback(
+    subscriber: *mut MoqSubscriber,
+    batch_callback: MoqBatchCallback,
+    user_data: *mut std::ffi::c_void,
+    max_batch_objects: usize,
+    max_batch_latency_us: u32,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            set_last_error("Subscriber is null".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+
+        let limits = BatchLimits::new(max_batch_objects, max_batch_latency_us);
+        let subscriber_ref = &*subscriber;
+        subscriber_ref.callback.store(
+            batch_callback.map(|cb| CallbackSlot::new(DataDelivery::Batch(Some(cb), limits), user_data)),
+        );
+
+        log::debug!("Replaced subscriber batch callback ({:?})", limits);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscriber_set_batch_callback");
+        set_last_error("Internal panic occurred in moq_subscriber_set_batch_callback".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/// Replaces a subscriber's callback with one that also receives the timing of every object.
+///
+/// `object_callback` gets each object's payload together with its
+/// `MoqObjectInfo`. For objects stamped by their publisher (see
+/// `moq_publish_data_timestamped()`) the info carries the capture time and,
+/// once the clock offset to the publisher has been estimated, the one-way
+/// latency from capture to arrival. The estimate starts with the first
+/// stamped object and takes about a round trip; objects before it have
+/// `latency_valid` unset.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `object_callback` may be null (no data will be received)
+/// - `user_data` will be passed to the callback and may be null
+/// - This function is thread-safe
+///
+/// # Returns
+/// `MoqOk`, or `MoqErrorInvalidArgument` if `subscriber` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_set_object_callback(
+    subscriber: *mut MoqSubscriber,
+    object_callback: MoqObjectCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            set_last_error("Subscriber is null".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+
+        let subscriber_ref = &*subscriber;
+        subscriber_ref.callback.store(
+            object_callback.map(|cb| CallbackSlot::new(DataDelivery::Info(Some(cb)), user_data)),
+        );
+
+        log::debug!("Replaced subscriber object callback");
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscriber_set_object_callback");
+        set_last_error("Internal panic occurred in moq_subscriber_set_object_callback".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/// Makes a subscriber reassemble objects directly into application buffers.
+///
+/// For every object the reader calls `alloc_fn(user_data, size)` with the
+/// object's size, copies the payload chunks straight into the returned buffer
+/// and then calls `commit_fn(user_data, buffer, len, group_id, object_id)`.
+/// This replaces the data or batch callback of the subscriber.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `subscriber` must not be null
+/// - `alloc_fn` and `commit_fn` must both be non-null, or both null to remove
+///   the hooks (which pauses delivery)
+/// - Buffers returned by `alloc_fn` must be writable for `size` bytes until
+///   they are passed to `commit_fn`; returning null drops the object
+/// - `commit_fn` is called exactly once per non-null buffer, possibly with a
+///   shorter `len` if the object was cut short (e.g. by unsubscribing)
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber
+/// - `alloc_fn`: Returns a buffer of at least `size` bytes, or null to drop the object
+/// - `commit_fn`: Receives each filled buffer
+/// - `user_data`: User data pointer passed to both hooks
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if subscriber is null or only one hook is given
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_set_allocator(
+    subscriber: *mut MoqSubscriber,
+    alloc_fn: MoqAllocFn,
+    commit_fn: MoqCommitFn,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            set_last_error("Subscriber is null".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+        if alloc_fn.is_some() != commit_fn.is_some() {
+            set_last_error("alloc_fn and commit_fn must both be set or both be null".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "alloc_fn and commit_fn must both be set or both be null",
+            );
+        }
+
+        let subscriber_ref = &*subscriber;
+        let delivery = DataDelivery::Allocated(alloc_fn, commit_fn);
+        subscriber_ref.callback.store(
+            delivery.is_set().then(|| CallbackSlot::new(delivery, user_data)),
+        );
+
+        log::debug!("Replaced subscriber allocator hooks");
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscriber_set_allocator");
+        set_last_error("Internal panic occurred in moq_subscriber_set_allocator".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/// Takes the next object from a subscriber created with `moq_subscribe_queued()`.
+///
+/// If an object is queued it is moved into `object_out` without copying; its
+/// payload stays valid until `moq_object_release()`. Otherwise `ready`, if
+/// given, is armed: it is invoked once, on a library worker thread, when an
+/// object arrives or the subscription ends, replacing any callback armed
+/// earlier. It is never invoked from within this function. Destroying the
+/// subscriber discards an armed callback without invoking it.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `object_out` must point to writable storage for one `MoqReceivedObject`
+/// - Objects must be consumed by one thread at a time
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber
+/// - `object_out`: Receives the object
+/// - `ready`: Optional one-shot callback armed when nothing is queued
+/// - `user_data`: User data pointer passed to `ready`
+///
+/// # Returns
+/// - `MoqOk` with `object_out` filled
+/// - `MoqErrorWouldBlock` if nothing is queued yet (no message is allocated)
+/// - `MoqErrorNotConnected` if the subscription has ended and the queue is drained
+/// - `MoqErrorInvalidArgument` if a pointer is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_next(
+    subscriber: *mut MoqSubscriber,
+    object_out: *mut MoqReceivedObject,
+    ready: MoqReadyCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() || object_out.is_null() {
+            set_last_error("Subscriber or object is null".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber or object is null",
+            );
+        }
+
+        *object_out = MoqReceivedObject::empty();
+        match (*subscriber).queue.pop(ready.map(|cb| (cb, user_data as usize))) {
+            Pop::Ready(object) => {
+                let extensions = object.extensions().collect();
+                let object = Box::new(QueuedObject { object, extensions });
+                *object_out = MoqReceivedObject {
+                    data: object.object.payload.as_ptr(),
+                    data_len: object.object.payload.len(),
+                    group_id: object.object.group_id,
+                    object_id: object.object.object_id,
+                    reserved: Box::into_raw(object) as *mut std::ffi::c_void,
+                };
+                make_ok_result()
+            }
+            // Polled on hot paths: report without allocating a message
+            Pop::Pending => MoqResult { code: MoqResultCode::MoqErrorWouldBlock, message: std::ptr::null() },
+            Pop::Closed => MoqResult { code: MoqResultCode::MoqErrorNotConnected, message: std::ptr::null() },
+        }
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscriber_next");
+        set_last_error("Internal panic occurred in moq_subscriber_next".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/// An object handed out by `moq_subscriber_next()`, with views of its
+/// extension headers that stay valid until it is released.
+struct QueuedObject {
+    object: ReceivedObject,
+    extensions: Vec<MoqExtension>,
+}
+
+/// Frees an object returned by `moq_subscriber_next()` and resets it to empty.
+///
+/// # Safety
+/// - `object` must be null or point to an object filled by `moq_subscriber_next()`
+///   (empty objects are ignored)
+/// - The object's payload must not be accessed afterwards
+#[no_mangle]
+pub unsafe extern "C" fn moq_object_release(object: *mut MoqReceivedObject) {
+    let _ = std::panic::catch_unwind(|| {
+        if object.is_null() || (*object).reserved.is_null() {
+            return;
+        }
+        drop(Box::from_raw((*object).reserved as *mut QueuedObject));
+        *object = MoqReceivedObject::empty();
+    });
+}
+
+/// Fills `info` with the timing of an object returned by `moq_subscriber_next()`.
+///
+/// The clock offset and latency are those known when the object arrived.
+///
+/// # Safety
+/// - `object` must point to an object filled by `moq_subscriber_next()` and not yet released
+/// - `info` must be a valid pointer to writable `MoqObjectInfo`
+///
+/// # Returns
+/// `MoqOk`, or `MoqErrorInvalidArgument` if either pointer is null or the object is empty
+#[no_mangle]
+pub unsafe extern "C" fn moq_object_info(object: *const MoqReceivedObject, info: *mut MoqObjectInfo) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if object.is_null() || info.is_null() || (*object).reserved.is_null() {
+            set_last_error("Object or info is null".to_string());
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Object or info is null");
+        }
+        let queued = &*((*object).reserved as *const QueuedObject);
+        *info = queued.object.info(&queued.extensions);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_object_info");
+        set_last_error("Internal panic occurred in moq_object_info".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+/// Keeps the most recent groups of a subscribed track for local catch-up and rewind.
+///
+/// Every object the subscriber receives is kept after delivery. Payloads stay
+/// in memory up to `memory_bytes`; beyond that the oldest ones spill into a
+/// memory-mapped overflow file of `overflow_bytes` (if `overflow_path` is
+/// given) used as a ring buffer. Whole groups are evicted oldest first once
+/// there are more than `max_groups`, once they are older than `max_age_ms`,
+/// or when memory and overflow file are both full. Enabling the cache again
+/// replaces it, discarding its contents.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `overflow_path` may be null; otherwise it must be a valid null-terminated
+///   C string naming a file that can be created or truncated
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber
+/// - `max_groups`: Maximum number of cached groups (0 = no group limit)
+/// - `max_age_ms`: Maximum age of a cached group, from its first object (0 = no age limit)
+/// - `memory_bytes`: Payload bytes kept in memory
+/// - `overflow_path`: Optional overflow file path (null = memory only)
+/// - `overflow_bytes`: Size of the overflow file (ignored without `overflow_path`)
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if subscriber is null, the path is invalid,
+///   or an overflow path is given with `overflow_bytes` of 0
+/// - `MoqErrorInternal` if the overflow file cannot be created
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_enable_cache(
+    subscriber: *mut MoqSubscriber,
+    max_groups: usize,
+    max_age_ms: u32,
+    memory_bytes: usize,
+    overflow_path: *const c_char,
+    overflow_bytes: usize,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        moq_subscriber_enable_cache_impl(subscriber, max_groups, max_age_ms, memory_bytes, overflow_path, overflow_bytes)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscriber_enable_cache");
+        set_last_error("Internal panic occurred in moq_subscriber_enable_cache".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+unsafe fn moq_subscriber_enable_cache_impl(
+    subscriber: *mut MoqSubscriber,
+    max_groups: usize,
+    max_age_ms: u32,
+    memory_bytes: usize,
+    overflow_path: *const c_char,
+    overflow_bytes: usize,
+) -> MoqResult {
+    if subscriber.is_null() {
+        set_last_error("Subscriber is null".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Subscriber is null",
+        );
+    }
+
+    let overflow = if overflow_path.is_null() {
+        None
+    } else {
+        let path = match CStr::from_ptr(overflow_path).to_str() {
+            Ok(s) => std::path::PathBuf::from(s),
+            Err(_) => {
+                set_last_error("Invalid UTF-8 in overflow_path".to_string());
+                return make_error_result(
+                    MoqResultCode::MoqErrorInvalidArgument,
+                    "Invalid UTF-8 in overflow_path",
+                );
+            }
+        };
+        if overflow_bytes == 0 {
+            set_last_error("overflow_bytes must be greater than zero".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "overflow_bytes must be greater than zero",
+            );
+        }
+        Some((path, overflow_bytes))
+    };
+
+    let limits = CacheLimits {
+        max_groups,
+        max_age: Duration::from_millis(max_age_ms as u64),
+        memory_bytes,
+    };
+    let cache = match GroupCache::new(limits, overflow.as_ref().map(|(path, size)| (path.as_path(), *size))) {
+        Ok(cache) => cache,
+        Err(e) => {
+            let msg = format!("Failed to create cache overflow file: {}", e);
+            set_last_error(msg.clone());
+            return make_error_result(MoqResultCode::MoqErrorInternal, &msg);
+        }
+    };
+
+    (*subscriber).cache.store(Some(Arc::new(Mutex::new(cache))));
+    log::debug!("Enabled subscriber group cache ({:?}, overflow {:?})", limits, overflow);
+    make_ok_result()
+}
+
+/// Gets the oldest and newest group IDs held in a subscriber's cache.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function, or null
+/// - `first_group` and `last_group` must be valid pointers to writable `u64`s
+/// - This function is thread-safe
+///
+/// # Returns
+/// `true` if the cache holds at least one group; `false` if it is empty,
+/// not enabled, or any pointer is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_cached_groups(
+    subscriber: *const MoqSubscriber,
+    first_group: *mut u64,
+    last_group: *mut u64,
+) -> bool {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() || first_group.is_null() || last_group.is_null() {
+            return false;
+        }
+        let Some(cache) = (*subscriber).cache.load_full() else { return false };
+        let range = cache.lock().unwrap_or_else(|poisoned| poisoned.into_inner()).group_range();
+        match range {
+            Some((first, last)) => {
+                *first_group = first;
+                *last_group = last;
+                true
+            }
+            None => false,
+        }
+    }).unwrap_or(false)
+}
+
+/// Delivers the cached objects of groups `first_group..=last_group`.
+///
+/// The objects are copied out of the cache and passed, in arrival order, to a
+/// single invocation of `callback` on the calling thread; the reader task
+/// keeps filling the cache meanwhile. The callback is not invoked if no
+/// cached object falls in the range.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `callback` must be non-null
+/// - The `MoqObject` array and its payloads are only valid during the callback
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `subscriber`: Pointer to the subscriber
+/// - `first_group`: First group ID of the range (inclusive)
+/// - `last_group`: Last group ID of the range (inclusive)
+/// - `callback`: Receives the cached objects
+/// - `user_data`: User data pointer passed to the callback
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if subscriber or callback is null, or the cache is not enabled
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_read_range(
+    subscriber: *mut MoqSubscriber,
+    first_group: u64,
+    last_group: u64,
+    callback: MoqBatchCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        moq_subscriber_read_range_impl(subscriber, first_group, last_group, callback, user_data)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscriber_read_range");
+        set_last_error("Internal panic occurred in moq_subscriber_read_range".to_string());
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred"
+        )
+    })
+}
+
+unsafe fn moq_subscriber_read_range_impl(
+    subscriber: *mut MoqSubscriber,
+    first_group: u64,
+    last_group: u64,
+    callback: MoqBatchCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    let cb = match callback {
+        Some(cb) if !subscriber.is_null() => cb,
+        _ => {
+            set_last_error("Subscriber or callback is null".to_string());
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber or callback is null",
+            );
+        }
+    };
+    let Some(cache) = (*subscriber).cache.load_full() else {
+        set_last_error("Subscriber cache is not enabled".to_string());
+        return make_error_result(
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Subscriber cache is not enabled",
+        );
+    };
+
+    // Copy out under the lock so the callback never blocks the reader task
+    let mut data = Vec::new();
+    let mut entries = Vec::new();
+    {
+        let cache = cache.lock().unwrap_or_else(|poisoned| poisoned.into_inner());
+        cache.read_range(first_group, last_group, |group_id, object_id, payload| {
+            entries.push((group_id, object_id, data.len(), payload.len()));
+            data.extend_from_slice(payload);
+        });
+    }
+    if entries.is_empty() {
+        return make_ok_result();
+    }
+
+    let views: Vec<MoqObject> = entries
+        .iter()
+        .map(|&(group_id, object_id, offset, len)| MoqObject {
+            data: data[offset..].as_ptr(),
+            data_len: len,
+            group_id,
+            object_id,
+        })
+        .collect();
+    log::trace!("Delivering {} cached objects of groups {}..={}", views.len(), first_group, last_group);
+    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+        cb(user_data, views.as_ptr(), views.len());
+    }));
+    make_ok_result()
+}
+
+/* ───────────────────────────────────────────────
+ * Recording
+ * ─────────────────────────────────────────────── */
+
+/// An object being received by a recorder.
+struct RecordedObject {
+    group_id: u64,
+    object_id: u64,
+    arrival: std::time::Instant,
+    payload: Vec<u8>,
+}
+
+impl PayloadBuffer for RecordedObject {
+    fn extend_from_slice(&mut self, chunk: &[u8]) {
+        self.payload.extend_from_slice(chunk);
+    }
+}
+
+/// Hands every object read from a track to a recording writer thread.
+///
+/// The writer lives on a thread of its own, as rolling over to a new segment
+/// and finalizing the recording block; dropping the sink ends the thread
+/// once it has written and closed the recording.
+struct RecorderSink {
+    objects: std::sync::mpsc::Sender<RecordedObject>,
+    // Reassembly buffers handed back by the writer thread for reuse
+    spare: std::sync::mpsc::Receiver<Vec<u8>>,
+}
+
+impl RecorderSink {
+    /// Starts the writer thread; join it to wait for the recording to be closed.
+    fn spawn(mut writer: RecordingWriter, description: String) -> std::io::Result<(Self, std::thread::JoinHandle<()>)> {
+        let (objects, received) = std::sync::mpsc::channel::<RecordedObject>();
+        let (returned, spare) = std::sync::mpsc::channel();
+        let thread = std::thread::Builder::new().name("moq-ffi-recorder".to_string()).spawn(move || {
+            let mut failed = false;
+            for object in received {
+                if !failed {
+                    if let Err(e) = writer.append(object.group_id, object.object_id, object.arrival, &object.payload) {
+                        log::error!("Recording stopped: failed to append object {}/{}: {}", object.group_id, object.object_id, e);
+                        failed = true;
+                    }
+                }
+                let _ = returned.send(object.payload);
+            }
+            if let Err(e) = writer.close() {
+                log::error!("Failed to finalize recording of {}: {}", description, e);
+            }
+            log::info!("Recording of {} ended after {} objects", description, writer.len());
+        })?;
+        Ok((RecorderSink { objects, spare }, thread))
+    }
+}
+
+impl TrackSink for RecorderSink {
+    type Buffer = RecordedObject;
+
+    fn begin_object(&self, group_id: u64, object_id: u64, size: usize, _header: ObjectHeader) -> RecordedObject {
+        let mut payload = self.spare.try_recv().unwrap_or_default();
+        payload.clear();
+        payload.reserve(size);
+        RecordedObject {
+            group_id,
+            object_id,
+            arrival: std::time::Instant::now(),
+            payload,
+        }
+    }
+
+    fn push(&mut self, object: RecordedObject) {
+        // Only fails once the writer thread is gone, which it logged
+        let _ = self.objects.send(object);
+    }
+
+    fn flush_deadline(&self) -> Option<Duration> {
+        // Objects are written as soon as they are complete
+        None
+    }
+
+    fn flush(&mut self) {}
+}
+
+#[repr(C)]
+pub struct MoqRecorder {
+    task: tokio::task::JoinHandle<()>,
+    writer: std::thread::JoinHandle<()>,
+}
+
+impl MoqRecorder {
+    /// Unsubscribes and waits for the writer thread to close the recording.
+    /// Never starts `runtime` again: a shutdown has already dropped the task
+    /// together with its sink, so only the writer thread is left to join.
+    fn stop(self, runtime: &SharedRuntime) {
+        self.task.abort();
+        if !self.task.is_finished() {
+            if let Some(handle) = runtime.try_handle() {
+                // Resolves once the aborted task has dropped its sink, which
+                // lets the writer thread finish writing and close the recording
+                let _ = handle.block_on(self.task);
+            }
+        }
+        let _ = self.writer.join();
+    }
+}
+
+/// Records a track to an indexed, memory-mapped on-disk log.
+///
+/// Subscribes to the track and appends every received object, with its group
+/// and object IDs and arrival time, to a new recording directory at `path`.
+/// A writer thread of the recorder's own copies payloads into preallocated,
+/// memory-mapped segment files and gives each object a fixed-size entry in a
+/// memory-mapped index, so recording costs a couple of memcpys per object and
+/// does not issue a write per object. Runtime workers only hand objects over.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace`, `track_name` and `path` must be valid null-terminated C string pointers
+/// - Client must be connected
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Namespace string (slash-separated path)
+/// - `track_name`: Track name string
+/// - `path`: Directory to record into; created if missing, must not already hold a recording
+///
+/// # Returns
+/// Pointer to the created recorder, or null on failure (check `moq_last_error()`)
+#[no_mangle]
+pub unsafe extern "C" fn moq_recorder_create(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    path: *const c_char,
+) -> *mut MoqRecorder {
+    std::panic::catch_unwind(|| {
+        moq_recorder_create_impl(client, namespace, track_name, path)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_recorder_create");
+        set_last_error("Internal panic occurred in moq_recorder_create".to_string());
+        std::ptr::null_mut()
+    })
+}
+
+unsafe fn moq_recorder_create_impl(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    path: *const c_char,
+) -> *mut MoqRecorder {
+    if client.is_null() || namespace.is_null() || track_name.is_null() || path.is_null() {
+        set_last_error("Client, namespace, track_name, or path is null".to_string());
+        return std::ptr::null_mut();
+    }
+
+    let (namespace_str, track_name_str, path_str) = match (
+        CStr::from_ptr(namespace).to_str(),
+        CStr::from_ptr(track_name).to_str(),
+        CStr::from_ptr(path).to_str(),
+    ) {
+        (Ok(ns), Ok(track), Ok(path)) => (ns, track, path),
+        _ => {
+            set_last_error("Invalid UTF-8 in namespace, track_name, or path".to_string());
+            return std::ptr::null_mut();
+        }
+    };
+
+    // Subscribe first so a disconnected client doesn't leave an empty recording behind
+    let track_namespace = TrackNamespace::from_utf8_path(namespace_str);
+    let track_reader = match subscribe_track(&(*client).inner, &track_namespace, track_name_str) {
+        Ok(reader) => reader,
+        Err(e) => {
+            set_last_error(e);
+            return std::ptr::null_mut();
+        }
+    };
+
+    let writer = match RecordingWriter::create(std::path::Path::new(path_str), namespace_str, track_name_str) {
+        Ok(writer) => writer,
+        Err(e) => {
+            set_last_error(format!("Failed to create recording at {}: {}", path_str, e));
+            return std::ptr::null_mut();
+        }
+    };
+
+    let (mut sink, writer) = match RecorderSink::spawn(writer, format!("{}/{}", namespace_str, track_name_str)) {
+        Ok(started) => started,
+        Err(e) => {
+            set_last_error(format!("Failed to start recording thread: {}", e));
+            return std::ptr::null_mut();
+        }
+    };
+    let track_name_log = track_name_str.to_string();
+    let inband_headers = (*client).inner.inband_headers();
+    let task = RUNTIME.spawn(async move {
+        read_track(track_reader, &mut sink, inband_headers, &track_namespace, &track_name_log).await;
+    });
+
+    log::info!("Recording {}/{} to {}", namespace_str, track_name_str, path_str);
+    Box::into_raw(Box::new(MoqRecorder { task, writer }))
+}
+
+/// Stops a recorder and finalizes its recording.
+///
+/// Unsubscribes from the track, then waits until every segment and the index
+/// have been written back and their preallocated space trimmed, so the
+/// recording can be opened as soon as this returns. After `moq_shutdown()`
+/// only the recording is finalized; the runtime is not started again.
+///
+/// # Safety
+/// - `recorder` must be a valid pointer returned from `moq_recorder_create()`
+/// - `recorder` may be null (no-op)
+/// - `recorder` must not be used after this call
+/// - Must not be called from a library callback
+#[no_mangle]
+pub unsafe extern "C" fn moq_recorder_destroy(recorder: *mut MoqRecorder) {
+    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+        if !recorder.is_null() {
+            Box::from_raw(recorder).stop(&RUNTIME);
+            log::debug!("Destroyed recorder");
+        }
+    }));
+    // Silently handle panics - destructor should not propagate panics
+}
+
+#[repr(C)]
+pub struct MoqReplayer {
+    task: tokio::task::JoinHandle<()>,
+}
+
+/// When an object recorded `arrival_us` after the start is due, relative to
+/// the start of the replay; None means as fast as possible.
+fn replay_offset(arrival_us: u64, speed: f64) -> Option<Duration> {
+    (speed > 0.0).then(|| Duration::from_secs_f64(arrival_us as f64 / 1_000_000.0 / speed))
+}
+
+/// Objects published back to back before an unpaced replay yields to other tasks.
+const REPLAY_YIELD_INTERVAL: usize = 64;
+
+/// Republishes a recording with its group structure and, when `speed` is
+/// positive, its inter-arrival timing.
+async fn replay_recording(mut reader: RecordingReader, mut subgroups: serve::SubgroupsWriter, speed: f64) {
+    let start = tokio::time::Instant::now();
+    let mut current: Option<(u64, serve::SubgroupWriter)> = None;
+
+    for i in 0..reader.len() {
+        let entry = reader.entry(i);
+        match replay_offset(entry.arrival_us, speed) {
+            // Scheduled against the start, so timer slack doesn't accumulate
+            Some(offset) => tokio::time::sleep_until(start + offset).await,
+            None if i % REPLAY_YIELD_INTERVAL == REPLAY_YIELD_INTERVAL - 1 => tokio::task::yield_now().await,
+            None => {}
+        }
+
+        let payload = match reader.payload(&entry) {
+            Ok(payload) => payload,
+            Err(e) => {
+                log::error!("Replay stopped: failed to read object {}/{}: {}", entry.group_id, entry.object_id, e);
+                return;
+            }
+        };
+
+        // Objects of one group go out on one subgroup, in recorded order
+        if current.as_ref().map(|(group_id, _)| *group_id) != Some(entry.group_id) {
+            current = None;
+            let subgroup = serve::Subgroup {
+                group_id: entry.group_id,
+                subgroup_id: 0,
+                priority: 127,
+            };
+            match subgroups.create(subgroup) {
+                Ok(writer) => current = Some((entry.group_id, writer)),
+                Err(e) => {
+                    log::warn!("Replay skipped object {}/{}: failed to create group: {}", entry.group_id, entry.object_id, e);
+                    continue;
+                }
+            }
+        }
+        if let Some((_, writer)) = current.as_mut() {
+            if let Err(e) = writer.write(payload) {
+                log::warn!("Replay failed to write object {}/{}: {}", entry.group_id, entry.object_id, e);
+            }
+        }
+    }
+    log::info!("Replay of {} finished after {} objects", reader.track_name(), reader.len());
+}
+
+/// Republishes a recorded track.
+///
+/// Opens a recording made by `moq_recorder_create()`, creates its track in an
+/// announced namespace and publishes the recorded objects with their original
+/// group structure. Payloads are sent straight out of the memory-mapped
+/// segments without copying.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` and `path` must be valid null-terminated C string pointers
+/// - Namespace must be announced before replaying into it
+/// - Client must be connected
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `client`: Pointer to the MoQ client
+/// - `namespace`: Announced namespace to publish the recorded track in
+/// - `path`: Recording directory
+/// - `speed`: Playback rate relative to the recorded timing (1.0 is real
+///   time, 2.0 twice as fast); 0 publishes as fast as possible
+///
+/// # Returns
+/// Pointer to the created replayer, or null on failure (check `moq_last_error()`)
+#[no_mangle]
+pub unsafe extern "C" fn moq_replayer_create(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    path: *const c_char,
+    speed: f64,
+) -> *mut MoqReplayer {
+    std::panic::catch_unwind(|| {
+        moq_replayer_create_impl(client, namespace, path, speed)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_replayer_create");
+        set_last_error("Internal panic occurred in moq_replayer_create".to_string());
+        std::ptr::null_mut()
+    })
+}
+
+unsafe fn moq_replayer_create_impl(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    path: *const c_char,
+    speed: f64,
+) -> *mut MoqReplayer {
+    if client.is_null() || namespace.is_null() || path.is_null() {
+        set_last_error("Client, namespace, or path is null".to_string());
+        return std::ptr::null_mut();
+    }
+    if !(speed >= 0.0 && speed.is_finite()) {
+        set_last_error(format!("Invalid replay speed: {}", speed));
+        return std::ptr::null_mut();
+    }
+
+    let (namespace_str, path_str) = match (CStr::from_ptr(namespace).to_str(), CStr::from_ptr(path).to_str()) {
+        (Ok(ns), Ok(path)) => (ns, path),
+        _ => {
+            set_last_error("Invalid UTF-8 in namespace or path".to_string());
+            return std::ptr::null_mut();
+        }
+    };
+
+    let reader = match RecordingReader::open(std::path::Path::new(path_str)) {
+        Ok(reader) => reader,
+        Err(e) => {
+            set_last_error(format!("Failed to open recording at {}: {}", path_str, e));
+            return std::ptr::null_mut();
+        }
+    };
+
+    let inner = &(*client).inner;
+    if !inner.is_connected() {
+        set_last_error("Not connected to MoQ server".to_string());
+        return std::ptr::null_mut();
+    }
+
+    // Create the recorded track in the announced namespace (locks only its shard)
+    let track_namespace = TrackNamespace::from_utf8_path(namespace_str);
+    let subgroups = {
+        let mut shard = inner.announced_namespaces.shard(&track_namespace);
+        let tracks_writer = match shard.get_mut(&track_namespace) {
+            Some(tw) => tw,
+            None => {
+                set_last_error(format!("Namespace not announced: {}", namespace_str));
+                return std::ptr::null_mut();
+            }
+        };
+        let track = match tracks_writer.create(reader.track_name()) {
+            Some(track) => track,
+            None => {
+                set_last_error("Failed to create track (all readers dropped)".to_string());
+                return std::ptr::null_mut();
+            }
+        };
+        match track.groups() {
+            Ok(subgroups) => subgroups,
+            Err(e) => {
+                set_last_error(format!("Failed to create subgroups writer: {}", e));
+                return std::ptr::null_mut();
+            }
+        }
+    };
+
+    log::info!(
+        "Replaying {} objects of {} into {} at {}x",
+        reader.len(), reader.track_name(), namespace_str, speed
+    );
+    let task = RUNTIME.spawn(replay_recording(reader, subgroups, speed));
+    Box::into_raw(Box::new(MoqReplayer { task }))
+}
+
+/// Checks whether a replayer has published every recorded object.
+///
+/// # Safety
+/// - `replayer` must be a valid pointer returned from `moq_replayer_create()`
+/// - `replayer` may be null (returns true)
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_replayer_is_finished(replayer: *const MoqReplayer) -> bool {
+    std::panic::catch_unwind(|| {
+        replayer.is_null() || (*replayer).task.is_finished()
+    }).unwrap_or(true)
+}
+
+/// Stops a replayer and closes its track.
+///
+/// # Safety
+/// - `replayer` must be a valid pointer returned from `moq_replayer_create()`
+/// - `replayer` may be null (no-op)
+/// - `replayer` must not be used after this call
+#[no_mangle]
+pub unsafe extern "C" fn moq_replayer_destroy(replayer: *mut MoqReplayer) {
+    let _ = std::panic::catch_unwind(|| {
+        if !replayer.is_null() {
+            let replayer = Box::from_raw(replayer);
+            replayer.task.abort();
+            log::debug!("Destroyed replayer");
+        }
+    });
+    // Silently handle panics - destructor should not propagate panics
+}
+
+/* ───────────────────────────────────────────────
+ * Namespace Announcement Discovery
+ * ─────────────────────────────────────────────── */
+
+/// Subscribe to namespace announcements from other publishers.
+///
+/// Registers a callback to be invoked when the relay forwards ANNOUNCE messages
+/// from other publishers. This enables dynamic discovery of available namespaces
+/// without knowing them in advance.
+///
+/// **Current Limitations:**
+/// - Most relays (including Cloudflare) do not currently forward announcements
+///   to subscribers. This function prepares your application for future relay
+///   support of SUBSCRIBE_NAMESPACE or similar discovery mechanisms.
+/// - Until relay support is available, the callback will not be invoked.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `client` must not be null
+/// - `callback` may be null (to unregister the callback)
+/// - `user_data` will be passed to the callback and may be null
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `client`: Pointer to a connected MoQ client
+/// - `callback`: Callback for namespace announcements (NULL to unregister)
+/// - `user_data`: User data pointer passed to the callback
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if client is null
+/// - `MoqErrorNotConnected` if client is not connected
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe_announces(
+    client: *mut MoqClient,
+    callback: MoqTrackCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        moq_subscribe_announces_impl(client, callback, user_data)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscribe_announces");
+        make_error_result(
+            MoqResultCode::MoqErrorInternal,
+            "Internal panic occurred in moq_subscribe_announces",
+        )
+    })
+}
+
+unsafe fn moq_subscribe_announces_impl(
+    client: *mut MoqClient,
+    callback: MoqTrackCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    if client.is_null() {
+        return make_error_result(
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Client is null",
+        );
+    }
+
+    let inner = &(*client).inner;
+
+    // Store the callback (can be None to unregister); the listener picks it up on its next announce
+    inner.announce_callback.store(callback.map(|cb| CallbackSlot::new(Some(cb), user_data)));
+
+    let mut announce_task = match inner.announce_task.lock() {
+        Ok(guard) => guard,
+        Err(poisoned) => {
+            log::warn!("Mutex poisoned in moq_subscribe_announces, recovering");
+            poisoned.into_inner()
+        }
+    };
+
+    // If unregistering (callback is None), cancel any existing announce task
+    if callback.is_none() {
+        if let Some(task) = announce_task.take() {
+            task.abort();
+            log::info!("Unregistered announce callback, cancelled listener task");
+        }
+        return make_ok_result();
+    }
+
+    // If not connected, just store the callback for when we connect
+    if !inner.is_connected() {
+        log::info!("Announce callback registered (will activate on connect)");
+        return make_ok_result();
+    }
+
+    // If already have an announce task running, it will pick up the new callback
+    if announce_task.is_some() {
+        log::info!("Updated announce callback (existing listener active)");
+        return make_ok_result();
+    }
+
+    // Get the subscriber to listen for announces
+    let subscriber = match inner.session() {
+        Some(session) => session.subscriber.clone(),
+        None => {
+            log::warn!("No subscriber available for announce listening");
+            return make_ok_result(); // Not an error, just no subscriber role
+        }
+    };
+
+    // Clone what we need for the async task
+    let client_inner = inner.clone();
+
+    // Spawn task to listen for announces
+    let task = RUNTIME.spawn(async move {
+        let mut subscriber = subscriber;
+        
+        log::info!("Starting announce listener task");
+        
+        // Listen for announced namespaces
+        // Note: Most relays don't forward announces to subscribers yet,
+        // so this loop may never receive any announcements.
+        while let Some(mut announced) = subscriber.announced().await {
+            let namespace = announced.namespace.to_utf8_path();
+            log::info!("Received namespace announcement: {}", namespace);
+
+            // Invoke callback if registered (read without locking the client)
+            if let Some(slot) = client_inner.announce_callback.load_full() {
+                let namespace_cstr = match std::ffi::CString::new(namespace.clone()) {
+                    Ok(s) => s,
+                    Err(_) => {
+                        log::error!("Invalid namespace string (contains null byte)");
+                        continue;
+                    }
+                };
+
+                if let Some(cb) = slot.callback {
+                    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+                        cb(
+                            slot.user_data as *mut std::ffi::c_void,
+                            namespace_cstr.as_ptr(),
+                            std::ptr::null(), // track_name is null for namespace announcements
+                        );
+                    }));
+                }
+            }
+
+            // Accept the announcement (required by protocol)
+            if let Err(e) = announced.ok() {
+                log::warn!("Failed to accept announcement for {}: {}", namespace, e);
+            }
+        }
+
+        log::info!("Announce listener task ended");
+    });
+
+    *announce_task = Some(task);
+    log::info!("Announce callback registered and listener started");
+
+    make_ok_result()
+}
+
+/* ───────────────────────────────────────────────
+ * Catalog Subscription (Track Discovery)
+ * ─────────────────────────────────────────────── */
+
+/// Subscribe to a catalog track for automatic track discovery.
+/// 
+/// The catalog track should publish JSON data conforming to the MoQ catalog format
+/// (draft-ietf-moq-catalogformat). When catalog updates are received, the callback
+/// is invoked with the parsed track list.
+/// 
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string
+/// - `catalog_track_name` must be a valid null-terminated C string
+/// - None of the above may be null
+/// - `callback` may be null (no callback will be invoked)
+/// - `user_data` will be passed to the callback and may be null
+/// - This function is thread-safe
+/// 
+/// # Parameters
+/// - `client`: Pointer to a connected MoQ client
+/// - `namespace`: Namespace containing the catalog track
+/// - `catalog_track_name`: Name of the catalog track (e.g., "catalog")
+/// - `callback`: Optional callback for track list updates
+/// - `user_data`: User data pointer passed to the callback
+/// 
+/// # Returns
+/// Subscriber handle for the catalog, or NULL on failure.
+/// The returned subscriber must be destroyed with `moq_subscriber_destroy()`.
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe_catalog(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    catalog_track_name: *const c_char,
+    callback: MoqCatalogCallback,
+    user_data: *mut std::ffi::c_void,
+) -> *mut MoqSubscriber {
+    std::panic::catch_unwind(|| {
+        moq_subscribe_catalog_impl(client, namespace, catalog_track_name, callback, user_data)
+    }).unwrap_or_else(|_| {
+        log::error!("Panic in moq_subscribe_catalog");
+        set_last_error("Internal panic occurred in moq_subscribe_catalog".to_string());
+        std::ptr::null_mut()
+    })
+}
+
+unsafe fn moq_subscribe_catalog_impl(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    catalog_track_name: *const c_char,
+    callback: MoqCatalogCallback,
+    user_data: *mut std::ffi::c_void,
+) -> *mut MoqSubscriber {
+    // Validate arguments
+    if client.is_null() || namespace.is_null() || catalog_track_name.is_null() {
+        set_last_error("Client, namespace, or catalog_track_name is null".to_string());
+        return std::ptr::null_mut();
+    }
+
+    let namespace_str = match CStr::from_ptr(namespace).to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            set_last_error("Invalid UTF-8 in namespace".to_string());
+            return std::ptr::null_mut();
+        }
+    };
+
+    let track_name_str = match CStr::from_ptr(catalog_track_name).to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            set_last_error("Invalid UTF-8 in catalog_track_name".to_string());
+            return std::ptr::null_mut();
+        }
+    };
+
+    // Get subscriber (cloned from the session handles without locking the client)
+    let subscriber_impl = match (*client).inner.session() {
+        Some(session) => session.subscriber.clone(),
+        None => {
+            set_last_error("Not connected to MoQ server".to_string());
+            return std::ptr::null_mut();
+        }
+    };
+
+    // Parse namespace
+    let track_namespace = TrackNamespace::from_utf8_path(&namespace_str);
+
+    // Create track subscription using the same pattern as moq_subscribe
+    let tracks = Tracks::new(track_namespace.clone());
+    let (mut tracks_writer, _tracks_request, mut tracks_reader) = tracks.produce();
+    
+    // Create track writer for the catalog track
+    let track_writer = match tracks_writer.create(&track_name_str) {
+        Some(tw) => tw,
+        None => {
+            set_last_error("Failed to create track writer for catalog (tracks closed)".to_string());
+            return std::ptr::null_mut();
+        }
+    };
+
+    // Clone subscriber for the async task
+    let mut subscriber_for_task = subscriber_impl.clone();
+    let track_name_for_task = track_name_str.clone();
+    
+    // Spawn task to send subscribe request to relay
+    RUNTIME.spawn(async move {
+        if let Err(err) = subscriber_for_task.subscribe(track_writer).await {
+            log::warn!("Failed to subscribe to catalog track {}: {}", track_name_for_task, err);
+        }
+    });
+
+    // Get the track reader from TracksReader
+    let track_reader = match tracks_reader.subscribe(&track_name_str) {
+        Some(tr) => tr,
+        None => {
+            set_last_error("Failed to get track reader for catalog (no track available)".to_string());
+            return std::ptr::null_mut();
+        }
+    };
+
+    // Create subscriber with catalog-specific data callback
+    // (the data callback cell stays empty; the catalog callback is used instead)
+    let subscriber_inner = Arc::new(Mutex::new(SubscriberInner {
+        namespace: track_namespace.clone(),
+        track_name: track_name_str.clone(),
+        track: Some(track_reader.clone()),
+        reader_task: None,
+        subscribed: true,
+    }));
+
+    // Clone values for the async task
+    let track_namespace_log = track_namespace.clone();
+    let track_name_log = track_name_str.clone();
+    let user_data_usize = user_data as usize;
+    
+    // Spawn task to read catalog data and parse it
+    let track = track_reader;
+    let reader_inner = Arc::downgrade(&subscriber_inner);
+    let reader_task = RUNTIME.spawn(async move {
+
+        log::debug!("Starting catalog reader for {:?}/{}", track_namespace_log, track_name_log);
+
+        // Get the mode - following moq-sub pattern
+        let mode_result = track.mode().await;
+        match mode_result {
+            Ok(mode) => {
+                use moq::serve::TrackReaderMode;
+                
+                match mode {
+                    TrackReaderMode::Subgroups(mut groups) => {
+                        log::debug!("Catalog {:?}/{} using Subgroups mode", track_namespace_log, track_name_log);
+                        while let Ok(Some(mut group)) = groups.next().await {
+                            while let Ok(Some(mut object)) = group.next().await {
+                                // Read the complete catalog object
+                                let mut buf = Vec::with_capacity(object.size);
+                                while let Ok(Some(chunk)) = object.read().await {
+                                    buf.extend_from_slice(&chunk);
+                                }
+                                
+                                if !buf.is_empty() {
+                                    // Parse catalog and invoke callback
+                                    parse_and_invoke_catalog_callback(
+                                        &buf,
+                                        callback,
+                                        user_data_usize,
+                                        &track_namespace_log,
+                                        &track_name_log,
+                                    );
+                                }
+                            }
+                        }
+                        log::debug!("Catalog {:?}/{} subgroups ended", track_namespace_log, track_name_log);
+                    }
+                    TrackReaderMode::Stream(mut stream) => {
+                        log::debug!("Catalog {:?}/{} using Stream mode", track_namespace_log, track_name_log);
+                        while let Ok(Some(mut group)) = stream.next().await {
+                            while let Ok(Some(mut object)) = group.next().await {
+                                let mut buf = Vec::new();
+                                while let Ok(Some(chunk)) = object.read().await {
+                                    buf.extend_from_slice(&chunk);
+                                }
+                                
+                                if !buf.is_empty() {
+                                    parse_and_invoke_catalog_callback(
+                                        &buf,
+                                        callback,
+                                        user_data_usize,
+                                        &track_namespace_log,
+                                        &track_name_log,
+                                    );
+                                }
+                            }
+                        }
+                        log::debug!("Catalog {:?}/{} stream ended", track_namespace_log, track_name_log);
+                    }
+                    TrackReaderMode::Datagrams(mut datagrams) => {
+                        log::debug!("Catalog {:?}/{} using Datagrams mode", track_namespace_log, track_name_log);
+                        while let Ok(Some(datagram)) = datagrams.read().await {
+                            let buf = datagram.payload.to_vec();
+                            if !buf.is_empty() {
+                                parse_and_invoke_catalog_callback(
+                                    &buf,
+                                    callback,
+                                    user_data_usize,
+                                    &track_namespace_log,
+                                    &track_name_log,
+                                );
+                            }
+                        }
+                        log::debug!("Catalog {:?}/{} datagrams ended", track_namespace_log, track_name_log);
+                    }
+                }
+            }
+            Err(e) => {
+                log::error!("Failed to get track mode for catalog {:?}/{}: {}", track_namespace_log, track_name_log, e);
+            }
+        }
+        if let Some(inner) = reader_inner.upgrade() {
+            inner.lock().unwrap_or_else(|poisoned| poisoned.into_inner()).subscribed = false;
+        }
+    });
+
+    // Store reader task
+    {
+        let inner_result = subscriber_inner.lock();
+        let mut inner = match inner_result {
+            Ok(guard) => guard,
+            Err(poisoned) => {
+                log::warn!("Mutex poisoned when storing reader task, recovering");
+                poisoned.into_inner()
+            }
+        };
+        inner.reader_task = Some(reader_task);
+    }
+
+    let subscriber = MoqSubscriber {
+        inner: subscriber_inner,
+        callback: Arc::new(ArcSwapOption::empty()),
+        cache: Arc::new(ArcSwapOption::empty()),
+        queue: Arc::new(ObjectQueue::new()),
+    };
+
+    log::info!("Subscribed to catalog {}/{}", namespace_str, track_name_str);
+    Box::into_raw(Box::new(subscriber))
+}
+
+/// Helper function to parse catalog JSON and invoke the callback.
+/// 
+/// This function handles:
+/// - JSON parsing using serde_json and moq_catalog::Root
+/// - Converting moq_catalog::Track to MoqTrackInfo for FFI
+/// - String allocation for C-compatible strings
+/// - Callback invocation with panic protection
+/// - Proper cleanup of allocated strings
+fn parse_and_invoke_catalog_callback(
+    data: &[u8],
+    callback: MoqCatalogCallback,
+    user_data: usize,
+    namespace: &TrackNamespace,
+    track_name: &str,
+) {
+    // Skip if no callback
+    let callback_fn = match callback {
+        Some(cb) => cb,
+        None => {
+            log::debug!("No catalog callback set, skipping");
+            return;
+        }
+    };
+
+    // Try to parse as UTF-8 string first
+    let json_str = match std::str::from_utf8(data) {
+        Ok(s) => s,
+        Err(e) => {
+            log::warn!("Catalog data for {:?}/{} is not valid UTF-8: {}", namespace, track_name, e);
+            return;
+        }
+    };
+
+    // Parse catalog JSON using moq_catalog crate
+    let catalog: moq_catalog::Root = match serde_json::from_str(json_str) {
+        Ok(cat) => cat,
+        Err(e) => {
+            log::warn!("Failed to parse catalog JSON for {:?}/{}: {}", namespace, track_name, e);
+            log::debug!("Catalog JSON (first 500 chars): {:.500}", json_str);
+            return;
+        }
+    };
+
+    log::debug!(
+        "Parsed catalog v{} with {} tracks for {:?}/{}",
+        catalog.version,
+        catalog.tracks.len(),
+        namespace,
+        track_name
+    );
+
+    // Convert tracks to MoqTrackInfo structs for FFI
+    // We need to keep CStrings alive until after the callback
+    let mut c_strings: Vec<CString> = Vec::new();
+    let mut track_infos: Vec<MoqTrackInfo> = Vec::with_capacity(catalog.tracks.len());
+
+    for track in &catalog.tracks {
+        // Allocate C strings - we'll clean these up after the callback
+        let name_cstr = CString::new(track.name.as_str())
+            .unwrap_or_else(|_| CString::new("").unwrap());
+        let name_ptr = name_cstr.as_ptr();
+        c_strings.push(name_cstr);
+
+        let codec_ptr = if let Some(ref codec) = track.selection_params.codec {
+            let cstr = CString::new(codec.as_str())
+                .unwrap_or_else(|_| CString::new("").unwrap());
+            let ptr = cstr.as_ptr();
+            c_strings.push(cstr);
+            ptr
+        } else {
+            std::ptr::null()
+        };
+
+        let mime_type_ptr = if let Some(ref mime) = track.selection_params.mime_type {
+            let cstr = CString::new(mime.as_str())
+                .unwrap_or_else(|_| CString::new("").unwrap());
+            let ptr = cstr.as_ptr();
+            c_strings.push(cstr);
+            ptr
+        } else {
+            std::ptr::null()
+        };
+
+        let language_ptr = if let Some(ref lang) = track.selection_params.language {
+            let cstr = CString::new(lang.as_str())
+                .unwrap_or_else(|_| CString::new("").unwrap());
+            let ptr = cstr.as_ptr();
+            c_strings.push(cstr);
+            ptr
+        } else {
+            std::ptr::null()
+        };
+
+        track_infos.push(MoqTrackInfo {
+            name: name_ptr,
+            codec: codec_ptr,
+            mime_type: mime_type_ptr,
+            width: track.selection_params.width.unwrap_or(0),
+            height: track.selection_params.height.unwrap_or(0),
+            bitrate: track.selection_params.bitrate.unwrap_or(0),
+            sample_rate: track.selection_params.samplerate.unwrap_or(0),
+            language: language_ptr,
+        });
+    }
+
+    // Invoke callback with panic protection
+    let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| {
+        log::debug!("Invoking catalog callback with {} tracks", track_infos.len());
+        // Safety: callback_fn is a C function pointer, user_data is provided by caller
+        unsafe {
+            callback_fn(
+                user_data as *mut std::ffi::c_void,
+                if track_infos.is_empty() { std::ptr::null() } else { track_infos.as_ptr() },
+                track_infos.len(),
+            );
+        }
+    }));
+
+    // c_strings will be dropped here, freeing the memory
+    // This is safe because the callback should have copied any data it needs
+}
+
+/* ───────────────────────────────────────────────
+ * Simulated Network
+ * ─────────────────────────────────────────────── */
+
+/// One direction of a client's link to a simulated relay (stub backend only).
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct MoqSimLink {
+    pub latency_us: u32,
+    pub jitter_us: u32,
+    pub bandwidth_bps: u64,
+    pub loss: f64,
+}
+
+fn simulation_unsupported() -> MoqResult {
+    set_last_error("Simulated relays are only available in builds without the moq features".to_string());
+    make_error_result(
+        MoqResultCode::MoqErrorUnsupported,
+        "Simulated relays are only available in builds without the moq features",
+    )
+}
+
+/// Sets simulated link characteristics (unsupported with a real transport).
+///
+/// # Safety
+/// - Arguments are not dereferenced
+///
+/// # Returns
+/// Always `MoqErrorUnsupported`; use the impairment proxy of the test suite instead
+#[no_mangle]
+pub unsafe extern "C" fn moq_sim_set_link(
+    _client: *mut MoqClient,
+    _uplink: *const MoqSimLink,
+    _downlink: *const MoqSimLink,
+) -> MoqResult {
+    simulation_unsupported()
+}
+
+/// Advances a simulated relay's clock (unsupported with a real transport).
+///
+/// # Safety
+/// - `url` is not dereferenced
+///
+/// # Returns
+/// Always `MoqErrorUnsupported`
+#[no_mangle]
+pub unsafe extern "C" fn moq_sim_advance(_url: *const c_char, _duration_us: u64) -> MoqResult {
+    simulation_unsupported()
+}
+
+/// Returns a simulated relay's virtual time (always 0 with a real transport).
+///
+/// # Safety
+/// - `url` is not dereferenced
+#[no_mangle]
+pub unsafe extern "C" fn moq_sim_now(_url: *const c_char) -> u64 {
+    0
+}
+
+/* ───────────────────────────────────────────────
+ * Utilities
+ * ─────────────────────────────────────────────── */
+
+/// Frees a string allocated by the FFI library.
+///
+/// # Safety
+/// - `s` must be a valid pointer returned by a moq_ffi function that requires freeing
+/// - `s` must not be null (null pointers are safely ignored)
+/// - `s` must not be accessed after this function returns
+/// - `s` must not be a static string (like those from moq_version or moq_last_error)
+/// - This function is thread-safe
+///
+/// # Parameters
+/// - `s`: Pointer to the string to free, or null (null is safely ignored)
+///
+/// # Note
+/// Only use this for strings in MoqResult.message fields where code != MOQ_OK.
+/// Do NOT use this for moq_version() or moq_last_error() return values.
+#[no_mangle]
+pub unsafe extern "C" fn moq_free_str(s: *const c_char) {
+    let _ = std::panic::catch_unwind(|| {
+        if !s.is_null() {
+            let _ = CString::from_raw(s as *mut c_char);
+        }
+    });
+    // Silently handle panics - free function should not propagate panics
+}
+
+/// Returns the version string of the library.
+///
+/// # Returns
+/// A pointer to a static null-terminated C string containing the version.
+/// This string must NOT be freed - it is a static string.
+///
+/// # Thread Safety
+/// This function is thread-safe.
+#[no_mangle]
+pub extern "C" fn moq_version() -> *const c_char {
+    #[cfg(feature = "with_moq")]
+    {
+        const VERSION: &[u8] = b"moq_ffi 0.1.0 (IETF Draft 14)\0";
+        VERSION.as_ptr() as *const c_char
+    }
+    
+    #[cfg(feature = "with_moq_draft07")]
+    {
+        const VERSION: &[u8] = b"moq_ffi 0.1.0 (IETF Draft 07)\0";
+        VERSION.as_ptr() as *const c_char
+    }
+    
+    #[cfg(not(any(feature = "with_moq", feature = "with_moq_draft07")))]
+    {
+        // Stub build - no MoQ transport
+        const VERSION: &[u8] = b"moq_ffi 0.1.0 (stub)\0";
+        VERSION.as_ptr() as *const c_char
+    }
+}
+
+/// Returns the last error message for this thread.
+///
+/// # Returns
+/// A pointer to a null-terminated C string containing the last error message,
+/// or null if no error has occurred. The string is valid until the next error
+/// occurs in this thread or the thread exits. The caller must NOT free this pointer.
+///
+/// # Thread Safety
+/// This function is thread-safe. Each thread has its own error storage.
+///
+/// # Note
+/// This pointer is thread-local and should NOT be freed with moq_free_str().
+#[no_mangle]
+pub extern "C" fn moq_last_error() -> *const c_char {
+    // Note: This returns a pointer that is valid until the next error occurs
+    // in this thread. The caller should NOT free this pointer.
+    // This is a common pattern in C FFI for error reporting.
+    match get_last_error() {
+        Some(err) => {
+            // Create a static string that we'll reuse per thread
+            thread_local! {
+                static ERROR_BUF: std::cell::RefCell<Option<CString>> = const { std::cell::RefCell::new(None) };
+            }
+            
+            ERROR_BUF.with(|buf| {
+                let c_str = CString::new(err).unwrap_or_else(|_| CString::new("Unknown error").unwrap());
+                *buf.borrow_mut() = Some(c_str);
+                buf.borrow().as_ref().unwrap().as_ptr()
+            })
+        }
+        None => std::ptr::null(),
+    }
+}
+
+/// Snapshot of the library's async runtime, for monitoring and soak tests.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct MoqRuntimeStats {
+    /// Worker threads of the runtime
+    pub worker_threads: usize,
+    /// Tasks spawned and not yet finished (reader tasks, session drivers, ...)
+    pub alive_tasks: usize,
+    /// Tasks waiting in the runtime's global queue
+    pub global_queue_depth: usize,
+}
+
+/// Fills `stats` with the current state of the library's async runtime.
+///
+/// A steadily rising `alive_tasks` count under a constant workload points to
+/// tasks that are never torn down.
+///
+/// # Safety
+/// - `stats` must be a valid pointer to writable `MoqRuntimeStats`, or null
+/// - This function is thread-safe
+///
+/// # Returns
+/// `true` on success, `false` if `stats` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_get_runtime_stats(stats: *mut MoqRuntimeStats) -> bool {
+    std::panic::catch_unwind(|| {
+        if stats.is_null() {
+            return false;
+        }
+        let metrics = RUNTIME.metrics();
+        *stats = MoqRuntimeStats {
+            worker_threads: metrics.num_workers(),
+            alive_tasks: metrics.num_alive_tasks(),
+            global_queue_depth: metrics.global_queue_depth(),
+        };
+        true
+    }).unwrap_or(false)
+}
+
+/* ───────────────────────────────────────────────
+ * Tests
+ * ─────────────────────────────────────────────── */
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::ffi::CStr;
+
+    /* ───────────────────────────────────────────────
+     * Lifecycle Tests
+     * ─────────────────────────────────────────────── */
+
+    mod lifecycle {
+        use super::*;
+
+        #[test]
+        fn test_client_create_returns_valid_pointer() {
+            let client = moq_client_create();
+            assert!(!client.is_null(), "Client creation should return non-null pointer");
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_client_destroy_with_null_is_safe() {
+            // Should not crash
+            unsafe { moq_client_destroy(std::ptr::null_mut()); }
+        }
+
+        #[test]
+        fn test_client_create_and_destroy_multiple() {
+            // Test creating and destroying multiple clients
+            for _ in 0..10 {
+                let client = moq_client_create();
+                assert!(!client.is_null());
+                unsafe { moq_client_destroy(client); }
+            }
+        }
+
+        #[test]
+        fn test_publisher_destroy_with_null_is_safe() {
+            // Should not crash
+            unsafe { moq_publisher_destroy(std::ptr::null_mut()); }
+        }
+
+        #[test]
+        fn test_subscriber_destroy_with_null_is_safe() {
+            // Should not crash
+            unsafe { moq_subscriber_destroy(std::ptr::null_mut()); }
+        }
+
+        #[test]
+        fn test_client_has_expected_initial_state() {
+            let client = moq_client_create();
+            assert!(!client.is_null());
+            
+            // Verify initial state
+            let connected = unsafe { moq_is_connected(client) };
+            assert!(!connected, "New client should not be connected");
+            
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_runtime_initialization() {
+            // Test that RUNTIME can be accessed without panicking
+            let _ = RUNTIME.handle();
+        }
+
+        #[test]
+        fn test_moq_init_succeeds() {
+            // Test that moq_init() can be called successfully
+            let result = moq_init();
+            assert!(result, "moq_init() should succeed");
+        }
+
+        #[test]
+        fn test_moq_init_is_idempotent() {
+            // Test that calling moq_init() multiple times is safe
+            for _ in 0..5 {
+                let result = moq_init();
+                assert!(result, "moq_init() should succeed on repeated calls");
+            }
+        }
+
+        #[test]
+        fn test_moq_init_before_client_create() {
+            // Test the recommended usage pattern: init before creating clients
+            let init_result = moq_init();
+            assert!(init_result, "moq_init() should return true");
+            
+            let client = moq_client_create();
+            assert!(!client.is_null(), "Client should be created after init");
+            
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_client_create_without_explicit_init() {
+            // Test that client creation works without explicitly calling moq_init()
+            // (it should auto-initialize on first connection)
+            let client = moq_client_create();
+            assert!(!client.is_null(), "Client should be created even without explicit init");
+            
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_crypto_provider_initialized_on_connect() {
+            // Test that crypto provider is initialized when connecting
+            // This ensures automatic initialization works
+            let client = moq_client_create();
+            assert!(!client.is_null());
+            
+            let url = std::ffi::CString::new("https://example.com:443").unwrap();
+            let _result = unsafe {
+                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
+            };
+            
+            // Even though connection will fail (invalid URL), crypto provider should be initialized
+            // No panic should occur
+            
+            unsafe { moq_client_destroy(client); }
+        }
+    }
+
+    /* ───────────────────────────────────────────────
+     * Null Pointer Tests
+     * ─────────────────────────────────────────────── */
+
+    mod null_pointer {
+        use super::*;
+
+        #[test]
+        fn test_connect_with_null_client() {
+            let url = std::ffi::CString::new("https://example.com").unwrap();
+            let result = unsafe {
+                moq_connect(
+                    std::ptr::null_mut(),
+                    url.as_ptr(),
+                    None,
+                    std::ptr::null_mut(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_connect_with_null_url() {
+            let client = moq_client_create();
+            let result = unsafe {
+                moq_connect(
+                    client,
+                    std::ptr::null(),
+                    None,
+                    std::ptr::null_mut(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+
+        unsafe extern "C" fn unexpected_completion(_user_data: *mut std::ffi::c_void, _result: MoqResult) {
+            panic!("Completion must not run for an attempt that was never started");
+        }
+
+        #[test]
+        fn test_connect_async_rejects_arguments_synchronously() {
+            let client = moq_client_create();
+            let url = std::ffi::CString::new("ftp://example.com").unwrap();
+            unsafe {
+                let result = moq_connect_async(client, url.as_ptr(), None, std::ptr::null_mut(), Some(unexpected_completion));
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+
+                let result = moq_connect_async(std::ptr::null_mut(), url.as_ptr(), None, std::ptr::null_mut(), Some(unexpected_completion));
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_subscriber_next_with_null_arguments() {
+            let mut object = MoqReceivedObject::empty();
+            unsafe {
+                let result = moq_subscriber_next(std::ptr::null_mut(), &mut object, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+                moq_object_release(std::ptr::null_mut());
+                moq_object_release(&mut object);
+            }
+        }
+
+        #[test]
+        fn test_disconnect_with_null_client() {
+            let result = unsafe { moq_disconnect(std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_is_connected_with_null_client() {
+            let connected = unsafe { moq_is_connected(std::ptr::null()) };
+            assert!(!connected);
+        }
+
+        #[test]
+        fn test_announce_namespace_with_null_client() {
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let result = unsafe {
+                moq_announce_namespace(std::ptr::null_mut(), namespace.as_ptr())
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_announce_namespace_with_null_namespace() {
+            let client = moq_client_create();
+            let result = unsafe {
+                moq_announce_namespace(client, std::ptr::null())
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_create_publisher_with_null_client() {
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track").unwrap();
+            let publisher = unsafe {
+                moq_create_publisher(std::ptr::null_mut(), namespace.as_ptr(), track.as_ptr())
+            };
+            assert!(publisher.is_null());
+        }
+
+        #[test]
+        fn test_create_publisher_with_null_namespace() {
+            let client = moq_client_create();
+            let track = std::ffi::CString::new("track").unwrap();
+            let publisher = unsafe {
+                moq_create_publisher(client, std::ptr::null(), track.as_ptr())
+            };
+            assert!(publisher.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_create_publisher_with_null_track_name() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let publisher = unsafe {
+                moq_create_publisher(client, namespace.as_ptr(), std::ptr::null())
+            };
+            assert!(publisher.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_create_publisher_ex_with_null_client() {
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track").unwrap();
+            let publisher = unsafe {
+                moq_create_publisher_ex(
+                    std::ptr::null_mut(),
+                    namespace.as_ptr(),
+                    track.as_ptr(),
+                    MoqDeliveryMode::MoqDeliveryStream,
+                )
+            };
+            assert!(publisher.is_null());
+        }
+
+        #[test]
+        fn test_create_publisher_ex_with_null_namespace() {
+            let client = moq_client_create();
+            let track = std::ffi::CString::new("track").unwrap();
+            let publisher = unsafe {
+                moq_create_publisher_ex(
+                    client,
+                    std::ptr::null(),
+                    track.as_ptr(),
+                    MoqDeliveryMode::MoqDeliveryDatagram,
+                )
+            };
+            assert!(publisher.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_create_publisher_ex_with_null_track_name() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let publisher = unsafe {
+                moq_create_publisher_ex(
+                    client,
+                    namespace.as_ptr(),
+                    std::ptr::null(),
+                    MoqDeliveryMode::MoqDeliveryStream,
+                )
+            };
+            assert!(publisher.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_publish_data_with_null_publisher() {
+            let data = [1u8, 2, 3, 4, 5];
+            let result = unsafe {
+                moq_publish_data(
+                    std::ptr::null_mut(),
+                    data.as_ptr(),
+                    data.len(),
+                    MoqDeliveryMode::MoqDeliveryStream,
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_flush_is_unsupported_over_the_network() {
+            let mut unacked = 7u64;
+            // Never dereferenced: the checks only look for null
+            let publisher = std::ptr::NonNull::<MoqPublisher>::dangling().as_ptr();
+            unsafe {
+                for (publisher, expected) in [
+                    (std::ptr::null_mut(), MoqResultCode::MoqErrorInvalidArgument),
+                    (publisher, MoqResultCode::MoqErrorUnsupported),
+                ] {
+                    for result in [
+                        moq_publisher_flush(publisher, 10),
+                        moq_publisher_flush_async(publisher, 10, None, std::ptr::null_mut()),
+                        moq_publisher_get_unacked_bytes(publisher, &mut unacked),
+                    ] {
+                        assert_eq!(result.code, expected);
+                        moq_free_str(result.message);
+                    }
+                }
+            }
+            assert_eq!(unacked, 7);
+        }
+
+        #[test]
+        fn test_publish_data_with_null_data_and_nonzero_length() {
+            // Create a fake publisher (we won't actually use it, just testing validation)
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track").unwrap();
+            
+            // This will return null since client is not connected, but that's fine for this test
+            let publisher = unsafe {
+                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
+            };
+            
+            if publisher.is_null() {
+                // Expected - client not connected
+                unsafe { moq_client_destroy(client); }
+                return;
+            }
+            
+            let result = unsafe {
+                moq_publish_data(
+                    publisher,
+                    std::ptr::null(),
+                    10, // non-zero length with null pointer
+                    MoqDeliveryMode::MoqDeliveryStream,
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe {
+                moq_free_str(result.message);
+                moq_publisher_destroy(publisher);
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_subscribe_with_null_client() {
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track").unwrap();
+            let subscriber = unsafe {
+                moq_subscribe(
+                    std::ptr::null_mut(),
+                    namespace.as_ptr(),
+                    track.as_ptr(),
+                    None,
+                    std::ptr::null_mut(),
+                )
+            };
+            assert!(subscriber.is_null());
+        }
+
+        #[test]
+        fn test_subscribe_with_null_namespace() {
+            let client = moq_client_create();
+            let track = std::ffi::CString::new("track").unwrap();
+            let subscriber = unsafe {
+                moq_subscribe(
+                    client,
+                    std::ptr::null(),
+                    track.as_ptr(),
+                    None,
+                    std::ptr::null_mut(),
+                )
+            };
+            assert!(subscriber.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_subscribe_with_null_track_name() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let subscriber = unsafe {
+                moq_subscribe(
+                    client,
+                    namespace.as_ptr(),
+                    std::ptr::null(),
+                    None,
+                    std::ptr::null_mut(),
+                )
+            };
+            assert!(subscriber.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_create_publishers_with_null_arguments() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let mut out = [std::ptr::null_mut::<MoqPublisher>(); 2];
+
+            let result = unsafe {
+                moq_create_publishers(
+                    std::ptr::null_mut(),
+                    namespace.as_ptr(),
+                    std::ptr::null(),
+                    0,
+                    MoqDeliveryMode::MoqDeliveryStream,
+                    out.as_mut_ptr(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+
+            let result = unsafe {
+                moq_create_publishers(
+                    client,
+                    namespace.as_ptr(),
+                    std::ptr::null(),
+                    out.len(),
+                    MoqDeliveryMode::MoqDeliveryStream,
+                    out.as_mut_ptr(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_create_publishers_with_null_track_name_entry() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track1").unwrap();
+            let names = [track.as_ptr(), std::ptr::null()];
+            let mut out = [std::ptr::null_mut::<MoqPublisher>(); 2];
+
+            let result = unsafe {
+                moq_create_publishers(
+                    client,
+                    namespace.as_ptr(),
+                    names.as_ptr(),
+                    names.len(),
+                    MoqDeliveryMode::MoqDeliveryStream,
+                    out.as_mut_ptr(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(out.iter().all(|p| p.is_null()));
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_subscribe_many_with_null_arguments() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track1").unwrap();
+            let names = [track.as_ptr()];
+            let mut out = [std::ptr::null_mut::<MoqSubscriber>(); 1];
+
+            let result = unsafe {
+                moq_subscribe_many(
+                    client,
+                    std::ptr::null(),
+                    names.as_ptr(),
+                    names.len(),
+                    None,
+                    std::ptr::null(),
+                    out.as_mut_ptr(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+
+            let result = unsafe {
+                moq_subscribe_many(
+                    client,
+                    namespace.as_ptr(),
+                    names.as_ptr(),
+                    names.len(),
+                    None,
+                    std::ptr::null(),
+                    std::ptr::null_mut(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_free_str_with_null_is_safe() {
+            // Should not crash
+            unsafe { moq_free_str(std::ptr::null()); }
+        }
+
+        #[test]
+        fn test_unsubscribe_with_null_subscriber() {
+            let result = unsafe { moq_unsubscribe(std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_is_subscribed_with_null_subscriber() {
+            let subscribed = unsafe { moq_is_subscribed(std::ptr::null()) };
+            assert!(!subscribed);
+        }
+
+        #[test]
+        fn test_subscriber_set_callback_with_null_subscriber() {
+            let result = unsafe { moq_subscriber_set_callback(std::ptr::null_mut(), None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe { moq_free_str(result.message); }
+
+            let result = unsafe {
+                moq_subscriber_set_batch_callback(std::ptr::null_mut(), None, std::ptr::null_mut(), 0, 0)
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_subscribe_batched_with_null_arguments() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track").unwrap();
+            unsafe {
+                assert!(moq_subscribe_batched(std::ptr::null_mut(), namespace.as_ptr(), track.as_ptr(), None, std::ptr::null_mut(), 0, 0).is_null());
+                assert!(moq_subscribe_batched(client, std::ptr::null(), track.as_ptr(), None, std::ptr::null_mut(), 0, 0).is_null());
+                assert!(moq_subscribe_batched(client, namespace.as_ptr(), std::ptr::null(), None, std::ptr::null_mut(), 0, 0).is_null());
+                // Valid arguments still fail while disconnected
+                assert!(moq_subscribe_batched(client, namespace.as_ptr(), track.as_ptr(), None, std::ptr::null_mut(), 0, 0).is_null());
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_subscribe_announces_with_null_client() {
+            let result = unsafe { moq_subscribe_announces(std::ptr::null_mut(), None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_subscribe_announces_succeeds() {
+            let client = moq_client_create();
+            // Can register callback even when not connected
+            let result = unsafe { moq_subscribe_announces(client, None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            assert!(result.message.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_subscribe_announces_with_callback() {
+            extern "C" fn announce_callback(
+                _user_data: *mut std::ffi::c_void,
+                _namespace: *const c_char,
+                _track_name: *const c_char,
+            ) {
+                // Callback for announce notifications
+            }
+
+            let client = moq_client_create();
+            let result = unsafe { 
+                moq_subscribe_announces(client, Some(announce_callback), std::ptr::null_mut()) 
+            };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            assert!(result.message.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+    }
 
-    // c_strings will be dropped here, freeing the memory
-    // This is safe because the callback should have copied any data it needs
-}
+    /* ───────────────────────────────────────────────
+     * Error Handling Tests
+     * ─────────────────────────────────────────────── */
 
-/* ───────────────────────────────────────────────
- * Utilities
- * ─────────────────────────────────────────────── */
+    mod error_handling {
+        use super::*;
 
-/// Frees a string allocated by the FFI library.
-///
-/// # Safety
-/// - `s` must be a valid pointer returned by a moq_ffi function that requires freeing
-/// - `s` must not be null (null pointers are safely ignored)
-/// - `s` must not be accessed after this function returns
-/// - `s` must not be a static string (like those from moq_version or moq_last_error)
-/// - This function is thread-safe
-///
-/// # Parameters
-/// - `s`: Pointer to the string to free, or null (null is safely ignored)
-///
-/// # Note
-/// Only use this for strings in MoqResult.message fields where code != MOQ_OK.
-/// Do NOT use this for moq_version() or moq_last_error() return values.
-#[no_mangle]
-pub unsafe extern "C" fn moq_free_str(s: *const c_char) {
-    let _ = std::panic::catch_unwind(|| {
-        if !s.is_null() {
-            let _ = CString::from_raw(s as *mut c_char);
+        #[test]
+        fn test_connect_with_invalid_url_scheme() {
+            let client = moq_client_create();
+            let url = std::ffi::CString::new("http://example.com").unwrap(); // http instead of https
+            let result = unsafe {
+                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            
+            let message = unsafe { CStr::from_ptr(result.message).to_string_lossy() };
+            assert!(message.contains("https://") || message.contains("URL"));
+            
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
         }
-    });
-    // Silently handle panics - free function should not propagate panics
-}
 
-/// Returns the version string of the library.
-///
-/// # Returns
-/// A pointer to a static null-terminated C string containing the version.
-/// This string must NOT be freed - it is a static string.
-///
-/// # Thread Safety
-/// This function is thread-safe.
-#[no_mangle]
-pub extern "C" fn moq_version() -> *const c_char {
-    #[cfg(feature = "with_moq")]
-    {
-        const VERSION: &[u8] = b"moq_ffi 0.1.0 (IETF Draft 14)\0";
-        VERSION.as_ptr() as *const c_char
-    }
-    
-    #[cfg(feature = "with_moq_draft07")]
-    {
-        const VERSION: &[u8] = b"moq_ffi 0.1.0 (IETF Draft 07)\0";
-        VERSION.as_ptr() as *const c_char
-    }
-    
-    #[cfg(not(any(feature = "with_moq", feature = "with_moq_draft07")))]
-    {
-        // Stub build - no MoQ transport
-        const VERSION: &[u8] = b"moq_ffi 0.1.0 (stub)\0";
-        VERSION.as_ptr() as *const c_char
-    }
-}
+        #[test]
+        fn test_connect_with_malformed_url() {
+            let client = moq_client_create();
+            let url = std::ffi::CString::new("not_a_valid_url").unwrap();
+            let result = unsafe {
+                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
+            };
+            assert_ne!(result.code, MoqResultCode::MoqOk);
+            assert!(!result.message.is_null());
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
 
-/// Returns the last error message for this thread.
-///
-/// # Returns
-/// A pointer to a null-terminated C string containing the last error message,
-/// or null if no error has occurred. The string is valid until the next error
-/// occurs in this thread or the thread exits. The caller must NOT free this pointer.
-///
-/// # Thread Safety
-/// This function is thread-safe. Each thread has its own error storage.
-///
-/// # Note
-/// This pointer is thread-local and should NOT be freed with moq_free_str().
-#[no_mangle]
-pub extern "C" fn moq_last_error() -> *const c_char {
-    // Note: This returns a pointer that is valid until the next error occurs
-    // in this thread. The caller should NOT free this pointer.
-    // This is a common pattern in C FFI for error reporting.
-    match get_last_error() {
-        Some(err) => {
-            // Create a static string that we'll reuse per thread
-            thread_local! {
-                static ERROR_BUF: std::cell::RefCell<Option<CString>> = const { std::cell::RefCell::new(None) };
+        #[test]
+        fn test_disconnect_succeeds_with_valid_client() {
+            let client = moq_client_create();
+            let result = unsafe { moq_disconnect(client) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            assert!(result.message.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_graceful_disconnect_without_session() {
+            let client = moq_client_create();
+            unsafe {
+                let result = moq_disconnect_graceful(std::ptr::null_mut(), 100);
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+
+                // Nothing queued, so nothing to wait for
+                let result = moq_disconnect_graceful(client, 0);
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+                assert!(!moq_is_connected(client));
+                moq_client_destroy(client);
             }
-            
-            ERROR_BUF.with(|buf| {
-                let c_str = CString::new(err).unwrap_or_else(|_| CString::new("Unknown error").unwrap());
-                *buf.borrow_mut() = Some(c_str);
-                buf.borrow().as_ref().unwrap().as_ptr()
-            })
         }
-        None => std::ptr::null(),
-    }
-}
 
-/* ───────────────────────────────────────────────
- * Tests
- * ─────────────────────────────────────────────── */
+        #[test]
+        fn test_runtime_starts_again_after_shutdown() {
+            // A runtime of its own: shutting down the library's would abort other tests' tasks
+            let shared = SharedRuntime::new();
+            assert!(shared.shutdown(Duration::from_millis(100)), "Nothing to shut down before first use");
+            shared.handle();
+            assert!(!shared.shutdown(Duration::ZERO), "Workers cannot have exited without a wait");
+            for round in 0..3 {
+                let worker = shared.block_on(shared.spawn(async { std::thread::current().id() })).unwrap();
+                assert_ne!(worker, std::thread::current().id());
+                let lingering = shared.spawn(std::future::pending::<()>());
+                assert!(shared.shutdown(Duration::from_secs(5)), "Workers should exit in round {}", round);
+                assert!(shared.block_on(lingering).unwrap_err().is_cancelled());
+            }
+        }
 
-#[cfg(test)]
-mod tests {
-    use super::*;
-    use std::ffi::CStr;
+        #[test]
+        fn test_prewarm_checks_urls_and_resolves_hosts() {
+            let invalid = CString::new("http://localhost:4443").unwrap();
+            let local = CString::new("https://localhost:4443/moq").unwrap();
+            unsafe {
+                let result = moq_prewarm(std::ptr::null(), 1);
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+                let urls = [local.as_ptr(), invalid.as_ptr()];
+                let result = moq_prewarm(urls.as_ptr(), urls.len());
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
 
-    /* ───────────────────────────────────────────────
-     * Lifecycle Tests
-     * ─────────────────────────────────────────────── */
+                // Runtime, crypto and certificates only
+                assert_eq!(moq_prewarm(std::ptr::null(), 0).code, MoqResultCode::MoqOk);
+                assert_eq!(moq_prewarm(urls.as_ptr(), 1).code, MoqResultCode::MoqOk);
+            }
+            assert!(Arc::ptr_eq(&root_certs(), &root_certs()), "Certificates should be read once");
+            assert!(take_prewarmed("https://localhost:4443/moq", UdpOffload::default()).is_none());
+        }
 
-    mod lifecycle {
-        use super::*;
+        #[test]
+        fn test_shutdown_refused_from_a_callback() {
+            fn shutdown_code() -> MoqResultCode {
+                let result = moq_shutdown(0);
+                unsafe { moq_free_str(result.message) };
+                result.code
+            }
+            // Callbacks run on the runtime's workers
+            let code = RUNTIME.block_on(RUNTIME.spawn(async { shutdown_code() })).unwrap();
+            assert_eq!(code, MoqResultCode::MoqErrorInvalidArgument);
+            let code = RUNTIME.block_on(RUNTIME.handle().spawn_blocking(shutdown_code)).unwrap();
+            assert_eq!(code, MoqResultCode::MoqErrorInvalidArgument);
+        }
 
         #[test]
-        fn test_client_create_returns_valid_pointer() {
+        fn test_host_runtime_threads_are_not_library_threads() {
+            let host = tokio::runtime::Builder::new_multi_thread().worker_threads(1).build().unwrap();
+            assert!(!host.block_on(host.spawn(async { on_library_thread() })).unwrap());
+            assert!(!host.block_on(async { on_library_thread() }));
+            assert!(RUNTIME.block_on(RUNTIME.spawn(async { on_library_thread() })).unwrap());
+        }
+
+        #[test]
+        fn test_is_connected_returns_false_before_connection() {
             let client = moq_client_create();
-            assert!(!client.is_null(), "Client creation should return non-null pointer");
+            let connected = unsafe { moq_is_connected(client) };
+            assert!(!connected);
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_client_destroy_with_null_is_safe() {
-            // Should not crash
-            unsafe { moq_client_destroy(std::ptr::null_mut()); }
+        fn test_transport_stats_need_a_connection() {
+            let client = moq_client_create();
+            let result = unsafe { moq_client_set_udp_offload(client, false, true) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            let inner = unsafe { &(*client).inner };
+            assert_eq!(*inner.udp_offload.lock().unwrap(), UdpOffload { gso: false, gro: true });
+
+            let mut stats = MoqTransportStats::default();
+            let result = unsafe { moq_client_get_transport_stats(client, &mut stats) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+            unsafe { moq_free_str(result.message); }
+            let result = unsafe { moq_client_get_transport_stats(client, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
         }
 
         #[test]
-        fn test_client_create_and_destroy_multiple() {
-            // Test creating and destroying multiple clients
-            for _ in 0..10 {
-                let client = moq_client_create();
-                assert!(!client.is_null());
-                unsafe { moq_client_destroy(client); }
+        fn test_inband_headers_are_opt_in() {
+            let client = moq_client_create();
+            assert!(!unsafe { &(*client).inner }.inband_headers());
+            let result = unsafe { moq_client_set_inband_headers(client, true) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            assert!(unsafe { &(*client).inner }.inband_headers());
+
+            let result = unsafe { moq_client_set_inband_headers(std::ptr::null_mut(), true) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
             }
         }
 
         #[test]
-        fn test_publisher_destroy_with_null_is_safe() {
-            // Should not crash
-            unsafe { moq_publisher_destroy(std::ptr::null_mut()); }
+        fn test_auto_resume_is_opt_in() {
+            let client = moq_client_create();
+            let inner = unsafe { &(*client).inner };
+            assert!(!inner.auto_resume());
+            let result = unsafe { moq_client_set_auto_resume(client, true) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            assert!(inner.auto_resume());
+
+            // Without a session there is nothing of the client's to resume or report
+            assert!(!inner.owns_session(&std::sync::Weak::new()));
+            disconnect(inner, MoqConnectionState::MoqStateFailed);
+            assert_eq!(inner.state.load(Ordering::Acquire), MoqConnectionState::MoqStateFailed as u8);
+
+            let result = unsafe { moq_client_set_auto_resume(std::ptr::null_mut(), true) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
         }
 
         #[test]
-        fn test_subscriber_destroy_with_null_is_safe() {
-            // Should not crash
-            unsafe { moq_subscriber_destroy(std::ptr::null_mut()); }
+        fn test_latency_probe_needs_a_connection() {
+            let client = moq_client_create();
+            let result = unsafe { moq_client_start_latency_probe(client, 0, None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+            let result = unsafe { moq_client_start_latency_probe(client, 100, None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+            unsafe { moq_free_str(result.message); }
+            let inner = unsafe { &(*client).inner };
+            assert!(inner.latency_probe.lock().unwrap().is_none());
+
+            let mut stats = MoqLatencyStats { probes_sent: 1, ..MoqLatencyStats::default() };
+            let result = unsafe { moq_client_get_latency_stats(client, &mut stats) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            assert_eq!(stats.probes_sent, 0);
+            let result = unsafe { moq_client_stop_latency_probe(client) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_client_has_expected_initial_state() {
+        fn test_announce_namespace_fails_when_not_connected() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test/namespace").unwrap();
+            let result = unsafe {
+                moq_announce_namespace(client, namespace.as_ptr())
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+            assert!(!result.message.is_null());
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_create_publisher_fails_when_not_connected() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track1").unwrap();
+            let publisher = unsafe {
+                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
+            };
+            assert!(publisher.is_null());
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_create_publisher_ex_fails_when_not_connected() {
             let client = moq_client_create();
-            assert!(!client.is_null());
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track1").unwrap();
             
-            // Verify initial state
-            let connected = unsafe { moq_is_connected(client) };
-            assert!(!connected, "New client should not be connected");
+            // Test with datagram mode
+            let publisher = unsafe {
+                moq_create_publisher_ex(
+                    client,
+                    namespace.as_ptr(),
+                    track.as_ptr(),
+                    MoqDeliveryMode::MoqDeliveryDatagram,
+                )
+            };
+            assert!(publisher.is_null());
+            
+            // Test with stream mode
+            let publisher = unsafe {
+                moq_create_publisher_ex(
+                    client,
+                    namespace.as_ptr(),
+                    track.as_ptr(),
+                    MoqDeliveryMode::MoqDeliveryStream,
+                )
+            };
+            assert!(publisher.is_null());
             
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_runtime_initialization() {
-            // Test that RUNTIME can be accessed without panicking
-            let _ = &*RUNTIME;
+        fn test_subscribe_fails_when_not_connected() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track1").unwrap();
+            let subscriber = unsafe {
+                moq_subscribe(
+                    client,
+                    namespace.as_ptr(),
+                    track.as_ptr(),
+                    None,
+                    std::ptr::null_mut(),
+                )
+            };
+            assert!(subscriber.is_null());
+            unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_moq_init_succeeds() {
-            // Test that moq_init() can be called successfully
-            let result = moq_init();
-            assert!(result, "moq_init() should succeed");
-        }
+        fn test_bulk_creation_fails_when_not_connected() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let tracks: Vec<_> = (0..3)
+                .map(|i| std::ffi::CString::new(format!("track{}", i)).unwrap())
+                .collect();
+            let names: Vec<_> = tracks.iter().map(|t| t.as_ptr()).collect();
 
-        #[test]
-        fn test_moq_init_is_idempotent() {
-            // Test that calling moq_init() multiple times is safe
-            for _ in 0..5 {
-                let result = moq_init();
-                assert!(result, "moq_init() should succeed on repeated calls");
+            let mut publishers = [std::ptr::null_mut::<MoqPublisher>(); 3];
+            let result = unsafe {
+                moq_create_publishers(
+                    client,
+                    namespace.as_ptr(),
+                    names.as_ptr(),
+                    names.len(),
+                    MoqDeliveryMode::MoqDeliveryStream,
+                    publishers.as_mut_ptr(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+            assert!(publishers.iter().all(|p| p.is_null()));
+            unsafe { moq_free_str(result.message); }
+
+            let mut subscribers = [std::ptr::null_mut::<MoqSubscriber>(); 3];
+            let result = unsafe {
+                moq_subscribe_many(
+                    client,
+                    namespace.as_ptr(),
+                    names.as_ptr(),
+                    names.len(),
+                    None,
+                    std::ptr::null(),
+                    subscribers.as_mut_ptr(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+            assert!(subscribers.iter().all(|s| s.is_null()));
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
             }
         }
 
         #[test]
-        fn test_moq_init_before_client_create() {
-            // Test the recommended usage pattern: init before creating clients
-            let init_result = moq_init();
-            assert!(init_result, "moq_init() should return true");
-            
+        fn test_bulk_creation_with_zero_tracks_is_noop() {
             let client = moq_client_create();
-            assert!(!client.is_null(), "Client should be created after init");
-            
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let result = unsafe {
+                moq_create_publishers(
+                    client,
+                    namespace.as_ptr(),
+                    std::ptr::null(),
+                    0,
+                    MoqDeliveryMode::MoqDeliveryStream,
+                    std::ptr::null_mut(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_client_create_without_explicit_init() {
-            // Test that client creation works without explicitly calling moq_init()
-            // (it should auto-initialize on first connection)
+        fn test_error_messages_are_valid_utf8() {
             let client = moq_client_create();
-            assert!(!client.is_null(), "Client should be created even without explicit init");
+            let url = std::ffi::CString::new("http://invalid").unwrap();
+            let result = unsafe {
+                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
+            };
+            
+            if !result.message.is_null() {
+                // Should not panic on to_string_lossy
+                let message = unsafe { CStr::from_ptr(result.message).to_string_lossy() };
+                assert!(!message.is_empty());
+                unsafe { moq_free_str(result.message); }
+            }
             
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_crypto_provider_initialized_on_connect() {
-            // Test that crypto provider is initialized when connecting
-            // This ensures automatic initialization works
+        fn test_all_error_codes_exist() {
+            // Ensure all error code variants are accessible
+            let _ = MoqResultCode::MoqOk;
+            let _ = MoqResultCode::MoqErrorInvalidArgument;
+            let _ = MoqResultCode::MoqErrorConnectionFailed;
+            let _ = MoqResultCode::MoqErrorNotConnected;
+            let _ = MoqResultCode::MoqErrorTimeout;
+            let _ = MoqResultCode::MoqErrorInternal;
+            let _ = MoqResultCode::MoqErrorUnsupported;
+            let _ = MoqResultCode::MoqErrorBufferTooSmall;
+        }
+
+        #[test]
+        fn test_connect_with_unusual_url() {
             let client = moq_client_create();
-            assert!(!client.is_null());
-            
-            let url = std::ffi::CString::new("https://example.com:443").unwrap();
-            let _result = unsafe {
+            // Test with a URL containing Unicode replacement character (valid UTF-8 but unusual)
+            let url = std::ffi::CString::new("https://\u{FFFD}").unwrap();
+            let result = unsafe {
                 moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
             };
-            
-            // Even though connection will fail (invalid URL), crypto provider should be initialized
-            // No panic should occur
-            
+            // Should fail (either invalid argument or connection failed)
+            assert_ne!(result.code, MoqResultCode::MoqOk);
+            if !result.message.is_null() {
+                unsafe { moq_free_str(result.message); }
+            }
             unsafe { moq_client_destroy(client); }
         }
     }
 
     /* ───────────────────────────────────────────────
-     * Null Pointer Tests
+     * Thread-Local Error Storage Tests
      * ─────────────────────────────────────────────── */
 
-    mod null_pointer {
+    mod error_storage {
         use super::*;
 
         #[test]
-        fn test_connect_with_null_client() {
-            let url = std::ffi::CString::new("https://example.com").unwrap();
-            let result = unsafe {
-                moq_connect(
-                    std::ptr::null_mut(),
-                    url.as_ptr(),
-                    None,
-                    std::ptr::null_mut(),
-                )
-            };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            unsafe { moq_free_str(result.message); }
+        fn test_last_error_initially_null() {
+            let error = moq_last_error();
+            assert!(error.is_null() || !error.is_null()); // May or may not have error from previous tests
         }
 
         #[test]
-        fn test_connect_with_null_url() {
-            let client = moq_client_create();
-            let result = unsafe {
-                moq_connect(
-                    client,
-                    std::ptr::null(),
-                    None,
-                    std::ptr::null_mut(),
-                )
-            };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            unsafe {
-                moq_free_str(result.message);
-                moq_client_destroy(client);
-            }
+        fn test_set_and_get_last_error() {
+            set_last_error("Test error message".to_string());
+            let error = get_last_error();
+            assert!(error.is_some());
+            assert_eq!(error.unwrap(), "Test error message");
         }
 
         #[test]
-        fn test_disconnect_with_null_client() {
-            let result = unsafe { moq_disconnect(std::ptr::null_mut()) };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            unsafe { moq_free_str(result.message); }
+        fn test_last_error_returns_valid_pointer() {
+            set_last_error("Another test error".to_string());
+            let error_ptr = moq_last_error();
+            assert!(!error_ptr.is_null());
+            
+            let error_str = unsafe { CStr::from_ptr(error_ptr).to_string_lossy() };
+            assert_eq!(error_str, "Another test error");
         }
 
         #[test]
-        fn test_is_connected_with_null_client() {
-            let connected = unsafe { moq_is_connected(std::ptr::null()) };
-            assert!(!connected);
+        fn test_error_storage_is_thread_local() {
+            use std::sync::{Arc, Barrier};
+            use std::thread;
+            
+            let barrier = Arc::new(Barrier::new(2));
+            let barrier_clone = barrier.clone();
+            
+            // Set error in main thread
+            set_last_error("Main thread error".to_string());
+            
+            // Spawn another thread
+            let handle = thread::spawn(move || {
+                // Should not see main thread's error
+                let error = get_last_error();
+                barrier_clone.wait();
+                
+                // Set error in spawned thread
+                set_last_error("Spawned thread error".to_string());
+                let spawned_error = get_last_error();
+                
+                (error, spawned_error)
+            });
+            
+            barrier.wait();
+            
+            // Check main thread still has its error
+            let main_error = get_last_error();
+            assert_eq!(main_error, Some("Main thread error".to_string()));
+            
+            // Check spawned thread results
+            let (spawned_initial, spawned_final) = handle.join().unwrap();
+            assert_ne!(spawned_initial, Some("Main thread error".to_string()));
+            assert_eq!(spawned_final, Some("Spawned thread error".to_string()));
+        }
+
+        #[test]
+        fn test_error_storage_persists_within_thread() {
+            set_last_error("First error".to_string());
+            assert_eq!(get_last_error(), Some("First error".to_string()));
+            
+            set_last_error("Second error".to_string());
+            assert_eq!(get_last_error(), Some("Second error".to_string()));
+        }
+    }
+
+    /* ───────────────────────────────────────────────
+     * Panic Protection Tests
+     * ─────────────────────────────────────────────── */
+
+    mod panic_protection {
+        use super::*;
+
+        #[test]
+        fn test_client_create_catches_panics() {
+            // moq_client_create should never panic
+            let client = moq_client_create();
+            assert!(!client.is_null());
+            unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_announce_namespace_with_null_client() {
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let result = unsafe {
-                moq_announce_namespace(std::ptr::null_mut(), namespace.as_ptr())
-            };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            unsafe { moq_free_str(result.message); }
+        fn test_client_destroy_catches_panics() {
+            let client = moq_client_create();
+            // Should not panic even with valid client
+            unsafe { moq_client_destroy(client); }
+            // Should not panic with null
+            unsafe { moq_client_destroy(std::ptr::null_mut()); }
         }
 
         #[test]
-        fn test_announce_namespace_with_null_namespace() {
+        fn test_connect_catches_panics() {
             let client = moq_client_create();
+            let url = std::ffi::CString::new("https://example.com").unwrap();
             let result = unsafe {
-                moq_announce_namespace(client, std::ptr::null())
+                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
             };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            unsafe {
-                moq_free_str(result.message);
-                moq_client_destroy(client);
+            // Should return error, not panic
+            assert_ne!(result.code, MoqResultCode::MoqOk); // Will fail to connect, but shouldn't panic
+            if !result.message.is_null() {
+                unsafe { moq_free_str(result.message); }
             }
+            unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_create_publisher_with_null_client() {
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track").unwrap();
-            let publisher = unsafe {
-                moq_create_publisher(std::ptr::null_mut(), namespace.as_ptr(), track.as_ptr())
-            };
-            assert!(publisher.is_null());
-        }
-
-        #[test]
-        fn test_create_publisher_with_null_namespace() {
+        fn test_disconnect_catches_panics() {
             let client = moq_client_create();
-            let track = std::ffi::CString::new("track").unwrap();
-            let publisher = unsafe {
-                moq_create_publisher(client, std::ptr::null(), track.as_ptr())
-            };
-            assert!(publisher.is_null());
+            let result = unsafe { moq_disconnect(client) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_create_publisher_with_null_track_name() {
+        fn test_announce_namespace_catches_panics() {
             let client = moq_client_create();
             let namespace = std::ffi::CString::new("test").unwrap();
-            let publisher = unsafe {
-                moq_create_publisher(client, namespace.as_ptr(), std::ptr::null())
-            };
-            assert!(publisher.is_null());
+            let result = unsafe { moq_announce_namespace(client, namespace.as_ptr()) };
+            // Should return error (not connected), not panic
+            assert_ne!(result.code, MoqResultCode::MoqOk);
+            if !result.message.is_null() {
+                unsafe { moq_free_str(result.message); }
+            }
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_create_publisher_ex_with_null_client() {
+        fn test_create_publisher_catches_panics() {
+            let client = moq_client_create();
             let namespace = std::ffi::CString::new("test").unwrap();
             let track = std::ffi::CString::new("track").unwrap();
             let publisher = unsafe {
-                moq_create_publisher_ex(
-                    std::ptr::null_mut(),
-                    namespace.as_ptr(),
-                    track.as_ptr(),
-                    MoqDeliveryMode::MoqDeliveryStream,
-                )
+                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
             };
+            // Should return null (not connected), not panic
             assert!(publisher.is_null());
+            unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_create_publisher_ex_with_null_namespace() {
+        fn test_create_publisher_ex_catches_panics() {
             let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
             let track = std::ffi::CString::new("track").unwrap();
             let publisher = unsafe {
                 moq_create_publisher_ex(
                     client,
-                    std::ptr::null(),
+                    namespace.as_ptr(),
                     track.as_ptr(),
                     MoqDeliveryMode::MoqDeliveryDatagram,
                 )
             };
+            // Should return null (not connected), not panic
             assert!(publisher.is_null());
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_create_publisher_ex_with_null_track_name() {
+        fn test_subscribe_catches_panics() {
             let client = moq_client_create();
             let namespace = std::ffi::CString::new("test").unwrap();
-            let publisher = unsafe {
-                moq_create_publisher_ex(
+            let track = std::ffi::CString::new("track").unwrap();
+            let subscriber = unsafe {
+                moq_subscribe(
                     client,
                     namespace.as_ptr(),
-                    std::ptr::null(),
-                    MoqDeliveryMode::MoqDeliveryStream,
+                    track.as_ptr(),
+                    None,
+                    std::ptr::null_mut(),
                 )
             };
-            assert!(publisher.is_null());
+            // Should return null (not connected), not panic
+            assert!(subscriber.is_null());
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_publish_data_with_null_publisher() {
-            let data = [1u8, 2, 3, 4, 5];
-            let result = unsafe {
-                moq_publish_data(
-                    std::ptr::null_mut(),
-                    data.as_ptr(),
-                    data.len(),
-                    MoqDeliveryMode::MoqDeliveryStream,
-                )
-            };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
+        fn test_free_str_catches_panics() {
+            // Should not panic with null
+            unsafe { moq_free_str(std::ptr::null()); }
+            
+            // Should not panic with valid string
+            let s = CString::new("test").unwrap();
+            unsafe { moq_free_str(s.into_raw()); }
+        }
+    }
+
+    /* ───────────────────────────────────────────────
+     * Utility Function Tests
+     * ─────────────────────────────────────────────── */
+
+    mod utilities {
+        use super::*;
+
+        #[test]
+        fn test_runtime_stats() {
+            assert!(!unsafe { moq_get_runtime_stats(std::ptr::null_mut()) });
+
+            let mut stats = MoqRuntimeStats::default();
+            let task = RUNTIME.spawn(std::future::pending::<()>());
+            assert!(unsafe { moq_get_runtime_stats(&mut stats) });
+            assert_eq!(stats.worker_threads, 4);
+            assert!(stats.alive_tasks >= 1);
+            task.abort();
+        }
+
+        #[test]
+        fn test_simulation_unsupported() {
+            let url = CString::new("sim://relay").unwrap();
+            let result = unsafe { moq_sim_advance(url.as_ptr(), 1000) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorUnsupported);
             unsafe { moq_free_str(result.message); }
+            assert_eq!(unsafe { moq_sim_now(url.as_ptr()) }, 0);
         }
 
         #[test]
-        fn test_publish_data_with_null_data_and_nonzero_length() {
-            // Create a fake publisher (we won't actually use it, just testing validation)
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track").unwrap();
-            
-            // This will return null since client is not connected, but that's fine for this test
-            let publisher = unsafe {
-                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
-            };
+        fn test_make_ok_result() {
+            let result = make_ok_result();
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            assert!(result.message.is_null());
+        }
+
+        #[test]
+        fn test_make_error_result() {
+            let result = make_error_result(MoqResultCode::MoqErrorInternal, "Test error");
+            assert_eq!(result.code, MoqResultCode::MoqErrorInternal);
+            assert!(!result.message.is_null());
             
-            if publisher.is_null() {
-                // Expected - client not connected
-                unsafe { moq_client_destroy(client); }
-                return;
-            }
+            let message = unsafe { CStr::from_ptr(result.message).to_string_lossy() };
+            assert_eq!(message, "Test error");
             
-            let result = unsafe {
-                moq_publish_data(
-                    publisher,
-                    std::ptr::null(),
-                    10, // non-zero length with null pointer
-                    MoqDeliveryMode::MoqDeliveryStream,
-                )
-            };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            unsafe {
-                moq_free_str(result.message);
-                moq_publisher_destroy(publisher);
-                moq_client_destroy(client);
-            }
+            unsafe { moq_free_str(result.message); }
         }
 
         #[test]
-        fn test_subscribe_with_null_client() {
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track").unwrap();
-            let subscriber = unsafe {
-                moq_subscribe(
-                    std::ptr::null_mut(),
-                    namespace.as_ptr(),
-                    track.as_ptr(),
-                    None,
-                    std::ptr::null_mut(),
-                )
-            };
-            assert!(subscriber.is_null());
+        fn test_version_returns_valid_string() {
+            let version_ptr = moq_version();
+            assert!(!version_ptr.is_null());
+            
+            let version = unsafe { CStr::from_ptr(version_ptr).to_string_lossy() };
+            assert!(version.contains("moq_ffi"));
+            assert!(version.contains("0.1.0"));
+            assert!(version.contains("Draft") || version.contains("IETF"));
         }
 
         #[test]
-        fn test_subscribe_with_null_namespace() {
-            let client = moq_client_create();
-            let track = std::ffi::CString::new("track").unwrap();
-            let subscriber = unsafe {
-                moq_subscribe(
-                    client,
-                    std::ptr::null(),
-                    track.as_ptr(),
-                    None,
-                    std::ptr::null_mut(),
-                )
-            };
-            assert!(subscriber.is_null());
-            unsafe { moq_client_destroy(client); }
+        fn test_version_string_is_static() {
+            let ptr1 = moq_version();
+            let ptr2 = moq_version();
+            // Should return same static pointer
+            assert_eq!(ptr1, ptr2);
         }
 
         #[test]
-        fn test_subscribe_with_null_track_name() {
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let subscriber = unsafe {
-                moq_subscribe(
-                    client,
-                    namespace.as_ptr(),
-                    std::ptr::null(),
-                    None,
-                    std::ptr::null_mut(),
-                )
-            };
-            assert!(subscriber.is_null());
-            unsafe { moq_client_destroy(client); }
+        fn test_moq_free_str_with_valid_string() {
+            let s = CString::new("test string").unwrap();
+            let ptr = s.into_raw();
+            unsafe { moq_free_str(ptr); }
+            // Should not crash
         }
 
         #[test]
-        fn test_free_str_with_null_is_safe() {
-            // Should not crash
+        fn test_moq_free_str_with_null() {
             unsafe { moq_free_str(std::ptr::null()); }
+            // Should not crash
         }
+    }
+
+    /* ───────────────────────────────────────────────
+     * Enum Value Tests
+     * ─────────────────────────────────────────────── */
+
+    mod enums {
+        use super::*;
 
         #[test]
-        fn test_unsubscribe_with_null_subscriber() {
-            let result = unsafe { moq_unsubscribe(std::ptr::null_mut()) };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            unsafe { moq_free_str(result.message); }
+        fn test_result_code_values() {
+            assert_eq!(MoqResultCode::MoqOk as i32, 0);
+            assert_eq!(MoqResultCode::MoqErrorInvalidArgument as i32, 1);
+            assert_eq!(MoqResultCode::MoqErrorConnectionFailed as i32, 2);
+            assert_eq!(MoqResultCode::MoqErrorNotConnected as i32, 3);
+            assert_eq!(MoqResultCode::MoqErrorTimeout as i32, 4);
+            assert_eq!(MoqResultCode::MoqErrorInternal as i32, 5);
+            assert_eq!(MoqResultCode::MoqErrorUnsupported as i32, 6);
+            assert_eq!(MoqResultCode::MoqErrorBufferTooSmall as i32, 7);
         }
 
         #[test]
-        fn test_is_subscribed_with_null_subscriber() {
-            let subscribed = unsafe { moq_is_subscribed(std::ptr::null()) };
-            assert!(!subscribed);
+        fn test_connection_state_values() {
+            assert_eq!(MoqConnectionState::MoqStateDisconnected as i32, 0);
+            assert_eq!(MoqConnectionState::MoqStateConnecting as i32, 1);
+            assert_eq!(MoqConnectionState::MoqStateConnected as i32, 2);
+            assert_eq!(MoqConnectionState::MoqStateFailed as i32, 3);
+            assert_eq!(MoqConnectionState::MoqStateResuming as i32, 4);
         }
 
         #[test]
-        fn test_subscribe_announces_with_null_client() {
-            let result = unsafe { moq_subscribe_announces(std::ptr::null_mut(), None, std::ptr::null_mut()) };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            unsafe { moq_free_str(result.message); }
+        fn test_delivery_mode_values() {
+            assert_eq!(MoqDeliveryMode::MoqDeliveryDatagram as i32, 0);
+            assert_eq!(MoqDeliveryMode::MoqDeliveryStream as i32, 1);
         }
 
         #[test]
-        fn test_subscribe_announces_succeeds() {
-            let client = moq_client_create();
-            // Can register callback even when not connected
-            let result = unsafe { moq_subscribe_announces(client, None, std::ptr::null_mut()) };
-            assert_eq!(result.code, MoqResultCode::MoqOk);
-            assert!(result.message.is_null());
-            unsafe { moq_client_destroy(client); }
+        fn test_result_code_equality() {
+            let code1 = MoqResultCode::MoqOk;
+            let code2 = MoqResultCode::MoqOk;
+            let code3 = MoqResultCode::MoqErrorInternal;
+            
+            assert_eq!(code1, code2);
+            assert_ne!(code1, code3);
         }
 
         #[test]
-        fn test_subscribe_announces_with_callback() {
-            extern "C" fn announce_callback(
-                _user_data: *mut std::ffi::c_void,
-                _namespace: *const c_char,
-                _track_name: *const c_char,
-            ) {
-                // Callback for announce notifications
-            }
+        fn test_connection_state_equality() {
+            let state1 = MoqConnectionState::MoqStateConnected;
+            let state2 = MoqConnectionState::MoqStateConnected;
+            let state3 = MoqConnectionState::MoqStateDisconnected;
+            
+            assert_eq!(state1, state2);
+            assert_ne!(state1, state3);
+        }
 
-            let client = moq_client_create();
-            let result = unsafe { 
-                moq_subscribe_announces(client, Some(announce_callback), std::ptr::null_mut()) 
-            };
-            assert_eq!(result.code, MoqResultCode::MoqOk);
-            assert!(result.message.is_null());
-            unsafe { moq_client_destroy(client); }
+        #[test]
+        fn test_delivery_mode_equality() {
+            let mode1 = MoqDeliveryMode::MoqDeliveryStream;
+            let mode2 = MoqDeliveryMode::MoqDeliveryStream;
+            let mode3 = MoqDeliveryMode::MoqDeliveryDatagram;
+            
+            assert_eq!(mode1, mode2);
+            assert_ne!(mode1, mode3);
         }
     }
 
     /* ───────────────────────────────────────────────
-     * Error Handling Tests
+     * Memory Safety Tests
      * ─────────────────────────────────────────────── */
 
-    mod error_handling {
+    mod memory_safety {
         use super::*;
 
         #[test]
-        fn test_connect_with_invalid_url_scheme() {
-            let client = moq_client_create();
-            let url = std::ffi::CString::new("http://example.com").unwrap(); // http instead of https
-            let result = unsafe {
-                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
-            };
-            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
-            assert!(!result.message.is_null());
-            
-            let message = unsafe { CStr::from_ptr(result.message).to_string_lossy() };
-            assert!(message.contains("https://") || message.contains("URL"));
+        fn test_double_destroy_with_different_clients() {
+            let client1 = moq_client_create();
+            let client2 = moq_client_create();
             
             unsafe {
-                moq_free_str(result.message);
-                moq_client_destroy(client);
+                moq_client_destroy(client1);
+                moq_client_destroy(client2);
             }
+            // Should not crash
         }
 
         #[test]
-        fn test_connect_with_malformed_url() {
+        fn test_result_message_memory_management() {
             let client = moq_client_create();
-            let url = std::ffi::CString::new("not_a_valid_url").unwrap();
             let result = unsafe {
-                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
+                moq_connect(
+                    std::ptr::null_mut(),
+                    std::ptr::null(),
+                    None,
+                    std::ptr::null_mut(),
+                )
             };
-            assert_ne!(result.code, MoqResultCode::MoqOk);
+            
             assert!(!result.message.is_null());
-            unsafe {
-                moq_free_str(result.message);
-                moq_client_destroy(client);
-            }
+            
+            // Read the message before freeing
+            let message = unsafe { CStr::from_ptr(result.message).to_string_lossy().to_string() };
+            assert!(!message.is_empty());
+            
+            // Free the message
+            unsafe { moq_free_str(result.message); }
+            
+            unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_disconnect_succeeds_with_valid_client() {
+        fn test_publish_data_with_zero_length() {
+            // This tests that zero-length data is handled correctly
             let client = moq_client_create();
-            let result = unsafe { moq_disconnect(client) };
-            assert_eq!(result.code, MoqResultCode::MoqOk);
-            assert!(result.message.is_null());
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track").unwrap();
+            
+            // Try to create publisher (will fail because not connected, but tests the path)
+            let publisher = unsafe {
+                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
+            };
+            
+            if !publisher.is_null() {
+                let data: [u8; 0] = [];
+                let result = unsafe {
+                    moq_publish_data(
+                        publisher,
+                        data.as_ptr(),
+                        0,
+                        MoqDeliveryMode::MoqDeliveryStream,
+                    )
+                };
+                // Should handle gracefully
+                assert!(result.code == MoqResultCode::MoqOk || result.code != MoqResultCode::MoqOk);
+                if !result.message.is_null() {
+                    unsafe { moq_free_str(result.message); }
+                }
+                unsafe { moq_publisher_destroy(publisher); }
+            }
+            
             unsafe { moq_client_destroy(client); }
         }
+    }
+
+    /* ───────────────────────────────────────────────
+     * Connection State Tests
+     * ─────────────────────────────────────────────── */
+
+    mod connection_state {
+        use super::*;
 
         #[test]
-        fn test_is_connected_returns_false_before_connection() {
+        fn test_initial_state_is_disconnected() {
             let client = moq_client_create();
             let connected = unsafe { moq_is_connected(client) };
             assert!(!connected);
@@ -2911,68 +8270,37 @@ mod tests {
         }
 
         #[test]
-        fn test_announce_namespace_fails_when_not_connected() {
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test/namespace").unwrap();
-            let result = unsafe {
-                moq_announce_namespace(client, namespace.as_ptr())
-            };
-            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
-            assert!(!result.message.is_null());
-            unsafe {
-                moq_free_str(result.message);
-                moq_client_destroy(client);
-            }
-        }
-
-        #[test]
-        fn test_create_publisher_fails_when_not_connected() {
+        fn test_disconnect_without_connect() {
             let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track1").unwrap();
-            let publisher = unsafe {
-                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
-            };
-            assert!(publisher.is_null());
+            let result = unsafe { moq_disconnect(client) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            
+            let connected = unsafe { moq_is_connected(client) };
+            assert!(!connected);
+            
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_create_publisher_ex_fails_when_not_connected() {
+        fn test_operations_fail_when_not_connected() {
             let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track1").unwrap();
             
-            // Test with datagram mode
-            let publisher = unsafe {
-                moq_create_publisher_ex(
-                    client,
-                    namespace.as_ptr(),
-                    track.as_ptr(),
-                    MoqDeliveryMode::MoqDeliveryDatagram,
-                )
-            };
-            assert!(publisher.is_null());
+            // Announce should fail
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let result = unsafe { moq_announce_namespace(client, namespace.as_ptr()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+            if !result.message.is_null() {
+                unsafe { moq_free_str(result.message); }
+            }
             
-            // Test with stream mode
+            // Create publisher should fail
+            let track = std::ffi::CString::new("track").unwrap();
             let publisher = unsafe {
-                moq_create_publisher_ex(
-                    client,
-                    namespace.as_ptr(),
-                    track.as_ptr(),
-                    MoqDeliveryMode::MoqDeliveryStream,
-                )
+                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
             };
             assert!(publisher.is_null());
             
-            unsafe { moq_client_destroy(client); }
-        }
-
-        #[test]
-        fn test_subscribe_fails_when_not_connected() {
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track1").unwrap();
+            // Subscribe should fail
             let subscriber = unsafe {
                 moq_subscribe(
                     client,
@@ -2981,517 +8309,950 @@ mod tests {
                     None,
                     std::ptr::null_mut(),
                 )
-            };
-            assert!(subscriber.is_null());
-            unsafe { moq_client_destroy(client); }
-        }
-
-        #[test]
-        fn test_error_messages_are_valid_utf8() {
-            let client = moq_client_create();
-            let url = std::ffi::CString::new("http://invalid").unwrap();
-            let result = unsafe {
-                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
-            };
-            
-            if !result.message.is_null() {
-                // Should not panic on to_string_lossy
-                let message = unsafe { CStr::from_ptr(result.message).to_string_lossy() };
-                assert!(!message.is_empty());
-                unsafe { moq_free_str(result.message); }
-            }
-            
-            unsafe { moq_client_destroy(client); }
-        }
-
-        #[test]
-        fn test_all_error_codes_exist() {
-            // Ensure all error code variants are accessible
-            let _ = MoqResultCode::MoqOk;
-            let _ = MoqResultCode::MoqErrorInvalidArgument;
-            let _ = MoqResultCode::MoqErrorConnectionFailed;
-            let _ = MoqResultCode::MoqErrorNotConnected;
-            let _ = MoqResultCode::MoqErrorTimeout;
-            let _ = MoqResultCode::MoqErrorInternal;
-            let _ = MoqResultCode::MoqErrorUnsupported;
-            let _ = MoqResultCode::MoqErrorBufferTooSmall;
+            };
+            assert!(subscriber.is_null());
+            
+            unsafe { moq_client_destroy(client); }
+        }
+
+        static REENTRANT_STATES: Mutex<Vec<(MoqConnectionState, bool)>> = Mutex::new(Vec::new());
+
+        unsafe extern "C" fn reentrant_connection_callback(
+            user_data: *mut std::ffi::c_void,
+            state: MoqConnectionState,
+        ) {
+            // Calling back into the client must not deadlock: no client lock is held here
+            let connected = moq_is_connected(user_data as *const MoqClient);
+            REENTRANT_STATES.lock().unwrap().push((state, connected));
         }
 
         #[test]
-        fn test_connect_with_unusual_url() {
+        fn test_connection_callback_can_reenter_client() {
             let client = moq_client_create();
-            // Test with a URL containing Unicode replacement character (valid UTF-8 but unusual)
-            let url = std::ffi::CString::new("https://\u{FFFD}").unwrap();
+            // Passes the scheme check but fails URL parsing, so no network is touched
+            let url = std::ffi::CString::new("https://").unwrap();
             let result = unsafe {
-                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
+                moq_connect(client, url.as_ptr(), Some(reentrant_connection_callback), client as *mut std::ffi::c_void)
             };
-            // Should fail (either invalid argument or connection failed)
-            assert_ne!(result.code, MoqResultCode::MoqOk);
-            if !result.message.is_null() {
-                unsafe { moq_free_str(result.message); }
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+
+            let result = unsafe { moq_disconnect(client) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+
+            let states = REENTRANT_STATES.lock().unwrap().clone();
+            assert_eq!(
+                states,
+                vec![
+                    (MoqConnectionState::MoqStateConnecting, false),
+                    (MoqConnectionState::MoqStateFailed, false),
+                    (MoqConnectionState::MoqStateDisconnected, false),
+                ]
+            );
+            unsafe { moq_client_destroy(client); }
+        }
+
+        #[test]
+        fn test_concurrent_operations_on_shared_client() {
+            let client = moq_client_create();
+            let client_addr = client as usize;
+
+            let threads: Vec<_> = (0..8)
+                .map(|t| {
+                    std::thread::spawn(move || {
+                        let client = client_addr as *mut MoqClient;
+                        let namespace = std::ffi::CString::new(format!("ns-{}", t)).unwrap();
+                        let track = std::ffi::CString::new("track").unwrap();
+                        for _ in 0..1000 {
+                            unsafe {
+                                assert!(!moq_is_connected(client));
+                                assert!(moq_create_publisher(client, namespace.as_ptr(), track.as_ptr()).is_null());
+                                let result = moq_announce_namespace(client, namespace.as_ptr());
+                                assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+                                moq_free_str(result.message);
+                            }
+                        }
+                    })
+                })
+                .collect();
+
+            for thread in threads {
+                thread.join().unwrap();
             }
             unsafe { moq_client_destroy(client); }
         }
+
+        #[test]
+        fn test_sharded_map_semantics() {
+            let map: ShardedMap<String, u32> = ShardedMap::new();
+            for i in 0..100 {
+                assert!(map.insert_if_absent(format!("ns-{}", i), i));
+            }
+            assert!(!map.insert_if_absent("ns-7".to_string(), 700));
+            assert_eq!(map.shard(&"ns-7".to_string()).get("ns-7"), Some(&7));
+
+            // Keys spread over more than one shard
+            let used = map.shards.iter().filter(|s| !s.lock().unwrap().is_empty()).count();
+            assert!(used > 1);
+
+            assert_eq!(map.remove(&"ns-7".to_string()), Some(7));
+            assert_eq!(map.remove(&"ns-7".to_string()), None);
+
+            map.clear();
+            assert!(map.shards.iter().all(|s| s.lock().unwrap().is_empty()));
+        }
     }
 
     /* ───────────────────────────────────────────────
-     * Thread-Local Error Storage Tests
+     * Data Callback Tests
      * ─────────────────────────────────────────────── */
 
-    mod error_storage {
+    mod callbacks {
         use super::*;
+        use std::sync::atomic::{AtomicBool, AtomicUsize};
+
+        // A subscriber without a network track; tests feed objects through an ObjectSink
+        fn detached_subscriber(delivery: DataDelivery, user_data: usize) -> MoqSubscriber {
+            let cell: Arc<DataCallbackCell> = Arc::new(ArcSwapOption::empty());
+            cell.store(Some(Arc::new(CallbackSlot { callback: delivery, user_data })));
+            MoqSubscriber {
+                inner: Arc::new(Mutex::new(SubscriberInner {
+                    namespace: TrackNamespace::from_utf8_path("test"),
+                    track_name: "track".to_string(),
+                    track: None,
+                    reader_task: None,
+                    subscribed: true,
+                })),
+                callback: cell,
+                cache: Arc::new(ArcSwapOption::empty()),
+                queue: Arc::new(ObjectQueue::new()),
+            }
+        }
 
-        #[test]
-        fn test_last_error_initially_null() {
-            let error = moq_last_error();
-            assert!(error.is_null() || !error.is_null()); // May or may not have error from previous tests
+        // Reassembles one object in group 0 the way a reader task does
+        fn object(sink: &ObjectSink, object_id: u64, data: &[u8]) -> ObjectBuffer {
+            let mut buf = sink.begin_object(0, object_id, data.len(), ObjectHeader::default());
+            buf.extend_from_slice(data);
+            buf
         }
 
-        #[test]
-        fn test_set_and_get_last_error() {
-            set_last_error("Test error message".to_string());
-            let error = get_last_error();
-            assert!(error.is_some());
-            assert_eq!(error.unwrap(), "Test error message");
+        unsafe extern "C" fn count_bytes(user_data: *mut std::ffi::c_void, _data: *const u8, len: usize) {
+            (*(user_data as *const AtomicUsize)).fetch_add(len, Ordering::SeqCst);
         }
 
         #[test]
-        fn test_last_error_returns_valid_pointer() {
-            set_last_error("Another test error".to_string());
-            let error_ptr = moq_last_error();
-            assert!(!error_ptr.is_null());
-            
-            let error_str = unsafe { CStr::from_ptr(error_ptr).to_string_lossy() };
-            assert_eq!(error_str, "Another test error");
+        fn test_callback_replaced_at_runtime() {
+            let first = AtomicUsize::new(0);
+            let second = AtomicUsize::new(0);
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(
+                DataDelivery::Object(Some(count_bytes)),
+                &first as *const _ as usize,
+            )));
+
+            unsafe {
+                let mut sink = ObjectSink::new((*subscriber).callback.clone());
+                sink.push(object(&sink, 0, &[1, 2, 3]));
+                let result = moq_subscriber_set_callback(
+                    subscriber,
+                    Some(count_bytes),
+                    &second as *const _ as *mut std::ffi::c_void,
+                );
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+                sink.push(object(&sink, 1, &[4, 5]));
+
+                // Null callback pauses delivery
+                let result = moq_subscriber_set_callback(subscriber, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+                sink.push(object(&sink, 2, &[6]));
+
+                moq_subscriber_destroy(subscriber);
+            }
+
+            assert_eq!(first.load(Ordering::SeqCst), 3);
+            assert_eq!(second.load(Ordering::SeqCst), 2);
+        }
+
+        static ENTERED: AtomicBool = AtomicBool::new(false);
+        static RELEASE: AtomicBool = AtomicBool::new(false);
+
+        unsafe extern "C" fn blocking_callback(_user_data: *mut std::ffi::c_void, _data: *const u8, _len: usize) {
+            ENTERED.store(true, Ordering::SeqCst);
+            while !RELEASE.load(Ordering::SeqCst) {
+                std::thread::yield_now();
+            }
         }
 
         #[test]
-        fn test_error_storage_is_thread_local() {
-            use std::sync::{Arc, Barrier};
-            use std::thread;
-            
-            let barrier = Arc::new(Barrier::new(2));
-            let barrier_clone = barrier.clone();
-            
-            // Set error in main thread
-            set_last_error("Main thread error".to_string());
-            
-            // Spawn another thread
-            let handle = thread::spawn(move || {
-                // Should not see main thread's error
-                let error = get_last_error();
-                barrier_clone.wait();
-                
-                // Set error in spawned thread
-                set_last_error("Spawned thread error".to_string());
-                let spawned_error = get_last_error();
-                
-                (error, spawned_error)
+        fn test_teardown_does_not_wait_for_running_callback() {
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(
+                DataDelivery::Object(Some(blocking_callback)),
+                0,
+            )));
+            let cell = unsafe { (*subscriber).callback.clone() };
+
+            let delivery = std::thread::spawn(move || {
+                let mut sink = ObjectSink::new(cell);
+                sink.push(object(&sink, 0, &[0]));
             });
-            
-            barrier.wait();
-            
-            // Check main thread still has its error
-            let main_error = get_last_error();
-            assert_eq!(main_error, Some("Main thread error".to_string()));
-            
-            // Check spawned thread results
-            let (spawned_initial, spawned_final) = handle.join().unwrap();
-            assert_ne!(spawned_initial, Some("Main thread error".to_string()));
-            assert_eq!(spawned_final, Some("Spawned thread error".to_string()));
+            while !ENTERED.load(Ordering::SeqCst) {
+                std::thread::yield_now();
+            }
+
+            // The callback is still running; none of these may block on it
+            unsafe {
+                let result = moq_subscriber_set_callback(subscriber, Some(count_bytes), std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+                let result = moq_unsubscribe(subscriber);
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+                assert!(!moq_is_subscribed(subscriber));
+                moq_subscriber_destroy(subscriber);
+            }
+
+            RELEASE.store(true, Ordering::SeqCst);
+            delivery.join().unwrap();
+        }
+
+        unsafe extern "C" fn count_wakeups(user_data: *mut std::ffi::c_void) {
+            (*(user_data as *const AtomicUsize)).fetch_add(1, Ordering::SeqCst);
         }
 
         #[test]
-        fn test_error_storage_persists_within_thread() {
-            set_last_error("First error".to_string());
-            assert_eq!(get_last_error(), Some("First error".to_string()));
-            
-            set_last_error("Second error".to_string());
-            assert_eq!(get_last_error(), Some("Second error".to_string()));
+        fn test_queued_objects_are_pulled_in_order() {
+            let wakeups = AtomicUsize::new(0);
+            let wakeups_ptr = &wakeups as *const _ as *mut std::ffi::c_void;
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(DataDelivery::Queue(2), 0)));
+
+            unsafe {
+                let mut sink = ObjectSink::new((*subscriber).callback.clone()).with_queue((*subscriber).queue.clone());
+                let mut received = MoqReceivedObject::empty();
+
+                let result = moq_subscriber_next(subscriber, &mut received, Some(count_wakeups), wakeups_ptr);
+                assert_eq!(result.code, MoqResultCode::MoqErrorWouldBlock);
+                assert!(result.message.is_null());
+                assert_eq!(wakeups.load(Ordering::SeqCst), 0);
+
+                // Capacity 2: the oldest of three objects is dropped, the armed callback fires once
+                for id in 0..3u64 {
+                    sink.push(object(&sink, id, &[id as u8; 4]));
+                }
+                assert_eq!(wakeups.load(Ordering::SeqCst), 1);
+
+                for id in 1..3u64 {
+                    let result = moq_subscriber_next(subscriber, &mut received, None, std::ptr::null_mut());
+                    assert_eq!(result.code, MoqResultCode::MoqOk);
+                    assert_eq!(received.object_id, id);
+                    assert_eq!(std::slice::from_raw_parts(received.data, received.data_len), &[id as u8; 4]);
+                    moq_object_release(&mut received);
+                    assert!(received.data.is_null());
+                }
+
+                // Unsubscribing ends the stream and wakes the consumer
+                let result = moq_subscriber_next(subscriber, &mut received, Some(count_wakeups), wakeups_ptr);
+                assert_eq!(result.code, MoqResultCode::MoqErrorWouldBlock);
+                assert_eq!(moq_unsubscribe(subscriber).code, MoqResultCode::MoqOk);
+                assert_eq!(wakeups.load(Ordering::SeqCst), 2);
+                let result = moq_subscriber_next(subscriber, &mut received, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+
+                moq_subscriber_destroy(subscriber);
+            }
         }
-    }
 
-    /* ───────────────────────────────────────────────
-     * Panic Protection Tests
-     * ─────────────────────────────────────────────── */
+        unsafe extern "C" fn record_info(
+            user_data: *mut std::ffi::c_void,
+            data: *const u8,
+            len: usize,
+            info: *const MoqObjectInfo,
+        ) {
+            let seen = &*(user_data as *const Mutex<Vec<(Vec<u8>, MoqObjectInfo)>>);
+            seen.lock().unwrap().push((std::slice::from_raw_parts(data, len).to_vec(), *info));
+        }
 
-    mod panic_protection {
-        use super::*;
+        // A clock that knows the publisher is `offset_us` ahead, without exchanges
+        fn known_clock(offset_us: i64) -> Arc<PeerClock> {
+            let clock = Arc::new(PeerClock::new(std::sync::Weak::new(), TrackNamespace::from_utf8_path("test")));
+            clock.started.store(true, Ordering::SeqCst);
+            clock.estimator.lock().unwrap().add(clock_sync::Sample { offset_us, delay_us: 1_000 });
+            clock
+        }
+
+        fn stamped(capture_time_us: u64, payload: &[u8]) -> Vec<u8> {
+            with_extensions(&[object_header::Extension { key: object_header::CAPTURE_TIMESTAMP, value: capture_time_us, data: &[] }], payload)
+        }
+
+        fn with_extensions(extensions: &[object_header::Extension], payload: &[u8]) -> Vec<u8> {
+            let mut object = object_header::encode(extensions).unwrap().unwrap();
+            object.extend_from_slice(payload);
+            object
+        }
+
+        // Copies out the extensions of every object, which are only valid during the callback
+        unsafe extern "C" fn record_extensions(
+            user_data: *mut std::ffi::c_void,
+            _data: *const u8,
+            _len: usize,
+            info: *const MoqObjectInfo,
+        ) {
+            let seen = &*(user_data as *const Mutex<Vec<ExtensionList>>);
+            seen.lock().unwrap().push(extension_list(&*info));
+        }
+
+        // Key, value and bytes of each extension of an object
+        type ExtensionList = Vec<(u64, u64, Vec<u8>)>;
+
+        unsafe fn extension_list(info: &MoqObjectInfo) -> ExtensionList {
+            if info.extension_count == 0 {
+                return Vec::new();
+            }
+            std::slice::from_raw_parts(info.extensions, info.extension_count)
+                .iter()
+                .map(|e| (e.key, e.value, std::slice::from_raw_parts(e.data, e.data_len).to_vec()))
+                .collect()
+        }
 
         #[test]
-        fn test_client_create_catches_panics() {
-            // moq_client_create should never panic
-            let client = moq_client_create();
-            assert!(!client.is_null());
-            unsafe { moq_client_destroy(client); }
+        fn test_extensions_reach_the_object_callback() {
+            let seen: Mutex<Vec<ExtensionList>> = Mutex::new(Vec::new());
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(
+                DataDelivery::Info(Some(record_extensions)),
+                &seen as *const _ as usize,
+            )));
+            let extensions = [
+                object_header::Extension { key: 0x0b, value: 0, data: b"keyframe" },
+                object_header::Extension { key: 0x3c, value: 300, data: &[] },
+            ];
+
+            unsafe {
+                let mut sink = ObjectSink::new((*subscriber).callback.clone());
+                for object in [with_extensions(&extensions, b"frame"), b"plain".to_vec()] {
+                    let mut buf = Reassembly::new(0, 0, object.len(), true);
+                    buf.extend_from_slice(&sink, &object);
+                    sink.push(buf.finish(&sink));
+                }
+                moq_subscriber_destroy(subscriber);
+            }
+
+            let seen = seen.lock().unwrap();
+            assert_eq!(*seen, vec![vec![(0x0b, 0, b"keyframe".to_vec()), (0x3c, 300, Vec::new())], Vec::new()]);
         }
 
         #[test]
-        fn test_client_destroy_catches_panics() {
-            let client = moq_client_create();
-            // Should not panic even with valid client
-            unsafe { moq_client_destroy(client); }
-            // Should not panic with null
-            unsafe { moq_client_destroy(std::ptr::null_mut()); }
+        fn test_object_header_is_split_off_wherever_chunks_end() {
+            let seen: Mutex<Vec<(Vec<u8>, MoqObjectInfo)>> = Mutex::new(Vec::new());
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(
+                DataDelivery::Info(Some(record_info)),
+                &seen as *const _ as usize,
+            )));
+            // Captured 5 ms ago on a publisher clock 2 s ahead
+            let capture_us = clock_sync::wallclock_us() + 2_000_000 - 5_000;
+            let object = stamped(capture_us, b"frame");
+
+            unsafe {
+                let mut sink = ObjectSink::new((*subscriber).callback.clone()).with_clock(known_clock(2_000_000));
+                for cut in 0..=object.len() {
+                    let mut buf = Reassembly::new(0, cut as u64, object.len(), true);
+                    buf.extend_from_slice(&sink, &object[..cut]);
+                    buf.extend_from_slice(&sink, &object[cut..]);
+                    sink.push(buf.finish(&sink));
+                }
+                // A plain object that ends while it could still be a header
+                let mut buf = Reassembly::new(1, 0, 3, true);
+                buf.extend_from_slice(&sink, &object_header::MAGIC[..3]);
+                sink.push(buf.finish(&sink));
+                moq_subscriber_destroy(subscriber);
+            }
+
+            let seen = seen.lock().unwrap();
+            assert_eq!(seen.len(), object.len() + 2);
+            for (payload, info) in &seen[..seen.len() - 1] {
+                assert_eq!(payload, b"frame");
+                assert_eq!(info.capture_time_us, capture_us);
+                assert_eq!(info.clock_offset_us, 2_000_000);
+                assert!(info.latency_valid);
+                assert!(info.latency_us >= 5_000 && info.latency_us < 1_000_000, "latency {}", info.latency_us);
+            }
+            let (payload, info) = seen.last().unwrap();
+            assert_eq!(payload.as_slice(), &object_header::MAGIC[..3]);
+            assert_eq!((info.group_id, info.capture_time_us, info.latency_valid), (1, 0, false));
         }
 
         #[test]
-        fn test_connect_catches_panics() {
-            let client = moq_client_create();
-            let url = std::ffi::CString::new("https://example.com").unwrap();
-            let result = unsafe {
-                moq_connect(client, url.as_ptr(), None, std::ptr::null_mut())
-            };
-            // Should return error, not panic
-            assert_ne!(result.code, MoqResultCode::MoqOk); // Will fail to connect, but shouldn't panic
-            if !result.message.is_null() {
-                unsafe { moq_free_str(result.message); }
+        fn test_payload_is_delivered_verbatim_without_inband_headers() {
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(DataDelivery::Queue(4), 0)));
+            let object = with_extensions(&[object_header::Extension { key: 0x3c, value: 300, data: &[] }], b"frame");
+
+            unsafe {
+                let mut sink = ObjectSink::new((*subscriber).callback.clone()).with_queue((*subscriber).queue.clone());
+                let mut buf = Reassembly::new(0, 0, object.len(), false);
+                buf.extend_from_slice(&sink, &object[..4]);
+                buf.extend_from_slice(&sink, &object[4..]);
+                sink.push(buf.finish(&sink));
+
+                let mut received = MoqReceivedObject::empty();
+                let mut info = MoqObjectInfo::default();
+                assert_eq!(moq_subscriber_next(subscriber, &mut received, None, std::ptr::null_mut()).code, MoqResultCode::MoqOk);
+                assert_eq!(std::slice::from_raw_parts(received.data, received.data_len), object.as_slice());
+                assert_eq!(moq_object_info(&received, &mut info).code, MoqResultCode::MoqOk);
+                assert_eq!(info.extension_count, 0);
+                moq_object_release(&mut received);
+                moq_subscriber_destroy(subscriber);
             }
-            unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_disconnect_catches_panics() {
-            let client = moq_client_create();
-            let result = unsafe { moq_disconnect(client) };
-            assert_eq!(result.code, MoqResultCode::MoqOk);
-            unsafe { moq_client_destroy(client); }
+        fn test_queued_object_info() {
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(DataDelivery::Queue(4), 0)));
+            let capture_us = clock_sync::wallclock_us();
+
+            unsafe {
+                // No clock offset known yet: the capture time is there, the latency is not
+                let mut sink = ObjectSink::new((*subscriber).callback.clone()).with_queue((*subscriber).queue.clone());
+                let object = stamped(capture_us, &[7; 3]);
+                let mut buf = Reassembly::new(4, 2, object.len(), true);
+                buf.extend_from_slice(&sink, &object);
+                sink.push(buf.finish(&sink));
+
+                let mut received = MoqReceivedObject::empty();
+                let mut info = MoqObjectInfo::default();
+                assert_eq!(moq_object_info(&received, &mut info).code, MoqResultCode::MoqErrorInvalidArgument);
+                assert_eq!(moq_subscriber_next(subscriber, &mut received, None, std::ptr::null_mut()).code, MoqResultCode::MoqOk);
+                assert_eq!(std::slice::from_raw_parts(received.data, received.data_len), &[7; 3]);
+                assert_eq!(moq_object_info(&received, &mut info).code, MoqResultCode::MoqOk);
+                assert_eq!((info.group_id, info.object_id, info.capture_time_us), (4, 2, capture_us));
+                assert!(info.arrival_time_us >= capture_us);
+                assert!(!info.latency_valid);
+                assert_eq!(extension_list(&info), vec![(object_header::CAPTURE_TIMESTAMP, capture_us, Vec::new())]);
+                moq_object_release(&mut received);
+                moq_subscriber_destroy(subscriber);
+            }
+        }
+
+        // Records (batch size, first object id) per batch callback invocation
+        unsafe extern "C" fn record_batch(user_data: *mut std::ffi::c_void, objects: *const MoqObject, count: usize) {
+            let batches = &*(user_data as *const Mutex<Vec<(usize, u64)>>);
+            let objects = std::slice::from_raw_parts(objects, count);
+            for object in objects {
+                assert_eq!(std::slice::from_raw_parts(object.data, object.data_len), &[object.object_id as u8]);
+            }
+            batches.lock().unwrap().push((count, objects[0].object_id));
+        }
+
+        fn batch_sink(batches: &Mutex<Vec<(usize, u64)>>, max_objects: usize, max_latency_us: u32) -> ObjectSink {
+            let cell: Arc<DataCallbackCell> = Arc::new(ArcSwapOption::empty());
+            cell.store(Some(CallbackSlot::new(
+                DataDelivery::Batch(Some(record_batch), BatchLimits::new(max_objects, max_latency_us)),
+                batches as *const _ as *mut std::ffi::c_void,
+            )));
+            ObjectSink::new(cell)
         }
 
         #[test]
-        fn test_announce_namespace_catches_panics() {
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let result = unsafe { moq_announce_namespace(client, namespace.as_ptr()) };
-            // Should return error (not connected), not panic
-            assert_ne!(result.code, MoqResultCode::MoqOk);
-            if !result.message.is_null() {
-                unsafe { moq_free_str(result.message); }
+        fn test_batch_flushes_at_max_objects() {
+            let batches = Mutex::new(Vec::new());
+            let mut sink = batch_sink(&batches, 4, 0);
+            for id in 0..10u64 {
+                sink.push(object(&sink, id, &[id as u8]));
             }
-            unsafe { moq_client_destroy(client); }
+            assert_eq!(*batches.lock().unwrap(), vec![(4, 0), (4, 4)]);
+            sink.flush();
+            assert_eq!(*batches.lock().unwrap(), vec![(4, 0), (4, 4), (2, 8)]);
         }
 
         #[test]
-        fn test_create_publisher_catches_panics() {
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track").unwrap();
-            let publisher = unsafe {
-                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
-            };
-            // Should return null (not connected), not panic
-            assert!(publisher.is_null());
-            unsafe { moq_client_destroy(client); }
+        fn test_batch_gathers_ready_objects_and_flushes_before_blocking() {
+            let batches = Mutex::new(Vec::new());
+            let mut sink = batch_sink(&batches, 0, 0);
+
+            RUNTIME.block_on(async {
+                // Reads that complete immediately join the current batch
+                for id in 0..3u64 {
+                    let id = sink.next_ready(async move { id }).await;
+                    sink.push(object(&sink, id, &[id as u8]));
+                }
+                assert!(batches.lock().unwrap().is_empty());
+
+                // A read that has to wait delivers the batch first
+                sink.next_ready(tokio::time::sleep(Duration::from_millis(5))).await;
+                assert_eq!(*batches.lock().unwrap(), vec![(3, 0)]);
+            });
         }
 
         #[test]
-        fn test_create_publisher_ex_catches_panics() {
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track").unwrap();
-            let publisher = unsafe {
-                moq_create_publisher_ex(
-                    client,
-                    namespace.as_ptr(),
-                    track.as_ptr(),
-                    MoqDeliveryMode::MoqDeliveryDatagram,
-                )
-            };
-            // Should return null (not connected), not panic
-            assert!(publisher.is_null());
-            unsafe { moq_client_destroy(client); }
+        fn test_batch_waits_within_latency_budget() {
+            let batches = Mutex::new(Vec::new());
+            let mut sink = batch_sink(&batches, 0, 200_000);
+
+            RUNTIME.block_on(async {
+                sink.push(object(&sink, 0, &[0]));
+                // Arrives well within the 200ms budget, so it joins the batch
+                let id = sink.next_ready(async {
+                    tokio::time::sleep(Duration::from_millis(1)).await;
+                    1u64
+                }).await;
+                sink.push(object(&sink, id, &[id as u8]));
+                assert!(batches.lock().unwrap().is_empty());
+            });
+            sink.flush();
+            assert_eq!(*batches.lock().unwrap(), vec![(2, 0)]);
+        }
+
+        // Application frame pool for allocator hook tests
+        #[derive(Default)]
+        struct FramePool {
+            frames: Mutex<Vec<Box<[u8]>>>,
+            committed: Mutex<Vec<(Vec<u8>, u64)>>,
+            decline: AtomicBool,
+        }
+
+        unsafe extern "C" fn pool_alloc(user_data: *mut std::ffi::c_void, size: usize) -> *mut u8 {
+            let pool = &*(user_data as *const FramePool);
+            if pool.decline.load(Ordering::SeqCst) {
+                return std::ptr::null_mut();
+            }
+            let mut frame = vec![0u8; size].into_boxed_slice();
+            let ptr = frame.as_mut_ptr();
+            pool.frames.lock().unwrap().push(frame);
+            ptr
+        }
+
+        unsafe extern "C" fn pool_commit(
+            user_data: *mut std::ffi::c_void,
+            buffer: *mut u8,
+            len: usize,
+            _group_id: u64,
+            object_id: u64,
+        ) {
+            let pool = &*(user_data as *const FramePool);
+            // The buffer must be one of ours
+            assert!(pool.frames.lock().unwrap().iter().any(|f| std::ptr::eq(f.as_ptr(), buffer as *const u8)));
+            let data = std::slice::from_raw_parts(buffer, len).to_vec();
+            pool.committed.lock().unwrap().push((data, object_id));
+        }
+
+        #[test]
+        fn test_allocator_receives_objects_in_place() {
+            let pool = FramePool::default();
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(DataDelivery::Object(None), 0)));
+
+            unsafe {
+                let result = moq_subscriber_set_allocator(
+                    subscriber,
+                    Some(pool_alloc),
+                    Some(pool_commit),
+                    &pool as *const _ as *mut std::ffi::c_void,
+                );
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+
+                let mut sink = ObjectSink::new((*subscriber).callback.clone());
+                let mut buf = sink.begin_object(0, 1, 5, ObjectHeader::default());
+                buf.extend_from_slice(&[1, 2]);
+                buf.extend_from_slice(&[3, 4, 5]);
+                sink.push(buf);
+
+                // Declined objects are dropped without a commit
+                pool.decline.store(true, Ordering::SeqCst);
+                sink.push(object(&sink, 2, &[9]));
+                pool.decline.store(false, Ordering::SeqCst);
+
+                // Oversized payloads are truncated to the announced size
+                let mut buf = sink.begin_object(0, 3, 2, ObjectHeader::default());
+                buf.extend_from_slice(&[7, 8, 9]);
+                sink.push(buf);
+
+                // A buffer abandoned mid-object is still committed, short
+                let mut buf = sink.begin_object(0, 4, 4, ObjectHeader::default());
+                buf.extend_from_slice(&[6]);
+                drop(buf);
+
+                moq_subscriber_destroy(subscriber);
+            }
+
+            assert_eq!(
+                *pool.committed.lock().unwrap(),
+                vec![(vec![1, 2, 3, 4, 5], 1), (vec![7, 8], 3), (vec![6], 4)]
+            );
+        }
+
+        #[test]
+        fn test_allocator_requires_both_hooks() {
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(DataDelivery::Object(None), 0)));
+            unsafe {
+                let result = moq_subscriber_set_allocator(subscriber, Some(pool_alloc), None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+
+                let result = moq_subscriber_set_allocator(subscriber, None, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+                assert!((*subscriber).callback.load().is_none());
+
+                let result = moq_subscriber_set_allocator(std::ptr::null_mut(), None, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+
+                moq_subscriber_destroy(subscriber);
+            }
+        }
+
+        // Records (group id, object id, payload) of every cached object delivered
+        unsafe extern "C" fn collect_range(user_data: *mut std::ffi::c_void, objects: *const MoqObject, count: usize) {
+            let out = &*(user_data as *const Mutex<Vec<(u64, u64, Vec<u8>)>>);
+            for object in std::slice::from_raw_parts(objects, count) {
+                let data = std::slice::from_raw_parts(object.data, object.data_len).to_vec();
+                out.lock().unwrap().push((object.group_id, object.object_id, data));
+            }
+        }
+
+        #[test]
+        fn test_cache_keeps_recent_groups_for_read_range() {
+            let first = AtomicUsize::new(0);
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(
+                DataDelivery::Object(Some(count_bytes)),
+                &first as *const _ as usize,
+            )));
+            let read: Mutex<Vec<(u64, u64, Vec<u8>)>> = Mutex::new(Vec::new());
+
+            unsafe {
+                let result = moq_subscriber_read_range(subscriber, 0, 10, Some(collect_range), std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+
+                let result = moq_subscriber_enable_cache(subscriber, 2, 0, 1 << 20, std::ptr::null(), 0);
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+
+                let mut sink = ObjectSink::new((*subscriber).callback.clone()).with_cache((*subscriber).cache.clone());
+                for group_id in 0..3u64 {
+                    let mut buf = sink.begin_object(group_id, 0, 2, ObjectHeader::default());
+                    buf.extend_from_slice(&[group_id as u8, 0]);
+                    sink.push(buf);
+                }
+
+                // Objects are still cached while delivery is paused
+                let result = moq_subscriber_set_callback(subscriber, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+                let mut buf = sink.begin_object(2, 1, 1, ObjectHeader::default());
+                buf.extend_from_slice(&[7]);
+                sink.push(buf);
+
+                let (mut oldest, mut newest) = (0u64, 0u64);
+                assert!(moq_subscriber_cached_groups(subscriber, &mut oldest, &mut newest));
+                assert_eq!((oldest, newest), (1, 2));
+
+                let result = moq_subscriber_read_range(
+                    subscriber,
+                    0,
+                    u64::MAX,
+                    Some(collect_range),
+                    &read as *const _ as *mut std::ffi::c_void,
+                );
+                assert_eq!(result.code, MoqResultCode::MoqOk);
+
+                moq_subscriber_destroy(subscriber);
+            }
+
+            assert_eq!(first.load(Ordering::SeqCst), 6);
+            assert_eq!(
+                *read.lock().unwrap(),
+                vec![(1, 0, vec![1, 0]), (2, 0, vec![2, 0]), (2, 1, vec![7])]
+            );
         }
 
         #[test]
-        fn test_subscribe_catches_panics() {
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track").unwrap();
-            let subscriber = unsafe {
-                moq_subscribe(
-                    client,
-                    namespace.as_ptr(),
-                    track.as_ptr(),
-                    None,
-                    std::ptr::null_mut(),
-                )
-            };
-            // Should return null (not connected), not panic
-            assert!(subscriber.is_null());
-            unsafe { moq_client_destroy(client); }
+        fn test_cache_requires_overflow_size() {
+            let subscriber = Box::into_raw(Box::new(detached_subscriber(DataDelivery::Object(None), 0)));
+            let path = CString::new("unused").unwrap();
+            unsafe {
+                let result = moq_subscriber_enable_cache(subscriber, 0, 0, 1024, path.as_ptr(), 0);
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+                assert!((*subscriber).cache.load().is_none());
+
+                let result = moq_subscriber_enable_cache(std::ptr::null_mut(), 0, 0, 1024, std::ptr::null(), 0);
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+
+                let (mut oldest, mut newest) = (0u64, 0u64);
+                assert!(!moq_subscriber_cached_groups(subscriber, &mut oldest, &mut newest));
+
+                moq_subscriber_destroy(subscriber);
+            }
         }
 
         #[test]
-        fn test_free_str_catches_panics() {
-            // Should not panic with null
-            unsafe { moq_free_str(std::ptr::null()); }
-            
-            // Should not panic with valid string
-            let s = CString::new("test").unwrap();
-            unsafe { moq_free_str(s.into_raw()); }
+        fn test_batch_limit_defaults() {
+            let limits = BatchLimits::new(0, 250);
+            assert_eq!(limits.max_objects, DEFAULT_BATCH_MAX_OBJECTS);
+            assert_eq!(limits.max_latency, Duration::from_micros(250));
         }
     }
 
     /* ───────────────────────────────────────────────
-     * Utility Function Tests
+     * Publish Buffer Pool Tests
      * ─────────────────────────────────────────────── */
 
-    mod utilities {
+    mod write_pool {
         use super::*;
 
         #[test]
-        fn test_make_ok_result() {
-            let result = make_ok_result();
-            assert_eq!(result.code, MoqResultCode::MoqOk);
-            assert!(result.message.is_null());
+        fn test_acquire_with_null_publisher() {
+            let slot = unsafe { moq_publish_acquire(std::ptr::null_mut(), 128) };
+            assert!(slot.data.is_null());
+            assert_eq!(slot.capacity, 0);
+            assert!(slot.reserved.is_null());
         }
 
         #[test]
-        fn test_make_error_result() {
-            let result = make_error_result(MoqResultCode::MoqErrorInternal, "Test error");
-            assert_eq!(result.code, MoqResultCode::MoqErrorInternal);
-            assert!(!result.message.is_null());
-            
-            let message = unsafe { CStr::from_ptr(result.message).to_string_lossy() };
-            assert_eq!(message, "Test error");
-            
+        fn test_commit_rejects_empty_slot() {
+            let result = unsafe { moq_publish_commit(std::ptr::null_mut(), 0) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
             unsafe { moq_free_str(result.message); }
+
+            let mut slot = MoqWriteSlot::empty();
+            let result = unsafe { moq_publish_commit(&mut slot, 0) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+
+            // Releasing null or empty slots is a no-op
+            unsafe {
+                moq_publish_release(std::ptr::null_mut());
+                moq_publish_release(&mut slot);
+            }
         }
 
         #[test]
-        fn test_version_returns_valid_string() {
-            let version_ptr = moq_version();
-            assert!(!version_ptr.is_null());
-            
-            let version = unsafe { CStr::from_ptr(version_ptr).to_string_lossy() };
-            assert!(version.contains("moq_ffi"));
-            assert!(version.contains("0.1.0"));
-            assert!(version.contains("Draft") || version.contains("IETF"));
+        fn test_pool_hands_out_requested_capacity() {
+            let pool = WriteBufferPool::new();
+            let small = pool.acquire(16);
+            assert!(small.capacity() >= WRITE_POOL_BLOCK_SIZE);
+            let large = pool.acquire(WRITE_POOL_BLOCK_SIZE * 4);
+            assert!(large.capacity() >= WRITE_POOL_BLOCK_SIZE * 4);
+        }
+
+        // Fills a pooled block and freezes the written part as a transport payload would
+        fn publish_from(pool: &WriteBufferPool, fill: u8) -> (bytes::Bytes, *mut u8) {
+            let mut block = pool.acquire(1024);
+            let start = block.spare_capacity_mut().as_mut_ptr() as *mut u8;
+            block.extend_from_slice(&[fill; 1024]);
+            let payload = block.split_to(1024).freeze();
+            pool.release(block);
+            (payload, start)
         }
 
         #[test]
-        fn test_version_string_is_static() {
-            let ptr1 = moq_version();
-            let ptr2 = moq_version();
-            // Should return same static pointer
-            assert_eq!(ptr1, ptr2);
+        fn test_pool_reclaims_block_after_payload_is_dropped() {
+            let pool = WriteBufferPool::new();
+            let (payload, start) = publish_from(&pool, 7);
+            assert_eq!(payload.as_ptr(), start as *const u8);
+            assert_eq!(pool.idle_count(), 1);
+            drop(payload);
+
+            let mut block = pool.acquire(1024);
+            assert_eq!(block.spare_capacity_mut().as_mut_ptr() as *mut u8, start);
         }
 
         #[test]
-        fn test_moq_free_str_with_valid_string() {
-            let s = CString::new("test string").unwrap();
-            let ptr = s.into_raw();
-            unsafe { moq_free_str(ptr); }
-            // Should not crash
+        fn test_pool_does_not_overwrite_payload_in_flight() {
+            let pool = WriteBufferPool::new();
+            let (first, _) = publish_from(&pool, 1);
+            let (second, _) = publish_from(&pool, 2);
+            assert!(first.iter().all(|&b| b == 1));
+            assert!(second.iter().all(|&b| b == 2));
         }
 
         #[test]
-        fn test_moq_free_str_with_null() {
-            unsafe { moq_free_str(std::ptr::null()); }
-            // Should not crash
+        fn test_pool_caps_idle_blocks() {
+            let pool = WriteBufferPool::new();
+            let blocks: Vec<_> = (0..WRITE_POOL_MAX_IDLE + 4).map(|_| pool.acquire(64)).collect();
+            for block in blocks {
+                pool.release(block);
+            }
+            assert_eq!(pool.idle_count(), WRITE_POOL_MAX_IDLE);
         }
     }
 
     /* ───────────────────────────────────────────────
-     * Enum Value Tests
+     * File Range Publishing Tests
      * ─────────────────────────────────────────────── */
 
-    mod enums {
+    mod file_range {
         use super::*;
 
-        #[test]
-        fn test_result_code_values() {
-            assert_eq!(MoqResultCode::MoqOk as i32, 0);
-            assert_eq!(MoqResultCode::MoqErrorInvalidArgument as i32, 1);
-            assert_eq!(MoqResultCode::MoqErrorConnectionFailed as i32, 2);
-            assert_eq!(MoqResultCode::MoqErrorNotConnected as i32, 3);
-            assert_eq!(MoqResultCode::MoqErrorTimeout as i32, 4);
-            assert_eq!(MoqResultCode::MoqErrorInternal as i32, 5);
-            assert_eq!(MoqResultCode::MoqErrorUnsupported as i32, 6);
-            assert_eq!(MoqResultCode::MoqErrorBufferTooSmall as i32, 7);
-        }
-
-        #[test]
-        fn test_connection_state_values() {
-            assert_eq!(MoqConnectionState::MoqStateDisconnected as i32, 0);
-            assert_eq!(MoqConnectionState::MoqStateConnecting as i32, 1);
-            assert_eq!(MoqConnectionState::MoqStateConnected as i32, 2);
-            assert_eq!(MoqConnectionState::MoqStateFailed as i32, 3);
-        }
-
-        #[test]
-        fn test_delivery_mode_values() {
-            assert_eq!(MoqDeliveryMode::MoqDeliveryDatagram as i32, 0);
-            assert_eq!(MoqDeliveryMode::MoqDeliveryStream as i32, 1);
+        fn temp_file(name: &str, contents: &[u8]) -> std::path::PathBuf {
+            let path = std::env::temp_dir().join(format!("moq_ffi_{}_{}", name, std::process::id()));
+            std::fs::write(&path, contents).unwrap();
+            path
         }
 
         #[test]
-        fn test_result_code_equality() {
-            let code1 = MoqResultCode::MoqOk;
-            let code2 = MoqResultCode::MoqOk;
-            let code3 = MoqResultCode::MoqErrorInternal;
-            
-            assert_eq!(code1, code2);
-            assert_ne!(code1, code3);
+        fn test_publish_file_range_with_null_arguments() {
+            let path = std::ffi::CString::new("/nonexistent").unwrap();
+            let result = unsafe { moq_publish_file_range(std::ptr::null_mut(), path.as_ptr(), 0, 1) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
         }
 
         #[test]
-        fn test_connection_state_equality() {
-            let state1 = MoqConnectionState::MoqStateConnected;
-            let state2 = MoqConnectionState::MoqStateConnected;
-            let state3 = MoqConnectionState::MoqStateDisconnected;
-            
-            assert_eq!(state1, state2);
-            assert_ne!(state1, state3);
+        fn test_ranges_are_slices_of_one_mapping() {
+            let contents: Vec<u8> = (0..=255u8).cycle().take(64 * 1024).collect();
+            let path = temp_file("file_range_slices", &contents);
+            let metadata = std::fs::metadata(&path).unwrap();
+            let mut file = MappedFile::open(&path, &metadata).unwrap();
+
+            let first = file.range(0, 4096);
+            let second = file.range(4096, 4096);
+            assert_eq!(&first[..], &contents[..4096]);
+            assert_eq!(&second[..], &contents[4096..8192]);
+            // Zero-copy: consecutive ranges are adjacent in the same mapping
+            assert_eq!(unsafe { first.as_ptr().add(4096) }, second.as_ptr());
+            assert_eq!(file.next_offset, 8192);
+
+            // Ranges may run to the very end of the file
+            let tail = file.range(contents.len() - 10, 10);
+            assert_eq!(&tail[..], &contents[contents.len() - 10..]);
+
+            // Payloads outlive the mapping's owner
+            drop(file);
+            assert_eq!(&first[..], &contents[..4096]);
+            std::fs::remove_file(&path).unwrap();
         }
 
         #[test]
-        fn test_delivery_mode_equality() {
-            let mode1 = MoqDeliveryMode::MoqDeliveryStream;
-            let mode2 = MoqDeliveryMode::MoqDeliveryStream;
-            let mode3 = MoqDeliveryMode::MoqDeliveryDatagram;
-            
-            assert_eq!(mode1, mode2);
-            assert_ne!(mode1, mode3);
+        fn test_mapping_is_refreshed_when_file_changes() {
+            let path = temp_file("file_range_refresh", b"first version");
+            let metadata = std::fs::metadata(&path).unwrap();
+            let file = MappedFile::open(&path, &metadata).unwrap();
+            assert!(file.is_current(&path, &metadata));
+
+            std::fs::write(&path, b"second, longer version").unwrap();
+            let metadata = std::fs::metadata(&path).unwrap();
+            assert!(!file.is_current(&path, &metadata));
+            assert!(!file.is_current(std::path::Path::new("/other"), &metadata));
+            std::fs::remove_file(&path).unwrap();
         }
     }
 
     /* ───────────────────────────────────────────────
-     * Memory Safety Tests
+     * Recorder Tests
      * ─────────────────────────────────────────────── */
 
-    mod memory_safety {
+    mod recorder {
         use super::*;
+        use crate::recording::RecordingReader;
 
         #[test]
-        fn test_double_destroy_with_different_clients() {
-            let client1 = moq_client_create();
-            let client2 = moq_client_create();
-            
+        fn test_recorder_create_with_null_arguments() {
+            let client = moq_client_create();
+            let name = std::ffi::CString::new("name").unwrap();
+            let recorder = unsafe {
+                moq_recorder_create(client, name.as_ptr(), name.as_ptr(), std::ptr::null())
+            };
+            assert!(recorder.is_null());
+            let recorder = unsafe {
+                moq_recorder_create(std::ptr::null_mut(), name.as_ptr(), name.as_ptr(), name.as_ptr())
+            };
+            assert!(recorder.is_null());
             unsafe {
-                moq_client_destroy(client1);
-                moq_client_destroy(client2);
+                moq_recorder_destroy(std::ptr::null_mut());
+                moq_client_destroy(client);
             }
-            // Should not crash
         }
 
         #[test]
-        fn test_result_message_memory_management() {
+        fn test_recorder_requires_connection_and_leaves_no_files() {
+            let dir = std::env::temp_dir().join(format!("moq_ffi_recorder_unconnected_{}", std::process::id()));
+            let _ = std::fs::remove_dir_all(&dir);
             let client = moq_client_create();
-            let result = unsafe {
-                moq_connect(
-                    std::ptr::null_mut(),
-                    std::ptr::null(),
-                    None,
-                    std::ptr::null_mut(),
-                )
-            };
-            
-            assert!(!result.message.is_null());
-            
-            // Read the message before freeing
-            let message = unsafe { CStr::from_ptr(result.message).to_string_lossy().to_string() };
-            assert!(!message.is_empty());
-            
-            // Free the message
-            unsafe { moq_free_str(result.message); }
-            
+            let namespace = std::ffi::CString::new("ns").unwrap();
+            let track = std::ffi::CString::new("track").unwrap();
+            let path = std::ffi::CString::new(dir.to_str().unwrap()).unwrap();
+
+            let recorder = unsafe { moq_recorder_create(client, namespace.as_ptr(), track.as_ptr(), path.as_ptr()) };
+            assert!(recorder.is_null());
+            assert!(!dir.exists());
             unsafe { moq_client_destroy(client); }
         }
 
         #[test]
-        fn test_publish_data_with_zero_length() {
-            // This tests that zero-length data is handled correctly
-            let client = moq_client_create();
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let track = std::ffi::CString::new("track").unwrap();
-            
-            // Try to create publisher (will fail because not connected, but tests the path)
-            let publisher = unsafe {
-                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
-            };
-            
-            if !publisher.is_null() {
-                let data: [u8; 0] = [];
-                let result = unsafe {
-                    moq_publish_data(
-                        publisher,
-                        data.as_ptr(),
-                        0,
-                        MoqDeliveryMode::MoqDeliveryStream,
-                    )
-                };
-                // Should handle gracefully
-                assert!(result.code == MoqResultCode::MoqOk || result.code != MoqResultCode::MoqOk);
-                if !result.message.is_null() {
-                    unsafe { moq_free_str(result.message); }
-                }
-                unsafe { moq_publisher_destroy(publisher); }
+        fn test_recorder_sink_appends_objects_and_reuses_buffer() {
+            let dir = std::env::temp_dir().join(format!("moq_ffi_recorder_sink_{}", std::process::id()));
+            let _ = std::fs::remove_dir_all(&dir);
+            let writer = RecordingWriter::create(&dir, "ns", "track").unwrap();
+            let (mut sink, thread) = RecorderSink::spawn(writer, "ns/track".to_string()).unwrap();
+
+            for id in 0..3u64 {
+                let mut object = sink.begin_object(7, id, 4, ObjectHeader::default());
+                object.extend_from_slice(&[id as u8; 2]);
+                object.extend_from_slice(&[0xFF; 2]);
+                sink.push(object);
             }
-            
-            unsafe { moq_client_destroy(client); }
-        }
-    }
-
-    /* ───────────────────────────────────────────────
-     * Connection State Tests
-     * ─────────────────────────────────────────────── */
+            let returned = sink.spare.recv_timeout(Duration::from_secs(5)).expect("buffers come back for reuse");
+            assert!(returned.capacity() >= 4);
+            assert_eq!(sink.flush_deadline(), None);
+            // The recording is closed once the writer thread has seen the sink go
+            drop(sink);
+            thread.join().unwrap();
 
-    mod connection_state {
-        use super::*;
+            let mut reader = RecordingReader::open(&dir).unwrap();
+            assert_eq!(reader.len(), 3);
+            let entry = reader.entry(2);
+            assert_eq!((entry.group_id, entry.object_id), (7, 2));
+            assert_eq!(&reader.payload(&entry).unwrap()[..], &[2, 2, 0xFF, 0xFF]);
+            std::fs::remove_dir_all(&dir).unwrap();
+        }
 
         #[test]
-        fn test_initial_state_is_disconnected() {
-            let client = moq_client_create();
-            let connected = unsafe { moq_is_connected(client) };
-            assert!(!connected);
-            unsafe { moq_client_destroy(client); }
+        fn test_recorder_stop_after_shutdown_starts_no_runtime() {
+            let dir = std::env::temp_dir().join(format!("moq_ffi_recorder_shutdown_{}", std::process::id()));
+            let _ = std::fs::remove_dir_all(&dir);
+            let writer = RecordingWriter::create(&dir, "ns", "track").unwrap();
+            let (mut sink, writer) = RecorderSink::spawn(writer, "ns/track".to_string()).unwrap();
+            sink.push(sink.begin_object(0, 0, 0, ObjectHeader::default()));
+
+            // A runtime of its own: shutting down the library's would abort other tests' tasks
+            let shared = SharedRuntime::new();
+            let task = shared.spawn(async move {
+                let _sink = sink;
+                std::future::pending::<()>().await
+            });
+            let recorder = MoqRecorder { task, writer };
+            assert!(shared.shutdown(Duration::from_secs(5)));
+
+            recorder.stop(&shared);
+            assert!(shared.try_handle().is_none());
+            assert!(shared.runtime.lock().unwrap().is_none(), "Stopping should not start a runtime");
+            assert_eq!(RecordingReader::open(&dir).unwrap().len(), 1);
+            std::fs::remove_dir_all(&dir).unwrap();
         }
 
         #[test]
-        fn test_disconnect_without_connect() {
-            let client = moq_client_create();
-            let result = unsafe { moq_disconnect(client) };
-            assert_eq!(result.code, MoqResultCode::MoqOk);
-            
-            let connected = unsafe { moq_is_connected(client) };
-            assert!(!connected);
-            
-            unsafe { moq_client_destroy(client); }
+        fn test_replay_offset_scales_recorded_timing() {
+            assert_eq!(replay_offset(1_000_000, 1.0), Some(Duration::from_secs(1)));
+            assert_eq!(replay_offset(1_000_000, 2.0), Some(Duration::from_millis(500)));
+            assert_eq!(replay_offset(250, 0.5), Some(Duration::from_micros(500)));
+            assert_eq!(replay_offset(1_000_000, 0.0), None);
         }
 
         #[test]
-        fn test_operations_fail_when_not_connected() {
+        fn test_replayer_create_validates_arguments() {
+            let dir = std::env::temp_dir().join(format!("moq_ffi_replayer_args_{}", std::process::id()));
+            let _ = std::fs::remove_dir_all(&dir);
+            drop(RecordingWriter::create(&dir, "ns", "track").unwrap());
+
             let client = moq_client_create();
-            
-            // Announce should fail
-            let namespace = std::ffi::CString::new("test").unwrap();
-            let result = unsafe { moq_announce_namespace(client, namespace.as_ptr()) };
-            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
-            if !result.message.is_null() {
-                unsafe { moq_free_str(result.message); }
+            let namespace = std::ffi::CString::new("ns").unwrap();
+            let path = std::ffi::CString::new(dir.to_str().unwrap()).unwrap();
+            let missing = std::ffi::CString::new(dir.join("missing").to_str().unwrap()).unwrap();
+            unsafe {
+                assert!(moq_replayer_create(std::ptr::null_mut(), namespace.as_ptr(), path.as_ptr(), 1.0).is_null());
+                assert!(moq_replayer_create(client, namespace.as_ptr(), path.as_ptr(), -1.0).is_null());
+                assert!(moq_replayer_create(client, namespace.as_ptr(), path.as_ptr(), f64::NAN).is_null());
+                assert!(moq_replayer_create(client, namespace.as_ptr(), missing.as_ptr(), 1.0).is_null());
+                // A valid recording still needs a connection
+                assert!(moq_replayer_create(client, namespace.as_ptr(), path.as_ptr(), 0.0).is_null());
+                assert!(moq_replayer_is_finished(std::ptr::null()));
+                moq_replayer_destroy(std::ptr::null_mut());
+                moq_client_destroy(client);
             }
-            
-            // Create publisher should fail
-            let track = std::ffi::CString::new("track").unwrap();
-            let publisher = unsafe {
-                moq_create_publisher(client, namespace.as_ptr(), track.as_ptr())
-            };
-            assert!(publisher.is_null());
-            
-            // Subscribe should fail
-            let subscriber = unsafe {
-                moq_subscribe(
-                    client,
-                    namespace.as_ptr(),
-                    track.as_ptr(),
-                    None,
-                    std::ptr::null_mut(),
-                )
-            };
-            assert!(subscriber.is_null());
-            
-            unsafe { moq_client_destroy(client); }
+            std::fs::remove_dir_all(&dir).unwrap();
         }
     }
 
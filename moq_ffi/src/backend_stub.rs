@@ -1,29 +1,69 @@
-// Stub backend for testing builds without moq-transport dependency
+// Stub backend for builds without moq-transport dependency
 //
-// This backend provides no-op implementations of all FFI functions,
-// allowing the library to build and link successfully for testing
-// the build toolchain and integration without requiring the full
-// moq-transport dependency.
+// This backend links without the network stack. Real relay URLs fail with
+// MoqErrorUnsupported, while `sim://<name>` URLs connect to a deterministic
+// in-memory relay (see sim.rs): announces, publishers and subscribers work
+// as in the network backend, over simulated links driven by a virtual clock
+// that the application advances with `moq_sim_advance()`.
 
-use std::ffi::CString;
+use std::ffi::{CStr, CString};
 use std::os::raw::c_char;
+use std::sync::{Arc, Mutex, MutexGuard};
+
+use crate::latency_probe::{self, LatencyFn, ProbeStats};
+use crate::object_queue::{ObjectQueue, Pop};
+use crate::sim;
 
 /* ───────────────────────────────────────────────
  * Opaque Types
  * ─────────────────────────────────────────────── */
 
-#[repr(C)]
 pub struct MoqClient {
-    _dummy: u8,
+    inner: Mutex<ClientState>,
 }
 
-#[repr(C)]
+#[derive(Default)]
+struct ClientState {
+    uplink: sim::LinkConfig,
+    downlink: sim::LinkConfig,
+    session: Option<sim::Session>,
+    connection_callback: Option<(unsafe extern "C" fn(*mut std::ffi::c_void, MoqConnectionState), UserData)>,
+    announce_handler: Option<sim::AnnounceHandler>,
+    latency_probe: Option<LatencyProbe>,
+    latency_stats: Option<Arc<ProbeStats>>,
+    // Whether new publishers and subscriptions use extension headers
+    // (moq_client_set_inband_headers)
+    inband_headers: bool,
+}
+
+/// A running latency probe: a timer on the relay's clock publishes, the subscription measures.
+struct LatencyProbe {
+    _timer: sim::Timer,
+    _subscription: sim::Subscription,
+}
+
+/// Addresses of the clients not yet destroyed, so moq_shutdown() can reach them
+static CLIENTS: Mutex<Vec<usize>> = Mutex::new(Vec::new());
+
+/// Publisher handle; `sim` is None only for handles not created by the library (tests).
 pub struct MoqPublisher {
+    sim: Option<Arc<sim::Publisher>>,
+    // Whether the client had opted in to in-band headers at creation
+    inband_headers: bool,
+}
+
+pub struct MoqSubscriber {
+    subscription: Mutex<Option<sim::Subscription>>,
+    sink: Arc<Sink>,
+}
+
+#[repr(C)]
+pub struct MoqRecorder {
     _dummy: u8,
 }
 
 #[repr(C)]
-pub struct MoqSubscriber {
+pub struct MoqReplayer {
     _dummy: u8,
 }
 
@@ -42,6 +82,9 @@ pub enum MoqResultCode {
     MoqErrorInternal = 5,
     MoqErrorUnsupported = 6,
     MoqErrorBufferTooSmall = 7,
+    MoqErrorWouldBlock = 8,
+    /// Best effort: sent, but delivery could not be confirmed
+    MoqErrorUnconfirmed = 9,
 }
 
 #[repr(C)]
@@ -57,6 +100,9 @@ pub enum MoqConnectionState {
     MoqStateConnecting = 1,
     MoqStateConnected = 2,
     MoqStateFailed = 3,
+    /// The relay ended the session: every subscription has ended, and the
+    /// client is reconnecting (`moq_client_set_auto_resume`)
+    MoqStateResuming = 4,
 }
 
 #[repr(C)]
@@ -77,6 +123,34 @@ pub type MoqDataCallback = Option<
     unsafe extern "C" fn(user_data: *mut std::ffi::c_void, data: *const u8, data_len: usize),
 >;
 
+/// A received object as handed to a batch callback.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct MoqObject {
+    pub data: *const u8,
+    pub data_len: usize,
+    pub group_id: u64,
+    pub object_id: u64,
+}
+
+pub type MoqBatchCallback = Option<
+    unsafe extern "C" fn(user_data: *mut std::ffi::c_void, objects: *const MoqObject, count: usize),
+>;
+
+pub type MoqAllocFn = Option<
+    unsafe extern "C" fn(user_data: *mut std::ffi::c_void, size: usize) -> *mut u8,
+>;
+
+pub type MoqCommitFn = Option<
+    unsafe extern "C" fn(
+        user_data: *mut std::ffi::c_void,
+        buffer: *mut u8,
+        len: usize,
+        group_id: u64,
+        object_id: u64,
+    ),
+>;
+
 pub type MoqTrackCallback = Option<
     unsafe extern "C" fn(
         user_data: *mut std::ffi::c_void,
@@ -85,6 +159,119 @@ pub type MoqTrackCallback = Option<
     ),
 >;
 
+/// One-shot completion of an asynchronous operation; the callee owns `result.message`.
+pub type MoqCompletionCallback =
+    Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void, result: MoqResult)>;
+
+/// One-shot notification that a queued subscriber has data or has ended.
+pub type MoqReadyCallback = Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void)>;
+
+/// Latency of one probe that came back through the relay.
+pub type MoqLatencyCallback =
+    Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void, latency_us: u64, sequence: u64)>;
+
+/// One extension header of an object: a key with a number (even keys) or bytes (odd keys).
+#[repr(C)]
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct MoqExtension {
+    pub key: u64,
+    pub value: u64,
+    pub data: *const u8,
+    pub data_len: usize,
+}
+
+impl MoqExtension {
+    fn of(extension: &sim::Extension) -> Self {
+        MoqExtension {
+            key: extension.key,
+            value: extension.value,
+            data: extension.data.as_ptr(),
+            data_len: extension.data.len(),
+        }
+    }
+}
+
+/// Timing and extension headers of a received object, passed with it to an object callback.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct MoqObjectInfo {
+    pub group_id: u64,
+    pub object_id: u64,
+    pub capture_time_us: u64,
+    pub arrival_time_us: u64,
+    pub clock_offset_us: i64,
+    pub latency_us: u64,
+    pub latency_valid: bool,
+    pub extensions: *const MoqExtension,
+    pub extension_count: usize,
+}
+
+impl MoqObjectInfo {
+    /// Every client of a simulated relay shares its virtual clock, so the offset is always 0.
+    fn of(object: &sim::Object, extensions: &[MoqExtension]) -> Self {
+        let latency_us = object.capture_time_us.map(|capture_us| object.arrival_us.saturating_sub(capture_us));
+        MoqObjectInfo {
+            group_id: object.group_id,
+            object_id: object.object_id,
+            capture_time_us: object.capture_time_us.unwrap_or(0),
+            arrival_time_us: object.arrival_us,
+            clock_offset_us: 0,
+            latency_us: latency_us.unwrap_or(0),
+            latency_valid: latency_us.is_some(),
+            extensions: if extensions.is_empty() { std::ptr::null() } else { extensions.as_ptr() },
+            extension_count: extensions.len(),
+        }
+    }
+}
+
+impl Default for MoqObjectInfo {
+    fn default() -> Self {
+        MoqObjectInfo {
+            group_id: 0,
+            object_id: 0,
+            capture_time_us: 0,
+            arrival_time_us: 0,
+            clock_offset_us: 0,
+            latency_us: 0,
+            latency_valid: false,
+            extensions: std::ptr::null(),
+            extension_count: 0,
+        }
+    }
+}
+
+pub type MoqObjectCallback = Option<
+    unsafe extern "C" fn(
+        user_data: *mut std::ffi::c_void,
+        data: *const u8,
+        data_len: usize,
+        info: *const MoqObjectInfo,
+    ),
+>;
+
+/// An object taken from a queued subscriber with `moq_subscriber_next()`.
+#[repr(C)]
+#[derive(Debug)]
+pub struct MoqReceivedObject {
+    pub data: *const u8,
+    pub data_len: usize,
+    pub group_id: u64,
+    pub object_id: u64,
+    pub reserved: *mut std::ffi::c_void,
+}
+
+impl MoqReceivedObject {
+    fn empty() -> Self {
+        MoqReceivedObject {
+            data: std::ptr::null(),
+            data_len: 0,
+            group_id: 0,
+            object_id: 0,
+            reserved: std::ptr::null_mut(),
+        }
+    }
+}
+
 /* ───────────────────────────────────────────────
  * Track Discovery (Catalog-Based)
  * ─────────────────────────────────────────────── */
@@ -145,6 +332,147 @@ fn make_error_result(code: MoqResultCode, message: &str) -> MoqResult {
     }
 }
 
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// Reads a C string argument; None if it is not valid UTF-8.
+unsafe fn c_str<'a>(s: *const c_char) -> Option<&'a str> {
+    CStr::from_ptr(s).to_str().ok()
+}
+
+fn not_connected() -> MoqResult {
+    make_error_result(MoqResultCode::MoqErrorNotConnected, "Not connected to a simulated relay")
+}
+
+/// Application context pointer handed back to its callbacks.
+#[derive(Copy, Clone)]
+struct UserData(*mut std::ffi::c_void);
+
+// Safety: the pointer is only passed back to the application, which owns its thread safety
+unsafe impl Send for UserData {}
+unsafe impl Sync for UserData {}
+
+/// How a subscriber hands received objects to the application.
+#[derive(Copy, Clone)]
+enum Delivery {
+    None,
+    Object(unsafe extern "C" fn(*mut std::ffi::c_void, *const u8, usize)),
+    Batch(unsafe extern "C" fn(*mut std::ffi::c_void, *const MoqObject, usize)),
+    Allocated(
+        unsafe extern "C" fn(*mut std::ffi::c_void, usize) -> *mut u8,
+        unsafe extern "C" fn(*mut std::ffi::c_void, *mut u8, usize, u64, u64),
+    ),
+    /// Objects wait in the sink's queue, at most this many, until pulled
+    Queue(usize),
+    Info(unsafe extern "C" fn(*mut std::ffi::c_void, *const u8, usize, *const MoqObjectInfo)),
+}
+
+/// Receiving end of a subscriber.
+///
+/// The lock is held while the application's callback runs, so replacing the
+/// callback or destroying the subscriber waits for a delivery in progress.
+/// Queued objects are pushed after releasing it, since the queue's ready
+/// callback may resume a consumer that calls back into the subscriber.
+struct Sink {
+    delivery: Mutex<(Delivery, UserData)>,
+    queue: ObjectQueue<sim::Object>,
+}
+
+impl Sink {
+    fn new(delivery: Delivery, user_data: *mut std::ffi::c_void) -> Arc<Self> {
+        Arc::new(Self {
+            delivery: Mutex::new((delivery, UserData(user_data))),
+            queue: ObjectQueue::new(),
+        })
+    }
+
+    fn set(&self, delivery: Delivery, user_data: *mut std::ffi::c_void) {
+        *lock(&self.delivery) = (delivery, UserData(user_data));
+    }
+
+    /// Delivers the objects of a subscription; without in-band headers, as
+    /// the network backend would, without their extension headers and
+    /// capture time.
+    fn handler(self: &Arc<Self>, inband_headers: bool) -> sim::ObjectHandler {
+        let sink = Arc::clone(self);
+        if inband_headers {
+            return Arc::new(move |objects: &[sim::Object]| sink.deliver(objects));
+        }
+        Arc::new(move |objects: &[sim::Object]| {
+            let plain: Vec<sim::Object> = objects
+                .iter()
+                .map(|o| sim::Object { capture_time_us: None, extensions: Arc::from([]), ..o.clone() })
+                .collect();
+            sink.deliver(&plain)
+        })
+    }
+
+    fn deliver(&self, objects: &[sim::Object]) {
+        let guard = lock(&self.delivery);
+        let (delivery, UserData(user_data)) = *guard;
+        let objects = objects.iter().filter(|o| !o.payload.is_empty());
+        if let Delivery::Queue(max_objects) = delivery {
+            drop(guard);
+            self.queue.push(objects.cloned(), max_objects);
+            return;
+        }
+        let _ = std::panic::catch_unwind(std::panic::AssertUnwindSafe(|| unsafe {
+            match delivery {
+                Delivery::None | Delivery::Queue(_) => {}
+                Delivery::Object(cb) => {
+                    for object in objects {
+                        cb(user_data, object.payload.as_ptr(), object.payload.len());
+                    }
+                }
+                Delivery::Info(cb) => {
+                    for object in objects {
+                        let extensions: Vec<MoqExtension> = object.extensions.iter().map(MoqExtension::of).collect();
+                        let info = MoqObjectInfo::of(object, &extensions);
+                        cb(user_data, object.payload.as_ptr(), object.payload.len(), &info);
+                    }
+                }
+                Delivery::Batch(cb) => {
+                    let views: Vec<MoqObject> = objects
+                        .map(|o| MoqObject {
+                            data: o.payload.as_ptr(),
+                            data_len: o.payload.len(),
+                            group_id: o.group_id,
+                            object_id: o.object_id,
+                        })
+                        .collect();
+                    if !views.is_empty() {
+                        cb(user_data, views.as_ptr(), views.len());
+                    }
+                }
+                Delivery::Allocated(alloc, commit) => {
+                    for object in objects {
+                        let len = object.payload.len();
+                        let buffer = alloc(user_data, len);
+                        if buffer.is_null() {
+                            log::trace!("Allocator declined object {}/{} ({} bytes)", object.group_id, object.object_id, len);
+                            continue;
+                        }
+                        std::ptr::copy_nonoverlapping(object.payload.as_ptr(), buffer, len);
+                        commit(user_data, buffer, len, object.group_id, object.object_id);
+                    }
+                }
+            }
+        }));
+    }
+}
+
+/// Objects per batch when the application passes 0, as in the network backend
+const DEFAULT_BATCH_MAX_OBJECTS: usize = 64;
+
+/// Maps the batch limits of the C API onto the simulated relay's batching.
+fn batching(max_batch_objects: usize, max_batch_latency_us: u32) -> sim::Batching {
+    sim::Batching {
+        max_objects: if max_batch_objects == 0 { DEFAULT_BATCH_MAX_OBJECTS } else { max_batch_objects },
+        max_delay_us: max_batch_latency_us as u64,
+    }
+}
+
 /* ───────────────────────────────────────────────
  * Initialization
  * ─────────────────────────────────────────────── */
@@ -163,6 +491,83 @@ pub extern "C" fn moq_init() -> bool {
     true
 }
 
+/// Shuts the library down so that it can be unloaded or started again (stub implementation).
+///
+/// Disconnects every client that has not been destroyed, as moq_disconnect()
+/// would. The stub runs no threads, so there is nothing to wait for. Client
+/// handles stay valid and must still be destroyed.
+///
+/// # Safety
+/// - No other library call may run concurrently
+#[no_mangle]
+pub extern "C" fn moq_shutdown(_timeout_ms: u64) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        // Taken under the registry lock so no client is destroyed meanwhile;
+        // closed after it, since callbacks may destroy clients
+        let detached: Vec<Detached> = lock(&CLIENTS)
+            .iter()
+            .map(|&client| detach(unsafe { &*(client as *const MoqClient) }))
+            .collect();
+        for client in detached {
+            client.close(None);
+        }
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Does the work of a first connect ahead of time (stub implementation).
+///
+/// Simulated relays need no warming, so `sim://` URLs succeed at once.
+///
+/// # Safety
+/// - `urls` must point to `url_count` valid null-terminated C strings, or be
+///   null if `url_count` is 0
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` if every URL is a valid `sim://` URL
+/// - `MoqErrorInvalidArgument` if `urls` or a URL is null or malformed
+/// - `MoqErrorUnsupported` for any other URL
+#[no_mangle]
+pub unsafe extern "C" fn moq_prewarm(urls: *const *const c_char, url_count: usize) -> MoqResult {
+    moq_prewarm_ex(urls, url_count, false)
+}
+
+/// Like `moq_prewarm()`; simulated sessions connect instantly, so there is
+/// nothing to open ahead of time (stub implementation).
+///
+/// # Safety
+/// Same as `moq_prewarm()`.
+#[no_mangle]
+pub unsafe extern "C" fn moq_prewarm_ex(urls: *const *const c_char, url_count: usize, _preconnect: bool) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if urls.is_null() && url_count > 0 {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "URLs are null");
+        }
+        for index in 0..url_count {
+            let url = *urls.add(index);
+            if url.is_null() {
+                return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "URL is null");
+            }
+            match c_str(url).and_then(sim::parse_url) {
+                Some(Ok(_)) => {}
+                Some(Err(e)) => return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &e),
+                None => {
+                    return make_error_result(
+                        MoqResultCode::MoqErrorUnsupported,
+                        "Stub backend: MoQ transport not enabled. Use a sim:// URL or rebuild with --features with_moq",
+                    )
+                }
+            }
+        }
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
 /* ───────────────────────────────────────────────
  * Client Management
  * ─────────────────────────────────────────────── */
@@ -178,7 +583,9 @@ pub extern "C" fn moq_init() -> bool {
 #[no_mangle]
 pub extern "C" fn moq_client_create() -> *mut MoqClient {
     std::panic::catch_unwind(|| {
-        Box::into_raw(Box::new(MoqClient { _dummy: 0 }))
+        let client = Box::into_raw(Box::new(MoqClient { inner: Mutex::new(ClientState::default()) }));
+        lock(&CLIENTS).push(client as usize);
+        client
     }).unwrap_or(std::ptr::null_mut())
 }
 
@@ -196,12 +603,18 @@ pub extern "C" fn moq_client_create() -> *mut MoqClient {
 pub unsafe extern "C" fn moq_client_destroy(client: *mut MoqClient) {
     let _ = std::panic::catch_unwind(|| {
         if !client.is_null() {
+            lock(&CLIENTS).retain(|&registered| registered != client as usize);
             let _ = Box::from_raw(client);
         }
     });
 }
 
-/// Connects to a MoQ relay server (stub implementation - always fails).
+/// Connects to a simulated relay (stub implementation - other URLs are unsupported).
+///
+/// `sim://<name>` connects to the in-memory relay of that name, creating it
+/// on first use; `sim://<name>?seed=N` seeds its loss and jitter draws. The
+/// connection is established immediately and the callback, if any, is told
+/// `MoqStateConnecting` and `MoqStateConnected` before this function returns.
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
@@ -211,13 +624,15 @@ pub unsafe extern "C" fn moq_client_destroy(client: *mut MoqClient) {
 /// - This function is thread-safe
 ///
 /// # Returns
-/// Always returns MoqErrorUnsupported in stub build
+/// - `MoqOk` once connected to a simulated relay
+/// - `MoqErrorInvalidArgument` for a null argument or a malformed `sim://` URL
+/// - `MoqErrorUnsupported` for any other URL
 #[no_mangle]
 pub unsafe extern "C" fn moq_connect(
     client: *mut MoqClient,
     url: *const c_char,
-    _connection_callback: MoqConnectionCallback,
-    _user_data: *mut std::ffi::c_void,
+    connection_callback: MoqConnectionCallback,
+    user_data: *mut std::ffi::c_void,
 ) -> MoqResult {
     std::panic::catch_unwind(|| {
         if client.is_null() || url.is_null() {
@@ -227,169 +642,1665 @@ pub unsafe extern "C" fn moq_connect(
             );
         }
 
-        // Stub: always return unsupported
-        make_error_result(
-            MoqResultCode::MoqErrorUnsupported,
-            "Stub backend: MoQ transport not enabled. Rebuild with --features with_moq",
-        )
+        let (name, seed) = match c_str(url).and_then(sim::parse_url) {
+            Some(Ok(relay)) => relay,
+            Some(Err(e)) => return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &e),
+            None => {
+                return make_error_result(
+                    MoqResultCode::MoqErrorUnsupported,
+                    "Stub backend: MoQ transport not enabled. Use a sim:// URL or rebuild with --features with_moq",
+                )
+            }
+        };
+
+        let mut state = lock(&(*client).inner);
+        // Reconnecting drops the previous session first, as the network backend does
+        state.latency_probe = None;
+        state.session = None;
+        state.connection_callback = connection_callback.map(|cb| (cb, UserData(user_data)));
+        let session = sim::Relay::connect(&name, seed, state.uplink, state.downlink);
+        session.set_announce_handler(state.announce_handler.clone());
+        state.session = Some(session);
+        let callback = state.connection_callback;
+        drop(state);
+
+        if let Some((cb, UserData(user_data))) = callback {
+            cb(user_data, MoqConnectionState::MoqStateConnecting);
+            cb(user_data, MoqConnectionState::MoqStateConnected);
+        }
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Starts connecting without blocking (stub implementation).
+///
+/// Connecting to a simulated relay never waits, so the attempt completes
+/// before this returns and `completion_callback` runs on the calling thread.
+/// If this function returns an error, `completion_callback` is not invoked.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `url` must be a valid null-terminated C string pointer
+/// - `user_data` is passed to both callbacks and may be null
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_connect_async(
+    client: *mut MoqClient,
+    url: *const c_char,
+    connection_callback: MoqConnectionCallback,
+    user_data: *mut std::ffi::c_void,
+    completion_callback: MoqCompletionCallback,
+) -> MoqResult {
+    let result = moq_connect(client, url, connection_callback, user_data);
+    if result.code != MoqResultCode::MoqOk {
+        return result;
+    }
+    if let Some(callback) = completion_callback {
+        let _ = std::panic::catch_unwind(|| callback(user_data, result));
+    }
+    make_ok_result()
+}
+
+/// Disconnects from the simulated relay (stub implementation).
+///
+/// Subscriptions of the client stop receiving and its publishers fail with
+/// `MoqErrorNotConnected`. Objects still on their way to the relay are lost.
+/// Disconnecting an unconnected client is a no-op.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `client` must not be null
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_disconnect(client: *mut MoqClient) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+        }
+        disconnect(&*client, None);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Disconnects from the simulated relay after letting what the client has
+/// published reach it (stub implementation).
+///
+/// Subscriptions stop at once and publishers fail with `MoqErrorNotConnected`,
+/// but objects already published keep travelling as the relay clock advances,
+/// for up to `deadline_ms` of virtual time. The client reports Disconnected
+/// before this returns.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `client` must not be null
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` if everything in flight reaches the relay by the deadline, or
+///   the client was not connected
+/// - `MoqErrorTimeout` if some of it would arrive later and is dropped
+#[no_mangle]
+pub unsafe extern "C" fn moq_disconnect_graceful(client: *mut MoqClient, deadline_ms: u64) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+        }
+        if disconnect(&*client, Some(deadline_ms.saturating_mul(1000))) {
+            make_ok_result()
+        } else {
+            make_error_result(MoqResultCode::MoqErrorTimeout, "Deadline passed before all data was sent")
+        }
     }).unwrap_or_else(|_| {
         make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
     })
 }
 
-/// Disconnects from the MoQ relay server (stub implementation).
+/// Ends the client's session, draining it for up to `drain_us` first if given.
+///
+/// Returns false if objects in flight miss the drain deadline.
+fn disconnect(client: &MoqClient, drain_us: Option<u64>) -> bool {
+    detach(client).close(drain_us)
+}
+
+/// What a disconnecting client lets go of, taken under its lock and closed without it.
+struct Detached {
+    probe: Option<LatencyProbe>,
+    session: Option<sim::Session>,
+    callback: Option<(unsafe extern "C" fn(*mut std::ffi::c_void, MoqConnectionState), UserData)>,
+}
+
+fn detach(client: &MoqClient) -> Detached {
+    let mut state = lock(&client.inner);
+    Detached {
+        probe: state.latency_probe.take(),
+        session: state.session.take(),
+        callback: state.connection_callback,
+    }
+}
+
+impl Detached {
+    /// Ends the session, first letting it drain for up to `drain_us` if given;
+    /// returns whether everything in flight was delivered.
+    fn close(self, drain_us: Option<u64>) -> bool {
+        drop(self.probe);
+        let Some(session) = self.session else { return true };
+        let drained = drain_us.is_none_or(|deadline_us| session.drain(deadline_us));
+        drop(session);
+        if let Some((cb, UserData(user_data))) = self.callback {
+            unsafe { cb(user_data, MoqConnectionState::MoqStateDisconnected) };
+        }
+        drained
+    }
+}
+
+/// Checks if the client is connected to a simulated relay (stub implementation).
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `client` may be null (returns false)
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_is_connected(client: *const MoqClient) -> bool {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            return false;
+        }
+        lock(&(*client).inner).session.is_some()
+    }).unwrap_or(false)
+}
+
+/// Accepts UDP offload settings (stub implementation - the simulated relay
+/// has no sockets, so they have no effect).
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_set_udp_offload(client: *mut MoqClient, _gso: bool, _gro: bool) -> MoqResult {
+    if client.is_null() {
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+    }
+    make_ok_result()
+}
+
+/// Accepts the auto-resume setting (stub implementation - the simulated
+/// relay never ends a session itself, so it has no effect).
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_set_auto_resume(client: *mut MoqClient, _enabled: bool) -> MoqResult {
+    if client.is_null() {
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+    }
+    make_ok_result()
+}
+
+/// Opts the client in to in-band object headers (stub implementation).
+///
+/// The simulated relay carries extension headers and capture times beside
+/// the payload rather than in it, so a subscription that did not opt in
+/// receives objects without them instead of with a header block ahead of
+/// the payload.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_set_inband_headers(client: *mut MoqClient, enabled: bool) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+        }
+        lock(&(*client).inner).inband_headers = enabled;
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Counters of a client's QUIC connection and its UDP socket.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct MoqTransportStats {
+    pub rtt_us: u64,
+    pub congestion_window: u64,
+    pub lost_packets: u64,
+    pub udp_tx_datagrams: u64,
+    pub udp_tx_bytes: u64,
+    pub udp_tx_syscalls: u64,
+    pub udp_rx_datagrams: u64,
+    pub udp_rx_bytes: u64,
+    pub udp_rx_syscalls: u64,
+    pub gso_segments: u32,
+    pub gro_segments: u32,
+}
+
+/// Reports transport statistics (stub implementation - the round-trip time
+/// is that of the simulated links, without jitter; there are no UDP counters
+/// and no offload).
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `stats` must be a valid pointer to writable `MoqTransportStats`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_get_transport_stats(
+    client: *const MoqClient,
+    stats: *mut MoqTransportStats,
+) -> MoqResult {
+    if client.is_null() || stats.is_null() {
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client or stats is null");
+    }
+    let state = lock(&(*client).inner);
+    if state.session.is_none() {
+        return make_error_result(MoqResultCode::MoqErrorNotConnected, "Not connected");
+    }
+    *stats = MoqTransportStats {
+        rtt_us: state.uplink.latency_us + state.downlink.latency_us,
+        gso_segments: 1,
+        gro_segments: 1,
+        ..MoqTransportStats::default()
+    };
+    make_ok_result()
+}
+
+/* ───────────────────────────────────────────────
+ * Latency probe
+ * ─────────────────────────────────────────────── */
+
+/// Latency of objects through the relay, as measured by the latency probe.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct MoqLatencyStats {
+    pub probes_sent: u64,
+    pub probes_received: u64,
+    pub last_us: u64,
+    pub min_us: u64,
+    pub max_us: u64,
+    pub smoothed_us: u64,
+}
+
+impl From<latency_probe::Summary> for MoqLatencyStats {
+    fn from(summary: latency_probe::Summary) -> Self {
+        MoqLatencyStats {
+            probes_sent: summary.sent,
+            probes_received: summary.received,
+            last_us: summary.last_us,
+            min_us: summary.min_us,
+            max_us: summary.max_us,
+            smoothed_us: summary.smoothed_us,
+        }
+    }
+}
+
+/// Starts measuring publish-to-subscribe latency through the simulated relay.
+///
+/// Probes are published on the relay's virtual clock, so they go out and
+/// come back while `moq_sim_advance()` runs, and the callback is invoked on
+/// that thread. Latencies are in virtual microseconds: the uplink and
+/// downlink latency plus any jitter, queuing and retransmissions.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `user_data` will be passed to the callback and may be null
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` once the probe is running
+/// - `MoqErrorInvalidArgument` if `client` is null or `interval_ms` is 0
+/// - `MoqErrorNotConnected` if the client is not connected to a simulated relay
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_start_latency_probe(
+    client: *mut MoqClient,
+    interval_ms: u32,
+    callback: MoqLatencyCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+        }
+        if interval_ms == 0 {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Latency probe interval must be at least 1 ms",
+            );
+        }
+
+        let mut state = lock(&(*client).inner);
+        state.latency_probe = None;
+        let Some(session) = state.session.as_ref() else {
+            return not_connected();
+        };
+        let namespace = latency_probe::unique_namespace();
+        let publisher = match session
+            .announce(&namespace)
+            .and_then(|()| session.create_publisher(&namespace, latency_probe::TRACK, true))
+        {
+            Ok(publisher) => publisher,
+            Err(_) => return not_connected(),
+        };
+
+        let stats = Arc::new(ProbeStats::new(callback.map(|cb| (cb as LatencyFn, user_data as usize))));
+        // Weak references: the handlers live in the relay's own state
+        let relay = Arc::downgrade(session.relay());
+        let echo_stats = Arc::clone(&stats);
+        let echo_relay = relay.clone();
+        let handler: sim::ObjectHandler = Arc::new(move |objects: &[sim::Object]| {
+            let Some(relay) = echo_relay.upgrade() else { return };
+            for object in objects {
+                echo_stats.on_echo(&object.payload, relay.now_us());
+            }
+        });
+        let subscription = match session.subscribe(&namespace, latency_probe::TRACK, handler, None) {
+            Ok(subscription) => subscription,
+            Err(_) => return not_connected(),
+        };
+
+        let publish_stats = Arc::clone(&stats);
+        let sequence = std::sync::atomic::AtomicU64::new(0);
+        let tick: sim::TimerHandler = Arc::new(move || {
+            let Some(relay) = relay.upgrade() else { return };
+            let sequence = sequence.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+            if publisher.publish(&latency_probe::encode(sequence, relay.now_us())).is_ok() {
+                publish_stats.on_sent();
+            }
+        });
+        let timer = match session.start_timer(interval_ms as u64 * 1_000, tick) {
+            Ok(timer) => timer,
+            Err(_) => return not_connected(),
+        };
+
+        state.latency_probe = Some(LatencyProbe { _timer: timer, _subscription: subscription });
+        state.latency_stats = Some(stats);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Stops the latency probe; its statistics stay readable until the next probe starts.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_stop_latency_probe(client: *mut MoqClient) -> MoqResult {
+    if client.is_null() {
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+    }
+    let probe = lock(&(*client).inner).latency_probe.take();
+    drop(probe);
+    make_ok_result()
+}
+
+/// Reports the figures of the running or most recent latency probe; all
+/// zero if no probe has been started.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `stats` must be a valid pointer to writable `MoqLatencyStats`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_client_get_latency_stats(
+    client: *const MoqClient,
+    stats: *mut MoqLatencyStats,
+) -> MoqResult {
+    if client.is_null() || stats.is_null() {
+        return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client or stats is null");
+    }
+    let probe = lock(&(*client).inner).latency_stats.clone();
+    *stats = probe.map_or_else(MoqLatencyStats::default, |probe| probe.summary().into());
+    make_ok_result()
+}
+
+/* ───────────────────────────────────────────────
+ * Publishing
+ * ─────────────────────────────────────────────── */
+
+/// Announces a namespace on the simulated relay (stub implementation).
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` on success (announcing twice is not an error)
+/// - `MoqErrorInvalidArgument` for a null or non-UTF-8 argument
+/// - `MoqErrorNotConnected` if the client is not connected to a simulated relay
+#[no_mangle]
+pub unsafe extern "C" fn moq_announce_namespace(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || namespace.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Client or namespace is null",
+            );
+        }
+        let Some(namespace) = c_str(namespace) else {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Invalid UTF-8 in namespace");
+        };
+
+        let state = lock(&(*client).inner);
+        match state.session.as_ref().map(|session| session.announce(namespace)) {
+            Some(Ok(())) => make_ok_result(),
+            _ => not_connected(),
+        }
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Creates a publisher for a specific track in stream mode (stub implementation).
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_name` must be a valid null-terminated C string pointer
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_create_publisher(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+) -> *mut MoqPublisher {
+    moq_create_publisher_ex(client, namespace, track_name, MoqDeliveryMode::MoqDeliveryStream)
+}
+
+/// Creates a simulated publisher for `track` under an announced namespace.
+unsafe fn create_publisher(
+    client: &MoqClient,
+    namespace: &str,
+    track: &str,
+    delivery_mode: MoqDeliveryMode,
+) -> Result<MoqPublisher, sim::SimError> {
+    let state = lock(&client.inner);
+    let session = state.session.as_ref().ok_or(sim::SimError::NotConnected)?;
+    let publisher = session.create_publisher(namespace, track, delivery_mode == MoqDeliveryMode::MoqDeliveryStream)?;
+    Ok(MoqPublisher { sim: Some(Arc::new(publisher)), inband_headers: state.inband_headers })
+}
+
+/// Creates a publisher for a specific track with explicit delivery mode (stub implementation).
+///
+/// Stream publishers deliver every object in order, paying a retransmission
+/// delay for simulated losses; datagram publishers lose objects outright.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_name` must be a valid null-terminated C string pointer
+/// - This function is thread-safe
+///
+/// # Returns
+/// The publisher, or null if an argument is null or not UTF-8, the client is
+/// not connected, or the namespace has not been announced
+#[no_mangle]
+pub unsafe extern "C" fn moq_create_publisher_ex(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    delivery_mode: MoqDeliveryMode,
+) -> *mut MoqPublisher {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || namespace.is_null() || track_name.is_null() {
+            return std::ptr::null_mut();
+        }
+        let (Some(namespace), Some(track)) = (c_str(namespace), c_str(track_name)) else {
+            return std::ptr::null_mut();
+        };
+
+        match create_publisher(&*client, namespace, track, delivery_mode) {
+            Ok(publisher) => Box::into_raw(Box::new(publisher)),
+            Err(e) => {
+                log::warn!("Cannot create simulated publisher for {}/{}: {:?}", namespace, track, e);
+                std::ptr::null_mut()
+            }
+        }
+    }).unwrap_or(std::ptr::null_mut())
+}
+
+/// Creates publishers for many tracks in one call (stub implementation).
+///
+/// The operation is all-or-nothing: on failure every output entry is null.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_names` must point to `track_count` C string pointers
+/// - `publishers_out` must point to writable storage for `track_count` publisher pointers
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` when every publisher was created
+/// - `MoqErrorInvalidArgument` for a null or non-UTF-8 argument, or an unannounced namespace
+/// - `MoqErrorNotConnected` if the client is not connected to a simulated relay
+#[no_mangle]
+pub unsafe extern "C" fn moq_create_publishers(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_names: *const *const c_char,
+    track_count: usize,
+    delivery_mode: MoqDeliveryMode,
+    publishers_out: *mut *mut MoqPublisher,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || namespace.is_null() || (track_count > 0 && (track_names.is_null() || publishers_out.is_null())) {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Client, namespace, track_names, or publishers_out is null",
+            );
+        }
+
+        let outputs: &mut [*mut MoqPublisher] = if track_count > 0 {
+            std::slice::from_raw_parts_mut(publishers_out, track_count)
+        } else {
+            &mut []
+        };
+        outputs.fill(std::ptr::null_mut());
+        let names: &[*const c_char] = if track_count > 0 {
+            std::slice::from_raw_parts(track_names, track_count)
+        } else {
+            &[]
+        };
+        let Some(namespace) = c_str(namespace) else {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Invalid UTF-8 in namespace");
+        };
+
+        let mut publishers = Vec::with_capacity(track_count);
+        for &name in names {
+            let track = match (!name.is_null()).then(|| c_str(name)).flatten() {
+                Some(track) => track,
+                None => {
+                    return make_error_result(
+                        MoqResultCode::MoqErrorInvalidArgument,
+                        "Track name is null or not valid UTF-8",
+                    )
+                }
+            };
+            match create_publisher(&*client, namespace, track, delivery_mode) {
+                Ok(publisher) => publishers.push(publisher),
+                Err(sim::SimError::NotConnected) => return not_connected(),
+                Err(sim::SimError::NotAnnounced) => {
+                    return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Namespace not announced")
+                }
+            }
+        }
+        for (out, publisher) in outputs.iter_mut().zip(publishers) {
+            *out = Box::into_raw(Box::new(publisher));
+        }
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Destroys a publisher and releases its resources (stub implementation).
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - `publisher` must not be null (null pointers are safely ignored)
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_destroy(publisher: *mut MoqPublisher) {
+    let _ = std::panic::catch_unwind(|| {
+        if !publisher.is_null() {
+            let _ = Box::from_raw(publisher);
+        }
+    });
+}
+
+/// Sends one object through a simulated publisher at the relay's current virtual time.
+fn publish_payload(
+    publisher: Option<&sim::Publisher>,
+    payload: &[u8],
+    capture_time_us: Option<u64>,
+    extensions: &[sim::Extension],
+) -> MoqResult {
+    match publisher.map(|p| p.publish_stamped(payload, capture_time_us, extensions)) {
+        Some(Ok(())) => make_ok_result(),
+        _ => not_connected(),
+    }
+}
+
+/// Publishes data to a track (stub implementation).
+///
+/// The object leaves at the relay's current virtual time; it reaches
+/// subscribers once `moq_sim_advance()` has moved the clock past its arrival.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - `data` must be a valid pointer to a buffer of at least `data_len` bytes
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_data(
+    publisher: *mut MoqPublisher,
+    data: *const u8,
+    data_len: usize,
+    _delivery_mode: MoqDeliveryMode,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() || data.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Publisher or data is null",
+            );
+        }
+
+        publish_payload((*publisher).sim.as_deref(), std::slice::from_raw_parts(data, data_len), None, &[])
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Publishes data stamped with its capture time (stub implementation).
+///
+/// Capture times are on the relay's virtual clock; 0 stamps the current
+/// virtual time. As in the network backend, the client must have opted in
+/// with `moq_client_set_inband_headers()`.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - `data` must be a valid pointer to a buffer of at least `data_len` bytes
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_data_timestamped(
+    publisher: *mut MoqPublisher,
+    data: *const u8,
+    data_len: usize,
+    capture_time_us: u64,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() || data.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Publisher or data is null",
+            );
+        }
+
+        if !(*publisher).inband_headers {
+            return make_error_result(
+                MoqResultCode::MoqErrorUnsupported,
+                "Timestamps need in-band headers, see moq_client_set_inband_headers()",
+            );
+        }
+        let sim = (*publisher).sim.as_deref();
+        let capture_time_us = match capture_time_us {
+            0 => sim.map_or(0, |p| p.now_us()),
+            t => t,
+        };
+        publish_payload(sim, std::slice::from_raw_parts(data, data_len), Some(capture_time_us), &[])
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Publishes data with extension headers (stub implementation).
+///
+/// The extensions travel with the simulated object; key 2 is its capture
+/// time. As in the network backend, the client must have opted in with
+/// `moq_client_set_inband_headers()`.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - `data` must be a valid pointer to a buffer of at least `data_len` bytes
+/// - `extensions` must point to `extension_count` extensions (may be null if the count is 0)
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_data_ex(
+    publisher: *mut MoqPublisher,
+    data: *const u8,
+    data_len: usize,
+    extensions: *const MoqExtension,
+    extension_count: usize,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() || data.is_null() || (extensions.is_null() && extension_count > 0) {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Publisher, data or extensions is null",
+            );
+        }
+
+        if extension_count > 0 && !(*publisher).inband_headers {
+            return make_error_result(
+                MoqResultCode::MoqErrorUnsupported,
+                "Extension headers need in-band headers, see moq_client_set_inband_headers()",
+            );
+        }
+        let extensions = if extension_count == 0 { &[] } else { std::slice::from_raw_parts(extensions, extension_count) };
+        let mut copied = Vec::with_capacity(extensions.len());
+        for extension in extensions {
+            let odd = extension.key % 2 == 1;
+            if extension.key >= 1 << 62 || (!odd && extension.value >= 1 << 62) {
+                return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Extension key or value is too large");
+            }
+            let data: Box<[u8]> = match (odd, extension.data_len) {
+                (false, _) | (true, 0) => Box::default(),
+                (true, _) if extension.data.is_null() => {
+                    return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Extension data is null");
+                }
+                (true, len) => std::slice::from_raw_parts(extension.data, len).into(),
+            };
+            copied.push(sim::Extension { key: extension.key, value: extension.value, data });
+        }
+        publish_payload((*publisher).sim.as_deref(), std::slice::from_raw_parts(data, data_len), None, &copied)
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Makes a publisher stamp every object with its virtual publish time (stub implementation).
+///
+/// Enabling it needs the client to have opted in to in-band headers, as in
+/// the network backend.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_set_timestamps(publisher: *mut MoqPublisher, enabled: bool) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Publisher is null");
+        }
+        if enabled && !(*publisher).inband_headers {
+            return make_error_result(
+                MoqResultCode::MoqErrorUnsupported,
+                "Timestamps need in-band headers, see moq_client_set_inband_headers()",
+            );
+        }
+        if let Some(sim) = (*publisher).sim.as_deref() {
+            sim.set_timestamps(enabled);
+        }
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Reports the payload bytes published that have not reached the simulated
+/// relay yet (stub implementation).
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - `unacked_bytes` must be a valid pointer to a writable `u64`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_get_unacked_bytes(
+    publisher: *const MoqPublisher,
+    unacked_bytes: *mut u64,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() || unacked_bytes.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Publisher or unacked_bytes is null");
+        }
+        *unacked_bytes = (*publisher).sim.as_deref().map_or(0, sim::Publisher::unacked_bytes);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Checks that everything published has reached the simulated relay (stub
+/// implementation).
+///
+/// The relay's virtual clock only moves in `moq_sim_advance()`, so this
+/// cannot wait: it fails with `MoqErrorTimeout` while objects are in flight.
+/// Use `moq_publisher_flush_async()` to wait on the virtual clock.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_flush(publisher: *mut MoqPublisher, _timeout_ms: u64) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Publisher is null");
+        }
+        match (*publisher).sim.as_deref() {
+            Some(sim) if sim.unacked_bytes() > 0 => flush_result(if sim.is_connected() {
+                sim::AckOutcome::TimedOut
+            } else {
+                sim::AckOutcome::Disconnected
+            }),
+            _ => make_ok_result(),
+        }
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Invokes `completion_callback` once everything published so far has
+/// reached the simulated relay, or `timeout_ms` of virtual time has passed
+/// (stub implementation).
+///
+/// The callback runs inside `moq_sim_advance()`, or before this returns if
+/// nothing is in flight.
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - The callee of `completion_callback` must free the result's message with `moq_free_str()`
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_publisher_flush_async(
+    publisher: *mut MoqPublisher,
+    timeout_ms: u64,
+    completion_callback: MoqCompletionCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Publisher is null");
+        }
+        let user_data = UserData(user_data);
+        let complete = move |outcome| {
+            let result = flush_result(outcome);
+            match completion_callback {
+                Some(callback) => {
+                    let context = &user_data;
+                    let _ = std::panic::catch_unwind(|| unsafe { callback(context.0, result) });
+                }
+                None => unsafe { moq_free_str(result.message) },
+            }
+        };
+        match (*publisher).sim.as_deref() {
+            Some(sim) => sim.on_acked(timeout_ms.saturating_mul(1000), Box::new(complete)),
+            None => complete(sim::AckOutcome::Acked),
+        }
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+fn flush_result(outcome: sim::AckOutcome) -> MoqResult {
+    match outcome {
+        sim::AckOutcome::Acked => make_ok_result(),
+        sim::AckOutcome::TimedOut => make_error_result(
+            MoqResultCode::MoqErrorTimeout,
+            "Timed out before all published data was acknowledged",
+        ),
+        sim::AckOutcome::Disconnected => make_error_result(
+            MoqResultCode::MoqErrorNotConnected,
+            "Not connected; published data may not have been delivered",
+        ),
+    }
+}
+
+/// Publishes a byte range of a file (stub implementation).
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - `path` must be a valid null-terminated C string pointer
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if an argument is null, the file cannot be opened, or the range exceeds it
+/// - `MoqErrorInternal` if reading the file fails
+/// - `MoqErrorNotConnected` if the publisher's client has disconnected
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_file_range(
+    publisher: *mut MoqPublisher,
+    path: *const c_char,
+    offset: u64,
+    len: usize,
+) -> MoqResult {
+    use std::io::{Read, Seek, SeekFrom};
+
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() || path.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Publisher or path is null",
+            );
+        }
+        let Some(path) = c_str(path).map(std::path::Path::new) else {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Invalid UTF-8 in path");
+        };
+
+        let mut file = match std::fs::File::open(path) {
+            Ok(file) => file,
+            Err(e) => {
+                let msg = format!("Failed to open {}: {}", path.display(), e);
+                return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &msg);
+            }
+        };
+        let size = file.metadata().map(|m| m.len()).unwrap_or(0);
+        if offset.checked_add(len as u64).is_none_or(|end| end > size) {
+            let msg = format!("Range {}+{} exceeds the size of {} ({} bytes)", offset, len, path.display(), size);
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, &msg);
+        }
+        let mut payload = vec![0u8; len];
+        if let Err(e) = file.seek(SeekFrom::Start(offset)).and_then(|_| file.read_exact(&mut payload)) {
+            let msg = format!("Failed to read {}: {}", path.display(), e);
+            return make_error_result(MoqResultCode::MoqErrorInternal, &msg);
+        }
+
+        publish_payload((*publisher).sim.as_deref(), &payload, None, &[])
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Writable publish buffer handed to the application by `moq_publish_acquire()`.
+#[repr(C)]
+pub struct MoqWriteSlot {
+    pub data: *mut u8,
+    pub capacity: usize,
+    pub reserved: *mut std::ffi::c_void,
+}
+
+impl MoqWriteSlot {
+    fn empty() -> Self {
+        MoqWriteSlot {
+            data: std::ptr::null_mut(),
+            capacity: 0,
+            reserved: std::ptr::null_mut(),
+        }
+    }
+}
+
+/// Buffer behind an acquired slot; keeps the publisher alive until commit or release.
+struct PendingWrite {
+    publisher: Option<Arc<sim::Publisher>>,
+    buffer: Vec<u8>,
+}
+
+/// Acquires a writable publish buffer of at least `size` bytes (stub implementation).
+///
+/// # Safety
+/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
+/// - This function is thread-safe
+///
+/// # Returns
+/// The slot, or an empty slot if `publisher` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_acquire(
+    publisher: *mut MoqPublisher,
+    size: usize,
+) -> MoqWriteSlot {
+    std::panic::catch_unwind(|| {
+        if publisher.is_null() {
+            return MoqWriteSlot::empty();
+        }
+        let mut pending = Box::new(PendingWrite {
+            publisher: (*publisher).sim.clone(),
+            buffer: vec![0u8; size],
+        });
+        MoqWriteSlot {
+            data: pending.buffer.as_mut_ptr(),
+            capacity: pending.buffer.len(),
+            reserved: Box::into_raw(pending) as *mut std::ffi::c_void,
+        }
+    }).unwrap_or_else(|_| MoqWriteSlot::empty())
+}
+
+/// Publishes the first `used_len` bytes of an acquired slot (stub implementation).
+///
+/// # Safety
+/// - `slot` must point to a slot returned from `moq_publish_acquire()`
+/// - A slot must not be committed from two threads at once
+///
+/// # Returns
+/// As `moq_publish_data()`. If `used_len` exceeds the capacity the slot is left
+/// untouched so it can still be released; any other outcome consumes the slot.
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_commit(
+    slot: *mut MoqWriteSlot,
+    used_len: usize,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if slot.is_null() || (*slot).reserved.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Write slot is null or already consumed",
+            );
+        }
+        if used_len > (*slot).capacity {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "used_len exceeds the slot capacity",
+            );
+        }
+
+        let pending = Box::from_raw((*slot).reserved as *mut PendingWrite);
+        *slot = MoqWriteSlot::empty();
+        publish_payload(pending.publisher.as_deref(), &pending.buffer[..used_len], None, &[])
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Returns an acquired slot without publishing (stub implementation).
+///
+/// # Safety
+/// - `slot` must be null or point to a slot returned from `moq_publish_acquire()`
+#[no_mangle]
+pub unsafe extern "C" fn moq_publish_release(slot: *mut MoqWriteSlot) {
+    let _ = std::panic::catch_unwind(|| {
+        if slot.is_null() || (*slot).reserved.is_null() {
+            return;
+        }
+        let _ = Box::from_raw((*slot).reserved as *mut PendingWrite);
+        *slot = MoqWriteSlot::empty();
+    });
+}
+
+/* ───────────────────────────────────────────────
+ * Subscribing
+ * ─────────────────────────────────────────────── */
+
+/// Subscribes a client to `track` on its simulated relay.
+unsafe fn subscribe(
+    client: &MoqClient,
+    namespace: &str,
+    track: &str,
+    delivery: Delivery,
+    user_data: *mut std::ffi::c_void,
+    batching: Option<sim::Batching>,
+) -> Result<MoqSubscriber, sim::SimError> {
+    let sink = Sink::new(delivery, user_data);
+    let state = lock(&client.inner);
+    let session = state.session.as_ref().ok_or(sim::SimError::NotConnected)?;
+    let subscription = session.subscribe(namespace, track, sink.handler(state.inband_headers), batching)?;
+    Ok(MoqSubscriber {
+        subscription: Mutex::new(Some(subscription)),
+        sink,
+    })
+}
+
+/// Subscribes to a track on the simulated relay (stub implementation).
+///
+/// Objects are delivered on the thread that calls `moq_sim_advance()`.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_name` must be a valid null-terminated C string pointer
+/// - This function is thread-safe
+///
+/// # Returns
+/// The subscriber, or null if an argument is null or not UTF-8 or the client is not connected
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    data_callback: MoqDataCallback,
+    user_data: *mut std::ffi::c_void,
+) -> *mut MoqSubscriber {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || namespace.is_null() || track_name.is_null() {
+            return std::ptr::null_mut();
+        }
+        let (Some(namespace), Some(track)) = (c_str(namespace), c_str(track_name)) else {
+            return std::ptr::null_mut();
+        };
+
+        let delivery = data_callback.map_or(Delivery::None, Delivery::Object);
+        match subscribe(&*client, namespace, track, delivery, user_data, None) {
+            Ok(subscriber) => Box::into_raw(Box::new(subscriber)),
+            Err(_) => std::ptr::null_mut(),
+        }
+    }).unwrap_or(std::ptr::null_mut())
+}
+
+/// Subscribes to a track with batched delivery (stub implementation).
+///
+/// A batch is delivered when it holds `max_batch_objects` objects or when
+/// `max_batch_latency_us` of virtual time has passed since its first object.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_name` must be a valid null-terminated C string pointer
+/// - This function is thread-safe
+///
+/// # Returns
+/// The subscriber, or null if an argument is null or not UTF-8 or the client is not connected
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe_batched(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    batch_callback: MoqBatchCallback,
+    user_data: *mut std::ffi::c_void,
+    max_batch_objects: usize,
+    max_batch_latency_us: u32,
+) -> *mut MoqSubscriber {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || namespace.is_null() || track_name.is_null() {
+            return std::ptr::null_mut();
+        }
+        let (Some(namespace), Some(track)) = (c_str(namespace), c_str(track_name)) else {
+            return std::ptr::null_mut();
+        };
+
+        let delivery = batch_callback.map_or(Delivery::None, Delivery::Batch);
+        let batching = batching(max_batch_objects, max_batch_latency_us);
+        match subscribe(&*client, namespace, track, delivery, user_data, Some(batching)) {
+            Ok(subscriber) => Box::into_raw(Box::new(subscriber)),
+            Err(_) => std::ptr::null_mut(),
+        }
+    }).unwrap_or(std::ptr::null_mut())
+}
+
+/// Subscribes to a track and queues objects for `moq_subscriber_next()` (stub implementation).
+///
+/// Beyond `max_queued_objects` (0 selects the default of 256) the oldest
+/// queued objects are dropped.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_name` must be a valid null-terminated C string pointer
+/// - This function is thread-safe
+///
+/// # Returns
+/// The subscriber, or null if an argument is null or not UTF-8 or the client is not connected
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe_queued(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_name: *const c_char,
+    max_queued_objects: usize,
+) -> *mut MoqSubscriber {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || namespace.is_null() || track_name.is_null() {
+            return std::ptr::null_mut();
+        }
+        let (Some(namespace), Some(track)) = (c_str(namespace), c_str(track_name)) else {
+            return std::ptr::null_mut();
+        };
+
+        let delivery = Delivery::Queue(max_queued_objects);
+        match subscribe(&*client, namespace, track, delivery, std::ptr::null_mut(), None) {
+            Ok(subscriber) => Box::into_raw(Box::new(subscriber)),
+            Err(_) => std::ptr::null_mut(),
+        }
+    }).unwrap_or(std::ptr::null_mut())
+}
+
+/// Subscribes to many tracks in one call (stub implementation).
+///
+/// The operation is all-or-nothing: on failure every output entry is null.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` must be a valid null-terminated C string pointer
+/// - `track_names` must point to `track_count` C string pointers
+/// - `user_data` may be null; otherwise it must point to `track_count` pointers
+/// - `subscribers_out` must point to writable storage for `track_count` subscriber pointers
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` when every subscriber was created
+/// - `MoqErrorInvalidArgument` for a null or non-UTF-8 argument
+/// - `MoqErrorNotConnected` if the client is not connected to a simulated relay
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscribe_many(
+    client: *mut MoqClient,
+    namespace: *const c_char,
+    track_names: *const *const c_char,
+    track_count: usize,
+    data_callback: MoqDataCallback,
+    user_data: *const *mut std::ffi::c_void,
+    subscribers_out: *mut *mut MoqSubscriber,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() || namespace.is_null() || (track_count > 0 && (track_names.is_null() || subscribers_out.is_null())) {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Client, namespace, track_names, or subscribers_out is null",
+            );
+        }
+
+        let outputs: &mut [*mut MoqSubscriber] = if track_count > 0 {
+            std::slice::from_raw_parts_mut(subscribers_out, track_count)
+        } else {
+            &mut []
+        };
+        outputs.fill(std::ptr::null_mut());
+        let Some(namespace) = c_str(namespace) else {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Invalid UTF-8 in namespace");
+        };
+
+        let delivery = data_callback.map_or(Delivery::None, Delivery::Object);
+        let mut subscribers = Vec::with_capacity(track_count);
+        for i in 0..track_count {
+            let name = *track_names.add(i);
+            let Some(track) = (!name.is_null()).then(|| c_str(name)).flatten() else {
+                return make_error_result(
+                    MoqResultCode::MoqErrorInvalidArgument,
+                    "Track name is null or not valid UTF-8",
+                );
+            };
+            let context = if user_data.is_null() { std::ptr::null_mut() } else { *user_data.add(i) };
+            match subscribe(&*client, namespace, track, delivery, context, None) {
+                Ok(subscriber) => subscribers.push(subscriber),
+                Err(_) => return not_connected(),
+            }
+        }
+        for (out, subscriber) in outputs.iter_mut().zip(subscribers) {
+            *out = Box::into_raw(Box::new(subscriber));
+        }
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Destroys a subscriber and releases its resources (stub implementation).
+///
+/// Waits for a callback in progress on another thread, so it must not be
+/// called from the subscriber's own callback.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
+/// - `subscriber` must not be null (null pointers are safely ignored)
+/// - This function is thread-safe
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_destroy(subscriber: *mut MoqSubscriber) {
+    let _ = std::panic::catch_unwind(|| {
+        if !subscriber.is_null() {
+            let subscriber = Box::from_raw(subscriber);
+            lock(&subscriber.subscription).take();
+            subscriber.sink.set(Delivery::None, std::ptr::null_mut());
+            subscriber.sink.queue.disarm();
+        }
+    });
+}
+
+/// Unsubscribes from a track without destroying the subscriber handle (stub implementation).
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
+/// - `subscriber` must not be null
+/// - This function is thread-safe
+/// - Safe to call multiple times (idempotent)
+///
+/// # Returns
+/// - `MoqOk` on success or if already unsubscribed
+/// - `MoqErrorInvalidArgument` if subscriber is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_unsubscribe(subscriber: *mut MoqSubscriber) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+
+        lock(&(*subscriber).subscription).take();
+        let sink = &(*subscriber).sink;
+        sink.queue.close();
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Checks if the subscriber is currently subscribed to a track (stub implementation).
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
+/// - `subscriber` may be null (returns false)
+/// - This function is thread-safe
+///
+/// # Returns
+/// - false after `moq_unsubscribe()` or once the client has disconnected
+#[no_mangle]
+pub unsafe extern "C" fn moq_is_subscribed(subscriber: *const MoqSubscriber) -> bool {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            return false;
+        }
+        lock(&(*subscriber).subscription).as_ref().is_some_and(|s| s.is_active())
+    }).unwrap_or(false)
+}
+
+/// Replaces the data callback of a subscriber (stub implementation).
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
+/// - `subscriber` must not be null
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` for a non-null subscriber
+/// - `MoqErrorInvalidArgument` if subscriber is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_set_callback(
+    subscriber: *mut MoqSubscriber,
+    data_callback: MoqDataCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+
+        let subscriber = &*subscriber;
+        if let Some(subscription) = lock(&subscriber.subscription).as_ref() {
+            subscription.set_batching(None);
+        }
+        subscriber.sink.set(data_callback.map_or(Delivery::None, Delivery::Object), user_data);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Replaces the callback of a subscriber with a batch callback (stub implementation).
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `subscriber` must not be null
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` for a non-null subscriber
+/// - `MoqErrorInvalidArgument` if subscriber is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_set_batch_callback(
+    subscriber: *mut MoqSubscriber,
+    batch_callback: MoqBatchCallback,
+    user_data: *mut std::ffi::c_void,
+    max_batch_objects: usize,
+    max_batch_latency_us: u32,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+
+        let subscriber = &*subscriber;
+        if let Some(subscription) = lock(&subscriber.subscription).as_ref() {
+            subscription.set_batching(Some(batching(max_batch_objects, max_batch_latency_us)));
+        }
+        subscriber.sink.set(batch_callback.map_or(Delivery::None, Delivery::Batch), user_data);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Replaces the callback of a subscriber with one that also receives each
+/// object's timing (stub implementation).
+///
+/// Clients of a simulated relay share its virtual clock, so the clock offset
+/// is 0 and stamped objects have a valid latency from the first one on.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` for a non-null subscriber
+/// - `MoqErrorInvalidArgument` if subscriber is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_set_object_callback(
+    subscriber: *mut MoqSubscriber,
+    object_callback: MoqObjectCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+
+        let subscriber = &*subscriber;
+        if let Some(subscription) = lock(&subscriber.subscription).as_ref() {
+            subscription.set_batching(None);
+        }
+        subscriber.sink.set(object_callback.map_or(Delivery::None, Delivery::Info), user_data);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Installs allocator hooks on a subscriber (stub implementation).
+///
+/// While installed, every object is copied into a buffer from `alloc_fn` and
+/// handed over with `commit_fn` instead of the data or batch callback.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `subscriber` must not be null
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` for a non-null subscriber
+/// - `MoqErrorInvalidArgument` if subscriber is null or only one hook is given
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_set_allocator(
+    subscriber: *mut MoqSubscriber,
+    alloc_fn: MoqAllocFn,
+    commit_fn: MoqCommitFn,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber is null",
+            );
+        }
+        let delivery = match (alloc_fn, commit_fn) {
+            (Some(alloc), Some(commit)) => Delivery::Allocated(alloc, commit),
+            (None, None) => Delivery::None,
+            _ => {
+                return make_error_result(
+                    MoqResultCode::MoqErrorInvalidArgument,
+                    "alloc_fn and commit_fn must both be set or both be null",
+                )
+            }
+        };
+
+        let subscriber = &*subscriber;
+        if let Some(subscription) = lock(&subscriber.subscription).as_ref() {
+            subscription.set_batching(None);
+        }
+        subscriber.sink.set(delivery, user_data);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Takes the next queued object of a subscriber (stub implementation).
+///
+/// The payload is shared with the simulated relay, not copied. When nothing
+/// is queued, `ready` is armed and later invoked on the thread that calls
+/// `moq_sim_advance()`, or on the thread calling `moq_unsubscribe()`.
+///
+/// # Safety
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `object_out` must point to writable storage for one `MoqReceivedObject`
+/// - Objects must be consumed by one thread at a time
+///
+/// # Returns
+/// - `MoqOk` with `object_out` filled (free with `moq_object_release()`)
+/// - `MoqErrorWouldBlock` if nothing is queued yet
+/// - `MoqErrorNotConnected` after `moq_unsubscribe()` once the queue is drained
+/// - `MoqErrorInvalidArgument` if a pointer is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_subscriber_next(
+    subscriber: *mut MoqSubscriber,
+    object_out: *mut MoqReceivedObject,
+    ready: MoqReadyCallback,
+    user_data: *mut std::ffi::c_void,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if subscriber.is_null() || object_out.is_null() {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Subscriber or object is null",
+            );
+        }
+
+        *object_out = MoqReceivedObject::empty();
+        let sink = &(*subscriber).sink;
+        match sink.queue.pop(ready.map(|cb| (cb, user_data as usize))) {
+            Pop::Ready(object) => {
+                let extensions = object.extensions.iter().map(MoqExtension::of).collect();
+                let object = Box::new(QueuedObject { object, extensions });
+                *object_out = MoqReceivedObject {
+                    data: object.object.payload.as_ptr(),
+                    data_len: object.object.payload.len(),
+                    group_id: object.object.group_id,
+                    object_id: object.object.object_id,
+                    reserved: Box::into_raw(object) as *mut std::ffi::c_void,
+                };
+                make_ok_result()
+            }
+            Pop::Pending => MoqResult { code: MoqResultCode::MoqErrorWouldBlock, message: std::ptr::null() },
+            Pop::Closed => MoqResult { code: MoqResultCode::MoqErrorNotConnected, message: std::ptr::null() },
+        }
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// An object handed out by `moq_subscriber_next()`, with views of its
+/// extension headers that stay valid until it is released.
+struct QueuedObject {
+    object: sim::Object,
+    extensions: Vec<MoqExtension>,
+}
+
+/// Frees an object returned by `moq_subscriber_next()` (stub implementation).
 ///
 /// # Safety
-/// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `client` must not be null
-/// - This function is thread-safe
+/// - `object` must be null or point to an object filled by `moq_subscriber_next()`
 #[no_mangle]
-pub unsafe extern "C" fn moq_disconnect(client: *mut MoqClient) -> MoqResult {
-    std::panic::catch_unwind(|| {
-        if client.is_null() {
-            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+pub unsafe extern "C" fn moq_object_release(object: *mut MoqReceivedObject) {
+    let _ = std::panic::catch_unwind(|| {
+        if object.is_null() || (*object).reserved.is_null() {
+            return;
         }
-        make_ok_result()
-    }).unwrap_or_else(|_| {
-        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
-    })
+        drop(Box::from_raw((*object).reserved as *mut QueuedObject));
+        *object = MoqReceivedObject::empty();
+    });
 }
 
-/// Checks if the client is currently connected (stub implementation - always returns false).
+/// Fills `info` with the timing of an object returned by `moq_subscriber_next()` (stub implementation).
 ///
 /// # Safety
-/// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `client` may be null (returns false)
-/// - This function is thread-safe
+/// - `object` must point to an object filled by `moq_subscriber_next()` and not yet released
+/// - `info` must be a valid pointer to writable `MoqObjectInfo`
 #[no_mangle]
-pub unsafe extern "C" fn moq_is_connected(client: *const MoqClient) -> bool {
+pub unsafe extern "C" fn moq_object_info(object: *const MoqReceivedObject, info: *mut MoqObjectInfo) -> MoqResult {
     std::panic::catch_unwind(|| {
-        if client.is_null() {
-            return false;
+        if object.is_null() || info.is_null() || (*object).reserved.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Object or info is null");
         }
-        false // Stub: never connected
-    }).unwrap_or(false)
+        let queued = &*((*object).reserved as *const QueuedObject);
+        *info = MoqObjectInfo::of(&queued.object, &queued.extensions);
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
 }
 
-/* ───────────────────────────────────────────────
- * Publishing
- * ─────────────────────────────────────────────── */
-
-/// Announces a namespace to the MoQ relay server (stub implementation).
+/// Enables the group cache of a subscriber (stub implementation).
 ///
 /// # Safety
-/// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `namespace` must be a valid null-terminated C string pointer
+/// - `subscriber` must be a valid pointer returned from a subscribe function
+/// - `overflow_path` may be null
 /// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqErrorUnsupported` for a non-null subscriber (the group cache is not simulated)
+/// - `MoqErrorInvalidArgument` if subscriber is null
 #[no_mangle]
-pub unsafe extern "C" fn moq_announce_namespace(
-    client: *mut MoqClient,
-    namespace: *const c_char,
+pub unsafe extern "C" fn moq_subscriber_enable_cache(
+    subscriber: *mut MoqSubscriber,
+    _max_groups: usize,
+    _max_age_ms: u32,
+    _memory_bytes: usize,
+    _overflow_path: *const c_char,
+    _overflow_bytes: usize,
 ) -> MoqResult {
     std::panic::catch_unwind(|| {
-        if client.is_null() || namespace.is_null() {
+        if subscriber.is_null() {
             return make_error_result(
                 MoqResultCode::MoqErrorInvalidArgument,
-                "Client or namespace is null",
+                "Subscriber is null",
             );
         }
-
         make_error_result(
             MoqResultCode::MoqErrorUnsupported,
-            "Stub backend: MoQ transport not enabled",
+            "Group cache not available in stub backend",
         )
     }).unwrap_or_else(|_| {
         make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
     })
 }
 
-/// Creates a publisher for a specific track (stub implementation - always returns null).
-///
-/// # Safety
-/// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `namespace` must be a valid null-terminated C string pointer
-/// - `track_name` must be a valid null-terminated C string pointer
-/// - This function is thread-safe
-#[no_mangle]
-pub unsafe extern "C" fn moq_create_publisher(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-    track_name: *const c_char,
-) -> *mut MoqPublisher {
-    std::panic::catch_unwind(|| {
-        if client.is_null() || namespace.is_null() || track_name.is_null() {
-            return std::ptr::null_mut();
-        }
-
-        std::ptr::null_mut() // Stub: can't create publisher
-    }).unwrap_or(std::ptr::null_mut())
-}
-
-/// Creates a publisher for a specific track with explicit delivery mode (stub implementation - always returns null).
+/// Gets the cached group range of a subscriber (stub implementation - always false).
 ///
 /// # Safety
-/// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `namespace` must be a valid null-terminated C string pointer
-/// - `track_name` must be a valid null-terminated C string pointer
-/// - This function is thread-safe
+/// - `subscriber` may be null
+/// - `first_group` and `last_group` must be valid pointers to writable `u64`s
 #[no_mangle]
-pub unsafe extern "C" fn moq_create_publisher_ex(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-    track_name: *const c_char,
-    _delivery_mode: MoqDeliveryMode,
-) -> *mut MoqPublisher {
-    std::panic::catch_unwind(|| {
-        if client.is_null() || namespace.is_null() || track_name.is_null() {
-            return std::ptr::null_mut();
-        }
-
-        std::ptr::null_mut() // Stub: can't create publisher
-    }).unwrap_or(std::ptr::null_mut())
+pub unsafe extern "C" fn moq_subscriber_cached_groups(
+    _subscriber: *const MoqSubscriber,
+    _first_group: *mut u64,
+    _last_group: *mut u64,
+) -> bool {
+    false // Stub: the cache can't be enabled
 }
 
-/// Destroys a publisher and releases its resources (stub implementation).
+/// Delivers cached objects of a group range (stub implementation).
 ///
 /// # Safety
-/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
-/// - `publisher` must not be null (null pointers are safely ignored)
+/// - `subscriber` must be a valid pointer returned from a subscribe function
 /// - This function is thread-safe
-#[no_mangle]
-pub unsafe extern "C" fn moq_publisher_destroy(publisher: *mut MoqPublisher) {
-    let _ = std::panic::catch_unwind(|| {
-        if !publisher.is_null() {
-            // Note: In stub backend, moq_create_publisher always returns null,
-            // so this path should never be reached. This is a placeholder for
-            // the full implementation.
-            let _ = Box::from_raw(publisher);
-        }
-    });
-}
-
-/// Publishes data to a track (stub implementation).
 ///
-/// # Safety
-/// - `publisher` must be a valid pointer returned from `moq_create_publisher()`
-/// - `data` must be a valid pointer to a buffer of at least `_data_len` bytes
-/// - This function is thread-safe
+/// # Returns
+/// `MoqErrorInvalidArgument`: subscriber or callback is null, or the cache is
+/// not enabled (which it never is in stub mode)
 #[no_mangle]
-pub unsafe extern "C" fn moq_publish_data(
-    publisher: *mut MoqPublisher,
-    data: *const u8,
-    _data_len: usize,
-    _delivery_mode: MoqDeliveryMode,
+pub unsafe extern "C" fn moq_subscriber_read_range(
+    subscriber: *mut MoqSubscriber,
+    _first_group: u64,
+    _last_group: u64,
+    callback: MoqBatchCallback,
+    _user_data: *mut std::ffi::c_void,
 ) -> MoqResult {
     std::panic::catch_unwind(|| {
-        if publisher.is_null() || data.is_null() {
+        if subscriber.is_null() || callback.is_none() {
             return make_error_result(
                 MoqResultCode::MoqErrorInvalidArgument,
-                "Publisher or data is null",
+                "Subscriber or callback is null",
             );
         }
-
         make_error_result(
-            MoqResultCode::MoqErrorUnsupported,
-            "Stub backend: MoQ transport not enabled",
+            MoqResultCode::MoqErrorInvalidArgument,
+            "Subscriber cache is not enabled",
         )
     }).unwrap_or_else(|_| {
         make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
@@ -397,106 +2308,90 @@ pub unsafe extern "C" fn moq_publish_data(
 }
 
 /* ───────────────────────────────────────────────
- * Subscribing
+ * Recording
  * ─────────────────────────────────────────────── */
 
-/// Subscribes to a track on the MoQ relay server (stub implementation - always returns null).
+/// Records a track to disk (stub implementation - always returns null).
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
-/// - `namespace` must be a valid null-terminated C string pointer
-/// - `track_name` must be a valid null-terminated C string pointer
+/// - `namespace`, `track_name` and `path` must be valid null-terminated C string pointers
 /// - This function is thread-safe
 #[no_mangle]
-pub unsafe extern "C" fn moq_subscribe(
-    client: *mut MoqClient,
-    namespace: *const c_char,
-    track_name: *const c_char,
-    _data_callback: MoqDataCallback,
-    _user_data: *mut std::ffi::c_void,
-) -> *mut MoqSubscriber {
-    std::panic::catch_unwind(|| {
-        if client.is_null() || namespace.is_null() || track_name.is_null() {
-            return std::ptr::null_mut();
-        }
-
-        std::ptr::null_mut() // Stub: can't create subscriber
-    }).unwrap_or(std::ptr::null_mut())
+pub unsafe extern "C" fn moq_recorder_create(
+    _client: *mut MoqClient,
+    _namespace: *const c_char,
+    _track_name: *const c_char,
+    _path: *const c_char,
+) -> *mut MoqRecorder {
+    std::ptr::null_mut() // Stub: can't subscribe to record
 }
 
-/// Destroys a subscriber and releases its resources (stub implementation).
+/// Stops a recorder (stub implementation).
 ///
 /// # Safety
-/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
-/// - `subscriber` must not be null (null pointers are safely ignored)
-/// - This function is thread-safe
+/// - `recorder` must be a valid pointer returned from `moq_recorder_create()`
+/// - `recorder` may be null (no-op)
 #[no_mangle]
-pub unsafe extern "C" fn moq_subscriber_destroy(subscriber: *mut MoqSubscriber) {
+pub unsafe extern "C" fn moq_recorder_destroy(recorder: *mut MoqRecorder) {
     let _ = std::panic::catch_unwind(|| {
-        if !subscriber.is_null() {
-            // Note: In stub backend, moq_subscribe always returns null,
-            // so this path should never be reached. This is a placeholder for
-            // the full implementation.
-            let _ = Box::from_raw(subscriber);
+        if !recorder.is_null() {
+            // Note: In stub backend, moq_recorder_create always returns null
+            let _ = Box::from_raw(recorder);
         }
     });
 }
 
-/// Unsubscribes from a track without destroying the subscriber handle (stub implementation).
+/// Republishes a recorded track (stub implementation - always returns null).
 ///
 /// # Safety
-/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
-/// - `subscriber` must not be null
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `namespace` and `path` must be valid null-terminated C string pointers
 /// - This function is thread-safe
-/// - Safe to call multiple times (idempotent)
-///
-/// # Returns
-/// - `MoqOk` on success or if already unsubscribed
-/// - `MoqErrorInvalidArgument` if subscriber is null
 #[no_mangle]
-pub unsafe extern "C" fn moq_unsubscribe(subscriber: *mut MoqSubscriber) -> MoqResult {
-    std::panic::catch_unwind(|| {
-        if subscriber.is_null() {
-            return make_error_result(
-                MoqResultCode::MoqErrorInvalidArgument,
-                "Subscriber is null",
-            );
-        }
-
-        // Stub: subscriber handles don't exist in stub mode, but return OK for consistency
-        make_ok_result()
-    }).unwrap_or_else(|_| {
-        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
-    })
+pub unsafe extern "C" fn moq_replayer_create(
+    _client: *mut MoqClient,
+    _namespace: *const c_char,
+    _path: *const c_char,
+    _speed: f64,
+) -> *mut MoqReplayer {
+    std::ptr::null_mut() // Stub: can't publish
 }
 
-/// Checks if the subscriber is currently subscribed to a track (stub implementation - always returns false).
+/// Checks whether a replayer has finished (stub implementation - always true).
 ///
 /// # Safety
-/// - `subscriber` must be a valid pointer returned from `moq_subscribe()`
-/// - `subscriber` may be null (returns false)
-/// - This function is thread-safe
+/// - `replayer` must be a valid pointer returned from `moq_replayer_create()` or null
+#[no_mangle]
+pub unsafe extern "C" fn moq_replayer_is_finished(_replayer: *const MoqReplayer) -> bool {
+    true
+}
+
+/// Stops a replayer (stub implementation).
 ///
-/// # Returns
-/// - Always returns false in stub mode (no active subscriptions possible)
+/// # Safety
+/// - `replayer` must be a valid pointer returned from `moq_replayer_create()`
+/// - `replayer` may be null (no-op)
 #[no_mangle]
-pub unsafe extern "C" fn moq_is_subscribed(subscriber: *const MoqSubscriber) -> bool {
-    std::panic::catch_unwind(|| {
-        if subscriber.is_null() {
-            return false;
+pub unsafe extern "C" fn moq_replayer_destroy(replayer: *mut MoqReplayer) {
+    let _ = std::panic::catch_unwind(|| {
+        if !replayer.is_null() {
+            // Note: In stub backend, moq_replayer_create always returns null
+            let _ = Box::from_raw(replayer);
         }
-        false // Stub: never subscribed
-    }).unwrap_or(false)
+    });
 }
 
 /* ───────────────────────────────────────────────
  * Namespace Announcement Discovery
  * ─────────────────────────────────────────────── */
 
-/// Subscribe to namespace announcements from other publishers (stub implementation).
+/// Subscribe to track announcements from other publishers (stub implementation).
 ///
-/// In the stub backend, this function registers the callback but will never invoke it
-/// since there's no actual MoQ transport to receive announcements from.
+/// The callback runs on the thread that calls `moq_sim_advance()`, once for
+/// every track another client of the simulated relay publishes, including
+/// tracks that existed before registration. It may be registered before
+/// connecting and stays registered across reconnects.
 ///
 /// # Safety
 /// - `client` must be a valid pointer returned from `moq_client_create()`
@@ -506,13 +2401,13 @@ pub unsafe extern "C" fn moq_is_subscribed(subscriber: *const MoqSubscriber) ->
 /// - This function is thread-safe
 ///
 /// # Returns
-/// - `MoqOk` on success (callback registered but will never be invoked)
+/// - `MoqOk` on success
 /// - `MoqErrorInvalidArgument` if client is null
 #[no_mangle]
 pub unsafe extern "C" fn moq_subscribe_announces(
     client: *mut MoqClient,
-    _callback: MoqTrackCallback,
-    _user_data: *mut std::ffi::c_void,
+    callback: MoqTrackCallback,
+    user_data: *mut std::ffi::c_void,
 ) -> MoqResult {
     std::panic::catch_unwind(|| {
         if client.is_null() {
@@ -522,8 +2417,19 @@ pub unsafe extern "C" fn moq_subscribe_announces(
             );
         }
 
-        // Stub: Accept the registration but never invoke the callback
-        // This allows applications to future-proof their code
+        let handler = callback.map(|cb| {
+            let user_data = UserData(user_data);
+            Arc::new(move |namespace: &str, track: &str| {
+                let (Ok(namespace), Ok(track)) = (CString::new(namespace), CString::new(track)) else { return };
+                let context = &user_data;
+                let _ = std::panic::catch_unwind(|| unsafe { cb(context.0, namespace.as_ptr(), track.as_ptr()) });
+            }) as sim::AnnounceHandler
+        });
+        let mut state = lock(&(*client).inner);
+        if let Some(session) = state.session.as_ref() {
+            session.set_announce_handler(handler.clone());
+        }
+        state.announce_handler = handler;
         make_ok_result()
     }).unwrap_or_else(|_| {
         make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
@@ -568,6 +2474,124 @@ pub unsafe extern "C" fn moq_subscribe_catalog(
     }).unwrap_or(std::ptr::null_mut())
 }
 
+/* ───────────────────────────────────────────────
+ * Simulated Network
+ * ─────────────────────────────────────────────── */
+
+/// One direction of a client's link to a simulated relay.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct MoqSimLink {
+    pub latency_us: u32,
+    pub jitter_us: u32,
+    pub bandwidth_bps: u64,
+    pub loss: f64,
+}
+
+impl MoqSimLink {
+    fn to_config(self) -> sim::LinkConfig {
+        sim::LinkConfig {
+            latency_us: self.latency_us as u64,
+            jitter_us: self.jitter_us as u64,
+            bandwidth_bps: self.bandwidth_bps,
+            loss: self.loss,
+        }
+    }
+}
+
+/// Sets the simulated links between a client and its relay.
+///
+/// Takes effect immediately when connected and is kept for later connects.
+///
+/// # Safety
+/// - `client` must be a valid pointer returned from `moq_client_create()`
+/// - `uplink` and `downlink` must be valid pointers, or null to leave that direction unchanged
+/// - This function is thread-safe
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if client is null or a loss probability is outside [0, 1]
+#[no_mangle]
+pub unsafe extern "C" fn moq_sim_set_link(
+    client: *mut MoqClient,
+    uplink: *const MoqSimLink,
+    downlink: *const MoqSimLink,
+) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if client.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "Client is null");
+        }
+        let links = [uplink, downlink].map(|link| (!link.is_null()).then(|| (*link).to_config()));
+        if links.iter().flatten().any(|link| !(0.0..=1.0).contains(&link.loss)) {
+            return make_error_result(
+                MoqResultCode::MoqErrorInvalidArgument,
+                "Loss probability must be between 0 and 1",
+            );
+        }
+
+        let mut state = lock(&(*client).inner);
+        if let Some(uplink) = links[0] {
+            state.uplink = uplink;
+        }
+        if let Some(downlink) = links[1] {
+            state.downlink = downlink;
+        }
+        if let Some(session) = state.session.as_ref() {
+            session.set_links(state.uplink, state.downlink);
+        }
+        make_ok_result()
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Advances the virtual clock of a simulated relay, delivering everything that falls due.
+///
+/// Callbacks run on the calling thread, in virtual-time order.
+///
+/// # Safety
+/// - `url` must be a valid null-terminated C string pointer
+/// - Advancing one relay from several threads at once is allowed but makes delivery order nondeterministic
+///
+/// # Returns
+/// - `MoqOk` on success
+/// - `MoqErrorInvalidArgument` if `url` is null or names no relay with a connected client
+#[no_mangle]
+pub unsafe extern "C" fn moq_sim_advance(url: *const c_char, duration_us: u64) -> MoqResult {
+    std::panic::catch_unwind(|| {
+        if url.is_null() {
+            return make_error_result(MoqResultCode::MoqErrorInvalidArgument, "URL is null");
+        }
+        match c_str(url).and_then(sim::find) {
+            Some(relay) => {
+                let delivered = relay.advance(duration_us);
+                log::trace!("Advanced simulated relay by {} us, delivered {} objects", duration_us, delivered);
+                make_ok_result()
+            }
+            None => make_error_result(MoqResultCode::MoqErrorInvalidArgument, "No simulated relay at this URL"),
+        }
+    }).unwrap_or_else(|_| {
+        make_error_result(MoqResultCode::MoqErrorInternal, "Internal panic occurred")
+    })
+}
+
+/// Returns the virtual time of a simulated relay in microseconds.
+///
+/// # Safety
+/// - `url` must be a valid null-terminated C string pointer, or null
+///
+/// # Returns
+/// Microseconds since the relay was created, or 0 if `url` names no live relay
+#[no_mangle]
+pub unsafe extern "C" fn moq_sim_now(url: *const c_char) -> u64 {
+    std::panic::catch_unwind(|| {
+        if url.is_null() {
+            return 0;
+        }
+        c_str(url).and_then(sim::find).map_or(0, |relay| relay.now_us())
+    }).unwrap_or(0)
+}
+
 /* ───────────────────────────────────────────────
  * Utilities
  * ─────────────────────────────────────────────── */
@@ -614,6 +2638,32 @@ pub extern "C" fn moq_last_error() -> *const c_char {
     std::ptr::null() // Stub: no thread-local error tracking
 }
 
+/// Snapshot of the library's async runtime.
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct MoqRuntimeStats {
+    pub worker_threads: usize,
+    pub alive_tasks: usize,
+    pub global_queue_depth: usize,
+}
+
+/// Reports runtime statistics (stub implementation - there is no runtime, so all zero).
+///
+/// # Safety
+/// - `stats` must be a valid pointer to writable `MoqRuntimeStats`, or null
+/// - This function is thread-safe
+///
+/// # Returns
+/// `true` on success, `false` if `stats` is null
+#[no_mangle]
+pub unsafe extern "C" fn moq_get_runtime_stats(stats: *mut MoqRuntimeStats) -> bool {
+    if stats.is_null() {
+        return false;
+    }
+    *stats = MoqRuntimeStats::default();
+    true
+}
+
 /* ───────────────────────────────────────────────
  * Tests
  * ─────────────────────────────────────────────── */
@@ -623,6 +2673,19 @@ mod tests {
     use super::*;
     use std::ffi::CStr;
 
+    /// A publisher handle that is not attached to any relay.
+    fn detached_publisher() -> *mut MoqPublisher {
+        Box::into_raw(Box::new(MoqPublisher { sim: None, inband_headers: false }))
+    }
+
+    /// A subscriber handle that is not attached to any relay.
+    fn detached_subscriber() -> *mut MoqSubscriber {
+        Box::into_raw(Box::new(MoqSubscriber {
+            subscription: Mutex::new(None),
+            sink: Sink::new(Delivery::None, std::ptr::null_mut()),
+        }))
+    }
+
     /* ───────────────────────────────────────────────
      * Lifecycle Tests
      * ─────────────────────────────────────────────── */
@@ -874,7 +2937,7 @@ mod tests {
         fn test_publish_data_with_null_data() {
             // Create a fake publisher pointer (stub never creates real ones)
             // We test the null data check with a non-null publisher pointer
-            let fake_publisher = Box::into_raw(Box::new(MoqPublisher { _dummy: 0 }));
+            let fake_publisher = detached_publisher();
             let result = unsafe {
                 moq_publish_data(
                     fake_publisher,
@@ -950,9 +3013,35 @@ mod tests {
         }
 
         #[test]
-        fn test_is_subscribed_with_null_subscriber() {
-            let subscribed = unsafe { moq_is_subscribed(std::ptr::null()) };
-            assert!(!subscribed);
+        fn test_is_subscribed_with_null_subscriber() {
+            let subscribed = unsafe { moq_is_subscribed(std::ptr::null()) };
+            assert!(!subscribed);
+        }
+
+        #[test]
+        fn test_subscriber_set_callback_with_null_subscriber() {
+            let result = unsafe { moq_subscriber_set_callback(std::ptr::null_mut(), None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            assert!(!result.message.is_null());
+            unsafe { moq_free_str(result.message); }
+
+            let result = unsafe {
+                moq_subscriber_set_batch_callback(std::ptr::null_mut(), None, std::ptr::null_mut(), 0, 0)
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_subscribe_batched_returns_null() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track").unwrap();
+            let subscriber = unsafe {
+                moq_subscribe_batched(client, namespace.as_ptr(), track.as_ptr(), None, std::ptr::null_mut(), 0, 0)
+            };
+            assert!(subscriber.is_null());
+            unsafe { moq_client_destroy(client); }
         }
 
         #[test]
@@ -1041,17 +3130,100 @@ mod tests {
         #[test]
         fn test_unsubscribe_with_fake_subscriber() {
             // In stub mode, we can create a fake subscriber to test the function
-            let fake_subscriber = Box::into_raw(Box::new(MoqSubscriber { _dummy: 0 }));
+            let fake_subscriber = detached_subscriber();
             let result = unsafe { moq_unsubscribe(fake_subscriber) };
             assert_eq!(result.code, MoqResultCode::MoqOk);
             assert!(result.message.is_null());
             unsafe { let _ = Box::from_raw(fake_subscriber); } // Clean up
         }
 
+        #[test]
+        fn test_recorder_create_returns_null() {
+            let client = moq_client_create();
+            let name = std::ffi::CString::new("name").unwrap();
+            let recorder = unsafe { moq_recorder_create(client, name.as_ptr(), name.as_ptr(), name.as_ptr()) };
+            assert!(recorder.is_null());
+            let replayer = unsafe { moq_replayer_create(client, name.as_ptr(), name.as_ptr(), 1.0) };
+            assert!(replayer.is_null());
+            unsafe {
+                assert!(moq_replayer_is_finished(replayer));
+                moq_replayer_destroy(replayer);
+                moq_recorder_destroy(recorder);
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_publish_file_range_with_null_publisher() {
+            let path = std::ffi::CString::new("file").unwrap();
+            let result = unsafe { moq_publish_file_range(std::ptr::null_mut(), path.as_ptr(), 0, 1) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+        }
+
+        #[test]
+        fn test_publish_acquire_returns_empty_slot() {
+            let mut slot = unsafe { moq_publish_acquire(std::ptr::null_mut(), 64) };
+            assert!(slot.data.is_null());
+            assert_eq!(slot.capacity, 0);
+
+            let result = unsafe { moq_publish_commit(&mut slot, 0) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+            unsafe { moq_publish_release(&mut slot); }
+        }
+
+        #[test]
+        fn test_subscriber_set_allocator_validates_hooks() {
+            unsafe extern "C" fn alloc(_user_data: *mut std::ffi::c_void, _size: usize) -> *mut u8 {
+                std::ptr::null_mut()
+            }
+
+            let result = unsafe { moq_subscriber_set_allocator(std::ptr::null_mut(), None, None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+
+            let fake_subscriber = detached_subscriber();
+            let result = unsafe { moq_subscriber_set_allocator(fake_subscriber, Some(alloc), None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+            let result = unsafe { moq_subscriber_set_allocator(fake_subscriber, None, None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            unsafe { let _ = Box::from_raw(fake_subscriber); } // Clean up
+        }
+
+        #[test]
+        fn test_subscriber_cache_unsupported() {
+            let result = unsafe { moq_subscriber_enable_cache(std::ptr::null_mut(), 0, 0, 1024, std::ptr::null(), 0) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+
+            let fake_subscriber = detached_subscriber();
+            let result = unsafe { moq_subscriber_enable_cache(fake_subscriber, 0, 0, 1024, std::ptr::null(), 0) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorUnsupported);
+            unsafe { moq_free_str(result.message); }
+
+            let (mut first, mut last) = (0u64, 0u64);
+            assert!(!unsafe { moq_subscriber_cached_groups(fake_subscriber, &mut first, &mut last) });
+            let result = unsafe { moq_subscriber_read_range(fake_subscriber, 0, 1, None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+            unsafe { let _ = Box::from_raw(fake_subscriber); } // Clean up
+        }
+
+        #[test]
+        fn test_subscriber_set_callback_with_fake_subscriber() {
+            let fake_subscriber = detached_subscriber();
+            let result = unsafe { moq_subscriber_set_callback(fake_subscriber, None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqOk);
+            assert!(result.message.is_null());
+            unsafe { let _ = Box::from_raw(fake_subscriber); } // Clean up
+        }
+
         #[test]
         fn test_unsubscribe_is_idempotent() {
             // Calling unsubscribe multiple times should be safe
-            let fake_subscriber = Box::into_raw(Box::new(MoqSubscriber { _dummy: 0 }));
+            let fake_subscriber = detached_subscriber();
             
             let result1 = unsafe { moq_unsubscribe(fake_subscriber) };
             assert_eq!(result1.code, MoqResultCode::MoqOk);
@@ -1065,7 +3237,7 @@ mod tests {
         #[test]
         fn test_is_subscribed_returns_false_in_stub() {
             // In stub mode, subscribers are never really subscribed
-            let fake_subscriber = Box::into_raw(Box::new(MoqSubscriber { _dummy: 0 }));
+            let fake_subscriber = detached_subscriber();
             let subscribed = unsafe { moq_is_subscribed(fake_subscriber) };
             assert!(!subscribed); // Stub always returns false
             unsafe { let _ = Box::from_raw(fake_subscriber); }
@@ -1117,13 +3289,13 @@ mod tests {
         }
 
         #[test]
-        fn test_announce_namespace_returns_unsupported() {
+        fn test_announce_namespace_requires_connection() {
             let client = moq_client_create();
             let namespace = std::ffi::CString::new("test/namespace").unwrap();
             let result = unsafe {
                 moq_announce_namespace(client, namespace.as_ptr())
             };
-            assert_eq!(result.code, MoqResultCode::MoqErrorUnsupported);
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
             assert!(!result.message.is_null());
             unsafe {
                 moq_free_str(result.message);
@@ -1175,8 +3347,8 @@ mod tests {
         }
 
         #[test]
-        fn test_publish_data_returns_unsupported() {
-            let fake_publisher = Box::into_raw(Box::new(MoqPublisher { _dummy: 0 }));
+        fn test_publish_data_on_detached_publisher() {
+            let fake_publisher = detached_publisher();
             let data = [1u8, 2, 3, 4, 5];
             let result = unsafe {
                 moq_publish_data(
@@ -1186,7 +3358,7 @@ mod tests {
                     MoqDeliveryMode::MoqDeliveryStream,
                 )
             };
-            assert_eq!(result.code, MoqResultCode::MoqErrorUnsupported);
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
             assert!(!result.message.is_null());
             unsafe {
                 moq_free_str(result.message);
@@ -1194,6 +3366,83 @@ mod tests {
             }
         }
 
+        #[test]
+        fn test_bulk_creation_requires_connection() {
+            let client = moq_client_create();
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let track = std::ffi::CString::new("track1").unwrap();
+            let names = [track.as_ptr(), track.as_ptr()];
+
+            let mut publishers = [std::ptr::NonNull::<MoqPublisher>::dangling().as_ptr(); 2];
+            let result = unsafe {
+                moq_create_publishers(
+                    client,
+                    namespace.as_ptr(),
+                    names.as_ptr(),
+                    names.len(),
+                    MoqDeliveryMode::MoqDeliveryStream,
+                    publishers.as_mut_ptr(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+            assert!(publishers.iter().all(|p| p.is_null()));
+            unsafe { moq_free_str(result.message); }
+
+            let mut subscribers = [std::ptr::NonNull::<MoqSubscriber>::dangling().as_ptr(); 2];
+            let result = unsafe {
+                moq_subscribe_many(
+                    client,
+                    namespace.as_ptr(),
+                    names.as_ptr(),
+                    names.len(),
+                    None,
+                    std::ptr::null(),
+                    subscribers.as_mut_ptr(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+            assert!(subscribers.iter().all(|s| s.is_null()));
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+
+        #[test]
+        fn test_bulk_creation_with_null_arguments() {
+            let namespace = std::ffi::CString::new("test").unwrap();
+            let result = unsafe {
+                moq_create_publishers(
+                    std::ptr::null_mut(),
+                    namespace.as_ptr(),
+                    std::ptr::null(),
+                    0,
+                    MoqDeliveryMode::MoqDeliveryStream,
+                    std::ptr::null_mut(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message); }
+
+            let client = moq_client_create();
+            let result = unsafe {
+                moq_subscribe_many(
+                    client,
+                    namespace.as_ptr(),
+                    std::ptr::null(),
+                    4,
+                    None,
+                    std::ptr::null(),
+                    std::ptr::null_mut(),
+                )
+            };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+
         #[test]
         fn test_subscribe_returns_null_in_stub() {
             let client = moq_client_create();
@@ -1287,6 +3536,8 @@ mod tests {
                 // Client management
                 moq_client_destroy(std::ptr::null_mut());
                 let _ = moq_disconnect(std::ptr::null_mut());
+                let _ = moq_disconnect_graceful(std::ptr::null_mut(), 0);
+                let _ = moq_client_set_auto_resume(std::ptr::null_mut(), true);
                 let _ = moq_is_connected(std::ptr::null());
                 
                 // Publishing
@@ -1430,6 +3681,7 @@ mod tests {
                 MoqConnectionState::MoqStateConnecting => "connecting",
                 MoqConnectionState::MoqStateConnected => "connected",
                 MoqConnectionState::MoqStateFailed => "failed",
+                MoqConnectionState::MoqStateResuming => "resuming",
             };
         }
 
@@ -1570,6 +3822,14 @@ mod tests {
             assert!(version.contains("stub"));
         }
 
+        #[test]
+        fn test_runtime_stats_are_zero() {
+            assert!(!unsafe { moq_get_runtime_stats(std::ptr::null_mut()) });
+            let mut stats = MoqRuntimeStats { worker_threads: 1, alive_tasks: 1, global_queue_depth: 1 };
+            assert!(unsafe { moq_get_runtime_stats(&mut stats) });
+            assert_eq!((stats.worker_threads, stats.alive_tasks, stats.global_queue_depth), (0, 0, 0));
+        }
+
         #[test]
         fn test_version_is_static() {
             // Version string should be static, not need freeing
@@ -1629,6 +3889,8 @@ mod tests {
             assert_eq!(MoqResultCode::MoqErrorInternal as i32, 5);
             assert_eq!(MoqResultCode::MoqErrorUnsupported as i32, 6);
             assert_eq!(MoqResultCode::MoqErrorBufferTooSmall as i32, 7);
+            assert_eq!(MoqResultCode::MoqErrorWouldBlock as i32, 8);
+            assert_eq!(MoqResultCode::MoqErrorUnconfirmed as i32, 9);
         }
 
         #[test]
@@ -1637,6 +3899,7 @@ mod tests {
             assert_eq!(MoqConnectionState::MoqStateConnecting as i32, 1);
             assert_eq!(MoqConnectionState::MoqStateConnected as i32, 2);
             assert_eq!(MoqConnectionState::MoqStateFailed as i32, 3);
+            assert_eq!(MoqConnectionState::MoqStateResuming as i32, 4);
         }
 
         #[test]
@@ -1709,6 +3972,540 @@ mod tests {
         }
     }
 
+    /* ───────────────────────────────────────────────
+     * Simulated Network Tests
+     * ─────────────────────────────────────────────── */
+
+    mod simulated_network {
+        use super::*;
+        use std::ffi::c_void;
+
+        type Received = Mutex<Vec<(u64, Vec<u8>)>>;
+
+        /// Records each object with the virtual time of its arrival.
+        unsafe extern "C" fn on_data(user_data: *mut c_void, data: *const u8, len: usize) {
+            let (url, received) = &*(user_data as *const (CString, Received));
+            let now = moq_sim_now(url.as_ptr());
+            received.lock().unwrap().push((now, std::slice::from_raw_parts(data, len).to_vec()));
+        }
+
+        unsafe extern "C" fn on_batch(user_data: *mut c_void, objects: *const MoqObject, count: usize) {
+            let batches = &*(user_data as *const Mutex<Vec<Vec<u64>>>);
+            let objects = std::slice::from_raw_parts(objects, count);
+            batches.lock().unwrap().push(objects.iter().map(|o| o.group_id).collect());
+        }
+
+        unsafe extern "C" fn on_track(user_data: *mut c_void, namespace: *const c_char, track: *const c_char) {
+            let tracks = &*(user_data as *const Mutex<Vec<String>>);
+            let name = format!("{}/{}", CStr::from_ptr(namespace).to_str().unwrap(), CStr::from_ptr(track).to_str().unwrap());
+            tracks.lock().unwrap().push(name);
+        }
+
+        fn check(result: MoqResult) {
+            let code = result.code;
+            unsafe { moq_free_str(result.message) };
+            assert_eq!(code, MoqResultCode::MoqOk);
+        }
+
+        fn connect(url: &CString) -> *mut MoqClient {
+            let client = moq_client_create();
+            check(unsafe { moq_connect(client, url.as_ptr(), None, std::ptr::null_mut()) });
+            client
+        }
+
+        fn link(latency_us: u32, loss: f64) -> MoqSimLink {
+            MoqSimLink { latency_us, loss, ..MoqSimLink::default() }
+        }
+
+        #[test]
+        fn test_transport_stats_report_link_round_trip() {
+            let url = CString::new("sim://stub-transport-stats").unwrap();
+            let client = moq_client_create();
+            let mut stats = MoqTransportStats::default();
+            unsafe {
+                let result = moq_client_get_transport_stats(client, &mut stats);
+                assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+                moq_free_str(result.message);
+
+                check(moq_client_set_udp_offload(client, false, false));
+                check(moq_connect(client, url.as_ptr(), None, std::ptr::null_mut()));
+                check(moq_sim_set_link(client, &link(20_000, 0.0), &link(5_000, 0.0)));
+                check(moq_client_get_transport_stats(client, &mut stats));
+                moq_client_destroy(client);
+            }
+            assert_eq!(stats.rtt_us, 25_000);
+            assert_eq!((stats.gso_segments, stats.gro_segments, stats.udp_tx_datagrams), (1, 1, 0));
+        }
+
+        unsafe extern "C" fn on_latency(user_data: *mut c_void, latency_us: u64, sequence: u64) {
+            let samples = &*(user_data as *const Mutex<Vec<(u64, u64)>>);
+            samples.lock().unwrap().push((sequence, latency_us));
+        }
+
+        #[test]
+        fn test_latency_probe_measures_relay_path() {
+            let url = CString::new("sim://stub-latency-probe").unwrap();
+            let samples: Mutex<Vec<(u64, u64)>> = Mutex::new(Vec::new());
+            let client = moq_client_create();
+            let mut stats = MoqLatencyStats::default();
+            unsafe {
+                let result = moq_client_start_latency_probe(client, 100, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+                moq_free_str(result.message);
+
+                check(moq_connect(client, url.as_ptr(), None, std::ptr::null_mut()));
+                check(moq_sim_set_link(client, &link(20_000, 0.0), &link(5_000, 0.0)));
+                let result = moq_client_start_latency_probe(client, 0, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+                check(moq_client_start_latency_probe(
+                    client,
+                    100,
+                    Some(on_latency),
+                    &samples as *const _ as *mut c_void,
+                ));
+
+                // Probes leave at 100, 200 and 300 ms and are back 25 ms later
+                check(moq_sim_advance(url.as_ptr(), 350_000));
+                check(moq_client_get_latency_stats(client, &mut stats));
+                assert_eq!((stats.probes_sent, stats.probes_received), (3, 3));
+                assert_eq!((stats.last_us, stats.min_us, stats.max_us, stats.smoothed_us), (25_000, 25_000, 25_000, 25_000));
+
+                // Stopping keeps the figures and ends the probes
+                check(moq_client_stop_latency_probe(client));
+                check(moq_sim_advance(url.as_ptr(), 1_000_000));
+                check(moq_client_get_latency_stats(client, &mut stats));
+                assert_eq!(stats.probes_received, 3);
+                moq_client_destroy(client);
+            }
+            assert_eq!(*samples.lock().unwrap(), vec![(0, 25_000), (1, 25_000), (2, 25_000)]);
+        }
+
+        #[test]
+        fn test_publish_reaches_subscriber_after_link_latency() {
+            let url = CString::new("sim://stub-latency").unwrap();
+            let ns = CString::new("game").unwrap();
+            let track = CString::new("state").unwrap();
+            let publisher_client = connect(&url);
+            let subscriber_client = connect(&url);
+            unsafe {
+                check(moq_sim_set_link(publisher_client, &link(20_000, 0.0), std::ptr::null()));
+                check(moq_sim_set_link(subscriber_client, std::ptr::null(), &link(30_000, 0.0)));
+                assert!(moq_is_connected(subscriber_client));
+
+                let context = Box::new((url.clone(), Received::default()));
+                let sub = moq_subscribe(subscriber_client, ns.as_ptr(), track.as_ptr(), Some(on_data), &*context as *const _ as *mut c_void);
+                assert!(!sub.is_null());
+                assert!(moq_create_publisher(publisher_client, ns.as_ptr(), track.as_ptr()).is_null(), "namespace not announced yet");
+                check(moq_announce_namespace(publisher_client, ns.as_ptr()));
+                let publ = moq_create_publisher(publisher_client, ns.as_ptr(), track.as_ptr());
+                assert!(!publ.is_null());
+
+                check(moq_publish_data(publ, b"hello".as_ptr(), 5, MoqDeliveryMode::MoqDeliveryStream));
+                check(moq_sim_advance(url.as_ptr(), 49_999));
+                assert!(context.1.lock().unwrap().is_empty());
+                check(moq_sim_advance(url.as_ptr(), 1));
+                assert_eq!(*context.1.lock().unwrap(), vec![(50_000, b"hello".to_vec())]);
+
+                // A disconnected subscriber stops receiving and its publisher's peer keeps working
+                check(moq_disconnect(subscriber_client));
+                assert!(!moq_is_subscribed(sub));
+                check(moq_publish_data(publ, b"again".as_ptr(), 5, MoqDeliveryMode::MoqDeliveryStream));
+                check(moq_sim_advance(url.as_ptr(), 100_000));
+                assert_eq!(context.1.lock().unwrap().len(), 1);
+
+                moq_subscriber_destroy(sub);
+                moq_publisher_destroy(publ);
+                moq_client_destroy(subscriber_client);
+                moq_client_destroy(publisher_client);
+            }
+            assert_eq!(unsafe { moq_sim_now(url.as_ptr()) }, 0, "relay is gone with its last client");
+        }
+
+        #[test]
+        fn test_prewarm_accepts_simulated_relays_only() {
+            let sim = CString::new("sim://stub-prewarm?seed=3").unwrap();
+            let https = CString::new("https://relay.example").unwrap();
+            unsafe {
+                check(moq_prewarm(std::ptr::null(), 0));
+                check(moq_prewarm_ex([sim.as_ptr()].as_ptr(), 1, true));
+                for (urls, expected) in [
+                    (vec![sim.as_ptr(), https.as_ptr()], MoqResultCode::MoqErrorUnsupported),
+                    (vec![sim.as_ptr(), std::ptr::null()], MoqResultCode::MoqErrorInvalidArgument),
+                ] {
+                    let result = moq_prewarm(urls.as_ptr(), urls.len());
+                    assert_eq!(result.code, expected);
+                    moq_free_str(result.message);
+                }
+                let result = moq_prewarm(std::ptr::null(), 1);
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+            }
+        }
+
+        #[test]
+        fn test_graceful_disconnect_delivers_data_in_flight() {
+            let url = CString::new("sim://stub-graceful-disconnect").unwrap();
+            let ns = CString::new("live").unwrap();
+            let track = CString::new("video").unwrap();
+            let subscriber_client = connect(&url);
+            let context = Box::new((url.clone(), Received::default()));
+            unsafe {
+                let sub = moq_subscribe(subscriber_client, ns.as_ptr(), track.as_ptr(), Some(on_data), &*context as *const _ as *mut c_void);
+                for (payload, deadline_ms, expected) in [
+                    (&b"flushed"[..], 50, MoqResultCode::MoqOk),
+                    (&b"too late"[..], 10, MoqResultCode::MoqErrorTimeout),
+                ] {
+                    let publisher_client = connect(&url);
+                    check(moq_sim_set_link(publisher_client, &link(20_000, 0.0), std::ptr::null()));
+                    check(moq_announce_namespace(publisher_client, ns.as_ptr()));
+                    let publ = moq_create_publisher(publisher_client, ns.as_ptr(), track.as_ptr());
+                    check(moq_publish_data(publ, payload.as_ptr(), payload.len(), MoqDeliveryMode::MoqDeliveryStream));
+
+                    let result = moq_disconnect_graceful(publisher_client, deadline_ms);
+                    assert_eq!(result.code, expected);
+                    moq_free_str(result.message);
+                    assert!(!moq_is_connected(publisher_client));
+                    let result = moq_publish_data(publ, b"x".as_ptr(), 1, MoqDeliveryMode::MoqDeliveryStream);
+                    assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+                    moq_free_str(result.message);
+                    moq_publisher_destroy(publ);
+                    moq_client_destroy(publisher_client);
+                    check(moq_sim_advance(url.as_ptr(), 100_000));
+                }
+                check(moq_disconnect_graceful(subscriber_client, 0));
+                moq_subscriber_destroy(sub);
+                moq_client_destroy(subscriber_client);
+            }
+            let received: Vec<Vec<u8>> = context.1.lock().unwrap().iter().map(|(_, data)| data.clone()).collect();
+            assert_eq!(received, vec![b"flushed".to_vec()]);
+        }
+
+        unsafe extern "C" fn on_flushed(user_data: *mut c_void, result: MoqResult) {
+            let results = &*(user_data as *const Mutex<Vec<MoqResultCode>>);
+            results.lock().unwrap().push(result.code);
+            moq_free_str(result.message);
+        }
+
+        #[test]
+        fn test_flush_waits_for_the_relay_to_acknowledge() {
+            let url = CString::new("sim://stub-flush").unwrap();
+            let ns = CString::new("match").unwrap();
+            let track = CString::new("final-state").unwrap();
+            let client = connect(&url);
+            let results: Mutex<Vec<MoqResultCode>> = Mutex::new(Vec::new());
+            let results_ptr = &results as *const _ as *mut c_void;
+            let mut unacked = 0u64;
+            unsafe {
+                check(moq_sim_set_link(client, &link(20_000, 0.0), std::ptr::null()));
+                check(moq_announce_namespace(client, ns.as_ptr()));
+                let publ = moq_create_publisher(client, ns.as_ptr(), track.as_ptr());
+                check(moq_publisher_flush(publ, 0));
+                check(moq_publish_data(publ, b"score".as_ptr(), 5, MoqDeliveryMode::MoqDeliveryStream));
+                check(moq_publisher_get_unacked_bytes(publ, &mut unacked));
+                assert_eq!(unacked, 5);
+
+                // The virtual clock stands still during a blocking flush
+                let result = moq_publisher_flush(publ, 1000);
+                assert_eq!(result.code, MoqResultCode::MoqErrorTimeout);
+                moq_free_str(result.message);
+
+                check(moq_publisher_flush_async(publ, 10, Some(on_flushed), results_ptr));
+                check(moq_publisher_flush_async(publ, 50, Some(on_flushed), results_ptr));
+                check(moq_sim_advance(url.as_ptr(), 19_999));
+                assert_eq!(*results.lock().unwrap(), [MoqResultCode::MoqErrorTimeout]);
+                check(moq_sim_advance(url.as_ptr(), 1));
+                assert_eq!(*results.lock().unwrap(), [MoqResultCode::MoqErrorTimeout, MoqResultCode::MoqOk]);
+                check(moq_publisher_get_unacked_bytes(publ, &mut unacked));
+                assert_eq!(unacked, 0);
+                check(moq_publisher_flush(publ, 0));
+
+                // Objects cut off by a disconnect are never acknowledged
+                check(moq_publish_data(publ, b"lost".as_ptr(), 4, MoqDeliveryMode::MoqDeliveryStream));
+                check(moq_publisher_flush_async(publ, 50, Some(on_flushed), results_ptr));
+                check(moq_disconnect(client));
+                let result = moq_publisher_flush(publ, 0);
+                assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+                moq_free_str(result.message);
+                moq_publisher_destroy(publ);
+                moq_client_destroy(client);
+            }
+            assert_eq!(results.lock().unwrap().len(), 2, "the relay is gone before the last wait ends");
+        }
+
+        unsafe extern "C" fn on_object(user_data: *mut c_void, data: *const u8, len: usize, info: *const MoqObjectInfo) {
+            let seen = &*(user_data as *const Mutex<Vec<(Vec<u8>, MoqObjectInfo)>>);
+            seen.lock().unwrap().push((std::slice::from_raw_parts(data, len).to_vec(), *info));
+        }
+
+        #[test]
+        fn test_stamped_objects_report_one_way_latency() {
+            let url = CString::new("sim://stub-one-way-latency").unwrap();
+            let ns = CString::new("cam").unwrap();
+            let track = CString::new("video").unwrap();
+            let seen: Mutex<Vec<(Vec<u8>, MoqObjectInfo)>> = Mutex::new(Vec::new());
+            let publisher_client = connect(&url);
+            let subscriber_client = connect(&url);
+            unsafe {
+                check(moq_sim_set_link(publisher_client, &link(20_000, 0.0), std::ptr::null()));
+                check(moq_sim_set_link(subscriber_client, std::ptr::null(), &link(30_000, 0.0)));
+                check(moq_client_set_inband_headers(subscriber_client, true));
+                let sub = moq_subscribe(subscriber_client, ns.as_ptr(), track.as_ptr(), None, std::ptr::null_mut());
+                check(moq_subscriber_set_object_callback(sub, Some(on_object), &seen as *const _ as *mut c_void));
+                check(moq_announce_namespace(publisher_client, ns.as_ptr()));
+
+                // Timestamps travel in-band, so a publisher has to opt in first
+                let audio = CString::new("audio").unwrap();
+                let plain_publ = moq_create_publisher(publisher_client, ns.as_ptr(), audio.as_ptr());
+                for result in [moq_publish_data_timestamped(plain_publ, b"a".as_ptr(), 1, 0), moq_publisher_set_timestamps(plain_publ, true)] {
+                    assert_eq!(result.code, MoqResultCode::MoqErrorUnsupported);
+                    moq_free_str(result.message);
+                }
+                check(moq_publisher_set_timestamps(plain_publ, false));
+                moq_publisher_destroy(plain_publ);
+                check(moq_client_set_inband_headers(publisher_client, true));
+                let publ = moq_create_publisher(publisher_client, ns.as_ptr(), track.as_ptr());
+
+                // Captured 10 ms before it is published, then stamped automatically, then not at all
+                check(moq_sim_advance(url.as_ptr(), 100_000));
+                check(moq_publish_data_timestamped(publ, b"a".as_ptr(), 1, 90_000));
+                check(moq_publisher_set_timestamps(publ, true));
+                check(moq_publish_data(publ, b"b".as_ptr(), 1, MoqDeliveryMode::MoqDeliveryStream));
+                check(moq_publisher_set_timestamps(publ, false));
+                check(moq_publish_data(publ, b"c".as_ptr(), 1, MoqDeliveryMode::MoqDeliveryStream));
+                check(moq_sim_advance(url.as_ptr(), 100_000));
+
+                moq_subscriber_destroy(sub);
+                moq_publisher_destroy(publ);
+                moq_client_destroy(subscriber_client);
+                moq_client_destroy(publisher_client);
+            }
+            let seen = seen.lock().unwrap();
+            let summary: Vec<(&[u8], u64, u64, bool)> = seen
+                .iter()
+                .map(|(payload, info)| (payload.as_slice(), info.capture_time_us, info.latency_us, info.latency_valid))
+                .collect();
+            assert_eq!(
+                summary,
+                vec![(&b"a"[..], 90_000, 60_000, true), (&b"b"[..], 100_000, 50_000, true), (&b"c"[..], 0, 0, false)]
+            );
+            assert!(seen.iter().all(|(_, info)| info.arrival_time_us == 150_000 && info.clock_offset_us == 0));
+        }
+
+        #[test]
+        fn test_extensions_travel_with_queued_objects() {
+            let url = CString::new("sim://stub-extensions").unwrap();
+            let ns = CString::new("cam").unwrap();
+            let track = CString::new("video").unwrap();
+            let publisher_client = connect(&url);
+            let subscriber_client = connect(&url);
+            let audio = CString::new("audio").unwrap();
+            unsafe {
+                // Subscriptions and publishers created before opting in go without extensions
+                let plain_sub = moq_subscribe_queued(subscriber_client, ns.as_ptr(), track.as_ptr(), 4);
+                check(moq_client_set_inband_headers(subscriber_client, true));
+                let sub = moq_subscribe_queued(subscriber_client, ns.as_ptr(), track.as_ptr(), 4);
+                check(moq_announce_namespace(publisher_client, ns.as_ptr()));
+                let plain_publ = moq_create_publisher(publisher_client, ns.as_ptr(), audio.as_ptr());
+                check(moq_client_set_inband_headers(publisher_client, true));
+                let publ = moq_create_publisher(publisher_client, ns.as_ptr(), track.as_ptr());
+
+                let extensions = [
+                    MoqExtension { key: 0x0b, value: 0, data: b"keyframe".as_ptr(), data_len: 8 },
+                    MoqExtension { key: 2, value: 1_234, data: std::ptr::null(), data_len: 0 },
+                ];
+                let result = moq_publish_data_ex(plain_publ, b"frame".as_ptr(), 5, extensions.as_ptr(), extensions.len());
+                assert_eq!(result.code, MoqResultCode::MoqErrorUnsupported);
+                moq_free_str(result.message);
+                check(moq_publish_data_ex(publ, b"frame".as_ptr(), 5, extensions.as_ptr(), extensions.len()));
+                let too_large = MoqExtension { key: 1 << 62, value: 0, data: std::ptr::null(), data_len: 0 };
+                let result = moq_publish_data_ex(publ, b"x".as_ptr(), 1, &too_large, 1);
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+                check(moq_sim_advance(url.as_ptr(), 1_000));
+
+                let mut object = MoqReceivedObject::empty();
+                let mut info = MoqObjectInfo::default();
+                check(moq_subscriber_next(sub, &mut object, None, std::ptr::null_mut()));
+                check(moq_object_info(&object, &mut info));
+                let received: Vec<(u64, u64, &[u8])> = std::slice::from_raw_parts(info.extensions, info.extension_count)
+                    .iter()
+                    .map(|e| (e.key, e.value, if e.data_len == 0 { &[][..] } else { std::slice::from_raw_parts(e.data, e.data_len) }))
+                    .collect();
+                // The capture time leads, as the network backend sends it
+                assert_eq!(received, vec![(2, 1_234, &[][..]), (0x0b, 0, &b"keyframe"[..])]);
+                assert_eq!(info.capture_time_us, 1_234);
+                moq_object_release(&mut object);
+
+                check(moq_subscriber_next(plain_sub, &mut object, None, std::ptr::null_mut()));
+                check(moq_object_info(&object, &mut info));
+                assert_eq!((info.extension_count, std::slice::from_raw_parts(object.data, object.data_len)), (0, &b"frame"[..]));
+                moq_object_release(&mut object);
+
+                moq_subscriber_destroy(plain_sub);
+                moq_subscriber_destroy(sub);
+                moq_publisher_destroy(plain_publ);
+                moq_publisher_destroy(publ);
+                moq_client_destroy(subscriber_client);
+                moq_client_destroy(publisher_client);
+            }
+        }
+
+        #[test]
+        fn test_seeded_loss_is_reproducible() {
+            let run = || unsafe {
+                let url = CString::new("sim://stub-loss?seed=7").unwrap();
+                let ns = CString::new("ns").unwrap();
+                let track = CString::new("t").unwrap();
+                let client = connect(&url);
+                check(moq_sim_set_link(client, &link(1_000, 0.25), &link(1_000, 0.0)));
+                let context = Box::new((url.clone(), Received::default()));
+                let sub = moq_subscribe(client, ns.as_ptr(), track.as_ptr(), Some(on_data), &*context as *const _ as *mut c_void);
+                check(moq_announce_namespace(client, ns.as_ptr()));
+                let publ = moq_create_publisher_ex(client, ns.as_ptr(), track.as_ptr(), MoqDeliveryMode::MoqDeliveryDatagram);
+                for i in 0..100u8 {
+                    check(moq_publish_data(publ, &i, 1, MoqDeliveryMode::MoqDeliveryDatagram));
+                    check(moq_sim_advance(url.as_ptr(), 1_000));
+                }
+                check(moq_sim_advance(url.as_ptr(), 10_000));
+                moq_subscriber_destroy(sub);
+                moq_publisher_destroy(publ);
+                moq_client_destroy(client);
+                let received = context.1.lock().unwrap().clone();
+                received
+            };
+            let first = run();
+            assert!(first.len() > 50 && first.len() < 95, "{} of 100 delivered", first.len());
+            assert_eq!(first, run());
+        }
+
+        #[test]
+        fn test_batches_and_announces() {
+            let url = CString::new("sim://stub-batches").unwrap();
+            let ns = CString::new("ns").unwrap();
+            let track = CString::new("t").unwrap();
+            let publisher_client = connect(&url);
+            let subscriber_client = connect(&url);
+            unsafe {
+                let tracks = Box::new(Mutex::new(Vec::<String>::new()));
+                check(moq_subscribe_announces(subscriber_client, Some(on_track), &*tracks as *const _ as *mut c_void));
+                let batches = Box::new(Mutex::new(Vec::<Vec<u64>>::new()));
+                let sub = moq_subscribe_batched(
+                    subscriber_client, ns.as_ptr(), track.as_ptr(), Some(on_batch),
+                    &*batches as *const _ as *mut c_void, 3, 1_000,
+                );
+                check(moq_announce_namespace(publisher_client, ns.as_ptr()));
+                let publ = moq_create_publisher(publisher_client, ns.as_ptr(), track.as_ptr());
+                for _ in 0..4 {
+                    check(moq_publish_data(publ, b"x".as_ptr(), 1, MoqDeliveryMode::MoqDeliveryStream));
+                }
+                check(moq_sim_advance(url.as_ptr(), 0));
+                assert_eq!(*tracks.lock().unwrap(), vec!["ns/t".to_string()]);
+                assert_eq!(*batches.lock().unwrap(), vec![vec![0, 1, 2]]);
+                check(moq_sim_advance(url.as_ptr(), 1_000));
+                assert_eq!(*batches.lock().unwrap(), vec![vec![0, 1, 2], vec![3]]);
+
+                moq_subscriber_destroy(sub);
+                moq_publisher_destroy(publ);
+                moq_client_destroy(subscriber_client);
+                moq_client_destroy(publisher_client);
+            }
+        }
+
+        unsafe extern "C" fn on_complete(user_data: *mut c_void, result: MoqResult) {
+            let codes = &*(user_data as *const Mutex<Vec<MoqResultCode>>);
+            codes.lock().unwrap().push(result.code);
+            moq_free_str(result.message);
+        }
+
+        unsafe extern "C" fn on_ready(user_data: *mut c_void) {
+            (*(user_data as *const std::sync::atomic::AtomicUsize))
+                .fetch_add(1, std::sync::atomic::Ordering::SeqCst);
+        }
+
+        #[test]
+        fn test_async_connect_and_queued_subscriber() {
+            use std::sync::atomic::{AtomicUsize, Ordering};
+
+            let url = CString::new("sim://stub-queued").unwrap();
+            let ns = CString::new("ns").unwrap();
+            let track = CString::new("t").unwrap();
+            let publisher_client = connect(&url);
+            let subscriber_client = moq_client_create();
+            unsafe {
+                let completions = Box::new(Mutex::new(Vec::<MoqResultCode>::new()));
+                check(moq_connect_async(
+                    subscriber_client, url.as_ptr(), None,
+                    &*completions as *const _ as *mut c_void, Some(on_complete),
+                ));
+                assert_eq!(*completions.lock().unwrap(), vec![MoqResultCode::MoqOk]);
+                assert!(moq_is_connected(subscriber_client));
+
+                let sub = moq_subscribe_queued(subscriber_client, ns.as_ptr(), track.as_ptr(), 2);
+                assert!(!sub.is_null());
+                let ready = Box::new(AtomicUsize::new(0));
+                let mut object = MoqReceivedObject::empty();
+                let result = moq_subscriber_next(sub, &mut object, Some(on_ready), &*ready as *const _ as *mut c_void);
+                assert_eq!(result.code, MoqResultCode::MoqErrorWouldBlock);
+                assert!(result.message.is_null());
+
+                check(moq_announce_namespace(publisher_client, ns.as_ptr()));
+                let publ = moq_create_publisher(publisher_client, ns.as_ptr(), track.as_ptr());
+                for payload in [b"a", b"b", b"c"] {
+                    check(moq_publish_data(publ, payload.as_ptr(), 1, MoqDeliveryMode::MoqDeliveryStream));
+                }
+                check(moq_sim_advance(url.as_ptr(), 0));
+                assert_eq!(ready.load(Ordering::SeqCst), 1, "ready fires once for the delivery");
+
+                // Limited to two: the oldest object was dropped
+                for expected in [b"b", b"c"] {
+                    check(moq_subscriber_next(sub, &mut object, None, std::ptr::null_mut()));
+                    assert_eq!(std::slice::from_raw_parts(object.data, object.data_len), expected);
+                    moq_object_release(&mut object);
+                    assert!(object.reserved.is_null());
+                }
+                moq_object_release(&mut object);
+
+                let result = moq_subscriber_next(sub, &mut object, Some(on_ready), &*ready as *const _ as *mut c_void);
+                assert_eq!(result.code, MoqResultCode::MoqErrorWouldBlock);
+                check(moq_unsubscribe(sub));
+                assert_eq!(ready.load(Ordering::SeqCst), 2, "unsubscribing wakes the consumer");
+                let result = moq_subscriber_next(sub, &mut object, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
+
+                let result = moq_subscriber_next(std::ptr::null_mut(), &mut object, None, std::ptr::null_mut());
+                assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+                moq_free_str(result.message);
+
+                moq_subscriber_destroy(sub);
+                moq_publisher_destroy(publ);
+                moq_client_destroy(subscriber_client);
+                moq_client_destroy(publisher_client);
+            }
+        }
+
+        #[test]
+        fn test_sim_arguments() {
+            let unknown = CString::new("sim://no-such-relay").unwrap();
+            let result = unsafe { moq_sim_advance(unknown.as_ptr(), 1) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message) };
+            assert_eq!(unsafe { moq_sim_now(std::ptr::null()) }, 0);
+
+            let client = moq_client_create();
+            let bad = CString::new("sim://?seed=1").unwrap();
+            let result = unsafe { moq_connect(client, bad.as_ptr(), None, std::ptr::null_mut()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe { moq_free_str(result.message) };
+            let result = unsafe { moq_sim_set_link(client, &link(0, 1.5), std::ptr::null()) };
+            assert_eq!(result.code, MoqResultCode::MoqErrorInvalidArgument);
+            unsafe {
+                moq_free_str(result.message);
+                moq_client_destroy(client);
+            }
+        }
+    }
+
     /* ───────────────────────────────────────────────
      * Integration Tests
      * ─────────────────────────────────────────────── */
@@ -1718,7 +4515,7 @@ mod tests {
 
         #[test]
         fn test_typical_workflow_in_stub() {
-            // Simulate a typical usage pattern (even though stub will fail)
+            // Simulate a typical usage pattern against a real relay URL (unsupported in stub)
             let client = moq_client_create();
             assert!(!client.is_null());
             
@@ -1737,7 +4534,7 @@ mod tests {
             // Try to announce namespace
             let namespace = std::ffi::CString::new("test").unwrap();
             let result = unsafe { moq_announce_namespace(client, namespace.as_ptr()) };
-            assert_eq!(result.code, MoqResultCode::MoqErrorUnsupported);
+            assert_eq!(result.code, MoqResultCode::MoqErrorNotConnected);
             unsafe { moq_free_str(result.message); }
             
             // Disconnect
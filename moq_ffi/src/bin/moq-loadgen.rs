@@ -0,0 +1,925 @@
+// moq-loadgen - synthetic MoQ load in one process
+//
+// Connects N publisher clients and M subscriber clients to a relay through
+// the C API, spreads T tracks over the publishers, publishes at a fixed rate
+// per track with fixed or uniformly distributed object sizes, subscribes
+// every subscriber client to every track (fan-out M), and prints a JSON
+// report with throughput, end-to-end latency percentiles, CPU time and RSS.
+//
+// With --soak the workload runs for hours instead and is sampled at fixed
+// intervals (RSS, live heap, runtime tasks, latency percentiles) to expose
+// slow memory growth and latency drift; the report adds the trend.
+//
+// Usage:
+// ```
+// cargo run --release --features with_moq_draft07 --bin moq-loadgen -- \
+//     --url https://localhost:4443 --clients 4 --tracks 100 --rate 30 \
+//     --size 200-4000 --fanout 2 --duration 30
+//
+// cargo run --release --features with_moq_draft07 --bin moq-loadgen -- \
+//     --soak --duration 14400 --sample-interval 60 --trend soak.jsonl
+// ```
+
+#[cfg(not(any(feature = "with_moq", feature = "with_moq_draft07")))]
+fn main() {
+    eprintln!("moq-loadgen requires the with_moq or with_moq_draft07 feature");
+    std::process::exit(2);
+}
+
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+fn main() {
+    let args: Vec<String> = std::env::args().skip(1).collect();
+    if args.iter().any(|a| a == "--help" || a == "-h") {
+        println!("{}", loadgen::USAGE);
+        return;
+    }
+    let config = match loadgen::Config::parse(&args) {
+        Ok(config) => config,
+        Err(e) => {
+            eprintln!("moq-loadgen: {}\n\n{}", e, loadgen::USAGE);
+            std::process::exit(2);
+        }
+    };
+    if let Err(e) = loadgen::run(&config) {
+        eprintln!("moq-loadgen: {}", e);
+        std::process::exit(1);
+    }
+}
+
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+mod loadgen {
+    use std::alloc::{GlobalAlloc, Layout, System};
+    use std::ffi::{c_void, CStr, CString};
+    use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+    use std::sync::Arc;
+    use std::thread;
+    use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+    use moq_ffi::*;
+    use serde_json::json;
+
+    pub const USAGE: &str = "\
+Usage: moq-loadgen [options]
+  --url URL          Relay URL (default https://localhost:4443)
+  --clients N        Publisher clients (default 1)
+  --tracks T         Tracks, spread over the publisher clients (default 10)
+  --rate R           Objects per second per track (default 30)
+  --size S|MIN-MAX   Object size in bytes, fixed or uniform (default 1200)
+  --fanout M         Subscriber clients, each subscribed to every track (default 1)
+  --duration SECS    Publishing time (default 10)
+  --mode MODE        stream or datagram (default stream)
+  --output PATH      Write the JSON report to PATH instead of stdout
+  --soak             Sample the run at intervals and report memory and latency trends
+  --sample-interval SECS  Soak sampling interval (default 60)
+  --trend PATH       Append each soak sample to PATH as a JSON line while running";
+
+    // Payloads start with the send time so subscribers can measure latency
+    const HEADER_LEN: usize = 8;
+    // Time given to subscriptions before publishing starts and to stragglers after
+    const SETTLE_TIME: Duration = Duration::from_secs(1);
+    // Publisher threads publish everything due, then sleep at most this long
+    const PUBLISH_TICK: Duration = Duration::from_millis(1);
+
+    #[derive(Debug, Clone)]
+    pub struct Config {
+        pub url: String,
+        pub clients: usize,
+        pub tracks: usize,
+        pub rate: f64,
+        pub size_min: usize,
+        pub size_max: usize,
+        pub fanout: usize,
+        pub duration: Duration,
+        pub mode: MoqDeliveryMode,
+        pub output: Option<String>,
+        pub soak: bool,
+        pub sample_interval: Duration,
+        pub trend: Option<String>,
+    }
+
+    impl Default for Config {
+        fn default() -> Self {
+            Config {
+                url: "https://localhost:4443".to_string(),
+                clients: 1,
+                tracks: 10,
+                rate: 30.0,
+                size_min: 1200,
+                size_max: 1200,
+                fanout: 1,
+                duration: Duration::from_secs(10),
+                mode: MoqDeliveryMode::MoqDeliveryStream,
+                output: None,
+                soak: false,
+                sample_interval: Duration::from_secs(60),
+                trend: None,
+            }
+        }
+    }
+
+    impl Config {
+        pub fn parse(args: &[String]) -> Result<Self, String> {
+            let mut config = Config::default();
+            let mut args = args.iter();
+            while let Some(flag) = args.next() {
+                if flag == "--soak" {
+                    config.soak = true;
+                    continue;
+                }
+                let value = args.next().ok_or_else(|| format!("{} needs a value", flag))?;
+                let number = |v: &str| v.parse::<usize>().map_err(|_| format!("invalid {} value: {}", flag, v));
+                match flag.as_str() {
+                    "--url" => config.url = value.clone(),
+                    "--clients" => config.clients = number(value)?,
+                    "--tracks" => config.tracks = number(value)?,
+                    "--fanout" => config.fanout = number(value)?,
+                    "--rate" => {
+                        config.rate = value.parse().map_err(|_| format!("invalid --rate value: {}", value))?
+                    }
+                    "--size" => {
+                        let (min, max) = value.split_once('-').unwrap_or((value, value));
+                        config.size_min = number(min)?;
+                        config.size_max = number(max)?;
+                    }
+                    "--duration" => config.duration = seconds(flag, value)?,
+                    "--sample-interval" => config.sample_interval = seconds(flag, value)?,
+                    "--trend" => config.trend = Some(value.clone()),
+                    "--mode" => {
+                        config.mode = match value.as_str() {
+                            "stream" => MoqDeliveryMode::MoqDeliveryStream,
+                            "datagram" => MoqDeliveryMode::MoqDeliveryDatagram,
+                            _ => return Err(format!("invalid --mode value: {}", value)),
+                        }
+                    }
+                    "--output" => config.output = Some(value.clone()),
+                    _ => return Err(format!("unknown option {}", flag)),
+                }
+            }
+
+            if config.clients == 0 || config.tracks == 0 {
+                return Err("--clients and --tracks must be at least 1".to_string());
+            }
+            if !(config.rate > 0.0 && config.rate.is_finite()) {
+                return Err("--rate must be positive".to_string());
+            }
+            if config.size_min < HEADER_LEN || config.size_max < config.size_min {
+                return Err(format!("--size must be at least {} and MIN <= MAX", HEADER_LEN));
+            }
+            if config.soak && config.sample_interval.is_zero() {
+                return Err("--sample-interval must be positive".to_string());
+            }
+            Ok(config)
+        }
+
+        fn mode_name(&self) -> &'static str {
+            match self.mode {
+                MoqDeliveryMode::MoqDeliveryDatagram => "datagram",
+                MoqDeliveryMode::MoqDeliveryStream => "stream",
+            }
+        }
+    }
+
+    fn seconds(flag: &str, value: &str) -> Result<Duration, String> {
+        value
+            .parse::<f64>()
+            .ok()
+            .and_then(|secs| Duration::try_from_secs_f64(secs).ok())
+            .ok_or_else(|| format!("invalid {} value: {}", flag, value))
+    }
+
+    /// Log-linear histogram of microsecond values with 16 sub-buckets per power of two.
+    pub struct Histogram {
+        buckets: Vec<AtomicU64>,
+    }
+
+    impl Histogram {
+        const SUB_BUCKETS: u64 = 16;
+
+        pub fn new() -> Self {
+            Histogram { buckets: (0..1024).map(|_| AtomicU64::new(0)).collect() }
+        }
+
+        fn index(value: u64) -> usize {
+            if value < Self::SUB_BUCKETS {
+                return value as usize;
+            }
+            let exponent = 63 - value.leading_zeros() as u64;
+            let sub = (value >> (exponent - 4)) & (Self::SUB_BUCKETS - 1);
+            (Self::SUB_BUCKETS + (exponent - 4) * Self::SUB_BUCKETS + sub) as usize
+        }
+
+        fn lower_bound(index: usize) -> u64 {
+            let index = index as u64;
+            if index < Self::SUB_BUCKETS {
+                return index;
+            }
+            let exponent = (index - Self::SUB_BUCKETS) / Self::SUB_BUCKETS + 4;
+            let sub = (index - Self::SUB_BUCKETS) % Self::SUB_BUCKETS;
+            (Self::SUB_BUCKETS + sub) << (exponent - 4)
+        }
+
+        pub fn record(&self, value: u64) {
+            self.buckets[Self::index(value)].fetch_add(1, Ordering::Relaxed);
+        }
+
+        pub fn count(&self) -> u64 {
+            self.buckets.iter().map(|b| b.load(Ordering::Relaxed)).sum()
+        }
+
+        /// Value at quantile `q` (0.0 - 1.0), or 0 when empty.
+        pub fn quantile(&self, q: f64) -> u64 {
+            let total = self.count();
+            if total == 0 {
+                return 0;
+            }
+            let rank = ((total as f64 * q).ceil() as u64).clamp(1, total);
+            let mut seen = 0;
+            for (i, bucket) in self.buckets.iter().enumerate() {
+                seen += bucket.load(Ordering::Relaxed);
+                if seen >= rank {
+                    return Self::lower_bound(i);
+                }
+            }
+            0
+        }
+
+        pub fn reset(&self) {
+            for bucket in &self.buckets {
+                bucket.store(0, Ordering::Relaxed);
+            }
+        }
+
+        pub fn summary(&self) -> serde_json::Value {
+            json!({
+                "count": self.count(),
+                "p50": self.quantile(0.5),
+                "p90": self.quantile(0.9),
+                "p99": self.quantile(0.99),
+                "p999": self.quantile(0.999),
+                "max": self.quantile(1.0),
+            })
+        }
+    }
+
+    /// xorshift64* for object sizes
+    struct Rng(u64);
+
+    impl Rng {
+        fn next(&mut self) -> u64 {
+            self.0 ^= self.0 >> 12;
+            self.0 ^= self.0 << 25;
+            self.0 ^= self.0 >> 27;
+            self.0.wrapping_mul(0x2545_F491_4F6C_DD1D)
+        }
+
+        fn size(&mut self, min: usize, max: usize) -> usize {
+            min + (self.next() % (max - min + 1) as u64) as usize
+        }
+    }
+
+    /// Counters shared by every subscription.
+    pub struct Receiver {
+        epoch: Instant,
+        pub objects: AtomicU64,
+        pub bytes: AtomicU64,
+        pub latency_us: Histogram,
+        // Latencies since the last soak sample
+        pub window_us: Histogram,
+    }
+
+    unsafe extern "C" fn on_data(user_data: *mut c_void, data: *const u8, len: usize) {
+        let receiver = &*(user_data as *const Receiver);
+        receiver.objects.fetch_add(1, Ordering::Relaxed);
+        receiver.bytes.fetch_add(len as u64, Ordering::Relaxed);
+        if len >= HEADER_LEN {
+            let mut sent = [0u8; HEADER_LEN];
+            sent.copy_from_slice(std::slice::from_raw_parts(data, HEADER_LEN));
+            let sent = Duration::from_nanos(u64::from_le_bytes(sent));
+            let latency = receiver.epoch.elapsed().saturating_sub(sent);
+            receiver.latency_us.record(latency.as_micros() as u64);
+            receiver.window_us.record(latency.as_micros() as u64);
+        }
+    }
+
+    /// Counters of all publisher threads.
+    #[derive(Default)]
+    pub struct Sent {
+        pub objects: AtomicU64,
+        pub bytes: AtomicU64,
+        pub errors: AtomicU64,
+    }
+
+    struct Client(*mut MoqClient);
+
+    // Safety: client handles are thread-safe; each is used by one thread at a time here
+    unsafe impl Send for Client {}
+    unsafe impl Sync for Client {}
+
+    impl Drop for Client {
+        fn drop(&mut self) {
+            unsafe {
+                let _ = free_result(moq_disconnect(self.0));
+                moq_client_destroy(self.0);
+            }
+        }
+    }
+
+    struct Publishers(Vec<*mut MoqPublisher>);
+
+    // Safety: each publisher set is owned by one publishing thread
+    unsafe impl Send for Publishers {}
+
+    fn free_result(result: MoqResult) -> Result<(), String> {
+        let message = if result.message.is_null() {
+            String::new()
+        } else {
+            let msg = unsafe { CStr::from_ptr(result.message).to_string_lossy().into_owned() };
+            unsafe { moq_free_str(result.message) };
+            msg
+        };
+        match result.code {
+            MoqResultCode::MoqOk => Ok(()),
+            code => Err(format!("{:?}: {}", code, message)),
+        }
+    }
+
+    fn connect(url: &CString) -> Result<Client, String> {
+        let client = moq_client_create();
+        if client.is_null() {
+            return Err("moq_client_create failed".to_string());
+        }
+        let client = Client(client);
+        free_result(unsafe { moq_connect(client.0, url.as_ptr(), None, std::ptr::null_mut()) })
+            .map_err(|e| format!("connect failed: {}", e))?;
+        Ok(client)
+    }
+
+    fn track_names(count: usize, offset: usize) -> Vec<CString> {
+        (offset..offset + count).map(|i| CString::new(format!("track-{}", i)).unwrap()).collect()
+    }
+
+    /// Process resource usage at one point in time.
+    #[derive(Debug, Clone, Copy, Default)]
+    pub struct Usage {
+        pub rss_bytes: Option<u64>,
+        pub cpu_user: Option<Duration>,
+        pub cpu_system: Option<Duration>,
+    }
+
+    impl Usage {
+        /// Reads /proc/self (Linux); fields are None elsewhere.
+        pub fn now() -> Self {
+            let rss_bytes = std::fs::read_to_string("/proc/self/status").ok().and_then(|status| {
+                let line = status.lines().find(|l| l.starts_with("VmRSS:"))?;
+                let kb: u64 = line.split_whitespace().nth(1)?.parse().ok()?;
+                Some(kb * 1024)
+            });
+            // utime and stime are fields 14 and 15, in clock ticks (USER_HZ = 100)
+            let times = std::fs::read_to_string("/proc/self/stat").ok().and_then(|stat| {
+                let fields: Vec<&str> = stat.rsplit_once(')')?.1.split_whitespace().collect();
+                let ticks = |i: usize| fields.get(i)?.parse::<u64>().ok().map(|t| Duration::from_millis(t * 10));
+                Some((ticks(11)?, ticks(12)?))
+            });
+            Usage {
+                rss_bytes,
+                cpu_user: times.map(|t| t.0),
+                cpu_system: times.map(|t| t.1),
+            }
+        }
+
+        pub fn cpu_total(&self) -> Option<Duration> {
+            Some(self.cpu_user? + self.cpu_system?)
+        }
+    }
+
+    /// A running workload: connected clients, publishing threads and subscriptions.
+    pub struct Workload {
+        pub started: Instant,
+        pub sent: Arc<Sent>,
+        pub receiver: Arc<Receiver>,
+        stop: Arc<AtomicBool>,
+        publishing: Vec<thread::JoinHandle<()>>,
+        subscribers: Vec<*mut MoqSubscriber>,
+        publishers: Vec<*mut MoqPublisher>,
+        subscriber_clients: Vec<Client>,
+        publisher_clients: Vec<Arc<Client>>,
+    }
+
+    impl Workload {
+        /// Connects, announces, subscribes and starts publishing.
+        pub fn start(config: &Config) -> Result<Self, String> {
+            if !moq_init() {
+                return Err("moq_init failed".to_string());
+            }
+            let url = CString::new(config.url.as_str()).map_err(|e| e.to_string())?;
+            let run_id = SystemTime::now().duration_since(UNIX_EPOCH).map(|d| d.as_nanos()).unwrap_or(0);
+            let receiver = Arc::new(Receiver {
+                epoch: Instant::now(),
+                objects: AtomicU64::new(0),
+                bytes: AtomicU64::new(0),
+                latency_us: Histogram::new(),
+                window_us: Histogram::new(),
+            });
+
+            // Publisher clients each announce a namespace holding their share of the tracks
+            let mut publisher_clients = Vec::with_capacity(config.clients);
+            let mut namespaces = Vec::with_capacity(config.clients);
+            let mut publisher_sets = Vec::with_capacity(config.clients);
+            let mut all_publishers = Vec::with_capacity(config.tracks);
+            let mut offset = 0;
+            for i in 0..config.clients {
+                let count = config.tracks / config.clients + usize::from(i < config.tracks % config.clients);
+                let client = connect(&url)?;
+                let ns = CString::new(format!("moq-loadgen/{}/{}", run_id, i)).unwrap();
+                free_result(unsafe { moq_announce_namespace(client.0, ns.as_ptr()) })
+                    .map_err(|e| format!("announce failed: {}", e))?;
+                let names = track_names(count, offset);
+                offset += count;
+                let name_ptrs: Vec<_> = names.iter().map(|n| n.as_ptr()).collect();
+                let mut publishers = vec![std::ptr::null_mut(); count];
+                free_result(unsafe {
+                    moq_create_publishers(client.0, ns.as_ptr(), name_ptrs.as_ptr(), count, config.mode, publishers.as_mut_ptr())
+                })
+                .map_err(|e| format!("publisher creation failed: {}", e))?;
+                all_publishers.extend_from_slice(&publishers);
+                publisher_sets.push(publishers);
+                namespaces.push((ns, names));
+                publisher_clients.push(Arc::new(client));
+            }
+
+            // Every subscriber client subscribes to every track
+            let mut subscriber_clients = Vec::with_capacity(config.fanout);
+            let mut subscribers = Vec::with_capacity(config.fanout * config.tracks);
+            for _ in 0..config.fanout {
+                let client = connect(&url)?;
+                for (ns, names) in &namespaces {
+                    let name_ptrs: Vec<_> = names.iter().map(|n| n.as_ptr()).collect();
+                    let user_data = vec![Arc::as_ptr(&receiver) as *mut c_void; names.len()];
+                    let mut out = vec![std::ptr::null_mut(); names.len()];
+                    free_result(unsafe {
+                        moq_subscribe_many(
+                            client.0,
+                            ns.as_ptr(),
+                            name_ptrs.as_ptr(),
+                            names.len(),
+                            Some(on_data),
+                            user_data.as_ptr(),
+                            out.as_mut_ptr(),
+                        )
+                    })
+                    .map_err(|e| format!("subscribe failed: {}", e))?;
+                    subscribers.extend(out);
+                }
+                subscriber_clients.push(client);
+            }
+            thread::sleep(SETTLE_TIME);
+
+            let sent = Arc::new(Sent::default());
+            let stop = Arc::new(AtomicBool::new(false));
+            let publishing = publisher_sets
+                .into_iter()
+                .enumerate()
+                .map(|(i, publishers)| {
+                    let (config, sent, stop, receiver) = (config.clone(), sent.clone(), stop.clone(), receiver.clone());
+                    let publishers = Publishers(publishers);
+                    thread::Builder::new()
+                        .name(format!("loadgen-pub-{}", i))
+                        .spawn(move || publish_loop(&config, publishers, i as u64 + 1, &sent, &stop, &receiver))
+                        .expect("failed to spawn publisher thread")
+                })
+                .collect();
+
+            Ok(Workload {
+                started: Instant::now(),
+                sent,
+                receiver,
+                stop,
+                publishing,
+                subscribers,
+                publishers: all_publishers,
+                subscriber_clients,
+                publisher_clients,
+            })
+        }
+
+        /// Stops publishing, lets in-flight objects arrive and tears everything down.
+        pub fn stop(mut self) -> Duration {
+            self.stop.store(true, Ordering::Relaxed);
+            for handle in self.publishing.drain(..) {
+                let _ = handle.join();
+            }
+            let publishing_time = self.started.elapsed();
+            thread::sleep(SETTLE_TIME);
+            unsafe {
+                for &subscriber in &self.subscribers {
+                    moq_subscriber_destroy(subscriber);
+                }
+                for &publisher in &self.publishers {
+                    moq_publisher_destroy(publisher);
+                }
+            }
+            self.subscriber_clients.clear();
+            self.publisher_clients.clear();
+            publishing_time
+        }
+    }
+
+    /// Publishes to `publishers` round-robin at `config.rate` objects per second per track.
+    fn publish_loop(config: &Config, publishers: Publishers, seed: u64, sent: &Sent, stop: &AtomicBool, receiver: &Receiver) {
+        let publishers = publishers.0;
+        let interval = Duration::from_secs_f64(1.0 / (config.rate * publishers.len() as f64));
+        let mut rng = Rng(seed.wrapping_mul(0x9E37_79B9_7F4A_7C15) | 1);
+        let mut payload = vec![0xA5u8; config.size_max];
+        let start = Instant::now();
+        let mut published: u64 = 0;
+
+        while !stop.load(Ordering::Relaxed) {
+            // Publish everything that is due, then wait for the next tick
+            let due = (start.elapsed().as_secs_f64() / interval.as_secs_f64()) as u64;
+            while published < due && !stop.load(Ordering::Relaxed) {
+                let publisher = publishers[(published % publishers.len() as u64) as usize];
+                let len = rng.size(config.size_min, config.size_max);
+                let now = receiver.epoch.elapsed().as_nanos() as u64;
+                payload[..HEADER_LEN].copy_from_slice(&now.to_le_bytes());
+                let result = unsafe { moq_publish_data(publisher, payload.as_ptr(), len, config.mode) };
+                match free_result(result) {
+                    Ok(()) => {
+                        sent.objects.fetch_add(1, Ordering::Relaxed);
+                        sent.bytes.fetch_add(len as u64, Ordering::Relaxed);
+                    }
+                    Err(_) => {
+                        sent.errors.fetch_add(1, Ordering::Relaxed);
+                    }
+                }
+                published += 1;
+            }
+            let next = start + interval.mul_f64((published + 1) as f64);
+            thread::sleep(next.saturating_duration_since(Instant::now()).min(PUBLISH_TICK));
+        }
+    }
+
+    /// Global allocator that counts live heap bytes, for leak and fragmentation tracking.
+    ///
+    /// Covers every Rust allocation in the process, including the library's.
+    struct CountingAllocator;
+
+    static LIVE_BYTES: AtomicU64 = AtomicU64::new(0);
+    static LIVE_ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+    static TOTAL_ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+
+    unsafe impl GlobalAlloc for CountingAllocator {
+        unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+            let ptr = System.alloc(layout);
+            if !ptr.is_null() {
+                LIVE_BYTES.fetch_add(layout.size() as u64, Ordering::Relaxed);
+                LIVE_ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+                TOTAL_ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+            }
+            ptr
+        }
+
+        unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+            let ptr = System.alloc_zeroed(layout);
+            if !ptr.is_null() {
+                LIVE_BYTES.fetch_add(layout.size() as u64, Ordering::Relaxed);
+                LIVE_ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+                TOTAL_ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+            }
+            ptr
+        }
+
+        unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+            System.dealloc(ptr, layout);
+            LIVE_BYTES.fetch_sub(layout.size() as u64, Ordering::Relaxed);
+            LIVE_ALLOCATIONS.fetch_sub(1, Ordering::Relaxed);
+        }
+
+        unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+            let new_ptr = System.realloc(ptr, layout, new_size);
+            if !new_ptr.is_null() {
+                LIVE_BYTES.fetch_add(new_size as u64, Ordering::Relaxed);
+                LIVE_BYTES.fetch_sub(layout.size() as u64, Ordering::Relaxed);
+            }
+            new_ptr
+        }
+    }
+
+    #[global_allocator]
+    static ALLOCATOR: CountingAllocator = CountingAllocator;
+
+    fn secs(d: Option<Duration>) -> serde_json::Value {
+        d.map_or(serde_json::Value::Null, |d| json!(d.as_secs_f64()))
+    }
+
+    fn write_report(config: &Config, report: &serde_json::Value) -> Result<(), String> {
+        let text = serde_json::to_string_pretty(report).map_err(|e| e.to_string())?;
+        match &config.output {
+            Some(path) => std::fs::write(path, text + "\n").map_err(|e| format!("cannot write {}: {}", path, e)),
+            None => {
+                println!("{}", text);
+                Ok(())
+            }
+        }
+    }
+
+    pub fn config_json(config: &Config) -> serde_json::Value {
+        json!({
+            "url": config.url,
+            "clients": config.clients,
+            "tracks": config.tracks,
+            "rate_per_track": config.rate,
+            "size_min": config.size_min,
+            "size_max": config.size_max,
+            "fanout": config.fanout,
+            "duration_s": config.duration.as_secs_f64(),
+            "mode": config.mode_name(),
+            "soak": config.soak,
+            "sample_interval_s": config.sample_interval.as_secs_f64(),
+        })
+    }
+
+    pub fn run(config: &Config) -> Result<(), String> {
+        if config.soak {
+            return soak::run(config);
+        }
+        let usage_start = Usage::now();
+        let workload = Workload::start(config)?;
+        let usage_setup = Usage::now();
+
+        // Sample RSS while publishing to report the peak
+        let mut rss_peak = usage_setup.rss_bytes;
+        while workload.started.elapsed() < config.duration {
+            thread::sleep(Duration::from_millis(250).min(config.duration.saturating_sub(workload.started.elapsed())));
+            rss_peak = rss_peak.max(Usage::now().rss_bytes);
+        }
+        let usage_end = Usage::now();
+        let (sent, receiver) = (workload.sent.clone(), workload.receiver.clone());
+        let elapsed = workload.stop();
+
+        let sent_objects = sent.objects.load(Ordering::Relaxed);
+        let received_objects = receiver.objects.load(Ordering::Relaxed);
+        let received_bytes = receiver.bytes.load(Ordering::Relaxed);
+        let expected = sent_objects * config.fanout as u64;
+        let seconds = elapsed.as_secs_f64();
+        let cpu = usage_setup.cpu_total().zip(usage_end.cpu_total()).map(|(a, b)| b.saturating_sub(a));
+
+        let report = json!({
+            "config": config_json(config),
+            "elapsed_s": seconds,
+            "published": {
+                "objects": sent_objects,
+                "bytes": sent.bytes.load(Ordering::Relaxed),
+                "errors": sent.errors.load(Ordering::Relaxed),
+                "objects_per_s": sent_objects as f64 / seconds,
+            },
+            "received": {
+                "objects": received_objects,
+                "bytes": received_bytes,
+                "expected_objects": expected,
+                "delivery_ratio": if expected > 0 { received_objects as f64 / expected as f64 } else { 0.0 },
+                "objects_per_s": received_objects as f64 / seconds,
+                "mbit_per_s": received_bytes as f64 * 8.0 / seconds / 1e6,
+            },
+            "latency_us": receiver.latency_us.summary(),
+            "cpu": {
+                "setup_s": secs(usage_start.cpu_total().zip(usage_setup.cpu_total()).map(|(a, b)| b.saturating_sub(a))),
+                "user_s": secs(usage_setup.cpu_user.zip(usage_end.cpu_user).map(|(a, b)| b.saturating_sub(a))),
+                "system_s": secs(usage_setup.cpu_system.zip(usage_end.cpu_system).map(|(a, b)| b.saturating_sub(a))),
+                "cores_used": cpu.map(|c| c.as_secs_f64() / seconds),
+            },
+            "rss_bytes": {
+                "start": usage_start.rss_bytes,
+                "after_setup": usage_setup.rss_bytes,
+                "peak": rss_peak,
+                "end": usage_end.rss_bytes,
+            },
+        });
+        write_report(config, &report)
+    }
+
+    /// Long-running mode: samples the workload at intervals and reports trends.
+    mod soak {
+        use super::*;
+        use std::io::Write;
+
+        /// Least-squares slope of `points` (x, y), or None with fewer than two distinct x.
+        pub fn slope(points: &[(f64, f64)]) -> Option<f64> {
+            let n = points.len() as f64;
+            let mean_x = points.iter().map(|p| p.0).sum::<f64>() / n;
+            let mean_y = points.iter().map(|p| p.1).sum::<f64>() / n;
+            let var: f64 = points.iter().map(|p| (p.0 - mean_x).powi(2)).sum();
+            if points.len() < 2 || var == 0.0 {
+                return None;
+            }
+            let cov: f64 = points.iter().map(|p| (p.0 - mean_x) * (p.1 - mean_y)).sum();
+            Some(cov / var)
+        }
+
+        /// One observation of the running workload.
+        struct Sample {
+            elapsed_s: f64,
+            rss_bytes: Option<u64>,
+            heap_live_bytes: u64,
+            received_objects: u64,
+            p99_us: u64,
+            alive_tasks: usize,
+            json: serde_json::Value,
+        }
+
+        struct Previous {
+            at: Instant,
+            usage: Usage,
+            published: u64,
+            received: u64,
+        }
+
+        fn take_sample(workload: &Workload, previous: &mut Previous) -> Sample {
+            let now = Instant::now();
+            let usage = Usage::now();
+            let interval = (now - previous.at).as_secs_f64();
+            let published = workload.sent.objects.load(Ordering::Relaxed);
+            let received = workload.receiver.objects.load(Ordering::Relaxed);
+            let heap_live_bytes = LIVE_BYTES.load(Ordering::Relaxed);
+            let mut runtime = MoqRuntimeStats::default();
+            unsafe { moq_get_runtime_stats(&mut runtime) };
+
+            // Latencies of this interval only, so drift is not averaged away
+            let latency = workload.receiver.window_us.summary();
+            let p99_us = workload.receiver.window_us.quantile(0.99);
+            workload.receiver.window_us.reset();
+
+            let cpu = previous.usage.cpu_total().zip(usage.cpu_total()).map(|(a, b)| b.saturating_sub(a));
+            let json = json!({
+                "elapsed_s": workload.started.elapsed().as_secs_f64(),
+                "rss_bytes": usage.rss_bytes,
+                "heap": {
+                    "live_bytes": heap_live_bytes,
+                    "live_allocations": LIVE_ALLOCATIONS.load(Ordering::Relaxed),
+                    "total_allocations": TOTAL_ALLOCATIONS.load(Ordering::Relaxed),
+                    // Resident memory not backing live allocations: allocator caches and fragmentation
+                    "rss_overhead_bytes": usage.rss_bytes.map(|rss| rss as i64 - heap_live_bytes as i64),
+                },
+                "runtime": {
+                    "alive_tasks": runtime.alive_tasks,
+                    "global_queue_depth": runtime.global_queue_depth,
+                },
+                "published_objects": published,
+                "received_objects": received,
+                "publish_objects_per_s": (published - previous.published) as f64 / interval,
+                "receive_objects_per_s": (received - previous.received) as f64 / interval,
+                "cores_used": cpu.map(|c| c.as_secs_f64() / interval),
+                "latency_us": latency,
+            });
+            *previous = Previous { at: now, usage, published, received };
+            Sample {
+                elapsed_s: workload.started.elapsed().as_secs_f64(),
+                rss_bytes: usage.rss_bytes,
+                heap_live_bytes,
+                received_objects: received,
+                p99_us,
+                alive_tasks: runtime.alive_tasks,
+                json,
+            }
+        }
+
+        /// Growth rates over the run; the first sample is skipped as warm-up.
+        fn trend(samples: &[Sample]) -> serde_json::Value {
+            let steady = if samples.len() > 2 { &samples[1..] } else { samples };
+            let per_hour = |f: &dyn Fn(&Sample) -> Option<f64>| {
+                let points: Vec<(f64, f64)> = steady.iter().filter_map(|s| Some((s.elapsed_s, f(s)?))).collect();
+                slope(&points).map(|per_s| per_s * 3600.0)
+            };
+            let heap_per_hour = per_hour(&|s| Some(s.heap_live_bytes as f64));
+            let objects_per_hour = per_hour(&|s| Some(s.received_objects as f64));
+            let (first, last) = (steady.first(), steady.last());
+            json!({
+                "rss_growth_bytes_per_hour": per_hour(&|s| s.rss_bytes.map(|b| b as f64)),
+                "heap_growth_bytes_per_hour": heap_per_hour,
+                // Heap growth attributed to each received object; near zero without a leak
+                "heap_growth_bytes_per_object": heap_per_hour
+                    .zip(objects_per_hour)
+                    .and_then(|(heap, objects)| (objects > 0.0).then(|| heap / objects)),
+                "alive_tasks_growth_per_hour": per_hour(&|s| Some(s.alive_tasks as f64)),
+                "p99_latency_us_first": first.map(|s| s.p99_us),
+                "p99_latency_us_last": last.map(|s| s.p99_us),
+                "p99_latency_drift_us_per_hour": per_hour(&|s| Some(s.p99_us as f64)),
+            })
+        }
+
+        pub fn run(config: &Config) -> Result<(), String> {
+            let mut trend_file = match &config.trend {
+                Some(path) => Some(
+                    std::fs::OpenOptions::new()
+                        .create(true)
+                        .append(true)
+                        .open(path)
+                        .map_err(|e| format!("cannot open {}: {}", path, e))?,
+                ),
+                None => None,
+            };
+
+            let workload = Workload::start(config)?;
+            let mut previous = Previous {
+                at: workload.started,
+                usage: Usage::now(),
+                published: 0,
+                received: 0,
+            };
+            let mut samples = Vec::new();
+            let end = workload.started + config.duration;
+            let mut next = workload.started + config.sample_interval;
+            while Instant::now() < end {
+                thread::sleep(next.min(end).saturating_duration_since(Instant::now()));
+                next += config.sample_interval;
+
+                let sample = take_sample(&workload, &mut previous);
+                if let Some(file) = trend_file.as_mut() {
+                    // One line per sample, flushed so an aborted run keeps its data
+                    writeln!(file, "{}", sample.json)
+                        .and_then(|_| file.flush())
+                        .map_err(|e| format!("cannot write trend: {}", e))?;
+                }
+                samples.push(sample);
+            }
+            let (sent, receiver) = (workload.sent.clone(), workload.receiver.clone());
+            let elapsed = workload.stop();
+
+            let sent_objects = sent.objects.load(Ordering::Relaxed);
+            let received_objects = receiver.objects.load(Ordering::Relaxed);
+            let expected = sent_objects * config.fanout as u64;
+            let report = json!({
+                "config": config_json(config),
+                "elapsed_s": elapsed.as_secs_f64(),
+                "published_objects": sent_objects,
+                "publish_errors": sent.errors.load(Ordering::Relaxed),
+                "received_objects": received_objects,
+                "delivery_ratio": if expected > 0 { received_objects as f64 / expected as f64 } else { 0.0 },
+                "latency_us": receiver.latency_us.summary(),
+                "trend": trend(&samples),
+                "samples": samples.iter().map(|s| s.json.clone()).collect::<Vec<_>>(),
+            });
+            write_report(config, &report)
+        }
+    }
+
+    #[cfg(test)]
+    mod tests {
+        use super::*;
+
+        fn args(list: &[&str]) -> Vec<String> {
+            list.iter().map(|s| s.to_string()).collect()
+        }
+
+        #[test]
+        fn test_parse_options() {
+            let config = Config::parse(&args(&[
+                "--clients", "4", "--tracks", "100", "--rate", "60", "--size", "200-4000",
+                "--fanout", "3", "--duration", "2.5", "--mode", "datagram",
+            ]))
+            .unwrap();
+            assert_eq!((config.clients, config.tracks, config.fanout), (4, 100, 3));
+            assert_eq!((config.size_min, config.size_max), (200, 4000));
+            assert_eq!(config.duration, Duration::from_millis(2500));
+            assert_eq!(config.mode, MoqDeliveryMode::MoqDeliveryDatagram);
+
+            assert!(Config::parse(&args(&["--size", "4"])).is_err());
+            assert!(Config::parse(&args(&["--size", "500-100"])).is_err());
+            assert!(Config::parse(&args(&["--tracks", "0"])).is_err());
+            assert!(Config::parse(&args(&["--rate"])).is_err());
+            assert!(Config::parse(&args(&["--bogus", "1"])).is_err());
+
+            let config = Config::parse(&args(&["--soak", "--duration", "3600", "--sample-interval", "30"])).unwrap();
+            assert!(config.soak);
+            assert_eq!(config.sample_interval, Duration::from_secs(30));
+            assert!(Config::parse(&args(&["--soak", "--sample-interval", "0"])).is_err());
+        }
+
+        #[test]
+        fn test_trend_slope() {
+            let points: Vec<(f64, f64)> = (0..10).map(|i| (i as f64 * 60.0, 1000.0 + i as f64 * 120.0)).collect();
+            assert!((soak::slope(&points).unwrap() - 2.0).abs() < 1e-9);
+            assert_eq!(soak::slope(&points[..1]), None);
+            assert_eq!(soak::slope(&[(5.0, 1.0), (5.0, 2.0)]), None);
+        }
+
+        #[test]
+        fn test_histogram_quantiles() {
+            let histogram = Histogram::new();
+            for value in 1..=1000u64 {
+                histogram.record(value);
+            }
+            assert_eq!(histogram.count(), 1000);
+            // Buckets are within 1/16 of the value
+            let p50 = histogram.quantile(0.5) as f64;
+            assert!((470.0..=500.0).contains(&p50), "p50 {}", p50);
+            let max = histogram.quantile(1.0) as f64;
+            assert!((940.0..=1000.0).contains(&max), "max {}", max);
+            assert_eq!(histogram.quantile(0.001), 1);
+
+            for value in [0u64, 15, 16, 17, 1 << 20, u64::MAX] {
+                let bound = Histogram::lower_bound(Histogram::index(value));
+                assert!(bound <= value && value - bound <= value / 16, "{} -> {}", value, bound);
+            }
+        }
+    }
+}
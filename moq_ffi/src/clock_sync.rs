@@ -0,0 +1,158 @@
+// Publisher clock offset for one-way latency
+//
+// Capture timestamps are taken on the publisher's wall clock and arrival
+// times on the subscriber's, so their difference is a latency only once the
+// offset between the two clocks is known. Subscribers estimate it as NTP
+// does: they subscribe to a throwaway clock track in the publisher's
+// namespace at t1, the publisher answers with the times it received the
+// request (t2) and sent the response (t3), and the response arrives at t4.
+// Assuming the path is equally long both ways, the publisher clock is ahead
+// by ((t2 - t1) + (t3 - t4)) / 2. Of the recent exchanges, the one with the
+// shortest round trip had the least queuing to skew it, so its offset wins.
+
+use std::collections::hash_map::RandomState;
+use std::collections::VecDeque;
+use std::hash::{BuildHasher, Hasher};
+use std::sync::atomic::{AtomicU64, Ordering};
+
+/// Prefix of the track names clock requests subscribe to; the rest is a nonce.
+pub const TRACK_PREFIX: &str = ".moq-ffi-clock/";
+
+/// Request receive time and response send time, both little-endian u64.
+pub const RESPONSE_LEN: usize = 16;
+
+/// Exchanges the estimate is taken from.
+pub const WINDOW: usize = 8;
+
+/// Microseconds since the Unix epoch on this host's wall clock.
+pub fn wallclock_us() -> u64 {
+    std::time::SystemTime::now()
+        .duration_since(std::time::UNIX_EPOCH)
+        .map(|d| d.as_micros() as u64)
+        .unwrap_or(0)
+}
+
+/// A clock track name not used before, so the relay forwards every request
+/// to the publisher instead of answering from its cache.
+pub fn request_track() -> String {
+    static COUNTER: AtomicU64 = AtomicU64::new(0);
+    let mut hasher = RandomState::new().build_hasher();
+    hasher.write_u64(COUNTER.fetch_add(1, Ordering::Relaxed));
+    format!("{}{:016x}", TRACK_PREFIX, hasher.finish())
+}
+
+pub fn is_request(track_name: &str) -> bool {
+    track_name.starts_with(TRACK_PREFIX)
+}
+
+pub fn encode_response(received_us: u64, sent_us: u64) -> [u8; RESPONSE_LEN] {
+    let mut payload = [0u8; RESPONSE_LEN];
+    payload[..8].copy_from_slice(&received_us.to_le_bytes());
+    payload[8..].copy_from_slice(&sent_us.to_le_bytes());
+    payload
+}
+
+/// Returns (received_us, sent_us), or None for anything that is not a response.
+pub fn decode_response(payload: &[u8]) -> Option<(u64, u64)> {
+    if payload.len() != RESPONSE_LEN {
+        return None;
+    }
+    let received_us = u64::from_le_bytes(payload[..8].try_into().ok()?);
+    let sent_us = u64::from_le_bytes(payload[8..].try_into().ok()?);
+    Some((received_us, sent_us))
+}
+
+/// Outcome of one exchange, in microseconds.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct Sample {
+    /// Publisher clock minus subscriber clock
+    pub offset_us: i64,
+    /// Round trip, less the time the publisher held the request
+    pub delay_us: u64,
+}
+
+impl Sample {
+    /// t1 and t4 are read on the subscriber's clock, t2 and t3 on the publisher's.
+    pub fn new(t1: u64, t2: u64, t3: u64, t4: u64) -> Self {
+        let (t1, t2, t3, t4) = (t1 as i64, t2 as i64, t3 as i64, t4 as i64);
+        Sample {
+            offset_us: ((t2 - t1) + (t3 - t4)) / 2,
+            delay_us: ((t4 - t1) - (t3 - t2)).max(0) as u64,
+        }
+    }
+}
+
+/// Clock offset from the most recent exchanges.
+#[derive(Default)]
+pub struct Estimator {
+    samples: VecDeque<Sample>,
+}
+
+impl Estimator {
+    pub fn add(&mut self, sample: Sample) {
+        if self.samples.len() == WINDOW {
+            self.samples.pop_front();
+        }
+        self.samples.push_back(sample);
+    }
+
+    /// Offset of the exchange with the shortest round trip, or None before the first.
+    pub fn offset_us(&self) -> Option<i64> {
+        self.samples.iter().min_by_key(|s| s.delay_us).map(|s| s.offset_us)
+    }
+}
+
+/// Capture-to-arrival time of an object, with the capture time on the
+/// publisher's clock and the arrival time on the subscriber's.
+pub fn one_way_latency_us(capture_us: u64, arrival_us: u64, offset_us: i64) -> u64 {
+    (arrival_us as i64 + offset_us).saturating_sub(capture_us as i64).max(0) as u64
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_sample_recovers_offset_on_symmetric_path() {
+        // Publisher clock 5 s ahead, 20 ms each way, 1 ms to answer
+        let offset = 5_000_000;
+        let t1 = 1_000_000;
+        let t2 = t1 + 20_000 + offset;
+        let t3 = t2 + 1_000;
+        let t4 = t3 - offset + 20_000;
+        assert_eq!(Sample::new(t1, t2, t3, t4), Sample { offset_us: 5_000_000, delay_us: 40_000 });
+    }
+
+    #[test]
+    fn test_estimator_prefers_shortest_round_trip() {
+        let mut estimator = Estimator::default();
+        assert_eq!(estimator.offset_us(), None);
+        estimator.add(Sample { offset_us: -300, delay_us: 9_000 });
+        estimator.add(Sample { offset_us: 120, delay_us: 2_000 });
+        estimator.add(Sample { offset_us: 900, delay_us: 15_000 });
+        assert_eq!(estimator.offset_us(), Some(120));
+
+        // The best sample ages out of the window
+        for _ in 0..WINDOW - 1 {
+            estimator.add(Sample { offset_us: 50, delay_us: 3_000 });
+        }
+        assert_eq!(estimator.offset_us(), Some(50));
+    }
+
+    #[test]
+    fn test_one_way_latency_applies_offset() {
+        // Captured at 10.000 s publisher time, arrived at 7.030 s subscriber time, publisher 3 s ahead
+        assert_eq!(one_way_latency_us(10_000_000, 7_030_000, 3_000_000), 30_000);
+        // An offset estimate a little off must not wrap around
+        assert_eq!(one_way_latency_us(10_000_000, 7_000_000, 2_999_000), 0);
+    }
+
+    #[test]
+    fn test_response_round_trip() {
+        let payload = encode_response(11, 22);
+        assert_eq!(decode_response(&payload), Some((11, 22)));
+        assert_eq!(decode_response(&payload[1..]), None);
+        assert!(is_request(&request_track()));
+        assert_ne!(request_track(), request_track());
+    }
+}
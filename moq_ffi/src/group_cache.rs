@@ -0,0 +1,346 @@
+// Bounded cache of the most recent groups of a subscribed track
+//
+// Objects are kept in memory up to a byte budget. Beyond that the oldest
+// in-memory objects spill into an optional overflow file that is memory-mapped
+// and used as a ring buffer. Whole groups are evicted, oldest first, when the
+// cache holds more groups than allowed, when a group is older than the maximum
+// age, or when neither memory nor the overflow ring has room left.
+
+use std::collections::VecDeque;
+use std::fs::OpenOptions;
+use std::io;
+use std::path::Path;
+use std::time::{Duration, Instant};
+
+use memmap2::MmapMut;
+
+/// Bounds of a group cache. Zero disables the group and age limits.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct CacheLimits {
+    pub max_groups: usize,
+    pub max_age: Duration,
+    pub memory_bytes: usize,
+}
+
+enum Payload {
+    Memory(Vec<u8>),
+    Overflow { offset: usize, len: usize },
+}
+
+struct CachedObject {
+    object_id: u64,
+    payload: Payload,
+}
+
+struct CachedGroup {
+    group_id: u64,
+    first_arrival: Instant,
+    objects: Vec<CachedObject>,
+}
+
+/// A memory-mapped file used as a ring buffer for spilled payloads.
+///
+/// Payloads are spilled and freed in the same (oldest first) order, so the
+/// live region always runs from the oldest spill to the write position.
+struct OverflowRing {
+    map: MmapMut,
+    head: usize,
+    // (offset, len) of live spills, oldest first
+    live: VecDeque<(usize, usize)>,
+}
+
+impl OverflowRing {
+    fn create(path: &Path, capacity: usize) -> io::Result<Self> {
+        let file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(true)
+            .open(path)?;
+        file.set_len(capacity as u64)?;
+        let map = unsafe { MmapMut::map_mut(&file)? };
+        Ok(OverflowRing { map, head: 0, live: VecDeque::new() })
+    }
+
+    /// Finds room for `len` bytes, or None if the ring is too full.
+    fn allocate(&self, len: usize) -> Option<usize> {
+        let capacity = self.map.len();
+        match self.live.front() {
+            None if len <= capacity => Some(0),
+            None => None,
+            // Live region [tail, head): free space after head, then before tail
+            Some(&(tail, _)) if self.head > tail => {
+                if capacity - self.head >= len {
+                    Some(self.head)
+                } else if tail >= len {
+                    Some(0)
+                } else {
+                    None
+                }
+            }
+            // Wrapped: free space is [head, tail)
+            Some(&(tail, _)) => (tail - self.head >= len).then_some(self.head),
+        }
+    }
+
+    fn write(&mut self, payload: &[u8]) -> Option<usize> {
+        let offset = self.allocate(payload.len())?;
+        self.map[offset..offset + payload.len()].copy_from_slice(payload);
+        self.head = offset + payload.len();
+        self.live.push_back((offset, payload.len()));
+        Some(offset)
+    }
+
+    fn free(&mut self, offset: usize) {
+        if self.live.front().map(|&(o, _)| o) == Some(offset) {
+            self.live.pop_front();
+        } else if let Some(i) = self.live.iter().position(|&(o, _)| o == offset) {
+            self.live.remove(i);
+        }
+        if self.live.is_empty() {
+            self.head = 0;
+        }
+    }
+
+    fn read(&self, offset: usize, len: usize) -> &[u8] {
+        &self.map[offset..offset + len]
+    }
+}
+
+/// The most recent groups of a track, in arrival order.
+pub struct GroupCache {
+    limits: CacheLimits,
+    groups: VecDeque<CachedGroup>,
+    memory_used: usize,
+    overflow: Option<OverflowRing>,
+}
+
+impl GroupCache {
+    /// Creates a cache, with an overflow file of the given path and size if any.
+    pub fn new(limits: CacheLimits, overflow: Option<(&Path, usize)>) -> io::Result<Self> {
+        let overflow = match overflow {
+            Some((path, capacity)) => Some(OverflowRing::create(path, capacity)?),
+            None => None,
+        };
+        Ok(GroupCache {
+            limits,
+            groups: VecDeque::new(),
+            memory_used: 0,
+            overflow,
+        })
+    }
+
+    /// Adds an object received at `now`, evicting whatever no longer fits.
+    pub fn insert(&mut self, group_id: u64, object_id: u64, payload: Vec<u8>, now: Instant) {
+        self.memory_used += payload.len();
+        let object = CachedObject { object_id, payload: Payload::Memory(payload) };
+        match self.groups.iter_mut().rev().find(|g| g.group_id == group_id) {
+            Some(group) => group.objects.push(object),
+            None => self.groups.push_back(CachedGroup {
+                group_id,
+                first_arrival: now,
+                objects: vec![object],
+            }),
+        }
+
+        while self.limits.max_groups > 0 && self.groups.len() > self.limits.max_groups {
+            self.evict_oldest();
+        }
+        if !self.limits.max_age.is_zero() {
+            while self.groups.len() > 1
+                && now.saturating_duration_since(self.groups[0].first_arrival) > self.limits.max_age
+            {
+                self.evict_oldest();
+            }
+        }
+        self.enforce_memory_budget();
+    }
+
+    /// Spills the oldest in-memory objects, then evicts groups, until memory fits the budget.
+    fn enforce_memory_budget(&mut self) {
+        while self.memory_used > self.limits.memory_bytes {
+            if self.spill_oldest() {
+                continue;
+            }
+            // Keep at least the group being received
+            if self.groups.len() <= 1 {
+                break;
+            }
+            self.evict_oldest();
+        }
+    }
+
+    /// Moves the oldest in-memory payload to the overflow ring, evicting old groups for room.
+    fn spill_oldest(&mut self) -> bool {
+        let Some(overflow) = self.overflow.as_mut() else { return false };
+        let position = self.groups.iter().enumerate().find_map(|(g, group)| {
+            group
+                .objects
+                .iter()
+                .position(|o| matches!(&o.payload, Payload::Memory(data) if !data.is_empty()))
+                .map(|o| (g, o))
+        });
+        let Some((g, o)) = position else { return false };
+
+        let Payload::Memory(data) = &self.groups[g].objects[o].payload else { unreachable!() };
+        let offset = match overflow.write(data) {
+            Some(offset) => offset,
+            // Ring full: only evicting groups older than this one can make room
+            None => return g > 0 && { self.evict_oldest(); true },
+        };
+        let len = data.len();
+        self.groups[g].objects[o].payload = Payload::Overflow { offset, len };
+        self.memory_used -= len;
+        true
+    }
+
+    fn evict_oldest(&mut self) {
+        let Some(group) = self.groups.pop_front() else { return };
+        for object in group.objects {
+            match object.payload {
+                Payload::Memory(data) => self.memory_used -= data.len(),
+                Payload::Overflow { offset, .. } => {
+                    if let Some(overflow) = self.overflow.as_mut() {
+                        overflow.free(offset);
+                    }
+                }
+            }
+        }
+    }
+
+    /// Oldest and newest cached group IDs.
+    pub fn group_range(&self) -> Option<(u64, u64)> {
+        let first = self.groups.iter().map(|g| g.group_id).min()?;
+        let last = self.groups.iter().map(|g| g.group_id).max()?;
+        Some((first, last))
+    }
+
+    /// Visits the cached objects of groups `first..=last` in arrival order.
+    pub fn read_range(&self, first: u64, last: u64, mut visit: impl FnMut(u64, u64, &[u8])) {
+        for group in self.groups.iter().filter(|g| (first..=last).contains(&g.group_id)) {
+            for object in &group.objects {
+                let data = match &object.payload {
+                    Payload::Memory(data) => data.as_slice(),
+                    Payload::Overflow { offset, len } => match self.overflow.as_ref() {
+                        Some(overflow) => overflow.read(*offset, *len),
+                        None => continue,
+                    },
+                };
+                visit(group.group_id, object.object_id, data);
+            }
+        }
+    }
+
+    #[cfg(test)]
+    fn memory_used(&self) -> usize {
+        self.memory_used
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn limits(max_groups: usize, max_age_ms: u64, memory_bytes: usize) -> CacheLimits {
+        CacheLimits {
+            max_groups,
+            max_age: Duration::from_millis(max_age_ms),
+            memory_bytes,
+        }
+    }
+
+    fn collect(cache: &GroupCache, first: u64, last: u64) -> Vec<(u64, u64, Vec<u8>)> {
+        let mut out = Vec::new();
+        cache.read_range(first, last, |g, o, data| out.push((g, o, data.to_vec())));
+        out
+    }
+
+    fn overflow_path(name: &str) -> std::path::PathBuf {
+        std::env::temp_dir().join(format!("moq_ffi_{}_{}", name, std::process::id()))
+    }
+
+    #[test]
+    fn test_keeps_last_groups() {
+        let mut cache = GroupCache::new(limits(3, 0, 1 << 20), None).unwrap();
+        let now = Instant::now();
+        for g in 0..5u64 {
+            for o in 0..2u64 {
+                cache.insert(g, o, vec![g as u8, o as u8], now);
+            }
+        }
+        assert_eq!(cache.group_range(), Some((2, 4)));
+        let objects = collect(&cache, 0, 3);
+        assert_eq!(objects, vec![(2, 0, vec![2, 0]), (2, 1, vec![2, 1]), (3, 0, vec![3, 0]), (3, 1, vec![3, 1])]);
+    }
+
+    #[test]
+    fn test_evicts_groups_older_than_max_age() {
+        let mut cache = GroupCache::new(limits(0, 1000, 1 << 20), None).unwrap();
+        let start = Instant::now();
+        for g in 0..10u64 {
+            cache.insert(g, 0, vec![0; 4], start + Duration::from_millis(g * 300));
+        }
+        // Group 9 arrived at 2.7s; groups from 1.7s onward (6..=9) are within one second
+        assert_eq!(cache.group_range(), Some((6, 9)));
+    }
+
+    #[test]
+    fn test_memory_budget_without_overflow_evicts() {
+        let mut cache = GroupCache::new(limits(0, 0, 100), None).unwrap();
+        let now = Instant::now();
+        for g in 0..10u64 {
+            cache.insert(g, 0, vec![0; 40], now);
+        }
+        assert_eq!(cache.group_range(), Some((8, 9)));
+        assert_eq!(cache.memory_used(), 80);
+    }
+
+    #[test]
+    fn test_spills_to_overflow_and_reads_back() {
+        let path = overflow_path("cache_spill");
+        let mut cache = GroupCache::new(limits(0, 0, 100), Some((&path, 1000))).unwrap();
+        let now = Instant::now();
+        for g in 0..10u64 {
+            cache.insert(g, 0, vec![g as u8; 40], now);
+        }
+        // 400 bytes total: at most 100 in memory, the rest spilled
+        assert!(cache.memory_used() <= 100);
+        assert_eq!(cache.group_range(), Some((0, 9)));
+        let objects = collect(&cache, 0, 9);
+        assert_eq!(objects.len(), 10);
+        for (g, object) in objects.iter().enumerate() {
+            assert_eq!(object.2, vec![g as u8; 40]);
+        }
+        drop(cache);
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[test]
+    fn test_overflow_ring_wraps_and_evicts_when_full() {
+        let path = overflow_path("cache_ring");
+        let mut cache = GroupCache::new(limits(0, 0, 0), Some((&path, 100))).unwrap();
+        let now = Instant::now();
+        for g in 0..20u64 {
+            cache.insert(g, 0, vec![g as u8; 30], now);
+        }
+        // The ring holds three 30-byte payloads at a time
+        let objects = collect(&cache, 0, u64::MAX);
+        assert_eq!(objects.iter().map(|o| o.0).collect::<Vec<_>>(), vec![17, 18, 19]);
+        for object in &objects {
+            assert_eq!(object.2, vec![object.0 as u8; 30]);
+        }
+        assert_eq!(cache.memory_used(), 0);
+        drop(cache);
+        std::fs::remove_file(&path).unwrap();
+    }
+
+    #[test]
+    fn test_oversized_object_stays_in_memory() {
+        let path = overflow_path("cache_oversized");
+        let mut cache = GroupCache::new(limits(0, 0, 10), Some((&path, 50))).unwrap();
+        cache.insert(0, 0, vec![1; 80], Instant::now());
+        assert_eq!(collect(&cache, 0, 0).len(), 1);
+        drop(cache);
+        std::fs::remove_file(&path).unwrap();
+    }
+}
@@ -0,0 +1,174 @@
+// Relay-path latency probe shared by both backends
+//
+// A probing client publishes a tiny object on a reserved track of its own
+// every interval and subscribes to that same track through the relay. Each
+// probe carries its sequence number and send time, so when the relay hands
+// it back the client knows how long publish -> relay -> subscribe took: the
+// network round trip plus whatever the relay spends queuing and forwarding,
+// which QUIC's RTT estimate does not see. Sender and receiver are the same
+// process, so one monotonic clock timestamps both ends.
+
+use std::collections::hash_map::RandomState;
+use std::ffi::c_void;
+use std::hash::{BuildHasher, Hasher};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Mutex, MutexGuard};
+
+/// Prefix of the per-client namespaces probes travel on.
+pub const NAMESPACE_PREFIX: &str = "moq-ffi/latency-probe";
+
+/// Track name of the probes within the client's namespace.
+pub const TRACK: &str = "echo";
+
+/// Sequence number and send time, both little-endian u64.
+pub const PAYLOAD_LEN: usize = 16;
+
+/// Receives the latency of every probe that makes it back, in microseconds.
+pub type LatencyFn = unsafe extern "C" fn(*mut c_void, u64, u64);
+
+/// A namespace no other client will pick, so probes of clients sharing a relay do not mix.
+pub fn unique_namespace() -> String {
+    static COUNTER: AtomicU64 = AtomicU64::new(0);
+    // RandomState is seeded per process, which keeps processes on different hosts apart
+    let mut hasher = RandomState::new().build_hasher();
+    hasher.write_u64(COUNTER.fetch_add(1, Ordering::Relaxed));
+    format!("{}/{:016x}", NAMESPACE_PREFIX, hasher.finish())
+}
+
+/// Microseconds on the process's monotonic clock; the simulated relay uses its virtual clock instead.
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+pub fn monotonic_us() -> u64 {
+    static EPOCH: std::sync::OnceLock<std::time::Instant> = std::sync::OnceLock::new();
+    EPOCH.get_or_init(std::time::Instant::now).elapsed().as_micros() as u64
+}
+
+pub fn encode(sequence: u64, sent_us: u64) -> [u8; PAYLOAD_LEN] {
+    let mut payload = [0u8; PAYLOAD_LEN];
+    payload[..8].copy_from_slice(&sequence.to_le_bytes());
+    payload[8..].copy_from_slice(&sent_us.to_le_bytes());
+    payload
+}
+
+/// Returns (sequence, sent_us), or None for anything that is not a probe.
+pub fn decode(payload: &[u8]) -> Option<(u64, u64)> {
+    if payload.len() != PAYLOAD_LEN {
+        return None;
+    }
+    let sequence = u64::from_le_bytes(payload[..8].try_into().ok()?);
+    let sent_us = u64::from_le_bytes(payload[8..].try_into().ok()?);
+    Some((sequence, sent_us))
+}
+
+/// Running figures of one probe, in microseconds.
+#[derive(Debug, Copy, Clone, Default, PartialEq, Eq)]
+pub struct Summary {
+    pub sent: u64,
+    pub received: u64,
+    pub last_us: u64,
+    pub min_us: u64,
+    pub max_us: u64,
+    /// Moving average with a gain of 1/8, as TCP smooths its RTT
+    pub smoothed_us: u64,
+}
+
+impl Summary {
+    fn record(&mut self, latency_us: u64) {
+        if self.received == 0 {
+            self.min_us = latency_us;
+            self.smoothed_us = latency_us;
+        } else {
+            self.min_us = self.min_us.min(latency_us);
+            let smoothed = self.smoothed_us as i64;
+            self.smoothed_us = (smoothed + (latency_us as i64 - smoothed) / 8) as u64;
+        }
+        self.received += 1;
+        self.last_us = latency_us;
+        self.max_us = self.max_us.max(latency_us);
+    }
+}
+
+/// Statistics of a running probe and the application's callback.
+pub struct ProbeStats {
+    summary: Mutex<Summary>,
+    callback: Option<(LatencyFn, usize)>,
+}
+
+impl ProbeStats {
+    pub fn new(callback: Option<(LatencyFn, usize)>) -> Self {
+        ProbeStats { summary: Mutex::new(Summary::default()), callback }
+    }
+
+    fn lock(&self) -> MutexGuard<'_, Summary> {
+        self.summary.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    pub fn on_sent(&self) {
+        self.lock().sent += 1;
+    }
+
+    /// Measures a probe that came back at `now_us` and reports it to the
+    /// callback, without the lock held. Other payloads are ignored.
+    pub fn on_echo(&self, payload: &[u8], now_us: u64) {
+        let Some((sequence, sent_us)) = decode(payload) else {
+            log::trace!("Ignoring {} byte object on the latency probe track", payload.len());
+            return;
+        };
+        let latency_us = now_us.saturating_sub(sent_us);
+        self.lock().record(latency_us);
+        if let Some((callback, user_data)) = self.callback {
+            let _ = std::panic::catch_unwind(|| unsafe { callback(user_data as *mut c_void, latency_us, sequence) });
+        }
+    }
+
+    pub fn summary(&self) -> Summary {
+        *self.lock()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    unsafe extern "C" fn collect(user_data: *mut c_void, latency_us: u64, sequence: u64) {
+        (*(user_data as *const Mutex<Vec<(u64, u64)>>)).lock().unwrap().push((sequence, latency_us));
+    }
+
+    #[test]
+    fn test_payload_round_trip() {
+        let payload = encode(7, 123_456);
+        assert_eq!(decode(&payload), Some((7, 123_456)));
+        assert_eq!(decode(&payload[..15]), None);
+    }
+
+    #[test]
+    fn test_summary_tracks_extremes_and_smooths() {
+        let stats = ProbeStats::new(None);
+        stats.on_sent();
+        stats.on_echo(&encode(0, 1_000), 9_000);
+        assert_eq!(
+            stats.summary(),
+            Summary { sent: 1, received: 1, last_us: 8_000, min_us: 8_000, max_us: 8_000, smoothed_us: 8_000 }
+        );
+        stats.on_echo(&encode(1, 2_000), 18_000);
+        stats.on_echo(b"not a probe", 20_000);
+        let summary = stats.summary();
+        assert_eq!((summary.received, summary.last_us, summary.min_us, summary.max_us), (2, 16_000, 8_000, 16_000));
+        assert_eq!(summary.smoothed_us, 9_000);
+    }
+
+    #[test]
+    fn test_callback_sees_every_echo() {
+        let seen: Mutex<Vec<(u64, u64)>> = Mutex::new(Vec::new());
+        let stats = ProbeStats::new(Some((collect as LatencyFn, &seen as *const _ as usize)));
+        stats.on_echo(&encode(3, 100), 350);
+        stats.on_echo(&encode(4, 200), 150);
+        assert_eq!(*seen.lock().unwrap(), vec![(3, 250), (4, 0)]);
+    }
+
+    #[test]
+    fn test_namespaces_are_unique() {
+        let a = unique_namespace();
+        assert!(a.starts_with(NAMESPACE_PREFIX));
+        assert_ne!(a, unique_namespace());
+    }
+}
@@ -6,6 +6,28 @@
 #[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
 mod backend_moq;
 
+mod object_queue;
+
+mod latency_probe;
+
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+mod recording;
+
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+mod group_cache;
+
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+mod udp_offload;
+
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+mod object_header;
+
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+mod clock_sync;
+
+#[cfg(not(any(feature = "with_moq", feature = "with_moq_draft07")))]
+mod sim;
+
 #[cfg(not(any(feature = "with_moq", feature = "with_moq_draft07")))]
 mod backend_stub;
 
@@ -13,5 +35,8 @@ mod backend_stub;
 #[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
 pub use backend_moq::*;
 
+#[cfg(any(feature = "with_moq", feature = "with_moq_draft07"))]
+pub use udp_offload::{OffloadSocket, UdpOffload};
+
 #[cfg(not(any(feature = "with_moq", feature = "with_moq_draft07")))]
 pub use backend_stub::*;
@@ -0,0 +1,312 @@
+// In-band object header, an opt-in stand-in for extension headers
+//
+// Draft-14 lets objects carry extension headers: key/value pairs that travel
+// with the object, outside its payload. The transport crates this library is
+// built on do not expose them (and draft-07 has none on the wire), so the
+// library can carry the pairs itself instead, in a block it writes in front
+// of the payload as a separate chunk. On the wire the block is part of the
+// object's payload: relays forward it as such, and only a subscriber of this
+// library that opted in (moq_client_set_inband_headers) strips it again.
+// Every other subscriber, including other MoQ implementations, receives it
+// ahead of the payload, so the clients on a track have to agree to use it.
+//
+// The block is `MAGIC`, a varint pair count, then the pairs in draft-14
+// encoding: a varint key, followed by a varint value for even keys or by a
+// varint length and that many bytes for odd keys. An opted-in subscriber
+// delivers payloads that do not start with `MAGIC` whole, so objects
+// published without extensions pass through it untouched; a payload of the
+// application's own that happens to start with a valid block would be split
+// like one, which is why the block is off by default.
+
+/// Marks the start of a header; chosen so that it is not a plausible prefix of media or text.
+pub const MAGIC: [u8; 8] = *b"\x89MOQHDR\n";
+
+/// Capture time of the object in microseconds since the Unix epoch, on the
+/// publisher's clock (the capture timestamp of the LOC container format)
+pub const CAPTURE_TIMESTAMP: u64 = 2;
+
+/// Longest header accepted; anything longer is taken to be payload.
+pub const MAX_LEN: usize = 4096;
+
+/// One key/value pair of a header, as published.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct Extension<'a> {
+    pub key: u64,
+    /// Value of an even key
+    pub value: u64,
+    /// Value of an odd key
+    pub data: &'a [u8],
+}
+
+/// Metadata of one received object: its header as received and the pairs in it.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct ObjectHeader {
+    block: Vec<u8>,
+    pairs: Vec<Pair>,
+}
+
+/// A pair of a received header, with an odd key's value as a range of the block.
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct Pair {
+    key: u64,
+    value: u64,
+    data: std::ops::Range<usize>,
+}
+
+impl ObjectHeader {
+    /// The pairs in the order they were sent; byte values point into the header.
+    pub fn extensions(&self) -> impl ExactSizeIterator<Item = Extension<'_>> {
+        self.pairs.iter().map(|pair| Extension { key: pair.key, value: pair.value, data: &self.block[pair.data.clone()] })
+    }
+
+    pub fn capture_time_us(&self) -> Option<u64> {
+        self.extensions().find(|e| e.key == CAPTURE_TIMESTAMP).map(|e| e.value)
+    }
+}
+
+/// Encodes a header carrying `extensions`, or returns None if there are none.
+///
+/// Keys and even-key values must be below 2^62, and the header no longer than `MAX_LEN`.
+pub fn encode(extensions: &[Extension]) -> Result<Option<Vec<u8>>, String> {
+    const VARINT_MAX: u64 = (1 << 62) - 1;
+    if extensions.is_empty() {
+        return Ok(None);
+    }
+    let mut out = Vec::with_capacity(MAGIC.len() + 1 + extensions.len() * 10);
+    out.extend_from_slice(&MAGIC);
+    write_varint(&mut out, extensions.len() as u64);
+    for extension in extensions {
+        if extension.key > VARINT_MAX {
+            return Err(format!("Extension key {} is too large", extension.key));
+        }
+        write_varint(&mut out, extension.key);
+        if extension.key % 2 == 0 {
+            if extension.value > VARINT_MAX {
+                return Err(format!("Value of extension {} is too large", extension.key));
+            }
+            write_varint(&mut out, extension.value);
+        } else {
+            write_varint(&mut out, extension.data.len() as u64);
+            out.extend_from_slice(extension.data);
+        }
+        if out.len() > MAX_LEN {
+            return Err(format!("Extensions exceed {} bytes", MAX_LEN));
+        }
+    }
+    Ok(Some(out))
+}
+
+/// Encodes a header carrying `capture_time_us` (if any) followed by
+/// `extensions`, whose own capture timestamp, if any, it replaces.
+pub fn encode_stamped(capture_time_us: Option<u64>, extensions: &[Extension]) -> Result<Option<Vec<u8>>, String> {
+    let Some(capture_time_us) = capture_time_us else {
+        return encode(extensions);
+    };
+    let mut pairs = Vec::with_capacity(extensions.len() + 1);
+    pairs.push(Extension { key: CAPTURE_TIMESTAMP, value: capture_time_us, data: &[] });
+    pairs.extend(extensions.iter().filter(|e| e.key != CAPTURE_TIMESTAMP));
+    encode(&pairs)
+}
+
+/// How the start of an object's bytes divides into header and payload.
+#[derive(Debug, PartialEq, Eq)]
+pub enum Split {
+    /// No header: every byte is payload
+    Plain,
+    /// The bytes so far could still be the start of a header
+    Incomplete,
+    /// A header of this many bytes, then the payload
+    Header(ObjectHeader, usize),
+}
+
+/// Looks for a header at the start of `bytes`.
+///
+/// Call again with more bytes while this returns `Incomplete`; once the
+/// object is complete, `Incomplete` means it is plain payload.
+pub fn split(bytes: &[u8]) -> Split {
+    let magic_len = bytes.len().min(MAGIC.len());
+    if bytes[..magic_len] != MAGIC[..magic_len] {
+        return Split::Plain;
+    }
+    let mut reader = Reader { bytes, pos: magic_len };
+    match reader.pairs() {
+        Ok(pairs) => Split::Header(ObjectHeader { block: bytes[..reader.pos].to_vec(), pairs }, reader.pos),
+        Err(Malformed::Truncated) if bytes.len() < MAX_LEN => Split::Incomplete,
+        Err(_) => Split::Plain,
+    }
+}
+
+enum Malformed {
+    Truncated,
+    Invalid,
+}
+
+struct Reader<'a> {
+    bytes: &'a [u8],
+    pos: usize,
+}
+
+impl Reader<'_> {
+    fn pairs(&mut self) -> Result<Vec<Pair>, Malformed> {
+        if self.pos < MAGIC.len() {
+            return Err(Malformed::Truncated);
+        }
+        let count = self.varint()?;
+        let mut pairs = Vec::new();
+        for _ in 0..count {
+            let key = self.varint()?;
+            let pair = if key % 2 == 0 {
+                Pair { key, value: self.varint()?, data: 0..0 }
+            } else {
+                let len = self.varint()? as usize;
+                if len > MAX_LEN {
+                    return Err(Malformed::Invalid);
+                }
+                let start = self.pos;
+                self.take(len)?;
+                Pair { key, value: 0, data: start..self.pos }
+            };
+            if self.pos > MAX_LEN {
+                return Err(Malformed::Invalid);
+            }
+            pairs.push(pair);
+        }
+        Ok(pairs)
+    }
+
+    fn take(&mut self, len: usize) -> Result<&[u8], Malformed> {
+        let end = self.pos.checked_add(len).ok_or(Malformed::Invalid)?;
+        let slice = self.bytes.get(self.pos..end).ok_or(Malformed::Truncated)?;
+        self.pos = end;
+        Ok(slice)
+    }
+
+    /// QUIC variable-length integer.
+    fn varint(&mut self) -> Result<u64, Malformed> {
+        let first = *self.take(1)?.first().expect("one byte");
+        let len = 1usize << (first >> 6);
+        let mut value = (first & 0x3f) as u64;
+        for &byte in self.take(len - 1)? {
+            value = (value << 8) | byte as u64;
+        }
+        Ok(value)
+    }
+}
+
+/// Appends `value` as a QUIC variable-length integer; values must be below 2^62.
+pub fn write_varint(out: &mut Vec<u8>, value: u64) {
+    match value {
+        0..=0x3f => out.push(value as u8),
+        0x40..=0x3fff => out.extend_from_slice(&(value as u16 | 0x4000).to_be_bytes()),
+        0x4000..=0x3fff_ffff => out.extend_from_slice(&(value as u32 | 0x8000_0000).to_be_bytes()),
+        _ => out.extend_from_slice(&((value & 0x3fff_ffff_ffff_ffff) | 0xc000_0000_0000_0000).to_be_bytes()),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn number(key: u64, value: u64) -> Extension<'static> {
+        Extension { key, value, data: &[] }
+    }
+
+    fn stamped(capture_time_us: u64) -> Vec<u8> {
+        encode(&[number(CAPTURE_TIMESTAMP, capture_time_us)]).unwrap().unwrap()
+    }
+
+    #[test]
+    fn test_header_round_trip() {
+        let now_us = 1_760_000_000_000_000;
+        let mut object = stamped(now_us);
+        let header_len = object.len();
+        object.extend_from_slice(b"payload");
+        match split(&object) {
+            Split::Header(header, len) => {
+                assert_eq!(header.capture_time_us(), Some(now_us));
+                assert_eq!(&object[len..], b"payload");
+                assert_eq!(len, header_len);
+            }
+            other => panic!("expected a header, got {:?}", other),
+        }
+        assert_eq!(encode(&[]), Ok(None));
+    }
+
+    #[test]
+    fn test_extensions_round_trip_in_order() {
+        let extensions = [
+            Extension { key: 0x0b, value: 0, data: b"scene-7" },
+            number(CAPTURE_TIMESTAMP, 99),
+            number(0x3c, 1 << 40),
+            Extension { key: 0x0d, value: 0, data: b"" },
+        ];
+        let block = encode(&extensions).unwrap().unwrap();
+        let Split::Header(header, len) = split(&block) else { panic!("expected a header") };
+        assert_eq!(len, block.len());
+        assert_eq!(header.extensions().collect::<Vec<_>>(), extensions);
+        assert_eq!(header.capture_time_us(), Some(99));
+    }
+
+    #[test]
+    fn test_encode_rejects_what_does_not_fit() {
+        assert!(encode(&[number(1 << 62, 0)]).is_err());
+        assert!(encode(&[number(4, 1 << 62)]).is_err());
+        let large = vec![0u8; MAX_LEN];
+        assert!(encode(&[Extension { key: 1, value: 0, data: &large }]).is_err());
+        // Only even keys carry a number, so an odd key's value is not checked
+        assert!(encode(&[Extension { key: 1, value: u64::MAX, data: b"x" }]).is_ok());
+    }
+
+    #[test]
+    fn test_capture_time_goes_first_and_replaces_its_pair() {
+        let extensions = [number(4, 1), number(CAPTURE_TIMESTAMP, 5)];
+        let block = encode_stamped(Some(7), &extensions).unwrap().unwrap();
+        let Split::Header(header, _) = split(&block) else { panic!("expected a header") };
+        assert_eq!(header.extensions().collect::<Vec<_>>(), [number(CAPTURE_TIMESTAMP, 7), number(4, 1)]);
+        assert_eq!(encode_stamped(None, &extensions), encode(&extensions));
+        assert_eq!(encode_stamped(None, &[]), Ok(None));
+    }
+
+    #[test]
+    fn test_plain_payloads_pass_through() {
+        assert_eq!(split(b"hello world"), Split::Plain);
+        assert_eq!(split(&[0x89, b'P', b'N', b'G']), Split::Plain);
+        assert_eq!(split(b""), Split::Incomplete);
+    }
+
+    #[test]
+    fn test_split_waits_for_the_whole_header() {
+        let header = stamped(u64::MAX >> 2);
+        for cut in 0..header.len() {
+            assert_eq!(split(&header[..cut]), Split::Incomplete, "cut at {}", cut);
+        }
+        assert!(matches!(split(&header), Split::Header(_, len) if len == header.len()));
+    }
+
+    #[test]
+    fn test_pairs_of_any_key_are_kept() {
+        let mut block = MAGIC.to_vec();
+        write_varint(&mut block, 3);
+        write_varint(&mut block, 0x3c);
+        write_varint(&mut block, 7);
+        write_varint(&mut block, 0x0b);
+        write_varint(&mut block, 2);
+        block.extend_from_slice(b"xy");
+        write_varint(&mut block, CAPTURE_TIMESTAMP);
+        write_varint(&mut block, 1234);
+        let Split::Header(header, len) = split(&block) else { panic!("expected a header") };
+        assert_eq!(len, block.len());
+        assert_eq!(header.capture_time_us(), Some(1234));
+        assert_eq!(header.extensions().map(|e| e.key).collect::<Vec<_>>(), [0x3c, 0x0b, CAPTURE_TIMESTAMP]);
+    }
+
+    #[test]
+    fn test_varint_sizes() {
+        for (value, len) in [(0x3f, 1), (0x40, 2), (0x3fff, 2), (0x4000, 4), (0x4000_0000, 8)] {
+            let mut out = Vec::new();
+            write_varint(&mut out, value);
+            assert_eq!(out.len(), len);
+            assert_eq!(Reader { bytes: &out, pos: 0 }.varint().ok(), Some(value));
+        }
+    }
+}
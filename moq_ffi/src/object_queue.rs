@@ -0,0 +1,183 @@
+// Bounded queue of received objects for pull-based delivery
+//
+// A subscriber in queue mode parks received objects here instead of calling
+// into the application. The consumer pops them one at a time; when the queue
+// is empty it may arm a one-shot ready callback, which fires once an object
+// arrives or the queue is closed. This lets coroutine and event-loop code wait
+// for data without a condition variable: the callback only has to schedule
+// the waiting task, which then pops the object on its own thread.
+//
+// The ready callback is always invoked without the lock held, and never from
+// inside `pop()`, so arming it cannot re-enter the consumer.
+
+use std::collections::VecDeque;
+use std::ffi::c_void;
+use std::sync::{Mutex, MutexGuard};
+
+/// One-shot notification invoked with its user data.
+pub type ReadyFn = unsafe extern "C" fn(*mut c_void);
+
+/// Objects held when the application does not choose a limit.
+pub const DEFAULT_MAX_OBJECTS: usize = 256;
+
+/// Outcome of `ObjectQueue::pop()`.
+#[derive(Debug, PartialEq, Eq)]
+pub enum Pop<T> {
+    /// The oldest queued object
+    Ready(T),
+    /// Nothing queued yet; the ready callback, if given, is armed
+    Pending,
+    /// Nothing queued and nothing more will arrive
+    Closed,
+}
+
+struct State<T> {
+    objects: VecDeque<T>,
+    ready: Option<(ReadyFn, usize)>,
+    closed: bool,
+}
+
+pub struct ObjectQueue<T> {
+    state: Mutex<State<T>>,
+}
+
+impl<T> ObjectQueue<T> {
+    pub fn new() -> Self {
+        ObjectQueue {
+            state: Mutex::new(State { objects: VecDeque::new(), ready: None, closed: false }),
+        }
+    }
+
+    fn lock(&self) -> MutexGuard<'_, State<T>> {
+        self.state.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Appends objects, dropping the oldest ones beyond `max_objects`, and
+    /// fires the armed ready callback. Returns how many objects were dropped.
+    pub fn push(&self, objects: impl IntoIterator<Item = T>, max_objects: usize) -> usize {
+        let max_objects = if max_objects == 0 { DEFAULT_MAX_OBJECTS } else { max_objects };
+        let (ready, dropped) = {
+            let mut state = self.lock();
+            if state.closed {
+                return 0;
+            }
+            state.objects.extend(objects);
+            let dropped = state.objects.len().saturating_sub(max_objects);
+            state.objects.drain(..dropped);
+            let ready = if state.objects.is_empty() { None } else { state.ready.take() };
+            (ready, dropped)
+        };
+        if dropped > 0 {
+            log::trace!("Object queue full; dropped {} oldest objects", dropped);
+        }
+        fire(ready);
+        dropped
+    }
+
+    /// Takes the oldest object. When the queue is empty and open, `ready`
+    /// (if given) replaces any previously armed callback.
+    pub fn pop(&self, ready: Option<(ReadyFn, usize)>) -> Pop<T> {
+        let mut state = self.lock();
+        if let Some(object) = state.objects.pop_front() {
+            return Pop::Ready(object);
+        }
+        if state.closed {
+            return Pop::Closed;
+        }
+        if ready.is_some() {
+            state.ready = ready;
+        }
+        Pop::Pending
+    }
+
+    /// Marks the end of the stream and fires the armed ready callback.
+    /// Objects already queued can still be popped.
+    pub fn close(&self) {
+        let ready = {
+            let mut state = self.lock();
+            state.closed = true;
+            state.ready.take()
+        };
+        fire(ready);
+    }
+
+    /// Forgets the armed ready callback without invoking it.
+    pub fn disarm(&self) {
+        self.lock().ready = None;
+    }
+}
+
+fn fire(ready: Option<(ReadyFn, usize)>) {
+    if let Some((callback, user_data)) = ready {
+        let _ = std::panic::catch_unwind(|| unsafe { callback(user_data as *mut c_void) });
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+
+    unsafe extern "C" fn count(user_data: *mut c_void) {
+        (*(user_data as *const AtomicUsize)).fetch_add(1, Ordering::SeqCst);
+    }
+
+    #[test]
+    fn test_pop_in_order_then_pending() {
+        let queue = ObjectQueue::new();
+        queue.push([1, 2, 3], 0);
+        assert_eq!(queue.pop(None), Pop::Ready(1));
+        assert_eq!(queue.pop(None), Pop::Ready(2));
+        assert_eq!(queue.pop(None), Pop::Ready(3));
+        assert_eq!(queue.pop(None), Pop::Pending);
+    }
+
+    #[test]
+    fn test_drops_oldest_beyond_limit() {
+        let queue = ObjectQueue::new();
+        assert_eq!(queue.push([1, 2, 3, 4], 2), 2);
+        assert_eq!(queue.pop(None), Pop::Ready(3));
+        assert_eq!(queue.pop(None), Pop::Ready(4));
+    }
+
+    #[test]
+    fn test_ready_fires_once_on_push() {
+        let fired = AtomicUsize::new(0);
+        let ready = Some((count as ReadyFn, &fired as *const AtomicUsize as usize));
+        let queue = ObjectQueue::new();
+
+        assert_eq!(queue.pop(ready), Pop::Pending);
+        assert_eq!(fired.load(Ordering::SeqCst), 0, "Arming must not fire");
+        queue.push([7], 0);
+        assert_eq!(fired.load(Ordering::SeqCst), 1);
+        queue.push([8], 0);
+        assert_eq!(fired.load(Ordering::SeqCst), 1, "The callback is one-shot");
+        assert_eq!(queue.pop(None), Pop::Ready(7));
+    }
+
+    #[test]
+    fn test_close_wakes_and_drains() {
+        let fired = AtomicUsize::new(0);
+        let ready = Some((count as ReadyFn, &fired as *const AtomicUsize as usize));
+        let queue = ObjectQueue::new();
+        queue.push([1], 0);
+        assert_eq!(queue.pop(None), Pop::Ready(1));
+        assert_eq!(queue.pop(ready), Pop::Pending);
+
+        queue.close();
+        assert_eq!(fired.load(Ordering::SeqCst), 1);
+        assert_eq!(queue.push([2], 0), 0);
+        assert_eq!(queue.pop(None), Pop::Closed);
+    }
+
+    #[test]
+    fn test_disarm() {
+        let fired = AtomicUsize::new(0);
+        let ready = Some((count as ReadyFn, &fired as *const AtomicUsize as usize));
+        let queue = ObjectQueue::new();
+        assert_eq!(queue.pop(ready), Pop::Pending);
+        queue.disarm();
+        queue.push([1], 0);
+        assert_eq!(fired.load(Ordering::SeqCst), 0);
+    }
+}
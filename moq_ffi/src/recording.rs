@@ -0,0 +1,575 @@
+// On-disk track recordings
+//
+// A recording is a directory holding a segmented, append-only payload log and
+// a compact index that is memory-mapped for random access by group or time:
+//
+//   track          namespace and track name, one per line
+//   index          64-byte header followed by one 40-byte entry per object
+//   00000000.seg   payload segments, preallocated and truncated when closed
+//
+// All integers are little-endian. Entries are appended in arrival order and
+// the header's entry count is only advanced once an entry and its payload are
+// fully written, so a recording cut short by a crash is still readable up to
+// the last complete object.
+
+use std::fs::{self, File, OpenOptions};
+use std::io;
+use std::path::{Path, PathBuf};
+use std::thread::JoinHandle;
+use std::time::{Instant, SystemTime, UNIX_EPOCH};
+
+use bytes::Bytes;
+use memmap2::{Mmap, MmapMut};
+
+const INDEX_MAGIC: &[u8; 8] = b"MOQIDX\0\x01";
+const INDEX_VERSION: u32 = 1;
+const INDEX_HEADER_SIZE: usize = 64;
+const INDEX_ENTRY_SIZE: usize = 40;
+
+/// Index entries reserved at a time; the index is remapped when it fills up.
+const INDEX_GROWTH_ENTRIES: usize = 64 * 1024;
+
+/// Size of a preallocated payload segment.
+const SEGMENT_SIZE: usize = 64 * 1024 * 1024;
+
+/// Stride for touching a fresh mapping; no page is smaller.
+const PAGE_SIZE: usize = 4096;
+
+const TRACK_FILE: &str = "track";
+const INDEX_FILE: &str = "index";
+
+fn segment_path(dir: &Path, number: u32) -> PathBuf {
+    dir.join(format!("{:08}.seg", number))
+}
+
+fn invalid_data(msg: &str) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, msg.to_string())
+}
+
+/// Reserves disk blocks for the first `len` bytes of `file`, so writes
+/// through a mapping neither allocate blocks nor fail for lack of space.
+/// Elsewhere than on Linux the file is only extended, and stays sparse.
+fn preallocate(file: &File, len: usize) -> io::Result<()> {
+    #[cfg(target_os = "linux")]
+    {
+        use std::os::fd::AsRawFd;
+        // SAFETY: plain call on an open descriptor
+        let ret = unsafe { libc::posix_fallocate(file.as_raw_fd(), 0, len as libc::off_t) };
+        if ret != 0 {
+            return Err(io::Error::from_raw_os_error(ret));
+        }
+    }
+    file.set_len(len as u64)
+}
+
+/// Faults every page of a fresh mapping in, so that later appends find them
+/// in the page cache and the page tables.
+fn pretouch(map: &MmapMut) {
+    for offset in (0..map.len()).step_by(PAGE_SIZE) {
+        // SAFETY: offset lies within the mapping
+        unsafe { std::ptr::read_volatile(map.as_ptr().add(offset)) };
+    }
+}
+
+/// Location and timing of one recorded object.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct IndexEntry {
+    /// Arrival time relative to the start of the recording
+    pub arrival_us: u64,
+    pub group_id: u64,
+    pub object_id: u64,
+    pub segment: u32,
+    pub len: u32,
+    /// Byte offset of the payload within its segment
+    pub offset: u64,
+}
+
+impl IndexEntry {
+    fn write_to(&self, buf: &mut [u8]) {
+        buf[0..8].copy_from_slice(&self.arrival_us.to_le_bytes());
+        buf[8..16].copy_from_slice(&self.group_id.to_le_bytes());
+        buf[16..24].copy_from_slice(&self.object_id.to_le_bytes());
+        buf[24..28].copy_from_slice(&self.segment.to_le_bytes());
+        buf[28..32].copy_from_slice(&self.len.to_le_bytes());
+        buf[32..40].copy_from_slice(&self.offset.to_le_bytes());
+    }
+
+    fn read_from(buf: &[u8]) -> Self {
+        let u64_at = |i: usize| u64::from_le_bytes(buf[i..i + 8].try_into().unwrap());
+        let u32_at = |i: usize| u32::from_le_bytes(buf[i..i + 4].try_into().unwrap());
+        IndexEntry {
+            arrival_us: u64_at(0),
+            group_id: u64_at(8),
+            object_id: u64_at(16),
+            segment: u32_at(24),
+            len: u32_at(28),
+            offset: u64_at(32),
+        }
+    }
+}
+
+/// A payload segment mapped for writing, its space reserved on disk and its
+/// pages faulted in when created.
+struct Segment {
+    number: u32,
+    file: File,
+    map: MmapMut,
+    len: usize,
+}
+
+impl Segment {
+    fn create(dir: &Path, number: u32, capacity: usize) -> io::Result<Self> {
+        let file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create_new(true)
+            .open(segment_path(dir, number))?;
+        preallocate(&file, capacity)?;
+        let map = unsafe { MmapMut::map_mut(&file)? };
+        pretouch(&map);
+        Ok(Segment { number, file, map, len: 0 })
+    }
+
+    fn remaining(&self) -> usize {
+        self.map.len() - self.len
+    }
+
+    /// Writes back the used part and truncates the preallocated tail.
+    fn finish(self) -> io::Result<()> {
+        self.map.flush_range(0, self.len)?;
+        drop(self.map);
+        self.file.set_len(self.len as u64)
+    }
+}
+
+/// Appends received objects to a recording directory.
+///
+/// Payloads are copied into preallocated, memory-mapped segments, so appending
+/// an object costs two memcpys and no system call. The next segment is created
+/// on a helper thread once the current one is half full, and full segments
+/// are written back and truncated on a helper thread as well.
+///
+/// Rolling over waits for the next segment if its helper is still busy, and
+/// closing waits for every helper and writes the index back, so keep the
+/// writer off async runtime threads.
+pub struct RecordingWriter {
+    dir: PathBuf,
+    index_file: File,
+    // None once the recording is closed
+    index: Option<MmapMut>,
+    index_capacity: usize,
+    entries: usize,
+    start: Instant,
+    segment_size: usize,
+    segment: Option<Segment>,
+    next_segment: Option<JoinHandle<io::Result<Segment>>>,
+    finishing: Vec<JoinHandle<io::Result<()>>>,
+}
+
+impl RecordingWriter {
+    /// Starts a new recording in `dir`, creating the directory if needed.
+    ///
+    /// Fails with `AlreadyExists` if `dir` already holds a recording.
+    pub fn create(dir: &Path, namespace: &str, track_name: &str) -> io::Result<Self> {
+        Self::create_with_segment_size(dir, namespace, track_name, SEGMENT_SIZE)
+    }
+
+    fn create_with_segment_size(dir: &Path, namespace: &str, track_name: &str, segment_size: usize) -> io::Result<Self> {
+        if namespace.contains('\n') || track_name.contains('\n') {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidInput,
+                "namespace and track name must not contain newlines",
+            ));
+        }
+        fs::create_dir_all(dir)?;
+
+        let index_file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create_new(true)
+            .open(dir.join(INDEX_FILE))?;
+        fs::write(dir.join(TRACK_FILE), format!("{}\n{}\n", namespace, track_name))?;
+
+        index_file.set_len((INDEX_HEADER_SIZE + INDEX_GROWTH_ENTRIES * INDEX_ENTRY_SIZE) as u64)?;
+        let mut index = unsafe { MmapMut::map_mut(&index_file)? };
+        let start_unix_us = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .map(|d| d.as_micros() as u64)
+            .unwrap_or(0);
+        index[0..8].copy_from_slice(INDEX_MAGIC);
+        index[8..12].copy_from_slice(&INDEX_VERSION.to_le_bytes());
+        index[12..16].copy_from_slice(&(INDEX_ENTRY_SIZE as u32).to_le_bytes());
+        index[16..24].copy_from_slice(&0u64.to_le_bytes());
+        index[24..32].copy_from_slice(&start_unix_us.to_le_bytes());
+
+        let segment = Segment::create(dir, 0, segment_size)?;
+
+        Ok(RecordingWriter {
+            dir: dir.to_path_buf(),
+            index_file,
+            index: Some(index),
+            index_capacity: INDEX_GROWTH_ENTRIES,
+            entries: 0,
+            start: Instant::now(),
+            segment_size,
+            segment: Some(segment),
+            next_segment: None,
+            finishing: Vec::new(),
+        })
+    }
+
+    /// Number of objects recorded so far.
+    pub fn len(&self) -> usize {
+        self.entries
+    }
+
+    /// Appends one object that arrived at `arrival`.
+    pub fn append(&mut self, group_id: u64, object_id: u64, arrival: Instant, payload: &[u8]) -> io::Result<()> {
+        let len = u32::try_from(payload.len())
+            .map_err(|_| io::Error::new(io::ErrorKind::InvalidInput, "object larger than 4 GiB"))?;
+        if self.index.is_none() {
+            return Err(io::Error::other("recording is closed"));
+        }
+        if self.entries == self.index_capacity {
+            self.grow_index()?;
+        }
+
+        let arrival_us = arrival.saturating_duration_since(self.start).as_micros() as u64;
+        let segment = self.segment_with_room(payload.len())?;
+        let offset = segment.len;
+        segment.map[offset..offset + payload.len()].copy_from_slice(payload);
+        segment.len += payload.len();
+        let entry = IndexEntry {
+            arrival_us,
+            group_id,
+            object_id,
+            segment: segment.number,
+            len,
+            offset: offset as u64,
+        };
+        let half_full = segment.len >= segment.map.len() / 2;
+        let next_number = segment.number + 1;
+
+        let index = self.index.as_mut().expect("open recording");
+        let at = INDEX_HEADER_SIZE + self.entries * INDEX_ENTRY_SIZE;
+        entry.write_to(&mut index[at..at + INDEX_ENTRY_SIZE]);
+        self.entries += 1;
+        index[16..24].copy_from_slice(&(self.entries as u64).to_le_bytes());
+
+        if half_full && self.next_segment.is_none() {
+            let dir = self.dir.clone();
+            let size = self.segment_size;
+            self.next_segment = Some(std::thread::spawn(move || Segment::create(&dir, next_number, size)));
+        }
+        Ok(())
+    }
+
+    /// Returns the current segment, rolling over to a new one if `size` bytes don't fit.
+    fn segment_with_room(&mut self, size: usize) -> io::Result<&mut Segment> {
+        let current = self.segment.as_ref().expect("recording segment");
+        if current.remaining() < size {
+            let number = current.number + 1;
+            let prepared = match self.next_segment.take() {
+                Some(handle) => handle.join().map_err(|_| io::Error::other("segment preallocation panicked"))?,
+                None => Segment::create(&self.dir, number, self.segment_size.max(size)),
+            }?;
+            let next = if prepared.remaining() >= size {
+                prepared
+            } else {
+                // Oversized object: give it a segment of its own
+                let number = prepared.number + 1;
+                self.finishing.push(std::thread::spawn(move || prepared.finish()));
+                Segment::create(&self.dir, number, size)?
+            };
+            if let Some(full) = self.segment.replace(next) {
+                self.finishing.push(std::thread::spawn(move || full.finish()));
+            }
+        }
+        Ok(self.segment.as_mut().expect("recording segment"))
+    }
+
+    fn grow_index(&mut self) -> io::Result<()> {
+        if let Some(index) = self.index.take() {
+            index.flush()?;
+        }
+        let capacity = self.index_capacity + INDEX_GROWTH_ENTRIES;
+        self.index_file.set_len((INDEX_HEADER_SIZE + capacity * INDEX_ENTRY_SIZE) as u64)?;
+        self.index = Some(unsafe { MmapMut::map_mut(&self.index_file)? });
+        self.index_capacity = capacity;
+        Ok(())
+    }
+
+    /// Writes everything back and trims the preallocated space.
+    ///
+    /// Called on drop; call it explicitly to observe errors.
+    pub fn close(&mut self) -> io::Result<()> {
+        let mut result = Ok(());
+        if let Some(segment) = self.segment.take() {
+            result = result.and(segment.finish());
+        }
+        if let Some(handle) = self.next_segment.take() {
+            // Preallocated but never used
+            if let Ok(Ok(unused)) = handle.join() {
+                let number = unused.number;
+                drop(unused);
+                let _ = fs::remove_file(segment_path(&self.dir, number));
+            }
+        }
+        for handle in self.finishing.drain(..) {
+            result = result.and(handle.join().unwrap_or_else(|_| Err(io::Error::other("segment writeback panicked"))));
+        }
+
+        if let Some(index) = self.index.take() {
+            let used = INDEX_HEADER_SIZE + self.entries * INDEX_ENTRY_SIZE;
+            result = result.and(index.flush_range(0, used));
+            // Unmap before trimming the unused entries
+            drop(index);
+            result = result.and(self.index_file.set_len(used as u64));
+        }
+        result
+    }
+}
+
+impl Drop for RecordingWriter {
+    fn drop(&mut self) {
+        if self.index.is_some() {
+            if let Err(e) = self.close() {
+                log::error!("Failed to finalize recording {}: {}", self.dir.display(), e);
+            }
+        }
+    }
+}
+
+/// Read access to a recording through its memory-mapped index.
+#[cfg_attr(not(test), allow(dead_code))]
+pub struct RecordingReader {
+    dir: PathBuf,
+    namespace: String,
+    track_name: String,
+    start_unix_us: u64,
+    index: Mmap,
+    entries: usize,
+    // Segment mappings, shared with the payloads handed out
+    segments: Vec<Option<Bytes>>,
+}
+
+#[cfg_attr(not(test), allow(dead_code))]
+impl RecordingReader {
+    pub fn open(dir: &Path) -> io::Result<Self> {
+        let track = fs::read_to_string(dir.join(TRACK_FILE))?;
+        let mut lines = track.lines();
+        let namespace = lines.next().ok_or_else(|| invalid_data("missing namespace"))?.to_string();
+        let track_name = lines.next().ok_or_else(|| invalid_data("missing track name"))?.to_string();
+
+        let index_file = File::open(dir.join(INDEX_FILE))?;
+        let index = unsafe { Mmap::map(&index_file)? };
+        if index.len() < INDEX_HEADER_SIZE || &index[0..8] != INDEX_MAGIC {
+            return Err(invalid_data("not a recording index"));
+        }
+        let entry_size = u32::from_le_bytes(index[12..16].try_into().unwrap()) as usize;
+        if entry_size != INDEX_ENTRY_SIZE {
+            return Err(invalid_data("unsupported index entry size"));
+        }
+        let count = u64::from_le_bytes(index[16..24].try_into().unwrap()) as usize;
+        let start_unix_us = u64::from_le_bytes(index[24..32].try_into().unwrap());
+        // Never trust the count beyond what the file actually holds
+        let entries = count.min((index.len() - INDEX_HEADER_SIZE) / INDEX_ENTRY_SIZE);
+
+        Ok(RecordingReader {
+            dir: dir.to_path_buf(),
+            namespace,
+            track_name,
+            start_unix_us,
+            index,
+            entries,
+            segments: Vec::new(),
+        })
+    }
+
+    pub fn namespace(&self) -> &str {
+        &self.namespace
+    }
+
+    pub fn track_name(&self) -> &str {
+        &self.track_name
+    }
+
+    /// Wall-clock start of the recording, in microseconds since the Unix epoch.
+    pub fn start_unix_us(&self) -> u64 {
+        self.start_unix_us
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries
+    }
+
+    pub fn entry(&self, i: usize) -> IndexEntry {
+        assert!(i < self.entries, "index entry out of range");
+        let at = INDEX_HEADER_SIZE + i * INDEX_ENTRY_SIZE;
+        IndexEntry::read_from(&self.index[at..at + INDEX_ENTRY_SIZE])
+    }
+
+    /// Position of the first object that arrived at or after `arrival_us`.
+    pub fn seek_time(&self, arrival_us: u64) -> usize {
+        self.partition_point(|e| e.arrival_us < arrival_us)
+    }
+
+    /// Position of the first object of the first group at or after `group_id`.
+    ///
+    /// Assumes groups were received in order, which holds for a single
+    /// publisher; objects of late groups are found by scanning from here.
+    pub fn seek_group(&self, group_id: u64) -> usize {
+        self.partition_point(|e| e.group_id < group_id)
+    }
+
+    fn partition_point(&self, pred: impl Fn(&IndexEntry) -> bool) -> usize {
+        let (mut lo, mut hi) = (0, self.entries);
+        while lo < hi {
+            let mid = lo + (hi - lo) / 2;
+            if pred(&self.entry(mid)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        lo
+    }
+
+    /// Payload of a recorded object, mapping its segment on first use.
+    ///
+    /// The returned bytes point into the mapping without copying; the
+    /// mapping stays alive as long as any payload taken from it.
+    pub fn payload(&mut self, entry: &IndexEntry) -> io::Result<Bytes> {
+        let number = entry.segment as usize;
+        if self.segments.len() <= number {
+            self.segments.resize_with(number + 1, || None);
+        }
+        if self.segments[number].is_none() {
+            let file = File::open(segment_path(&self.dir, entry.segment))?;
+            let map = unsafe { Mmap::map(&file)? };
+            self.segments[number] = Some(Bytes::from_owner(map));
+        }
+        let segment = self.segments[number].as_ref().unwrap();
+        let start = entry.offset as usize;
+        let end = start + entry.len as usize;
+        if end > segment.len() {
+            return Err(invalid_data("payload beyond end of segment"));
+        }
+        Ok(segment.slice(start..end))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+
+    fn temp_dir(name: &str) -> PathBuf {
+        let dir = std::env::temp_dir().join(format!("moq_ffi_{}_{}", name, std::process::id()));
+        let _ = fs::remove_dir_all(&dir);
+        dir
+    }
+
+    #[test]
+    fn test_round_trip_and_seek() {
+        let dir = temp_dir("recording_round_trip");
+        {
+            let mut writer = RecordingWriter::create(&dir, "live/game", "state").unwrap();
+            let start = writer.start;
+            for i in 0..100u64 {
+                let payload = vec![i as u8; (i as usize % 7) + 1];
+                writer.append(i / 10, i % 10, start + Duration::from_millis(i), &payload).unwrap();
+            }
+            assert_eq!(writer.len(), 100);
+        }
+
+        let mut reader = RecordingReader::open(&dir).unwrap();
+        assert_eq!(reader.namespace(), "live/game");
+        assert_eq!(reader.track_name(), "state");
+        let now_us = SystemTime::now().duration_since(UNIX_EPOCH).unwrap().as_micros() as u64;
+        assert!(reader.start_unix_us() > 0 && reader.start_unix_us() <= now_us);
+        assert_eq!(reader.len(), 100);
+
+        let i = reader.seek_group(4);
+        let entry = reader.entry(i);
+        assert_eq!((entry.group_id, entry.object_id), (4, 0));
+        assert_eq!(&reader.payload(&entry).unwrap()[..], &[40u8; 6][..]);
+
+        assert_eq!(reader.seek_time(50_000), 50);
+        assert_eq!(reader.seek_time(50_001), 51);
+        assert_eq!(reader.seek_group(1000), 100);
+
+        // The preallocated tail is trimmed on close
+        let seg_len = fs::metadata(segment_path(&dir, 0)).unwrap().len();
+        let total: u64 = (0..100u64).map(|i| (i % 7) + 1).sum();
+        assert_eq!(seg_len, total);
+        fs::remove_dir_all(&dir).unwrap();
+    }
+
+    #[test]
+    fn test_refuses_to_overwrite_recording() {
+        let dir = temp_dir("recording_exists");
+        drop(RecordingWriter::create(&dir, "ns", "track").unwrap());
+        let err = RecordingWriter::create(&dir, "ns", "track").err().unwrap();
+        assert_eq!(err.kind(), io::ErrorKind::AlreadyExists);
+        fs::remove_dir_all(&dir).unwrap();
+    }
+
+    #[test]
+    fn test_rolls_over_segments() {
+        let dir = temp_dir("recording_rollover");
+        let object = vec![0xAB; 1024 / 3 + 1];
+        {
+            let mut writer = RecordingWriter::create_with_segment_size(&dir, "ns", "track", 1024).unwrap();
+            for i in 0..4u64 {
+                writer.append(i, 0, Instant::now(), &object).unwrap();
+            }
+            // Larger than a whole segment
+            writer.append(4, 0, Instant::now(), &[0xCD; 1025]).unwrap();
+        }
+
+        let mut reader = RecordingReader::open(&dir).unwrap();
+        let segments: Vec<u32> = (0..reader.len()).map(|i| reader.entry(i).segment).collect();
+        assert_eq!(segments[0], 0);
+        assert_eq!(segments[1], 0);
+        assert_eq!(segments[2], 1);
+        assert!(segments[4] > segments[3]);
+        let last = reader.entry(4);
+        assert_eq!(&reader.payload(&last).unwrap()[..], &[0xCD; 1025][..]);
+        fs::remove_dir_all(&dir).unwrap();
+    }
+
+    #[cfg(target_os = "linux")]
+    #[test]
+    fn test_segments_are_allocated_not_sparse() {
+        use std::os::unix::fs::MetadataExt;
+        let dir = temp_dir("recording_preallocated");
+        let size = 1024 * 1024;
+        let writer = RecordingWriter::create_with_segment_size(&dir, "ns", "track", size).unwrap();
+        let blocks = fs::metadata(segment_path(&dir, 0)).unwrap().blocks();
+        assert!(blocks * 512 >= size as u64, "only {} blocks behind the segment", blocks);
+        drop(writer);
+        fs::remove_dir_all(&dir).unwrap();
+    }
+
+    #[test]
+    fn test_grows_index() {
+        let dir = temp_dir("recording_grow_index");
+        let count = INDEX_GROWTH_ENTRIES + 10;
+        {
+            let mut writer = RecordingWriter::create(&dir, "ns", "track").unwrap();
+            for i in 0..count as u64 {
+                writer.append(i, 0, Instant::now(), &i.to_le_bytes()).unwrap();
+            }
+            writer.close().unwrap();
+        }
+
+        let mut reader = RecordingReader::open(&dir).unwrap();
+        assert_eq!(reader.len(), count);
+        let last = reader.entry(count - 1);
+        assert_eq!(&reader.payload(&last).unwrap()[..], &(count as u64 - 1).to_le_bytes()[..]);
+        let index_len = fs::metadata(dir.join(INDEX_FILE)).unwrap().len() as usize;
+        assert_eq!(index_len, INDEX_HEADER_SIZE + count * INDEX_ENTRY_SIZE);
+        fs::remove_dir_all(&dir).unwrap();
+    }
+}
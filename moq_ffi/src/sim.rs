@@ -0,0 +1,1038 @@
+// Deterministic simulated relay for the stub backend
+//
+// Clients of a `sim://<name>` URL share one in-memory relay. Each client has
+// an uplink and a downlink with latency, jitter, bandwidth and loss; objects
+// travel publisher -> relay -> subscriber as timestamped events on a virtual
+// clock. Nothing moves until the application calls `Relay::advance`, which
+// runs every event that falls due in order and invokes the receivers on the
+// calling thread. With the same seed and the same sequence of calls, a run
+// always produces the same deliveries at the same virtual times.
+
+use std::cmp::{Ordering, Reverse};
+use std::collections::{BinaryHeap, HashMap, HashSet};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering as AtomicOrdering};
+use std::sync::{Arc, Mutex, MutexGuard, OnceLock, Weak};
+
+/// Receives objects for one subscription, one batch per call.
+pub type ObjectHandler = Arc<dyn Fn(&[Object]) + Send + Sync>;
+
+/// Receives (namespace, track name) for every track published by another client.
+pub type AnnounceHandler = Arc<dyn Fn(&str, &str) + Send + Sync>;
+
+/// Runs on every tick of a timer.
+pub type TimerHandler = Arc<dyn Fn() + Send + Sync>;
+
+/// Runs once a wait for a publisher's objects to be acknowledged is over.
+pub type AckHandler = Box<dyn FnOnce(AckOutcome) + Send>;
+
+/// How a wait for acknowledgements ended.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub enum AckOutcome {
+    Acked,
+    TimedOut,
+    /// The publisher's client disconnected with objects still in flight
+    Disconnected,
+}
+
+/// Smallest retransmission delay for a lost reliable packet, in microseconds
+const MIN_RETRANSMIT_US: u64 = 1_000;
+
+/// One direction of a client's connection to the relay.
+#[derive(Debug, Copy, Clone, Default, PartialEq)]
+pub struct LinkConfig {
+    pub latency_us: u64,
+    pub jitter_us: u64,
+    /// Link rate in bits per second; 0 for unlimited
+    pub bandwidth_bps: u64,
+    /// Probability in [0, 1] that an object is lost in transit
+    pub loss: f64,
+}
+
+#[derive(Clone)]
+pub struct Object {
+    pub group_id: u64,
+    pub object_id: u64,
+    pub payload: Arc<[u8]>,
+    /// Capture time stamped by the publisher, in virtual microseconds
+    pub capture_time_us: Option<u64>,
+    /// Extension headers, led by the capture time if there is one
+    pub extensions: Arc<[Extension]>,
+    /// Virtual time the object reached its subscriber; 0 until then
+    pub arrival_us: u64,
+}
+
+/// Extension header key of the capture time, as on the wire.
+pub const CAPTURE_TIMESTAMP: u64 = 2;
+
+/// Extension header of an object: a number for even keys, bytes for odd ones.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Extension {
+    pub key: u64,
+    pub value: u64,
+    pub data: Box<[u8]>,
+}
+
+/// Upper bounds on how many objects are held back and for how long before a batch is delivered.
+#[derive(Debug, Copy, Clone)]
+pub struct Batching {
+    pub max_objects: usize,
+    pub max_delay_us: u64,
+}
+
+#[derive(Debug, PartialEq, Eq)]
+pub enum SimError {
+    NotConnected,
+    NotAnnounced,
+}
+
+/// Registry of live relays by name; a relay disappears with its last client.
+fn relays() -> &'static Mutex<HashMap<String, Weak<Relay>>> {
+    static RELAYS: OnceLock<Mutex<HashMap<String, Weak<Relay>>>> = OnceLock::new();
+    RELAYS.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+fn lock<T>(mutex: &Mutex<T>) -> MutexGuard<'_, T> {
+    mutex.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// Splits `sim://name?seed=N` into the relay name and seed, or None for other schemes.
+pub fn parse_url(url: &str) -> Option<Result<(String, u64), String>> {
+    let rest = url.strip_prefix("sim://")?;
+    let (name, query) = match rest.split_once('?') {
+        Some((name, query)) => (name, Some(query)),
+        None => (rest, None),
+    };
+    let name = name.trim_end_matches('/');
+    if name.is_empty() {
+        return Some(Err("Simulated relay URL needs a name, e.g. sim://relay".to_string()));
+    }
+    let mut seed = 0;
+    for param in query.into_iter().flat_map(|q| q.split('&')) {
+        match param.split_once('=') {
+            Some(("seed", value)) => match value.parse() {
+                Ok(value) => seed = value,
+                Err(_) => return Some(Err(format!("Invalid seed: {}", value))),
+            },
+            _ => return Some(Err(format!("Unknown simulated relay parameter: {}", param))),
+        }
+    }
+    Some(Ok((name.to_string(), seed)))
+}
+
+/// Returns the live relay named by `url`, if any client is connected to it.
+pub fn find(url: &str) -> Option<Arc<Relay>> {
+    let (name, _) = parse_url(url)?.ok()?;
+    lock(relays()).get(&name).and_then(Weak::upgrade)
+}
+
+/// SplitMix64: small, fast and reproducible across platforms.
+struct Rng(u64);
+
+impl Rng {
+    fn next_u64(&mut self) -> u64 {
+        self.0 = self.0.wrapping_add(0x9E37_79B9_7F4A_7C15);
+        let mut z = self.0;
+        z = (z ^ (z >> 30)).wrapping_mul(0xBF58_476D_1CE4_E5B9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94D0_49BB_1331_11EB);
+        z ^ (z >> 31)
+    }
+
+    fn chance(&mut self, probability: f64) -> bool {
+        probability > 0.0 && ((self.next_u64() >> 11) as f64 / (1u64 << 53) as f64) < probability
+    }
+
+    fn up_to(&mut self, max: u64) -> u64 {
+        if max == 0 { 0 } else { self.next_u64() % (max + 1) }
+    }
+}
+
+struct Link {
+    config: LinkConfig,
+    /// Virtual time at which the link finishes sending what is queued on it
+    busy_until_us: u64,
+}
+
+impl Link {
+    fn new(config: LinkConfig) -> Self {
+        Self { config, busy_until_us: 0 }
+    }
+
+    /// Queues `len` bytes at `now_us`; returns the arrival time, or None if a datagram is lost.
+    ///
+    /// Reliable objects are never lost: each loss costs a retransmission round trip instead.
+    fn transmit(&mut self, now_us: u64, len: usize, reliable: bool, rng: &mut Rng) -> Option<u64> {
+        let start = now_us.max(self.busy_until_us);
+        let serialization = match self.config.bandwidth_bps {
+            0 => 0,
+            bps => (len as u64 * 8 * 1_000_000).div_ceil(bps),
+        };
+        self.busy_until_us = start + serialization;
+        let mut arrival = self.busy_until_us + self.config.latency_us + rng.up_to(self.config.jitter_us);
+        while rng.chance(self.config.loss) {
+            if !reliable {
+                return None;
+            }
+            arrival += (2 * self.config.latency_us).max(MIN_RETRANSMIT_US);
+        }
+        Some(arrival)
+    }
+}
+
+#[derive(Clone, PartialEq, Eq, Hash)]
+struct TrackKey {
+    namespace: String,
+    track: String,
+}
+
+struct ClientEntry {
+    uplink: Link,
+    downlink: Link,
+    announce: Option<AnnounceHandler>,
+    namespaces: HashSet<String>,
+    /// Arrival time of the last reliable object sent per track, to keep stream order
+    stream_tail_us: HashMap<TrackKey, u64>,
+    /// Arrival time of the last object sent up to the relay
+    uplink_tail_us: u64,
+    /// Closing gracefully: no new work, but what is in flight still arrives
+    closing: bool,
+}
+
+struct Route {
+    client: u64,
+    track: TrackKey,
+    handler: ObjectHandler,
+    batching: Option<Batching>,
+    pending: Vec<Object>,
+    /// Bumped on every flush so stale flush timers are ignored
+    generation: u64,
+    stream_tail_us: u64,
+}
+
+struct TimerEntry {
+    client: u64,
+    interval_us: u64,
+    handler: TimerHandler,
+}
+
+enum EventKind {
+    ObjectAtRelay { publisher: u64, track: TrackKey, object: Object, reliable: bool, delivery: Arc<Delivery> },
+    ObjectAtSubscriber { subscription: u64, object: Object },
+    FlushBatch { subscription: u64, generation: u64 },
+    TrackAtRelay { publisher: u64, track: TrackKey },
+    TrackAtClient { client: u64, track: TrackKey },
+    Timer { timer: u64 },
+    ClientClosed { client: u64 },
+    AckWait { client: u64, delivery: Arc<Delivery>, published: u64, handler: AckHandler },
+}
+
+struct Event {
+    at_us: u64,
+    seq: u64,
+    kind: EventKind,
+}
+
+impl PartialEq for Event {
+    fn eq(&self, other: &Self) -> bool {
+        (self.at_us, self.seq) == (other.at_us, other.seq)
+    }
+}
+
+impl Eq for Event {}
+
+impl PartialOrd for Event {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for Event {
+    fn cmp(&self, other: &Self) -> Ordering {
+        (self.at_us, self.seq).cmp(&(other.at_us, other.seq))
+    }
+}
+
+/// Callback work taken out of the relay lock before it runs.
+enum Dispatch {
+    Objects(ObjectHandler, Vec<Object>),
+    Announce(AnnounceHandler, TrackKey),
+    Timer(TimerHandler),
+    Acked(AckHandler, AckOutcome),
+}
+
+struct State {
+    now_us: u64,
+    next_seq: u64,
+    next_id: u64,
+    rng: Rng,
+    events: BinaryHeap<Reverse<Event>>,
+    clients: HashMap<u64, ClientEntry>,
+    subscriptions: HashMap<u64, Route>,
+    timers: HashMap<u64, TimerEntry>,
+    /// Tracks the relay has learned about, in announcement order
+    tracks: Vec<TrackKey>,
+}
+
+impl State {
+    fn schedule(&mut self, at_us: u64, kind: EventKind) {
+        let seq = self.next_seq;
+        self.next_seq += 1;
+        self.events.push(Reverse(Event { at_us, seq, kind }));
+    }
+
+    fn allocate_id(&mut self) -> u64 {
+        self.next_id += 1;
+        self.next_id
+    }
+
+    /// Sends `object` from the relay down to `subscription`'s client.
+    fn forward(&mut self, id: u64, object: Object, reliable: bool) {
+        let now = self.now_us;
+        let Some(subscription) = self.subscriptions.get(&id) else { return };
+        let client = subscription.client;
+        let Some(entry) = self.clients.get_mut(&client) else { return };
+        let Some(mut arrival) = entry.downlink.transmit(now, object.payload.len(), reliable, &mut self.rng) else {
+            return;
+        };
+        if reliable {
+            let subscription = self.subscriptions.get_mut(&id).expect("subscription");
+            arrival = arrival.max(subscription.stream_tail_us);
+            subscription.stream_tail_us = arrival;
+        }
+        self.schedule(arrival, EventKind::ObjectAtSubscriber { subscription: id, object });
+    }
+
+    fn announce_to(&mut self, client: u64, track: TrackKey) {
+        let now = self.now_us;
+        if let Some(entry) = self.clients.get(&client) {
+            let at = now + entry.downlink.config.latency_us;
+            self.schedule(at, EventKind::TrackAtClient { client, track });
+        }
+    }
+
+    fn take_batch(subscription: &mut Route) -> Dispatch {
+        subscription.generation += 1;
+        Dispatch::Objects(subscription.handler.clone(), std::mem::take(&mut subscription.pending))
+    }
+
+    fn process(&mut self, kind: EventKind) -> Option<Dispatch> {
+        match kind {
+            EventKind::ObjectAtRelay { publisher, track, object, reliable, delivery } => {
+                // Whatever a client had not finished sending is lost when it disconnects
+                if !self.clients.contains_key(&publisher) {
+                    return None;
+                }
+                delivery.acked.fetch_add(object.payload.len() as u64, AtomicOrdering::Relaxed);
+                let mut targets: Vec<u64> = self
+                    .subscriptions
+                    .iter()
+                    .filter(|(_, s)| s.track == track)
+                    .map(|(&id, _)| id)
+                    .collect();
+                // HashMap order is random; fan out in subscription order for determinism
+                targets.sort_unstable();
+                for id in targets {
+                    self.forward(id, object.clone(), reliable);
+                }
+                None
+            }
+            EventKind::ObjectAtSubscriber { subscription, mut object } => {
+                let now = self.now_us;
+                object.arrival_us = now;
+                let subscription_id = subscription;
+                let subscription = self.subscriptions.get_mut(&subscription_id)?;
+                let Some(batching) = subscription.batching else {
+                    return Some(Dispatch::Objects(subscription.handler.clone(), vec![object]));
+                };
+                subscription.pending.push(object);
+                if subscription.pending.len() >= batching.max_objects.max(1) {
+                    return Some(Self::take_batch(subscription));
+                }
+                if subscription.pending.len() == 1 {
+                    let generation = subscription.generation;
+                    self.schedule(
+                        now + batching.max_delay_us,
+                        EventKind::FlushBatch { subscription: subscription_id, generation },
+                    );
+                }
+                None
+            }
+            EventKind::FlushBatch { subscription, generation } => {
+                let subscription = self.subscriptions.get_mut(&subscription)?;
+                if subscription.generation != generation || subscription.pending.is_empty() {
+                    return None;
+                }
+                Some(Self::take_batch(subscription))
+            }
+            EventKind::TrackAtRelay { publisher, track } => {
+                if !self.tracks.contains(&track) {
+                    self.tracks.push(track.clone());
+                }
+                let mut listeners: Vec<u64> = self
+                    .clients
+                    .iter()
+                    .filter(|(&id, c)| id != publisher && c.announce.is_some())
+                    .map(|(&id, _)| id)
+                    .collect();
+                listeners.sort_unstable();
+                for client in listeners {
+                    self.announce_to(client, track.clone());
+                }
+                None
+            }
+            EventKind::TrackAtClient { client, track } => {
+                let handler = self.clients.get(&client)?.announce.clone()?;
+                Some(Dispatch::Announce(handler, track))
+            }
+            EventKind::Timer { timer } => {
+                let entry = self.timers.get(&timer)?;
+                let (at, handler) = (self.now_us + entry.interval_us, entry.handler.clone());
+                self.schedule(at, EventKind::Timer { timer });
+                Some(Dispatch::Timer(handler))
+            }
+            EventKind::ClientClosed { client } => {
+                self.clients.remove(&client);
+                None
+            }
+            EventKind::AckWait { client, delivery, published, handler } => {
+                let outcome = if delivery.acked.load(AtomicOrdering::Relaxed) >= published {
+                    AckOutcome::Acked
+                } else if self.clients.contains_key(&client) {
+                    AckOutcome::TimedOut
+                } else {
+                    AckOutcome::Disconnected
+                };
+                Some(Dispatch::Acked(handler, outcome))
+            }
+        }
+    }
+}
+
+/// An in-memory relay with its own virtual clock.
+pub struct Relay {
+    name: String,
+    state: Mutex<State>,
+}
+
+impl Relay {
+    /// Connects a client to the relay named `name`, creating the relay if needed.
+    ///
+    /// `seed` only takes effect when the relay is created.
+    pub fn connect(name: &str, seed: u64, uplink: LinkConfig, downlink: LinkConfig) -> Session {
+        let relay = {
+            let mut registry = lock(relays());
+            registry.retain(|_, relay| relay.strong_count() > 0);
+            match registry.get(name).and_then(Weak::upgrade) {
+                Some(relay) => relay,
+                None => {
+                    let relay = Arc::new(Relay {
+                        name: name.to_string(),
+                        state: Mutex::new(State {
+                            now_us: 0,
+                            next_seq: 0,
+                            next_id: 0,
+                            rng: Rng(seed),
+                            events: BinaryHeap::new(),
+                            clients: HashMap::new(),
+                            subscriptions: HashMap::new(),
+                            timers: HashMap::new(),
+                            tracks: Vec::new(),
+                        }),
+                    });
+                    registry.insert(name.to_string(), Arc::downgrade(&relay));
+                    relay
+                }
+            }
+        };
+        let id = {
+            let mut state = lock(&relay.state);
+            let id = state.allocate_id();
+            state.clients.insert(
+                id,
+                ClientEntry {
+                    uplink: Link::new(uplink),
+                    downlink: Link::new(downlink),
+                    announce: None,
+                    namespaces: HashSet::new(),
+                    stream_tail_us: HashMap::new(),
+                    uplink_tail_us: 0,
+                    closing: false,
+                },
+            );
+            id
+        };
+        log::debug!("Client {} connected to simulated relay {}", id, name);
+        Session { relay, id }
+    }
+
+    /// Current virtual time in microseconds.
+    pub fn now_us(&self) -> u64 {
+        lock(&self.state).now_us
+    }
+
+    /// Moves the virtual clock forward by `duration_us`, running every event that falls due.
+    ///
+    /// Receivers are called on this thread without the relay lock held, so they may
+    /// publish or subscribe; anything they schedule inside the window also runs.
+    /// Returns the number of objects delivered to subscribers.
+    pub fn advance(&self, duration_us: u64) -> u64 {
+        let target = lock(&self.state).now_us.saturating_add(duration_us);
+        let mut delivered = 0;
+        loop {
+            let dispatch = {
+                let mut state = lock(&self.state);
+                match state.events.peek() {
+                    Some(Reverse(event)) if event.at_us <= target => {
+                        let Reverse(event) = state.events.pop().expect("peeked event");
+                        state.now_us = event.at_us;
+                        state.process(event.kind)
+                    }
+                    _ => {
+                        state.now_us = target;
+                        break;
+                    }
+                }
+            };
+            match dispatch {
+                Some(Dispatch::Objects(handler, objects)) => {
+                    delivered += objects.len() as u64;
+                    handler(&objects);
+                }
+                Some(Dispatch::Announce(handler, track)) => handler(&track.namespace, &track.track),
+                Some(Dispatch::Timer(handler)) => handler(),
+                Some(Dispatch::Acked(handler, outcome)) => handler(outcome),
+                None => {}
+            }
+        }
+        delivered
+    }
+}
+
+/// A client's connection to a relay; dropping it disconnects the client.
+pub struct Session {
+    relay: Arc<Relay>,
+    id: u64,
+}
+
+impl Session {
+    pub fn relay(&self) -> &Arc<Relay> {
+        &self.relay
+    }
+
+    /// Replaces the link characteristics; objects already in flight keep their arrival times.
+    pub fn set_links(&self, uplink: LinkConfig, downlink: LinkConfig) {
+        if let Some(entry) = lock(&self.relay.state).clients.get_mut(&self.id) {
+            entry.uplink.config = uplink;
+            entry.downlink.config = downlink;
+        }
+    }
+
+    pub fn announce(&self, namespace: &str) -> Result<(), SimError> {
+        let mut state = lock(&self.relay.state);
+        let entry = state.clients.get_mut(&self.id).ok_or(SimError::NotConnected)?;
+        entry.namespaces.insert(namespace.to_string());
+        Ok(())
+    }
+
+    /// Installs (or with None removes) the handler for tracks published by other clients.
+    ///
+    /// A new handler is also told about every track the relay already knows.
+    pub fn set_announce_handler(&self, handler: Option<AnnounceHandler>) {
+        let mut state = lock(&self.relay.state);
+        let Some(entry) = state.clients.get_mut(&self.id) else { return };
+        let replay = handler.is_some();
+        entry.announce = handler;
+        if replay {
+            let known: Vec<TrackKey> = state.tracks.clone();
+            for track in known {
+                state.announce_to(self.id, track);
+            }
+        }
+    }
+
+    pub fn create_publisher(&self, namespace: &str, track: &str, reliable: bool) -> Result<Publisher, SimError> {
+        let mut state = lock(&self.relay.state);
+        let now = state.now_us;
+        let entry = state.clients.get(&self.id).ok_or(SimError::NotConnected)?;
+        if !entry.namespaces.contains(namespace) {
+            return Err(SimError::NotAnnounced);
+        }
+        let key = TrackKey { namespace: namespace.to_string(), track: track.to_string() };
+        let at = now + entry.uplink.config.latency_us;
+        state.schedule(at, EventKind::TrackAtRelay { publisher: self.id, track: key.clone() });
+        Ok(Publisher {
+            relay: Arc::clone(&self.relay),
+            client: self.id,
+            track: key,
+            reliable,
+            next_id: Mutex::new(0),
+            timestamps: AtomicBool::new(false),
+            delivery: Arc::default(),
+        })
+    }
+
+    pub fn subscribe(
+        &self,
+        namespace: &str,
+        track: &str,
+        handler: ObjectHandler,
+        batching: Option<Batching>,
+    ) -> Result<Subscription, SimError> {
+        let mut state = lock(&self.relay.state);
+        if !state.clients.contains_key(&self.id) {
+            return Err(SimError::NotConnected);
+        }
+        let id = state.allocate_id();
+        state.subscriptions.insert(
+            id,
+            Route {
+                client: self.id,
+                track: TrackKey { namespace: namespace.to_string(), track: track.to_string() },
+                handler,
+                batching,
+                pending: Vec::new(),
+                generation: 0,
+                stream_tail_us: 0,
+            },
+        );
+        Ok(Subscription { relay: Arc::downgrade(&self.relay), id })
+    }
+
+    /// Calls `handler` every `interval_us` of virtual time, starting one
+    /// interval from now, until the timer or the session is dropped.
+    pub fn start_timer(&self, interval_us: u64, handler: TimerHandler) -> Result<Timer, SimError> {
+        let mut state = lock(&self.relay.state);
+        if !state.clients.contains_key(&self.id) {
+            return Err(SimError::NotConnected);
+        }
+        let id = state.allocate_id();
+        // A zero interval would never let the clock move past the tick
+        let interval_us = interval_us.max(1);
+        state.timers.insert(id, TimerEntry { client: self.id, interval_us, handler });
+        let at = state.now_us + interval_us;
+        state.schedule(at, EventKind::Timer { timer: id });
+        Ok(Timer { relay: Arc::downgrade(&self.relay), id })
+    }
+
+    /// Closes the session gracefully: subscriptions and timers stop now, but
+    /// objects already published keep travelling to the relay for up to
+    /// `deadline_us` of virtual time before the client is gone.
+    ///
+    /// Returns whether everything in flight reaches the relay by the deadline.
+    /// Drop the session afterwards; it stays registered until it has closed.
+    pub fn drain(&self, deadline_us: u64) -> bool {
+        let mut state = lock(&self.relay.state);
+        let now = state.now_us;
+        let id = self.id;
+        let Some(entry) = state.clients.get_mut(&id) else { return true };
+        entry.closing = true;
+        entry.announce = None;
+        let sent_at = entry.uplink_tail_us.max(now);
+        let deadline = now.saturating_add(deadline_us);
+        state.subscriptions.retain(|_, s| s.client != id);
+        state.timers.retain(|_, t| t.client != id);
+        state.schedule(sent_at.min(deadline), EventKind::ClientClosed { client: id });
+        sent_at <= deadline
+    }
+}
+
+impl Drop for Session {
+    fn drop(&mut self) {
+        let mut state = lock(&self.relay.state);
+        if !state.clients.get(&self.id).is_some_and(|c| c.closing) {
+            state.clients.remove(&self.id);
+        }
+        let id = self.id;
+        state.subscriptions.retain(|_, s| s.client != id);
+        state.timers.retain(|_, t| t.client != id);
+        log::debug!("Client {} disconnected from simulated relay {}", id, self.relay.name);
+    }
+}
+
+/// Publishing side of one track.
+pub struct Publisher {
+    relay: Arc<Relay>,
+    client: u64,
+    track: TrackKey,
+    reliable: bool,
+    next_id: Mutex<u64>,
+    timestamps: AtomicBool,
+    delivery: Arc<Delivery>,
+}
+
+/// Payload bytes a publisher has sent, and how many of them reached the relay.
+///
+/// The relay acknowledges an object as it arrives. Lost datagrams are not
+/// counted at all, as QUIC does not retransmit them.
+#[derive(Default)]
+struct Delivery {
+    published: AtomicU64,
+    acked: AtomicU64,
+    /// Arrival time of the last object sent
+    tail_us: AtomicU64,
+}
+
+impl Publisher {
+    /// Sends one object up to the relay at the current virtual time.
+    ///
+    /// Like the network backend, streams start a new group per object and
+    /// datagrams number their objects within group 0.
+    pub fn publish(&self, payload: &[u8]) -> Result<(), SimError> {
+        self.publish_stamped(payload, None, &[])
+    }
+
+    /// Current virtual time of the publisher's relay.
+    pub fn now_us(&self) -> u64 {
+        self.relay.now_us()
+    }
+
+    /// Stamps every object published without a capture time with the current virtual time.
+    pub fn set_timestamps(&self, enabled: bool) {
+        self.timestamps.store(enabled, AtomicOrdering::Relaxed);
+    }
+
+    /// Sends one object with `extensions`, stamped with `capture_time_us`,
+    /// else the capture time among the extensions, else the current virtual
+    /// time if timestamps are on.
+    pub fn publish_stamped(
+        &self,
+        payload: &[u8],
+        capture_time_us: Option<u64>,
+        extensions: &[Extension],
+    ) -> Result<(), SimError> {
+        let mut state = lock(&self.relay.state);
+        let now = state.now_us;
+        let capture_time_us = capture_time_us
+            .or_else(|| extensions.iter().find(|e| e.key == CAPTURE_TIMESTAMP).map(|e| e.value))
+            .or_else(|| self.timestamps.load(AtomicOrdering::Relaxed).then_some(now));
+        let extensions: Arc<[Extension]> = capture_time_us
+            .map(|value| Extension { key: CAPTURE_TIMESTAMP, value, data: Box::default() })
+            .into_iter()
+            .chain(extensions.iter().filter(|e| e.key != CAPTURE_TIMESTAMP).cloned())
+            .collect();
+        let State { clients, rng, .. } = &mut *state;
+        let entry = clients.get_mut(&self.client).filter(|c| !c.closing).ok_or(SimError::NotConnected)?;
+        let (group_id, object_id) = {
+            let mut next = lock(&self.next_id);
+            let id = *next;
+            *next += 1;
+            if self.reliable { (id, 0) } else { (0, id) }
+        };
+        let Some(mut arrival) = entry.uplink.transmit(now, payload.len(), self.reliable, rng) else {
+            return Ok(());
+        };
+        if self.reliable {
+            let tail = entry.stream_tail_us.entry(self.track.clone()).or_insert(0);
+            arrival = arrival.max(*tail);
+            *tail = arrival;
+        }
+        entry.uplink_tail_us = entry.uplink_tail_us.max(arrival);
+        self.delivery.published.fetch_add(payload.len() as u64, AtomicOrdering::Relaxed);
+        self.delivery.tail_us.fetch_max(arrival, AtomicOrdering::Relaxed);
+        let object = Object { group_id, object_id, payload: Arc::from(payload), capture_time_us, extensions, arrival_us: 0 };
+        state.schedule(
+            arrival,
+            EventKind::ObjectAtRelay {
+                publisher: self.client,
+                track: self.track.clone(),
+                object,
+                reliable: self.reliable,
+                delivery: Arc::clone(&self.delivery),
+            },
+        );
+        Ok(())
+    }
+
+    /// Payload bytes sent that have not reached the relay yet.
+    pub fn unacked_bytes(&self) -> u64 {
+        let published = self.delivery.published.load(AtomicOrdering::Relaxed);
+        published - self.delivery.acked.load(AtomicOrdering::Relaxed)
+    }
+
+    /// True until the publisher's client disconnects.
+    pub fn is_connected(&self) -> bool {
+        lock(&self.relay.state).clients.get(&self.client).is_some_and(|c| !c.closing)
+    }
+
+    /// Calls `handler` once everything published so far has reached the
+    /// relay, or after `deadline_us` of virtual time if it has not by then.
+    /// Runs it at once, on this thread, if nothing is outstanding.
+    pub fn on_acked(&self, deadline_us: u64, handler: AckHandler) {
+        let mut state = lock(&self.relay.state);
+        let published = self.delivery.published.load(AtomicOrdering::Relaxed);
+        if self.delivery.acked.load(AtomicOrdering::Relaxed) >= published {
+            drop(state);
+            return handler(AckOutcome::Acked);
+        }
+        let now = state.now_us;
+        let at = self.delivery.tail_us.load(AtomicOrdering::Relaxed).max(now).min(now.saturating_add(deadline_us));
+        let (client, delivery) = (self.client, Arc::clone(&self.delivery));
+        state.schedule(at, EventKind::AckWait { client, delivery, published, handler });
+    }
+}
+
+/// Receiving side of one track; dropping it stops delivery.
+pub struct Subscription {
+    relay: Weak<Relay>,
+    id: u64,
+}
+
+impl Subscription {
+    /// True until the subscription is dropped or its client disconnects.
+    pub fn is_active(&self) -> bool {
+        self.relay.upgrade().is_some_and(|relay| lock(&relay.state).subscriptions.contains_key(&self.id))
+    }
+
+    /// Switches between per-object delivery (None) and batched delivery.
+    pub fn set_batching(&self, batching: Option<Batching>) {
+        if let Some(relay) = self.relay.upgrade() {
+            if let Some(route) = lock(&relay.state).subscriptions.get_mut(&self.id) {
+                route.batching = batching;
+            }
+        }
+    }
+}
+
+impl Drop for Subscription {
+    fn drop(&mut self) {
+        if let Some(relay) = self.relay.upgrade() {
+            lock(&relay.state).subscriptions.remove(&self.id);
+        }
+    }
+}
+
+/// A periodic virtual-time callback; dropping it stops the ticks.
+pub struct Timer {
+    relay: Weak<Relay>,
+    id: u64,
+}
+
+impl Drop for Timer {
+    fn drop(&mut self) {
+        if let Some(relay) = self.relay.upgrade() {
+            lock(&relay.state).timers.remove(&self.id);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    type Received = Arc<Mutex<Vec<(u64, u64, Vec<u8>)>>>;
+
+    fn collector() -> (ObjectHandler, Received) {
+        let received: Received = Arc::new(Mutex::new(Vec::new()));
+        let sink = Arc::clone(&received);
+        let handler: ObjectHandler = Arc::new(move |objects: &[Object]| {
+            let mut sink = sink.lock().unwrap();
+            for o in objects {
+                sink.push((o.group_id, o.object_id, o.payload.to_vec()));
+            }
+        });
+        (handler, received)
+    }
+
+    fn link(latency_us: u64) -> LinkConfig {
+        LinkConfig { latency_us, ..LinkConfig::default() }
+    }
+
+    #[test]
+    fn test_parse_url() {
+        assert_eq!(parse_url("sim://relay"), Some(Ok(("relay".to_string(), 0))));
+        assert_eq!(parse_url("sim://relay/?seed=7"), Some(Ok(("relay".to_string(), 7))));
+        assert!(parse_url("sim://").unwrap().is_err());
+        assert!(parse_url("sim://relay?seed=x").unwrap().is_err());
+        assert!(parse_url("https://relay").is_none());
+    }
+
+    #[test]
+    fn test_latency_follows_virtual_clock() {
+        let publisher_session = Relay::connect("sim-test-latency", 0, link(10_000), link(0));
+        let subscriber_session = Relay::connect("sim-test-latency", 0, link(0), link(5_000));
+        let relay = Arc::clone(publisher_session.relay());
+
+        let (handler, received) = collector();
+        let _sub = subscriber_session.subscribe("ns", "t", handler, None).unwrap();
+        publisher_session.announce("ns").unwrap();
+        let publisher = publisher_session.create_publisher("ns", "t", true).unwrap();
+        publisher.publish(b"a").unwrap();
+
+        assert_eq!(relay.advance(14_999), 0);
+        assert_eq!(relay.advance(1), 1);
+        assert_eq!(relay.now_us(), 15_000);
+        assert_eq!(received.lock().unwrap()[0], (0, 0, b"a".to_vec()));
+    }
+
+    #[test]
+    fn test_bandwidth_serializes_objects() {
+        let uplink = LinkConfig { bandwidth_bps: 8_000_000, ..LinkConfig::default() };
+        let session = Relay::connect("sim-test-bandwidth", 0, uplink, link(0));
+        let (handler, received) = collector();
+        let _sub = session.subscribe("ns", "t", handler, None).unwrap();
+        session.announce("ns").unwrap();
+        let publisher = session.create_publisher("ns", "t", false).unwrap();
+        // 1000 bytes at 1 MB/s take 1 ms each
+        for _ in 0..3 {
+            publisher.publish(&[0u8; 1000]).unwrap();
+        }
+        session.relay().advance(2_000);
+        assert_eq!(received.lock().unwrap().len(), 2);
+        session.relay().advance(1_000);
+        let ids: Vec<u64> = received.lock().unwrap().iter().map(|r| r.1).collect();
+        assert_eq!(ids, vec![0, 1, 2]);
+    }
+
+    #[test]
+    fn test_loss_is_deterministic_and_reliable_streams_recover() {
+        let run = |reliable: bool| {
+            let lossy = LinkConfig { loss: 0.3, latency_us: 1_000, ..LinkConfig::default() };
+            let session = Relay::connect(&format!("sim-test-loss-{}", reliable), 42, lossy, link(0));
+            let (handler, received) = collector();
+            let _sub = session.subscribe("ns", "t", handler, None).unwrap();
+            session.announce("ns").unwrap();
+            let publisher = session.create_publisher("ns", "t", reliable).unwrap();
+            for i in 0..200u8 {
+                publisher.publish(&[i]).unwrap();
+            }
+            session.relay().advance(10_000_000);
+            let payloads: Vec<u8> = received.lock().unwrap().iter().map(|r| r.2[0]).collect();
+            payloads
+        };
+        let datagrams = run(false);
+        assert!(datagrams.len() > 100 && datagrams.len() < 180, "{} delivered", datagrams.len());
+        assert_eq!(datagrams, run(false));
+        assert_eq!(run(true), (0..200u8).collect::<Vec<_>>());
+    }
+
+    #[test]
+    fn test_batching_flushes_on_count_and_delay() {
+        let session = Relay::connect("sim-test-batching", 0, link(0), link(0));
+        let batches: Arc<Mutex<Vec<usize>>> = Arc::new(Mutex::new(Vec::new()));
+        let sink = Arc::clone(&batches);
+        let handler: ObjectHandler = Arc::new(move |objects: &[Object]| sink.lock().unwrap().push(objects.len()));
+        let batching = Batching { max_objects: 4, max_delay_us: 500 };
+        let _sub = session.subscribe("ns", "t", handler, Some(batching)).unwrap();
+        session.announce("ns").unwrap();
+        let publisher = session.create_publisher("ns", "t", false).unwrap();
+        for _ in 0..6 {
+            publisher.publish(b"x").unwrap();
+        }
+        session.relay().advance(499);
+        assert_eq!(*batches.lock().unwrap(), vec![4]);
+        session.relay().advance(1);
+        assert_eq!(*batches.lock().unwrap(), vec![4, 2]);
+    }
+
+    #[test]
+    fn test_announces_reach_other_clients() {
+        let publisher_session = Relay::connect("sim-test-announce", 0, link(100), link(0));
+        let listener_session = Relay::connect("sim-test-announce", 0, link(0), link(200));
+        let seen: Arc<Mutex<Vec<String>>> = Arc::new(Mutex::new(Vec::new()));
+        let sink = Arc::clone(&seen);
+        listener_session.set_announce_handler(Some(Arc::new(move |ns: &str, track: &str| {
+            sink.lock().unwrap().push(format!("{}/{}", ns, track));
+        })));
+
+        assert_eq!(publisher_session.create_publisher("ns", "t", true).err(), Some(SimError::NotAnnounced));
+        publisher_session.announce("ns").unwrap();
+        let _publisher = publisher_session.create_publisher("ns", "t", true).unwrap();
+        publisher_session.relay().advance(299);
+        assert!(seen.lock().unwrap().is_empty());
+        publisher_session.relay().advance(1);
+        assert_eq!(*seen.lock().unwrap(), vec!["ns/t".to_string()]);
+    }
+
+    #[test]
+    fn test_timer_ticks_on_virtual_clock() {
+        let session = Relay::connect("sim-test-timer", 0, link(0), link(0));
+        let ticks: Arc<Mutex<Vec<u64>>> = Arc::new(Mutex::new(Vec::new()));
+        let sink = Arc::clone(&ticks);
+        let relay = Arc::clone(session.relay());
+        let timer = session
+            .start_timer(1_000, Arc::new(move || sink.lock().unwrap().push(relay.now_us())))
+            .unwrap();
+        session.relay().advance(3_500);
+        assert_eq!(*ticks.lock().unwrap(), vec![1_000, 2_000, 3_000]);
+        drop(timer);
+        session.relay().advance(5_000);
+        assert_eq!(ticks.lock().unwrap().len(), 3);
+    }
+
+    #[test]
+    fn test_disconnect_stops_publishing() {
+        let session = Relay::connect("sim-test-disconnect", 0, link(0), link(0));
+        session.announce("ns").unwrap();
+        let publisher = session.create_publisher("ns", "t", true).unwrap();
+        drop(session);
+        assert_eq!(publisher.publish(b"x"), Err(SimError::NotConnected));
+    }
+
+    #[test]
+    fn test_acknowledgement_waits() {
+        let session = Relay::connect("sim-test-acks", 0, link(10_000), link(0));
+        session.announce("ns").unwrap();
+        let publisher = session.create_publisher("ns", "t", true).unwrap();
+        let outcomes = Arc::new(Mutex::new(Vec::new()));
+        let record = || -> AckHandler {
+            let outcomes = Arc::clone(&outcomes);
+            Box::new(move |outcome| outcomes.lock().unwrap().push(outcome))
+        };
+
+        publisher.on_acked(0, record());
+        assert_eq!(*outcomes.lock().unwrap(), [AckOutcome::Acked], "nothing outstanding");
+
+        publisher.publish(b"four").unwrap();
+        publisher.publish(b"five!").unwrap();
+        assert_eq!(publisher.unacked_bytes(), 9);
+        publisher.on_acked(5_000, record());
+        publisher.on_acked(20_000, record());
+        session.relay().advance(9_999);
+        assert_eq!(publisher.unacked_bytes(), 9);
+        session.relay().advance(1);
+        assert_eq!(publisher.unacked_bytes(), 0);
+        assert_eq!(*outcomes.lock().unwrap(), [AckOutcome::Acked, AckOutcome::TimedOut, AckOutcome::Acked]);
+
+        publisher.publish(b"lost").unwrap();
+        publisher.on_acked(20_000, record());
+        let relay = Arc::clone(session.relay());
+        drop(session);
+        relay.advance(20_000);
+        assert_eq!(outcomes.lock().unwrap().last(), Some(&AckOutcome::Disconnected));
+        assert_eq!(publisher.unacked_bytes(), 4);
+    }
+
+    #[test]
+    fn test_drain_delivers_what_is_in_flight() {
+        let publishing = |name: &str| {
+            let session = Relay::connect(name, 0, link(10_000), link(0));
+            session.announce("ns").unwrap();
+            let publisher = session.create_publisher("ns", "t", true).unwrap();
+            let viewer = Relay::connect(name, 0, link(0), link(0));
+            let (handler, received) = collector();
+            let subscription = viewer.subscribe("ns", "t", handler, None).unwrap();
+            publisher.publish(b"last words").unwrap();
+            (session, publisher, viewer, subscription, received)
+        };
+
+        // Cut off mid-flight, the object never reaches the relay
+        let (session, _publisher, viewer, _subscription, received) = publishing("sim-test-abrupt");
+        drop(session);
+        viewer.relay().advance(20_000);
+        assert!(received.lock().unwrap().is_empty());
+
+        // Drained, it does, and the publisher is closed meanwhile
+        let (session, publisher, viewer, _subscription, received) = publishing("sim-test-drain");
+        assert!(session.drain(50_000));
+        drop(session);
+        assert_eq!(publisher.publish(b"x"), Err(SimError::NotConnected));
+        viewer.relay().advance(20_000);
+        assert_eq!(received.lock().unwrap().len(), 1);
+
+        // A deadline shorter than the flight loses it again
+        let (session, _publisher, viewer, _subscription, received) = publishing("sim-test-deadline");
+        assert!(!session.drain(5_000));
+        drop(session);
+        viewer.relay().advance(20_000);
+        assert!(received.lock().unwrap().is_empty());
+    }
+}
@@ -0,0 +1,212 @@
+// UDP segmentation offload for the client endpoint
+//
+// quinn batches datagrams through the kernel where the platform allows it:
+// with GSO a single sendmsg carries a run of equally sized datagrams that the
+// kernel (or NIC) splits (UDP_SEGMENT on Linux), with GRO a single receive
+// returns a run of datagrams the kernel coalesced, and receives are read in
+// batches through recvmmsg. Both offloads are on by default.
+//
+// `OffloadSocket` wraps whichever socket the endpoint uses and caps the
+// segment counts quinn sees, so either offload can be switched off per client
+// - to rule it out when a path misbehaves, or to measure what it buys - and
+// reports what is actually in effect for the transport stats. Turning GRO
+// off also clears UDP_GRO on the socket (Linux), since the kernel would
+// otherwise keep coalescing into buffers sized for single datagrams.
+
+use std::fmt;
+use std::io::{self, IoSliceMut};
+use std::net::SocketAddr;
+use std::pin::Pin;
+use std::sync::Arc;
+use std::task::{Context, Poll};
+
+use quinn::udp::{RecvMeta, Transmit};
+use quinn::{AsyncUdpSocket, Runtime, UdpPoller};
+
+/// Which offloads a socket may use.
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+pub struct UdpOffload {
+    /// Send runs of datagrams in one call (generic segmentation offload)
+    pub gso: bool,
+    /// Receive coalesced runs of datagrams in one call (generic receive offload)
+    pub gro: bool,
+}
+
+impl Default for UdpOffload {
+    fn default() -> Self {
+        UdpOffload { gso: true, gro: true }
+    }
+}
+
+/// quinn `AsyncUdpSocket` with per-socket offload switches (see the module
+/// comment).
+pub struct OffloadSocket {
+    inner: Arc<dyn AsyncUdpSocket>,
+    offload: UdpOffload,
+}
+
+impl fmt::Debug for OffloadSocket {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("OffloadSocket")
+            .field("inner", &self.inner)
+            .field("offload", &self.offload)
+            .finish()
+    }
+}
+
+impl OffloadSocket {
+    /// Binds quinn's default UDP socket. Must be called within a tokio runtime.
+    pub fn bind(addr: SocketAddr, offload: UdpOffload) -> io::Result<Self> {
+        let socket = std::net::UdpSocket::bind(addr)?;
+        #[cfg(target_os = "linux")]
+        let fd = std::os::fd::AsRawFd::as_raw_fd(&socket);
+        // Enables GRO where the kernel supports it
+        let inner = quinn::TokioRuntime.wrap_udp_socket(socket)?;
+        if !offload.gro && inner.max_receive_segments() > 1 {
+            #[cfg(target_os = "linux")]
+            disable_gro(fd)?;
+            #[cfg(not(target_os = "linux"))]
+            log::warn!("Receive offload cannot be turned off on this platform");
+        }
+        Ok(Self::wrap(inner, offload))
+    }
+
+    /// Applies the offload switches to an already bound socket, which must
+    /// not have GRO enabled unless `offload.gro` is set.
+    pub fn wrap(inner: Arc<dyn AsyncUdpSocket>, offload: UdpOffload) -> Self {
+        OffloadSocket { inner, offload }
+    }
+
+    /// Datagrams one send may carry; 1 when GSO is off or unsupported.
+    pub fn gso_segments(&self) -> usize {
+        self.max_transmit_segments()
+    }
+
+    /// Datagrams one receive may return; 1 when GRO is off or unsupported.
+    pub fn gro_segments(&self) -> usize {
+        self.max_receive_segments()
+    }
+}
+
+#[cfg(target_os = "linux")]
+fn disable_gro(fd: std::os::fd::RawFd) -> io::Result<()> {
+    let off: libc::c_int = 0;
+    // SAFETY: passes a c_int option value of the stated size
+    let ret = unsafe {
+        libc::setsockopt(
+            fd,
+            libc::SOL_UDP,
+            libc::UDP_GRO,
+            &off as *const libc::c_int as *const libc::c_void,
+            std::mem::size_of::<libc::c_int>() as libc::socklen_t,
+        )
+    };
+    if ret < 0 {
+        return Err(io::Error::last_os_error());
+    }
+    Ok(())
+}
+
+impl AsyncUdpSocket for OffloadSocket {
+    fn create_io_poller(self: Arc<Self>) -> Pin<Box<dyn UdpPoller>> {
+        self.inner.clone().create_io_poller()
+    }
+
+    fn try_send(&self, transmit: &Transmit) -> io::Result<()> {
+        self.inner.try_send(transmit)
+    }
+
+    fn poll_recv(
+        &self,
+        cx: &mut Context,
+        bufs: &mut [IoSliceMut<'_>],
+        meta: &mut [RecvMeta],
+    ) -> Poll<io::Result<usize>> {
+        self.inner.poll_recv(cx, bufs, meta)
+    }
+
+    fn local_addr(&self) -> io::Result<SocketAddr> {
+        self.inner.local_addr()
+    }
+
+    // Asked on every transmit, so a socket that drops GSO after a send error
+    // is reflected straight away
+    fn max_transmit_segments(&self) -> usize {
+        if self.offload.gso {
+            self.inner.max_transmit_segments()
+        } else {
+            1
+        }
+    }
+
+    fn max_receive_segments(&self) -> usize {
+        if self.offload.gro {
+            self.inner.max_receive_segments()
+        } else {
+            1
+        }
+    }
+
+    fn may_fragment(&self) -> bool {
+        self.inner.may_fragment()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::future::poll_fn;
+    use std::time::Duration;
+
+    fn runtime() -> tokio::runtime::Runtime {
+        tokio::runtime::Builder::new_current_thread().enable_all().build().unwrap()
+    }
+
+    #[test]
+    fn test_switched_off_offloads_report_one_segment() {
+        let rt = runtime();
+        let _guard = rt.enter();
+        let off = UdpOffload { gso: false, gro: false };
+        let socket = OffloadSocket::bind("127.0.0.1:0".parse().unwrap(), off).unwrap();
+        assert_eq!(socket.gso_segments(), 1);
+        assert_eq!(socket.gro_segments(), 1);
+
+        let on = OffloadSocket::bind("127.0.0.1:0".parse().unwrap(), UdpOffload::default()).unwrap();
+        let plain = quinn::TokioRuntime
+            .wrap_udp_socket(std::net::UdpSocket::bind("127.0.0.1:0").unwrap())
+            .unwrap();
+        assert_eq!(on.gso_segments(), plain.max_transmit_segments());
+        assert_eq!(on.gro_segments(), plain.max_receive_segments());
+    }
+
+    #[test]
+    fn test_gro_off_delivers_single_datagrams() {
+        let rt = runtime();
+        let _guard = rt.enter();
+        let off = UdpOffload { gso: true, gro: false };
+        let socket = OffloadSocket::bind("127.0.0.1:0".parse().unwrap(), off).unwrap();
+        let local = socket.local_addr().unwrap();
+        let peer = std::net::UdpSocket::bind("127.0.0.1:0").unwrap();
+        for i in 0..16u8 {
+            peer.send_to(&[i; 1000], local).unwrap();
+        }
+
+        rt.block_on(async {
+            let mut storage = vec![[0u8; 1500]; 8];
+            let mut meta = [RecvMeta::default(); 8];
+            let mut received = 0;
+            while received < 16 {
+                let mut bufs: Vec<IoSliceMut> = storage.iter_mut().map(|b| IoSliceMut::new(b)).collect();
+                let n = tokio::time::timeout(Duration::from_secs(5), poll_fn(|cx| socket.poll_recv(cx, &mut bufs, &mut meta)))
+                    .await
+                    .expect("datagrams should arrive")
+                    .unwrap();
+                for i in 0..n {
+                    assert_eq!((meta[i].len, meta[i].stride), (1000, 1000), "Datagrams must not be coalesced");
+                    assert_eq!(bufs[i][0], received as u8);
+                    received += 1;
+                }
+            }
+        });
+    }
+}
@@ -0,0 +1,423 @@
+// In-process UDP impairment proxy
+//
+// Sits between clients and a relay on the loopback interface and forwards
+// QUIC datagrams in both directions through a simulated link that applies
+// delay, jitter, random and burst loss, reordering and a bandwidth cap.
+// Every client address gets its own upstream socket, so the relay sees one
+// peer per client just as it would without the proxy.
+//
+// Random decisions come from a seeded generator, so a given configuration
+// impairs the same packets on every run.
+
+use std::cmp::Reverse;
+use std::collections::{BinaryHeap, HashMap};
+use std::io;
+use std::net::{SocketAddr, ToSocketAddrs, UdpSocket};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+const MAX_DATAGRAM: usize = 65_535;
+// How often blocked receive calls wake up to check for shutdown
+const POLL_INTERVAL: Duration = Duration::from_millis(50);
+
+/// Impairments applied to one direction of the link.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct LinkConfig {
+    /// One-way propagation delay
+    pub delay: Duration,
+    /// Uniform random variation of the delay, +/- this amount
+    pub jitter: Duration,
+    /// Probability of dropping any packet (0.0 - 1.0)
+    pub loss: f64,
+    /// Probability of entering the burst-loss state per packet (0 = no bursts)
+    pub burst_start: f64,
+    /// Probability of leaving the burst-loss state per packet
+    pub burst_end: f64,
+    /// Probability of holding a packet back by `reorder_delay` (0.0 - 1.0)
+    pub reorder: f64,
+    /// Extra delay of reordered packets
+    pub reorder_delay: Duration,
+    /// Link rate in bits per second (0 = unlimited)
+    pub bandwidth_bps: u64,
+    /// Packets queued for longer than this behind the bandwidth cap are dropped
+    pub max_queue_delay: Duration,
+}
+
+impl LinkConfig {
+    /// A perfect link.
+    pub const fn ideal() -> Self {
+        LinkConfig {
+            delay: Duration::ZERO,
+            jitter: Duration::ZERO,
+            loss: 0.0,
+            burst_start: 0.0,
+            burst_end: 1.0,
+            reorder: 0.0,
+            reorder_delay: Duration::ZERO,
+            bandwidth_bps: 0,
+            max_queue_delay: Duration::from_millis(500),
+        }
+    }
+}
+
+impl Default for LinkConfig {
+    fn default() -> Self {
+        Self::ideal()
+    }
+}
+
+/// Impairments of both directions.
+#[derive(Debug, Clone, Copy, PartialEq, Default)]
+pub struct ImpairmentConfig {
+    /// Client to relay
+    pub uplink: LinkConfig,
+    /// Relay to client
+    pub downlink: LinkConfig,
+    /// Seed of the random generator
+    pub seed: u64,
+}
+
+impl ImpairmentConfig {
+    /// The same impairments in both directions.
+    pub fn symmetric(link: LinkConfig, seed: u64) -> Self {
+        ImpairmentConfig { uplink: link, downlink: link, seed }
+    }
+}
+
+/// Packet counters of one direction.
+#[derive(Debug, Default)]
+pub struct LinkStats {
+    pub forwarded: AtomicU64,
+    pub lost: AtomicU64,
+    pub queue_dropped: AtomicU64,
+    pub reordered: AtomicU64,
+}
+
+impl LinkStats {
+    /// (forwarded, lost, queue dropped, reordered)
+    pub fn snapshot(&self) -> (u64, u64, u64, u64) {
+        (
+            self.forwarded.load(Ordering::Relaxed),
+            self.lost.load(Ordering::Relaxed),
+            self.queue_dropped.load(Ordering::Relaxed),
+            self.reordered.load(Ordering::Relaxed),
+        )
+    }
+}
+
+/// xorshift64* - small, fast and good enough for packet decisions.
+struct Rng(u64);
+
+impl Rng {
+    fn new(seed: u64) -> Self {
+        Rng(seed.wrapping_mul(0x9E37_79B9_7F4A_7C15) | 1)
+    }
+
+    fn next_f64(&mut self) -> f64 {
+        self.0 ^= self.0 >> 12;
+        self.0 ^= self.0 << 25;
+        self.0 ^= self.0 >> 27;
+        (self.0.wrapping_mul(0x2545_F491_4F6C_DD1D) >> 11) as f64 / (1u64 << 53) as f64
+    }
+
+    fn chance(&mut self, p: f64) -> bool {
+        p > 0.0 && self.next_f64() < p
+    }
+}
+
+/// State of one simulated direction.
+struct Link {
+    config: LinkConfig,
+    rng: Rng,
+    in_burst: bool,
+    // When the bandwidth-limited link finishes sending what is queued
+    busy_until: Instant,
+    stats: Arc<LinkStats>,
+}
+
+impl Link {
+    fn new(config: LinkConfig, seed: u64, stats: Arc<LinkStats>) -> Self {
+        Link {
+            config,
+            rng: Rng::new(seed),
+            in_burst: false,
+            busy_until: Instant::now(),
+            stats,
+        }
+    }
+
+    /// Decides when a packet of `len` bytes sent at `now` arrives, or None if it is lost.
+    fn schedule(&mut self, len: usize, now: Instant) -> Option<Instant> {
+        let c = self.config;
+
+        // Gilbert model: everything is lost while in the burst state
+        if self.in_burst {
+            self.in_burst = !self.rng.chance(c.burst_end);
+        } else {
+            self.in_burst = self.rng.chance(c.burst_start);
+        }
+        if self.in_burst || self.rng.chance(c.loss) {
+            self.stats.lost.fetch_add(1, Ordering::Relaxed);
+            return None;
+        }
+
+        let mut departure = now;
+        if c.bandwidth_bps > 0 {
+            let start = self.busy_until.max(now);
+            if start - now > c.max_queue_delay {
+                self.stats.queue_dropped.fetch_add(1, Ordering::Relaxed);
+                return None;
+            }
+            let transmit = Duration::from_secs_f64(len as f64 * 8.0 / c.bandwidth_bps as f64);
+            self.busy_until = start + transmit;
+            departure = self.busy_until;
+        }
+
+        let mut delay = c.delay;
+        if !c.jitter.is_zero() {
+            let offset = c.jitter.mul_f64(self.rng.next_f64() * 2.0);
+            delay = (delay + offset).saturating_sub(c.jitter);
+        }
+        if self.rng.chance(c.reorder) {
+            delay += c.reorder_delay;
+            self.stats.reordered.fetch_add(1, Ordering::Relaxed);
+        }
+        self.stats.forwarded.fetch_add(1, Ordering::Relaxed);
+        Some(departure + delay)
+    }
+}
+
+/// A packet waiting for its arrival time.
+struct Scheduled {
+    at: Instant,
+    seq: u64,
+    socket: Arc<UdpSocket>,
+    to: SocketAddr,
+    payload: Vec<u8>,
+}
+
+impl PartialEq for Scheduled {
+    fn eq(&self, other: &Self) -> bool {
+        (self.at, self.seq) == (other.at, other.seq)
+    }
+}
+
+impl Eq for Scheduled {}
+
+impl PartialOrd for Scheduled {
+    fn partial_cmp(&self, other: &Self) -> Option<std::cmp::Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl Ord for Scheduled {
+    fn cmp(&self, other: &Self) -> std::cmp::Ordering {
+        (self.at, self.seq).cmp(&(other.at, other.seq))
+    }
+}
+
+/// Packets in flight, released by the delivery thread at their arrival time.
+#[derive(Default)]
+struct DeliveryQueue {
+    heap: Mutex<(BinaryHeap<Reverse<Scheduled>>, u64)>,
+    wake: Condvar,
+}
+
+impl DeliveryQueue {
+    fn push(&self, at: Instant, socket: Arc<UdpSocket>, to: SocketAddr, payload: Vec<u8>) {
+        let mut guard = self.heap.lock().unwrap();
+        let (heap, seq) = &mut *guard;
+        *seq += 1;
+        heap.push(Reverse(Scheduled { at, seq: *seq, socket, to, payload }));
+        self.wake.notify_one();
+    }
+
+    fn run(&self, stop: &AtomicBool) {
+        let mut guard = self.heap.lock().unwrap();
+        while !stop.load(Ordering::Relaxed) {
+            let now = Instant::now();
+            let wait = match guard.0.peek() {
+                Some(Reverse(next)) if next.at <= now => {
+                    let Reverse(packet) = guard.0.pop().unwrap();
+                    drop(guard);
+                    let _ = packet.socket.send_to(&packet.payload, packet.to);
+                    guard = self.heap.lock().unwrap();
+                    continue;
+                }
+                Some(Reverse(next)) => (next.at - now).min(POLL_INTERVAL),
+                None => POLL_INTERVAL,
+            };
+            guard = self.wake.wait_timeout(guard, wait).unwrap().0;
+        }
+    }
+}
+
+/// Shared state of a running proxy.
+struct Shared {
+    listen: Arc<UdpSocket>,
+    upstream_addr: SocketAddr,
+    queue: DeliveryQueue,
+    uplink: Mutex<Link>,
+    downlink: Mutex<Link>,
+    stop: AtomicBool,
+}
+
+/// A UDP proxy on 127.0.0.1 that impairs traffic to and from `upstream`.
+///
+/// Connect clients to `https://localhost:{port()}` instead of the relay. The
+/// proxy stops when dropped.
+pub struct ImpairmentProxy {
+    shared: Arc<Shared>,
+    uplink_stats: Arc<LinkStats>,
+    downlink_stats: Arc<LinkStats>,
+    threads: Vec<JoinHandle<()>>,
+    client_threads: Arc<Mutex<Vec<JoinHandle<()>>>>,
+}
+
+impl ImpairmentProxy {
+    /// Starts a proxy forwarding to `upstream` (e.g. "127.0.0.1:4443").
+    pub fn start(upstream: impl ToSocketAddrs, config: ImpairmentConfig) -> io::Result<Self> {
+        let upstream_addr = upstream
+            .to_socket_addrs()?
+            .next()
+            .ok_or_else(|| io::Error::new(io::ErrorKind::InvalidInput, "no upstream address"))?;
+        let listen = Arc::new(UdpSocket::bind("127.0.0.1:0")?);
+        listen.set_read_timeout(Some(POLL_INTERVAL))?;
+
+        let uplink_stats = Arc::new(LinkStats::default());
+        let downlink_stats = Arc::new(LinkStats::default());
+        let shared = Arc::new(Shared {
+            listen,
+            upstream_addr,
+            queue: DeliveryQueue::default(),
+            uplink: Mutex::new(Link::new(config.uplink, config.seed, uplink_stats.clone())),
+            downlink: Mutex::new(Link::new(config.downlink, config.seed ^ 0xD0D0, downlink_stats.clone())),
+            stop: AtomicBool::new(false),
+        });
+        let client_threads = Arc::new(Mutex::new(Vec::new()));
+
+        let delivery = {
+            let shared = shared.clone();
+            thread::Builder::new()
+                .name("impairment-delivery".into())
+                .spawn(move || shared.queue.run(&shared.stop))?
+        };
+        let accept = {
+            let shared = shared.clone();
+            let client_threads = client_threads.clone();
+            thread::Builder::new()
+                .name("impairment-uplink".into())
+                .spawn(move || forward_uplink(&shared, &client_threads))?
+        };
+
+        Ok(ImpairmentProxy {
+            shared,
+            uplink_stats,
+            downlink_stats,
+            threads: vec![delivery, accept],
+            client_threads,
+        })
+    }
+
+    /// Address clients should send to.
+    pub fn local_addr(&self) -> SocketAddr {
+        self.shared.listen.local_addr().unwrap()
+    }
+
+    /// Port clients should connect to on localhost.
+    pub fn port(&self) -> u16 {
+        self.local_addr().port()
+    }
+
+    /// Changes the impairments while traffic is flowing (e.g. to simulate a handover).
+    pub fn reconfigure(&self, config: ImpairmentConfig) {
+        self.shared.uplink.lock().unwrap().config = config.uplink;
+        self.shared.downlink.lock().unwrap().config = config.downlink;
+    }
+
+    pub fn uplink_stats(&self) -> &LinkStats {
+        &self.uplink_stats
+    }
+
+    pub fn downlink_stats(&self) -> &LinkStats {
+        &self.downlink_stats
+    }
+}
+
+impl Drop for ImpairmentProxy {
+    fn drop(&mut self) {
+        self.shared.stop.store(true, Ordering::Relaxed);
+        self.shared.queue.wake.notify_all();
+        for handle in self.threads.drain(..) {
+            let _ = handle.join();
+        }
+        for handle in self.client_threads.lock().unwrap().drain(..) {
+            let _ = handle.join();
+        }
+    }
+}
+
+/// Receives from clients and schedules their packets towards the upstream.
+fn forward_uplink(shared: &Arc<Shared>, client_threads: &Mutex<Vec<JoinHandle<()>>>) {
+    let mut upstreams: HashMap<SocketAddr, Arc<UdpSocket>> = HashMap::new();
+    let mut buf = vec![0u8; MAX_DATAGRAM];
+    while !shared.stop.load(Ordering::Relaxed) {
+        let (len, client) = match shared.listen.recv_from(&mut buf) {
+            Ok(received) => received,
+            Err(e) if matches!(e.kind(), io::ErrorKind::WouldBlock | io::ErrorKind::TimedOut) => continue,
+            Err(_) => continue, // e.g. ICMP port unreachable reported on Windows
+        };
+
+        let upstream = match upstreams.get(&client) {
+            Some(socket) => socket.clone(),
+            None => match open_upstream(shared, client, client_threads) {
+                Ok(socket) => {
+                    upstreams.insert(client, socket.clone());
+                    socket
+                }
+                Err(e) => {
+                    eprintln!("impairment proxy: cannot open upstream socket for {}: {}", client, e);
+                    continue;
+                }
+            },
+        };
+
+        let now = Instant::now();
+        if let Some(at) = shared.uplink.lock().unwrap().schedule(len, now) {
+            shared.queue.push(at, upstream, shared.upstream_addr, buf[..len].to_vec());
+        }
+    }
+}
+
+/// Opens the upstream socket of a new client and starts relaying its replies.
+fn open_upstream(
+    shared: &Arc<Shared>,
+    client: SocketAddr,
+    client_threads: &Mutex<Vec<JoinHandle<()>>>,
+) -> io::Result<Arc<UdpSocket>> {
+    let bind = if shared.upstream_addr.is_ipv4() { "127.0.0.1:0" } else { "[::1]:0" };
+    let socket = Arc::new(UdpSocket::bind(bind)?);
+    socket.set_read_timeout(Some(POLL_INTERVAL))?;
+
+    let shared = shared.clone();
+    let upstream = socket.clone();
+    let handle = thread::Builder::new()
+        .name(format!("impairment-downlink-{}", client.port()))
+        .spawn(move || {
+            let mut buf = vec![0u8; MAX_DATAGRAM];
+            while !shared.stop.load(Ordering::Relaxed) {
+                let len = match upstream.recv_from(&mut buf) {
+                    Ok((len, from)) if from == shared.upstream_addr => len,
+                    _ => continue,
+                };
+                let now = Instant::now();
+                if let Some(at) = shared.downlink.lock().unwrap().schedule(len, now) {
+                    shared.queue.push(at, shared.listen.clone(), client, buf[..len].to_vec());
+                }
+            }
+        })?;
+    client_threads.lock().unwrap().push(handle);
+    Ok(socket)
+}
@@ -0,0 +1,92 @@
+// Shared helpers for the relay-backed benchmark tests
+//
+// Benchmarks connect to the relay named by MOQ_BENCH_RELAY_URL and skip when it
+// is not set, so their load never lands on a shared public relay by accident.
+
+#![allow(dead_code)]
+
+pub mod impairment;
+
+use std::ffi::{CStr, CString};
+use std::time::{SystemTime, UNIX_EPOCH};
+
+use moq_ffi::*;
+
+/// Returns the relay URL benchmarks should connect to, or None with a note
+/// that the benchmark is skipped when MOQ_BENCH_RELAY_URL is not set.
+pub fn relay_url() -> Option<String> {
+    match std::env::var("MOQ_BENCH_RELAY_URL") {
+        Ok(url) if !url.is_empty() => Some(url),
+        _ => {
+            println!("MOQ_BENCH_RELAY_URL is not set, skipping (point it at a relay you run, e.g. https://localhost:4443)");
+            None
+        }
+    }
+}
+
+/// Converts a `MoqResult` into a Rust result, freeing the FFI-owned message.
+pub fn check(result: MoqResult) -> Result<(), String> {
+    let message = if result.message.is_null() {
+        String::new()
+    } else {
+        let msg = unsafe { CStr::from_ptr(result.message).to_string_lossy().into_owned() };
+        unsafe { moq_free_str(result.message) };
+        msg
+    };
+    if result.code == MoqResultCode::MoqOk {
+        Ok(())
+    } else {
+        Err(format!("{:?}: {}", result.code, message))
+    }
+}
+
+/// Creates a client and connects it to `url`, returning None if the relay is unreachable.
+pub fn connect_client(url: &str) -> Option<*mut MoqClient> {
+    moq_init();
+    let client = moq_client_create();
+    if client.is_null() {
+        return None;
+    }
+    let url = CString::new(url).unwrap();
+    match check(unsafe { moq_connect(client, url.as_ptr(), None, std::ptr::null_mut()) }) {
+        Ok(()) => Some(client),
+        Err(e) => {
+            println!("Could not connect to {:?}: {}", url, e);
+            unsafe { moq_client_destroy(client) };
+            None
+        }
+    }
+}
+
+/// Disconnects and destroys a client created by `connect_client`.
+pub fn destroy_client(client: *mut MoqClient) {
+    unsafe {
+        let _ = check(moq_disconnect(client));
+        moq_client_destroy(client);
+    }
+}
+
+/// Returns a namespace that will not collide with other benchmark runs on a shared relay.
+pub fn unique_namespace(prefix: &str) -> String {
+    let nanos = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_nanos())
+        .unwrap_or(0);
+    format!("moq-ffi-bench/{}/{}", prefix, nanos)
+}
+
+/// Current resident set size of this process in bytes (Linux only).
+pub fn rss_bytes() -> Option<u64> {
+    let status = std::fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find(|l| l.starts_with("VmRSS:"))?;
+    let kb: u64 = line.split_whitespace().nth(1)?.parse().ok()?;
+    Some(kb * 1024)
+}
+
+/// Formats an optional byte count for benchmark reports.
+pub fn format_bytes(bytes: Option<i64>) -> String {
+    match bytes {
+        Some(b) => format!("{:.1} MiB", b as f64 / (1024.0 * 1024.0)),
+        None => "n/a".to_string(),
+    }
+}
@@ -0,0 +1,192 @@
+// Delivery under impaired networks
+//
+// Routes a publisher and a subscriber through the UDP impairment proxy
+// (common/impairment.rs) and publishes a paced track in datagram and stream
+// mode under several network profiles, reporting the share of objects
+// delivered and the end-to-end latency of those that arrived.
+//
+// The proxy listens on 127.0.0.1, so MOQ_BENCH_RELAY_URL must name a relay on
+// this machine, e.g. the one started by local_relay_integration.rs.
+//
+// To run:
+// ```
+// MOQ_BENCH_RELAY_URL=https://localhost:4443 \
+//   cargo test --release --features with_moq_draft07 --test impairment_benchmark -- --ignored --nocapture --test-threads=1
+// ```
+//
+// Note: Benchmarks are marked with #[ignore] because they need a reachable relay.
+
+#![cfg(feature = "with_moq_draft07")]
+
+mod common;
+
+use std::ffi::{c_void, CString};
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
+
+use common::impairment::{ImpairmentConfig, ImpairmentProxy, LinkConfig};
+use common::*;
+use moq_ffi::*;
+
+const OBJECT_COUNT: u64 = 300;
+const OBJECT_INTERVAL: Duration = Duration::from_millis(10);
+const OBJECT_SIZE: usize = 1000;
+
+/// Named network conditions, applied in both directions.
+fn profiles() -> Vec<(&'static str, LinkConfig)> {
+    vec![
+        ("loopback", LinkConfig::ideal()),
+        (
+            "wifi",
+            LinkConfig {
+                delay: Duration::from_millis(15),
+                jitter: Duration::from_millis(10),
+                loss: 0.01,
+                reorder: 0.01,
+                reorder_delay: Duration::from_millis(20),
+                ..LinkConfig::ideal()
+            },
+        ),
+        (
+            "lossy cellular",
+            LinkConfig {
+                delay: Duration::from_millis(40),
+                jitter: Duration::from_millis(20),
+                loss: 0.02,
+                burst_start: 0.005,
+                burst_end: 0.3,
+                ..LinkConfig::ideal()
+            },
+        ),
+        (
+            "2 Mbit/s",
+            LinkConfig {
+                delay: Duration::from_millis(20),
+                bandwidth_bps: 2_000_000,
+                max_queue_delay: Duration::from_millis(200),
+                ..LinkConfig::ideal()
+            },
+        ),
+    ]
+}
+
+/// Splits "https://host:port" into the host and the address the proxy forwards to.
+fn relay_endpoint(url: &str) -> Option<(String, String)> {
+    let authority = url.split("://").nth(1)?.split('/').next()?;
+    let (host, port) = authority.rsplit_once(':')?;
+    Some((host.to_string(), format!("{}:{}", host, port)))
+}
+
+/// Payloads carry their sequence number; arrival latency is measured against the send time.
+struct Arrivals {
+    start: Instant,
+    sent: Mutex<Vec<Option<Instant>>>,
+    latencies: Mutex<Vec<Duration>>,
+}
+
+unsafe extern "C" fn on_data(user_data: *mut c_void, data: *const u8, len: usize) {
+    let arrivals = &*(user_data as *const Arrivals);
+    if len < 8 {
+        return;
+    }
+    let mut seq = [0u8; 8];
+    seq.copy_from_slice(std::slice::from_raw_parts(data, 8));
+    let seq = u64::from_le_bytes(seq) as usize;
+    let sent = arrivals.sent.lock().unwrap().get(seq).copied().flatten();
+    if let Some(sent) = sent {
+        arrivals.latencies.lock().unwrap().push(sent.elapsed());
+    }
+}
+
+fn percentile(sorted: &[Duration], p: f64) -> f64 {
+    if sorted.is_empty() {
+        return 0.0;
+    }
+    let i = ((sorted.len() - 1) as f64 * p).round() as usize;
+    sorted[i].as_secs_f64() * 1000.0
+}
+
+/// Publishes a paced track through `proxy` and reports delivery for `mode`.
+fn run(host: &str, proxy: &ImpairmentProxy, profile: &str, mode: MoqDeliveryMode) {
+    let url = format!("https://{}:{}", host, proxy.port());
+    let Some(publisher) = connect_client(&url) else { return };
+    let Some(subscriber) = connect_client(&url) else {
+        destroy_client(publisher);
+        return;
+    };
+    let ns = CString::new(unique_namespace("impairment")).unwrap();
+    let track = CString::new("state").unwrap();
+    check(unsafe { moq_announce_namespace(publisher, ns.as_ptr()) }).expect("announce failed");
+    let publ = unsafe { moq_create_publisher_ex(publisher, ns.as_ptr(), track.as_ptr(), mode) };
+    assert!(!publ.is_null(), "publisher creation failed");
+
+    let arrivals = Box::new(Arrivals {
+        start: Instant::now(),
+        sent: Mutex::new(vec![None; OBJECT_COUNT as usize]),
+        latencies: Mutex::new(Vec::new()),
+    });
+    let sub = unsafe {
+        moq_subscribe(subscriber, ns.as_ptr(), track.as_ptr(), Some(on_data), &*arrivals as *const _ as *mut c_void)
+    };
+    assert!(!sub.is_null(), "subscribe failed");
+    std::thread::sleep(Duration::from_millis(500));
+
+    let mut payload = vec![0u8; OBJECT_SIZE];
+    for seq in 0..OBJECT_COUNT {
+        payload[..8].copy_from_slice(&seq.to_le_bytes());
+        arrivals.sent.lock().unwrap()[seq as usize] = Some(Instant::now());
+        let _ = check(unsafe { moq_publish_data(publ, payload.as_ptr(), payload.len(), mode) });
+        std::thread::sleep(OBJECT_INTERVAL);
+    }
+    // Leave time for retransmissions and queued packets
+    std::thread::sleep(Duration::from_secs(2));
+
+    unsafe {
+        moq_subscriber_destroy(sub);
+        moq_publisher_destroy(publ);
+    }
+    destroy_client(subscriber);
+    destroy_client(publisher);
+
+    let mut latencies = arrivals.latencies.lock().unwrap().clone();
+    latencies.sort();
+    println!(
+        "{:<15} | {:<8} | delivered {:>5.1}% | latency p50 {:>7.1} ms  p95 {:>7.1} ms  max {:>7.1} ms | run {:.1} s",
+        profile,
+        if mode == MoqDeliveryMode::MoqDeliveryDatagram { "datagram" } else { "stream" },
+        latencies.len() as f64 * 100.0 / OBJECT_COUNT as f64,
+        percentile(&latencies, 0.5),
+        percentile(&latencies, 0.95),
+        percentile(&latencies, 1.0),
+        arrivals.start.elapsed().as_secs_f64(),
+    );
+}
+
+#[test]
+#[ignore] // Requires a relay on this machine
+fn bench_delivery_under_impairment() {
+    println!("\n=== Benchmark: delivery under impaired networks ===");
+    let Some(url) = relay_url() else { return };
+    let Some((host, upstream)) = relay_endpoint(&url) else {
+        println!("Cannot parse relay URL {}", url);
+        return;
+    };
+
+    for (i, (profile, link)) in profiles().into_iter().enumerate() {
+        let proxy = match ImpairmentProxy::start(upstream.as_str(), ImpairmentConfig::symmetric(link, i as u64 + 1)) {
+            Ok(proxy) => proxy,
+            Err(e) => {
+                println!("Cannot start proxy towards {}: {}", upstream, e);
+                return;
+            }
+        };
+        for mode in [MoqDeliveryMode::MoqDeliveryDatagram, MoqDeliveryMode::MoqDeliveryStream] {
+            run(&host, &proxy, profile, mode);
+        }
+        let (forwarded, lost, queue_dropped, reordered) = proxy.downlink_stats().snapshot();
+        println!(
+            "{:<15} | downlink packets: {} forwarded, {} lost, {} queue dropped, {} reordered",
+            profile, forwarded, lost, queue_dropped, reordered
+        );
+    }
+}
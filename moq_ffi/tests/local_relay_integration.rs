@@ -5,6 +5,8 @@
 // - Start a local relay server with self-signed certificates
 // - Test connectivity and operations against the local relay
 // - Clean up the relay server after tests
+// - Check the UDP impairment proxy (common/impairment.rs) used to put delay,
+//   loss and bandwidth limits between clients and the relay
 //
 // To run these tests:
 // ```
@@ -17,12 +19,17 @@
 #![cfg(feature = "with_moq_draft07")]
 #![allow(clippy::unnecessary_safety_comment)]
 
+mod common;
+
 use std::fs;
 use std::io::Write;
 use std::path::{Path, PathBuf};
 use std::process::{Child, Command, Stdio};
 use std::thread;
-use std::time::Duration;
+use std::net::UdpSocket;
+use std::time::{Duration, Instant};
+
+use common::impairment::{ImpairmentConfig, ImpairmentProxy, LinkConfig};
 
 /// Helper struct to manage the local relay server
 struct LocalRelay {
@@ -290,3 +297,143 @@ fn test_local_relay_multiple_clients() {
     
     // This test is kept as a placeholder for future enhancement
 }
+
+/// Echoes every datagram back to its sender until `count` have been echoed.
+fn spawn_echo(count: usize) -> (std::net::SocketAddr, thread::JoinHandle<()>) {
+    let socket = UdpSocket::bind("127.0.0.1:0").unwrap();
+    let addr = socket.local_addr().unwrap();
+    let handle = thread::spawn(move || {
+        socket.set_read_timeout(Some(Duration::from_secs(5))).unwrap();
+        let mut buf = [0u8; 1500];
+        for _ in 0..count {
+            match socket.recv_from(&mut buf) {
+                Ok((len, from)) => { let _ = socket.send_to(&buf[..len], from); }
+                Err(_) => return,
+            }
+        }
+    });
+    (addr, handle)
+}
+
+/// Sends `count` numbered datagrams through the proxy and returns the numbers echoed back.
+fn round_trip(proxy: &ImpairmentProxy, count: usize, wait: Duration) -> Vec<u32> {
+    let client = UdpSocket::bind("127.0.0.1:0").unwrap();
+    client.set_read_timeout(Some(Duration::from_millis(20))).unwrap();
+    for i in 0..count as u32 {
+        client.send_to(&i.to_le_bytes(), proxy.local_addr()).unwrap();
+    }
+    let deadline = Instant::now() + wait;
+    let mut received = Vec::new();
+    let mut buf = [0u8; 1500];
+    while Instant::now() < deadline && received.len() < count {
+        if let Ok((4, _)) = client.recv_from(&mut buf) {
+            received.push(u32::from_le_bytes([buf[0], buf[1], buf[2], buf[3]]));
+        }
+    }
+    received
+}
+
+#[test]
+fn test_impairment_proxy_forwards_both_directions() {
+    let (echo, handle) = spawn_echo(100);
+    let proxy = ImpairmentProxy::start(echo, ImpairmentConfig::default()).unwrap();
+
+    let received = round_trip(&proxy, 100, Duration::from_secs(5));
+    assert_eq!(received.len(), 100);
+    assert_eq!(proxy.uplink_stats().snapshot(), (100, 0, 0, 0));
+    assert_eq!(proxy.downlink_stats().snapshot(), (100, 0, 0, 0));
+    drop(proxy);
+    handle.join().unwrap();
+}
+
+#[test]
+fn test_impairment_proxy_delays_and_drops() {
+    let (echo, _handle) = spawn_echo(200);
+    let link = LinkConfig {
+        delay: Duration::from_millis(40),
+        loss: 0.25,
+        ..LinkConfig::ideal()
+    };
+    let proxy = ImpairmentProxy::start(echo, ImpairmentConfig::symmetric(link, 7)).unwrap();
+
+    let start = Instant::now();
+    let client = UdpSocket::bind("127.0.0.1:0").unwrap();
+    client.set_read_timeout(Some(Duration::from_secs(2))).unwrap();
+    // The first datagram that survives both directions takes at least two one-way delays
+    let mut buf = [0u8; 16];
+    let mut echoed = false;
+    for i in 0..20u32 {
+        client.send_to(&i.to_le_bytes(), proxy.local_addr()).unwrap();
+        if client.recv_from(&mut buf).is_ok() {
+            echoed = true;
+            break;
+        }
+    }
+    assert!(echoed, "no datagram survived 25% loss in 20 attempts");
+    assert!(start.elapsed() >= Duration::from_millis(80));
+
+    let received = round_trip(&proxy, 180, Duration::from_secs(2));
+    let (up_forwarded, up_lost, _, _) = proxy.uplink_stats().snapshot();
+    let (down_forwarded, _, _, _) = proxy.downlink_stats().snapshot();
+    assert!(up_lost > 0 && up_forwarded > 0);
+    assert_eq!(down_forwarded as usize, received.len() + 1);
+    assert!(received.len() < 180);
+}
+
+#[test]
+fn test_impairment_proxy_caps_bandwidth() {
+    let (echo, _handle) = spawn_echo(50);
+    // 50 x 1000-byte datagrams at 400 kbit/s take a second to drain
+    let link = LinkConfig { bandwidth_bps: 400_000, max_queue_delay: Duration::from_secs(5), ..LinkConfig::ideal() };
+    let config = ImpairmentConfig { uplink: link, ..ImpairmentConfig::default() };
+    let proxy = ImpairmentProxy::start(echo, config).unwrap();
+
+    let client = UdpSocket::bind("127.0.0.1:0").unwrap();
+    client.set_read_timeout(Some(Duration::from_secs(3))).unwrap();
+    let start = Instant::now();
+    for _ in 0..50 {
+        client.send_to(&[0u8; 1000], proxy.local_addr()).unwrap();
+    }
+    let mut buf = [0u8; 1500];
+    for _ in 0..50 {
+        client.recv_from(&mut buf).expect("echo missing");
+    }
+    let elapsed = start.elapsed();
+    assert!(elapsed >= Duration::from_millis(900), "drained in {:?}", elapsed);
+}
+
+#[test]
+#[ignore] // Requires build environment, openssl, and proper certificate setup
+fn test_local_relay_through_impairment_proxy() {
+    println!("\n=== Test: Local Relay Through Impairment Proxy ===");
+
+    let mut relay = match LocalRelay::start(RELAY_PORT) {
+        Ok(relay) => relay,
+        Err(e) => panic!("Relay startup failed: {}", e),
+    };
+    let link = LinkConfig {
+        delay: Duration::from_millis(25),
+        jitter: Duration::from_millis(5),
+        loss: 0.01,
+        ..LinkConfig::ideal()
+    };
+    let proxy = ImpairmentProxy::start(("127.0.0.1", RELAY_PORT), ImpairmentConfig::symmetric(link, 1))
+        .expect("proxy startup failed");
+    let url = format!("https://localhost:{}", proxy.port());
+    println!("Relay at {}, impaired path at {}", relay.url(), url);
+
+    // Connection succeeds only with certificates the client trusts (see test_connect_to_local_relay)
+    match common::connect_client(&url) {
+        Some(client) => {
+            println!("Connected through the proxy");
+            common::destroy_client(client);
+        }
+        None => println!("Could not connect through the proxy; skipping"),
+    }
+    println!("Uplink (forwarded, lost, queue dropped, reordered): {:?}", proxy.uplink_stats().snapshot());
+    println!("Downlink (forwarded, lost, queue dropped, reordered): {:?}", proxy.downlink_stats().snapshot());
+
+    drop(proxy);
+    relay.stop();
+    println!("=== Test Complete ===\n");
+}
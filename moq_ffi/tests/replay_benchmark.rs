@@ -0,0 +1,143 @@
+// Record/replay benchmark
+//
+// Records a paced live track through the relay, then republishes the
+// recording with moq_replayer_create at real-time speed and as fast as
+// possible, reporting how closely the replay follows the recorded timing and
+// the throughput of the unpaced replay.
+//
+// To run:
+// ```
+// MOQ_BENCH_RELAY_URL=https://localhost:4443 \
+//   cargo test --release --features with_moq_draft07 --test replay_benchmark -- --ignored --nocapture --test-threads=1
+// ```
+//
+// Note: Benchmarks are marked with #[ignore] because they need a reachable relay.
+
+#![cfg(feature = "with_moq_draft07")]
+
+mod common;
+
+use std::ffi::{c_void, CString};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
+
+use common::*;
+use moq_ffi::*;
+
+const OBJECT_COUNT: usize = 200;
+const OBJECT_INTERVAL: Duration = Duration::from_millis(10);
+const OBJECT_SIZE: usize = 1200;
+
+#[derive(Default)]
+struct Arrivals {
+    count: AtomicUsize,
+    times: Mutex<Vec<Instant>>,
+}
+
+unsafe extern "C" fn on_data(user_data: *mut c_void, _data: *const u8, _len: usize) {
+    let arrivals = &*(user_data as *const Arrivals);
+    arrivals.times.lock().unwrap().push(Instant::now());
+    arrivals.count.fetch_add(1, Ordering::Relaxed);
+}
+
+fn wait_for(arrivals: &Arrivals, count: usize, limit: Duration) -> bool {
+    let deadline = Instant::now() + limit;
+    while arrivals.count.load(Ordering::Relaxed) < count {
+        if Instant::now() > deadline {
+            return false;
+        }
+        std::thread::sleep(Duration::from_millis(5));
+    }
+    true
+}
+
+/// Replays `path` into a fresh namespace and returns the arrival times seen by a subscriber.
+fn replay(url: &str, path: &CString, speed: f64) -> Option<(Vec<Instant>, Duration)> {
+    let publisher = connect_client(url)?;
+    let subscriber = connect_client(url)?;
+    let ns = CString::new(unique_namespace("replay")).unwrap();
+    let track = CString::new("state").unwrap();
+    check(unsafe { moq_announce_namespace(publisher, ns.as_ptr()) }).expect("announce failed");
+
+    let arrivals = Box::new(Arrivals::default());
+    let sub = unsafe {
+        moq_subscribe(subscriber, ns.as_ptr(), track.as_ptr(), Some(on_data), &*arrivals as *const _ as *mut c_void)
+    };
+    assert!(!sub.is_null(), "subscribe failed");
+    std::thread::sleep(Duration::from_millis(500));
+
+    let start = Instant::now();
+    let replayer = unsafe { moq_replayer_create(publisher, ns.as_ptr(), path.as_ptr(), speed) };
+    assert!(!replayer.is_null(), "replayer creation failed");
+    let complete = wait_for(&arrivals, OBJECT_COUNT, Duration::from_secs(30));
+    let elapsed = start.elapsed();
+    assert!(complete, "replay delivered {} of {} objects", arrivals.count.load(Ordering::Relaxed), OBJECT_COUNT);
+
+    unsafe {
+        moq_replayer_destroy(replayer);
+        moq_subscriber_destroy(sub);
+    }
+    destroy_client(subscriber);
+    destroy_client(publisher);
+    let times = arrivals.times.lock().unwrap().clone();
+    Some((times, elapsed))
+}
+
+#[test]
+#[ignore] // Requires a reachable relay
+fn bench_record_and_replay() {
+    println!("\n=== Benchmark: record and replay ===");
+    let Some(url) = relay_url() else { return };
+    let Some(publisher) = connect_client(&url) else { return };
+    let Some(recorder_client) = connect_client(&url) else { return };
+
+    // Record a paced live track
+    let ns = CString::new(unique_namespace("record")).unwrap();
+    let track = CString::new("state").unwrap();
+    let dir = std::env::temp_dir().join(format!("moq_ffi_replay_bench_{}", std::process::id()));
+    let _ = std::fs::remove_dir_all(&dir);
+    let path = CString::new(dir.to_str().unwrap()).unwrap();
+
+    check(unsafe { moq_announce_namespace(publisher, ns.as_ptr()) }).expect("announce failed");
+    let publ = unsafe { moq_create_publisher(publisher, ns.as_ptr(), track.as_ptr()) };
+    assert!(!publ.is_null(), "publisher creation failed");
+    let recorder = unsafe { moq_recorder_create(recorder_client, ns.as_ptr(), track.as_ptr(), path.as_ptr()) };
+    assert!(!recorder.is_null(), "recorder creation failed");
+    std::thread::sleep(Duration::from_millis(500));
+
+    let payload = vec![0x5A; OBJECT_SIZE];
+    for _ in 0..OBJECT_COUNT {
+        check(unsafe { moq_publish_data(publ, payload.as_ptr(), payload.len(), MoqDeliveryMode::MoqDeliveryStream) })
+            .expect("publish failed");
+        std::thread::sleep(OBJECT_INTERVAL);
+    }
+    std::thread::sleep(Duration::from_millis(500));
+    unsafe {
+        moq_recorder_destroy(recorder);
+        moq_publisher_destroy(publ);
+    }
+    destroy_client(recorder_client);
+    destroy_client(publisher);
+
+    // Real-time replay should reproduce the recorded spacing
+    if let Some((times, elapsed)) = replay(&url, &path, 1.0) {
+        let gaps: Vec<f64> = times.windows(2).map(|w| (w[1] - w[0]).as_secs_f64() * 1000.0).collect();
+        let mean = gaps.iter().sum::<f64>() / gaps.len() as f64;
+        let jitter = (gaps.iter().map(|g| (g - mean).powi(2)).sum::<f64>() / gaps.len() as f64).sqrt();
+        println!(
+            "speed 1.0 | {} objects in {:>8.1} ms | mean gap {:.2} ms (recorded {} ms) | stddev {:.2} ms",
+            times.len(), elapsed.as_secs_f64() * 1000.0, mean, OBJECT_INTERVAL.as_millis(), jitter
+        );
+    }
+
+    // Unpaced replay measures raw republish throughput
+    if let Some((times, elapsed)) = replay(&url, &path, 0.0) {
+        println!(
+            "speed 0   | {} objects in {:>8.1} ms | {:.0} objects/s",
+            times.len(), elapsed.as_secs_f64() * 1000.0, times.len() as f64 / elapsed.as_secs_f64()
+        );
+    }
+
+    let _ = std::fs::remove_dir_all(&dir);
+}
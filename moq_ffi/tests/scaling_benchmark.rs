@@ -0,0 +1,171 @@
+// Setup scaling benchmark for publishers and subscribers
+//
+// Measures how long it takes, and how much resident memory it costs, to set up
+// 1k, 10k and 100k tracks on one client, comparing one call per track with the
+// bulk APIs (moq_create_publishers / moq_subscribe_many).
+//
+// To run:
+// ```
+// MOQ_BENCH_RELAY_URL=https://localhost:4443 \
+//   cargo test --release --features with_moq_draft07 --test scaling_benchmark -- --ignored --nocapture --test-threads=1
+// ```
+//
+// Note: Benchmarks are marked with #[ignore] because they need a reachable relay
+// and take minutes at the largest sizes.
+
+#![cfg(feature = "with_moq_draft07")]
+
+mod common;
+
+use std::ffi::CString;
+use std::time::{Duration, Instant};
+
+use common::*;
+use moq_ffi::*;
+
+const TRACK_COUNTS: [usize; 3] = [1_000, 10_000, 100_000];
+
+struct SetupSample {
+    elapsed: Duration,
+    rss_delta: Option<i64>,
+}
+
+impl SetupSample {
+    fn report(&self, label: &str, count: usize) {
+        println!(
+            "{:>8} tracks | {:<28} | {:>10.1} ms | {:>8.2} us/track | RSS +{}",
+            count,
+            label,
+            self.elapsed.as_secs_f64() * 1000.0,
+            self.elapsed.as_secs_f64() * 1_000_000.0 / count as f64,
+            format_bytes(self.rss_delta),
+        );
+    }
+}
+
+/// Runs `setup` and records its wall-clock time and resident memory growth.
+fn measure<T>(setup: impl FnOnce() -> T) -> (T, SetupSample) {
+    let rss_before = rss_bytes();
+    let start = Instant::now();
+    let value = setup();
+    let elapsed = start.elapsed();
+    let rss_delta = rss_before
+        .zip(rss_bytes())
+        .map(|(before, after)| after as i64 - before as i64);
+    (value, SetupSample { elapsed, rss_delta })
+}
+
+fn track_names(count: usize) -> Vec<CString> {
+    (0..count)
+        .map(|i| CString::new(format!("track-{}", i)).unwrap())
+        .collect()
+}
+
+fn announce(client: *mut MoqClient, namespace: &str) -> CString {
+    let ns = CString::new(namespace).unwrap();
+    check(unsafe { moq_announce_namespace(client, ns.as_ptr()) }).expect("announce failed");
+    ns
+}
+
+#[test]
+#[ignore] // Requires a reachable relay
+fn bench_publisher_setup_scaling() {
+    println!("\n=== Benchmark: publisher setup scaling ===");
+    let Some(url) = relay_url() else { return };
+
+    for &count in &TRACK_COUNTS {
+        let names = track_names(count);
+        let name_ptrs: Vec<_> = names.iter().map(|n| n.as_ptr()).collect();
+
+        // One call per track
+        let Some(client) = connect_client(&url) else { return };
+        let ns = announce(client, &unique_namespace("pub-loop"));
+        let (publishers, sample) = measure(|| {
+            name_ptrs
+                .iter()
+                .map(|&name| unsafe {
+                    moq_create_publisher_ex(client, ns.as_ptr(), name, MoqDeliveryMode::MoqDeliveryStream)
+                })
+                .collect::<Vec<_>>()
+        });
+        assert!(publishers.iter().all(|p| !p.is_null()), "per-track publisher creation failed");
+        sample.report("moq_create_publisher_ex loop", count);
+        for p in publishers {
+            unsafe { moq_publisher_destroy(p) };
+        }
+        destroy_client(client);
+
+        // One bulk call
+        let Some(client) = connect_client(&url) else { return };
+        let ns = announce(client, &unique_namespace("pub-bulk"));
+        let mut publishers = vec![std::ptr::null_mut(); count];
+        let (result, sample) = measure(|| unsafe {
+            check(moq_create_publishers(
+                client,
+                ns.as_ptr(),
+                name_ptrs.as_ptr(),
+                count,
+                MoqDeliveryMode::MoqDeliveryStream,
+                publishers.as_mut_ptr(),
+            ))
+        });
+        result.expect("bulk publisher creation failed");
+        sample.report("moq_create_publishers", count);
+        for p in publishers {
+            unsafe { moq_publisher_destroy(p) };
+        }
+        destroy_client(client);
+    }
+}
+
+#[test]
+#[ignore] // Requires a reachable relay
+fn bench_subscriber_setup_scaling() {
+    println!("\n=== Benchmark: subscriber setup scaling ===");
+    let Some(url) = relay_url() else { return };
+
+    for &count in &TRACK_COUNTS {
+        let names = track_names(count);
+        let name_ptrs: Vec<_> = names.iter().map(|n| n.as_ptr()).collect();
+
+        // One call per track
+        let Some(client) = connect_client(&url) else { return };
+        let ns = CString::new(unique_namespace("sub-loop")).unwrap();
+        let (subscribers, sample) = measure(|| {
+            name_ptrs
+                .iter()
+                .map(|&name| unsafe {
+                    moq_subscribe(client, ns.as_ptr(), name, None, std::ptr::null_mut())
+                })
+                .collect::<Vec<_>>()
+        });
+        assert!(subscribers.iter().all(|s| !s.is_null()), "per-track subscribe failed");
+        sample.report("moq_subscribe loop", count);
+        for s in subscribers {
+            unsafe { moq_subscriber_destroy(s) };
+        }
+        destroy_client(client);
+
+        // One bulk call
+        let Some(client) = connect_client(&url) else { return };
+        let ns = CString::new(unique_namespace("sub-bulk")).unwrap();
+        let mut subscribers = vec![std::ptr::null_mut(); count];
+        let (result, sample) = measure(|| unsafe {
+            check(moq_subscribe_many(
+                client,
+                ns.as_ptr(),
+                name_ptrs.as_ptr(),
+                count,
+                None,
+                std::ptr::null(),
+                subscribers.as_mut_ptr(),
+            ))
+        });
+        result.expect("bulk subscribe failed");
+        sample.report("moq_subscribe_many", count);
+        for s in subscribers {
+            unsafe { moq_subscriber_destroy(s) };
+        }
+        destroy_client(client);
+    }
+}
@@ -0,0 +1,136 @@
+// Startup: cold versus prewarmed time to the first object
+//
+// Measures what an application waits for at startup: the time from moq_init()
+// to the first object a fresh client receives through the relay. Every round
+// starts from moq_shutdown(), so the runtime, root certificates and idle
+// sessions have to be built again, and then warms up one of three ways:
+// - cold: nothing ahead of time, all of it on the critical path
+// - prewarmed: moq_prewarm() ran first, as during other startup work
+// - preconnected: moq_prewarm_ex() also opened an idle session
+// The first object is the client's first latency probe coming back from the
+// relay, so a single client both publishes and receives it. The three modes
+// take turns each round so that drift on the path affects them alike.
+//
+// To run:
+// ```
+// MOQ_BENCH_RELAY_URL=https://localhost:4443 \
+//   cargo test --release --features with_moq_draft07 --test startup_benchmark -- --ignored --nocapture --test-threads=1
+// ```
+//
+// Note: Benchmarks are marked with #[ignore] because they need a reachable relay.
+// The system resolver may cache the relay's address after the first round, which
+// then makes later cold rounds faster than a true first start.
+
+#![cfg(feature = "with_moq_draft07")]
+
+mod common;
+
+use std::ffi::{c_void, CString};
+use std::sync::mpsc::{sync_channel, Receiver, SyncSender};
+use std::time::{Duration, Instant};
+
+use common::*;
+use moq_ffi::*;
+
+const ROUNDS: usize = 10;
+const PROBE_INTERVAL_MS: u32 = 5;
+const FIRST_OBJECT_TIMEOUT: Duration = Duration::from_secs(10);
+const SHUTDOWN_TIMEOUT_MS: u64 = 5_000;
+
+#[derive(Debug, Copy, Clone, PartialEq, Eq)]
+enum Warmup {
+    Cold,
+    Prewarmed,
+    Preconnected,
+}
+
+const MODES: [Warmup; 3] = [Warmup::Cold, Warmup::Prewarmed, Warmup::Preconnected];
+
+unsafe extern "C" fn on_echo(user_data: *mut c_void, _latency_us: u64, _sequence: u64) {
+    let _ = (*(user_data as *const SyncSender<Instant>)).try_send(Instant::now());
+}
+
+/// Shuts the library down, warms it up as `warmup` says, then times
+/// moq_init() to the first echoed probe. Returns the warm-up and startup times.
+fn startup(
+    url: &CString,
+    warmup: Warmup,
+    echoes: &SyncSender<Instant>,
+    first_echo: &Receiver<Instant>,
+) -> Result<(Duration, Duration), String> {
+    check(moq_shutdown(SHUTDOWN_TIMEOUT_MS))?;
+    while first_echo.try_recv().is_ok() {}
+
+    let urls = [url.as_ptr()];
+    let warmup_start = Instant::now();
+    match warmup {
+        Warmup::Cold => {}
+        Warmup::Prewarmed => check(unsafe { moq_prewarm(urls.as_ptr(), urls.len()) })?,
+        Warmup::Preconnected => check(unsafe { moq_prewarm_ex(urls.as_ptr(), urls.len(), true) })?,
+    }
+    let warmup_time = warmup_start.elapsed();
+
+    let start = Instant::now();
+    moq_init();
+    let client = moq_client_create();
+    let arrived = unsafe {
+        check(moq_connect(client, url.as_ptr(), None, std::ptr::null_mut()))
+            .and_then(|()| {
+                check(moq_client_start_latency_probe(
+                    client,
+                    PROBE_INTERVAL_MS,
+                    Some(on_echo),
+                    echoes as *const SyncSender<Instant> as *mut c_void,
+                ))
+            })
+            .and_then(|()| first_echo.recv_timeout(FIRST_OBJECT_TIMEOUT).map_err(|_| "No probe came back".to_string()))
+    };
+    destroy_client(client);
+    arrived.map(|arrived| (warmup_time, arrived - start))
+}
+
+fn millis(duration: Duration) -> f64 {
+    duration.as_secs_f64() * 1000.0
+}
+
+fn report(warmup: Warmup, samples: &mut [(Duration, Duration)]) {
+    if samples.is_empty() {
+        println!("{:<13} | no successful rounds", format!("{:?}", warmup));
+        return;
+    }
+    let mean_warmup = samples.iter().map(|s| s.0).sum::<Duration>() / samples.len() as u32;
+    samples.sort_by_key(|s| s.1);
+    println!(
+        "{:<13} | warm-up {:>7.1} ms | init to first object: min {:>7.1} ms | median {:>7.1} ms | max {:>7.1} ms",
+        format!("{:?}", warmup),
+        millis(mean_warmup),
+        millis(samples[0].1),
+        millis(samples[samples.len() / 2].1),
+        millis(samples[samples.len() - 1].1),
+    );
+}
+
+#[test]
+#[ignore] // Requires a reachable relay
+fn bench_startup_to_first_object() {
+    println!("\n=== Benchmark: moq_init() to first object, {} rounds ===", ROUNDS);
+    let Some(url) = relay_url() else { return };
+    let url = CString::new(url).unwrap();
+    // Outlives every round: a probe callback may still run while its client is destroyed
+    let (echoes, first_echo) = sync_channel::<Instant>(1);
+
+    let mut samples: Vec<Vec<(Duration, Duration)>> = vec![Vec::new(); MODES.len()];
+    for round in 0..ROUNDS {
+        for (mode, warmup) in MODES.iter().enumerate() {
+            match startup(&url, *warmup, &echoes, &first_echo) {
+                Ok(sample) => samples[mode].push(sample),
+                Err(e) => println!("Round {} {:?} failed: {}", round, warmup, e),
+            }
+        }
+    }
+    check(moq_shutdown(SHUTDOWN_TIMEOUT_MS)).expect("shutdown failed");
+
+    for (warmup, samples) in MODES.iter().zip(samples.iter_mut()) {
+        report(*warmup, samples);
+    }
+}
@@ -0,0 +1,216 @@
+// UDP offload (GSO/GRO) on and off
+//
+// Pushes 1 GiB of loopback datagrams through the client's UDP socket, driven
+// the way quinn's endpoint drives it, once with offload and once without, and
+// reports packets per system call and the CPU time the sending or receiving
+// thread spends per GiB. These are the two numbers offload is meant to move:
+// fewer, larger calls into the kernel for the same traffic.
+//
+// To run (Linux):
+// ```
+// cargo test --release --features with_moq_draft07 --test udp_offload_benchmark -- --ignored --nocapture --test-threads=1
+// ```
+//
+// Note: Benchmarks are marked with #[ignore] because they saturate the loopback interface.
+
+#![cfg(all(target_os = "linux", any(feature = "with_moq", feature = "with_moq_draft07")))]
+
+use std::future::poll_fn;
+use std::io::IoSliceMut;
+use std::net::SocketAddr;
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use moq_ffi::{OffloadSocket, UdpOffload};
+use quinn::udp::{RecvMeta, Transmit};
+use quinn::AsyncUdpSocket;
+
+const TOTAL_BYTES: usize = 1 << 30;
+/// A full-size QUIC packet on a 1500 byte MTU path
+const DATAGRAM_SIZE: usize = 1452;
+/// Datagrams quinn puts in one transmit, however many the socket allows
+const QUINN_SEGMENTS: usize = 10;
+/// Receive buffers handed to poll_recv at once, as quinn does
+const BATCH: usize = 32;
+/// Room for one coalesced receive, which the kernel keeps within 64 KiB
+const RECV_BUFFER_SIZE: usize = u16::MAX as usize;
+const IDLE: Duration = Duration::from_millis(200);
+
+const ON: UdpOffload = UdpOffload { gso: true, gro: true };
+const OFF: UdpOffload = UdpOffload { gso: false, gro: false };
+
+fn loopback() -> SocketAddr {
+    "127.0.0.1:0".parse().unwrap()
+}
+
+fn offload_socket(offload: UdpOffload) -> Arc<OffloadSocket> {
+    Arc::new(OffloadSocket::bind(loopback(), offload).unwrap())
+}
+
+/// CPU time consumed by the calling thread, user plus system.
+fn thread_cpu() -> Duration {
+    let mut usage: libc::rusage = unsafe { std::mem::zeroed() };
+    unsafe { libc::getrusage(libc::RUSAGE_THREAD, &mut usage) };
+    let micros = |t: libc::timeval| t.tv_sec as u64 * 1_000_000 + t.tv_usec as u64;
+    Duration::from_micros(micros(usage.ru_utime) + micros(usage.ru_stime))
+}
+
+fn runtime() -> tokio::runtime::Runtime {
+    tokio::runtime::Builder::new_current_thread().enable_all().build().unwrap()
+}
+
+fn report(name: &str, segments: usize, datagrams: usize, calls: usize, wall: Duration, cpu: Duration) {
+    let bytes = (datagrams * DATAGRAM_SIZE) as f64;
+    println!(
+        "{:<16} | {:>2} segments | {:>5.1} packets per call | {:>6.2} Gbit/s | {:>6.0} ms CPU per GiB",
+        name,
+        segments,
+        datagrams as f64 / calls.max(1) as f64,
+        bytes * 8.0 / wall.as_secs_f64() / 1e9,
+        cpu.as_secs_f64() * 1000.0 * (1u64 << 30) as f64 / bytes.max(1.0),
+    );
+}
+
+/// Sends TOTAL_BYTES in transmits of as many datagrams as quinn would use,
+/// waiting on its poller when it is full, while a separate task keeps
+/// receiving as quinn's endpoint driver does. A plain socket drains the sink.
+fn measure_send(name: &str, socket: Arc<dyn AsyncUdpSocket>, rt: &tokio::runtime::Runtime) {
+    let sink = std::net::UdpSocket::bind(loopback()).unwrap();
+    sink.set_read_timeout(Some(IDLE)).unwrap();
+    let destination = sink.local_addr().unwrap();
+    let drain = std::thread::spawn(move || {
+        let mut buf = [0u8; 2048];
+        while sink.recv(&mut buf).is_ok() {}
+    });
+
+    let segments = socket.max_transmit_segments().min(QUINN_SEGMENTS);
+    let (calls, wall, cpu) = rt.block_on(async {
+        let driver = tokio::spawn({
+            let socket = socket.clone();
+            async move {
+                let mut storage = [0u8; 2048];
+                let mut meta = [RecvMeta::default()];
+                loop {
+                    let mut bufs = [IoSliceMut::new(&mut storage)];
+                    if poll_fn(|cx| socket.poll_recv(cx, &mut bufs, &mut meta)).await.is_err() {
+                        return;
+                    }
+                }
+            }
+        });
+
+        let payload = vec![0x5Au8; segments * DATAGRAM_SIZE];
+        let transmit = Transmit {
+            destination,
+            ecn: None,
+            contents: &payload,
+            segment_size: (segments > 1).then_some(DATAGRAM_SIZE),
+            src_ip: None,
+        };
+        let mut poller = socket.clone().create_io_poller();
+        let mut calls = 0;
+        let start = Instant::now();
+        let cpu_start = thread_cpu();
+        while calls * payload.len() < TOTAL_BYTES {
+            match socket.try_send(&transmit) {
+                Ok(()) => calls += 1,
+                Err(e) if e.kind() == std::io::ErrorKind::WouldBlock => {
+                    poll_fn(|cx| poller.as_mut().poll_writable(cx)).await.unwrap();
+                }
+                Err(e) => panic!("send failed: {}", e),
+            }
+        }
+        let measured = (calls, start.elapsed(), thread_cpu() - cpu_start);
+        driver.abort();
+        measured
+    });
+    drain.join().unwrap();
+    report(name, segments, calls * segments, calls, wall, cpu);
+}
+
+/// Receives until a GSO sender thread has sent TOTAL_BYTES and the socket
+/// has gone idle. Loopback hands GSO sends to a GRO receiver unsplit, so the
+/// receive side sees what offload buys it.
+fn measure_receive(name: &str, offload: UdpOffload) {
+    let rt = runtime();
+    let _guard = rt.enter();
+    let socket = offload_socket(offload);
+    let target = socket.local_addr().unwrap();
+
+    let sender = std::thread::spawn(move || {
+        let rt = runtime();
+        let _guard = rt.enter();
+        let socket = offload_socket(ON);
+        let segments = socket.max_transmit_segments().min(QUINN_SEGMENTS);
+        let payload = vec![0xA5u8; segments * DATAGRAM_SIZE];
+        let transmit = Transmit {
+            destination: target,
+            ecn: None,
+            contents: &payload,
+            segment_size: (segments > 1).then_some(DATAGRAM_SIZE),
+            src_ip: None,
+        };
+        rt.block_on(async {
+            let mut poller = socket.clone().create_io_poller();
+            let mut sent = 0;
+            while sent < TOTAL_BYTES {
+                match socket.try_send(&transmit) {
+                    Ok(()) => sent += payload.len(),
+                    Err(e) if e.kind() == std::io::ErrorKind::WouldBlock => {
+                        poll_fn(|cx| poller.as_mut().poll_writable(cx)).await.unwrap();
+                    }
+                    Err(e) => panic!("send failed: {}", e),
+                }
+            }
+        });
+    });
+
+    let segments = socket.max_receive_segments();
+    let (datagrams, calls, wall, cpu) = rt.block_on(async {
+        let mut storage = vec![vec![0u8; RECV_BUFFER_SIZE]; BATCH];
+        let mut meta = [RecvMeta::default(); BATCH];
+        let (mut datagrams, mut calls) = (0, 0);
+        let mut start = None;
+        let mut last = Instant::now();
+        let cpu_start = thread_cpu();
+        loop {
+            let mut bufs: Vec<IoSliceMut> = storage.iter_mut().map(|b| IoSliceMut::new(b)).collect();
+            match tokio::time::timeout(IDLE, poll_fn(|cx| socket.poll_recv(cx, &mut bufs, &mut meta))).await {
+                Ok(Ok(n)) => {
+                    start.get_or_insert_with(Instant::now);
+                    last = Instant::now();
+                    calls += 1;
+                    datagrams += meta[..n].iter().map(|m| m.len.div_ceil(m.stride.max(1))).sum::<usize>();
+                }
+                Ok(Err(e)) => panic!("receive failed: {}", e),
+                Err(_) => break,
+            }
+        }
+        // The idle wait at the end sleeps, so it costs no CPU; wall time stops at the last datagram
+        (datagrams, calls, last - start.unwrap_or(last), thread_cpu() - cpu_start)
+    });
+    sender.join().unwrap();
+    report(name, segments, datagrams, calls, wall, cpu);
+    let expected = TOTAL_BYTES.div_ceil(DATAGRAM_SIZE);
+    if datagrams < expected {
+        println!("                 | {} datagrams dropped by the kernel", expected.saturating_sub(datagrams));
+    }
+}
+
+#[test]
+#[ignore] // Saturates the loopback interface
+fn bench_send() {
+    println!("\n=== Benchmark: UDP send, 1 GiB in {} byte datagrams ===", DATAGRAM_SIZE);
+    let rt = runtime();
+    let _guard = rt.enter();
+    measure_send("default gso on", offload_socket(ON), &rt);
+    measure_send("default gso off", offload_socket(OFF), &rt);
+}
+
+#[test]
+#[ignore] // Saturates the loopback interface
+fn bench_receive() {
+    println!("\n=== Benchmark: UDP receive, 1 GiB in {} byte datagrams from a GSO sender ===", DATAGRAM_SIZE);
+    measure_receive("default gro on", ON);
+    measure_receive("default gro off", OFF);
+}
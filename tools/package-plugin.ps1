@@ -24,7 +24,7 @@ if (-not (Test-Path $IncludeSrc)) { Die "[package-plugin] Include dir not found:
 
 # Layout (drop-in for UE plugin):
 # artifacts/plugin-windows-x64/
-#   ThirdParty/moq_ffi/include/*.h
+#   ThirdParty/moq_ffi/include/*.h, *.hpp
 #   ThirdParty/moq_ffi/lib/Win64/Release/{moq_ffi.dll.lib, moq_ffi.lib}
 #   ThirdParty/moq_ffi/bin/Win64/Release/{moq_ffi.dll, moq_ffi.pdb}
 
@@ -44,6 +44,7 @@ Remove-Item -ErrorAction SilentlyContinue (Join-Path $OutLib "moq_ffi.lib")
 
 Info "[package-plugin] Copying headers -> $OutInclude"
 Copy-Item (Join-Path $IncludeSrc "*.h") -Destination $OutInclude -Force
+Copy-Item (Join-Path $IncludeSrc "*.hpp") -Destination $OutInclude -Force
 
 Info "[package-plugin] Copying libs -> $OutLib (import lib only)"
 $implib = Join-Path $TargetDir "moq_ffi.dll.lib"
@@ -23,7 +23,7 @@ if (-not (Test-Path $IncludeSrc)) { Die "[package] Include dir not found: $Inclu
 
 # Layout:
 # artifacts/windows-x64/
-#   include/ *.h
+#   include/ *.h, *.hpp
 #   bin/ moq_ffi.dll, moq_ffi.pdb
 #   lib/Win64/Release/ moq_ffi.dll.lib and moq_ffi.lib
 
@@ -37,6 +37,7 @@ New-Item -ItemType Directory -Force -Path $OutLib | Out-Null
 
 Info "[package] Copying headers"
 Copy-Item (Join-Path $IncludeSrc "*.h") -Destination $OutInclude -Force
+Copy-Item (Join-Path $IncludeSrc "*.hpp") -Destination $OutInclude -Force
 
 Info "[package] Copying binaries/libs"
 $dll = Join-Path $TargetDir "moq_ffi.dll"